@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "Workload.hpp"
+
+#include <rmf_task/BinaryPriorityScheme.hpp>
+#include <rmf_task/requests/Clean.hpp>
+#include <rmf_task/requests/Delivery.hpp>
+#include <rmf_task/requests/Loop.hpp>
+
+#include <rmf_traffic/agv/VehicleTraits.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/Profile.hpp>
+#include <rmf_traffic/Trajectory.hpp>
+
+#include <rmf_battery/agv/BatterySystem.hpp>
+#include <rmf_battery/agv/SimpleDevicePowerSink.hpp>
+#include <rmf_battery/agv/SimpleMotionPowerSink.hpp>
+
+namespace rmf_task {
+namespace workload {
+
+namespace {
+
+//==============================================================================
+const std::string map_name = "benchmark_map";
+
+} // anonymous namespace
+
+//==============================================================================
+rmf_traffic::agv::Graph make_graph(const Layout layout, const std::size_t side)
+{
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < side; ++i)
+  {
+    for (std::size_t j = 0; j < side; ++j)
+    {
+      graph.add_waypoint(
+        map_name, {static_cast<double>(j) * edge_length,
+          -static_cast<double>(i) * edge_length});
+    }
+  }
+
+  const auto add_bidir_lane = [&](const std::size_t w0, const std::size_t w1)
+    {
+      graph.add_lane(w0, w1);
+      graph.add_lane(w1, w0);
+    };
+
+  for (std::size_t i = 0; i < side; ++i)
+  {
+    for (std::size_t j = 0; j < side; ++j)
+    {
+      const std::size_t w = i * side + j;
+      const bool cross_row = layout == Grid || i == 0 || i + 1 == side;
+      if (j + 1 < side && cross_row)
+        add_bidir_lane(w, w + 1);
+
+      if (i + 1 < side)
+        add_bidir_lane(w, w + side);
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+Fleet make_fleet(
+  rmf_traffic::agv::Graph graph,
+  const std::size_t num_agents,
+  const bool drain_battery,
+  const rmf_traffic::Time now,
+  std::mt19937& rng)
+{
+  using namespace rmf_battery::agv;
+
+  Fleet fleet;
+  fleet.graph = std::move(graph);
+  const std::size_t num_waypoints = fleet.graph.num_waypoints();
+
+  const auto shape = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(1.0);
+  const rmf_traffic::Profile profile{shape, shape};
+  const rmf_traffic::agv::VehicleTraits traits(
+    {1.0, 0.7}, {0.6, 0.5}, profile);
+
+  fleet.planner = std::make_shared<rmf_traffic::agv::Planner>(
+    rmf_traffic::agv::Planner::Configuration{fleet.graph, traits},
+    rmf_traffic::agv::Planner::Options{nullptr});
+
+  const auto battery_system = *BatterySystem::make(24.0, 40.0, 8.8);
+  const auto mechanical_system = *MechanicalSystem::make(70.0, 40.0, 0.22);
+  const auto power_system = *PowerSystem::make(20.0);
+
+  const Parameters parameters{
+    fleet.planner,
+    battery_system,
+    std::make_shared<SimpleMotionPowerSink>(battery_system, mechanical_system),
+    std::make_shared<SimpleDevicePowerSink>(battery_system, power_system)};
+
+  const Constraints constraints{0.2, 1.0, drain_battery};
+  fleet.config.emplace(
+    parameters, constraints,
+    BinaryPriorityScheme::make_cost_calculator());
+
+  std::uniform_int_distribution<std::size_t> waypoint(0, num_waypoints - 1);
+  std::uniform_real_distribution<double> soc(0.6, 1.0);
+  for (std::size_t a = 0; a < num_agents; ++a)
+  {
+    const std::size_t charger = waypoint(rng);
+    rmf_traffic::agv::Plan::Start start{now, charger, 0.0};
+    fleet.agents.push_back(State().load_basic(start, charger, soc(rng)));
+  }
+
+  return fleet;
+}
+
+//==============================================================================
+ConstRequestPtr make_request(
+  const RequestType type,
+  const rmf_traffic::agv::Graph& graph,
+  const std::size_t from,
+  const std::size_t to,
+  const std::string& id,
+  const rmf_traffic::Time earliest_start_time,
+  ConstPriorityPtr priority)
+{
+  switch (type)
+  {
+    case Delivery:
+      return requests::Delivery::make(
+        from, rmf_traffic::time::from_seconds(10.0),
+        to, rmf_traffic::time::from_seconds(10.0),
+        {{}}, id, earliest_start_time, std::move(priority));
+    case Loop:
+      return requests::Loop::make(
+        from, to, 2, id, earliest_start_time, std::move(priority));
+    default:
+    {
+      const auto location = graph.get_waypoint(from).get_location();
+      rmf_traffic::Trajectory path;
+      path.insert(
+        earliest_start_time,
+        Eigen::Vector3d(location.x(), location.y(), 0.0),
+        Eigen::Vector3d::Zero());
+      path.insert(
+        earliest_start_time + rmf_traffic::time::from_seconds(60.0),
+        Eigen::Vector3d(location.x() + edge_length, location.y(), 0.0),
+        Eigen::Vector3d::Zero());
+      return requests::Clean::make(
+        from, from, path, id, earliest_start_time, std::move(priority));
+    }
+  }
+}
+
+//==============================================================================
+RequestStream::RequestStream(
+  rmf_traffic::agv::Graph graph,
+  const double requests_per_hour,
+  const Mix mix,
+  const double high_priority_fraction,
+  const rmf_traffic::Time start,
+  const unsigned int seed)
+: _graph(std::move(graph)),
+  _rng(seed),
+  _interarrival(requests_per_hour / 3600.0),
+  _type({mix.delivery, mix.loop, mix.clean}),
+  _waypoint(0, _graph.num_waypoints() - 1),
+  _high_priority(high_priority_fraction),
+  _next_arrival(start)
+{
+  _next_arrival += rmf_traffic::time::from_seconds(_interarrival(_rng));
+}
+
+//==============================================================================
+rmf_traffic::Time RequestStream::next_arrival() const
+{
+  return _next_arrival;
+}
+
+//==============================================================================
+ConstRequestPtr RequestStream::next()
+{
+  const auto type = static_cast<RequestType>(_type(_rng));
+  const std::size_t from = _waypoint(_rng);
+  const std::size_t to = _waypoint(_rng);
+  auto priority = _high_priority(_rng) ?
+    BinaryPriorityScheme::make_high_priority() : nullptr;
+
+  auto request = make_request(
+    type, _graph, from, to, "request_" + std::to_string(_count++),
+    _next_arrival, std::move(priority));
+
+  _next_arrival += rmf_traffic::time::from_seconds(_interarrival(_rng));
+  return request;
+}
+
+//==============================================================================
+std::size_t RequestStream::count() const
+{
+  return _count;
+}
+
+} // namespace workload
+} // namespace rmf_task
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef BENCHMARK__WORKLOAD_HPP
+#define BENCHMARK__WORKLOAD_HPP
+
+#include <rmf_task/Request.hpp>
+#include <rmf_task/State.hpp>
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <rmf_traffic/agv/Graph.hpp>
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+namespace workload {
+
+//==============================================================================
+/// The distance between neighboring waypoints of a generated graph
+constexpr double edge_length = 10.0;
+
+//==============================================================================
+enum Layout
+{
+  /// Every pair of neighboring waypoints is connected
+  Grid = 0,
+
+  /// The columns of waypoints are only connected through the first and last
+  /// rows, like aisles between shelves
+  Warehouse = 1
+};
+
+//==============================================================================
+/// Make a square graph of waypoints with side * side waypoints
+rmf_traffic::agv::Graph make_graph(Layout layout, std::size_t side);
+
+//==============================================================================
+/// A fleet of agents on a graph, along with everything the task planner needs
+/// to plan for it
+struct Fleet
+{
+  rmf_traffic::agv::Graph graph;
+  std::shared_ptr<rmf_traffic::agv::Planner> planner;
+  std::optional<TaskPlanner::Configuration> config;
+  std::vector<State> agents;
+};
+
+//==============================================================================
+/// Make a fleet whose agents start at random waypoints, which are also their
+/// chargers, with a random battery charge between 60% and 100%.
+///
+/// \param[in] graph
+///   The graph that the fleet moves on
+///
+/// \param[in] num_agents
+///   The number of agents in the fleet
+///
+/// \param[in] drain_battery
+///   Whether the planner accounts for the battery of the agents
+///
+/// \param[in] now
+///   The time that the agents start at
+///
+/// \param[in] rng
+///   The random numbers that the fleet is made from
+Fleet make_fleet(
+  rmf_traffic::agv::Graph graph,
+  std::size_t num_agents,
+  bool drain_battery,
+  rmf_traffic::Time now,
+  std::mt19937& rng);
+
+//==============================================================================
+enum RequestType
+{
+  Delivery = 0,
+  Loop = 1,
+  Clean = 2
+};
+
+//==============================================================================
+/// Make a request of the given type between two waypoints of a graph. A
+/// Clean request cleans the lane next to its starting waypoint.
+ConstRequestPtr make_request(
+  RequestType type,
+  const rmf_traffic::agv::Graph& graph,
+  std::size_t from,
+  std::size_t to,
+  const std::string& id,
+  rmf_traffic::Time earliest_start_time,
+  ConstPriorityPtr priority = nullptr);
+
+//==============================================================================
+/// A stream of requests whose arrivals follow a Poisson process. Each request
+/// may start as soon as it arrives.
+class RequestStream
+{
+public:
+
+  /// How often each type of request appears, relative to the others
+  struct Mix
+  {
+    double delivery = 1.0;
+    double loop = 1.0;
+    double clean = 1.0;
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] graph
+  ///   The graph that the requests take place on
+  ///
+  /// \param[in] requests_per_hour
+  ///   The average rate that requests arrive at
+  ///
+  /// \param[in] mix
+  ///   How often each type of request appears
+  ///
+  /// \param[in] high_priority_fraction
+  ///   The fraction of the requests that have a high priority
+  ///
+  /// \param[in] start
+  ///   The time that the stream starts at
+  ///
+  /// \param[in] seed
+  ///   The seed of the random numbers of the stream
+  RequestStream(
+    rmf_traffic::agv::Graph graph,
+    double requests_per_hour,
+    Mix mix,
+    double high_priority_fraction,
+    rmf_traffic::Time start,
+    unsigned int seed = 42);
+
+  /// The time that the next request arrives
+  rmf_traffic::Time next_arrival() const;
+
+  /// Take the next request from the stream
+  ConstRequestPtr next();
+
+  /// The number of requests that have been taken from the stream
+  std::size_t count() const;
+
+private:
+  rmf_traffic::agv::Graph _graph;
+  std::mt19937 _rng;
+  std::exponential_distribution<double> _interarrival;
+  std::discrete_distribution<int> _type;
+  std::uniform_int_distribution<std::size_t> _waypoint;
+  std::bernoulli_distribution _high_priority;
+  rmf_traffic::Time _next_arrival;
+  std::size_t _count = 0;
+};
+
+} // namespace workload
+} // namespace rmf_task
+
+#endif // BENCHMARK__WORKLOAD_HPP
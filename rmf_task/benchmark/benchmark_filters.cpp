@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Compares the node filters of the task planner on synthetic search nodes.
+// Each node assigns a random subset of tasks to a few agents, and a fraction
+// of the nodes repeat an earlier set of assignments so that every filter has
+// some duplicates to detect.
+//
+// Usage: benchmark_filters [num_tasks] [num_agents] [num_nodes]
+
+#include "Filter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace rmf_task;
+
+namespace {
+
+//==============================================================================
+using Sequence = std::vector<std::vector<std::size_t>>;
+
+//==============================================================================
+std::vector<Sequence> make_sequences(
+  const std::size_t num_tasks,
+  const std::size_t num_agents,
+  const std::size_t num_nodes)
+{
+  std::mt19937 rng(42);
+  std::vector<std::size_t> tasks(num_tasks);
+  for (std::size_t i = 0; i < num_tasks; ++i)
+    tasks[i] = i + 1;
+
+  std::vector<Sequence> sequences;
+  sequences.reserve(num_nodes);
+  std::uniform_int_distribution<std::size_t> pick_agent(0, num_agents - 1);
+  std::uniform_int_distribution<std::size_t> pick_depth(1, num_tasks);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  for (std::size_t n = 0; n < num_nodes; ++n)
+  {
+    if (!sequences.empty() && chance(rng) < 0.25)
+    {
+      std::uniform_int_distribution<std::size_t> pick(0, sequences.size() - 1);
+      sequences.push_back(sequences[pick(rng)]);
+      continue;
+    }
+
+    std::shuffle(tasks.begin(), tasks.end(), rng);
+    Sequence sequence(num_agents);
+    const std::size_t depth = pick_depth(rng);
+    for (std::size_t i = 0; i < depth; ++i)
+      sequence[pick_agent(rng)].push_back(tasks[i]);
+
+    sequences.push_back(std::move(sequence));
+  }
+
+  return sequences;
+}
+
+//==============================================================================
+std::vector<Node> make_nodes(const std::vector<Sequence>& sequences)
+{
+  const TaskPlanner::Assignment assignment{
+    nullptr, State(), rmf_traffic::Time()};
+
+  std::vector<Node> nodes;
+  nodes.reserve(sequences.size());
+  for (const auto& sequence : sequences)
+  {
+    Node node;
+    node.assigned_tasks.resize(sequence.size());
+    for (std::size_t a = 0; a < sequence.size(); ++a)
+    {
+      for (const auto id : sequence[a])
+        node.push_assignment(a, Node::AssignmentWrapper{id, assignment});
+    }
+
+    nodes.push_back(std::move(node));
+  }
+
+  return nodes;
+}
+
+//==============================================================================
+void run(
+  const std::string& name,
+  const TaskPlanner::FilterType type,
+  const std::size_t num_tasks,
+  const std::vector<Node>& nodes)
+{
+  Filter filter{type, num_tasks};
+  std::size_t ignored = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& node : nodes)
+  {
+    if (filter.ignore(node))
+      ++ignored;
+  }
+  const auto finish = std::chrono::steady_clock::now();
+
+  const double seconds = std::chrono::duration<double>(finish - start).count();
+  std::cout << name
+            << ": " << seconds * 1e3 << " ms, "
+            << static_cast<double>(nodes.size()) / seconds << " nodes/s, "
+            << ignored << " ignored, "
+            << filter.memory_usage() / 1024 << " KiB" << std::endl;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t num_tasks = argc > 1 ? std::stoul(argv[1]) : 200;
+  const std::size_t num_agents = argc > 2 ? std::stoul(argv[2]) : 8;
+  const std::size_t num_nodes = argc > 3 ? std::stoul(argv[3]) : 100000;
+  if (num_tasks == 0 || num_agents == 0)
+  {
+    std::cerr << "The number of tasks and agents must be positive"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << num_nodes << " nodes, " << num_tasks << " tasks, "
+            << num_agents << " agents" << std::endl;
+
+  const auto nodes = make_nodes(
+    make_sequences(num_tasks, num_agents, num_nodes));
+
+  run("Passthrough", TaskPlanner::FilterType::Passthrough, num_tasks, nodes);
+  run("Trie", TaskPlanner::FilterType::Trie, num_tasks, nodes);
+  run("Hash", TaskPlanner::FilterType::Hash, num_tasks, nodes);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+// Compares the open list of the optimal search against a binary heap of node
+// pointers ordered by LowestCostEstimate, which is what the search used
+// before. The workload imitates a search that expands one node for every few
+// that it generates, where the generated nodes tend to cost more as the
+// search goes on.
+//
+// Usage: benchmark_open_list [num_nodes] [branching] [heuristic_weight]
+
+#include "OpenList.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace rmf_task;
+
+namespace {
+
+//==============================================================================
+// The nodes in the order that the workload generates them. Later nodes tend
+// to cost more, like the descendants of a node in a search, but not strictly.
+std::vector<ConstNodePtr> make_nodes(
+  const std::size_t num_nodes,
+  const std::size_t branching)
+{
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> noise(0.0, 100.0);
+  std::vector<ConstNodePtr> nodes;
+  nodes.reserve(num_nodes);
+  for (std::size_t i = 0; i < num_nodes; ++i)
+  {
+    auto node = std::make_shared<Node>();
+    node->cost_estimate =
+      25.0 * static_cast<double>(i / branching) + noise(rng);
+    node->heuristic_cost = 0.5 * node->cost_estimate;
+    node->accumulated_cost = 0.5 * node->cost_estimate;
+    nodes.push_back(std::move(node));
+  }
+
+  return nodes;
+}
+
+//==============================================================================
+// Expand one node for every branching nodes that are pushed, until every node
+// has been pushed and popped
+template<typename Push, typename Pop, typename Empty>
+void run(
+  const std::string& name,
+  const std::vector<ConstNodePtr>& nodes,
+  const std::size_t branching,
+  Push push,
+  Pop pop,
+  Empty empty)
+{
+  std::size_t next = 0;
+  std::size_t expanded = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  push(nodes[next++]);
+  while (!empty())
+  {
+    pop();
+    ++expanded;
+
+    for (std::size_t b = 0; b < branching && next < nodes.size(); ++b)
+      push(nodes[next++]);
+  }
+  const auto finish = std::chrono::steady_clock::now();
+
+  const double seconds = std::chrono::duration<double>(finish - start).count();
+  std::cout << name
+            << ": " << seconds * 1e3 << " ms, "
+            << static_cast<double>(expanded) / seconds << " nodes/s"
+            << std::endl;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t num_nodes = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  const std::size_t branching = argc > 2 ? std::stoul(argv[2]) : 4;
+  const double weight = argc > 3 ? std::stod(argv[3]) : 1.0;
+  if (num_nodes == 0 || branching == 0 || weight < 1.0)
+  {
+    std::cerr << "The nodes and branching must be positive and the weight "
+              << "must be at least 1.0" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << num_nodes << " nodes, branching " << branching
+            << ", heuristic weight " << weight << std::endl;
+
+  const auto nodes = make_nodes(num_nodes, branching);
+
+  LowestCostEstimate compare{weight};
+  std::vector<ConstNodePtr> heap;
+  run(
+    "Binary heap of nodes", nodes, branching,
+    [&](ConstNodePtr n)
+    {
+      heap.push_back(std::move(n));
+      std::push_heap(heap.begin(), heap.end(), compare);
+    },
+    [&]()
+    {
+      std::pop_heap(heap.begin(), heap.end(), compare);
+      heap.pop_back();
+    },
+    [&]() { return heap.empty(); });
+
+  for (const auto tie_break :
+    {OpenList::TieBreak::None, OpenList::TieBreak::Cost})
+  {
+    OpenList open_list(weight, tie_break);
+    run(
+      tie_break == OpenList::TieBreak::None ?
+      "OpenList" : "OpenList with cost tie breaking",
+      nodes, branching,
+      [&](ConstNodePtr n) { open_list.push(std::move(n)); },
+      [&]() { open_list.pop(); },
+      [&]() { return open_list.empty(); });
+  }
+
+  return EXIT_SUCCESS;
+}
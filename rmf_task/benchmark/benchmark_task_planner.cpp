@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Benchmarks TaskPlanner::plan() on generated navigation graphs and fleets.
+//
+// Each benchmark is parametrized by:
+//   0: the layout of the graph (0 = open grid, 1 = warehouse aisles)
+//   1: the number of agents
+//   2: the number of requests, a mix of Delivery, Loop and Clean
+//   3: whether battery drain is enabled
+//   4: whether the greedy planner is used
+//   5: whether the Loop requests are patrols scheduled five minutes apart
+//
+// The optimal planner is given a time budget per plan so that the larger
+// configurations still finish. Besides time, each benchmark reports the
+// number of nodes that were expanded and generated, the number of heap
+// allocations per plan, and the peak resident set size of the process.
+//
+// The TaskPlanner/parallel benchmarks run the portfolio search with parallel
+// expansion, initialization and refinement, once with
+// Options::deterministic() and once without. The difference in their times
+// is the price of reproducible assignments: the greedy bound only reaches
+// the optimal search once both are over, and the refinement threads wait
+// for each other at the end of every round. They also report the cost of
+// the plans, since the deterministic refinement makes fewer attempts within
+// the same refinement time.
+
+#include "Workload.hpp"
+
+#include <rmf_task/TaskPlanner.hpp>
+#include <rmf_task/requests/Loop.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+using rmf_task::TaskPlanner;
+
+namespace {
+
+//==============================================================================
+// Every heap allocation of the process, counted by the replacements of the
+// global operator new below
+std::atomic_size_t allocations = 0;
+
+} // anonymous namespace
+
+//==============================================================================
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+
+  throw std::bad_alloc();
+}
+
+//==============================================================================
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+//==============================================================================
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+//==============================================================================
+using rmf_task::workload::Layout;
+using rmf_task::workload::Grid;
+using rmf_task::workload::Warehouse;
+
+//==============================================================================
+struct Problem
+{
+  rmf_task::workload::Fleet fleet;
+  std::vector<rmf_task::ConstRequestPtr> requests;
+  rmf_traffic::Time now;
+};
+
+//==============================================================================
+Problem make_problem(
+  const Layout layout,
+  const std::size_t num_agents,
+  const std::size_t num_requests,
+  const bool drain_battery,
+  const bool scheduled_patrols = false)
+{
+  Problem problem;
+  problem.now = std::chrono::steady_clock::now();
+
+  std::mt19937 rng(42);
+  problem.fleet = rmf_task::workload::make_fleet(
+    rmf_task::workload::make_graph(layout, 10),
+    num_agents, drain_battery, problem.now, rng);
+
+  const auto& graph = problem.fleet.graph;
+  std::uniform_int_distribution<std::size_t> waypoint(
+    0, graph.num_waypoints() - 1);
+
+  if (scheduled_patrols)
+  {
+    // Patrols that are scheduled a few minutes apart, so most of the cost of
+    // each one is the wait for its start time
+    for (std::size_t r = 0; r < num_requests; ++r)
+    {
+      const auto start_time = problem.now
+        + rmf_traffic::time::from_seconds(300.0 * r);
+      const std::size_t from = waypoint(rng);
+      const std::size_t to = waypoint(rng);
+      problem.requests.push_back(
+        rmf_task::requests::Loop::make(
+          from, to, 1, std::to_string(r), start_time));
+    }
+
+    return problem;
+  }
+
+  // Requests arrive in waves so that the planner splits them into segments
+  const std::size_t wave_size = 10;
+  for (std::size_t r = 0; r < num_requests; ++r)
+  {
+    const auto start_time = problem.now
+      + rmf_traffic::time::from_seconds(3600.0 * (r / wave_size));
+    const std::size_t from = waypoint(rng);
+    const std::size_t to = waypoint(rng);
+    problem.requests.push_back(
+      rmf_task::workload::make_request(
+        static_cast<rmf_task::workload::RequestType>(r % 3),
+        graph, from, to, std::to_string(r), start_time));
+  }
+
+  return problem;
+}
+
+//==============================================================================
+long peak_rss_kb()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+//==============================================================================
+void BM_Plan(benchmark::State& state)
+{
+  const auto layout = static_cast<Layout>(state.range(0));
+  const auto num_agents = static_cast<std::size_t>(state.range(1));
+  const auto num_requests = static_cast<std::size_t>(state.range(2));
+  const bool drain_battery = state.range(3) != 0;
+  const bool greedy = state.range(4) != 0;
+  const bool scheduled_patrols = state.range(5) != 0;
+
+  const auto problem = make_problem(
+    layout, num_agents, num_requests, drain_battery, scheduled_patrols);
+
+  // Give the optimal search a budget so that large problems still finish
+  std::chrono::steady_clock::time_point deadline;
+  const auto interrupter = [&deadline]()
+    {
+      return std::chrono::steady_clock::now() > deadline;
+    };
+
+  TaskPlanner::Options options{greedy, interrupter, nullptr};
+  TaskPlanner planner(*problem.fleet.config, options);
+
+  std::size_t nodes_expanded = 0;
+  std::size_t nodes_generated = 0;
+  std::size_t failures = 0;
+  std::size_t plan_allocations = 0;
+  for (auto _ : state)
+  {
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    const std::size_t initial_allocations = allocations;
+    const auto result = planner.plan(
+      problem.now, problem.fleet.agents, problem.requests);
+    plan_allocations += allocations - initial_allocations;
+    const auto* assignments =
+      std::get_if<TaskPlanner::Assignments>(&result);
+    if (!assignments || assignments->empty())
+      ++failures;
+
+    benchmark::DoNotOptimize(result);
+
+    const auto& statistics = planner.last_statistics();
+    nodes_expanded += statistics.nodes_expanded;
+    nodes_generated += statistics.nodes_generated;
+  }
+
+  state.counters["nodes_expanded"] = benchmark::Counter(
+    static_cast<double>(nodes_expanded), benchmark::Counter::kAvgIterations);
+  state.counters["nodes_generated"] = benchmark::Counter(
+    static_cast<double>(nodes_generated), benchmark::Counter::kAvgIterations);
+  state.counters["allocations"] = benchmark::Counter(
+    static_cast<double>(plan_allocations), benchmark::Counter::kAvgIterations);
+  state.counters["failures"] = static_cast<double>(failures);
+  state.counters["peak_rss_kb"] = static_cast<double>(peak_rss_kb());
+}
+
+//==============================================================================
+void BM_PlanParallel(benchmark::State& state)
+{
+  const auto num_agents = static_cast<std::size_t>(state.range(0));
+  const auto num_requests = static_cast<std::size_t>(state.range(1));
+  const bool deterministic = state.range(2) != 0;
+
+  const auto problem = make_problem(Grid, num_agents, num_requests, false);
+
+  TaskPlanner::Options options{false, nullptr, nullptr};
+  options.portfolio(true);
+  options.expansion_threads(4);
+  options.initialization_threads(4);
+  options.refinement_time(std::chrono::milliseconds(100));
+  options.refinement_threads(4);
+  options.time_budget(std::chrono::seconds(10));
+  options.deterministic(deterministic);
+  TaskPlanner planner(*problem.fleet.config, options);
+
+  double total_cost = 0.0;
+  std::size_t failures = 0;
+  for (auto _ : state)
+  {
+    const auto result = planner.plan(
+      problem.now, problem.fleet.agents, problem.requests);
+    const auto* assignments =
+      std::get_if<TaskPlanner::Assignments>(&result);
+    if (!assignments || assignments->empty())
+      ++failures;
+    else
+      total_cost += planner.compute_cost(*assignments);
+
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.counters["cost"] = benchmark::Counter(
+    total_cost, benchmark::Counter::kAvgIterations);
+  state.counters["failures"] = static_cast<double>(failures);
+}
+
+//==============================================================================
+void greedy_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int layout : {Grid, Warehouse})
+  {
+    for (const int agents : {5, 20, 100})
+    {
+      for (const int requests : {10, 100, 500})
+      {
+        for (const int battery : {0, 1})
+          b->Args({layout, agents, requests, battery, 1, 0});
+      }
+    }
+  }
+}
+
+//==============================================================================
+void optimal_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int layout : {Grid, Warehouse})
+  {
+    for (const int agents : {5, 10})
+    {
+      for (const int requests : {10, 50})
+      {
+        for (const int battery : {0, 1})
+          b->Args({layout, agents, requests, battery, 0, 0});
+      }
+    }
+  }
+}
+
+//==============================================================================
+void patrol_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int layout : {Grid, Warehouse})
+  {
+    for (const int agents : {3, 5})
+    {
+      for (const int requests : {8, 12})
+        b->Args({layout, agents, requests, 0, 0, 1});
+    }
+  }
+}
+
+//==============================================================================
+void parallel_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int agents : {5, 10})
+  {
+    for (const int requests : {20, 50})
+    {
+      for (const int deterministic : {0, 1})
+        b->Args({agents, requests, deterministic});
+    }
+  }
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_Plan)
+->Name("TaskPlanner/greedy")
+->ArgNames({"layout", "agents", "requests", "battery", "greedy", "patrols"})
+->Apply(greedy_arguments)
+->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_Plan)
+->Name("TaskPlanner/optimal")
+->ArgNames({"layout", "agents", "requests", "battery", "greedy", "patrols"})
+->Apply(optimal_arguments)
+->Unit(benchmark::kMillisecond)
+->Iterations(1);
+
+// The optimal search over patrols that are scheduled apart, which is where
+// the time window bound of the heuristic prunes the most nodes
+BENCHMARK(BM_Plan)
+->Name("TaskPlanner/scheduled_patrols")
+->ArgNames({"layout", "agents", "requests", "battery", "greedy", "patrols"})
+->Apply(patrol_arguments)
+->Unit(benchmark::kMillisecond)
+->Iterations(1);
+
+BENCHMARK(BM_PlanParallel)
+->Name("TaskPlanner/parallel")
+->ArgNames({"agents", "requests", "deterministic"})
+->Apply(parallel_arguments)
+->Unit(benchmark::kMillisecond)
+->Iterations(3);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Builds a table of the travel estimates between every pair of waypoints for
+// the parameters that are stored in a plan capture (see
+// TaskPlanner::Options::capture_path()). The table can then be loaded with
+// the TravelEstimator constructor that takes a table path.
+//
+// Usage: build_travel_table <capture> <table> [threads]
+
+#include "PlanCapture.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace rmf_task;
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <capture> <table> [threads]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::size_t threads = argc > 3 ? std::stoul(argv[3]) : 0;
+
+  std::ifstream file(argv[1]);
+  if (!file)
+  {
+    std::cerr << "Unable to open [" << argv[1] << "]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    const auto capture = read_plan_capture(file);
+    for (const auto& warning : capture.warnings)
+      std::cerr << "Warning: " << warning << std::endl;
+
+    const auto& parameters = capture.configuration->parameters();
+    const auto num_waypoints =
+      parameters.planner()->get_configuration().graph().num_waypoints();
+
+    const auto start = std::chrono::steady_clock::now();
+    TravelEstimator::build_table(parameters, argv[2], threads);
+    const auto finish = std::chrono::steady_clock::now();
+
+    std::cout << "Wrote " << num_waypoints * num_waypoints
+              << " estimates to [" << argv[2] << "] in "
+              << std::chrono::duration<double>(finish - start).count()
+              << " s" << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+// Drives the task planner through simulated time with a stream of requests
+// whose arrivals follow a Poisson process, the way a fleet manager replans
+// its queue. At every planning period the requests that have arrived but not
+// started yet are planned together. The assignments that would begin before
+// the next planning period are dispatched, and the agents move on to the
+// finish states of those assignments. Everything else stays in the queue for
+// the next plan.
+//
+// At the end the harness reports the throughput of the planner, percentiles
+// of the wall time of each plan, and the quality of the plans as seen by the
+// requests: how long they waited to start and how long they took to finish
+// after they arrived.
+//
+// Usage:
+//   load_test_task_planner [agents] [requests_per_hour] [hours] [greedy]
+//     [layout] [high_priority_fraction] [period_seconds]
+
+#include "Workload.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace rmf_task;
+
+namespace {
+
+//==============================================================================
+double percentile(std::vector<double> values, const double p)
+{
+  if (values.empty())
+    return 0.0;
+
+  std::sort(values.begin(), values.end());
+  const auto index = static_cast<std::size_t>(
+    p * static_cast<double>(values.size() - 1) + 0.5);
+  return values[index];
+}
+
+//==============================================================================
+double mean(const std::vector<double>& values)
+{
+  if (values.empty())
+    return 0.0;
+
+  double sum = 0.0;
+  for (const double v : values)
+    sum += v;
+
+  return sum / static_cast<double>(values.size());
+}
+
+//==============================================================================
+void report(const std::string& name, const std::vector<double>& values)
+{
+  std::cout << name << ": mean " << mean(values)
+            << ", p50 " << percentile(values, 0.5)
+            << ", p90 " << percentile(values, 0.9)
+            << ", p99 " << percentile(values, 0.99)
+            << ", max " << percentile(values, 1.0) << std::endl;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const std::size_t num_agents = argc > 1 ? std::stoul(argv[1]) : 10;
+  const double requests_per_hour = argc > 2 ? std::stod(argv[2]) : 60.0;
+  const double hours = argc > 3 ? std::stod(argv[3]) : 8.0;
+  const bool greedy = argc > 4 ? std::stoi(argv[4]) != 0 : true;
+  const auto layout = argc > 5 ?
+    static_cast<workload::Layout>(std::stoi(argv[5])) : workload::Grid;
+  const double high_priority_fraction = argc > 6 ? std::stod(argv[6]) : 0.1;
+  const double period_seconds = argc > 7 ? std::stod(argv[7]) : 60.0;
+  if (num_agents == 0 || requests_per_hour <= 0.0 || hours <= 0.0
+    || period_seconds <= 0.0)
+  {
+    std::cerr << "The agents, request rate, hours and planning period must "
+              << "all be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << num_agents << " agents, " << requests_per_hour
+            << " requests per hour for " << hours << " hours, "
+            << (greedy ? "greedy" : "optimal") << " planner" << std::endl;
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto end = start + rmf_traffic::time::from_seconds(hours * 3600.0);
+  const auto period = rmf_traffic::time::from_seconds(period_seconds);
+
+  std::mt19937 rng(42);
+  auto fleet = workload::make_fleet(
+    workload::make_graph(layout, 10), num_agents, true, start, rng);
+  workload::RequestStream stream(
+    fleet.graph, requests_per_hour, workload::RequestStream::Mix(),
+    high_priority_fraction, start);
+
+  // Give the optimal search a budget so that every plan finishes within the
+  // planning period
+  TaskPlanner::Options options{greedy, nullptr, nullptr};
+  if (!greedy)
+    options.time_budget(std::chrono::seconds(1));
+
+  TaskPlanner planner(*fleet.config, options);
+
+  std::vector<ConstRequestPtr> queue;
+  std::vector<double> plan_ms;
+  std::vector<double> wait_s;
+  std::vector<double> completion_s;
+  std::size_t failures = 0;
+  std::size_t charges = 0;
+  double planning_seconds = 0.0;
+
+  for (auto now = start; now < end; now += period)
+  {
+    while (stream.next_arrival() <= now)
+      queue.push_back(stream.next());
+
+    if (queue.empty())
+      continue;
+
+    // Agents that finished their work are idle until now
+    for (auto& agent : fleet.agents)
+    {
+      if (agent.time().value() < now)
+        agent.time(now);
+    }
+
+    const auto plan_start = std::chrono::steady_clock::now();
+    const auto result = planner.plan(now, fleet.agents, queue);
+    const auto plan_finish = std::chrono::steady_clock::now();
+    const double seconds =
+      std::chrono::duration<double>(plan_finish - plan_start).count();
+    plan_ms.push_back(seconds * 1e3);
+    planning_seconds += seconds;
+
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    if (!assignments)
+    {
+      ++failures;
+      continue;
+    }
+
+    std::unordered_set<std::string> dispatched;
+    for (std::size_t a = 0; a < assignments->size(); ++a)
+    {
+      for (const auto& assignment : (*assignments)[a])
+      {
+        if (assignment.deployment_time() >= now + period)
+          break;
+
+        fleet.agents[a] = assignment.finish_state();
+        const auto& booking = *assignment.request()->booking();
+        const auto queued = std::find_if(
+          queue.begin(), queue.end(), [&](const ConstRequestPtr& r)
+          {
+            return r->booking()->id() == booking.id();
+          });
+
+        if (queued == queue.end())
+        {
+          // The planner added this, e.g. to charge the battery
+          ++charges;
+          continue;
+        }
+
+        dispatched.insert(booking.id());
+        const auto arrival = booking.earliest_start_time();
+        wait_s.push_back(
+          rmf_traffic::time::to_seconds(
+            assignment.deployment_time() - arrival));
+        completion_s.push_back(
+          rmf_traffic::time::to_seconds(
+            assignment.finish_state().time().value() - arrival));
+      }
+    }
+
+    queue.erase(
+      std::remove_if(
+        queue.begin(), queue.end(), [&](const ConstRequestPtr& r)
+        {
+          return dispatched.count(r->booking()->id()) > 0;
+        }),
+      queue.end());
+  }
+
+  std::cout << stream.count() << " requests arrived, " << completion_s.size()
+            << " dispatched, " << queue.size() << " still queued, "
+            << charges << " charging assignments, " << failures
+            << " failed plans" << std::endl;
+  std::cout << plan_ms.size() << " plans in " << planning_seconds
+            << " s of planning, "
+            << (planning_seconds > 0.0 ?
+    static_cast<double>(completion_s.size()) / planning_seconds : 0.0)
+            << " dispatched requests per second of planning" << std::endl;
+  report("Plan time (ms)", plan_ms);
+  report("Wait until start (s)", wait_s);
+  report("Arrival to finish (s)", completion_s);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Runs the task planner on the inputs that were written by a plan() call with
+// TaskPlanner::Options::capture_path() set. The assignments are printed so
+// that the output of two replays can be compared, and the planner can be run
+// several times to collect a profile, e.g.
+//
+//   perf record replay_task_planner capture.txt 20
+//
+// Usage: replay_task_planner <capture> [iterations]
+
+#include "PlanCapture.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace rmf_task;
+
+namespace {
+
+//==============================================================================
+void print_result(const TaskPlanner::Result& result)
+{
+  if (const auto* error = std::get_if<TaskPlanner::TaskPlannerError>(&result))
+  {
+    std::cout << "Planning failed with error "
+              << static_cast<int>(*error) << std::endl;
+    return;
+  }
+
+  const auto& assignments = std::get<TaskPlanner::Assignments>(result);
+  for (std::size_t a = 0; a < assignments.size(); ++a)
+  {
+    std::cout << "Agent " << a << ":";
+    for (const auto& assignment : assignments[a])
+    {
+      const auto finish = assignment.finish_state().time();
+      std::cout << " " << assignment.request()->booking()->id() << " ("
+                << (finish ? finish->time_since_epoch().count() : -1) << ")";
+    }
+    std::cout << std::endl;
+  }
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <capture> [iterations]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::size_t iterations = argc > 2 ? std::stoul(argv[2]) : 1;
+
+  std::ifstream file(argv[1]);
+  if (!file)
+  {
+    std::cerr << "Unable to open [" << argv[1] << "]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::optional<PlanCapture> capture;
+  try
+  {
+    capture = read_plan_capture(file);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (const auto& warning : capture->warnings)
+    std::cerr << "Warning: " << warning << std::endl;
+
+  std::cout << capture->initial_states.size() << " agents, "
+            << capture->requests.size() << " requests" << std::endl;
+
+  TaskPlanner planner(*capture->configuration, capture->options);
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = planner.plan(
+      capture->time_now, capture->initial_states, capture->requests);
+    const auto finish = std::chrono::steady_clock::now();
+
+    const auto& statistics = planner.last_statistics();
+    std::cout << "Iteration " << i << ": "
+              << std::chrono::duration<double>(finish - start).count() * 1e3
+              << " ms, " << statistics.nodes_expanded << " nodes expanded, "
+              << statistics.nodes_generated << " nodes generated" << std::endl;
+
+    if (i + 1 == iterations)
+      print_result(result);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -18,8 +18,11 @@
 #ifndef RMF_TASK__ACTIVATOR_HPP
 #define RMF_TASK__ACTIVATOR_HPP
 
+#include <rmf_task/Executor.hpp>
 #include <rmf_task/Request.hpp>
 
+#include <typeinfo>
+
 namespace rmf_task {
 
 //==============================================================================
@@ -87,9 +90,23 @@ public:
   ///
   /// \param[in] activator
   ///   A callback that activates a Task matching the Description
+  ///
+  /// \throws std::runtime_error if the Activator is frozen and it does not
+  /// have an activator for this Description yet.
   template<typename Description>
   void add_activator(Activate<Description> activator);
 
+  /// Freeze the set of Description types that this Activator supports. After
+  /// this, finding the activator of a request compares the address of the
+  /// type of its description against a sorted array instead of hashing it,
+  /// which is cheaper when a large number of tasks are activated or restored
+  /// at once. The activators of types that were already added can still be
+  /// replaced, but no new types can be added.
+  void freeze();
+
+  /// True if freeze() has been called on this Activator
+  bool frozen() const;
+
   /// Activate a Task object based on a Request.
   ///
   /// \param[in] get_state
@@ -114,6 +131,13 @@ public:
   /// \param[in] task_finished
   ///   A callback that will be triggered when the task has finished
   ///
+  /// \param[in] executor
+  ///   If this is not null, the callbacks are posted to a Strand of this
+  ///   executor instead of being called by the thread that triggers them.
+  ///   They are still called one at a time in the order that they were
+  ///   triggered. A task whose callbacks are posted may have moved on by the
+  ///   time that a callback runs.
+  ///
   /// \return an active, running instance of the requested task.
   Task::ActivePtr activate(
     const std::function<State()>& get_state,
@@ -122,7 +146,8 @@ public:
     std::function<void(Phase::ConstSnapshotPtr)> update,
     std::function<void(Task::Active::Backup)> checkpoint,
     std::function<void(Phase::ConstCompletedPtr)> phase_finished,
-    std::function<void()> task_finished) const;
+    std::function<void()> task_finished,
+    const ExecutorPtr& executor = nullptr) const;
 
   /// Restore a Task that crashed or disconnected.
   ///
@@ -151,6 +176,13 @@ public:
   /// \param[in] task_finished
   ///   A callback that will be triggered when the task has finished
   ///
+  /// \param[in] executor
+  ///   If this is not null, the callbacks are posted to a Strand of this
+  ///   executor instead of being called by the thread that triggers them.
+  ///   They are still called one at a time in the order that they were
+  ///   triggered. A task whose callbacks are posted may have moved on by the
+  ///   time that a callback runs.
+  ///
   /// \return an active, running instance of the requested task.
   Task::ActivePtr restore(
     const std::function<State()>& get_state,
@@ -160,14 +192,15 @@ public:
     std::function<void(Phase::ConstSnapshotPtr)> update,
     std::function<void(Task::Active::Backup)> checkpoint,
     std::function<void(Phase::ConstCompletedPtr)> phase_finished,
-    std::function<void()> task_finished) const;
+    std::function<void()> task_finished,
+    const ExecutorPtr& executor = nullptr) const;
 
   class Implementation;
 private:
 
   /// \private
   void _add_activator(
-    std::type_index type,
+    const std::type_info& type,
     Activate<Task::Description> activator);
 
   rmf_utils::impl_ptr<Implementation> _pimpl;
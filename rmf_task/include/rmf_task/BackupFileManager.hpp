@@ -31,6 +31,24 @@ public:
 
   class Group;
   class Robot;
+  class ReplicationSink;
+
+  /// How much care is taken to make sure that backups survive a crash or a
+  /// loss of power
+  enum class Durability : uint8_t
+  {
+    /// Leave it to the operating system to decide when the backups reach the
+    /// storage device. This is the fastest option.
+    None,
+
+    /// Flush each backup to the storage device before the write is finished
+    EveryWrite,
+
+    /// Flush all the backups that were written by this manager together once
+    /// every period, so that a crash loses at most one period of backups
+    /// without needing a flush for every write.
+    GroupCommit
+  };
 
   /// Construct a BackupFileManager
   ///
@@ -56,6 +74,99 @@ public:
   ///   off.
   BackupFileManager& clear_on_shutdown(bool value = true);
 
+  /// Set whether backups should be written by a background thread instead of
+  /// the thread that calls Robot::write(). A backup that is still waiting to
+  /// be written when a newer one arrives for the same robot is replaced by
+  /// the newer one, so the background thread is never more than one backup
+  /// behind for each robot. Failures to write are reported to the info
+  /// logger. By default this behavior is turned OFF. This should be set
+  /// before any robots begin writing.
+  ///
+  /// \param[in] value
+  ///   True if the behavior should be turned on; false if it should be turned
+  ///   off.
+  BackupFileManager& asynchronous_write(bool value = true);
+
+  /// Set how much care is taken to make sure that backups survive a crash or
+  /// a loss of power. By default this is Durability::None. This should be set
+  /// before any robots begin writing.
+  ///
+  /// \param[in] value
+  ///   The durability of the backups
+  ///
+  /// \param[in] group_commit_period
+  ///   How often the backups are flushed when the durability is
+  ///   Durability::GroupCommit. This is ignored for other values.
+  BackupFileManager& durability(
+    Durability value,
+    rmf_traffic::Duration group_commit_period = std::chrono::milliseconds(100));
+
+  /// Set whether backups should be journaled. Instead of rewriting the whole
+  /// backup file for every backup, each backup only appends to a journal the
+  /// bytes that changed since the previous backup, and read() replays the
+  /// journal on top of the last full backup. Once the journal holds enough
+  /// records or bytes, it is compacted into a new full backup. If
+  /// asynchronous writing is turned on, compaction happens on the background
+  /// thread along with the rest of the writes. By default this behavior is
+  /// turned OFF. This should be set before any robots begin writing.
+  ///
+  /// \param[in] value
+  ///   True if the behavior should be turned on; false if it should be turned
+  ///   off.
+  ///
+  /// \param[in] compaction_records
+  ///   The number of records that the journal can hold before it is compacted
+  ///
+  /// \param[in] compaction_bytes
+  ///   The number of bytes that the journal can hold before it is compacted
+  BackupFileManager& journal(
+    bool value = true,
+    std::size_t compaction_records = 64,
+    std::size_t compaction_bytes = 1 << 20);
+
+  /// Set whether the backups of all the robots of a group should be kept
+  /// together in one memory-mapped file inside the directory of the group,
+  /// instead of in a directory for each robot. This saves a large fleet from
+  /// creating, clearing and reading thousands of files. Each robot gets a
+  /// record with two slots in the file, and each backup is written into the
+  /// slot that is not in use before the record is switched over to it, so a
+  /// crash never leaves a robot with a partial backup. A robot whose backup
+  /// outgrows its slots is moved to a record with larger slots. Journaling is
+  /// not used for robots in a consolidated store. By default this behavior is
+  /// turned OFF. This should be set before any groups are made, and it is not
+  /// supported on Windows.
+  ///
+  /// \param[in] value
+  ///   True if the behavior should be turned on; false if it should be turned
+  ///   off.
+  ///
+  /// \param[in] slot_capacity
+  ///   The number of bytes that each slot of a new record can hold
+  BackupFileManager& consolidated_store(
+    bool value = true,
+    std::size_t slot_capacity = 1 << 14);
+
+  /// Set whether large backups should be compressed with zstd before they are
+  /// written. Backups that are smaller than the threshold are written as they
+  /// are. Compressed backups begin with a header that marks them, so backups
+  /// that were written without compression can always be read. Each group
+  /// can change its threshold with Group::compression_threshold(). By default
+  /// this behavior is turned OFF. This should be set before any groups are
+  /// made. If compression_available() is false, backups are never compressed.
+  ///
+  /// \param[in] value
+  ///   True if the behavior should be turned on; false if it should be turned
+  ///   off.
+  ///
+  /// \param[in] threshold
+  ///   The smallest backup, in bytes, that will be compressed
+  BackupFileManager& compression(
+    bool value = true,
+    std::size_t threshold = 1 << 14);
+
+  /// True if rmf_task was built with support for compressing backups
+  static bool compression_available();
+
   /// Make a group (a.k.a. fleet) to back up.
   std::shared_ptr<Group> make_group(std::string name);
 
@@ -64,6 +175,44 @@ private:
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
 };
 
+//==============================================================================
+/// A destination that the backups of a group get mirrored to, such as a
+/// hot-standby fleet adapter that should be ready to take over.
+class BackupFileManager::ReplicationSink
+{
+public:
+
+  /// The latest backup of one robot
+  struct Entry
+  {
+    /// The name of the robot
+    std::string robot;
+
+    /// The sequence number of the backup
+    uint64_t sequence = 0;
+
+    /// The serialized state of the backup. This is null if the backup of the
+    /// robot was cleared.
+    Task::Active::Backup::SharedState state;
+  };
+
+  /// Send a batch of the backups of a group that changed since the previous
+  /// batch. Batches are sent one at a time from a background thread of the
+  /// group. If this throws, the entries of the batch are sent again with the
+  /// next batch, unless newer backups of those robots have replaced them.
+  ///
+  /// \param[in] group
+  ///   The name of the group
+  ///
+  /// \param[in] entries
+  ///   The latest backup of each robot that changed, sorted by robot name
+  virtual void send(
+    const std::string& group,
+    const std::vector<Entry>& entries) = 0;
+
+  virtual ~ReplicationSink() = default;
+};
+
 //==============================================================================
 class BackupFileManager::Group
 {
@@ -75,6 +224,81 @@ public:
   ///   The unique name of the robot that's being backed up
   std::shared_ptr<Robot> make_robot(std::string name);
 
+  /// Compress the backups of the robots in this group that are at least as
+  /// large as the threshold, whether or not compression was turned on for the
+  /// BackupFileManager. This takes effect for backups that are written after
+  /// it is called.
+  ///
+  /// \param[in] threshold
+  ///   The smallest backup, in bytes, that will be compressed
+  Group& compression_threshold(std::size_t threshold);
+
+  /// Mirror the backups of the robots in this group to a replication sink.
+  /// Instead of sending every backup as it is written, the latest backup of
+  /// each robot that changed is collected and sent in one batch once every
+  /// period. Anything that has not been sent yet is sent when the group is
+  /// destroyed.
+  ///
+  /// \param[in] sink
+  ///   The sink to send the batches to. Pass nullptr to stop replicating.
+  ///
+  /// \param[in] period
+  ///   How often a batch of changed backups is sent
+  Group& replicate(
+    std::shared_ptr<ReplicationSink> sink,
+    rmf_traffic::Duration period = std::chrono::milliseconds(500));
+
+  /// Load a batch of replicated backups into this group, as a standby would
+  /// when it receives them. Each entry is written as the backup of its robot,
+  /// and an entry without a state clears the backup of its robot. The group
+  /// holds onto the handles of the robots that it loaded, so their backups
+  /// are kept until restore_all() hands the handles out.
+  ///
+  /// \param[in] entries
+  ///   The entries that were sent by the ReplicationSink of another group
+  void load(const std::vector<ReplicationSink::Entry>& entries);
+
+  /// Signature for restoring a robot from its backup
+  ///
+  /// \param[in] name
+  ///   The name of the robot
+  ///
+  /// \param[in] robot
+  ///   The handle for backing up the robot. Keep this to continue backing up
+  ///   the robot. If it is dropped, the backup is cleared as usual.
+  ///
+  /// \param[in] backup
+  ///   The backup state that was read for the robot. This would usually be
+  ///   passed along to Activator::restore().
+  using Restore = std::function<
+    void(
+      const std::string& name,
+      const std::shared_ptr<Robot>& robot,
+      std::string backup)
+  >;
+
+  /// Read the backups of every robot in this group that has one and pass each
+  /// of them to a restore callback, using a pool of threads. Each backup is
+  /// handed over as soon as it has been read, so the robots are read, parsed
+  /// and restored concurrently. The callback may be called from several
+  /// threads at once.
+  ///
+  /// \param[in] restore
+  ///   The callback that restores each robot
+  ///
+  /// \param[in] num_threads
+  ///   The greatest number of threads to use, including the calling thread.
+  ///   Zero means one thread per hardware thread.
+  ///
+  /// \throws the first exception that was thrown while reading or restoring a
+  /// backup, after every other robot has been restored.
+  ///
+  /// \return the names of the robots that were restored, in the order that
+  /// they finished.
+  std::vector<std::string> restore_all(
+    const Restore& restore,
+    std::size_t num_threads = 0);
+
   // TODO(MXG): Add an API for saving the task assignments of the Group. When
   // the Group is constructed/destructed, it should clear out those task
   // assignments, according to the RAII settings of its parent BackupFileManager
@@ -95,9 +319,18 @@ public:
   /// If a backup does not exist, return a nullopt.
   std::optional<std::string> read() const;
 
-  /// Write a backup to file
+  /// Write a backup to file. If asynchronous writing is turned on, this only
+  /// hands the backup over to the background thread.
+  ///
+  /// \throws std::runtime_error if the backup cannot be written and
+  /// asynchronous writing is turned off.
   void write(const Task::Active::Backup& backup);
 
+  /// Wait until any backup of this robot that is waiting to be written by the
+  /// background thread has been written. This returns right away if
+  /// asynchronous writing is turned off.
+  void flush();
+
   class Implementation;
 private:
   Robot();
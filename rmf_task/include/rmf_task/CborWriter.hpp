@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__CBORWRITER_HPP
+#define RMF_TASK__CBORWRITER_HPP
+
+#include <rmf_task/Event.hpp>
+#include <rmf_task/Log.hpp>
+#include <rmf_task/Phase.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Write task states in the CBOR binary format (RFC 8949) directly into a
+/// buffer, without building any intermediate documents. Every value is
+/// written as a definite-length item, so the output can be decoded by any
+/// CBOR library and converted into the equivalent JSON.
+///
+/// Log entries are written as maps with the keys "seq", "tier",
+/// "unix_millis_time" and "text". Events are written as maps with the keys
+/// "id", "status", "name", "detail", "log" and "deps", where "deps" holds the
+/// dependencies as nested events. Phases are written as maps with the keys
+/// "id", "category", "detail", "original_estimate_millis",
+/// "estimate_millis" and "final_event". Tiers and statuses are written as
+/// lowercase names, e.g. "warning" and "underway".
+class CborWriter
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] buffer
+  ///   Every item is appended to the end of this buffer. The buffer must
+  ///   outlive the writer.
+  CborWriter(std::vector<uint8_t>& buffer);
+
+  /// Write an unsigned integer
+  CborWriter& write_unsigned(uint64_t value);
+
+  /// Write a signed integer
+  CborWriter& write_signed(int64_t value);
+
+  /// Write a double precision floating point number
+  CborWriter& write_double(double value);
+
+  /// Write a boolean
+  CborWriter& write_bool(bool value);
+
+  /// Write a null
+  CborWriter& write_null();
+
+  /// Write a text string
+  CborWriter& write_text(const std::string& value);
+
+  /// Begin an array of the given number of items. That many items must be
+  /// written next.
+  CborWriter& begin_array(std::size_t size);
+
+  /// Begin a map of the given number of pairs. That many keys and values must
+  /// be written next, alternating between a key and its value.
+  CborWriter& begin_map(std::size_t size);
+
+  /// Write an entry of a log
+  CborWriter& write(const Log::Entry& entry);
+
+  /// Write every entry of a log view as an array
+  CborWriter& write(const Log::View& view);
+
+  /// Write the state of an event along with its log and its dependencies.
+  /// This works for any Event::State, including an Event::Snapshot.
+  CborWriter& write(const Event::State& state);
+
+  /// Write the state of a phase along with its final event. This works for
+  /// any Phase::Active, including a Phase::Snapshot.
+  CborWriter& write(const Phase::Active& phase);
+
+  /// Get the buffer that is being written to
+  const std::vector<uint8_t>& buffer() const;
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__CBORWRITER_HPP
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__COMPACTASSIGNMENTS_HPP
+#define RMF_TASK__COMPACTASSIGNMENTS_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// A compact view of the assignments of a plan, meant for sending large plans
+/// to a dispatcher. Each assignment is a row of six columns, and each column
+/// is a contiguous array:
+///   * the index of the agent
+///   * the index of the request
+///   * the deployment time
+///   * the finish time
+///   * the finish waypoint
+///   * the finish battery charge
+///
+/// The rows are sorted by agent, in the order of the assignments of each
+/// agent. All of the columns share one buffer, so the whole view can be sent
+/// with a single write of data() and read back with from_bytes() by a process
+/// on a host with the same byte order.
+///
+/// A State is only made for a finish state when finish_state() is called, and
+/// it only has the components that the columns keep.
+class CompactAssignments
+{
+public:
+
+  /// The finish waypoint of a finish state that has no waypoint
+  static constexpr uint64_t NoWaypoint = std::numeric_limits<uint64_t>::max();
+
+  /// Compact the assignments of a plan.
+  ///
+  /// \param[in] assignments
+  ///   The assignments that TaskPlanner::plan() returned
+  ///
+  /// \param[in] requests
+  ///   The requests that were given to TaskPlanner::plan(). An assignment of
+  ///   one of these gets the index of the request in this vector. The
+  ///   requests that the planner generated, such as charging, get the indices
+  ///   that follow, in the order that they appear, and are kept in
+  ///   generated_requests().
+  CompactAssignments(
+    const TaskPlanner::Assignments& assignments,
+    const std::vector<ConstRequestPtr>& requests);
+
+  /// Read a view from the bytes of data(). The generated requests are not
+  /// part of the bytes, so generated_requests() will be empty.
+  ///
+  /// \throws std::invalid_argument if the bytes do not hold a view
+  static CompactAssignments from_bytes(const void* data, std::size_t size);
+
+  /// Get the number of assignments
+  std::size_t size() const;
+
+  /// Get the number of agents
+  std::size_t num_agents() const;
+
+  /// Get the column of agent indices
+  const uint32_t* agents() const;
+
+  /// Get the column of request indices
+  const uint32_t* request_indices() const;
+
+  /// Get the column of deployment times, in nanoseconds since the epoch of
+  /// rmf_traffic::Time
+  const int64_t* deployment_times() const;
+
+  /// Get the column of finish times, in nanoseconds since the epoch of
+  /// rmf_traffic::Time
+  const int64_t* finish_times() const;
+
+  /// Get the column of finish waypoints. This is NoWaypoint for a finish
+  /// state that has no waypoint.
+  const uint64_t* finish_waypoints() const;
+
+  /// Get the column of finish battery charges. This is NaN for a finish state
+  /// that has no battery charge.
+  const double* finish_socs() const;
+
+  /// Get the deployment time of an assignment
+  rmf_traffic::Time deployment_time(std::size_t i) const;
+
+  /// Make the finish state of an assignment, with its waypoint, time and
+  /// battery charge
+  State finish_state(std::size_t i) const;
+
+  /// Get the requests that the planner generated. The request index of an
+  /// assignment of one of these is the size of the requests that were
+  /// planned plus its position in this vector.
+  const std::vector<ConstRequestPtr>& generated_requests() const;
+
+  /// Get the bytes of all the columns
+  const void* data() const;
+
+  /// Get the number of bytes of data()
+  std::size_t size_bytes() const;
+
+  class Implementation;
+private:
+  CompactAssignments();
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__COMPACTASSIGNMENTS_HPP
@@ -18,9 +18,9 @@
 #ifndef RMF_TASK__COMPOSITEDATA_HPP
 #define RMF_TASK__COMPOSITEDATA_HPP
 
-#include <rmf_utils/impl_ptr.hpp>
-
 #include <any>
+#include <cstddef>
+#include <memory>
 #include <typeindex>
 
 namespace rmf_task {
@@ -28,6 +28,23 @@ namespace rmf_task {
 //==============================================================================
 /// A class that can store and return arbitrary data structures, as long as they
 /// are copyable.
+///
+/// Each type of data structure is given a small index the first time it is
+/// used. The first few types are stored in slots that are looked up by index
+/// directly, and any others are kept in a flat array that is sorted by index.
+/// Small data structures, like the components that are made with
+/// RMF_TASK_DEFINE_COMPONENT, are stored without a heap allocation of their
+/// own.
+///
+/// Copies of a CompositeData share their data structures until one of them
+/// is modified, so copying one only increments a reference count. Anything
+/// that may modify a data structure, including the non-const get(), first
+/// gives this CompositeData its own copy of them if they are shared. A
+/// pointer that was obtained that way should not be used to modify the data
+/// structure after this CompositeData has been copied, because the copy would
+/// see the modification too. A const pointer stays valid until the data
+/// structure is erased or modified, or every CompositeData that shares it has
+/// been destroyed.
 //
 // TODO(MXG): Should this class move to rmf_utils? It is not very specific to
 // task planning or management.
@@ -96,11 +113,16 @@ public:
 
   class Implementation;
 private:
-  std::any* _get(std::type_index type);
-  const std::any* _get(std::type_index type) const;
-  InsertResult<std::any> _insert(std::any value, bool or_assign);
-  bool _erase(std::type_index type);
-  rmf_utils::impl_ptr<Implementation> _pimpl;
+  std::any* _get(std::size_t index);
+  const std::any* _get(std::size_t index) const;
+  InsertResult<std::any> _insert(
+    std::size_t index, std::any value, bool or_assign);
+  bool _erase(std::size_t index);
+
+  // Get the implementation for modification, copying it first if it is shared
+  Implementation& _mutable();
+
+  std::shared_ptr<Implementation> _pimpl;
 };
 
 } // namespace rmf_task
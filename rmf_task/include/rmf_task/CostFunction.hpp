@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__COSTFUNCTION_HPP
+#define RMF_TASK__COSTFUNCTION_HPP
+
+#include <rmf_task/CostCalculator.hpp>
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace rmf_task {
+
+//==============================================================================
+/// A custom objective for the TaskPlanner, such as energy use, makespan or
+/// penalties for late requests. Give the result of make_cost_calculator(~) to
+/// TaskPlanner::Configuration::cost_calculator(~) to plan with it.
+///
+/// The cost of a search node is the accumulated cost of its assignments plus
+/// a heuristic estimate of what its unassigned requests will add. The cost of
+/// each assignment is computed once, when it gets added to a node, and the
+/// planner keeps their sum. The planner generates all the children of a node
+/// before it passes them together to evaluate_batch(~), so one call can work
+/// through the flat arrays of many nodes.
+///
+/// The optimal search only returns optimal plans if the heuristic never
+/// exceeds what the unassigned requests will actually add, and if the cost of
+/// an assignment does not depend on the assignments that come after it.
+///
+/// Every function of a cost function may be called from several threads at
+/// once.
+class CostFunction
+{
+public:
+
+  using Assignment = TaskPlanner::Assignment;
+  using Assignments = TaskPlanner::Assignments;
+
+  /// A compact, read-only view of one search node. The pointers are only
+  /// valid during the call that the view is given to.
+  struct NodeView
+  {
+    /// The sum of assignment_cost(~) over the assignments of the node
+    double accumulated_cost = 0.0;
+
+    /// The number of agents
+    std::size_t num_agents = 0;
+
+    /// When each agent finishes its last assignment, or the time of the plan
+    /// for an agent without assignments
+    const rmf_traffic::Time* agent_finish_times = nullptr;
+
+    /// The number of assignments of each agent
+    const std::size_t* agent_num_assignments = nullptr;
+
+    /// The number of requests that are not assigned yet
+    std::size_t num_unassigned = 0;
+
+    /// The requests that are not assigned yet
+    const Request* const* unassigned_requests = nullptr;
+
+    /// The earliest time that any agent could finish each unassigned request
+    /// if it were given that request next. No agent can finish the request
+    /// before this.
+    const rmf_traffic::Time* unassigned_best_finish_times = nullptr;
+
+    /// False if some agent does a low priority request before a high priority
+    /// one. This is only checked when the planner is told to check priority,
+    /// otherwise it is always true.
+    bool valid_priority_order = true;
+  };
+
+  /// The cost of a node and the portion of it that is heuristic
+  struct Cost
+  {
+    double total = 0.0;
+    double heuristic = 0.0;
+  };
+
+  /// Compute the cost that one assignment adds to any node that it is part
+  /// of.
+  ///
+  /// \param[in] assignment
+  ///   The assignment
+  ///
+  /// \param[in] is_charging
+  ///   True if the planner added the assignment to charge the battery
+  virtual double assignment_cost(
+    const Assignment& assignment,
+    bool is_charging) const = 0;
+
+  /// Compute the cost of a node. By default this is the accumulated cost of
+  /// the node with no heuristic.
+  virtual Cost evaluate(
+    const NodeView& node,
+    rmf_traffic::Time time_now) const;
+
+  /// Compute the costs of many nodes at once, placing the cost of nodes[i] in
+  /// costs[i]. By default each node is passed to evaluate(~).
+  virtual void evaluate_batch(
+    const NodeView* nodes,
+    std::size_t count,
+    rmf_traffic::Time time_now,
+    Cost* costs) const;
+
+  /// Compute the cost of a complete set of assignments. By default this is
+  /// the sum of assignment_cost(~) over all of them, where the charging
+  /// assignments are the ones whose request is a ChargeBattery.
+  virtual double compute_cost(const Assignments& assignments) const;
+
+  /// Make a cost calculator that plans with a cost function
+  ///
+  /// \throws std::invalid_argument if the function is a nullptr.
+  static CostCalculatorPtr make_cost_calculator(
+    std::shared_ptr<const CostFunction> function);
+
+  virtual ~CostFunction() = default;
+};
+
+using CostFunctionPtr = std::shared_ptr<CostFunction>;
+using ConstCostFunctionPtr = std::shared_ptr<const CostFunction>;
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__COSTFUNCTION_HPP
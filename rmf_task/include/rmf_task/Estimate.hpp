@@ -18,11 +18,16 @@
 #ifndef RMF_TASK__ESTIMATE_HPP
 #define RMF_TASK__ESTIMATE_HPP
 
+#include <future>
+#include <memory>
 #include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <rmf_task/State.hpp>
 #include <rmf_task/Parameters.hpp>
+#include <rmf_task/TravelProfile.hpp>
 #include <rmf_traffic/Time.hpp>
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_utils/impl_ptr.hpp>
@@ -49,11 +54,16 @@ public:
   Estimate(State finish_state, rmf_traffic::Time wait_until);
 
   /// Finish state of the robot once it completes the request.
-  State finish_state() const;
+  const State& finish_state() const;
 
   /// Sets a new finish state for the robot.
   Estimate& finish_state(State new_finish_state);
 
+  /// Move the finish state out of this estimate. The state is only copied if
+  /// this estimate shares its implementation with a copy of it. Afterwards the
+  /// finish state of this estimate should not be used.
+  State release_finish_state();
+
   /// The ideal time the robot starts executing this request.
   rmf_traffic::Time wait_until() const;
 
@@ -62,7 +72,8 @@ public:
 
   class Implementation;
 private:
-  rmf_utils::impl_ptr<Implementation> _pimpl;
+  // Copies share one implementation until one of them is modified
+  std::shared_ptr<Implementation> _pimpl;
 };
 
 //==============================================================================
@@ -78,6 +89,105 @@ public:
   ///   The parameters for the robot
   TravelEstimator(const Parameters& parameters);
 
+  /// Constructor that loads a table of precomputed estimates which was made by
+  /// build_table(). The table is mapped into memory, so every estimate between
+  /// two waypoints of the graph is answered from it without planning.
+  ///
+  /// \param[in] parameters
+  ///   The parameters for the robot. These must match the parameters that the
+  ///   table was built for.
+  ///
+  /// \param[in] table_path
+  ///   The path of the table file
+  ///
+  /// \throws std::runtime_error if the file cannot be read, is not a valid
+  /// table, or was built for a different navigation graph, vehicle traits,
+  /// battery system or power sinks.
+  TravelEstimator(const Parameters& parameters, const std::string& table_path);
+
+  /// Get an estimator that is shared by everything in this process that plans
+  /// with equivalent parameters, so that each estimate is only calculated once
+  /// even when there are several planners or fleets on the same graph. The
+  /// parameters are matched by their navigation graph, vehicle traits, battery
+  /// system and power sinks. Power sinks other than the simple sinks of
+  /// rmf_battery are only matched if they are the same objects. The estimator
+  /// is kept for as long as anything holds on to it. Pass it to
+  /// TaskPlanner::Configuration::travel_estimator() to use it for planning.
+  ///
+  /// Note that the planner options of the parameters are not compared, so
+  /// parameters whose planners have different default options should not
+  /// share an estimator.
+  static std::shared_ptr<TravelEstimator> shared(const Parameters& parameters);
+
+  /// Get an estimator that never plans a path. Each of its estimates is the
+  /// straight line between the two waypoints at the nominal velocity of the
+  /// vehicle, which is the same as lower_bound(), and its battery drain is
+  /// the drain of that straight line. Pairs of waypoints on different maps
+  /// are planned as usual. These estimates are far cheaper than the usual
+  /// ones but they are optimistic, so they suit a first pass of a search whose
+  /// results get estimated again properly.
+  ///
+  /// \param[in] parameters
+  ///   The parameters for the robot
+  static std::shared_ptr<TravelEstimator> straight_line(
+    const Parameters& parameters);
+
+  /// Get an estimator for very large navigation graphs, where planning and
+  /// memoizing every pair of waypoints costs too much. The graph is split
+  /// into connected regions, and the fastest durations are precomputed within
+  /// each region and between the waypoints that connect the regions, so the
+  /// memory grows with the number of regions and connecting waypoints rather
+  /// than with the square of the number of waypoints. Those answers are not
+  /// memoized, so the cache only holds the trips that were planned.
+  ///
+  /// Each lane is travelled at the nominal velocity of the vehicle plus the
+  /// durations of its events, and the time to accelerate and stop once is
+  /// added to every trip. Turning in place is not counted. Trips that are so
+  /// short that this overhead would be more than the tolerance of their
+  /// duration are planned as usual. The battery drain is the drain of a
+  /// straight line as long as the route.
+  ///
+  /// The hierarchy is no longer used after update_planner(), since it was
+  /// built for the old lane closures.
+  ///
+  /// \param[in] parameters
+  ///   The parameters for the robot
+  ///
+  /// \param[in] region_size
+  ///   The greatest number of waypoints in each region
+  ///
+  /// \param[in] tolerance
+  ///   The fraction of the duration of a trip that the acceleration overhead
+  ///   may be before the trip is planned instead
+  ///
+  /// \throws std::invalid_argument if the region size is zero or the
+  /// tolerance is not positive.
+  static std::shared_ptr<TravelEstimator> hierarchical(
+    const Parameters& parameters,
+    std::size_t region_size = 64,
+    double tolerance = 0.1);
+
+  /// Compute the estimates between every pair of waypoints in the navigation
+  /// graph and write them to a table file that can be loaded by the
+  /// constructor above. The estimates are made for a robot that starts with an
+  /// orientation of zero. The file holds 24 bytes for every pair of waypoints.
+  ///
+  /// \param[in] parameters
+  ///   The parameters for the robot
+  ///
+  /// \param[in] table_path
+  ///   The path to write the table to
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads to compute the estimates with. A value of 0 uses
+  ///   the hardware concurrency.
+  ///
+  /// \throws std::runtime_error if the file cannot be written.
+  static void build_table(
+    const Parameters& parameters,
+    const std::string& table_path,
+    std::size_t num_threads = 0);
+
   /// The result of a travel estimation
   class Result
   {
@@ -100,6 +210,133 @@ public:
     const rmf_traffic::agv::Plan::Start& start,
     const rmf_traffic::agv::Plan::Goal& goal) const;
 
+  /// Estimate the cost of travelling from one start to each of several goals.
+  /// Every goal that is already memoized is answered first, and the rest are
+  /// planned concurrently by this thread and the threads of the prefetch pool.
+  ///
+  /// \return the estimate for each goal, in the same order as the goals
+  std::vector<std::optional<Result>> estimate(
+    const rmf_traffic::agv::Plan::Start& start,
+    const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const;
+
+  /// A lower bound on the time it takes to travel between two waypoints. This
+  /// is the straight-line distance between them divided by the nominal linear
+  /// velocity of the vehicle, so it never exceeds the duration given by
+  /// estimate() and it does not need any planning. It can be used to rule out
+  /// options before paying for an exact estimate. Waypoints on different maps
+  /// or outside of the graph have a lower bound of zero.
+  rmf_traffic::Duration lower_bound(
+    std::size_t start_waypoint,
+    std::size_t goal_waypoint) const;
+
+  /// Switch to a planner whose lane closures are different, e.g. because a
+  /// lane was blocked or cleared. Only the memoized estimates that the change
+  /// can affect are dropped: those whose route used a lane that is now closed,
+  /// and those that a newly opened lane might make faster or reachable. Any
+  /// estimate whose route is not known, such as one that was loaded from a
+  /// file, is dropped as well, and a precomputed table is no longer used.
+  ///
+  /// Estimates that are being calculated when this is called are finished
+  /// with the old planner and then dropped if they are affected. Task models
+  /// that were made with the old parameters keep using the old planner, so
+  /// the planner of their parameters should be updated as well.
+  ///
+  /// \param[in] planner
+  ///   The new planner. It must have the same navigation graph as the current
+  ///   one apart from its lane closures.
+  ///
+  /// \return the number of memoized estimates that were dropped
+  ///
+  /// \throws std::runtime_error if the navigation graph of the new planner has
+  /// a different number of waypoints or lanes.
+  std::size_t update_planner(
+    std::shared_ptr<const rmf_traffic::agv::Planner> planner);
+
+  /// Calculate the estimates from each of the starts to each of the goals on
+  /// background threads, so that later calls to estimate() for those pairs
+  /// are answered from the memoized results. Pairs that are already memoized
+  /// are skipped, and an estimate() of a pair that is still being prefetched
+  /// waits for it instead of planning it again. Prefetching is not counted in
+  /// cache_hits() or cache_misses().
+  ///
+  /// \return a future that becomes ready once every pair has been estimated.
+  /// If any of the estimates failed, the future holds the exception.
+  std::shared_future<void> prefetch(
+    const std::vector<rmf_traffic::agv::Plan::Start>& starts,
+    const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const;
+
+  /// The number of estimates that were answered from the memoized results
+  std::size_t cache_hits() const;
+
+  /// The number of estimates that needed a new travel plan to be computed
+  std::size_t cache_misses() const;
+
+  /// Limit the number of estimates that are memoized. Once the limit is
+  /// exceeded, the estimates that have not been used recently are evicted
+  /// until the cache is 10% below the limit. Pass std::nullopt to keep every
+  /// estimate, which is the default.
+  TravelEstimator& cache_capacity(std::optional<std::size_t> capacity);
+
+  /// Get the limit on the number of memoized estimates
+  std::optional<std::size_t> cache_capacity() const;
+
+  /// The number of estimates that are currently memoized
+  std::size_t cache_size() const;
+
+  /// The number of memoized estimates that have been evicted
+  std::size_t cache_evictions() const;
+
+  /// The approximate number of bytes that the memoized estimates use
+  std::size_t cache_memory() const;
+
+  /// Write the estimates that have been memoized so far to a file. The file is
+  /// tagged with a fingerprint of the parameters so that load_cache() can tell
+  /// whether it still applies.
+  ///
+  /// \return the number of estimates that were written
+  ///
+  /// \throws std::runtime_error if the file cannot be written.
+  std::size_t save_cache(const std::string& path) const;
+
+  /// Memoize the estimates in a file that was written by save_cache(). The
+  /// file is ignored if it does not exist or if it was written for a different
+  /// navigation graph, vehicle traits, battery system or power sinks.
+  ///
+  /// \return the number of estimates that were loaded
+  std::size_t load_cache(const std::string& path);
+
+  /// Answer the estimates that depart within a bucket of a time-of-day profile
+  /// from the values of that bucket. Estimates for buckets of the profile that
+  /// have no values are calculated and memoized as usual. The profile can keep
+  /// learning while it is in use. Answers from the profile are counted in
+  /// cache_hits(). Pass nullptr to stop using a profile.
+  ///
+  /// This should not be changed while estimates are being made on other
+  /// threads. Note that task models may calculate the travel within a task
+  /// only once for all start times, so the profile mostly affects travelling
+  /// to the start of each task and to the chargers.
+  TravelEstimator& profile(ConstTravelProfilePtr profile);
+
+  /// Get the time-of-day profile that this estimator uses, if any
+  const ConstTravelProfilePtr& profile() const;
+
+  /// The number of times that the travel times of this estimator were
+  /// changed by update_planner() or profile(). Results that were worked out
+  /// from its estimates are stale once this changes.
+  std::size_t generation() const;
+
+  /// The number of bytes used by the tables of a hierarchical() estimator,
+  /// or 0 for any other estimator
+  std::size_t hierarchy_memory() const;
+
+  /// Keep the memoized estimates in a file so that they survive restarts. The
+  /// file is loaded right away, and then saved every period on a background
+  /// thread and once more when this estimator is destroyed. Failures to save
+  /// are ignored and retried at the next period.
+  ///
+  /// \throws std::runtime_error if the cache is already being persisted.
+  void persist_cache(const std::string& path, rmf_traffic::Duration period);
+
   class Implementation;
 private:
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
@@ -25,6 +25,7 @@
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -127,6 +128,14 @@ public:
   /// Get more granular dependencies of this event, if any exist.
   virtual std::vector<ConstStatePtr> dependencies() const = 0;
 
+  /// A number that changes whenever the id, status, name, detail, log or list
+  /// of dependencies of this event changes. Changes inside of the
+  /// dependencies do not need to change it. Snapshot::make() uses this to
+  /// reuse the parts of a previous snapshot that have not changed. The
+  /// default implementation returns std::nullopt, which means that changes
+  /// are not tracked and this event will always be copied into snapshots.
+  virtual std::optional<uint64_t> version() const;
+
   // Virtual destructor
   virtual ~State() = default;
 };
@@ -141,7 +150,18 @@ class Event::Snapshot : public Event::State
 public:
 
   /// Make a snapshot of the current state of an Event
-  static ConstSnapshotPtr make(const State& other);
+  ///
+  /// \param[in] other
+  ///   The event to take a snapshot of
+  ///
+  /// \param[in] previous
+  ///   An earlier snapshot of the same event. Any part of the dependency tree
+  ///   whose version() has not changed since the previous snapshot will be
+  ///   shared with it instead of being copied again. If nothing has changed,
+  ///   the previous snapshot itself is returned.
+  static ConstSnapshotPtr make(
+    const State& other,
+    const ConstSnapshotPtr& previous = nullptr);
 
   // Documentation inherited
   uint64_t id() const final;
@@ -161,6 +181,9 @@ public:
   // Documentation inherited
   std::vector<ConstStatePtr> dependencies() const final;
 
+  /// The version of the event when this snapshot was made
+  std::optional<uint64_t> version() const final;
+
   class Implementation;
 private:
   Snapshot();
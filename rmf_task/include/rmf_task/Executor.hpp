@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__EXECUTOR_HPP
+#define RMF_TASK__EXECUTOR_HPP
+
+#include <rmf_traffic/Time.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace rmf_task {
+
+//==============================================================================
+/// An interface for running jobs somewhere other than on the thread that
+/// produced them. Activator::activate(~) and Activator::restore(~) can be
+/// given an executor so that the callbacks of a task are run by it instead of
+/// by whichever thread changed the state of the task.
+///
+/// Jobs may be run concurrently and in any order. Use a Strand to run a
+/// series of jobs in order. Jobs should not throw exceptions.
+class Executor
+{
+public:
+
+  using Job = std::function<void()>;
+
+  /// Run a job at some point in the future
+  virtual void post(Job job) = 0;
+
+  /// Make an executor that runs its jobs on a pool of threads. When the pool
+  /// is destroyed, any jobs that were already posted are finished first.
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads in the pool. Pass 0 to use one thread per
+  ///   hardware thread.
+  static std::shared_ptr<Executor> make_thread_pool(
+    std::size_t num_threads = 0);
+
+  /// Post a job to an executor once a delay has passed. The delays of every
+  /// executor are kept by TimerWheel::shared(), so a job that is waiting does
+  /// not hold on to a thread of its executor.
+  ///
+  /// \param[in] executor
+  ///   The executor to post the job to. If this is null, the job is run by the
+  ///   thread of the timer wheel itself, so it should return quickly.
+  ///
+  /// \param[in] delay
+  ///   How long to wait before the job is posted
+  ///
+  /// \param[in] job
+  ///   The job to post
+  static void post_after(
+    std::shared_ptr<Executor> executor,
+    rmf_traffic::Duration delay,
+    Job job);
+
+  // Virtual destructor
+  virtual ~Executor() = default;
+};
+
+using ExecutorPtr = std::shared_ptr<Executor>;
+
+//==============================================================================
+/// Runs jobs on an executor one at a time, in the order that they were
+/// posted. A job does not begin until the one before it has returned, even if
+/// the executor has many threads.
+class Strand : public Executor
+{
+public:
+
+  /// Make a strand that runs its jobs on an executor
+  static std::shared_ptr<Strand> make(ExecutorPtr executor);
+
+  // Documentation inherited
+  void post(Job job) final;
+
+  /// The executor that this strand runs its jobs on
+  const ExecutorPtr& executor() const;
+
+  class Implementation;
+private:
+  Strand();
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+using StrandPtr = std::shared_ptr<Strand>;
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__EXECUTOR_HPP
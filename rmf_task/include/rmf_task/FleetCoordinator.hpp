@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__FLEETCOORDINATOR_HPP
+#define RMF_TASK__FLEETCOORDINATOR_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Assigns a common pool of requests among several fleets, each of which is
+/// planned by its own TaskPlanner.
+///
+/// The requests are auctioned off one at a time in order of their earliest
+/// start time. Every fleet bids for each request with
+/// TaskPlanner::evaluate_insertion(~) on the assignments it has won so far,
+/// and the request goes to the fleet whose bid adds the least cost. Once the
+/// auction is over, each fleet plans the requests that it won from scratch,
+/// which also adds any charging tasks that it needs, and keeps whichever of
+/// that plan and its auction assignments is cheaper. The bids of the fleets
+/// and their final plans are run in parallel.
+///
+/// Fleets whose configurations do not provide a travel estimator are given
+/// TravelEstimator::shared(~), so fleets on the same navigation graph with
+/// the same vehicle traits and battery share their memoized estimates.
+class FleetCoordinator
+{
+public:
+
+  /// One fleet that takes part in the assignment
+  struct Fleet
+  {
+    /// The name of the fleet, which becomes the ID of its planner
+    std::string name;
+
+    /// The configuration of the planner of the fleet
+    TaskPlanner::Configuration configuration;
+
+    /// The current states of the agents of the fleet
+    std::vector<State> agents;
+  };
+
+  /// The assignment of every request among the fleets
+  struct Result
+  {
+    /// The assignments of each fleet, in the same order as the fleets
+    std::vector<TaskPlanner::Assignments> assignments;
+
+    /// The cost of the assignments of each fleet, as computed by its planner
+    std::vector<double> costs;
+
+    /// The IDs of the requests that none of the fleets could take
+    std::vector<std::string> unassigned;
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] fleets
+  ///   The fleets that the requests are assigned among
+  ///
+  /// \param[in] options
+  ///   The options that each fleet plans its requests with
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads that the fleets are evaluated with. A value of 0
+  ///   uses one thread per hardware thread.
+  FleetCoordinator(
+    std::vector<Fleet> fleets,
+    TaskPlanner::Options options,
+    std::size_t num_threads = 0);
+
+  /// Get the number of fleets
+  std::size_t num_fleets() const;
+
+  /// Get the planner of a fleet
+  ///
+  /// \throws std::out_of_range if there is no such fleet.
+  const TaskPlanner& planner(std::size_t fleet) const;
+
+  /// Get the current states of the agents of a fleet
+  ///
+  /// \throws std::out_of_range if there is no such fleet.
+  const std::vector<State>& agents(std::size_t fleet) const;
+
+  /// Update the states of the agents of a fleet
+  ///
+  /// \throws std::out_of_range if there is no such fleet.
+  FleetCoordinator& agents(std::size_t fleet, std::vector<State> agents);
+
+  /// Assign requests among the fleets
+  ///
+  /// \param[in] time_now
+  ///   The current time
+  ///
+  /// \param[in] requests
+  ///   The requests that need to be assigned
+  Result assign(
+    rmf_traffic::Time time_now,
+    const std::vector<ConstRequestPtr>& requests);
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__FLEETCOORDINATOR_HPP
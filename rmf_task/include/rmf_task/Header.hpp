@@ -23,6 +23,7 @@
 
 #include <rmf_utils/impl_ptr.hpp>
 
+#include <functional>
 #include <string>
 
 namespace rmf_task {
@@ -47,10 +48,29 @@ public:
     std::string detail_,
     rmf_traffic::Duration estimate_);
 
+  /// Constructor for a header whose details are only generated the first time
+  /// that they are asked for. Copies of the header share the generated
+  /// details, so they are generated at most once.
+  ///
+  /// \param[in] category_
+  ///   Category of the subject
+  ///
+  /// \param[in] make_detail_
+  ///   Generates the details about the subject. This may be called from any
+  ///   thread that asks for the details.
+  ///
+  /// \param[in] estimate_
+  ///   The original (ideal) estimate of how long the subject will last
+  Header(
+    std::string category_,
+    std::function<std::string()> make_detail_,
+    rmf_traffic::Duration estimate_);
+
   /// Category of the subject
   const std::string& category() const;
 
-  /// Details about the subject
+  /// Details about the subject. If they have not been generated yet, they are
+  /// generated now.
   const std::string& detail() const;
 
   /// The original (ideal) estimate of how long the subject will last
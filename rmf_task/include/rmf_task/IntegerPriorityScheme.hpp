@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__INTEGERPRIORITYSCHEME_HPP
+#define RMF_TASK__INTEGERPRIORITYSCHEME_HPP
+
+#include <rmf_task/Priority.hpp>
+#include <rmf_task/CostCalculator.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace rmf_task {
+
+//==============================================================================
+/// A prioritization scheme with any number of integer priority levels, where
+/// higher levels are more urgent. Level 0 is the same as having no priority,
+/// and level 1 is the same as the high priority of BinaryPriorityScheme, so
+/// the two schemes can be mixed.
+///
+/// The cost calculator penalizes plans where an agent does a task before a
+/// task of a higher level, and plans where an agent is left without any
+/// prioritized task while another agent has more than one. The planner reads
+/// the level of each request once per plan, so checking the order of the
+/// levels during the search only compares integers.
+class IntegerPriorityScheme
+{
+public:
+
+  /// Make a priority of the given level. Level 0 gives a nullptr, the same as
+  /// a low priority of BinaryPriorityScheme.
+  static std::shared_ptr<Priority> make_priority(std::size_t level);
+
+  /// Get the level of a priority. A nullptr is level 0 and a priority from a
+  /// different scheme is level 1.
+  static std::size_t level(const ConstPriorityPtr& priority);
+
+  /// Use this to give the appropriate cost calculator to the task planner
+  static std::shared_ptr<CostCalculator> make_cost_calculator();
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__INTEGERPRIORITYSCHEME_HPP
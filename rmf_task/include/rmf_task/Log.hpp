@@ -20,9 +20,14 @@
 
 #include <rmf_utils/impl_ptr.hpp>
 
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
 
 #include <rmf_traffic/Time.hpp>
 
@@ -39,6 +44,8 @@ public:
   class Entry;
   class View;
   class Reader;
+  class Format;
+  class Argument;
 
   /// A computer-friendly ranking of how serious the log entry is.
   enum class Tier : uint32_t
@@ -75,17 +82,77 @@ public:
   /// Add an error to the log.
   void error(std::string text);
 
+  /// Add an informational entry whose text is rendered from a format and its
+  /// arguments only when the text is first asked for. This avoids building
+  /// strings for entries that nobody reads.
+  void info(const Format& format, std::vector<Argument> arguments);
+
+  /// Add a warning whose text is rendered when it is first asked for.
+  void warn(const Format& format, std::vector<Argument> arguments);
+
+  /// Add an error whose text is rendered when it is first asked for.
+  void error(const Format& format, std::vector<Argument> arguments);
+
   /// Push an entry of the specified severity.
+  ///
+  /// Entries can be added from any number of threads at once without taking
+  /// a lock, so adding an entry never waits for a View to be made. An entry
+  /// becomes visible to new Views once every entry that was added before it
+  /// has finished being written.
   void push(Tier tier, std::string text);
 
-  /// Insert an arbitrary entry into the log.
+  /// Insert an arbitrary entry into the log. The entry keeps its own sequence
+  /// number. Like push(), this never takes a lock.
   void insert(Log::Entry entry);
 
+  /// Push an entry of the specified severity whose text is rendered from a
+  /// format and its arguments when it is first asked for. This has the same
+  /// thread-safety as the other push().
+  void push(Tier tier, const Format& format, std::vector<Argument> arguments);
+
   /// Get a View of the current state of this log. Any new entries that are
   /// added after calling this function will not be visible to the View that
   /// is returned.
   View view() const;
 
+  /// Entries are stored in chunks of this many entries. When a retention
+  /// limit is exceeded, the oldest chunks are evicted as a whole, but the
+  /// chunk that new entries are being added to is always kept.
+  static constexpr std::size_t ChunkSize = 64;
+
+  /// Limit the number of entries that the log keeps. Pass std::nullopt to
+  /// keep every entry, which is the default.
+  Log& max_entries(std::optional<std::size_t> value);
+
+  /// Get the limit on the number of entries that the log keeps.
+  std::optional<std::size_t> max_entries() const;
+
+  /// Limit the approximate number of bytes that the entries of the log use.
+  /// Pass std::nullopt to keep every entry, which is the default.
+  Log& max_bytes(std::optional<std::size_t> value);
+
+  /// Get the limit on the approximate number of bytes of the log.
+  std::optional<std::size_t> max_bytes() const;
+
+  /// Limit how long the log keeps its entries, as measured by its clock.
+  /// A chunk is evicted once its newest entry is older than this. Pass
+  /// std::nullopt to keep every entry, which is the default.
+  Log& max_age(std::optional<rmf_traffic::Duration> value);
+
+  /// Get the limit on the age of the entries of the log.
+  std::optional<rmf_traffic::Duration> max_age() const;
+
+  /// The number of entries that are currently kept by the log.
+  std::size_t size() const;
+
+  /// The number of entries that have been evicted from the log.
+  std::size_t evicted() const;
+
+  /// The number of entries that have been added to the log and can be seen
+  /// by new Views, including the ones that were evicted. This only grows, so
+  /// it can be used to tell whether a log has changed.
+  uint64_t version() const;
+
   class Implementation;
 private:
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
@@ -116,13 +183,108 @@ private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
 };
 
+//==============================================================================
+/// A message template for entries whose text is rendered when it is read.
+/// Each "{}" in the pattern is replaced by the next argument of the entry.
+/// Arguments beyond the placeholders are appended after a space.
+///
+/// Patterns are interned: every Format with the same pattern refers to one
+/// shared copy, which lives until the program exits. Formats are meant to be
+/// made once for each kind of message, e.g. as static variables, and not
+/// for text that changes.
+class Log::Format
+{
+public:
+
+  /// Get the format for a pattern.
+  explicit Format(const std::string& pattern);
+
+  /// The pattern of this format.
+  const std::string& pattern() const;
+
+  class Implementation;
+private:
+  const Implementation* _pimpl;
+};
+
+//==============================================================================
+/// A value that fills in a placeholder of a Format. Times are rendered as
+/// seconds since the epoch of their clock, and durations as seconds followed
+/// by "s".
+class Log::Argument
+{
+public:
+
+  using Value = std::variant<
+    std::string,
+    int64_t,
+    uint64_t,
+    double,
+    rmf_traffic::Time,
+    rmf_traffic::Duration
+  >;
+
+  /// Text argument
+  Argument(std::string value);
+
+  /// Text argument
+  Argument(const char* value);
+
+  /// Integer argument, such as a waypoint index
+  template<
+    typename T,
+    typename = std::enable_if_t<std::is_integral_v<T>>>
+  Argument(T value);
+
+  /// Floating point argument, such as a state of charge
+  Argument(double value);
+
+  /// Time argument
+  Argument(rmf_traffic::Time value);
+
+  /// Duration argument
+  Argument(rmf_traffic::Duration value);
+
+  /// Get the value of this argument
+  const Value& value() const;
+
+  /// Render this argument as text
+  std::string render() const;
+
+private:
+  Value _value;
+};
+
 //==============================================================================
 /// A snapshot view of the log's contents. This is thread-safe to read even
 /// while new entries are being added to the log, but those new entries will
 /// not be seen by this View. You must retrieve a new View to see new entries.
+/// The entries of a View stay readable even if the log evicts them.
 class Log::View
 {
 public:
+
+  /// The number of entries in this View.
+  std::size_t size() const;
+
+  /// Append the entries of this View that come after the entry whose sequence
+  /// number is seq. If seq is std::nullopt, or if no entry of this View has
+  /// that sequence number (e.g. because it was evicted), every entry of the
+  /// View is appended. The entry is found directly unless the log contains
+  /// entries that were given to insert(). The pointers stay valid for as long
+  /// as this View or a copy of it exists.
+  ///
+  /// \param[in] seq
+  ///   The sequence number of the last entry that the caller already has.
+  ///
+  /// \param[out] output
+  ///   The entries are appended to this buffer.
+  ///
+  /// \return the number of entries that were appended.
+  std::size_t entries_after(
+    std::optional<uint32_t> seq,
+    std::vector<const Entry*>& output) const;
+
   class Implementation;
 private:
   View();
@@ -154,6 +316,13 @@ public:
   /// \endcode
   Iterable read(const View& view);
 
+  /// Append the entries of a View that this Reader has not read yet to a
+  /// buffer, just like read(const View&) would visit them. The pointers stay
+  /// valid for as long as the View or a copy of it exists.
+  ///
+  /// \return the number of entries that were appended.
+  std::size_t read(const View& view, std::vector<const Entry*>& output);
+
   class Implementation;
 private:
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
@@ -173,6 +342,10 @@ public:
   /// Get the ending iterator of the read
   iterator end() const;
 
+  /// The number of entries that this read skipped because they were evicted
+  /// from the log before the Reader got to them.
+  std::size_t truncated() const;
+
   class Implementation;
 private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -221,4 +394,6 @@ private:
 
 } // namespace rmf_task
 
+#include <rmf_task/detail/impl_Log.hpp>
+
 #endif // RMF_TASK__LOG_HPP
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__METRICS_HPP
+#define RMF_TASK__METRICS_HPP
+
+#include <rmf_traffic/Time.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Counters and latency histograms that rmf_task and rmf_task_sequence keep
+/// for the whole process. They are always on. Each thread adds to its own
+/// block of counters without any locking, and the blocks of every thread are
+/// only added together when the metrics are scraped, so recording a metric
+/// costs about as much as incrementing an integer.
+///
+/// To export the metrics, implement a Sink, e.g. as a bridge to Prometheus,
+/// and pass it to scrape() whenever the exporter is asked for them. Every
+/// value that gets scraped only ever grows.
+class Metrics
+{
+public:
+
+  enum class Counter : std::size_t
+  {
+    /// Calls to TaskPlanner::plan()
+    plans = 0,
+
+    /// Search nodes that the planner expanded
+    plan_nodes_expanded,
+
+    /// Search nodes that the planner generated
+    plan_nodes_generated,
+
+    /// Travel estimates that were answered without planning a route
+    travel_estimate_hits,
+
+    /// Travel estimates that needed a route to be planned
+    travel_estimate_misses,
+
+    /// Entries that were added to any Log
+    log_entries,
+
+    /// Backups that were written by a BackupFileManager
+    backup_writes,
+
+    /// The bytes of the backups that were written, before compression
+    backup_bytes,
+
+    /// Calls to Phase::Snapshot::make()
+    phase_snapshots,
+
+    /// Backups that were generated by active tasks
+    task_backups
+  };
+
+  /// The number of kinds of Counter
+  static constexpr std::size_t NumCounters = 10;
+
+  enum class Latency : std::size_t
+  {
+    /// The time that each call to TaskPlanner::plan() takes
+    plan = 0,
+
+    /// The time that each backup takes to be stored by a BackupFileManager
+    backup_write,
+
+    /// The time that requests wait in a PlanBatcher before a plan that
+    /// includes them is started
+    plan_queueing
+  };
+
+  /// The number of kinds of Latency
+  static constexpr std::size_t NumLatencies = 3;
+
+  /// The upper bounds of the buckets of every latency histogram, in seconds.
+  /// There is one more bucket after these for everything slower.
+  static constexpr std::size_t NumBounds = 12;
+  static const std::array<double, NumBounds>& bucket_bounds();
+
+  /// The aggregated value of one latency histogram
+  struct Histogram
+  {
+    /// The number of observations in each bucket. These are not cumulative.
+    std::array<uint64_t, NumBounds + 1> buckets = {};
+
+    /// The total number of observations
+    uint64_t count = 0;
+
+    /// The sum of all the observations, in seconds
+    double sum = 0.0;
+  };
+
+  /// An exporter of the metrics
+  class Sink
+  {
+  public:
+
+    /// Receive the total of a counter
+    virtual void counter(const char* name, uint64_t value) = 0;
+
+    /// Receive a latency histogram. See bucket_bounds() for its buckets.
+    virtual void histogram(const char* name, const Histogram& value) = 0;
+
+    virtual ~Sink() = default;
+  };
+
+  /// Add to a counter of the current thread
+  static void add(Counter counter, uint64_t amount = 1);
+
+  /// Record a latency on the current thread
+  static void observe(Latency latency, rmf_traffic::Duration duration);
+
+  /// Get the total of a counter across every thread
+  static uint64_t total(Counter counter);
+
+  /// Get a histogram aggregated across every thread
+  static Histogram histogram(Latency latency);
+
+  /// Aggregate every metric across every thread and pass them to the sink.
+  /// The names are in the style of Prometheus, e.g. "rmf_task_plans_total".
+  static void scrape(Sink& sink);
+
+  /// The name that scrape() gives to a counter
+  static const char* name(Counter counter);
+
+  /// The name that scrape() gives to a latency histogram
+  static const char* name(Latency latency);
+
+  class ScopedLatency;
+};
+
+//==============================================================================
+/// Record the time from the construction of this object until its
+/// destruction as a latency
+class Metrics::ScopedLatency
+{
+public:
+
+  ScopedLatency(Latency latency);
+
+  ~ScopedLatency();
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+  Latency _latency;
+  std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__METRICS_HPP
@@ -130,7 +130,18 @@ class Phase::Snapshot : public Phase::Active
 public:
 
   /// Make a snapshot of an Active phase
-  static ConstSnapshotPtr make(const Active& active);
+  ///
+  /// \param[in] active
+  ///   The phase to take a snapshot of
+  ///
+  /// \param[in] previous
+  ///   An earlier snapshot of the same phase. The events that have not changed
+  ///   since then will be shared with it, as described by
+  ///   Event::Snapshot::make(). If nothing has changed, the previous snapshot
+  ///   itself is returned.
+  static ConstSnapshotPtr make(
+    const Active& active,
+    const ConstSnapshotPtr& previous = nullptr);
 
   // Documentation inherited
   ConstTagPtr tag() const final;
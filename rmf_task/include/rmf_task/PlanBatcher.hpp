@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__PLANBATCHER_HPP
+#define RMF_TASK__PLANBATCHER_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Gathers requests that arrive in bursts so that a TaskPlanner is run once
+/// for each batch of them instead of once for each request.
+///
+/// The batcher keeps the set of outstanding requests: each request that is
+/// submitted stays in the set until it is retired. A batch is closed once the
+/// window has passed since the first request that arrived after the latest
+/// plan was started, or as soon as the batch reaches its size limit. Closing
+/// a batch starts a plan of every outstanding request on a background thread
+/// that is owned by the batcher.
+///
+/// A plan that is still running when the next batch closes does not include
+/// the newer requests, so it is stale. It is cancelled through the
+/// interrupter of its options and its result is never delivered. If the
+/// plans generally take longer than the window, use a larger window or
+/// size limit so that the plans get a chance to finish.
+///
+/// Every function of this class is thread-safe. The callbacks are run on the
+/// background thread, so they should return quickly and must not call back
+/// into the batcher that is running them.
+class PlanBatcher
+{
+public:
+
+  /// The outcome of a plan that was not superseded
+  struct Batch
+  {
+    /// The result of the plan
+    TaskPlanner::Result result;
+
+    /// Every request that was planned, in the order that they were submitted
+    std::vector<ConstRequestPtr> requests;
+
+    /// The number of requests that arrived since the previous plan was
+    /// started
+    std::size_t new_requests = 0;
+
+    /// How long the oldest of the new requests waited before this plan was
+    /// started. This is also recorded as Metrics::Latency::plan_queueing.
+    rmf_traffic::Duration queueing_latency = rmf_traffic::Duration(0);
+
+    /// How long the plan itself took
+    rmf_traffic::Duration planning_latency = rmf_traffic::Duration(0);
+  };
+
+  /// Get the current states of the agents when a plan is about to start
+  using GetAgents = std::function<std::vector<State>()>;
+
+  /// Receive the outcome of a plan
+  using Deliver = std::function<void(Batch)>;
+
+  /// Get the current time when a plan is about to start. This becomes the
+  /// time_now of the plan.
+  using Clock = std::function<rmf_traffic::Time()>;
+
+  /// Constructor
+  ///
+  /// \param[in] planner
+  ///   The planner that the batches are planned with
+  ///
+  /// \param[in] agents
+  ///   Gets the states of the agents for each plan
+  ///
+  /// \param[in] deliver
+  ///   Receives the outcome of each plan that is not superseded
+  ///
+  /// \param[in] window
+  ///   How long a batch stays open after its first request arrives
+  ///
+  /// \param[in] max_batch_size
+  ///   The number of new requests that closes a batch right away. A value of
+  ///   0 means the batches are only closed by the window.
+  ///
+  /// \param[in] clock
+  ///   The clock for the time_now of each plan. If this is nullptr then
+  ///   std::chrono::steady_clock is used.
+  PlanBatcher(
+    TaskPlanner planner,
+    GetAgents agents,
+    Deliver deliver,
+    rmf_traffic::Duration window,
+    std::size_t max_batch_size = 0,
+    Clock clock = nullptr);
+
+  /// Add a request to the outstanding requests. A request with the same
+  /// booking ID as an outstanding request replaces it.
+  PlanBatcher& submit(ConstRequestPtr request);
+
+  /// Remove a request from the outstanding requests, e.g. once its task has
+  /// been dispatched. This does not cause a plan to start.
+  ///
+  /// \return true if the request was outstanding.
+  bool retire(const std::string& request_id);
+
+  /// Close the current batch right away, even if it has no new requests
+  void flush();
+
+  /// Wait until no batch is open and no plan is running
+  void wait_until_idle() const;
+
+  /// The number of outstanding requests
+  std::size_t outstanding() const;
+
+  /// The number of requests that are waiting for a plan to be started
+  std::size_t pending() const;
+
+  /// The number of plans that have been started
+  std::size_t plans_started() const;
+
+  /// The number of plans that were cancelled because a newer batch closed
+  /// before they finished
+  std::size_t plans_superseded() const;
+
+  /// Stop the background thread. A plan that is running is cancelled and its
+  /// result is not delivered.
+  ~PlanBatcher();
+
+  PlanBatcher(const PlanBatcher&) = delete;
+  PlanBatcher& operator=(const PlanBatcher&) = delete;
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__PLANBATCHER_HPP
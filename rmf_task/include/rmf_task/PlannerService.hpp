@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__PLANNERSERVICE_HPP
+#define RMF_TASK__PLANNERSERVICE_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Serves plan() calls to other processes on the same host, so that several
+/// fleet adapters can share one set of planners, with their travel estimate
+/// and model caches and their worker pools, instead of each embedding their
+/// own.
+///
+/// Clients and the service communicate through a ring of request slots in a
+/// memory mapped file. Putting the file on a memory backed filesystem such as
+/// /dev/shm keeps the communication in shared memory. A client writes the
+/// agent states and the requests of a plan into a free slot in a compact
+/// binary layout, and the service writes the assignments back into the same
+/// slot.
+///
+/// Only the basic components of each State are sent, i.e. its waypoint,
+/// orientation, time, dedicated charger and battery charge. The only
+/// supported requests are the built-in Delivery, Loop, Clean and
+/// ChargeBattery requests, with no priority or a priority of the
+/// BinaryPriorityScheme, and their payloads are not sent since planning does
+/// not depend on them. The assignments that come back refer to the request
+/// instances that the client gave.
+///
+/// This is only supported on POSIX platforms.
+class PlannerService
+{
+public:
+
+  class Client;
+
+  /// Create the file of the request slots and begin serving.
+  ///
+  /// \param[in] path
+  ///   The path of the file to create. This is replaced if it already exists
+  ///   and removed when the service is destroyed.
+  ///
+  /// \param[in] threads
+  ///   The number of requests that are planned at once. Each one is planned
+  ///   on a thread of its own, and each of those may use the worker pool of
+  ///   its planner.
+  ///
+  /// \param[in] slots
+  ///   The number of request slots. This is the most requests that may be
+  ///   waiting for the service at once.
+  ///
+  /// \param[in] slot_capacity
+  ///   The number of bytes in each request slot. Requests and results that do
+  ///   not fit are refused.
+  ///
+  /// \throws std::runtime_error if the file cannot be created or the platform
+  /// does not support the service.
+  PlannerService(
+    std::string path,
+    std::size_t threads = 1,
+    std::size_t slots = 8,
+    std::size_t slot_capacity = 1 << 20);
+
+  /// Add the planner of a fleet, or replace the planner that the fleet had.
+  /// This may be called while requests are being served.
+  PlannerService& add_fleet(
+    const std::string& fleet,
+    std::shared_ptr<TaskPlanner> planner);
+
+  /// Get the path of the file of the request slots
+  const std::string& path() const;
+
+  /// Get the number of requests that the service has answered
+  std::size_t served() const;
+
+  /// Stops serving and removes the file. Clients that are waiting for the
+  /// service get an error.
+  ~PlannerService();
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+//==============================================================================
+/// Submits plans to a PlannerService that runs in another process, or in the
+/// same one. A client may be used from several threads at once.
+class PlannerService::Client
+{
+public:
+
+  /// Connect to the file of a running service.
+  ///
+  /// \throws std::runtime_error if there is no service with this path
+  Client(const std::string& path);
+
+  /// Plan with the default options of the planner of a fleet. The arguments
+  /// are the same as for TaskPlanner::plan().
+  ///
+  /// \param[in] timeout
+  ///   How long to wait for a free slot and then for the result
+  ///
+  /// \throws std::invalid_argument if a state or request cannot be sent, or
+  /// std::runtime_error if the service refuses the request, does not know the
+  /// fleet, stops, or does not answer before the timeout.
+  TaskPlanner::Result plan(
+    const std::string& fleet,
+    rmf_traffic::Time time_now,
+    const std::vector<State>& agents,
+    const std::vector<ConstRequestPtr>& requests,
+    rmf_traffic::Duration timeout = std::chrono::seconds(60)) const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__PLANNERSERVICE_HPP
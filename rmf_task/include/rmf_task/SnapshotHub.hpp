@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__SNAPSHOTHUB_HPP
+#define RMF_TASK__SNAPSHOTHUB_HPP
+
+#include <rmf_task/Phase.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Publish the phase snapshots of tasks to any number of subscribers without
+/// serializing them once per subscriber. The hub keeps the latest snapshot of
+/// each task and encodes it at most once for each format, the first time that
+/// a subscriber or a call to encoded() needs that format. Every subscriber of
+/// a format then receives the same immutable buffer.
+///
+/// The "cbor" format, written by CborWriter, is available from the start.
+/// Subscribers are called on the thread that publishes, after the hub has
+/// released its lock, so they may call back into the hub.
+class SnapshotHub
+{
+public:
+
+  /// An immutable encoded snapshot that is shared by everyone who receives it
+  using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+  /// A function that encodes a snapshot into a format
+  using Encoder = std::function<std::vector<uint8_t>(const Phase::Snapshot&)>;
+
+  /// A function that receives the encoded snapshots of a format
+  ///
+  /// \param[in] task
+  ///   The task that the snapshot was published for
+  ///
+  /// \param[in] buffer
+  ///   The encoded snapshot
+  using Subscriber =
+    std::function<void(const std::string& task, const Buffer& buffer)>;
+
+  /// Constructor
+  SnapshotHub();
+
+  /// Add a format that snapshots can be encoded in. A format that already
+  /// exists is replaced, and the buffers that were encoded in it are dropped.
+  ///
+  /// \param[in] format
+  ///   The name of the format
+  ///
+  /// \param[in] encoder
+  ///   The function that encodes snapshots into the format
+  SnapshotHub& add_format(std::string format, Encoder encoder);
+
+  /// Encode a snapshot with CborWriter. This is the encoder of the "cbor"
+  /// format.
+  static std::vector<uint8_t> encode_cbor(const Phase::Snapshot& snapshot);
+
+  /// Subscribe to the snapshots of every task in a format. The latest
+  /// snapshot of each task is not replayed to a new subscriber; use
+  /// encoded() to catch up.
+  ///
+  /// \param[in] format
+  ///   The format to receive the snapshots in
+  ///
+  /// \param[in] subscriber
+  ///   The function that receives the snapshots
+  ///
+  /// \throws std::invalid_argument if the format has not been added.
+  ///
+  /// \return an identifier that can be passed to unsubscribe()
+  uint64_t subscribe(const std::string& format, Subscriber subscriber);
+
+  /// Stop delivering snapshots to a subscriber. Unknown identifiers are
+  /// ignored.
+  void unsubscribe(uint64_t id);
+
+  /// Publish the latest snapshot of a task. The snapshot is encoded once for
+  /// each format that has subscribers, and the buffer of each format is
+  /// delivered to all of its subscribers. A snapshot that is the same object
+  /// as the one that the hub already has for the task is not delivered again,
+  /// and a null snapshot is ignored.
+  ///
+  /// \param[in] task
+  ///   The task that the snapshot belongs to
+  ///
+  /// \param[in] snapshot
+  ///   The latest snapshot of the task
+  void publish(const std::string& task, Phase::ConstSnapshotPtr snapshot);
+
+  /// Get the latest snapshot of a task, or nullptr if none was published
+  Phase::ConstSnapshotPtr latest(const std::string& task) const;
+
+  /// Get the latest snapshot of a task encoded in a format. It is encoded now
+  /// if it has not been encoded in that format yet.
+  ///
+  /// \throws std::invalid_argument if the format has not been added.
+  ///
+  /// \return the encoded snapshot, or nullptr if no snapshot was published
+  /// for the task.
+  Buffer encoded(const std::string& task, const std::string& format);
+
+  /// Forget the latest snapshot of a task, e.g. once the task is finished
+  void erase(const std::string& task);
+
+  /// The number of times that a snapshot has been encoded in any format
+  std::size_t encodings() const;
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__SNAPSHOTHUB_HPP
@@ -106,6 +106,41 @@ public:
   std::optional<rmf_traffic::agv::Plan::Start> extract_plan_start() const;
 };
 
+//==============================================================================
+/// A plain copy of the basic components of a State. The task planner and the
+/// built-in task models estimate tasks with this so that they do not need to
+/// allocate a new State for every estimate. It is converted to a State once
+/// the estimate is finished.
+struct PlanningState
+{
+  /// The current waypoint of the robot
+  std::size_t waypoint;
+
+  /// The current orientation of the robot
+  double orientation;
+
+  /// The current time for the robot
+  rmf_traffic::Time time;
+
+  /// The dedicated charging point for this robot
+  std::size_t dedicated_charging_waypoint;
+
+  /// The current battery state of charge of the robot, between 0.0 and 1.0
+  double battery_soc;
+
+  /// Copy the basic components of a State. If any of them is missing, this
+  /// will return a std::nullopt.
+  static std::optional<PlanningState> from(const State& state);
+
+  /// Make a State that has the basic components of this planning state.
+  ///
+  /// \throws std::invalid_argument if battery_soc is not between 0.0 and 1.0.
+  State to_state() const;
+
+  /// Get the rmf_traffic::agv::Plan::Start of this planning state.
+  rmf_traffic::agv::Plan::Start plan_start() const;
+};
+
 } // namespace rmf_task
 
 #endif // RMF_TASK__AGV__STATE_HPP
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__STATESNAPSHOT_HPP
+#define RMF_TASK__STATESNAPSHOT_HPP
+
+#include <rmf_task/State.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Build the State of a robot at most once per control tick. An active task,
+/// its phases and its events each call the get_state function that they were
+/// activated with whenever they need the state, so a single update of a
+/// deeply composed task may build it many times. Give them provider() instead
+/// and call tick() once at the start of each control cycle. The first request
+/// after a tick builds the state and every other request until the next tick
+/// shares it.
+///
+/// Copies of a State share their data until one of them is modified, so the
+/// states that provider() hands out cost no allocations, and a copy that gets
+/// modified does not affect the snapshot.
+class StateSnapshot
+{
+public:
+
+  using GetState = std::function<State()>;
+
+  /// Constructor
+  ///
+  /// \param[in] get_state
+  ///   The function that builds the current state of the robot
+  StateSnapshot(GetState get_state);
+
+  /// Start a new control tick. The next request for the state will build it
+  /// again.
+  void tick();
+
+  /// Get the state of the current tick, building it first if this is the
+  /// first request since the last tick.
+  std::shared_ptr<const State> get() const;
+
+  /// Get a function that can be given to Activator::activate(~) in place of
+  /// the original get_state. It keeps the snapshot data alive, so it can
+  /// outlive this StateSnapshot.
+  GetState provider() const;
+
+  /// The number of times that the state has been built
+  std::size_t builds() const;
+
+  StateSnapshot(const StateSnapshot&) = delete;
+  StateSnapshot& operator=(const StateSnapshot&) = delete;
+
+  class Implementation;
+private:
+  // Shared with the functions that are given out by provider()
+  std::shared_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__STATESNAPSHOT_HPP
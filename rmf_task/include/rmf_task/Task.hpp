@@ -33,6 +33,8 @@
 #include <memory>
 #include <optional>
 #include <functional>
+#include <string_view>
+#include <vector>
 
 namespace rmf_task {
 
@@ -128,21 +130,41 @@ public:
   rmf_traffic::Time earliest_start_time() const;
 
   /// Get the priority of this booking.
-  ConstPriorityPtr priority() const;
+  const ConstPriorityPtr& priority() const;
 
   /// Get the identifier of the entity that requested this booking. Returns a
   /// nullopt if no requester was defined.
-  std::optional<std::string> requester() const;
+  const std::optional<std::string>& requester() const;
 
   /// Get the time that this booking was requested. Returns a nullopt if no
   /// request time was defined.
-  std::optional<rmf_traffic::Time> request_time() const;
+  const std::optional<rmf_traffic::Time>& request_time() const;
 
   // Returns true if this booking was automatically generated.
   bool automatic() const;
 
   /// Get the labels that describe the purpose of the task dispatch request.
-  std::vector<std::string> labels() const;
+  ///
+  /// Like the other accessors of Booking, this refers to the data inside the
+  /// booking instead of copying it, so filtering or sorting many bookings does
+  /// not allocate anything. The reference stays valid for as long as the
+  /// booking does.
+  const std::vector<std::string>& labels() const;
+
+  /// Check whether the booking has a certain label without copying either of
+  /// them.
+  bool has_label(std::string_view label) const;
+
+  /// Set the IDs of the bookings that must finish before this booking may
+  /// begin. When those bookings are planned by the same TaskPlanner::plan()
+  /// call, the planner only assigns this booking after all of them and never
+  /// has it begin before the last of them finishes. Dependencies on bookings
+  /// that are not part of the plan are considered to be finished already.
+  Booking& dependencies(std::vector<std::string> booking_ids);
+
+  /// Get the IDs of the bookings that must finish before this booking may
+  /// begin.
+  const std::vector<std::string>& dependencies() const;
 
   class Implementation;
 private:
@@ -185,9 +207,67 @@ public:
     const Constraints& task_planning_constraints,
     const TravelEstimator& travel_estimator) const = 0;
 
+  /// Estimate the finish of the task for each of several initial states, such
+  /// as the current states of every robot in a fleet. The default
+  /// implementation calls estimate_finish() once per state. Models can
+  /// override this to share work between the states.
+  ///
+  /// \return one estimate for each element of initial_states, in the same
+  /// order.
+  virtual std::vector<std::optional<Estimate>> estimate_finish_batch(
+    const std::vector<State>& initial_states,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const;
+
+  /// The finish of a task that was estimated from a PlanningState
+  struct PlanningEstimate
+  {
+    /// The state of the robot once it completes the task
+    PlanningState finish_state;
+
+    /// The ideal time for the robot to start the task
+    rmf_traffic::Time wait_until;
+  };
+
+  /// True if estimate_finish() only reads the basic components of its initial
+  /// state and only fills in the basic components of its finish state. The
+  /// task planner then estimates this model with estimate_planning_finish()
+  /// instead, which does not need to allocate a State. The default
+  /// implementation returns false.
+  virtual bool uses_planning_state() const;
+
+  /// Estimate the finish of the task from the basic components of a state.
+  /// This must give the same result as estimate_finish(). The default
+  /// implementation converts the initial state to a State, calls
+  /// estimate_finish(), and copies the basic components of its finish state.
+  virtual std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const;
+
   /// Estimate the invariant component of the task's duration
   virtual rmf_traffic::Duration invariant_duration() const = 0;
 
+  /// Compute anything that this model deferred when it was made, such as the
+  /// travel plans behind its invariant duration. Models may defer that work
+  /// so that making a model is cheap, and the task planner calls this for
+  /// every model before it starts searching, on as many threads as it has.
+  /// Models that are used without calling this compute what they need on
+  /// first use instead. This may be called more than once and from several
+  /// threads at the same time. The default implementation does nothing.
+  ///
+  /// \param[in] travel_estimator
+  ///   The estimator to plan any deferred travel with
+  virtual void materialize(const TravelEstimator& travel_estimator) const;
+
+  /// Make a model of the same task with a different earliest start time,
+  /// sharing whatever this model has already computed. The task planner uses
+  /// this to reuse the models of recurring requests. The default
+  /// implementation returns nullptr, which means that a new model must be
+  /// made instead.
+  virtual ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const;
+
   virtual ~Model() = default;
 };
 
@@ -211,6 +291,35 @@ public:
     rmf_traffic::Time earliest_start_time,
     const Parameters& parameters) const = 0;
 
+  /// Generate a Model for the task, using a travel estimator for any travel
+  /// that the model needs to plan ahead of time. The task planner uses this
+  /// so that a route which appears in many requests is only planned once.
+  /// Models that defer their planning until Model::materialize() do not need
+  /// to override this. The default implementation ignores the travel
+  /// estimator.
+  ///
+  /// \param[in] earliest_start_time
+  ///   The earliest time this task should begin execution.
+  ///
+  /// \param[in] parameters
+  ///   The parameters that describe this AGV
+  ///
+  /// \param[in] travel_estimator
+  ///   The estimator for the travel of this AGV
+  virtual ConstModelPtr make_model(
+    rmf_traffic::Time earliest_start_time,
+    const Parameters& parameters,
+    const TravelEstimator& travel_estimator) const;
+
+  /// A hash of everything in this description that its models depend on,
+  /// apart from their earliest start time. The task planner treats
+  /// descriptions of the same type with the same hash as equivalent and
+  /// shares one model between them, using Model::with_earliest_start_time()
+  /// to adjust its start time. The default implementation returns
+  /// std::nullopt, which means that models of this description are never
+  /// shared.
+  virtual std::optional<std::size_t> model_hash() const;
+
   struct Info
   {
     std::string category;
@@ -346,6 +455,12 @@ public:
   /// the discretion of the Task implementation.
   virtual void rewind(uint64_t phase_id) = 0;
 
+  /// The number of phase snapshots that were never given to the update
+  /// callback because a newer snapshot replaced them while updates were being
+  /// rate limited. The default implementation returns 0 for tasks that do not
+  /// limit their updates.
+  virtual std::size_t suppressed_updates() const;
+
   // Virtual destructor
   virtual ~Active() = default;
 
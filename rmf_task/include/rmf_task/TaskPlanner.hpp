@@ -22,6 +22,7 @@
 #include <rmf_task/RequestFactory.hpp>
 #include <rmf_task/CostCalculator.hpp>
 #include <rmf_task/Constraints.hpp>
+#include <rmf_task/Estimate.hpp>
 #include <rmf_task/Parameters.hpp>
 #include <rmf_task/State.hpp>
 
@@ -30,6 +31,10 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <unordered_set>
 #include <variant>
 
 namespace rmf_task {
@@ -78,18 +83,146 @@ public:
     /// BinaryPriorityCostCalculator is used by the planner.
     Configuration& cost_calculator(ConstCostCalculatorPtr cost_calculator);
 
+    /// Get the TravelEstimator that the planner will use
+    const ConstTravelEstimatorPtr& travel_estimator() const;
+
+    /// Set the TravelEstimator that the planner will use. This allows several
+    /// planners to share memoized estimates, or an estimator to be configured
+    /// with a precomputed table, persistence or a cache capacity. It must have
+    /// been made for the same parameters as this configuration. If a nullptr
+    /// is passed, which is the default, each planner makes its own estimator.
+    Configuration& travel_estimator(ConstTravelEstimatorPtr travel_estimator);
+
+    /// Get the number of task models that the planner keeps between calls to
+    /// plan()
+    std::size_t model_cache_capacity() const;
+
+    /// Set the number of task models that the planner keeps between calls to
+    /// plan(). Requests whose descriptions provide a
+    /// Task::Description::model_hash() reuse the model of an equivalent
+    /// earlier request instead of making a new one, which pays off for
+    /// recurring requests. The least recently used models are dropped once
+    /// there are more than this many. A capacity of 0 disables the cache. The
+    /// default is 1000.
+    Configuration& model_cache_capacity(std::size_t capacity);
+
+    /// Get the number of plan() results that the planner keeps
+    std::size_t plan_cache_capacity() const;
+
+    /// Set the number of plan() results that the planner keeps. A plan() call
+    /// whose inputs match an earlier call returns the result of that call
+    /// without searching again, which helps when the same plan is requested
+    /// several times, e.g. when a bid is retried. The inputs match when
+    /// time_now falls in the same interval of plan_cache_time_resolution(),
+    /// the basic components of the initial states are the same, the requests
+    /// have the same bookings and Task::Description::model_hash(), and the
+    /// options would lead to the same result. Plans that use an interrupter,
+    /// a time budget, a refinement time, a segment callback or a capture path
+    /// are never cached, and neither are plans of requests that do not
+    /// provide a model hash or that use a priority other than the
+    /// BinaryPriorityScheme, or calls to replan(). The least recently used
+    /// results are dropped once there are more than this many. A capacity of
+    /// 0, which is the default, disables the cache.
+    Configuration& plan_cache_capacity(std::size_t capacity);
+
+    /// Get the width of the intervals that time_now is rounded to when plans
+    /// are matched
+    rmf_traffic::Duration plan_cache_time_resolution() const;
+
+    /// Set the width of the intervals that time_now is rounded to when plans
+    /// are matched. The default is 1 second.
+    Configuration& plan_cache_time_resolution(rmf_traffic::Duration value);
+
+    /// Get the number of idle worker threads that the planner keeps between
+    /// searches
+    std::size_t worker_pool_size() const;
+
+    /// Set the number of idle worker threads that the planner keeps between
+    /// searches. The threads that Options::expansion_threads(),
+    /// Options::initialization_threads(), Options::refinement_threads(),
+    /// Options::decompose() and compute_costs() use are then taken from this
+    /// pool instead of being started for each search and joined again at the
+    /// end of it, which pays off for a planner that is asked for plans many
+    /// times a minute. Threads beyond this many are still started as needed,
+    /// but they are not kept. The pool is shared with copies of the planner.
+    /// The default is 0, which keeps no threads.
+    Configuration& worker_pool_size(std::size_t value);
+
+    /// Get the largest memory buffer, in bytes, that the planner keeps for the
+    /// arenas of Options::arena_allocation() between plans
+    std::size_t arena_pool_capacity() const;
+
+    /// Set the largest memory buffer, in bytes, that the planner keeps for the
+    /// arenas of Options::arena_allocation() between plans. Each arena starts
+    /// with a kept buffer that is as large as all of the memory the previous
+    /// arena used, up to this capacity, so the nodes of a plan that is similar
+    /// to the previous one are allocated without going to the heap. The
+    /// default is 0, which keeps no buffers.
+    Configuration& arena_pool_capacity(std::size_t bytes);
+
+    /// Get the chargers that the agents share
+    const std::vector<std::size_t>& charger_pool() const;
+
+    /// Set the chargers that the agents share. When this is not empty, an
+    /// implicit charging task goes to the charger of the pool that is the
+    /// fastest to reach, instead of the dedicated charger of the agent, and
+    /// that charger becomes the dedicated charger of the state it finishes
+    /// in. An agent holds the dedicated charger of its latest state, so no
+    /// agent is sent to charge at a charger that another agent holds, and it
+    /// charges at the nearest charger that is free instead. Which chargers
+    /// are the fastest to reach from each waypoint is only estimated once per
+    /// planner, so choosing a charger is a lookup. The default is empty.
+    Configuration& charger_pool(std::vector<std::size_t> chargers);
+
     class Implementation;
 
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
   };
 
+  /// The type of filter that the optimal search uses to avoid exploring the
+  /// same set of assignments more than once
+  enum class FilterType
+  {
+    /// Do not filter out any nodes
+    Passthrough,
+
+    /// Store the assignments that have been seen in a trie
+    Trie,
+
+    /// Store a 128-bit fingerprint of the assignments that have been seen
+    Hash
+  };
+
+  /// How the optimal search orders the nodes that have the same cost estimate
+  enum class TieBreak
+  {
+    /// Leave the order of such nodes unspecified
+    None,
+
+    /// Prefer the node whose assignments have cost the most so far, since
+    /// less of its cost is left to the heuristic
+    Cost,
+
+    /// Prefer the node with the fewest unassigned requests
+    Depth
+  };
+
+  class Assignment;
+
+  /// Container for assignments for each agent
+  using Assignments = std::vector<std::vector<Assignment>>;
+
   /// The Options class contains planning parameters that can change between
   /// each planning attempt.
   class Options
   {
   public:
 
+    /// Signature of a callback that receives the assignments of one planning
+    /// segment
+    using SegmentCallback = std::function<void(const Assignments& segment)>;
+
     /// Constructor
     ///
     /// \param[in] greedy
@@ -115,6 +248,32 @@ public:
     /// Get whether a greedy approach will be used
     bool greedy() const;
 
+    /// Set the greedy approach to regret-k insertion. Instead of taking the
+    /// cheapest assignment of any task, each step assigns the task with the
+    /// largest regret: the total delay of its 2nd through k-th best agents
+    /// compared to its best agent. Tasks that few agents can perform are
+    /// assigned first. A value below 2, which is the default, uses the plain
+    /// greedy approach. This only has an effect when greedy() is true.
+    Options& regret_insertion(std::size_t k);
+
+    /// Get the k of regret-k insertion, or a value below 2 if it is not used
+    std::size_t regret_insertion() const;
+
+    /// Set whether the requests should be assigned by a sequential auction
+    /// instead of a search. The requests are auctioned one at a time in order
+    /// of their earliest start time, and each one goes to the agent that can
+    /// finish it soonest after the requests that the agent has already won,
+    /// charging first if it needs to. Every request is only considered once,
+    /// instead of once for every step like the greedy approach, so the
+    /// planning time grows close to linearly with the number of agents, at
+    /// the price of some optimality. Like greedy(), this gives no
+    /// suboptimality bound, and it takes precedence over greedy() and
+    /// regret_insertion(). The default is false.
+    Options& auction(bool value);
+
+    /// Get whether the requests are assigned by a sequential auction
+    bool auction() const;
+
     /// Set an interrupter callback that will indicate to the planner if it
     /// should stop trying to plan
     Options& interrupter(std::function<bool()> interrupter);
@@ -122,12 +281,305 @@ public:
     /// Get the interrupter that will be used in this Options
     const std::function<bool()>& interrupter() const;
 
+    /// Set how much wall-clock time each plan() or replan() call may take. The
+    /// deadline is checked in every loop of the optimal and greedy searches
+    /// and while finishing requests are appended. Once it passes, the planner
+    /// stops as if the interrupter had fired: the best solution found so far
+    /// is returned when the search is anytime, and otherwise no assignments
+    /// are returned. Unlike the interrupter, the clock is only read every few
+    /// iterations. The default is std::nullopt, which means no deadline.
+    Options& time_budget(std::optional<rmf_traffic::Duration> value);
+
+    /// Get how much wall-clock time each plan() call may take
+    std::optional<rmf_traffic::Duration> time_budget() const;
+
     /// Set the request factory that will generate a finishing task
     Options& finishing_request(ConstRequestFactoryPtr finishing_request);
 
     /// Get the request factory that will generate a finishing task
     ConstRequestFactoryPtr finishing_request() const;
 
+    /// Set whether the planner should allocate its search nodes from a
+    /// monotonic arena that is scoped to a single plan() call. All of the
+    /// search memory is released at once when the plan returns, instead of
+    /// one node at a time. This is off by default.
+    Options& arena_allocation(bool value);
+
+    /// Get whether the planner will allocate its search nodes from an arena
+    bool arena_allocation() const;
+
+    /// Set the number of threads that the optimal (non-greedy) search may use
+    /// to expand each node. The nodes are still explored in the same order as
+    /// with a single thread, so the solution has the same cost. A value of 0
+    /// will use the number of hardware threads that are available. The
+    /// default is 1.
+    Options& expansion_threads(std::size_t value);
+
+    /// Get the number of threads that will be used to expand search nodes
+    std::size_t expansion_threads() const;
+
+    /// Set the number of threads that may be used to build the task models
+    /// and candidate estimates of the requests before each search begins. The
+    /// results do not depend on the number of threads. A value of 0 will use
+    /// the number of hardware threads that are available. The default is 1.
+    Options& initialization_threads(std::size_t value);
+
+    /// Get the number of threads that will be used to prepare the requests
+    std::size_t initialization_threads() const;
+
+    /// Set whether the greedy and the optimal searches should be run
+    /// concurrently. The greedy solution is used as an upper bound to prune
+    /// the optimal search, and it is returned if the optimal search gets
+    /// interrupted before it finishes. When this is enabled the greedy()
+    /// setting is ignored. This is off by default.
+    Options& portfolio(bool value);
+
+    /// Get whether the greedy and optimal searches will be run concurrently
+    bool portfolio() const;
+
+    /// Set whether the optimal search should run as an anytime search. It
+    /// begins with an inflated heuristic so that it finds a complete solution
+    /// quickly, and then keeps improving on that solution until it is optimal.
+    /// If the interrupter stops the search early, the best solution found so
+    /// far is returned instead of nothing. Use last_suboptimality_bound() to
+    /// find out how close that solution is to optimal. This is off by default.
+    Options& anytime(bool value);
+
+    /// Get whether the optimal search will run as an anytime search
+    bool anytime() const;
+
+    /// Set the weight w that the optimal search applies to its heuristic, so
+    /// that nodes are explored in order of g + w*h. With a weight above 1.0
+    /// the search usually explores far fewer nodes, and the cost of its
+    /// solution is guaranteed to be within a factor of w of the optimal cost.
+    /// The bound that was actually achieved is reported by
+    /// last_suboptimality_bound(). The default is 1.0, which gives optimal
+    /// solutions.
+    ///
+    /// \throws std::invalid_argument if the weight is less than 1.0
+    Options& heuristic_weight(double value);
+
+    /// Get the weight that the optimal search applies to its heuristic
+    double heuristic_weight() const;
+
+    /// Set the largest number of nodes that the optimal search may keep in its
+    /// open list. Whenever the limit is exceeded, the worst half of the open
+    /// list is dropped, and the filter of nodes that have already been seen
+    /// is cleared whenever it holds more than twice the limit, which bounds
+    /// the memory used by the search. A cleared filter may let the search
+    /// explore some nodes again. If that leaves the search without a
+    /// solution, it degrades to a greedy solution. The effect on the quality
+    /// of the solution is reflected in last_suboptimality_bound(). A value of
+    /// 0 means there is no limit, which is the default.
+    Options& max_open_nodes(std::size_t value);
+
+    /// Get the largest number of nodes that the optimal search may keep open
+    std::size_t max_open_nodes() const;
+
+    /// Set the type of filter that the optimal search uses to skip duplicate
+    /// nodes. The default is FilterType::Hash.
+    Options& filter_type(FilterType value);
+
+    /// Get the type of filter that the optimal search uses
+    FilterType filter_type() const;
+
+    /// Set how the optimal search orders nodes with the same cost estimate.
+    /// Preferring deeper nodes tends to reach a complete solution sooner when
+    /// many nodes tie. The default is TieBreak::None.
+    Options& tie_break(TieBreak value);
+
+    /// Get how the optimal search orders nodes with the same cost estimate
+    TieBreak tie_break() const;
+
+    /// Set whether the optimal search should expand its nodes partially. When
+    /// a node is expanded, only the children whose cost estimate is within
+    /// the margin of the node's own are put in the open list. The node goes
+    /// back into the open list in place of the rest, and they are only added
+    /// once the search reaches their cost. Most children of a large search are
+    /// never explored, so this keeps far fewer nodes in memory, but a node may
+    /// have to be expanded more than once. It has no effect on an anytime
+    /// search. The default is std::nullopt, which expands every node fully.
+    ///
+    /// 	hrows std::invalid_argument if the margin is negative
+    Options& partial_expansion(std::optional<double> margin);
+
+    /// Get the margin of partial expansion, if it is enabled
+    std::optional<double> partial_expansion() const;
+
+    /// Set whether the planner should split the problem into independent
+    /// clusters before searching. Two agents belong to the same cluster when
+    /// some request can be performed by both of them, e.g. because they share
+    /// a connected part of the navigation graph. Each cluster is then planned
+    /// concurrently and the results are merged. Requests that are separated
+    /// in time are already planned one segment at a time. Priorities are only
+    /// balanced between agents of the same cluster. The default is false.
+    Options& decompose(bool value);
+
+    /// Get whether the planner will split the problem into clusters
+    bool decompose() const;
+
+    /// Set whether the optimal search should start from a quick greedy
+    /// solution and discard any node whose cost estimate cannot beat the best
+    /// solution found so far. The bound tightens each time a cheaper complete
+    /// solution is generated. This keeps the open list small on large problems
+    /// and the solution remains optimal, although a different assignment of
+    /// equal cost may be chosen. The default is false.
+    Options& branch_and_bound(bool value);
+
+    /// Get whether the optimal search will prune against an upper bound
+    bool branch_and_bound() const;
+
+    /// Set whether the optimal search should treat agents with equivalent
+    /// initial states as interchangeable. Agents are equivalent when they
+    /// share the same waypoint, orientation, time and charger, and their
+    /// battery levels differ by no more than symmetry_tolerance(). While
+    /// several equivalent agents are idle, only the one with the lowest index
+    /// is given a new assignment, so equivalent branches of the search are
+    /// expanded only once. The default is false.
+    Options& symmetry_breaking(bool value);
+
+    /// Get whether the optimal search will skip equivalent agents
+    bool symmetry_breaking() const;
+
+    /// Set the largest difference in battery state of charge between two
+    /// agents that are still considered equivalent for symmetry_breaking().
+    /// The solution remains optimal with the default of 0.0. A larger value
+    /// merges more agents, but the planner may then choose an agent that
+    /// has slightly less battery than an equivalent one.
+    Options& symmetry_tolerance(double value);
+
+    /// Get the tolerance on battery levels for equivalent agents
+    double symmetry_tolerance() const;
+
+    /// Set how long the planner should try to improve the solution of each
+    /// planning segment after it has been found by the greedy, optimal or
+    /// anytime search. The refinement repeatedly removes a few tasks that
+    /// finish close together in time or space, keeps the rest of the
+    /// assignments, and reinserts the removed tasks with an exact search. A
+    /// change is kept only if it lowers the cost of the plan. This gives
+    /// better plans for problems that are too large for the optimal search.
+    /// The default is std::nullopt, which means no refinement.
+    Options& refinement_time(std::optional<rmf_traffic::Duration> value);
+
+    /// Get how long the planner will refine the solution of each segment
+    std::optional<rmf_traffic::Duration> refinement_time() const;
+
+    /// Set how many threads refine each solution concurrently. A value of 0
+    /// uses one thread per hardware thread. The default is 1.
+    Options& refinement_threads(std::size_t value);
+
+    /// Get how many threads refine each solution concurrently
+    std::size_t refinement_threads() const;
+
+    /// Set a callback that receives the assignments of each planning segment
+    /// as soon as that segment has been solved, before the planner moves on
+    /// to the next one. Requests that start far apart in time are planned in
+    /// separate segments, so a dispatcher can act on the first assignments
+    /// without waiting for the whole horizon to be planned. Each call holds
+    /// the assignments that the segment added for every agent. The callback
+    /// runs on the thread that called plan(), so run plan() on another thread
+    /// to keep planning in the background. Finishing requests only appear in
+    /// the final result. With decompose(), the merged plan is passed to the
+    /// callback once. The default is nullptr.
+    Options& segment_callback(SegmentCallback callback);
+
+    /// Get the callback that receives the assignments of each segment
+    const SegmentCallback& segment_callback() const;
+
+    /// Set a file that each plan() or replan() call should write its inputs
+    /// to before it starts planning: the time, the initial states, the
+    /// requests, these options and the configuration of the planner. The
+    /// replay_task_planner tool can load the file and run the same plan again,
+    /// e.g. under a profiler. Inputs that the file cannot represent, like
+    /// custom task descriptions or power sinks, are recorded as unsupported.
+    /// If the file cannot be opened, the plan proceeds without it. An empty
+    /// path, which is the default, turns off the capture.
+    Options& capture_path(std::string value);
+
+    /// Get the file that plan inputs are written to
+    const std::string& capture_path() const;
+
+    /// Set how many of the first previous assignments of each agent replan()
+    /// keeps as they are, such as the assignment that the agent is already
+    /// executing. Their requests are left out of the search, and the rest of
+    /// the assignments of the agent are planned from the finish state of its
+    /// last pinned assignment. An assignment whose request is cancelled or
+    /// replaced by a new request is never pinned, and neither is anything
+    /// after it. This has no effect on plan(). The default is 0.
+    Options& pinned_assignments(std::size_t value);
+
+    /// Get how many of the first previous assignments of each agent are kept
+    std::size_t pinned_assignments() const;
+
+    /// Set a time before which replan() keeps the previous assignments of each
+    /// agent as they are. A previous assignment is pinned if its deployment
+    /// time is before the horizon and every assignment before it on the same
+    /// agent is pinned as well. This is combined with pinned_assignments(), so
+    /// an assignment is pinned if either of them pins it. The default is
+    /// std::nullopt, which pins nothing.
+    Options& pinned_horizon(std::optional<rmf_traffic::Time> value);
+
+    /// Get the time before which previous assignments are kept
+    std::optional<rmf_traffic::Time> pinned_horizon() const;
+
+    /// Set how far ahead of the time of a plan the requests get planned
+    /// properly. The planning segments whose requests all start later than
+    /// this are only assigned greedily, as placeholders that later replans
+    /// will improve on as the horizon slides forward. This keeps the time of
+    /// a plan bounded when there is a long backlog of scheduled requests. The
+    /// suboptimality bound of a plan with placeholders is unknown. The default
+    /// is std::nullopt, which plans every segment properly.
+    Options& planning_horizon(std::optional<rmf_traffic::Duration> value);
+
+    /// Get how far ahead the requests get planned properly
+    std::optional<rmf_traffic::Duration> planning_horizon() const;
+
+    /// Set whether the parallel modes must give the same assignments every
+    /// time that they are given the same problem. Expanding nodes and
+    /// preparing the requests on several threads already do. With this on,
+    /// solutions of equal cost are ordered by the internal IDs of the tasks
+    /// of each agent, ties in the open list go to the node that was generated
+    /// first, the portfolio greedy search stops feeding its bound to the
+    /// optimal search while it runs, and the refinement threads work in
+    /// rounds whose results are combined in the order of the threads. Time
+    /// budgets and interrupters still decide how much work gets done before
+    /// they stop the plan, and a round of refinement is only checked against
+    /// the refinement time once it is over. This is off by default.
+    Options& deterministic(bool value);
+
+    /// Get whether the parallel modes give reproducible assignments
+    bool deterministic() const;
+
+    /// Set how many candidate plans an approximate search hands over to be
+    /// estimated exactly. With a value above 0, the search of each segment is
+    /// done with TravelEstimator::straight_line() estimates, so it never
+    /// waits for a path to be planned, and it keeps going until it has found
+    /// this many of its cheapest complete plans. Only those candidates are
+    /// estimated again with the travel estimator of the configuration, and
+    /// the one whose exact cost is lowest is used. The suboptimality bound of
+    /// such a plan is unknown. This is ignored by the greedy, auction and
+    /// portfolio modes. The default is 0, which searches with exact estimates.
+    Options& approximate_candidates(std::size_t value);
+
+    /// Get how many candidates an approximate search hands over
+    std::size_t approximate_candidates() const;
+
+    /// Set whether nearby planning segments should be merged. A request only
+    /// joins the segment that is being planned if it may begin within a
+    /// window of the latest time that the agents reach in that segment. The
+    /// window is normally one second, so requests that are staggered by a few
+    /// seconds can each end up in a tiny segment of their own, and every
+    /// segment pays for a new initial node and a new search. With this on,
+    /// the window of each segment grows to the median duration of the tasks
+    /// that remain, so a request that begins within about one task of the
+    /// latest time is planned together with the segment. Larger segments give
+    /// the search more to choose from, so this may also change the plan. The
+    /// default is false.
+    Options& adaptive_segmentation(bool value);
+
+    /// Get whether nearby planning segments are merged
+    bool adaptive_segmentation() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -165,7 +617,9 @@ public:
     class Implementation;
 
   private:
-    rmf_utils::impl_ptr<Implementation> _pimpl;
+    // Assignments never change once they are made, so copies share the same
+    // implementation
+    std::shared_ptr<const Implementation> _pimpl;
   };
 
   enum class TaskPlannerError
@@ -179,13 +633,211 @@ public:
     /// capacity to accommodate one or more requests. This may be remedied by
     /// increasing the battery capacity or by lowering the threshold_soc in the
     /// state configs of the agents or by modifying the original request.
-    limited_capacity
+    limited_capacity,
+
+    /// The dependencies between the bookings of the requests form a cycle, so
+    /// none of the requests in that cycle could ever begin.
+    cyclic_dependencies
   };
 
-  /// Container for assignments for each agent
-  using Assignments = std::vector<std::vector<Assignment>>;
   using Result = std::variant<Assignments, TaskPlannerError>;
 
+  /// Statistics that describe the work done by a call to plan() or replan()
+  struct Statistics
+  {
+    /// Number of nodes that the searches expanded
+    std::size_t nodes_expanded = 0;
+
+    /// Number of child nodes that the searches generated, including the ones
+    /// that were rejected by the filter
+    std::size_t nodes_generated = 0;
+
+    /// Number of generated nodes that the filter rejected as duplicates
+    std::size_t filter_rejections = 0;
+
+    /// The largest size that the open list of the optimal search reached
+    std::size_t peak_open_nodes = 0;
+
+    /// Number of planning segments that the requests were split into
+    std::size_t segments = 0;
+
+    /// Number of those segments that were beyond the planning horizon and
+    /// were only assigned greedily
+    std::size_t deferred_segments = 0;
+
+    /// Number of times that a task model was asked to estimate its finish
+    std::size_t estimate_finish_calls = 0;
+
+    /// Number of requests that shared the model and the candidates of an
+    /// equivalent request of the same plan() call instead of being estimated
+    /// on their own. Requests are equivalent when their descriptions have the
+    /// same type and Task::Description::model_hash() and they have the same
+    /// earliest start time.
+    std::size_t grouped_requests = 0;
+
+    /// Number of candidate estimates that a segment kept from the segment
+    /// before it instead of estimating them again. The candidates of an agent
+    /// that was not assigned anything in a segment still apply to the next
+    /// segment.
+    std::size_t carried_candidates = 0;
+
+    /// Number of travel estimates that were answered from the memoized results
+    std::size_t travel_estimator_hits = 0;
+
+    /// Number of travel estimates that needed a new travel plan
+    std::size_t travel_estimator_misses = 0;
+
+    /// Number of requests whose model was reused from an equivalent request
+    /// of an earlier plan() call
+    std::size_t model_cache_hits = 0;
+
+    /// Number of requests whose model had to be made because no equivalent
+    /// model was cached
+    std::size_t model_cache_misses = 0;
+
+    /// Time spent building the initial node of each segment
+    rmf_traffic::Duration initialization_time = rmf_traffic::Duration(0);
+
+    /// Time spent searching
+    rmf_traffic::Duration search_time = rmf_traffic::Duration(0);
+
+    /// Time spent appending the finishing request
+    rmf_traffic::Duration finishing_time = rmf_traffic::Duration(0);
+
+    /// Bytes allocated for search nodes, including their tables of pending
+    /// tasks. The lists of assignments that nodes share with each other are
+    /// not included.
+    std::size_t node_bytes = 0;
+
+    /// Bytes allocated for the candidate tables of the pending tasks
+    std::size_t candidate_bytes = 0;
+
+    /// The most bytes that the duplicate filter of any search was using
+    std::size_t filter_bytes = 0;
+
+    /// The most bytes that the open list of any optimal search was using
+    std::size_t open_list_bytes = 0;
+
+    /// The bytes of nodes and candidate tables for each generated node, which
+    /// estimates how much memory each node in a search costs
+    double bytes_per_node = 0.0;
+
+    /// Whether the result was taken from the plan cache. When it was, the
+    /// other statistics are all zero.
+    bool plan_cache_hit = false;
+  };
+
+  /// The best place to insert one new request into a set of assignments, as
+  /// found by evaluate_insertion()
+  struct Insertion
+  {
+    /// The agent whose assignments the request is inserted into
+    std::size_t agent;
+
+    /// The index within the assignments of the agent where the request is
+    /// inserted
+    std::size_t position;
+
+    /// The cost of the assignments after the insertion
+    double cost;
+
+    /// How much the insertion adds to the cost of the current assignments
+    double additional_cost;
+
+    /// The assignments after the insertion. The assignments that come after
+    /// the new request on the same agent have their finish states estimated
+    /// again.
+    Assignments assignments;
+  };
+
+  /// How one set of assignments differs from an earlier one, such as the
+  /// results of consecutive plans, as found by diff(). Requests are matched by
+  /// their booking ID. Charging tasks get new IDs every time they are
+  /// planned, so they are matched by their position instead.
+  struct AssignmentDiff
+  {
+    enum class Kind
+    {
+      /// The request was assigned to the same agent before, but at another
+      /// position
+      Shifted,
+
+      /// The request was assigned to another agent before
+      Moved,
+
+      /// The request was not assigned to any agent before
+      Added,
+
+      /// A charging task that does not match one from before
+      Charger
+    };
+
+    struct Change
+    {
+      /// What happened to the assignment
+      Kind kind;
+
+      /// The index of the assignment within the new assignments of the agent
+      std::size_t index;
+
+      /// The agent and index of the assignment within the previous
+      /// assignments, for Shifted and Moved assignments
+      std::optional<std::size_t> previous_agent;
+      std::optional<std::size_t> previous_index;
+    };
+
+    struct Agent
+    {
+      /// How many of the first assignments of the agent are the same in both
+      /// sets and in the same order. These can be left as they are.
+      std::size_t unchanged_prefix = 0;
+
+      /// Every new assignment of the agent after the unchanged prefix, in
+      /// order
+      std::vector<Change> changes;
+
+      /// The indices of the previous assignments of the agent after the
+      /// unchanged prefix that the agent no longer has anywhere, because
+      /// they were moved to another agent or dropped, or because they were
+      /// charging tasks that are not needed anymore
+      std::vector<std::size_t> removed;
+    };
+
+    /// The differences of each agent. There is one for every agent of the new
+    /// assignments.
+    std::vector<Agent> agents;
+
+    /// True if nothing changed
+    bool empty() const;
+  };
+
+  /// A handle to a plan that is running in the background, as started by
+  /// plan_async(). Copies of the handle refer to the same plan.
+  class AsyncPlan
+  {
+  public:
+
+    /// Get the result of the plan. This can be waited on, or checked for
+    /// readiness, from any thread. If the plan throws an exception, the
+    /// future holds the exception.
+    const std::shared_future<Result>& result() const;
+
+    /// Ask the plan to stop as soon as possible. The planner checks for this
+    /// in the same places that it checks Options::time_budget(), so the
+    /// result is whatever the planner produces when its time budget runs out.
+    /// Waiting on the result is still needed to know when the plan has
+    /// stopped. The result of a cancelled plan is never cached.
+    void cancel();
+
+    /// Check whether cancel() has been called
+    bool cancelled() const;
+
+    class Implementation;
+  private:
+    AsyncPlan();
+    std::shared_ptr<Implementation> _pimpl;
+  };
+
   /// Constructor
   ///
   /// \param[in] configuration
@@ -227,6 +879,16 @@ public:
   /// Generate assignments for requests among available agents. The default
   /// Options of this TaskPlanner instance will be used.
   ///
+  /// The agents and requests are taken by value and are not copied again
+  /// while planning, so callers that no longer need them can pass them with
+  /// std::move to avoid copying them at all.
+  ///
+  /// Each call keeps the state of its search to itself, so plan() and
+  /// replan() may be called from several threads at once on the same
+  /// TaskPlanner, e.g. to evaluate several bids. The calls share the travel
+  /// estimates and the model and plan caches. The default options must not be
+  /// changed while any call is in progress.
+  ///
   /// \param[in] time_now
   ///   The current time when this plan is requested
   ///
@@ -261,9 +923,179 @@ public:
     std::vector<ConstRequestPtr> requests,
     Options options);
 
+  /// Generate new assignments after the previous assignments have changed,
+  /// using the default Options of this TaskPlanner. The search is seeded with
+  /// the previous assignments, so that only the parts of the plan that are
+  /// affected by the changes need to be worked out again.
+  ///
+  /// \param[in] time_now
+  ///   The current time when this plan is requested
+  ///
+  /// \param[in] agents
+  ///   The latest states of the agents/AGVs that can undertake the requests
+  ///
+  /// \param[in] previous
+  ///   The assignments that were produced by the previous plan. Automatic
+  ///   requests, such as charging, will be left out and added again if needed.
+  ///
+  /// \param[in] new_requests
+  ///   Requests that have arrived since the previous plan. These replace any
+  ///   previous request with the same ID.
+  ///
+  /// \param[in] cancelled_requests
+  ///   IDs of previous requests that should no longer be assigned
+  Result replan(
+    rmf_traffic::Time time_now,
+    std::vector<State> agents,
+    const Assignments& previous,
+    std::vector<ConstRequestPtr> new_requests,
+    const std::unordered_set<std::string>& cancelled_requests = {});
+
+  /// Generate new assignments after the previous assignments have changed.
+  /// Override the default parameters.
+  ///
+  /// \param[in] time_now
+  ///   The current time when this plan is requested
+  ///
+  /// \param[in] agents
+  ///   The latest states of the agents/AGVs that can undertake the requests
+  ///
+  /// \param[in] previous
+  ///   The assignments that were produced by the previous plan. Automatic
+  ///   requests, such as charging, will be left out and added again if needed.
+  ///
+  /// \param[in] new_requests
+  ///   Requests that have arrived since the previous plan. These replace any
+  ///   previous request with the same ID.
+  ///
+  /// \param[in] cancelled_requests
+  ///   IDs of previous requests that should no longer be assigned
+  ///
+  /// \param[in] options
+  ///   The options to use for this plan. This overrides the default Options of
+  ///   the TaskPlanner instance
+  Result replan(
+    rmf_traffic::Time time_now,
+    std::vector<State> agents,
+    const Assignments& previous,
+    std::vector<ConstRequestPtr> new_requests,
+    const std::unordered_set<std::string>& cancelled_requests,
+    Options options);
+
+  /// Start planning in the background and return right away. The plan is run
+  /// by a copy of this planner on a pool of threads that is owned by this
+  /// planner and its copies, so several plans, e.g. for different fleets, can
+  /// run at the same time without blocking the thread that started them. The
+  /// copy shares the memoized travel estimates and the model and plan caches
+  /// of this planner, but last_statistics() and last_suboptimality_bound() of
+  /// this planner are not changed by the plan. Destroying the last copy of
+  /// this planner waits for its background plans to finish, so cancel them
+  /// first if their results are no longer needed.
+  ///
+  /// \param[in] time_now
+  ///   The current time when this plan is requested
+  ///
+  /// \param[in] agents
+  ///   The initial states of the agents/AGVs that can undertake the requests
+  ///
+  /// \param[in] requests
+  ///   The set of requests that need to be assigned among the agents/AGVs
+  ///
+  /// \param[in] options
+  ///   The options to use for this plan. If this is std::nullopt, the default
+  ///   Options of this planner are used.
+  ///
+  /// \param[in] progress
+  ///   A callback that receives the assignments of each planning segment as
+  ///   soon as it has been solved. It runs on the thread of the plan, in
+  ///   addition to any Options::segment_callback().
+  AsyncPlan plan_async(
+    rmf_traffic::Time time_now,
+    std::vector<State> agents,
+    std::vector<ConstRequestPtr> requests,
+    std::optional<Options> options = std::nullopt,
+    Options::SegmentCallback progress = nullptr) const;
+
+  /// Get the suboptimality bound of the assignments that were produced by the
+  /// most recent call to plan() that finished. The cost of those assignments
+  /// is at most this many times the optimal cost, so a value of 1.0 means
+  /// they are optimal.
+  /// This will be std::nullopt if the most recent plan did not produce any
+  /// assignments or if no bound is known, such as for a greedy plan.
+  std::optional<double> last_suboptimality_bound() const;
+
+  /// Get the statistics of the most recent call to plan() or replan() that
+  /// finished
+  Statistics last_statistics() const;
+
   /// Compute the cost of a set of assignments
   double compute_cost(const Assignments& assignments) const;
 
+  /// Compute the cost of many sets of assignments at once, such as the
+  /// candidate assignments of several bids. The sets are read through the
+  /// pointers without being copied, and the cost of assignments[i] is placed
+  /// at index i of the result. None of the pointers may be null.
+  ///
+  /// \param[in] assignments
+  ///   The sets of assignments to evaluate
+  ///
+  /// \param[in] num_threads
+  ///   The number of threads to evaluate the sets with. A value of 0 uses the
+  ///   hardware concurrency. When more than one thread is used, the cost
+  ///   calculator of the configuration must be safe to call concurrently.
+  std::vector<double> compute_costs(
+    const std::vector<const Assignments*>& assignments,
+    std::size_t num_threads = 1) const;
+
+  /// Find the cheapest way to insert one new request into a set of existing
+  /// assignments without planning them again, such as when bidding for the
+  /// request. Every position of every agent is tried by estimating the finish
+  /// of the new request from the state that the agent is in at that position,
+  /// and then estimating the finish of the assignments that follow it. The
+  /// assignments that come before the position are kept as they are.
+  ///
+  /// Unlike plan(), this will not add charging tasks to make room for the
+  /// request, so a position is skipped if the battery of the agent would run
+  /// too low anywhere along it.
+  ///
+  /// \param[in] time_now
+  ///   The current time. No task will be estimated to start before it.
+  ///
+  /// \param[in] agents
+  ///   The initial states of the agents, in the same order as the assignments
+  ///
+  /// \param[in] current_assignments
+  ///   The assignments that the request should be inserted into
+  ///
+  /// \param[in] new_request
+  ///   The request to insert
+  ///
+  /// \throws std::invalid_argument if there is not one set of assignments for
+  ///   each agent.
+  ///
+  /// \return the cheapest insertion, or std::nullopt if the request cannot be
+  ///   inserted anywhere.
+  std::optional<Insertion> evaluate_insertion(
+    rmf_traffic::Time time_now,
+    const std::vector<State>& agents,
+    const Assignments& current_assignments,
+    ConstRequestPtr new_request) const;
+
+  /// Find the smallest set of changes that turns the previous assignments
+  /// into the next ones, so that only the tasks that changed need to be
+  /// cancelled or activated again. This takes time proportional to the total
+  /// number of assignments.
+  ///
+  /// \param[in] previous
+  ///   The earlier assignments, e.g. from the previous plan
+  ///
+  /// \param[in] next
+  ///   The later assignments. Agents that are not in the previous assignments
+  ///   have no assignments to keep.
+  static AssignmentDiff diff(
+    const Assignments& previous,
+    const Assignments& next);
+
   class Implementation;
 
 private:
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__TIMERWHEEL_HPP
+#define RMF_TASK__TIMERWHEEL_HPP
+
+#include <rmf_traffic/Time.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace rmf_task {
+
+//==============================================================================
+/// A hierarchical timer wheel. Arming and canceling a timer take constant
+/// time no matter how many timers are armed, and all of the timers that
+/// expire during the same tick are fired together as one batch.
+///
+/// A wheel that is constructed directly only moves forward when advance(~) is
+/// called. The shared() wheel is moved forward by a background thread that
+/// only wakes up while some timer is armed, so any number of waiting events
+/// cost one thread and at most one wakeup per tick between them.
+///
+/// Every function of this class is thread-safe. Callbacks are run without any
+/// lock held, so they may arm or cancel timers, but they should return quickly
+/// and must not throw.
+class TimerWheel
+{
+public:
+
+  using Callback = std::function<void()>;
+
+  /// Identifies an armed timer so that it can be canceled
+  using Id = uint64_t;
+
+  /// Constructor
+  ///
+  /// \param[in] resolution
+  ///   The length of one tick of the wheel. Timers fire on the first tick at
+  ///   or after their delay, so this is how late a timer may fire.
+  explicit TimerWheel(
+    rmf_traffic::Duration resolution = std::chrono::milliseconds(10));
+
+  /// Get the wheel that is shared by the whole process and driven by a
+  /// background thread. Its resolution is 10ms and its timers never fire
+  /// before their delay has passed.
+  static TimerWheel& shared();
+
+  /// Arm a timer
+  ///
+  /// \param[in] delay
+  ///   How long until the timer fires. A timer always waits for at least one
+  ///   tick, even if this is zero or negative.
+  ///
+  /// \param[in] callback
+  ///   The callback that the timer fires
+  ///
+  /// \return the ID of the timer, which can be used to cancel it.
+  Id arm(rmf_traffic::Duration delay, Callback callback);
+
+  /// Cancel a timer before it fires
+  ///
+  /// \return true if the timer was still armed. False if it has already fired
+  /// or been canceled.
+  bool cancel(Id id);
+
+  /// Move the wheel forward and fire the timers that expire along the way.
+  /// This is not needed for the shared() wheel.
+  ///
+  /// \param[in] ticks
+  ///   How many ticks to move forward
+  ///
+  /// \return the number of timers that fired.
+  std::size_t advance(std::size_t ticks = 1);
+
+  /// The number of timers that are armed
+  std::size_t size() const;
+
+  /// The length of one tick
+  rmf_traffic::Duration resolution() const;
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__TIMERWHEEL_HPP
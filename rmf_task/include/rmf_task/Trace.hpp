@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__TRACE_HPP
+#define RMF_TASK__TRACE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Records scoped spans of time from any thread of the process so that they
+/// can be viewed together on one timeline. The spans are written in the
+/// Chrome trace event format, which can be opened by Perfetto
+/// (ui.perfetto.dev) or chrome://tracing.
+///
+/// The planner and the task execution utilities only open their own spans if
+/// this library was built with the RMF_TASK_ENABLE_TRACING CMake option.
+/// Otherwise those spans are compiled out entirely. Spans that are opened
+/// explicitly with Trace::Span are always available. Either way, nothing is
+/// recorded until start() is called.
+class Trace
+{
+public:
+
+  /// True if this library was built with its own spans
+  static bool available();
+
+  /// Begin recording spans. Any spans from an earlier recording are
+  /// discarded.
+  static void start();
+
+  /// Stop recording spans. The spans that were recorded are kept until the
+  /// next start().
+  static void stop();
+
+  /// True if spans are being recorded
+  static bool recording();
+
+  /// The number of spans that have been recorded
+  static std::size_t size();
+
+  /// Get the recorded spans as a Chrome trace JSON document
+  static std::string chrome_json();
+
+  /// Write chrome_json() to a file
+  ///
+  /// \throws std::runtime_error if the file cannot be written.
+  static void write(const std::string& path);
+
+  class Span;
+};
+
+//==============================================================================
+/// A span of time that lasts from its construction until its destruction. It
+/// is only recorded if recording was already on when it was constructed and
+/// is still on when it is destroyed.
+class Trace::Span
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] name
+  ///   The name of the span. This is not copied, so it should be a string
+  ///   literal.
+  ///
+  /// \param[in] category
+  ///   The category of the span. This is not copied either.
+  Span(const char* name, const char* category = "rmf_task");
+
+  ~Span();
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+private:
+  const char* _name;
+  const char* _category;
+  bool _active;
+  std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace rmf_task
+
+// Open a span that lasts until the end of the current scope, only if the code
+// is built with RMF_TASK_TRACING defined
+#ifdef RMF_TASK_TRACING
+#define RMF_TASK_TRACE_CONCAT_IMPL(a, b) a ## b
+#define RMF_TASK_TRACE_CONCAT(a, b) RMF_TASK_TRACE_CONCAT_IMPL(a, b)
+#define RMF_TASK_TRACE_SPAN(name) \
+  const ::rmf_task::Trace::Span RMF_TASK_TRACE_CONCAT( \
+    rmf_task_trace_span_, __LINE__)(name)
+#else
+#define RMF_TASK_TRACE_SPAN(name)
+#endif
+
+#endif // RMF_TASK__TRACE_HPP
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__TRAVELPROFILE_HPP
+#define RMF_TASK__TRAVELPROFILE_HPP
+
+#include <memory>
+#include <optional>
+
+#include <rmf_traffic/Time.hpp>
+#include <rmf_traffic/Trajectory.hpp>
+#include <rmf_utils/impl_ptr.hpp>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Travel estimates that depend on the time of day, e.g. because corridors
+/// are congested during shift changes. The day is split into buckets of equal
+/// length, and each pair of waypoints keeps a travel duration and battery
+/// drain for each bucket. The values can be supplied offline with set() or
+/// learned from executed trips with record().
+///
+/// Give a profile to TravelEstimator::profile() so that each estimate which
+/// departs within a bucket that has a value is answered from the profile.
+/// Estimates for every other bucket are calculated as usual.
+///
+/// A profile may be read and updated from several threads at once.
+class TravelProfile
+{
+public:
+
+  /// The values of one bucket of a pair of waypoints
+  struct Entry
+  {
+    /// How long the travelling takes
+    rmf_traffic::Duration duration;
+
+    /// How much the battery drains while travelling
+    double change_in_charge;
+
+    /// How many trips the values are the mean of. Values that were supplied
+    /// with set() count as one trip.
+    std::size_t samples;
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] num_buckets
+  ///   The number of buckets that each day is split into
+  ///
+  /// \param[in] midnight
+  ///   Any time when a day begins. rmf_traffic::Time has no calendar, so this
+  ///   is what times are measured against to find their time of day.
+  ///
+  /// \throws std::invalid_argument if num_buckets is zero.
+  TravelProfile(std::size_t num_buckets, rmf_traffic::Time midnight);
+
+  /// The number of buckets that each day is split into
+  std::size_t num_buckets() const;
+
+  /// The length of time that each bucket covers
+  rmf_traffic::Duration bucket_length() const;
+
+  /// The bucket that a time falls into
+  std::size_t bucket(rmf_traffic::Time time) const;
+
+  /// Supply the values of one bucket of a pair of waypoints, replacing any
+  /// values that were supplied or learned for it before.
+  ///
+  /// \throws std::out_of_range if the bucket is not less than num_buckets().
+  TravelProfile& set(
+    std::size_t start_waypoint,
+    std::size_t goal_waypoint,
+    std::size_t bucket,
+    rmf_traffic::Duration duration,
+    double change_in_charge);
+
+  /// Learn from a trip that was executed. The values of the bucket of its
+  /// departure become the mean of every trip that was recorded for it.
+  TravelProfile& record(
+    std::size_t start_waypoint,
+    std::size_t goal_waypoint,
+    rmf_traffic::Time departure,
+    rmf_traffic::Duration duration,
+    double change_in_charge);
+
+  /// Learn from a trajectory that was executed between two waypoints. The
+  /// trip departs at the start of the trajectory and lasts until its finish.
+  /// Trajectories with fewer than two waypoints are ignored.
+  TravelProfile& record(
+    std::size_t start_waypoint,
+    std::size_t goal_waypoint,
+    const rmf_traffic::Trajectory& trajectory,
+    double change_in_charge);
+
+  /// Get the values for a trip that departs at a certain time, if its bucket
+  /// has any
+  std::optional<Entry> find(
+    std::size_t start_waypoint,
+    std::size_t goal_waypoint,
+    rmf_traffic::Time departure) const;
+
+  /// The number of pairs of waypoints that have values for any bucket
+  std::size_t num_pairs() const;
+
+  /// The approximate number of bytes that the values use
+  std::size_t memory() const;
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+using TravelProfilePtr = std::shared_ptr<TravelProfile>;
+using ConstTravelProfilePtr = std::shared_ptr<const TravelProfile>;
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__TRAVELPROFILE_HPP
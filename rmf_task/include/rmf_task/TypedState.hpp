@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__TYPEDSTATE_HPP
+#define RMF_TASK__TYPEDSTATE_HPP
+
+#include <rmf_task/State.hpp>
+#include <rmf_task/Task.hpp>
+
+#include <optional>
+#include <tuple>
+
+namespace rmf_task {
+
+//==============================================================================
+/// A state whose set of components is fixed at compile time. The components
+/// are stored in a plain struct, each with a flag for whether it is present,
+/// so reading and writing them can be inlined instead of going through the
+/// type erasure of State. Each component type may only appear once.
+///
+/// A TypedState can be made from a State and converted back into one. Any
+/// components of the State that are not part of the schema are ignored.
+template<typename... Components>
+class TypedState
+{
+public:
+
+  /// Create a TypedState without any components
+  TypedState() = default;
+
+  /// Copy the components of the schema that are present in a State
+  static TypedState from(const State& state);
+
+  /// Make a State that has the components which are present in this
+  /// TypedState
+  State to_state() const;
+
+  /// Write the components which are present in this TypedState into a State,
+  /// overwriting the values that the State already has for them. Other
+  /// components of the State are left alone.
+  State& store_in(State& state) const;
+
+  /// True if the schema of this TypedState has a component of type T
+  template<typename T>
+  static constexpr bool has_component();
+
+  /// Get a reference to the component of type T if it is present, or a
+  /// nullptr if it is not.
+  template<typename T>
+  T* get();
+
+  /// Get an immutable reference to the component of type T if it is present,
+  /// or a nullptr if it is not.
+  template<typename T>
+  const T* get() const;
+
+  /// Set the value of the component of type T
+  template<typename T>
+  TypedState& with(T value);
+
+  /// Remove the component of type T. This will return true if it was
+  /// present.
+  template<typename T>
+  bool erase();
+
+private:
+  std::tuple<std::optional<Components>...> _components;
+};
+
+//==============================================================================
+/// A TypedState with the basic components that the task planner expects
+using BasicState = TypedState<
+  State::CurrentWaypoint,
+  State::CurrentOrientation,
+  State::CurrentTime,
+  State::DedicatedChargingPoint,
+  State::CurrentBatterySoC>;
+
+//==============================================================================
+/// A base class for task models that only need a fixed set of components.
+/// The initial state is converted into a TypedState before it is given to
+/// estimate_typed_finish(), and the finish state that it returns is converted
+/// back into a State, so the estimate itself works on plain data.
+template<typename... Components>
+class TypedModel : public Task::Model
+{
+public:
+
+  using TypedState = rmf_task::TypedState<Components...>;
+
+  /// The finish of a task that was estimated from a TypedState
+  struct TypedEstimate
+  {
+    /// The state of the robot once it completes the task
+    TypedState finish_state;
+
+    /// The ideal time for the robot to start the task
+    rmf_traffic::Time wait_until;
+  };
+
+  /// Estimate the state of the robot when the task is finished along with
+  /// the time the robot has to wait before commencing the task
+  virtual std::optional<TypedEstimate> estimate_typed_finish(
+    const TypedState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const = 0;
+
+  /// Calls estimate_typed_finish(). Only the components of the schema are
+  /// given to it, and only the components of the schema that it fills in are
+  /// part of the finish state.
+  std::optional<Estimate> estimate_finish(
+    const State& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const override;
+};
+
+} // namespace rmf_task
+
+#include <rmf_task/detail/impl_TypedState.hpp>
+
+#endif // RMF_TASK__TYPEDSTATE_HPP
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__UPDATECOALESCER_HPP
+#define RMF_TASK__UPDATECOALESCER_HPP
+
+#include <rmf_task/Phase.hpp>
+
+#include <rmf_traffic/Time.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace rmf_task {
+
+//==============================================================================
+/// Limit how often the phase snapshots of a task are delivered to its update
+/// callback. Notifications that arrive faster than the limit are held back,
+/// and only the most recent one is delivered once enough time has passed, so
+/// a burst of event changes results in a single snapshot of the latest state.
+///
+/// Held notifications are delivered from a background thread that is shared
+/// by every coalescer in the process, so update callbacks should return
+/// quickly. Deliveries are never concurrent with each other and always arrive
+/// in the order that they were notified. The update callback must not call
+/// back into the coalescer that is delivering to it.
+class UpdateCoalescer
+{
+public:
+
+  using Update = std::function<void(Phase::ConstSnapshotPtr)>;
+
+  /// A function that makes the snapshot of a notification. It is only called
+  /// if the notification gets delivered, which might happen on the background
+  /// thread.
+  using MakeSnapshot = std::function<Phase::ConstSnapshotPtr()>;
+
+  /// Constructor
+  ///
+  /// \param[in] update
+  ///   The callback that the snapshots are delivered to
+  ///
+  /// \param[in] minimum_period
+  ///   The least amount of time between two deliveries
+  UpdateCoalescer(Update update, rmf_traffic::Duration minimum_period);
+
+  /// Notify that the state has changed. If nothing has been delivered within
+  /// the minimum period then the snapshot is made and delivered right away on
+  /// this thread. Otherwise it replaces any notification that is being held
+  /// and will be delivered at the end of the period.
+  void notify(MakeSnapshot make_snapshot);
+
+  /// Notify with a snapshot that has already been made
+  void notify(Phase::ConstSnapshotPtr snapshot);
+
+  /// Deliver the notification that is being held, if there is one, right
+  /// away on this thread.
+  void flush();
+
+  /// The least amount of time between two deliveries
+  rmf_traffic::Duration minimum_period() const;
+
+  /// The number of notifications that were replaced by a newer one before
+  /// they could be delivered
+  std::size_t suppressed() const;
+
+  /// The number of snapshots that have been delivered
+  std::size_t delivered() const;
+
+  /// Any notification that is being held when the coalescer is destroyed will
+  /// not be delivered.
+  ~UpdateCoalescer();
+
+  UpdateCoalescer(const UpdateCoalescer&) = delete;
+  UpdateCoalescer& operator=(const UpdateCoalescer&) = delete;
+
+  class Implementation;
+private:
+  // Shared with the background thread while a notification is being held
+  std::shared_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__UPDATECOALESCER_HPP
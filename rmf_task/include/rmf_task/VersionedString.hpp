@@ -20,6 +20,8 @@
 
 #include <rmf_utils/impl_ptr.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace rmf_task {
@@ -38,7 +40,8 @@ public:
   ///   The initial value of this versioned string
   VersionedString(std::string initial_value);
 
-  /// Update the value of this versioned string
+  /// Update the value of this versioned string. This may be called while
+  /// other threads are getting views of this string.
   ///
   /// \param[in] new_value
   ///   The new value for this versioned string
@@ -47,6 +50,11 @@ public:
   /// Get a view of the current version of the string
   View view() const;
 
+  /// Get the number of the current version. This starts at 0 and increments
+  /// with every update. It is a single atomic load, so it can be polled from
+  /// other threads to cheaply check for changes.
+  uint64_t version() const;
+
   class Implementation;
 private:
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
@@ -62,6 +70,10 @@ private:
 class VersionedString::View
 {
 public:
+
+  /// The number of the version that this View contains
+  uint64_t version() const;
+
   class Implementation;
 private:
   View();
@@ -78,6 +90,10 @@ public:
 
   /// Read from the View.
   ///
+  /// A Reader compares the version numbers of the Views that it reads, so
+  /// checking a View that it has already seen is cheap. A single Reader must
+  /// not be used by several threads at once.
+  ///
   /// If this Reader has never seen this View before, then this function will
   /// return a reference to the string that the View contains. Otherwise, if
   /// this Reader has seen this View before, then this function will return a
@@ -21,15 +21,23 @@
 #include <rmf_utils/impl_ptr.hpp>
 
 #include <cstddef>
+#include <memory>
 #include <string>
 
 namespace rmf_task {
 namespace detail {
 
 //==============================================================================
+/// Backup data for a Task. The serialized state is held in an immutable buffer
+/// that every copy of the Backup shares, so a large backup is only built once
+/// no matter how many times it gets passed along before it is written.
 class Backup
 {
 public:
+
+  /// An immutable buffer holding the serialized state of a backup
+  using SharedState = std::shared_ptr<const std::string>;
+
   /// Make a Backup state
   ///
   /// \param[in] seq
@@ -42,6 +50,10 @@ public:
   ///   when restoring a Task.
   static Backup make(uint64_t seq, std::string state);
 
+  /// Make a Backup state that refers to a buffer which has already been
+  /// serialized. A null buffer is treated as an empty state.
+  static Backup make(uint64_t seq, SharedState state);
+
   /// Get the sequence number for this backup.
   uint64_t sequence() const;
 
@@ -51,6 +63,10 @@ public:
   /// Get the serialized state for this backup.
   const std::string& state() const;
 
+  /// Get the buffer that holds the serialized state for this backup. Holding
+  /// onto it keeps the state alive without copying it.
+  const SharedState& shared_state() const;
+
   /// Set the serialized state for this backup.
   Backup& state(std::string new_state);
 
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__DETAIL__TYPEREGISTRY_HPP
+#define RMF_TASK__DETAIL__TYPEREGISTRY_HPP
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <optional>
+#include <typeinfo>
+
+namespace rmf_task {
+namespace detail {
+
+//==============================================================================
+/// Gives each registered type a dense ID, counting up from zero, so that the
+/// handlers of the types can be kept in a vector and found by their ID.
+///
+/// Looking up a type normally hashes its type_index. Once the registry is
+/// frozen, lookups search a sorted array of type_info addresses instead, and
+/// only fall back to hashing for a type whose type_info lives at a different
+/// address, e.g. because it comes from another library.
+class TypeRegistry
+{
+public:
+
+  /// Make an empty registry
+  TypeRegistry();
+
+  /// Get the ID of a type, registering the type if it is new.
+  ///
+  /// \throws std::runtime_error if the type is new and the registry has been
+  /// frozen.
+  std::size_t insert(const std::type_info& type);
+
+  /// Get the ID of a type, or std::nullopt if it was never registered
+  std::optional<std::size_t> find(const std::type_info& type) const;
+
+  /// The number of registered types
+  std::size_t size() const;
+
+  /// Stop new types from being registered and switch lookups to the sorted
+  /// array. Types that are already registered can still be inserted again.
+  void freeze();
+
+  /// True if freeze() has been called
+  bool frozen() const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace detail
+} // namespace rmf_task
+
+#endif // RMF_TASK__DETAIL__TYPEREGISTRY_HPP
@@ -30,20 +30,37 @@ CompositeData::InsertResult<T> insertion_cast(
 {
   return {result.inserted, std::any_cast<T>(result.value)};
 }
+
+//==============================================================================
+/// Get the index that CompositeData stores a type under. Every type gets the
+/// same index in every library of the process.
+std::size_t composite_data_index(std::type_index type);
+
+//==============================================================================
+template<typename T>
+std::size_t composite_data_index()
+{
+  static const std::size_t index = composite_data_index(typeid(T));
+  return index;
+}
 } // namespace detail
 
 //==============================================================================
 template<typename T>
 auto CompositeData::insert(T&& value) -> InsertResult<T>
 {
-  return detail::insertion_cast<T>(_insert(std::any(std::move(value)), false));
+  return detail::insertion_cast<T>(
+    _insert(
+      detail::composite_data_index<T>(), std::any(std::move(value)), false));
 }
 
 //==============================================================================
 template<typename T>
 auto CompositeData::insert_or_assign(T&& value) -> InsertResult<T>
 {
-  return detail::insertion_cast<T>(_insert(std::any(std::move(value)), true));
+  return detail::insertion_cast<T>(
+    _insert(
+      detail::composite_data_index<T>(), std::any(std::move(value)), true));
 }
 
 //==============================================================================
@@ -58,21 +75,21 @@ CompositeData& CompositeData::with(T&& value)
 template<typename T>
 T* CompositeData::get()
 {
-  return std::any_cast<T>(_get(typeid(T)));
+  return std::any_cast<T>(_get(detail::composite_data_index<T>()));
 }
 
 //==============================================================================
 template<typename T>
 const T* CompositeData::get() const
 {
-  return std::any_cast<T>(_get(typeid(T)));
+  return std::any_cast<T>(_get(detail::composite_data_index<T>()));
 }
 
 //==============================================================================
 template<typename T>
 bool CompositeData::erase()
 {
-  return _erase(typeid(T));
+  return _erase(detail::composite_data_index<T>());
 }
 
 } // namespace rmf_task
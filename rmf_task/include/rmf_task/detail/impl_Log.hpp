@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__DETAIL__IMPL_LOG_HPP
+#define RMF_TASK__DETAIL__IMPL_LOG_HPP
+
+#include <rmf_task/Log.hpp>
+
+namespace rmf_task {
+
+//==============================================================================
+template<typename T, typename>
+Log::Argument::Argument(T value)
+{
+  if constexpr (std::is_signed_v<T>)
+    _value = static_cast<int64_t>(value);
+  else
+    _value = static_cast<uint64_t>(value);
+}
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__DETAIL__IMPL_LOG_HPP
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__DETAIL__IMPL_TYPEDSTATE_HPP
+#define RMF_TASK__DETAIL__IMPL_TYPEDSTATE_HPP
+
+#include <rmf_task/TypedState.hpp>
+
+#include <type_traits>
+
+namespace rmf_task {
+
+//==============================================================================
+template<typename... Components>
+auto TypedState<Components...>::from(const State& state) -> TypedState
+{
+  TypedState typed;
+  (
+    [&]()
+    {
+      if (const auto* component = state.get<Components>())
+        std::get<std::optional<Components>>(typed._components) = *component;
+    }(), ...);
+
+  return typed;
+}
+
+//==============================================================================
+template<typename... Components>
+State TypedState<Components...>::to_state() const
+{
+  State state;
+  store_in(state);
+  return state;
+}
+
+//==============================================================================
+template<typename... Components>
+State& TypedState<Components...>::store_in(State& state) const
+{
+  (
+    [&]()
+    {
+      if (const auto& component =
+      std::get<std::optional<Components>>(_components))
+      {
+        state.with(Components(*component));
+      }
+    }(), ...);
+
+  return state;
+}
+
+//==============================================================================
+template<typename... Components>
+template<typename T>
+constexpr bool TypedState<Components...>::has_component()
+{
+  return (std::is_same_v<T, Components> || ...);
+}
+
+//==============================================================================
+template<typename... Components>
+template<typename T>
+T* TypedState<Components...>::get()
+{
+  static_assert(
+    has_component<T>(), "The component is not part of this TypedState");
+
+  auto& component = std::get<std::optional<T>>(_components);
+  return component.has_value() ? &*component : nullptr;
+}
+
+//==============================================================================
+template<typename... Components>
+template<typename T>
+const T* TypedState<Components...>::get() const
+{
+  return const_cast<TypedState*>(this)->template get<T>();
+}
+
+//==============================================================================
+template<typename... Components>
+template<typename T>
+auto TypedState<Components...>::with(T value) -> TypedState&
+{
+  static_assert(
+    has_component<T>(), "The component is not part of this TypedState");
+
+  std::get<std::optional<T>>(_components) = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+template<typename... Components>
+template<typename T>
+bool TypedState<Components...>::erase()
+{
+  static_assert(
+    has_component<T>(), "The component is not part of this TypedState");
+
+  auto& component = std::get<std::optional<T>>(_components);
+  const bool present = component.has_value();
+  component.reset();
+  return present;
+}
+
+//==============================================================================
+template<typename... Components>
+std::optional<Estimate> TypedModel<Components...>::estimate_finish(
+  const State& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  const auto estimate = estimate_typed_finish(
+    TypedState::from(initial_state),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+} // namespace rmf_task
+
+#endif // RMF_TASK__DETAIL__IMPL_TYPEDSTATE_HPP
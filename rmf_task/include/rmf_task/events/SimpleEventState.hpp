@@ -55,7 +55,8 @@ public:
   // Documentation inherited
   Status status() const final;
 
-  /// Update the status of this event
+  /// Update the status of this event. Setting the status that the event
+  /// already has does not change its version().
   SimpleEventState& update_status(Status new_status);
 
   // Documentation inherited
@@ -86,6 +87,9 @@ public:
   /// Add one dependency to the state
   SimpleEventState& add_dependency(ConstStatePtr new_dependency);
 
+  // Documentation inherited
+  std::optional<uint64_t> version() const final;
+
   class Implementation;
 private:
   SimpleEventState();
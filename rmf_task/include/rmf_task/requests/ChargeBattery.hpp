@@ -61,6 +61,9 @@ public:
       rmf_traffic::Time earliest_start_time,
       const Parameters& parameters) const final;
 
+    // Documentation inherited
+    std::optional<std::size_t> model_hash() const final;
+
     // Documentation inherited
     Info generate_info(
       const State& initial_state,
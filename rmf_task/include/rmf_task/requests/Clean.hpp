@@ -61,6 +61,9 @@ public:
       rmf_traffic::Time earliest_start_time,
       const Parameters& parameters) const final;
 
+    // Documentation inherited
+    std::optional<std::size_t> model_hash() const final;
+
     // Documentation inherited
     Info generate_info(
       const State& initial_state,
@@ -72,6 +75,9 @@ public:
     /// Get the end waypoint in this request
     std::size_t end_waypoint() const;
 
+    /// Get the trajectory that the AGV follows while cleaning
+    const rmf_traffic::Trajectory& cleaning_path() const;
+
     class Implementation;
   private:
     Description();
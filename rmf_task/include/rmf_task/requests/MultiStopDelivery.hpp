@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__REQUESTS__MULTISTOPDELIVERY_HPP
+#define RMF_TASK__REQUESTS__MULTISTOPDELIVERY_HPP
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <rmf_traffic/Time.hpp>
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <rmf_task/State.hpp>
+#include <rmf_task/Request.hpp>
+#include <rmf_task/Estimate.hpp>
+#include <rmf_task/Payload.hpp>
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+/// A class that generates a Request which requires an AGV to pick up items
+/// from one location and then drop them off at several stops, in order. Since
+/// the whole route is one request, the planner always gives it to a single
+/// robot.
+class MultiStopDelivery
+{
+public:
+
+  // Forward declare the Model for this request
+  class Model;
+
+  /// One of the stops where items are dropped off
+  struct Stop
+  {
+    /// The graph index of the stop
+    std::size_t waypoint;
+
+    /// How long it takes to drop off the items at the stop
+    rmf_traffic::Duration wait;
+
+    /// The items that are dropped off at the stop
+    Payload payload;
+
+    /// The ingestor that takes the items at the stop, if there is one
+    std::string ingestor = "";
+  };
+
+  class Description : public Task::Description
+  {
+  public:
+
+    /// Generate the description for this request
+    ///
+    /// \param[in] pickup_waypoint
+    ///   The graph index of the pickup location
+    ///
+    /// \param[in] pickup_wait
+    ///   How long it takes to load the items at the pickup location
+    ///
+    /// \param[in] dropoffs
+    ///   The stops where items are dropped off, in the order that they are
+    ///   visited
+    ///
+    /// \param[in] pickup_from_dispenser
+    ///   The dispenser that loads the items, if there is one
+    ///
+    /// \throws std::invalid_argument if there are no stops.
+    static std::shared_ptr<Description> make(
+      std::size_t pickup_waypoint,
+      rmf_traffic::Duration pickup_wait,
+      std::vector<Stop> dropoffs,
+      std::string pickup_from_dispenser = "");
+
+    // Documentation inherited
+    Task::ConstModelPtr make_model(
+      rmf_traffic::Time earliest_start_time,
+      const Parameters& parameters) const final;
+
+    // Documentation inherited
+    std::optional<std::size_t> model_hash() const final;
+
+    // Documentation inherited
+    Info generate_info(
+      const State& initial_state,
+      const Parameters& parameters) const final;
+
+    /// Get the pickup waypoint in this request
+    std::size_t pickup_waypoint() const;
+
+    /// Get the duration of the pickup
+    rmf_traffic::Duration pickup_wait() const;
+
+    /// Get the name of the dispenser that the items are picked up from
+    const std::string& pickup_from_dispenser() const;
+
+    /// Get the stops where the items are dropped off, in order
+    const std::vector<Stop>& dropoffs() const;
+
+    class Implementation;
+  private:
+    Description();
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Generate a multi-stop delivery request
+  ///
+  /// \param[in] pickup_waypoint
+  ///   The graph index of the pickup location
+  ///
+  /// \param[in] pickup_wait
+  ///   How long it takes to load the items at the pickup location
+  ///
+  /// \param[in] dropoffs
+  ///   The stops where items are dropped off, in the order that they are
+  ///   visited
+  ///
+  /// \param[in] id
+  ///   A unique id for this request
+  ///
+  /// \param[in] earliest_start_time
+  ///   The desired start time for this request
+  ///
+  /// \param[in] priority
+  ///   The priority for this request
+  ///
+  /// \param[in] automatic
+  ///   True if this request is auto-generated
+  ///
+  /// \param[in] pickup_from_dispenser
+  ///   The dispenser that loads the items, if there is one
+  static ConstRequestPtr make(
+    std::size_t pickup_waypoint,
+    rmf_traffic::Duration pickup_wait,
+    std::vector<Stop> dropoffs,
+    const std::string& id,
+    rmf_traffic::Time earliest_start_time,
+    ConstPriorityPtr priority = nullptr,
+    bool automatic = false,
+    std::string pickup_from_dispenser = "");
+
+  /// Generate a multi-stop delivery request.
+  ///
+  /// \param[in] pickup_waypoint
+  ///   The graph index of the pickup location.
+  ///
+  /// \param[in] pickup_wait
+  ///   How long it takes to load the items at the pickup location.
+  ///
+  /// \param[in] dropoffs
+  ///   The stops where items are dropped off, in the order that they are
+  ///   visited.
+  ///
+  /// \param[in] id
+  ///   A unique id for this request.
+  ///
+  /// \param[in] earliest_start_time
+  ///   The desired start time for this request.
+  ///
+  /// \param[in] requester
+  ///   The entity that issued this request.
+  ///
+  /// \param[in] request_time
+  ///   The time this request was generated or submitted.
+  ///
+  /// \param[in] priority
+  ///   The priority for this request.
+  ///
+  /// \param[in] automatic
+  ///   True if this request is auto-generated, default value as false.
+  ///
+  /// \param[in] pickup_from_dispenser
+  ///   The dispenser that loads the items, if there is one.
+  static ConstRequestPtr make(
+    std::size_t pickup_waypoint,
+    rmf_traffic::Duration pickup_wait,
+    std::vector<Stop> dropoffs,
+    const std::string& id,
+    rmf_traffic::Time earliest_start_time,
+    const std::string& requester,
+    rmf_traffic::Time request_time,
+    ConstPriorityPtr priority = nullptr,
+    bool automatic = false,
+    std::string pickup_from_dispenser = "");
+};
+
+} // namespace requests
+} // namespace rmf_task
+
+#endif // RMF_TASK__REQUESTS__MULTISTOPDELIVERY_HPP
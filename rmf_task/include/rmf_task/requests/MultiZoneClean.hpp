@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK__REQUESTS__MULTIZONECLEAN_HPP
+#define RMF_TASK__REQUESTS__MULTIZONECLEAN_HPP
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <rmf_traffic/Time.hpp>
+#include <rmf_traffic/Trajectory.hpp>
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <rmf_task/State.hpp>
+#include <rmf_task/Request.hpp>
+#include <rmf_task/Estimate.hpp>
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+/// A class that generates a Request which requires an AGV to clean several
+/// zones in one task. The model of the request decides the order that the
+/// zones get visited in, so a floor with many zones can be planned as one
+/// request instead of one request per zone.
+class MultiZoneClean
+{
+public:
+
+  // Forward declare the model for this request
+  class Model;
+
+  /// A zone to clean, described the same way as a Clean request
+  struct Zone
+  {
+    /// The graph index for the location where the AGV begins cleaning the
+    /// zone
+    std::size_t start_waypoint;
+
+    /// The graph index for the location where the AGV ends up after cleaning
+    /// the zone
+    std::size_t end_waypoint;
+
+    /// The trajectory that the AGV follows while cleaning the zone
+    rmf_traffic::Trajectory cleaning_path;
+  };
+
+  class Description : public Task::Description
+  {
+  public:
+
+    /// Generate the description for this request
+    ///
+    /// \param[in] zones
+    ///   The zones to clean, in any order
+    ///
+    /// \throws std::invalid_argument if there are no zones.
+    static std::shared_ptr<Description> make(std::vector<Zone> zones);
+
+    // Documentation inherited
+    Task::ConstModelPtr make_model(
+      rmf_traffic::Time earliest_start_time,
+      const Parameters& parameters) const final;
+
+    // Documentation inherited
+    std::optional<std::size_t> model_hash() const final;
+
+    // Documentation inherited
+    Info generate_info(
+      const State& initial_state,
+      const Parameters& parameters) const final;
+
+    /// Get the zones of this request, in the order that they were given
+    const std::vector<Zone>& zones() const;
+
+    /// Get the order that the zones should be cleaned in, as indices into
+    /// zones(). This is the order that the model of the request estimates.
+    /// It is chosen with a nearest neighbor tour that gets improved by 2-opt
+    /// moves, using the travel estimates between the end of each zone and
+    /// the start of each other zone. Models of the same zones under
+    /// equivalent parameters share the order, so it is only computed once.
+    std::vector<std::size_t> visiting_order(const Parameters& parameters) const;
+
+    class Implementation;
+  private:
+    Description();
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Generate a multi-zone clean request
+  ///
+  /// \param[in] zones
+  ///   The zones to clean, in any order
+  ///
+  /// \param[in] id
+  ///   A unique id for this request
+  ///
+  /// \param[in] earliest_start_time
+  ///   The desired start time for this request
+  ///
+  /// \param[in] priority
+  ///   The priority for this request
+  ///
+  /// \param[in] automatic
+  ///   True if this request is auto-generated
+  static ConstRequestPtr make(
+    std::vector<Zone> zones,
+    const std::string& id,
+    rmf_traffic::Time earliest_start_time,
+    ConstPriorityPtr priority = nullptr,
+    bool automatic = false);
+
+  /// Generate a multi-zone clean request.
+  ///
+  /// \param[in] zones
+  ///   The zones to clean, in any order.
+  ///
+  /// \param[in] id
+  ///   A unique id for this request.
+  ///
+  /// \param[in] earliest_start_time
+  ///   The desired start time for this request.
+  ///
+  /// \param[in] requester
+  ///   The entity that issued this request.
+  ///
+  /// \param[in] request_time
+  ///   The time this request was generated or submitted.
+  ///
+  /// \param[in] priority
+  ///   The priority for this request.
+  ///
+  /// \param[in] automatic
+  ///   True if this request is auto-generated, default value as false.
+  static ConstRequestPtr make(
+    std::vector<Zone> zones,
+    const std::string& id,
+    rmf_traffic::Time earliest_start_time,
+    const std::string& requester,
+    rmf_traffic::Time request_time,
+    ConstPriorityPtr priority = nullptr,
+    bool automatic = false);
+};
+
+} // namespace requests
+} // namespace rmf_task
+
+#endif // RMF_TASK__REQUESTS__MULTIZONECLEAN_HPP
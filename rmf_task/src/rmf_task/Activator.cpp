@@ -16,15 +16,58 @@
 */
 
 #include <rmf_task/Activator.hpp>
+#include <rmf_task/Trace.hpp>
+#include <rmf_task/detail/TypeRegistry.hpp>
 
 namespace rmf_task {
 
+namespace {
+//==============================================================================
+// Make a callback that posts each of its calls to a strand
+template<typename... Args>
+std::function<void(Args...)> dispatch(
+  const StrandPtr& strand,
+  std::function<void(Args...)> callback)
+{
+  if (!strand || !callback)
+    return callback;
+
+  return [strand, callback = std::make_shared<std::function<void(Args...)>>(
+        std::move(callback))](Args... args)
+    {
+      strand->post([callback, args...]() { (*callback)(args...); });
+    };
+}
+
+//==============================================================================
+StrandPtr make_strand(const ExecutorPtr& executor)
+{
+  if (!executor)
+    return nullptr;
+
+  return Strand::make(executor);
+}
+} // anonymous namespace
+
 //==============================================================================
 class Activator::Implementation
 {
 public:
 
-  std::unordered_map<std::type_index, Activate<Task::Description>> activators;
+  // The activator of each type of description is stored at the ID that the
+  // registry gives the type
+  detail::TypeRegistry types;
+  std::vector<Activate<Task::Description>> activators;
+
+  const Activate<Task::Description>* find(
+    const Task::Description& description) const
+  {
+    const auto id = types.find(typeid(description));
+    if (!id.has_value())
+      return nullptr;
+
+    return &activators[*id];
+  }
 
 };
 
@@ -43,30 +86,34 @@ Task::ActivePtr Activator::activate(
   std::function<void(Phase::ConstSnapshotPtr)> update,
   std::function<void(Task::Active::Backup)> checkpoint,
   std::function<void(Phase::ConstCompletedPtr)> phase_finished,
-  std::function<void()> task_finished) const
+  std::function<void()> task_finished,
+  const ExecutorPtr& executor) const
 {
+  RMF_TASK_TRACE_SPAN("Activator::activate");
+
   // TODO(MXG): Should we issue some kind of error/warning to distinguish
   // between a missing description versus a description that doesn't have a
   // corresponding activator? Same for the restore(~) function.
   if (!request.description())
     return nullptr;
 
-  const auto& desc = *request.description();
-  const auto& type = typeid(desc);
-  const auto it = _pimpl->activators.find(type);
-  if (it == _pimpl->activators.end())
+  const auto* activator = _pimpl->find(*request.description());
+  if (!activator)
     return nullptr;
 
-  return it->second(
+  // Every callback of the task shares one strand so they stay in order
+  const auto strand = make_strand(executor);
+
+  return (*activator)(
     get_state,
     parameters,
     request.booking(),
     *request.description(),
     std::nullopt,
-    std::move(update),
-    std::move(checkpoint),
-    std::move(phase_finished),
-    std::move(task_finished));
+    dispatch(strand, std::move(update)),
+    dispatch(strand, std::move(checkpoint)),
+    dispatch(strand, std::move(phase_finished)),
+    dispatch(strand, std::move(task_finished)));
 }
 
 //==============================================================================
@@ -78,35 +125,54 @@ Task::ActivePtr Activator::restore(
   std::function<void(Phase::ConstSnapshotPtr)> update,
   std::function<void(Task::Active::Backup)> checkpoint,
   std::function<void(Phase::ConstCompletedPtr)> phase_finished,
-  std::function<void()> task_finished) const
+  std::function<void()> task_finished,
+  const ExecutorPtr& executor) const
 {
+  RMF_TASK_TRACE_SPAN("Activator::restore");
   if (!request.description())
     return nullptr;
 
-  const auto& desc = *request.description();
-  const auto& type = typeid(desc);
-  const auto it = _pimpl->activators.find(type);
-  if (it == _pimpl->activators.end())
+  const auto* activator = _pimpl->find(*request.description());
+  if (!activator)
     return nullptr;
 
-  return it->second(
+  // Every callback of the task shares one strand so they stay in order
+  const auto strand = make_strand(executor);
+
+  return (*activator)(
     get_state,
     parameters,
     request.booking(),
     *request.description(),
     std::move(backup_state),
-    std::move(update),
-    std::move(checkpoint),
-    std::move(phase_finished),
-    std::move(task_finished));
+    dispatch(strand, std::move(update)),
+    dispatch(strand, std::move(checkpoint)),
+    dispatch(strand, std::move(phase_finished)),
+    dispatch(strand, std::move(task_finished)));
+}
+
+//==============================================================================
+void Activator::freeze()
+{
+  _pimpl->types.freeze();
+}
+
+//==============================================================================
+bool Activator::frozen() const
+{
+  return _pimpl->types.frozen();
 }
 
 //==============================================================================
 void Activator::_add_activator(
-  std::type_index type,
+  const std::type_info& type,
   Activate<Task::Description> activator)
 {
-  _pimpl->activators.insert_or_assign(type, std::move(activator));
+  const auto id = _pimpl->types.insert(type);
+  if (id < _pimpl->activators.size())
+    _pimpl->activators[id] = std::move(activator);
+  else
+    _pimpl->activators.push_back(std::move(activator));
 }
 
 } // namespace rmf_task
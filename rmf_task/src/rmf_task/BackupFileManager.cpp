@@ -15,15 +15,1087 @@
  *
 */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <iostream>
+#include <limits>
 #include <fstream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <rmf_task/BackupFileManager.hpp>
+#include <rmf_task/Metrics.hpp>
+#include <rmf_task/Trace.hpp>
 
 #include <rmf_utils/Modular.hpp>
 
+#ifdef RMF_TASK_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace rmf_task {
 
+namespace {
+
+//==============================================================================
+// Flush a file or directory to the storage device
+void sync_path(const std::string& path)
+{
+#ifndef _WIN32
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  ::fsync(fd);
+  ::close(fd);
+#else
+  (void)(path);
+#endif
+}
+
+//==============================================================================
+// Write the state next to the backup file and then move it into place, so
+// that the backup file is never left partially written. If sync is true, the
+// data and the rename are flushed to the storage device before returning.
+void write_backup_file(
+  const std::string& pre_backup_file_path,
+  const std::string& backup_file_path,
+  const std::string& state,
+  const bool sync)
+{
+#ifndef _WIN32
+  if (sync)
+  {
+    const int fd = ::open(
+      pre_backup_file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      throw std::runtime_error(
+              "Could not open file " + pre_backup_file_path +
+              " for pre_backup.");
+
+    const char* data = state.data();
+    std::size_t remaining = state.size();
+    bool failed = false;
+    while (remaining > 0 && !failed)
+    {
+      const auto written = ::write(fd, data, remaining);
+      if (written < 0)
+      {
+        failed = errno != EINTR;
+        continue;
+      }
+
+      data += written;
+      remaining -= static_cast<std::size_t>(written);
+    }
+
+    failed = failed || ::fsync(fd) != 0;
+    failed = ::close(fd) != 0 || failed;
+    if (failed)
+      throw std::runtime_error(
+              "Could not write file " + pre_backup_file_path +
+              " for pre_backup: " + std::strerror(errno));
+
+    std::filesystem::rename(pre_backup_file_path, backup_file_path);
+    sync_path(std::filesystem::path(backup_file_path).parent_path().string());
+    return;
+  }
+#else
+  (void)(sync);
+#endif
+
+  std::ofstream pre_backup(
+    pre_backup_file_path, std::ios::out | std::ios::binary);
+  if (!pre_backup)
+    throw std::runtime_error(
+            "Could not open file " + pre_backup_file_path +
+            " for pre_backup.");
+  else
+  {
+    pre_backup << state;
+    pre_backup.close();
+    std::filesystem::rename(pre_backup_file_path, backup_file_path);
+  }
+}
+
+//==============================================================================
+// Flushes the backup files that have been written since the last commit, and
+// the directories that they were renamed in, once every period
+class GroupCommitter
+{
+public:
+
+  GroupCommitter(rmf_traffic::Duration period)
+  : _thread([this, period]() { run(period); })
+  {
+    // Do nothing
+  }
+
+  void add(const std::string& backup_file_path)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _dirty.insert(backup_file_path);
+  }
+
+  ~GroupCommitter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+  }
+
+private:
+
+  void run(const rmf_traffic::Duration period)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool stop = false;
+    while (!stop)
+    {
+      stop = _wake.wait_for(lock, period, [this]() { return _stop; });
+
+      // Anything that is still dirty gets committed before the thread stops
+      std::unordered_set<std::string> dirty;
+      std::swap(dirty, _dirty);
+      lock.unlock();
+
+      std::unordered_set<std::string> directories;
+      for (const auto& path : dirty)
+      {
+        sync_path(path);
+        directories.insert(
+          std::filesystem::path(path).parent_path().string());
+      }
+
+      for (const auto& directory : directories)
+        sync_path(directory);
+
+      lock.lock();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::unordered_set<std::string> _dirty;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+//==============================================================================
+// Write a backup file with the durability that the manager asks for
+void store_backup_file(
+  const std::string& pre_backup_file_path,
+  const std::string& backup_file_path,
+  const std::string& state,
+  const BackupFileManager::Durability durability,
+  const std::shared_ptr<GroupCommitter>& committer)
+{
+  using Durability = BackupFileManager::Durability;
+  write_backup_file(
+    pre_backup_file_path, backup_file_path, state,
+    durability == Durability::EveryWrite);
+
+  if (durability == Durability::GroupCommit && committer)
+    committer->add(backup_file_path);
+}
+
+//==============================================================================
+// Compressed backups begin with this header. A backup that was written
+// without compression, including every backup written before compression was
+// supported, is read back as it is.
+const std::string compressed_header = "\x89rmf_task zstd\n";
+
+//==============================================================================
+using CompressionThreshold = std::shared_ptr<const std::atomic_size_t>;
+
+//==============================================================================
+// Compress a backup if it is at least as large as the threshold
+std::string encode_backup(
+  const std::string& state,
+  const CompressionThreshold& threshold)
+{
+  RMF_TASK_TRACE_SPAN("BackupFileManager::encode");
+#ifdef RMF_TASK_HAVE_ZSTD
+  if (!threshold || state.size() < threshold->load())
+    return state;
+
+  std::string output = compressed_header;
+  output.resize(compressed_header.size() + ZSTD_compressBound(state.size()));
+  const auto size = ZSTD_compress(
+    output.data() + compressed_header.size(),
+    output.size() - compressed_header.size(),
+    state.data(), state.size(), ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(size))
+    return state;
+
+  output.resize(compressed_header.size() + size);
+  return output;
+#else
+  (void)(threshold);
+  return state;
+#endif
+}
+
+//==============================================================================
+// Decompress a backup if it was compressed
+std::string decode_backup(const std::string& data)
+{
+  if (data.compare(0, compressed_header.size(), compressed_header) != 0)
+    return data;
+
+#ifdef RMF_TASK_HAVE_ZSTD
+  ZSTD_DStream* const stream = ZSTD_createDStream();
+  ZSTD_initDStream(stream);
+  ZSTD_inBuffer input = {
+    data.data() + compressed_header.size(),
+    data.size() - compressed_header.size(),
+    0
+  };
+
+  std::string output;
+  std::string chunk(ZSTD_DStreamOutSize(), '\0');
+  std::size_t result = 0;
+  while (input.pos < input.size)
+  {
+    ZSTD_outBuffer out = {chunk.data(), chunk.size(), 0};
+    result = ZSTD_decompressStream(stream, &out, &input);
+    if (ZSTD_isError(result))
+      break;
+
+    output.append(chunk.data(), out.pos);
+  }
+  ZSTD_freeDStream(stream);
+
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (ZSTD_isError(result) || result != 0)
+  {
+    throw std::runtime_error(
+      "[BackupFileManager::Robot::read] Compressed backup is corrupted");
+  }
+  // *INDENT-ON*
+
+  return output;
+#else
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  throw std::runtime_error(
+    "[BackupFileManager::Robot::read] Backup is compressed, but rmf_task was "
+    "built without zstd support");
+  // *INDENT-ON*
+#endif
+}
+
+//==============================================================================
+// Append data to the end of a file, creating the file if it does not exist
+void append_file(
+  const std::string& path,
+  const std::string& data,
+  const bool sync)
+{
+  std::ofstream file(path, std::ios::out | std::ios::app | std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Could not open file " + path + " for journal.");
+
+  file << data;
+  file.close();
+  if (!file)
+    throw std::runtime_error("Could not write file " + path + " for journal.");
+
+  if (sync)
+    sync_path(path);
+}
+
+//==============================================================================
+// A checksum that identifies the snapshot that a journal was started from.
+// This is FNV-1a, which gives the same result on every platform.
+uint64_t fingerprint(const std::string& data)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : data)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+//==============================================================================
+std::string journal_header(const std::string& snapshot)
+{
+  return "rmf_task_journal " + std::to_string(fingerprint(snapshot)) + " "
+    + std::to_string(snapshot.size()) + "\n";
+}
+
+//==============================================================================
+// Keeps a journal of the changes to a backup next to a snapshot of it. Each
+// record of the journal replaces the bytes of the previous state that lie
+// between the prefix and the suffix that it has in common with the new state,
+// so a backup where only a phase index changed only appends a few bytes. The
+// journal is compacted into a new snapshot once it holds too many records or
+// bytes.
+//
+// The journal begins with a header that identifies its snapshot. If the
+// process stops after a new snapshot is written but before the journal is
+// started over, the stale journal is recognized and ignored.
+class BackupJournal
+{
+public:
+
+  BackupJournal(
+    std::string pre_backup_file_path,
+    std::string backup_file_path,
+    std::string pre_journal_file_path,
+    std::string journal_file_path,
+    std::size_t max_records,
+    std::size_t max_bytes,
+    CompressionThreshold compression_threshold)
+  : _pre_backup_file_path(std::move(pre_backup_file_path)),
+    _backup_file_path(std::move(backup_file_path)),
+    _pre_journal_file_path(std::move(pre_journal_file_path)),
+    _journal_file_path(std::move(journal_file_path)),
+    _max_records(max_records),
+    _max_bytes(max_bytes),
+    _compression_threshold(std::move(compression_threshold))
+  {
+    // Do nothing
+  }
+
+  void store(
+    const std::string& state,
+    const BackupFileManager::Durability durability,
+    const std::shared_ptr<GroupCommitter>& committer)
+  {
+    using Durability = BackupFileManager::Durability;
+    if (!_last_state.has_value() || _records >= _max_records)
+      return compact(state, durability, committer);
+
+    const auto& last = *_last_state;
+    const std::size_t shortest = std::min(last.size(), state.size());
+    std::size_t prefix = 0;
+    while (prefix < shortest && last[prefix] == state[prefix])
+      ++prefix;
+
+    std::size_t suffix = 0;
+    while (suffix < shortest - prefix
+      && last[last.size() - suffix - 1] == state[state.size() - suffix - 1])
+    {
+      ++suffix;
+    }
+
+    const auto middle = state.substr(prefix, state.size() - prefix - suffix);
+    const std::string record =
+      std::to_string(prefix) + " " + std::to_string(suffix) + " "
+      + std::to_string(middle.size()) + "\n" + middle + "\n";
+
+    if (_bytes + record.size() > _max_bytes)
+      return compact(state, durability, committer);
+
+    append_file(
+      _journal_file_path, record, durability == Durability::EveryWrite);
+    if (durability == Durability::GroupCommit && committer)
+      committer->add(_journal_file_path);
+
+    ++_records;
+    _bytes += record.size();
+    _last_state = state;
+  }
+
+  // Apply the records of a journal to the snapshot that it was started from
+  static std::string replay(std::string snapshot, const std::string& journal)
+  {
+    const auto header = journal_header(snapshot);
+    if (journal.compare(0, header.size(), header) != 0)
+      return snapshot;
+
+    std::istringstream stream(journal.substr(header.size()));
+    while (true)
+    {
+      std::size_t prefix, suffix, size;
+      if (!(stream >> prefix >> suffix >> size) || stream.get() != '\n')
+        break;
+
+      if (prefix + suffix > snapshot.size())
+        break;
+
+      // A record that was cut off by a crash is left out
+      std::string middle(size, '\0');
+      if (!stream.read(middle.data(), static_cast<std::streamsize>(size))
+        || stream.get() != '\n')
+        break;
+
+      snapshot = snapshot.substr(0, prefix) + middle
+        + snapshot.substr(snapshot.size() - suffix);
+    }
+
+    return snapshot;
+  }
+
+private:
+
+  void compact(
+    const std::string& state,
+    const BackupFileManager::Durability durability,
+    const std::shared_ptr<GroupCommitter>& committer)
+  {
+    store_backup_file(
+      _pre_backup_file_path, _backup_file_path,
+      encode_backup(state, _compression_threshold), durability, committer);
+
+    const auto header = journal_header(state);
+    store_backup_file(
+      _pre_journal_file_path, _journal_file_path, header, durability,
+      committer);
+
+    _records = 0;
+    _bytes = header.size();
+    _last_state = state;
+  }
+
+  const std::string _pre_backup_file_path;
+  const std::string _backup_file_path;
+  const std::string _pre_journal_file_path;
+  const std::string _journal_file_path;
+  const std::size_t _max_records;
+  const std::size_t _max_bytes;
+  const CompressionThreshold _compression_threshold;
+
+  // The state that the snapshot and the journal add up to
+  std::optional<std::string> _last_state;
+  std::size_t _records = 0;
+  std::size_t _bytes = 0;
+};
+
+//==============================================================================
+// A single thread that writes the backups of every robot whose manager uses
+// asynchronous writes. Only the newest backup that is waiting for each backup
+// file is kept, and the files are written in the order that they first began
+// waiting, so no file waits behind more than one write of every other file.
+class AsyncBackupWriter
+{
+public:
+
+  using Logger = std::function<void(const std::string&)>;
+  using Store = std::function<void(const std::string&)>;
+  using SharedState = Task::Active::Backup::SharedState;
+
+  static AsyncBackupWriter& get()
+  {
+    static AsyncBackupWriter writer;
+    return writer;
+  }
+
+  void push(
+    const std::string& backup_file_path,
+    SharedState state,
+    Store store,
+    Logger log_error)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      const auto insertion = _pending.insert({backup_file_path, Pending()});
+      if (insertion.second)
+        _order.push_back(backup_file_path);
+
+      auto& pending = insertion.first->second;
+      pending.state = std::move(state);
+      pending.store = std::move(store);
+      pending.log_error = std::move(log_error);
+    }
+    _wake.notify_all();
+  }
+
+  // Wait until nothing is waiting to be written to the backup file
+  void flush(const std::string& backup_file_path)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wake.wait(lock, [&]()
+      {
+        return _pending.count(backup_file_path) == 0
+        && _writing != backup_file_path;
+      });
+  }
+
+  // Drop any backup that is waiting to be written to the backup file, and
+  // wait for any write of it that has already begun
+  void discard(const std::string& backup_file_path)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_pending.erase(backup_file_path) > 0)
+    {
+      _order.erase(
+        std::find(_order.begin(), _order.end(), backup_file_path));
+    }
+
+    _wake.wait(lock, [&]() { return _writing != backup_file_path; });
+  }
+
+  ~AsyncBackupWriter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+  }
+
+private:
+
+  struct Pending
+  {
+    // Shared with the Backup that it came from, so queueing it copies nothing
+    SharedState state;
+    Store store;
+    Logger log_error;
+  };
+
+  AsyncBackupWriter()
+  : _thread([this]() { run(); })
+  {
+    // Do nothing
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+      _wake.wait(lock, [&]() { return _stop || !_order.empty(); });
+
+      // Everything that is waiting gets written before the thread stops
+      if (_order.empty())
+        return;
+
+      _writing = std::move(_order.front());
+      _order.pop_front();
+      const auto it = _pending.find(_writing);
+      Pending pending = std::move(it->second);
+      _pending.erase(it);
+      lock.unlock();
+
+      try
+      {
+        pending.store(*pending.state);
+      }
+      catch (const std::exception& e)
+      {
+        if (pending.log_error)
+          pending.log_error(e.what());
+      }
+
+      lock.lock();
+      _writing.clear();
+      _wake.notify_all();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::unordered_map<std::string, Pending> _pending;
+  std::deque<std::string> _order;
+  std::string _writing;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+//==============================================================================
+// Collects the latest backup of each robot of a group and sends the ones that
+// changed to a replication sink once every period, so that mirroring the
+// backups does not need a message for every checkpoint.
+class BackupReplication
+{
+public:
+
+  using Entry = BackupFileManager::ReplicationSink::Entry;
+  using Logger = std::function<void(const std::string&)>;
+
+  BackupReplication(std::string group, Logger log_error)
+  : _group(std::move(group)),
+    _log_error(std::move(log_error))
+  {
+    // Do nothing
+  }
+
+  void start(
+    std::shared_ptr<BackupFileManager::ReplicationSink> sink,
+    const rmf_traffic::Duration period)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _sink = std::move(sink);
+      _period = period;
+      if (!_sink)
+        _changed.clear();
+
+      if (!_sink || _thread.joinable())
+      {
+        _wake.notify_all();
+        return;
+      }
+    }
+
+    _thread = std::thread([this]() { run(); });
+  }
+
+  void record(
+    const std::string& robot,
+    const uint64_t sequence,
+    Task::Active::Backup::SharedState state)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_sink)
+      return;
+
+    // Only the newest backup of each robot needs to be sent
+    _changed[robot] = Entry{robot, sequence, std::move(state)};
+  }
+
+  ~BackupReplication()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    if (_thread.joinable())
+      _thread.join();
+  }
+
+private:
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool stop = false;
+    while (!stop)
+    {
+      stop = _wake.wait_for(lock, _period, [this]() { return _stop; });
+
+      // Anything that has not been sent yet gets sent before the thread stops
+      if (_changed.empty() || !_sink)
+        continue;
+
+      std::unordered_map<std::string, Entry> changed;
+      std::swap(changed, _changed);
+      const auto sink = _sink;
+      lock.unlock();
+
+      std::vector<Entry> entries;
+      entries.reserve(changed.size());
+      for (auto& [robot, entry] : changed)
+        entries.push_back(std::move(entry));
+
+      std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.robot < b.robot; });
+
+      bool sent = true;
+      try
+      {
+        sink->send(_group, entries);
+      }
+      catch (const std::exception& e)
+      {
+        sent = false;
+        if (_log_error)
+        {
+          _log_error(
+            "[BackupFileManager::Group::replicate] Failed to send backups of ["
+            + _group + "]: " + e.what());
+        }
+      }
+
+      lock.lock();
+      if (!sent)
+      {
+        // Entries that were replaced while the batch was being sent are
+        // newer, so they win
+        for (auto& entry : entries)
+          _changed.insert({entry.robot, std::move(entry)});
+      }
+    }
+  }
+
+  const std::string _group;
+  Logger _log_error;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::shared_ptr<BackupFileManager::ReplicationSink> _sink;
+  rmf_traffic::Duration _period = std::chrono::milliseconds(500);
+  std::unordered_map<std::string, Entry> _changed;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+//==============================================================================
+// Keeps the backups of every robot of a group in one memory-mapped file, so
+// that a large fleet does not need a directory and a pair of files for every
+// robot.
+//
+// After a short file header, the file holds one record for each robot. A
+// record has two slots of the same capacity. A backup is written into the
+// slot that is not active, and then the header of the record is switched over
+// to it with a single aligned store, so a record always holds a complete
+// backup. A backup that does not fit in its slots moves the robot to a new
+// record with larger slots, and the old record is marked dead. If the process
+// stops before the old record is marked, the newer record wins when the file
+// is opened again.
+#ifndef _WIN32
+class BackupStore
+{
+public:
+
+  BackupStore(std::string path, std::size_t slot_capacity)
+  : _path(std::move(path)),
+    _slot_capacity(align(std::max<std::size_t>(slot_capacity, 1)))
+  {
+    _fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (_fd < 0)
+      throw std::runtime_error("Could not open backup store file " + _path);
+    // *INDENT-ON*
+
+    try
+    {
+      load();
+    }
+    catch (const std::exception&)
+    {
+      close();
+      throw;
+    }
+  }
+
+  std::optional<std::string> read(const std::string& robot) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _records.find(robot);
+    if (it == _records.end())
+      return std::nullopt;
+
+    const auto& record = at(it->second);
+    if (record.active == 0)
+      return std::nullopt;
+
+    const auto slot = record.active - 1;
+    return std::string(
+      slot_of(it->second, slot), static_cast<std::size_t>(record.size[slot]));
+  }
+
+  void write(const std::string& robot, const std::string& state, bool sync)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _records.find(robot);
+    if (it == _records.end())
+    {
+      it = _records.insert(
+        {robot, append(robot, std::max(_slot_capacity, align(state.size())))})
+        .first;
+    }
+    else if (at(it->second).capacity < state.size())
+    {
+      const auto old_offset = it->second;
+      it->second = append(
+        robot, std::max(2 * at(old_offset).capacity, align(state.size())));
+      commit(it->second, state, sync);
+      kill(old_offset);
+      if (sync)
+        sync_range(old_offset, sizeof(Record));
+
+      return;
+    }
+
+    commit(it->second, state, sync);
+  }
+
+  void clear(const std::string& robot)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _records.find(robot);
+    if (it != _records.end())
+      set_active(it->second, 0);
+  }
+
+  // The robots that have a backup in the store
+  std::vector<std::string> robots() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> output;
+    for (const auto& [name, offset] : _records)
+    {
+      if (at(offset).active != 0)
+        output.push_back(name);
+    }
+
+    return output;
+  }
+
+  const std::string& path() const
+  {
+    return _path;
+  }
+
+  ~BackupStore()
+  {
+    close();
+  }
+
+private:
+
+  struct Record
+  {
+    char magic[8];
+    uint64_t name_size;
+    uint64_t capacity;
+    // 0 when the record holds no backup, otherwise one more than the index of
+    // the slot that holds the backup
+    uint64_t active;
+    uint64_t size[2];
+  };
+
+  static constexpr std::size_t magic_size = 8;
+  static constexpr char file_magic[] = "RMFTSTR1";
+  static constexpr char live_magic[] = "RMFTLIVE";
+  static constexpr char dead_magic[] = "RMFTDEAD";
+  static constexpr std::size_t initial_size = 1 << 16;
+
+  void load()
+  {
+    const auto file_size =
+      static_cast<std::size_t>(std::filesystem::file_size(_path));
+    if (file_size == 0)
+    {
+      map(initial_size);
+      std::memcpy(_data, file_magic, magic_size);
+      _end = magic_size;
+      return;
+    }
+
+    map(file_size);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (file_size < magic_size
+      || std::memcmp(_data, file_magic, magic_size) != 0)
+    {
+      throw std::runtime_error(
+        "File " + _path + " is not a backup store. It should be removed.");
+    }
+    // *INDENT-ON*
+
+    _end = magic_size;
+    while (_end + sizeof(Record) <= _size)
+    {
+      const auto& record = at(_end);
+      const bool live = std::memcmp(record.magic, live_magic, magic_size) == 0;
+      if (!live && std::memcmp(record.magic, dead_magic, magic_size) != 0)
+        break;
+
+      const auto total = record_size(record.name_size, record.capacity);
+      if (_end + total > _size)
+        break;
+
+      if (live)
+      {
+        const std::string name(name_of(_end), record.name_size);
+        const auto insertion = _records.insert({name, _end});
+        if (!insertion.second)
+        {
+          kill(insertion.first->second);
+          insertion.first->second = _end;
+        }
+      }
+
+      _end += total;
+    }
+  }
+
+  static std::size_t align(std::size_t size)
+  {
+    return (size + 7) & ~static_cast<std::size_t>(7);
+  }
+
+  static std::size_t record_size(uint64_t name_size, uint64_t capacity)
+  {
+    return sizeof(Record) + align(name_size) + 2 * capacity;
+  }
+
+  Record& at(std::size_t offset) const
+  {
+    return *reinterpret_cast<Record*>(_data + offset);
+  }
+
+  char* name_of(std::size_t offset) const
+  {
+    return _data + offset + sizeof(Record);
+  }
+
+  char* slot_of(std::size_t offset, uint64_t slot) const
+  {
+    const auto& record = at(offset);
+    return name_of(offset) + align(record.name_size) + slot * record.capacity;
+  }
+
+  void map(std::size_t size)
+  {
+    if (_data)
+      ::munmap(_data, _size);
+
+    _data = nullptr;
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (::ftruncate(_fd, static_cast<off_t>(size)) != 0)
+      throw std::runtime_error("Could not resize backup store file " + _path);
+    // *INDENT-ON*
+
+    void* data = ::mmap(
+      nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (data == MAP_FAILED)
+      throw std::runtime_error("Could not map backup store file " + _path);
+    // *INDENT-ON*
+
+    _data = static_cast<char*>(data);
+    _size = size;
+  }
+
+  std::size_t append(const std::string& robot, std::size_t capacity)
+  {
+    const auto total = record_size(robot.size(), capacity);
+    if (_end + total > _size)
+    {
+      auto size = _size;
+      while (_end + total > size)
+        size *= 2;
+
+      map(size);
+    }
+
+    const auto offset = _end;
+    auto& record = at(offset);
+    record.name_size = robot.size();
+    record.capacity = capacity;
+    record.active = 0;
+    record.size[0] = 0;
+    record.size[1] = 0;
+    std::memcpy(name_of(offset), robot.data(), robot.size());
+
+    // The record only counts once its magic is written
+    std::memcpy(record.magic, live_magic, magic_size);
+    _end += total;
+    return offset;
+  }
+
+  void commit(std::size_t offset, const std::string& state, bool sync)
+  {
+    auto& record = at(offset);
+    const uint64_t slot = record.active == 1 ? 1 : 0;
+    std::memcpy(slot_of(offset, slot), state.data(), state.size());
+    record.size[slot] = state.size();
+    if (sync)
+      sync_range(slot_of(offset, slot) - _data, state.size());
+
+    set_active(offset, slot + 1);
+    if (sync)
+      sync_range(offset, sizeof(Record) + align(record.name_size));
+  }
+
+  void set_active(std::size_t offset, uint64_t active)
+  {
+    // An aligned 8-byte store, which cannot be torn by a crash
+    reinterpret_cast<std::atomic<uint64_t>*>(&at(offset).active)->store(
+      active, std::memory_order_release);
+  }
+
+  void close()
+  {
+    if (_data)
+      ::munmap(_data, _size);
+
+    ::close(_fd);
+  }
+
+  void kill(std::size_t offset)
+  {
+    std::memcpy(at(offset).magic, dead_magic, magic_size);
+  }
+
+  void sync_range(std::size_t offset, std::size_t size)
+  {
+    const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto begin = offset - offset % page;
+    ::msync(_data + begin, offset + size - begin, MS_SYNC);
+  }
+
+  const std::string _path;
+  const std::size_t _slot_capacity;
+  int _fd = -1;
+  char* _data = nullptr;
+  std::size_t _size = 0;
+  std::size_t _end = 0;
+  mutable std::mutex _mutex;
+  std::unordered_map<std::string, std::size_t> _records;
+};
+#else
+class BackupStore
+{
+public:
+
+  BackupStore(std::string path, std::size_t)
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::runtime_error(
+      "Consolidated backup stores are not supported on this platform: "
+      + path);
+    // *INDENT-ON*
+  }
+
+  std::optional<std::string> read(const std::string&) const
+  {
+    return std::nullopt;
+  }
+
+  void write(const std::string&, const std::string&, bool)
+  {
+    // Do nothing
+  }
+
+  void clear(const std::string&)
+  {
+    // Do nothing
+  }
+
+  std::vector<std::string> robots() const
+  {
+    return {};
+  }
+
+  const std::string& path() const
+  {
+    return _path;
+  }
+
+private:
+  std::string _path;
+};
+#endif
+
+} // anonymous namespace
+
 //==============================================================================
 class BackupFileManager::Implementation
 {
@@ -33,6 +1105,16 @@ public:
   {
     bool clear_on_startup = false;
     bool clear_on_shutdown = true;
+    bool asynchronous_write = false;
+    Durability durability = Durability::None;
+    std::shared_ptr<GroupCommitter> committer;
+    bool journal = false;
+    std::size_t journal_compaction_records = 0;
+    std::size_t journal_compaction_bytes = 0;
+    bool consolidated_store = false;
+    std::size_t store_slot_capacity = 0;
+    bool compression = false;
+    std::size_t compression_threshold = 0;
     std::function<void(std::string)> info_logger = nullptr;
     std::function<void(std::string)> debug_logger = nullptr;
   };
@@ -66,9 +1148,29 @@ public:
     std::filesystem::path directory,
     ConstSettingsPtr settings)
   : group_directory(std::move(directory)),
-    settings(std::move(settings))
+    settings(std::move(settings)),
+    compression_threshold(std::make_shared<std::atomic_size_t>(
+        this->settings->compression ?
+        this->settings->compression_threshold :
+        std::numeric_limits<std::size_t>::max()))
   {
     std::filesystem::create_directories(this->group_directory);
+    if (this->settings->consolidated_store)
+    {
+      store = std::make_shared<BackupStore>(
+        (this->group_directory / store_file_name).string(),
+        this->settings->store_slot_capacity);
+    }
+
+    replication = std::make_shared<BackupReplication>(
+      group_directory.filename().string(),
+      [settings = this->settings](const std::string& msg)
+      {
+        if (settings->info_logger)
+          settings->info_logger(msg);
+        else
+          std::cout << msg << std::endl;
+      });
   }
 
   template<typename... Args>
@@ -83,8 +1185,17 @@ public:
 
   const std::filesystem::path group_directory;
   ConstSettingsPtr settings;
+  const std::string store_file_name = "backups";
+  std::shared_ptr<BackupStore> store;
+  // Shared with the robots of the group
+  std::shared_ptr<std::atomic_size_t> compression_threshold;
+  // Shared with the robots of the group
+  std::shared_ptr<BackupReplication> replication;
 
   std::unordered_map<std::string, std::weak_ptr<Robot>> robots;
+  // The robots whose backups were loaded from a replica, held until they are
+  // restored
+  std::unordered_map<std::string, std::shared_ptr<Robot>> loaded;
 };
 
 //==============================================================================
@@ -96,14 +1207,21 @@ public:
 
   Implementation(
     std::filesystem::path directory,
-    ConstSettingsPtr settings)
+    ConstSettingsPtr settings,
+    std::shared_ptr<BackupStore> store_,
+    CompressionThreshold compression_threshold_,
+    std::shared_ptr<BackupReplication> replication_)
   : robot_directory(std::move(directory)),
-    settings(std::move(settings))
+    settings(std::move(settings)),
+    store(std::move(store_)),
+    compression_threshold(std::move(compression_threshold_)),
+    replication(std::move(replication_))
   {
     if (this->settings->clear_on_startup)
       this->clear_backup();
 
-    std::filesystem::create_directories(this->robot_directory);
+    if (!store)
+      std::filesystem::create_directories(this->robot_directory);
   }
 
   template<typename... Args>
@@ -116,20 +1234,46 @@ public:
     return std::make_shared<Robot>(std::move(output));
   }
 
+  static Implementation& get(Robot& robot)
+  {
+    return *robot._pimpl;
+  }
+
   ~Implementation()
   {
     if (settings->clear_on_shutdown)
+    {
+      if (wrote_asynchronously)
+        AsyncBackupWriter::get().discard(backup_file_path);
+
       clear_backup();
+    }
+    else
+    {
+      flush();
+    }
   }
 
   const std::filesystem::path robot_directory;
   ConstSettingsPtr settings;
+  // Set when the robot is backed up in the consolidated store of its group
+  std::shared_ptr<BackupStore> store;
+  const std::string robot_name = robot_directory.filename().string();
+  CompressionThreshold compression_threshold;
+  std::shared_ptr<BackupReplication> replication;
   std::optional<uint64_t> last_seq;
+  std::atomic_bool wrote_asynchronously = false;
   const std::string backup_file_name = "backup";
   const std::string pre_backup_file_name = ".backup";
   const std::string pre_backup_file_path = robot_directory /
     pre_backup_file_name;
   const std::string backup_file_path = robot_directory / backup_file_name;
+  const std::string journal_file_name = "journal";
+  const std::string pre_journal_file_name = ".journal";
+  const std::string pre_journal_file_path = robot_directory /
+    pre_journal_file_name;
+  const std::string journal_file_path = robot_directory / journal_file_name;
+  std::shared_ptr<BackupJournal> journal;
 
   void write_if_new(const Task::Active::Backup& backup)
   {
@@ -140,7 +1284,25 @@ public:
     }
 
     last_seq = backup.sequence();
-    write(backup.state());
+    write(backup.shared_state());
+    if (replication)
+      replication->record(robot_name, backup.sequence(), backup.shared_state());
+  }
+
+  // Write or clear a backup that was replicated from another group
+  void load(const ReplicationSink::Entry& entry)
+  {
+    if (!entry.state)
+    {
+      if (wrote_asynchronously)
+        AsyncBackupWriter::get().discard(backup_file_path);
+
+      clear_backup();
+      last_seq = std::nullopt;
+      return;
+    }
+
+    write_if_new(Task::Active::Backup::make(entry.sequence, entry.state));
   }
 
   void log_debug(const std::string msg) const
@@ -167,27 +1329,103 @@ public:
     }
   }
 
+  void flush() const
+  {
+    if (wrote_asynchronously)
+      AsyncBackupWriter::get().flush(backup_file_path);
+  }
+
 private:
-  void write(const std::string& state)
+  void write(const Task::Active::Backup::SharedState& state)
   {
-    std::ofstream pre_backup(pre_backup_file_path, std::ios::out);
-    if (!pre_backup)
-      throw std::runtime_error(
-              "Could not open file " + pre_backup_file_path +
-              " for pre_backup.");
+    if (settings->journal && !journal && !this->store)
+    {
+      journal = std::make_shared<BackupJournal>(
+        pre_backup_file_path, backup_file_path,
+        pre_journal_file_path, journal_file_path,
+        settings->journal_compaction_records,
+        settings->journal_compaction_bytes,
+        compression_threshold);
+    }
+
+    AsyncBackupWriter::Store store;
+    if (this->store)
+    {
+      store = [backups = this->store, settings = settings,
+          name = robot_name, threshold = compression_threshold](
+        const std::string& s)
+        {
+          using Durability = BackupFileManager::Durability;
+          backups->write(
+            name, encode_backup(s, threshold),
+            settings->durability == Durability::EveryWrite);
+          if (settings->durability == Durability::GroupCommit
+            && settings->committer)
+          {
+            settings->committer->add(backups->path());
+          }
+        };
+    }
+    else if (journal)
+    {
+      store = [journal = journal, settings = settings](const std::string& s)
+        {
+          journal->store(s, settings->durability, settings->committer);
+        };
+    }
     else
     {
-      pre_backup << state;
-      pre_backup.close();
-      std::filesystem::rename(pre_backup_file_path, backup_file_path);
+      store = [settings = settings, pre = pre_backup_file_path,
+          path = backup_file_path, threshold = compression_threshold](
+        const std::string& s)
+        {
+          store_backup_file(
+            pre, path, encode_backup(s, threshold),
+            settings->durability, settings->committer);
+        };
     }
+
+    // Measure every kind of store on whichever thread ends up writing it
+    store = [store = std::move(store)](const std::string& s)
+      {
+        RMF_TASK_TRACE_SPAN("BackupFileManager::write");
+        const Metrics::ScopedLatency latency(Metrics::Latency::backup_write);
+        store(s);
+        Metrics::add(Metrics::Counter::backup_writes);
+        Metrics::add(Metrics::Counter::backup_bytes, s.size());
+      };
+
+    if (!settings->asynchronous_write)
+      return store(*state);
+
+    wrote_asynchronously = true;
+    AsyncBackupWriter::get().push(
+      backup_file_path, state, std::move(store),
+      [settings = settings, path = backup_file_path](const std::string& error)
+      {
+        const std::string msg =
+          "[BackupFileManager::Robot::write] Failed to write backup to ["
+          + path + "]: " + error;
+        if (settings->info_logger)
+          settings->info_logger(msg);
+        else
+          std::cout << msg << std::endl;
+      });
   }
 
   void clear_backup()
   {
+    if (replication)
+      replication->record(robot_name, last_seq.value_or(0), nullptr);
+
+    if (store)
+      return store->clear(robot_name);
+
     if (std::filesystem::exists(robot_directory))
       std::filesystem::remove(pre_backup_file_path);
     std::filesystem::remove(backup_file_path);
+    std::filesystem::remove(pre_journal_file_path);
+    std::filesystem::remove(journal_file_path);
   }
 
 };
@@ -218,6 +1456,73 @@ BackupFileManager& BackupFileManager::clear_on_shutdown(bool value)
   return *this;
 }
 
+//==============================================================================
+BackupFileManager& BackupFileManager::asynchronous_write(bool value)
+{
+  _pimpl->settings->asynchronous_write = value;
+  return *this;
+}
+
+//==============================================================================
+BackupFileManager& BackupFileManager::durability(
+  const Durability value,
+  const rmf_traffic::Duration group_commit_period)
+{
+  auto& settings = *_pimpl->settings;
+  settings.durability = value;
+  if (value == Durability::GroupCommit)
+    settings.committer = std::make_shared<GroupCommitter>(group_commit_period);
+  else
+    settings.committer = nullptr;
+
+  return *this;
+}
+
+//==============================================================================
+BackupFileManager& BackupFileManager::journal(
+  const bool value,
+  const std::size_t compaction_records,
+  const std::size_t compaction_bytes)
+{
+  auto& settings = *_pimpl->settings;
+  settings.journal = value;
+  settings.journal_compaction_records = compaction_records;
+  settings.journal_compaction_bytes = compaction_bytes;
+  return *this;
+}
+
+//==============================================================================
+BackupFileManager& BackupFileManager::consolidated_store(
+  const bool value,
+  const std::size_t slot_capacity)
+{
+  auto& settings = *_pimpl->settings;
+  settings.consolidated_store = value;
+  settings.store_slot_capacity = slot_capacity;
+  return *this;
+}
+
+//==============================================================================
+BackupFileManager& BackupFileManager::compression(
+  const bool value,
+  const std::size_t threshold)
+{
+  auto& settings = *_pimpl->settings;
+  settings.compression = value;
+  settings.compression_threshold = threshold;
+  return *this;
+}
+
+//==============================================================================
+bool BackupFileManager::compression_available()
+{
+#ifdef RMF_TASK_HAVE_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
 //==============================================================================
 auto BackupFileManager::make_group(std::string name) -> std::shared_ptr<Group>
 {
@@ -254,12 +1559,126 @@ auto BackupFileManager::Group::make_robot(std::string name)
 
   auto robot = Robot::Implementation::make(
     _pimpl->group_directory / std::filesystem::path(std::move(name)),
-    _pimpl->settings);
+    _pimpl->settings,
+    _pimpl->store,
+    _pimpl->compression_threshold,
+    _pimpl->replication);
 
   it->second = robot;
   return robot;
 }
 
+//==============================================================================
+auto BackupFileManager::Group::compression_threshold(std::size_t threshold)
+-> Group&
+{
+  _pimpl->compression_threshold->store(threshold);
+  return *this;
+}
+
+//==============================================================================
+auto BackupFileManager::Group::replicate(
+  std::shared_ptr<ReplicationSink> sink,
+  const rmf_traffic::Duration period) -> Group&
+{
+  _pimpl->replication->start(std::move(sink), period);
+  return *this;
+}
+
+//==============================================================================
+void BackupFileManager::Group::load(
+  const std::vector<ReplicationSink::Entry>& entries)
+{
+  for (const auto& entry : entries)
+  {
+    auto robot = make_robot(entry.robot);
+    Robot::Implementation::get(*robot).load(entry);
+    if (entry.state)
+      _pimpl->loaded[entry.robot] = std::move(robot);
+    else
+      _pimpl->loaded.erase(entry.robot);
+  }
+}
+
+//==============================================================================
+std::vector<std::string> BackupFileManager::Group::restore_all(
+  const Restore& restore,
+  const std::size_t num_threads)
+{
+  std::vector<std::string> names;
+  if (_pimpl->store)
+  {
+    names = _pimpl->store->robots();
+  }
+  else
+  {
+    for (const auto& entry :
+      std::filesystem::directory_iterator(_pimpl->group_directory))
+    {
+      if (entry.is_directory())
+        names.push_back(entry.path().filename().string());
+    }
+  }
+  std::sort(names.begin(), names.end());
+
+  // Making the handles changes the group, so that is done before any of the
+  // threads begin
+  std::vector<std::shared_ptr<Robot>> robots;
+  robots.reserve(names.size());
+  for (const auto& name : names)
+    robots.push_back(make_robot(name));
+
+  // The handles of loaded robots are handed to the restore callback from here
+  _pimpl->loaded.clear();
+
+  const std::size_t N = robots.size();
+  std::atomic_size_t next = 0;
+  std::mutex mutex;
+  std::vector<std::string> restored;
+  std::exception_ptr error;
+  const auto work = [&]()
+    {
+      std::size_t i;
+      while ((i = next++) < N)
+      {
+        try
+        {
+          auto backup = robots[i]->read();
+          if (!backup.has_value())
+            continue;
+
+          restore(names[i], robots[i], std::move(*backup));
+
+          std::lock_guard<std::mutex> lock(mutex);
+          restored.push_back(names[i]);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error)
+            error = std::current_exception();
+        }
+      }
+    };
+
+  std::size_t threads = num_threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < std::min(threads, N); ++i)
+    workers.emplace_back(work);
+
+  work();
+  for (auto& worker : workers)
+    worker.join();
+
+  if (error)
+    std::rethrow_exception(error);
+
+  return restored;
+}
+
 //==============================================================================
 BackupFileManager::Group::Group()
 {
@@ -269,6 +1688,18 @@ BackupFileManager::Group::Group()
 //==============================================================================
 std::optional<std::string> BackupFileManager::Robot::read() const
 {
+  // Make sure the file is not being written while it is read
+  _pimpl->flush();
+
+  if (_pimpl->store)
+  {
+    const auto state = _pimpl->store->read(_pimpl->robot_name);
+    if (!state.has_value())
+      return std::nullopt;
+
+    return decode_backup(*state);
+  }
+
   if (!std::filesystem::exists(_pimpl->robot_directory))
   {
     throw std::runtime_error("[BackupFileManager::Robot::read] Directory " +
@@ -286,7 +1717,9 @@ std::optional<std::string> BackupFileManager::Robot::read() const
   {
     auto filename = p.path().filename().string();
     if (filename.compare(_pimpl->backup_file_name) != 0 &&
-      filename.compare(_pimpl->pre_backup_file_name) != 0)
+      filename.compare(_pimpl->pre_backup_file_name) != 0 &&
+      filename.compare(_pimpl->journal_file_name) != 0 &&
+      filename.compare(_pimpl->pre_journal_file_name) != 0)
     {
       throw std::runtime_error("[BackupFileManager::Robot::read] Foreign file " +
               filename + " found. This should be removed.");
@@ -304,7 +1737,8 @@ std::optional<std::string> BackupFileManager::Robot::read() const
       std::filesystem::remove(_pimpl->pre_backup_file_path);
     }
 
-    std::ifstream backup(_pimpl->backup_file_path, std::ios::in);
+    std::ifstream backup(
+      _pimpl->backup_file_path, std::ios::in | std::ios::binary);
     if (!backup)
       throw std::runtime_error(
               "Could not open file " + _pimpl->backup_file_path +
@@ -313,7 +1747,16 @@ std::optional<std::string> BackupFileManager::Robot::read() const
     {
       std::stringstream buffer;
       buffer << backup.rdbuf();
-      return std::optional(buffer.str());
+      auto snapshot = decode_backup(buffer.str());
+      if (!std::filesystem::exists(_pimpl->journal_file_path))
+        return std::optional(std::move(snapshot));
+
+      std::ifstream journal(
+        _pimpl->journal_file_path, std::ios::in | std::ios::binary);
+      std::stringstream journal_buffer;
+      journal_buffer << journal.rdbuf();
+      return BackupJournal::replay(
+        std::move(snapshot), journal_buffer.str());
     }
   }
   else
@@ -324,6 +1767,10 @@ std::optional<std::string> BackupFileManager::Robot::read() const
       std::filesystem::remove(_pimpl->pre_backup_file_path);
     }
 
+    // A journal without a snapshot cannot be replayed
+    std::filesystem::remove(_pimpl->journal_file_path);
+    std::filesystem::remove(_pimpl->pre_journal_file_path);
+
     return std::nullopt;
   }
 
@@ -335,6 +1782,12 @@ void BackupFileManager::Robot::write(const Task::Active::Backup& backup)
   _pimpl->write_if_new(backup);
 }
 
+//==============================================================================
+void BackupFileManager::Robot::flush()
+{
+  _pimpl->flush();
+}
+
 //==============================================================================
 BackupFileManager::Robot::Robot()
 {
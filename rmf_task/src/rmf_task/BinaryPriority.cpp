@@ -32,4 +32,16 @@ std::size_t BinaryPriority::value() const
   return _value;
 }
 
+//==============================================================================
+std::size_t BinaryPriority::level(const ConstPriorityPtr& priority)
+{
+  if (!priority)
+    return 0;
+
+  if (const auto* leveled = dynamic_cast<const BinaryPriority*>(&*priority))
+    return leveled->value();
+
+  return 1;
+}
+
 }
\ No newline at end of file
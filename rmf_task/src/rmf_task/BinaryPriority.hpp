@@ -20,9 +20,13 @@
 
 #include "Priority.hpp"
 
+#include <cstddef>
+
 namespace rmf_task {
 
-// Sample implementation for binary prioritization scheme
+// Sample implementation for binary prioritization scheme. The value is a
+// priority level where higher levels are more urgent, so it also serves the
+// IntegerPriorityScheme. The high priority of the binary scheme is level 1.
 class BinaryPriority : public Priority
 {
 public:
@@ -33,6 +37,10 @@ public:
   /// Get the value of this priority object
   std::size_t value() const;
 
+  /// Get the level of any priority. A nullptr is level 0, and a priority
+  /// from some other prioritization scheme is level 1.
+  static std::size_t level(const ConstPriorityPtr& priority);
+
 private:
   std::size_t _value;
 };
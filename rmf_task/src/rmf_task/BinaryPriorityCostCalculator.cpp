@@ -20,15 +20,16 @@
 
 #include <rmf_task/requests/ChargeBattery.hpp>
 
+#include <algorithm>
+
 namespace rmf_task {
 
 //==============================================================================
 auto BinaryPriorityCostCalculator::compute_g_assignment(
-  const TaskPlanner::Assignment& assignment) const -> double
+  const TaskPlanner::Assignment& assignment,
+  const bool is_charging) const -> double
 {
-  if (std::dynamic_pointer_cast<
-      const rmf_task::requests::ChargeBattery::Description>(
-      assignment.request()->description()))
+  if (is_charging)
   {
     return 0.0; // Ignore charging tasks in cost
   }
@@ -38,6 +39,13 @@ auto BinaryPriorityCostCalculator::compute_g_assignment(
     - assignment.request()->booking()->earliest_start_time());
 }
 
+//==============================================================================
+auto BinaryPriorityCostCalculator::compute_assignment_cost(
+  const Node::AssignmentWrapper& assignment) const -> double
+{
+  return compute_g_assignment(assignment.assignment, assignment.is_charging);
+}
+
 //==============================================================================
 auto BinaryPriorityCostCalculator::compute_g(
   const Assignments& assigned_tasks) const -> double
@@ -47,7 +55,14 @@ auto BinaryPriorityCostCalculator::compute_g(
   {
     for (const auto& assignment : agent)
     {
-      cost += compute_g_assignment(assignment);
+      // Assignments that are handed back by the planner do not carry a
+      // charging flag, so their request description needs to be inspected.
+      // A plain dynamic_cast avoids touching the reference count of the
+      // description for every assignment.
+      const bool is_charging = dynamic_cast<
+        const rmf_task::requests::ChargeBattery::Description*>(
+        assignment.request()->description().get()) != nullptr;
+      cost += compute_g_assignment(assignment, is_charging);
     }
   }
 
@@ -58,59 +73,64 @@ auto BinaryPriorityCostCalculator::compute_g(
 auto BinaryPriorityCostCalculator::compute_g(
   const Node& node) const -> double
 {
-  double cost = 0.0;
-  for (const auto& agent : node.assigned_tasks)
-  {
-    for (const auto& assignment : agent)
-    {
-      cost += compute_g_assignment(assignment.assignment);
-    }
-  }
-  return cost;
+  // Each assignment's cost was computed by compute_assignment_cost() when it
+  // was added to the node
+  return node.accumulated_cost;
 }
 
 //==============================================================================
 auto BinaryPriorityCostCalculator::compute_h(
   const Node& node, const rmf_traffic::Time time_now) const -> double
 {
-  std::vector<double> initial_queue_values(
-    node.assigned_tasks.size(), std::numeric_limits<double>::infinity());
+  // Each thread reuses the same buffer for the queue so that evaluating a node
+  // does not allocate
+  thread_local std::vector<Ticks> buffer;
+  std::vector<Ticks> initial_queue_values = std::move(buffer);
+  initial_queue_values.assign(
+    node.assigned_tasks.size(), std::numeric_limits<Ticks>::max());
+
+  // No task can finish before the best finish time among its candidates: an
+  // agent only gets to it later, and from further along its timeline, when
+  // other tasks are assigned first. That time already includes the travel to
+  // the task and the wait for its earliest start time, so it gives a bound on
+  // the cost of each task on its own.
+  Ticks time_window_bound = 0;
 
   // Determine the earliest possible time an agent can begin the invariant
   // portion of any of its next tasks
   for (const auto& u : node.unassigned_tasks)
   {
-    const auto invariant_duration = u.second.model->invariant_duration();
-    const rmf_traffic::Time earliest_deployment_time =
-      u.second.candidates.best_finish_time()
-      - invariant_duration;
-    const double earliest_deployment_time_s =
-      rmf_traffic::time::to_seconds(
-      earliest_deployment_time.time_since_epoch());
-
-    const auto& range = u.second.candidates.best_candidates();
+    const auto best_finish_time = u.second.candidates->best_finish_time();
+    const auto& booking = *u.second.request()->booking();
+    time_window_bound += std::max<Ticks>(
+      0, to_ticks(best_finish_time - booking.earliest_start_time()));
+
+    const auto invariant_duration = u.second.model()->invariant_duration();
+    const Ticks earliest_deployment_time =
+      to_ticks(best_finish_time - invariant_duration);
+
+    const auto& range = u.second.candidates->best_candidates();
     for (auto it = range.begin; it != range.end; ++it)
     {
-      const std::size_t candidate = it->second.candidate;
-      if (earliest_deployment_time_s < initial_queue_values[candidate])
-        initial_queue_values[candidate] = earliest_deployment_time_s;
+      const std::size_t candidate = it->candidate;
+      if (earliest_deployment_time < initial_queue_values[candidate])
+        initial_queue_values[candidate] = earliest_deployment_time;
     }
   }
 
   for (std::size_t i = 0; i < initial_queue_values.size(); ++i)
   {
     auto& value = initial_queue_values[i];
-    if (std::isinf(value))
+    if (value == std::numeric_limits<Ticks>::max())
     {
-      // Clear out any infinity placeholders. Those candidates simply don't have
-      // any unassigned tasks that want to use it.
-      const auto& assignments = node.assigned_tasks[i];
+      // Clear out any placeholders. Those candidates simply don't have any
+      // unassigned tasks that want to use it.
+      const auto& assignments = *node.assigned_tasks[i];
       if (assignments.empty())
-        value = rmf_traffic::time::to_seconds(time_now.time_since_epoch());
+        value = to_ticks(time_now);
       else
-        value = rmf_traffic::time::to_seconds(
-          assignments.back().assignment.finish_state()
-          .time().value().time_since_epoch());
+        value = to_ticks(
+          assignments.back().assignment.finish_state().time().value());
     }
   }
 
@@ -119,79 +139,27 @@ auto BinaryPriorityCostCalculator::compute_h(
   // here. The InvariantHeuristicQueue expects the invariant costs to be passed
   // to it in order of smallest to largest. If that assumption is not met, then
   // the final cost that's calculated may be invalid.
-  for (const auto& u : node.unassigned_invariants)
+  for (const auto& u : *node.unassigned_invariants)
   {
     queue.add(u.earliest_start_time, u.earliest_finish_time);
   }
-  return queue.compute_cost();
+
+  // The queue accounts for tasks having to wait for each other on the same
+  // agent while the time window bound accounts for the travel and waiting of
+  // each task. Both are admissible, so the larger of them is as well.
+  const double cost =
+    std::max(queue.compute_cost(), ticks_to_seconds(time_window_bound));
+  buffer = queue.release();
+  return cost;
 }
 
 //==============================================================================
 bool BinaryPriorityCostCalculator::valid_assignment_priority(
   const Node& node) const
 {
-  // STEP 1: Checking for validity across agents
-  const std::size_t num_agents = node.assigned_tasks.size();
-  // Number of priority tasks assigned for each agent
-  std::vector<std::size_t> priority_count;
-  priority_count.resize(num_agents, 0);
-  for (std::size_t i = 0; i < num_agents; ++i)
-  {
-    const auto& assignments = node.assigned_tasks[i];
-    for (const auto& a : assignments)
-    {
-      if (a.assignment.request()->booking()->priority() != nullptr)
-        priority_count[i] += 1;
-    }
-  }
-  // Here we check if any of the agents is not assigned a priority task
-  // while others are assigned more than one
-  const std::size_t max_priority_count = *std::max_element(
-    priority_count.begin(), priority_count.end());
-  if (max_priority_count > 1)
-  {
-    for (const auto& c : priority_count)
-    {
-      if (c == 0)
-        return false;
-    }
-  }
-
-  // STEP 2: Checking for validity within assignments of an agent
-  const auto& assignments = node.assigned_tasks;
-  for (const auto& agent : assignments)
-  {
-    if (agent.empty())
-      continue;
-
-    auto it = agent.begin();
-    // We update the iterator such that the first assignment is a non-charging task
-    while (std::dynamic_pointer_cast<
-        const rmf_task::requests::ChargeBattery::Description>(
-        it->assignment.request()->description()))
-    {
-      ++it;
-      if (it == agent.end())
-        return true;
-    }
-
-    auto prev_priority = it->assignment.request()->booking()->priority();
-    ++it;
-    for (; it != agent.end(); ++it)
-    {
-      if (std::dynamic_pointer_cast<
-          const rmf_task::requests::ChargeBattery::Description>(
-          it->assignment.request()->description()))
-        continue;
-      auto curr_priority = it->assignment.request()->booking()->priority();
-      if ((prev_priority == nullptr) && (curr_priority != nullptr))
-        return false;
-
-      prev_priority = curr_priority;
-    }
-  }
-
-  return true;
+  // The node keeps per-agent priority counters up to date as assignments are
+  // added, so this check does not need to visit every assignment
+  return node.valid_priority_order();
 }
 
 //==============================================================================
@@ -207,6 +175,15 @@ double BinaryPriorityCostCalculator::compute_cost(
   const Node& n,
   rmf_traffic::Time time_now,
   bool check_priority) const
+{
+  return compute_node_cost(n, time_now, check_priority).total;
+}
+
+//==============================================================================
+auto BinaryPriorityCostCalculator::compute_node_cost(
+  const Node& n,
+  rmf_traffic::Time time_now,
+  bool check_priority) const -> NodeCost
 {
   const double g = compute_g(n);
   const double h = compute_h(n, time_now);
@@ -214,15 +191,15 @@ double BinaryPriorityCostCalculator::compute_cost(
   if (check_priority)
   {
     if (!valid_assignment_priority(n))
-      return _priority_penalty * (g + h);
+      return NodeCost{_priority_penalty * (g + h), _priority_penalty * h};
   }
 
-  return g + h;
+  return NodeCost{g + h, h};
 }
 
 //==============================================================================
 double BinaryPriorityCostCalculator::compute_cost(
-  rmf_task::TaskPlanner::Assignments assignments) const
+  const rmf_task::TaskPlanner::Assignments& assignments) const
 {
   return compute_g(assignments);
 }
@@ -37,16 +37,28 @@ public:
     rmf_traffic::Time time_now,
     bool check_priority) const final;
 
+  /// Documentation inherited
+  NodeCost compute_node_cost(
+    const Node& n,
+    rmf_traffic::Time time_now,
+    bool check_priority) const final;
+
   /// Compute the cost of assignments
   double compute_cost(
-    rmf_task::TaskPlanner::Assignments assignments) const final;
+    const rmf_task::TaskPlanner::Assignments& assignments) const final;
+
+  /// Documentation inherited
+  double compute_assignment_cost(
+    const Node::AssignmentWrapper& assignment) const final;
 
 private:
   using Assignments = TaskPlanner::Assignments;
 
   double _priority_penalty;
 
-  double compute_g_assignment(const TaskPlanner::Assignment& assignment) const;
+  double compute_g_assignment(
+    const TaskPlanner::Assignment& assignment,
+    bool is_charging) const;
 
   double compute_g(const Assignments& assigned_tasks) const;
 
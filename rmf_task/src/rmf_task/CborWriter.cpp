@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/CborWriter.hpp>
+
+#include <chrono>
+#include <cstring>
+
+namespace rmf_task {
+
+namespace {
+//==============================================================================
+// The major types of CBOR items
+enum Major : uint8_t
+{
+  UnsignedInteger = 0,
+  NegativeInteger = 1,
+  TextString = 3,
+  Array = 4,
+  Map = 5,
+  Simple = 7
+};
+
+//==============================================================================
+const char* tier_name(Log::Tier tier)
+{
+  switch (tier)
+  {
+    case Log::Tier::Info: return "info";
+    case Log::Tier::Warning: return "warning";
+    case Log::Tier::Error: return "error";
+    default: return "uninitialized";
+  }
+}
+
+//==============================================================================
+const char* status_name(Event::Status status)
+{
+  using Status = Event::Status;
+  switch (status)
+  {
+    case Status::Blocked: return "blocked";
+    case Status::Error: return "error";
+    case Status::Failed: return "failed";
+    case Status::Standby: return "standby";
+    case Status::Underway: return "underway";
+    case Status::Delayed: return "delayed";
+    case Status::Skipped: return "skipped";
+    case Status::Canceled: return "canceled";
+    case Status::Killed: return "killed";
+    case Status::Completed: return "completed";
+    default: return "uninitialized";
+  }
+}
+
+//==============================================================================
+int64_t to_millis(rmf_traffic::Duration duration)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+    .count();
+}
+} // anonymous namespace
+
+//==============================================================================
+class CborWriter::Implementation
+{
+public:
+  std::vector<uint8_t>* buffer;
+
+  // Write the head of an item, which holds its major type and its argument
+  // in as few bytes as possible
+  void head(Major major, uint64_t argument)
+  {
+    const uint8_t type = static_cast<uint8_t>(major << 5);
+    if (argument < 24)
+    {
+      buffer->push_back(type | static_cast<uint8_t>(argument));
+    }
+    else if (argument <= 0xff)
+    {
+      buffer->push_back(type | 24);
+      buffer->push_back(static_cast<uint8_t>(argument));
+    }
+    else if (argument <= 0xffff)
+    {
+      buffer->push_back(type | 25);
+      big_endian(argument, 2);
+    }
+    else if (argument <= 0xffffffff)
+    {
+      buffer->push_back(type | 26);
+      big_endian(argument, 4);
+    }
+    else
+    {
+      buffer->push_back(type | 27);
+      big_endian(argument, 8);
+    }
+  }
+
+  void big_endian(uint64_t value, std::size_t bytes)
+  {
+    for (std::size_t i = bytes; i > 0; --i)
+      buffer->push_back(static_cast<uint8_t>(value >> (8*(i-1))));
+  }
+
+  void text(const char* value, std::size_t size)
+  {
+    head(TextString, size);
+    buffer->insert(buffer->end(), value, value + size);
+  }
+
+  void text(const char* value)
+  {
+    text(value, std::strlen(value));
+  }
+
+  void signed_integer(int64_t value)
+  {
+    if (value >= 0)
+      head(UnsignedInteger, static_cast<uint64_t>(value));
+    else
+      head(NegativeInteger, static_cast<uint64_t>(-(value + 1)));
+  }
+
+  void versioned(const VersionedString::View& view)
+  {
+    // A new reader always provides the current value
+    const auto value = VersionedString::Reader().read(view);
+    if (value)
+      text(value->data(), value->size());
+    else
+      text("", 0);
+  }
+};
+
+//==============================================================================
+CborWriter::CborWriter(std::vector<uint8_t>& buffer)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>(Implementation{&buffer}))
+{
+  // Do nothing
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_unsigned(const uint64_t value)
+{
+  _pimpl->head(UnsignedInteger, value);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_signed(const int64_t value)
+{
+  _pimpl->signed_integer(value);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_double(const double value)
+{
+  uint64_t bits;
+  static_assert(sizeof(bits) == sizeof(value), "Unexpected size of double");
+  std::memcpy(&bits, &value, sizeof(bits));
+  _pimpl->buffer->push_back(static_cast<uint8_t>(Simple << 5) | 27);
+  _pimpl->big_endian(bits, 8);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_bool(const bool value)
+{
+  _pimpl->head(Simple, value ? 21 : 20);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_null()
+{
+  _pimpl->head(Simple, 22);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write_text(const std::string& value)
+{
+  _pimpl->text(value.data(), value.size());
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::begin_array(const std::size_t size)
+{
+  _pimpl->head(Array, size);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::begin_map(const std::size_t size)
+{
+  _pimpl->head(Map, size);
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write(const Log::Entry& entry)
+{
+  auto& w = *_pimpl;
+  w.head(Map, 4);
+  w.text("seq");
+  w.head(UnsignedInteger, entry.seq());
+  w.text("tier");
+  w.text(tier_name(entry.tier()));
+  w.text("unix_millis_time");
+  w.signed_integer(to_millis(entry.time().time_since_epoch()));
+  w.text("text");
+  write_text(entry.text());
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write(const Log::View& view)
+{
+  std::vector<const Log::Entry*> entries;
+  view.entries_after(std::nullopt, entries);
+  _pimpl->head(Array, entries.size());
+  for (const auto* entry : entries)
+    write(*entry);
+
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write(const Event::State& state)
+{
+  auto& w = *_pimpl;
+  w.head(Map, 6);
+  w.text("id");
+  w.head(UnsignedInteger, state.id());
+  w.text("status");
+  w.text(status_name(state.status()));
+  w.text("name");
+  w.versioned(state.name());
+  w.text("detail");
+  w.versioned(state.detail());
+  w.text("log");
+  write(state.log());
+
+  const auto dependencies = state.dependencies();
+  w.text("deps");
+  w.head(Array, dependencies.size());
+  for (const auto& dependency : dependencies)
+  {
+    if (dependency)
+      write(*dependency);
+    else
+      write_null();
+  }
+
+  return *this;
+}
+
+//==============================================================================
+CborWriter& CborWriter::write(const Phase::Active& phase)
+{
+  auto& w = *_pimpl;
+  const auto tag = phase.tag();
+  w.head(Map, 6);
+  w.text("id");
+  w.head(UnsignedInteger, tag->id());
+  w.text("category");
+  write_text(tag->header().category());
+  w.text("detail");
+  write_text(tag->header().detail());
+  w.text("original_estimate_millis");
+  w.signed_integer(to_millis(tag->header().original_duration_estimate()));
+  w.text("estimate_millis");
+  w.signed_integer(to_millis(phase.estimate_remaining_time()));
+  w.text("final_event");
+  if (const auto final_event = phase.final_event())
+    write(*final_event);
+  else
+    write_null();
+
+  return *this;
+}
+
+//==============================================================================
+const std::vector<uint8_t>& CborWriter::buffer() const
+{
+  return *_pimpl->buffer;
+}
+
+} // namespace rmf_task
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ChargerPool.hpp"
+
+#include <algorithm>
+
+namespace rmf_task {
+
+//==============================================================================
+ChargerPool::ChargerPool(
+  std::vector<std::size_t> chargers,
+  ConstTravelEstimatorPtr travel_estimator,
+  const std::size_t num_waypoints)
+: _chargers(std::move(chargers)),
+  _travel_estimator(std::move(travel_estimator)),
+  _num_waypoints(num_waypoints),
+  _rows(std::make_unique<Row[]>(num_waypoints))
+{
+  // Do nothing
+}
+
+//==============================================================================
+const std::vector<std::size_t>& ChargerPool::chargers() const
+{
+  return _chargers;
+}
+
+//==============================================================================
+const std::vector<std::size_t>& ChargerPool::nearest(
+  const std::size_t waypoint) const
+{
+  if (waypoint >= _num_waypoints)
+    return _chargers;
+
+  Row& row = _rows[waypoint];
+  std::call_once(row.once, [&]()
+    {
+      std::vector<rmf_traffic::agv::Plan::Goal> goals;
+      goals.reserve(_chargers.size());
+      for (const auto charger : _chargers)
+        goals.push_back(rmf_traffic::agv::Plan::Goal(charger));
+
+      // The chargers are ordered by how long it takes to reach them, which
+      // does not depend on when the trip starts
+      const rmf_traffic::agv::Plan::Start start(
+        rmf_traffic::Time(), waypoint, 0.0);
+      const auto estimates = _travel_estimator->estimate(start, goals);
+
+      std::vector<std::pair<rmf_traffic::Duration, std::size_t>> reachable;
+      for (std::size_t i = 0; i < _chargers.size(); ++i)
+      {
+        if (_chargers[i] == waypoint)
+          reachable.push_back({rmf_traffic::Duration(0), _chargers[i]});
+        else if (estimates[i].has_value())
+          reachable.push_back({estimates[i]->duration(), _chargers[i]});
+      }
+
+      std::stable_sort(reachable.begin(), reachable.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+      row.order.reserve(reachable.size());
+      for (const auto& r : reachable)
+        row.order.push_back(r.second);
+    });
+
+  return row.order;
+}
+
+//==============================================================================
+PooledChargingModel::PooledChargingModel(
+  Task::ConstModelPtr base,
+  std::shared_ptr<const ChargerPool> pool)
+: _base(std::move(base)),
+  _pool(std::move(pool))
+{
+  // Do nothing
+}
+
+//==============================================================================
+std::optional<Estimate> PooledChargingModel::estimate_finish(
+  const State& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  const auto planning_state = PlanningState::from(initial_state);
+  if (!planning_state.has_value())
+    return std::nullopt;
+
+  const auto estimate = estimate_planning_finish(
+    *planning_state, task_planning_constraints, travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool PooledChargingModel::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto PooledChargingModel::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  const auto& nearest = _pool->nearest(initial_state.waypoint);
+  if (nearest.empty())
+    return std::nullopt;
+
+  PlanningState state = initial_state;
+  state.dedicated_charging_waypoint = nearest.front();
+  return _base->estimate_planning_finish(
+    state, task_planning_constraints, travel_estimator);
+}
+
+//==============================================================================
+rmf_traffic::Duration PooledChargingModel::invariant_duration() const
+{
+  return _base->invariant_duration();
+}
+
+//==============================================================================
+Task::ConstModelPtr PooledChargingModel::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  return std::make_shared<PooledChargingModel>(
+    _base->with_earliest_start_time(earliest_start_time), _pool);
+}
+
+//==============================================================================
+const Task::Model& PooledChargingModel::base() const
+{
+  return *_base;
+}
+
+} // namespace rmf_task
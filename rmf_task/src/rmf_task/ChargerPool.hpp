@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__CHARGERPOOL_HPP
+#define SRC__RMF_TASK__CHARGERPOOL_HPP
+
+#include <rmf_task/Estimate.hpp>
+#include <rmf_task/Task.hpp>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// The chargers that the agents of a planner share, with an index of which of
+// them are the fastest to reach from each waypoint.
+//
+// The order of the chargers for a waypoint is estimated with the travel
+// estimator the first time that it is needed, so the estimates come from its
+// cache and picking a charger from then on is a lookup. Chargers that cannot
+// be reached from a waypoint are left out of its order. The index can be read
+// and filled from several threads at once.
+class ChargerPool
+{
+public:
+
+  ChargerPool(
+    std::vector<std::size_t> chargers,
+    ConstTravelEstimatorPtr travel_estimator,
+    std::size_t num_waypoints);
+
+  const std::vector<std::size_t>& chargers() const;
+
+  // The chargers that can be reached from the waypoint, from the fastest to
+  // the slowest to reach. Waypoints outside of the graph get every charger of
+  // the pool in the order that they were given.
+  const std::vector<std::size_t>& nearest(std::size_t waypoint) const;
+
+  // The fastest charger to reach from the waypoint that is not in use
+  template<typename InUse>
+  std::optional<std::size_t> nearest_available(
+    const std::size_t waypoint,
+    const InUse& in_use) const
+  {
+    for (const auto charger : nearest(waypoint))
+    {
+      if (!in_use(charger))
+        return charger;
+    }
+
+    return std::nullopt;
+  }
+
+private:
+
+  struct Row
+  {
+    std::once_flag once;
+    std::vector<std::size_t> order;
+  };
+
+  std::vector<std::size_t> _chargers;
+  ConstTravelEstimatorPtr _travel_estimator;
+  std::size_t _num_waypoints;
+  std::unique_ptr<Row[]> _rows;
+};
+
+//==============================================================================
+// The model of implicit charging tasks for a planner with a charger pool. It
+// charges at the charger of the pool that is the fastest to reach, which
+// becomes the dedicated charger of its finish state, and otherwise estimates
+// the same as the base model.
+class PooledChargingModel : public Task::Model
+{
+public:
+
+  PooledChargingModel(
+    Task::ConstModelPtr base,
+    std::shared_ptr<const ChargerPool> pool);
+
+  std::optional<Estimate> estimate_finish(
+    const State& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  rmf_traffic::Duration invariant_duration() const final;
+
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
+  // The model that charges at the dedicated charger of its initial state
+  const Task::Model& base() const;
+
+private:
+  Task::ConstModelPtr _base;
+  std::shared_ptr<const ChargerPool> _pool;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__CHARGERPOOL_HPP
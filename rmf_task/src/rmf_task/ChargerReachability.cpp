@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include "ChargerReachability.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace rmf_task {
+
+namespace {
+//==============================================================================
+// The entry of a waypoint whose travel has not been estimated yet
+constexpr double Unknown = std::numeric_limits<double>::quiet_NaN();
+
+// The entry of a waypoint that the charger cannot be reached from
+constexpr double Unreachable = std::numeric_limits<double>::infinity();
+} // anonymous namespace
+
+//==============================================================================
+ChargerReachability::ChargerReachability(
+  const std::vector<State>& agents,
+  ConstTravelEstimatorPtr travel_estimator,
+  const std::size_t num_waypoints)
+: _travel_estimator(std::move(travel_estimator)),
+  _num_waypoints(num_waypoints)
+{
+  for (const auto& agent : agents)
+  {
+    const auto charger = agent.dedicated_charging_waypoint();
+    if (!charger.has_value() || *charger >= _num_waypoints || row(*charger))
+      continue;
+
+    Row new_row{*charger, std::make_unique<std::atomic<double>[]>(
+        _num_waypoints)};
+    for (std::size_t i = 0; i < _num_waypoints; ++i)
+      new_row.soc[i].store(Unknown, std::memory_order_relaxed);
+
+    new_row.soc[*charger].store(0.0, std::memory_order_relaxed);
+    _rows.push_back(std::move(new_row));
+  }
+
+  // Where the agents start from is always relevant, so those entries are
+  // filled in right away
+  for (const auto& agent : agents)
+  {
+    const auto charger = agent.dedicated_charging_waypoint();
+    const auto start = agent.extract_plan_start();
+    if (!charger.has_value() || !start.has_value())
+      continue;
+
+    const Row* r = row(*charger);
+    if (r && start->waypoint() < _num_waypoints)
+      lookup(*r, *start);
+  }
+}
+
+//==============================================================================
+bool ChargerReachability::can_reach(
+  const State& state,
+  const Constraints& constraints) const
+{
+  const auto charger = state.dedicated_charging_waypoint();
+  const auto waypoint = state.waypoint();
+  const auto battery_soc = state.battery_soc();
+  if (!charger.has_value() || !waypoint.has_value() || !battery_soc.has_value())
+    return true;
+
+  if (*waypoint == *charger)
+    return true;
+
+  const Row* r = row(*charger);
+  if (!r || *waypoint >= _num_waypoints)
+    return true;
+
+  const auto start = state.extract_plan_start();
+  if (!start.has_value())
+    return true;
+
+  const double soc = lookup(*r, *start);
+  if (std::isinf(soc))
+    return false;
+
+  if (!constraints.drain_battery())
+    return true;
+
+  // This is the same comparison that the charging model makes
+  return *battery_soc - soc > constraints.threshold_soc();
+}
+
+//==============================================================================
+std::size_t ChargerReachability::hits() const
+{
+  return _hits.load();
+}
+
+//==============================================================================
+std::size_t ChargerReachability::misses() const
+{
+  return _misses.load();
+}
+
+//==============================================================================
+auto ChargerReachability::row(const std::size_t charger) const -> const Row*
+{
+  // There are rarely more than a few chargers, so a linear search is fastest
+  for (const auto& r : _rows)
+  {
+    if (r.charger == charger)
+      return &r;
+  }
+
+  return nullptr;
+}
+
+//==============================================================================
+double ChargerReachability::lookup(
+  const Row& row,
+  const rmf_traffic::agv::Plan::Start& start) const
+{
+  auto& entry = row.soc[start.waypoint()];
+  const double known = entry.load(std::memory_order_acquire);
+  if (!std::isnan(known))
+  {
+    ++_hits;
+    return known;
+  }
+
+  // Two threads may both estimate the same entry, but the travel estimator
+  // only plans each pair of waypoints once, so they get the same value
+  ++_misses;
+  const auto travel = _travel_estimator->estimate(
+    start, rmf_traffic::agv::Plan::Goal(row.charger));
+  const double soc = travel.has_value() ? travel->change_in_charge() :
+    Unreachable;
+
+  entry.store(soc, std::memory_order_release);
+  return soc;
+}
+
+} // namespace rmf_task
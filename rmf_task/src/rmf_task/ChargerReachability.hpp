@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef SRC__RMF_TASK__CHARGERREACHABILITY_HPP
+#define SRC__RMF_TASK__CHARGERREACHABILITY_HPP
+
+#include <rmf_task/Constraints.hpp>
+#include <rmf_task/Estimate.hpp>
+#include <rmf_task/State.hpp>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// The state of charge that the agents of a plan need to get back to their
+// dedicated chargers from each waypoint.
+//
+// The table has a row for every charger of the agents and an entry in each
+// row for every waypoint. The entries of the waypoints that the agents start
+// from are calculated when the table is made, and the rest are filled in the
+// first time that they are needed. Every entry only ever gets one value, so
+// the table can be read and filled from several threads at once.
+//
+// This lets the planner rule out a charging task with a lookup instead of
+// evaluating the charging model, which would need a full estimate of the task.
+class ChargerReachability
+{
+public:
+
+  ChargerReachability(
+    const std::vector<State>& agents,
+    ConstTravelEstimatorPtr travel_estimator,
+    std::size_t num_waypoints);
+
+  // Whether a robot in this state can make it back to its charger without its
+  // battery falling to the threshold of the constraints. States whose charger
+  // or waypoint is not in the table are given the benefit of the doubt.
+  bool can_reach(const State& state, const Constraints& constraints) const;
+
+  // The number of lookups that did not need a new travel estimate
+  std::size_t hits() const;
+
+  // The number of entries that needed a new travel estimate
+  std::size_t misses() const;
+
+private:
+
+  struct Row
+  {
+    std::size_t charger;
+    std::unique_ptr<std::atomic<double>[]> soc;
+  };
+
+  const Row* row(std::size_t charger) const;
+
+  // Get the entry of a waypoint, calculating it from the start if it is not
+  // known yet
+  double lookup(
+    const Row& row,
+    const rmf_traffic::agv::Plan::Start& start) const;
+
+  ConstTravelEstimatorPtr _travel_estimator;
+  std::size_t _num_waypoints;
+  std::vector<Row> _rows;
+
+  mutable std::atomic_size_t _hits = 0;
+  mutable std::atomic_size_t _misses = 0;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__CHARGERREACHABILITY_HPP
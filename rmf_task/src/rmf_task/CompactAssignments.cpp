@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/CompactAssignments.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rmf_task {
+
+namespace {
+//==============================================================================
+constexpr uint64_t CompactMagic = 0x31617373'41747043; // "CptAssa1"
+
+//==============================================================================
+/// The number of bytes in the header of the buffer: the magic number, the
+/// number of assignments and the number of agents
+constexpr std::size_t HeaderBytes = 3 * sizeof(uint64_t);
+
+//==============================================================================
+/// The number of bytes that each assignment takes across all of the columns
+constexpr std::size_t RowBytes =
+  2 * sizeof(int64_t) + sizeof(uint64_t) + sizeof(double)
+  + 2 * sizeof(uint32_t);
+} // anonymous namespace
+
+//==============================================================================
+class CompactAssignments::Implementation
+{
+public:
+
+  /// The buffer is kept in words so that every column is aligned
+  std::vector<uint64_t> words;
+  std::size_t count = 0;
+  std::vector<ConstRequestPtr> generated;
+
+  void allocate(std::size_t n, std::size_t agents)
+  {
+    count = n;
+    words.assign((bytes() + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    words[0] = CompactMagic;
+    words[1] = n;
+    words[2] = agents;
+  }
+
+  std::size_t bytes() const
+  {
+    return HeaderBytes + count * RowBytes;
+  }
+
+  template<typename T>
+  T* column(std::size_t offset)
+  {
+    return reinterpret_cast<T*>(
+      reinterpret_cast<char*>(words.data()) + HeaderBytes + offset * count);
+  }
+
+  template<typename T>
+  const T* column(std::size_t offset) const
+  {
+    return reinterpret_cast<const T*>(
+      reinterpret_cast<const char*>(words.data()) + HeaderBytes
+      + offset * count);
+  }
+
+  // The columns with 8 byte values come first so that every column stays
+  // aligned
+  int64_t* deployment_times() { return column<int64_t>(0); }
+  int64_t* finish_times() { return column<int64_t>(8); }
+  uint64_t* finish_waypoints() { return column<uint64_t>(16); }
+  double* finish_socs() { return column<double>(24); }
+  uint32_t* agents() { return column<uint32_t>(32); }
+  uint32_t* request_indices() { return column<uint32_t>(36); }
+};
+
+//==============================================================================
+CompactAssignments::CompactAssignments(
+  const TaskPlanner::Assignments& assignments,
+  const std::vector<ConstRequestPtr>& requests)
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  std::unordered_map<const Request*, uint32_t> indices;
+  for (std::size_t i = 0; i < requests.size(); ++i)
+    indices.insert({requests[i].get(), static_cast<uint32_t>(i)});
+
+  std::size_t n = 0;
+  for (const auto& agent : assignments)
+    n += agent.size();
+
+  _pimpl->allocate(n, assignments.size());
+  const auto deployment_times = _pimpl->deployment_times();
+  const auto finish_times = _pimpl->finish_times();
+  const auto finish_waypoints = _pimpl->finish_waypoints();
+  const auto finish_socs = _pimpl->finish_socs();
+  const auto agents = _pimpl->agents();
+  const auto request_indices = _pimpl->request_indices();
+
+  std::size_t row = 0;
+  for (std::size_t a = 0; a < assignments.size(); ++a)
+  {
+    for (const auto& assignment : assignments[a])
+    {
+      const auto& state = assignment.finish_state();
+      agents[row] = static_cast<uint32_t>(a);
+
+      const auto it = indices.find(assignment.request().get());
+      if (it != indices.end())
+      {
+        request_indices[row] = it->second;
+      }
+      else
+      {
+        request_indices[row] =
+          static_cast<uint32_t>(requests.size() + _pimpl->generated.size());
+        _pimpl->generated.push_back(assignment.request());
+      }
+
+      deployment_times[row] =
+        assignment.deployment_time().time_since_epoch().count();
+      finish_times[row] = state.time().has_value() ?
+        state.time()->time_since_epoch().count() : deployment_times[row];
+      finish_waypoints[row] = state.waypoint().value_or(NoWaypoint);
+      finish_socs[row] = state.battery_soc().value_or(std::nan(""));
+      ++row;
+    }
+  }
+}
+
+//==============================================================================
+CompactAssignments CompactAssignments::from_bytes(
+  const void* data,
+  std::size_t size)
+{
+  uint64_t header[3];
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (size < HeaderBytes)
+    throw std::invalid_argument("Compact assignments are truncated");
+  // *INDENT-ON*
+
+  std::memcpy(header, data, HeaderBytes);
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (header[0] != CompactMagic)
+    throw std::invalid_argument("The bytes are not compact assignments");
+
+  if (header[1] > (size - HeaderBytes) / RowBytes
+    || HeaderBytes + header[1] * RowBytes != size)
+    throw std::invalid_argument(
+      "The size of compact assignments does not match their header");
+  // *INDENT-ON*
+
+  CompactAssignments result;
+  result._pimpl->allocate(header[1], header[2]);
+  std::memcpy(result._pimpl->words.data(), data, size);
+  return result;
+}
+
+//==============================================================================
+std::size_t CompactAssignments::size() const
+{
+  return _pimpl->count;
+}
+
+//==============================================================================
+std::size_t CompactAssignments::num_agents() const
+{
+  return _pimpl->words[2];
+}
+
+//==============================================================================
+const uint32_t* CompactAssignments::agents() const
+{
+  return _pimpl->column<uint32_t>(32);
+}
+
+//==============================================================================
+const uint32_t* CompactAssignments::request_indices() const
+{
+  return _pimpl->column<uint32_t>(36);
+}
+
+//==============================================================================
+const int64_t* CompactAssignments::deployment_times() const
+{
+  return _pimpl->column<int64_t>(0);
+}
+
+//==============================================================================
+const int64_t* CompactAssignments::finish_times() const
+{
+  return _pimpl->column<int64_t>(8);
+}
+
+//==============================================================================
+const uint64_t* CompactAssignments::finish_waypoints() const
+{
+  return _pimpl->column<uint64_t>(16);
+}
+
+//==============================================================================
+const double* CompactAssignments::finish_socs() const
+{
+  return _pimpl->column<double>(24);
+}
+
+//==============================================================================
+rmf_traffic::Time CompactAssignments::deployment_time(std::size_t i) const
+{
+  return rmf_traffic::Time(rmf_traffic::Duration(deployment_times()[i]));
+}
+
+//==============================================================================
+State CompactAssignments::finish_state(std::size_t i) const
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (i >= size())
+    throw std::out_of_range(
+      "Assignment " + std::to_string(i) + " is out of range for "
+      + std::to_string(size()) + " compact assignments");
+  // *INDENT-ON*
+
+  State state;
+  state.time(rmf_traffic::Time(rmf_traffic::Duration(finish_times()[i])));
+  if (finish_waypoints()[i] != NoWaypoint)
+    state.waypoint(finish_waypoints()[i]);
+  if (!std::isnan(finish_socs()[i]))
+    state.battery_soc(finish_socs()[i]);
+
+  return state;
+}
+
+//==============================================================================
+const std::vector<ConstRequestPtr>&
+CompactAssignments::generated_requests() const
+{
+  return _pimpl->generated;
+}
+
+//==============================================================================
+const void* CompactAssignments::data() const
+{
+  return _pimpl->words.data();
+}
+
+//==============================================================================
+std::size_t CompactAssignments::size_bytes() const
+{
+  return _pimpl->bytes();
+}
+
+//==============================================================================
+CompactAssignments::CompactAssignments()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+} // namespace rmf_task
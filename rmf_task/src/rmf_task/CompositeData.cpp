@@ -17,22 +17,108 @@
 
 #include <rmf_task/CompositeData.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace rmf_task {
 
+namespace detail {
+//==============================================================================
+std::size_t composite_data_index(std::type_index type)
+{
+  // The index of a type is looked up by its type_index instead of being
+  // counted by each instantiation of composite_data_index<T>(), because each
+  // library of a process may have its own instantiation.
+  static std::mutex mutex;
+  static std::unordered_map<std::type_index, std::size_t> indices;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return indices.insert({type, indices.size()}).first->second;
+}
+} // namespace detail
+
 //==============================================================================
 class CompositeData::Implementation
 {
 public:
 
-  std::unordered_map<std::type_index, std::any> data;
+  // The types with the lowest indices, which are usually the components of
+  // State, are stored in slots that are found by their index. Empty slots
+  // hold an empty std::any.
+  static constexpr std::size_t NumSlots = 8;
+  std::array<std::any, NumSlots> slots;
+
+  // Any other types are sorted by their index. Their values are kept on the
+  // heap so that pointers to them stay valid when other values get inserted.
+  struct Extension
+  {
+    std::size_t index;
+    std::unique_ptr<std::any> value;
+  };
+  std::vector<Extension> extensions;
+
+  Implementation() = default;
+
+  Implementation(const Implementation& other)
+  : slots(other.slots)
+  {
+    extensions.reserve(other.extensions.size());
+    for (const auto& extension : other.extensions)
+    {
+      extensions.push_back(
+        {extension.index, std::make_unique<std::any>(*extension.value)});
+    }
+  }
+
+  Implementation& operator=(const Implementation& other)
+  {
+    Implementation copy(other);
+    *this = std::move(copy);
+    return *this;
+  }
+
+  Implementation(Implementation&&) = default;
+  Implementation& operator=(Implementation&&) = default;
+
+  std::vector<Extension>::iterator find_extension(std::size_t index)
+  {
+    return std::lower_bound(
+      extensions.begin(), extensions.end(), index,
+      [](const Extension& extension, std::size_t i)
+      {
+        return extension.index < i;
+      });
+  }
+
+  const std::any* find(std::size_t index) const
+  {
+    return const_cast<Implementation*>(this)->find(index);
+  }
+
+  std::any* find(std::size_t index)
+  {
+    if (index < NumSlots)
+    {
+      auto& slot = slots[index];
+      return slot.has_value() ? &slot : nullptr;
+    }
+
+    const auto it = find_extension(index);
+    if (it == extensions.end() || it->index != index)
+      return nullptr;
 
+    return it->value.get();
+  }
 };
 
 //==============================================================================
 CompositeData::CompositeData()
-: _pimpl(rmf_utils::make_impl<Implementation>())
+: _pimpl(std::make_shared<Implementation>())
 {
   // Do nothing
 }
@@ -40,45 +126,89 @@ CompositeData::CompositeData()
 //==============================================================================
 void CompositeData::clear()
 {
-  _pimpl->data.clear();
+  if (_pimpl.use_count() > 1)
+  {
+    // Leave the shared values to the other copies
+    _pimpl = std::make_shared<Implementation>();
+    return;
+  }
+
+  for (auto& slot : _pimpl->slots)
+    slot.reset();
+
+  _pimpl->extensions.clear();
+}
+
+//==============================================================================
+auto CompositeData::_mutable() -> Implementation&
+{
+  if (_pimpl.use_count() > 1)
+    _pimpl = std::make_shared<Implementation>(*_pimpl);
+  else
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+  return *_pimpl;
 }
 
 //==============================================================================
-std::any* CompositeData::_get(std::type_index type)
+std::any* CompositeData::_get(std::size_t index)
 {
-  const auto it = _pimpl->data.find(type);
-  if (it == _pimpl->data.end())
+  if (!_pimpl->find(index))
     return nullptr;
 
-  return &it->second;
+  // The caller may modify the value, so it must not be shared
+  return _mutable().find(index);
 }
 
 //==============================================================================
-const std::any* CompositeData::_get(std::type_index type) const
+const std::any* CompositeData::_get(std::size_t index) const
 {
-  return const_cast<CompositeData*>(this)->_get(type);
+  return _pimpl->find(index);
 }
 
 //==============================================================================
-auto CompositeData::_insert(std::any value, bool or_assign)
+auto CompositeData::_insert(
+  std::size_t index, std::any value, bool or_assign)
 -> InsertResult<std::any>
 {
-  if (or_assign)
+  auto& impl = _mutable();
+  std::any* existing = impl.find(index);
+  if (existing)
   {
-    const auto insertion =
-      _pimpl->data.insert_or_assign(value.type(), std::move(value));
+    if (or_assign)
+      *existing = std::move(value);
+
+    return {false, existing};
+  }
 
-    return {insertion.second, &insertion.first->second};
+  if (index < Implementation::NumSlots)
+  {
+    auto& slot = impl.slots[index];
+    slot = std::move(value);
+    return {true, &slot};
   }
 
-  const auto insertion = _pimpl->data.insert({value.type(), std::move(value)});
-  return {insertion.second, &insertion.first->second};
+  const auto it = impl.extensions.insert(
+    impl.find_extension(index),
+    {index, std::make_unique<std::any>(std::move(value))});
+  return {true, it->value.get()};
 }
 
 //==============================================================================
-bool CompositeData::_erase(std::type_index type)
+bool CompositeData::_erase(std::size_t index)
 {
-  return _pimpl->data.erase(type) > 0;
+  if (!_pimpl->find(index))
+    return false;
+
+  auto& impl = _mutable();
+  if (index < Implementation::NumSlots)
+  {
+    impl.slots[index].reset();
+    return true;
+  }
+
+  impl.extensions.erase(impl.find_extension(index));
+  return true;
 }
 
 } // namespace rmf_task
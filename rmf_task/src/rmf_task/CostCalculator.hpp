@@ -28,15 +28,59 @@ class CostCalculator
 {
 public:
 
+  /// The total cost of a node and the portion of it that is heuristic
+  struct NodeCost
+  {
+    double total;
+    double heuristic;
+  };
+
   /// Compute the total cost of a node while factoring in the prioritization scheme
   virtual double compute_cost(
     const Node& n,
     rmf_traffic::Time time_now,
     bool check_priority) const = 0;
 
+  /// Compute the total cost of a node along with its heuristic portion. By
+  /// default the whole cost is treated as accumulated cost.
+  virtual NodeCost compute_node_cost(
+    const Node& n,
+    rmf_traffic::Time time_now,
+    bool check_priority) const
+  {
+    return NodeCost{compute_cost(n, time_now, check_priority), 0.0};
+  }
+
+  /// Whether compute_node_costs() is faster than computing the cost of each
+  /// node on its own. When this is true the planner generates all the
+  /// children of a node before it computes their costs.
+  virtual bool batched() const
+  {
+    return false;
+  }
+
+  /// Compute the costs of many nodes at once. By default each node is passed
+  /// to compute_node_cost().
+  virtual void compute_node_costs(
+    const Node* const* nodes,
+    std::size_t count,
+    rmf_traffic::Time time_now,
+    bool check_priority,
+    NodeCost* output) const
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      output[i] = compute_node_cost(*nodes[i], time_now, check_priority);
+  }
+
   /// Compute the cost of assignments
   virtual double compute_cost(
-    rmf_task::TaskPlanner::Assignments assignments) const = 0;
+    const rmf_task::TaskPlanner::Assignments& assignments) const = 0;
+
+  /// Compute the cost that a single assignment contributes to the accumulated
+  /// cost of a node. This is cached in Node::AssignmentWrapper::cost when the
+  /// assignment is added to a node.
+  virtual double compute_assignment_cost(
+    const Node::AssignmentWrapper& assignment) const = 0;
 
   virtual ~CostCalculator() = default;
 };
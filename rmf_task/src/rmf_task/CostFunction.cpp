@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/CostFunction.hpp>
+#include <rmf_task/requests/ChargeBattery.hpp>
+
+#include "CostCalculator.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+// Gives a CostFunction the nodes of the planner as flat arrays
+class CostFunctionCalculator : public CostCalculator
+{
+public:
+
+  CostFunctionCalculator(std::shared_ptr<const CostFunction> function)
+  : _function(std::move(function))
+  {
+    // Do nothing
+  }
+
+  double compute_cost(
+    const Node& n,
+    rmf_traffic::Time time_now,
+    bool check_priority) const final
+  {
+    return compute_node_cost(n, time_now, check_priority).total;
+  }
+
+  NodeCost compute_node_cost(
+    const Node& n,
+    rmf_traffic::Time time_now,
+    bool check_priority) const final
+  {
+    NodeCost output;
+    const Node* const nodes[] = {&n};
+    compute_node_costs(nodes, 1, time_now, check_priority, &output);
+    return output;
+  }
+
+  bool batched() const final
+  {
+    return true;
+  }
+
+  void compute_node_costs(
+    const Node* const* nodes,
+    std::size_t count,
+    rmf_traffic::Time time_now,
+    bool check_priority,
+    NodeCost* output) const final
+  {
+    // Each thread reuses its buffers so that evaluating nodes does not
+    // allocate once the buffers are large enough
+    thread_local Buffers buffers;
+    buffers.clear();
+
+    // The arrays may still grow while the nodes are added, so the views only
+    // get their pointers afterwards
+    struct Offsets
+    {
+      std::size_t agents;
+      std::size_t unassigned;
+    };
+    thread_local std::vector<Offsets> offsets;
+    offsets.clear();
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const Node& node = *nodes[i];
+      offsets.push_back({buffers.finish_times.size(), buffers.requests.size()});
+      for (const auto& agent : node.assigned_tasks)
+      {
+        buffers.finish_times.push_back(agent->empty() ?
+          time_now : agent->back().assignment.finish_state().time().value());
+        buffers.num_assignments.push_back(agent->size());
+      }
+
+      for (const auto& u : node.unassigned_tasks)
+      {
+        buffers.requests.push_back(u.second.request().get());
+        buffers.best_finish_times.push_back(
+          u.second.candidates->best_finish_time());
+      }
+    }
+
+    buffers.views.resize(count);
+    buffers.costs.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const Node& node = *nodes[i];
+      auto& view = buffers.views[i];
+      view.accumulated_cost = node.accumulated_cost;
+      view.num_agents = node.assigned_tasks.size();
+      view.agent_finish_times = buffers.finish_times.data() + offsets[i].agents;
+      view.agent_num_assignments =
+        buffers.num_assignments.data() + offsets[i].agents;
+      view.num_unassigned = node.unassigned_tasks.size();
+      view.unassigned_requests =
+        buffers.requests.data() + offsets[i].unassigned;
+      view.unassigned_best_finish_times =
+        buffers.best_finish_times.data() + offsets[i].unassigned;
+      view.valid_priority_order =
+        !check_priority || node.valid_priority_order();
+    }
+
+    _function->evaluate_batch(
+      buffers.views.data(), count, time_now, buffers.costs.data());
+
+    for (std::size_t i = 0; i < count; ++i)
+      output[i] = NodeCost{buffers.costs[i].total, buffers.costs[i].heuristic};
+  }
+
+  double compute_cost(
+    const TaskPlanner::Assignments& assignments) const final
+  {
+    return _function->compute_cost(assignments);
+  }
+
+  double compute_assignment_cost(
+    const Node::AssignmentWrapper& assignment) const final
+  {
+    return _function->assignment_cost(
+      assignment.assignment, assignment.is_charging);
+  }
+
+private:
+
+  struct Buffers
+  {
+    std::vector<rmf_traffic::Time> finish_times;
+    std::vector<std::size_t> num_assignments;
+    std::vector<const Request*> requests;
+    std::vector<rmf_traffic::Time> best_finish_times;
+    std::vector<CostFunction::NodeView> views;
+    std::vector<CostFunction::Cost> costs;
+
+    void clear()
+    {
+      finish_times.clear();
+      num_assignments.clear();
+      requests.clear();
+      best_finish_times.clear();
+    }
+  };
+
+  std::shared_ptr<const CostFunction> _function;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+auto CostFunction::evaluate(
+  const NodeView& node,
+  rmf_traffic::Time) const -> Cost
+{
+  return Cost{node.accumulated_cost, 0.0};
+}
+
+//==============================================================================
+void CostFunction::evaluate_batch(
+  const NodeView* nodes,
+  const std::size_t count,
+  const rmf_traffic::Time time_now,
+  Cost* costs) const
+{
+  for (std::size_t i = 0; i < count; ++i)
+    costs[i] = evaluate(nodes[i], time_now);
+}
+
+//==============================================================================
+double CostFunction::compute_cost(const Assignments& assignments) const
+{
+  double cost = 0.0;
+  for (const auto& agent : assignments)
+  {
+    for (const auto& assignment : agent)
+    {
+      const bool is_charging = dynamic_cast<
+        const rmf_task::requests::ChargeBattery::Description*>(
+        assignment.request()->description().get()) != nullptr;
+      cost += assignment_cost(assignment, is_charging);
+    }
+  }
+
+  return cost;
+}
+
+//==============================================================================
+CostCalculatorPtr CostFunction::make_cost_calculator(
+  std::shared_ptr<const CostFunction> function)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!function)
+  {
+    throw std::invalid_argument(
+      "[rmf_task::CostFunction::make_cost_calculator] The cost function must "
+      "not be a nullptr");
+  }
+  // *INDENT-ON*
+
+  return std::make_shared<CostFunctionCalculator>(std::move(function));
+}
+
+} // namespace rmf_task
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "DrainMemo.hpp"
+#include "Hasher.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+// The drains of one motion sink
+struct SinkDrains
+{
+  std::weak_ptr<const rmf_battery::MotionPowerSink> sink;
+  std::unordered_map<uint64_t, double> drains;
+};
+
+//==============================================================================
+// Each sink forgets its drains once it holds this many, so that a process
+// which plans for a long time does not grow without bound
+constexpr std::size_t max_drains_per_sink = 1 << 16;
+
+//==============================================================================
+std::mutex memo_mutex;
+std::vector<SinkDrains> memo;
+
+//==============================================================================
+// Find the drains of the sink, and drop the drains of expired sinks along the
+// way. The memo mutex must be locked.
+SinkDrains& drains_of(const rmf_battery::ConstMotionPowerSinkPtr& sink)
+{
+  SinkDrains* found = nullptr;
+  for (auto it = memo.begin(); it != memo.end(); )
+  {
+    if (it->sink.expired())
+    {
+      it = memo.erase(it);
+      continue;
+    }
+
+    if (it->sink.lock() == sink)
+      found = &*it;
+
+    ++it;
+  }
+
+  if (found)
+    return *found;
+
+  memo.push_back(SinkDrains{sink, {}});
+  return memo.back();
+}
+
+} // anonymous namespace
+
+//==============================================================================
+double DrainMemo::motion(
+  const rmf_battery::ConstMotionPowerSinkPtr& sink,
+  const rmf_traffic::Trajectory& trajectory)
+{
+  const uint64_t key = fingerprint(trajectory);
+  {
+    std::lock_guard<std::mutex> lock(memo_mutex);
+    const auto& drains = drains_of(sink).drains;
+    const auto it = drains.find(key);
+    if (it != drains.end())
+      return it->second;
+  }
+
+  // Evaluate the drain without holding the lock, since sinks can be slow. Two
+  // threads might both evaluate the same trajectory, but they get the same
+  // answer.
+  const double drain = sink->compute_change_in_charge(trajectory);
+
+  std::lock_guard<std::mutex> lock(memo_mutex);
+  auto& drains = drains_of(sink).drains;
+  if (drains.size() >= max_drains_per_sink)
+    drains.clear();
+
+  drains.insert({key, drain});
+  return drain;
+}
+
+//==============================================================================
+uint64_t DrainMemo::fingerprint(const rmf_traffic::Trajectory& trajectory)
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(trajectory.size());
+  if (trajectory.size() == 0)
+    return hash.value();
+
+  const auto start_time = *trajectory.start_time();
+  for (const auto& waypoint : trajectory)
+  {
+    hash << static_cast<uint64_t>((waypoint.time() - start_time).count());
+
+    const Eigen::Vector3d p = waypoint.position();
+    const Eigen::Vector3d v = waypoint.velocity();
+    for (int i = 0; i < 3; ++i)
+      hash << p[i] << v[i];
+  }
+
+  return hash.value();
+}
+
+//==============================================================================
+std::size_t DrainMemo::size()
+{
+  std::lock_guard<std::mutex> lock(memo_mutex);
+  std::size_t total = 0;
+  for (const auto& entry : memo)
+    total += entry.drains.size();
+
+  return total;
+}
+
+} // namespace rmf_task
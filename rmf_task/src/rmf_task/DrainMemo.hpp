@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__DRAINMEMO_HPP
+#define SRC__RMF_TASK__DRAINMEMO_HPP
+
+#include <rmf_battery/MotionPowerSink.hpp>
+
+#include <rmf_traffic/Trajectory.hpp>
+
+#include <cstdint>
+
+namespace rmf_task {
+
+//==============================================================================
+// Memoizes the battery drain of motion along trajectories for each motion
+// sink in the process. Trajectories are matched by the shape of their motion
+// relative to their start time, so the same leg planned at another time, or
+// by another estimator or model that uses the same sink, is only evaluated
+// once. The drains of a sink are forgotten once the sink is destroyed.
+class DrainMemo
+{
+public:
+
+  // Get the change in charge of the sink along the trajectory
+  static double motion(
+    const rmf_battery::ConstMotionPowerSinkPtr& sink,
+    const rmf_traffic::Trajectory& trajectory);
+
+  // The fingerprint that trajectories are matched by
+  static uint64_t fingerprint(const rmf_traffic::Trajectory& trajectory);
+
+  // The number of drains that are memoized across all the sinks
+  static std::size_t size();
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__DRAINMEMO_HPP
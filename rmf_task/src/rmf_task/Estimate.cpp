@@ -15,10 +15,28 @@
  *
 */
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <rmf_task/Estimate.hpp>
+#include <rmf_task/Metrics.hpp>
+#include <rmf_task/Trace.hpp>
+
+#include "DrainMemo.hpp"
+#include "TravelCache.hpp"
+#include "TravelHierarchy.hpp"
+#include "TravelTable.hpp"
 
 namespace rmf_task {
 
@@ -36,15 +54,28 @@ public:
   rmf_traffic::Time _wait_until;
 };
 
+//==============================================================================
+namespace {
+// Give an estimate its own implementation before it gets modified
+Estimate::Implementation& unshare(
+  std::shared_ptr<Estimate::Implementation>& pimpl)
+{
+  if (pimpl.use_count() > 1)
+    pimpl = std::make_shared<Estimate::Implementation>(*pimpl);
+
+  return *pimpl;
+}
+} // anonymous namespace
+
 //==============================================================================
 Estimate::Estimate(State finish_state, rmf_traffic::Time wait_until)
-: _pimpl(rmf_utils::make_impl<Implementation>(
+: _pimpl(std::make_shared<Implementation>(
       std::move(finish_state), std::move(wait_until)))
 {
 }
 
 //==============================================================================
-State Estimate::finish_state() const
+const State& Estimate::finish_state() const
 {
   return _pimpl->_finish_state;
 }
@@ -52,10 +83,19 @@ State Estimate::finish_state() const
 //==============================================================================
 Estimate& Estimate::finish_state(State new_finish_state)
 {
-  _pimpl->_finish_state = std::move(new_finish_state);
+  unshare(_pimpl)._finish_state = std::move(new_finish_state);
   return *this;
 }
 
+//==============================================================================
+State Estimate::release_finish_state()
+{
+  if (_pimpl.use_count() > 1)
+    return _pimpl->_finish_state;
+
+  return std::move(_pimpl->_finish_state);
+}
+
 //==============================================================================
 rmf_traffic::Time Estimate::wait_until() const
 {
@@ -65,7 +105,7 @@ rmf_traffic::Time Estimate::wait_until() const
 //==============================================================================
 Estimate& Estimate::wait_until(rmf_traffic::Time new_wait_until)
 {
-  _pimpl->_wait_until = std::move(new_wait_until);
+  unshare(_pimpl)._wait_until = std::move(new_wait_until);
   return *this;
 }
 
@@ -94,48 +134,527 @@ class TravelEstimator::Implementation
 {
 public:
 
-  Implementation(const Parameters& parameters)
-  : planner(parameters.planner()),
-    motion_sink(parameters.motion_sink()),
-    ambient_sink(parameters.ambient_sink()),
-    cache(make_cache(planner))
+  Implementation(const Parameters& parameters_)
+  : cache(parameters_.planner()->get_configuration().graph().num_waypoints()),
+    parameters(parameters_),
+    planner(parameters_.planner()),
+    motion_sink(parameters_.motion_sink()),
+    ambient_sink(parameters_.ambient_sink())
+  {
+    const auto& configuration = planner->get_configuration();
+    const auto& graph = configuration.graph();
+    std::unordered_map<std::string, std::size_t> maps;
+    for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+    {
+      const auto& waypoint = graph.get_waypoint(i);
+      locations.push_back(waypoint.get_location());
+      map_of_waypoint.push_back(
+        maps.insert({waypoint.get_map_name(), maps.size()}).first->second);
+    }
+
+    max_speed = configuration.vehicle_traits().linear().get_nominal_velocity();
+  }
+
+  ~Implementation()
+  {
+    if (!persistence_thread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(persistence_mutex);
+      stop_persistence = true;
+    }
+    persistence_wake.notify_all();
+    persistence_thread.join();
+
+    // Take a final snapshot on shutdown. There is nowhere to report a failure
+    // from a destructor, and a missing snapshot only costs a slower start.
+    try
+    {
+      save(persistence_path);
+    }
+    catch (const std::exception&)
+    {
+      // Do nothing
+    }
+  }
+
+  std::size_t save(const std::string& path) const
+  {
+    std::vector<TravelCacheEntry> entries;
+    cache.for_each(
+      [&](const TravelCache::Key& key, const TravelCache::Value& value)
+      {
+        TravelCacheEntry entry{key.first, key.second, {0, 0.0, 0}};
+        if (value.has_value())
+        {
+          entry.record = TravelTable::Record{
+            value->duration().count(), value->change_in_charge(), 1};
+        }
+
+        entries.push_back(entry);
+      });
+
+    write_travel_cache(path, current_parameters(), entries);
+    return entries.size();
+  }
+
+  std::size_t load(const std::string& path)
+  {
+    std::size_t loaded = 0;
+    for (const auto& entry : read_travel_cache(path, current_parameters()))
+    {
+      const auto& record = entry.record;
+      TravelCache::Value value;
+      if (record.reachable)
+      {
+        value = Result::Implementation::make(
+          rmf_traffic::Duration(record.duration), record.change_in_charge);
+      }
+
+      if (cache.insert({entry.start, entry.goal}, std::move(value)))
+        ++loaded;
+    }
+
+    return loaded;
+  }
+
+  void persist(std::string path, const rmf_traffic::Duration period)
   {
-    // Do nothing
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (persistence_thread.joinable())
+      throw std::runtime_error("The travel cache is already being persisted");
+    // *INDENT-ON*
+
+    persistence_path = std::move(path);
+    load(persistence_path);
+    persistence_thread = std::thread([this, period]()
+        {
+          std::unique_lock<std::mutex> lock(persistence_mutex);
+          while (!persistence_wake.wait_for(
+            lock, period, [this]() { return stop_persistence; }))
+          {
+            lock.unlock();
+            try
+            {
+              save(persistence_path);
+            }
+            catch (const std::exception&)
+            {
+              // Try again at the next period
+            }
+            lock.lock();
+          }
+        });
   }
 
   std::optional<Result> estimate(
     const rmf_traffic::agv::Plan::Start& start,
     const rmf_traffic::agv::Plan::Goal& goal) const
   {
-    std::pair<Cache::iterator, bool> insertion;
+    if (auto result = from_profile(start, goal.waypoint()))
+      return result;
+
+    if (auto result = from_hierarchy(start, goal.waypoint()))
+      return result;
+
+    if (use_table())
     {
-      std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
-      while (!lock.try_lock()) {}
+      if (const auto* record = table->find(start.waypoint(), goal.waypoint()))
+      {
+        count_hit();
+        if (!record->reachable)
+          return std::nullopt;
 
-      Key wps{start.waypoint(), goal.waypoint()};
-      insertion = cache.insert(std::make_pair(wps, Value()));
+        return Result::Implementation::make(
+          rmf_traffic::Duration(record->duration), record->change_in_charge);
+      }
     }
 
-    if (!insertion.second)
-      return insertion.first->second;
+    // Only the first thread that misses on a pair calculates its result. Any
+    // other thread that looks up the same pair in the meantime waits for that
+    // calculation instead of repeating it.
+    bool calculated = false;
+    auto result = lookup(start, goal, calculated);
+    if (calculated)
+      count_miss();
+    else
+      count_hit();
 
-    auto result = calculate_result(start, goal);
+    return result;
+  }
+
+  std::vector<std::optional<Result>> estimate(
+    const rmf_traffic::agv::Plan::Start& start,
+    const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const
+  {
+    struct Batch
     {
-      std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
-      while (!lock.try_lock()) {}
-      insertion.first->second = result;
+      Batch(const std::vector<rmf_traffic::agv::Plan::Goal>& goals_)
+      : goals(goals_),
+        results(goals_.size())
+      {
+        // Do nothing
+      }
+
+      std::vector<rmf_traffic::agv::Plan::Goal> goals;
+      std::vector<std::optional<Result>> results;
+      std::vector<std::size_t> missing;
+      std::atomic_size_t next = 0;
+      std::size_t finished = 0;
+      std::mutex mutex;
+      std::condition_variable all_finished;
+      std::exception_ptr error;
+    };
+
+    const auto batch = std::make_shared<Batch>(goals);
+
+    // Answer everything that is already known before planning anything
+    for (std::size_t i = 0; i < goals.size(); ++i)
+    {
+      const std::size_t goal = goals[i].waypoint();
+      if (auto result = from_profile(start, goal))
+      {
+        batch->results[i] = std::move(result);
+        continue;
+      }
+
+      if (auto result = from_hierarchy(start, goal))
+      {
+        batch->results[i] = std::move(result);
+        continue;
+      }
+
+      if (use_table())
+      {
+        if (const auto* record = table->find(start.waypoint(), goal))
+        {
+          count_hit();
+          if (record->reachable)
+          {
+            batch->results[i] = Result::Implementation::make(
+              rmf_traffic::Duration(record->duration),
+              record->change_in_charge);
+          }
+          continue;
+        }
+      }
+
+      if (auto cached = cache.peek({start.waypoint(), goal}))
+      {
+        count_hit();
+        batch->results[i] = std::move(*cached);
+        continue;
+      }
+
+      batch->missing.push_back(i);
     }
 
-    return result;
+    if (batch->missing.empty())
+      return std::move(batch->results);
+
+    // The misses are planned by this thread together with helpers from the
+    // prefetch pool. Each one takes the next miss that nobody has started.
+    const auto work = [this, batch, start]()
+      {
+        std::size_t n;
+        while ((n = batch->next++) < batch->missing.size())
+        {
+          const std::size_t i = batch->missing[n];
+          try
+          {
+            batch->results[i] = estimate(start, batch->goals[i]);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (!batch->error)
+              batch->error = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> lock(batch->mutex);
+          if (++batch->finished == batch->missing.size())
+            batch->all_finished.notify_all();
+        }
+      };
+
+    const std::size_t num_helpers = std::min<std::size_t>(
+      batch->missing.size() - 1, std::thread::hardware_concurrency());
+    if (num_helpers > 0)
+      prefetch_pool.push(std::vector<PrefetchPool::Job>(num_helpers, work));
+
+    work();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->all_finished.wait(
+      lock, [&]() { return batch->finished == batch->missing.size(); });
+
+    if (batch->error)
+      std::rethrow_exception(batch->error);
+
+    return std::move(batch->results);
+  }
+
+  std::shared_future<void> prefetch(
+    const std::vector<rmf_traffic::agv::Plan::Start>& starts,
+    const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const
+  {
+    struct Batch
+    {
+      std::atomic_size_t remaining = 0;
+      std::promise<void> promise;
+      std::mutex mutex;
+      std::exception_ptr error;
+    };
+
+    const auto batch = std::make_shared<Batch>();
+    std::shared_future<void> done = batch->promise.get_future().share();
+    if (starts.empty() || goals.empty())
+    {
+      batch->promise.set_value();
+      return done;
+    }
+
+    // Each job calculates the estimates from one start to every goal
+    const auto shared_goals =
+      std::make_shared<const std::vector<rmf_traffic::agv::Plan::Goal>>(goals);
+    batch->remaining = starts.size();
+
+    std::vector<PrefetchPool::Job> jobs;
+    for (const auto& start : starts)
+    {
+      jobs.push_back([this, batch, start, shared_goals]()
+        {
+          try
+          {
+            for (const auto& goal : *shared_goals)
+            {
+              const bool in_table = use_table()
+                && table->find(start.waypoint(), goal.waypoint());
+              if (in_table)
+                continue;
+
+              if (hierarchy_duration(start.waypoint(), goal.waypoint()))
+                continue;
+
+              bool calculated = false;
+              lookup(start, goal, calculated);
+            }
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (!batch->error)
+              batch->error = std::current_exception();
+          }
+
+          if (--batch->remaining == 0)
+          {
+            if (batch->error)
+              batch->promise.set_exception(batch->error);
+            else
+              batch->promise.set_value();
+          }
+        });
+    }
+
+    prefetch_pool.push(std::move(jobs));
+    return done;
+  }
+
+  rmf_traffic::Duration lower_bound(
+    const std::size_t start,
+    const std::size_t goal) const
+  {
+    if (start >= locations.size() || goal >= locations.size())
+      return rmf_traffic::Duration(0);
+
+    if (map_of_waypoint[start] != map_of_waypoint[goal] || max_speed <= 0.0)
+      return rmf_traffic::Duration(0);
+
+    const double distance = (locations[goal] - locations[start]).norm();
+    return rmf_traffic::time::from_seconds(distance / max_speed);
+  }
+
+  std::size_t update_planner(
+    std::shared_ptr<const rmf_traffic::agv::Planner> new_planner)
+  {
+    // Wait for every calculation that is using the current planner
+    std::unique_lock<std::shared_mutex> lock(planner_mutex);
+    const auto& old_configuration = planner->get_configuration();
+    const auto& new_configuration = new_planner->get_configuration();
+    const auto& graph = new_configuration.graph();
+
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (graph.num_waypoints() != old_configuration.graph().num_waypoints()
+      || graph.num_lanes() != old_configuration.graph().num_lanes())
+    {
+      throw std::runtime_error(
+        "The new planner of a TravelEstimator must have the same navigation "
+        "graph as the old one");
+    }
+    // *INDENT-ON*
+
+    const auto& old_closures = old_configuration.lane_closures();
+    const auto& new_closures = new_configuration.lane_closures();
+    std::vector<bool> closed(graph.num_lanes(), false);
+    std::vector<std::size_t> opened;
+    bool any_closed = false;
+    for (std::size_t lane = 0; lane < graph.num_lanes(); ++lane)
+    {
+      const bool was_open = old_closures.is_open(lane);
+      const bool is_open = new_closures.is_open(lane);
+      if (was_open && !is_open)
+      {
+        closed[lane] = true;
+        any_closed = true;
+      }
+      else if (!was_open && is_open)
+      {
+        opened.push_back(lane);
+      }
+    }
+
+    planner = new_planner;
+    parameters.planner(std::move(new_planner));
+    ++generation;
+    if (!any_closed && opened.empty())
+      return 0;
+
+    // The table does not know which routes its estimates were planned along,
+    // and the hierarchy was built for the old lane closures
+    table_valid = false;
+    hierarchy_valid = false;
+
+    return cache.erase_if(
+      [&](
+        const TravelCache::Key& key,
+        const TravelCache::Value& value,
+        const TravelCache::Route& route) -> bool
+      {
+        // An opened lane might connect a goal that could not be reached
+        if (!value.has_value())
+          return !opened.empty();
+
+        // Without the route there is no telling which lanes were used
+        if (!route.has_value())
+          return true;
+
+        for (const auto lane : *route)
+        {
+          if (lane < closed.size() && closed[lane])
+            return true;
+        }
+
+        // An opened lane can only give a faster route if even the straight
+        // line through that lane would be faster than the current estimate
+        for (const auto lane : opened)
+        {
+          const auto& l = graph.get_lane(lane);
+          const std::size_t entry = l.entry().waypoint_index();
+          const std::size_t exit = l.exit().waypoint_index();
+          const auto bound = lower_bound(key.first, entry)
+            + lower_bound(entry, exit) + lower_bound(exit, key.second);
+
+          if (bound < value->duration())
+            return true;
+        }
+
+        return false;
+      });
   }
 
+  mutable TravelCache cache;
+  mutable std::atomic_size_t hits = 0;
+  mutable std::atomic_size_t misses = 0;
+
+  void count_hit() const
+  {
+    ++hits;
+    Metrics::add(Metrics::Counter::travel_estimate_hits);
+  }
+
+  void count_miss() const
+  {
+    ++misses;
+    Metrics::add(Metrics::Counter::travel_estimate_misses);
+  }
+
+  // The graph as seen by lower_bound()
+  std::vector<Eigen::Vector2d> locations;
+  std::vector<std::size_t> map_of_waypoint;
+  double max_speed = 0.0;
+
+  // Precomputed estimates that are checked before the cache. They are no
+  // longer used once the lane closures change.
+  std::shared_ptr<const TravelTable> table;
+  std::atomic_bool table_valid = true;
+
+  // Time-of-day estimates that are checked before anything else
+  ConstTravelProfilePtr profile;
+
+  // Counts the changes to the travel times, see generation()
+  std::atomic_size_t generation = 0;
+
+  // Estimate travel along straight lines instead of planning it
+  bool straight_line = false;
+
+  // Durations from a hierarchy of the graph that are checked after the
+  // profile. Trips that are faster than the threshold are planned instead,
+  // because the overhead of accelerating would be too much of their duration.
+  // The hierarchy is no longer used once the lane closures change.
+  std::shared_ptr<const TravelHierarchy> hierarchy;
+  std::atomic_bool hierarchy_valid = true;
+  double hierarchy_threshold = 0.0;
+  double hierarchy_overhead = 0.0;
+
+  // Snapshots of the cache that are taken periodically by persist()
+  std::string persistence_path;
+  std::thread persistence_thread;
+  std::mutex persistence_mutex;
+  std::condition_variable persistence_wake;
+  bool stop_persistence = false;
+
   std::optional<Result> calculate_result(
     const rmf_traffic::agv::Plan::Start& start,
-    const rmf_traffic::agv::Plan::Goal& goal) const
+    const rmf_traffic::agv::Plan::Goal& goal,
+    TravelCache::Route* route = nullptr) const
   {
+    RMF_TASK_TRACE_SPAN("TravelEstimator::estimate miss");
+    if (straight_line)
+    {
+      if (auto result = calculate_straight_line(start, goal.waypoint()))
+      {
+        // The straight line does not use any lanes
+        if (route)
+          *route = std::vector<std::size_t>();
+
+        return result;
+      }
+    }
+
     const auto plan = planner->plan(start, goal);
     if (!plan.success())
+    {
+      if (route)
+        *route = std::vector<std::size_t>();
+
       return std::nullopt;
+    }
+
+    if (route)
+    {
+      std::vector<std::size_t> lanes;
+      for (const auto& waypoint : plan->get_waypoints())
+      {
+        const auto& approach = waypoint.approach_lanes();
+        lanes.insert(lanes.end(), approach.begin(), approach.end());
+      }
+
+      std::sort(lanes.begin(), lanes.end());
+      lanes.erase(std::unique(lanes.begin(), lanes.end()), lanes.end());
+      *route = std::move(lanes);
+    }
 
     // We assume we can always compute a plan
     const auto itinerary_start_time = start.time();
@@ -147,9 +666,9 @@ public:
       const rmf_traffic::Duration itinerary_duration =
         finish_time - itinerary_start_time;
 
-      // Compute battery drain
-      const auto dSOC_motion =
-        motion_sink->compute_change_in_charge(trajectory);
+      // Compute battery drain. Legs that were already evaluated for this sink
+      // by any estimator are not evaluated again.
+      const auto dSOC_motion = DrainMemo::motion(motion_sink, trajectory);
 
       const auto dSOC_device = ambient_sink->compute_change_in_charge(
         rmf_traffic::time::to_seconds(itinerary_duration));
@@ -169,38 +688,218 @@ public:
   }
 
 private:
+
+  // Estimate travel along the straight line between two waypoints, or return
+  // nullopt if they are not on the same map
+  std::optional<Result> calculate_straight_line(
+    const rmf_traffic::agv::Plan::Start& start,
+    const std::size_t goal) const
+  {
+    const std::size_t from = start.waypoint();
+    if (from >= locations.size() || goal >= locations.size())
+      return std::nullopt;
+
+    if (map_of_waypoint[from] != map_of_waypoint[goal] || max_speed <= 0.0)
+      return std::nullopt;
+
+    const auto duration = lower_bound(from, goal);
+    double battery_drain = ambient_sink->compute_change_in_charge(
+      rmf_traffic::time::to_seconds(duration));
+
+    if (duration > rmf_traffic::Duration(0))
+    {
+      const double yaw = start.orientation();
+      const Eigen::Vector2d& p0 = locations[from];
+      const Eigen::Vector2d& p1 = locations[goal];
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(
+        start.time(), {p0[0], p0[1], yaw}, Eigen::Vector3d::Zero());
+      trajectory.insert(
+        start.time() + duration, {p1[0], p1[1], yaw}, Eigen::Vector3d::Zero());
+      battery_drain += motion_sink->compute_change_in_charge(trajectory);
+    }
+
+    return Result::Implementation::make(duration, battery_drain);
+  }
+
+  std::optional<Result> from_profile(
+    const rmf_traffic::agv::Plan::Start& start,
+    const std::size_t goal) const
+  {
+    if (!profile)
+      return std::nullopt;
+
+    const auto entry = profile->find(start.waypoint(), goal, start.time());
+    if (!entry.has_value())
+      return std::nullopt;
+
+    count_hit();
+    return Result::Implementation::make(
+      entry->duration, entry->change_in_charge);
+  }
+
+  // The duration in seconds of a trip that the hierarchy can answer
+  std::optional<double> hierarchy_duration(
+    const std::size_t start,
+    const std::size_t goal) const
+  {
+    if (!hierarchy || !hierarchy_valid.load(std::memory_order_relaxed))
+      return std::nullopt;
+
+    const auto duration = hierarchy->duration(start, goal);
+    if (!duration.has_value() || *duration < hierarchy_threshold)
+      return std::nullopt;
+
+    return *duration + hierarchy_overhead;
+  }
+
+  std::optional<Result> from_hierarchy(
+    const rmf_traffic::agv::Plan::Start& start,
+    const std::size_t goal) const
+  {
+    const auto seconds = hierarchy_duration(start.waypoint(), goal);
+    if (!seconds.has_value())
+      return std::nullopt;
+
+    // The motion drain is the drain of a straight line that is as long as the
+    // route would be at the nominal velocity
+    const auto duration = rmf_traffic::time::from_seconds(*seconds);
+    const Eigen::Vector2d& p0 = locations[start.waypoint()];
+    const Eigen::Vector2d p1 =
+      p0 + Eigen::Vector2d::UnitX() * (*seconds - hierarchy_overhead)
+      * max_speed;
+    const double yaw = start.orientation();
+    rmf_traffic::Trajectory trajectory;
+    trajectory.insert(
+      start.time(), {p0[0], p0[1], yaw}, Eigen::Vector3d::Zero());
+    trajectory.insert(
+      start.time() + duration, {p1[0], p1[1], yaw}, Eigen::Vector3d::Zero());
+
+    const double battery_drain =
+      ambient_sink->compute_change_in_charge(*seconds)
+      + motion_sink->compute_change_in_charge(trajectory);
+
+    count_hit();
+    return Result::Implementation::make(duration, battery_drain);
+  }
+
+  bool use_table() const
+  {
+    return table && table_valid.load(std::memory_order_relaxed);
+  }
+
+  // Get a memoized estimate, or calculate it if it is missing
+  TravelCache::Value lookup(
+    const rmf_traffic::agv::Plan::Start& start,
+    const rmf_traffic::agv::Plan::Goal& goal,
+    bool& calculated) const
+  {
+    const TravelCache::Key key{start.waypoint(), goal.waypoint()};
+    if (auto cached = cache.peek(key))
+    {
+      calculated = false;
+      return std::move(*cached);
+    }
+
+    // Misses hold the planner lock until their estimate is stored, so that
+    // update_planner() never leaves behind an estimate from an old planner.
+    // Hits are answered above without touching the lock.
+    std::shared_lock<std::shared_mutex> lock(planner_mutex);
+    return cache.get(
+      key,
+      [&](TravelCache::Route& route)
+      {
+        return calculate_result(start, goal, &route);
+      },
+      calculated);
+  }
+
+  Parameters current_parameters() const
+  {
+    std::shared_lock<std::shared_mutex> lock(planner_mutex);
+    return parameters;
+  }
+
+  mutable std::shared_mutex planner_mutex;
+  Parameters parameters;
   std::shared_ptr<const rmf_traffic::agv::Planner> planner;
   rmf_battery::ConstMotionPowerSinkPtr motion_sink;
   rmf_battery::ConstDevicePowerSinkPtr ambient_sink;
 
-  struct PairHash
+  // Background threads that run the jobs of prefetch(). The threads are only
+  // started by the first prefetch. Jobs that have not started when the pool
+  // is destroyed are dropped, which breaks the promise of their batch.
+  class PrefetchPool
   {
-    PairHash(std::size_t N)
+  public:
+
+    using Job = std::function<void()>;
+
+    PrefetchPool() = default;
+    PrefetchPool(const PrefetchPool&) = delete;
+    PrefetchPool& operator=(const PrefetchPool&) = delete;
+
+    ~PrefetchPool()
     {
-      _shift = std::ceil(std::log2(N));
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _jobs.clear();
+      }
+      _wake.notify_all();
+
+      for (auto& t : _threads)
+        t.join();
     }
 
-    size_t operator()(const std::pair<size_t, size_t>& p) const
+    void push(std::vector<Job> jobs)
     {
-      return p.first + (p.second << _shift);
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_threads.empty())
+        {
+          const std::size_t num_threads =
+            std::max(1u, std::thread::hardware_concurrency());
+          for (std::size_t i = 0; i < num_threads; ++i)
+            _threads.emplace_back([this]() { _work(); });
+        }
+
+        for (auto& job : jobs)
+          _jobs.push_back(std::move(job));
+      }
+      _wake.notify_all();
     }
 
-    std::size_t _shift;
-  };
+  private:
 
-  using Key = std::pair<size_t, size_t>;
-  using Value = std::optional<Result>;
-  using Cache = std::unordered_map<Key, std::optional<Result>, PairHash>;
-  mutable Cache cache;
+    void _work()
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (true)
+      {
+        _wake.wait(lock, [&]() { return _stop || !_jobs.empty(); });
+        if (_stop)
+          return;
 
-  static Cache make_cache(
-    const std::shared_ptr<const rmf_traffic::agv::Planner>& planner)
-  {
-    const auto N = planner->get_configuration().graph().num_waypoints();
-    return Cache(N, PairHash(N));
-  }
+        Job job = std::move(_jobs.front());
+        _jobs.pop_front();
+
+        lock.unlock();
+        job();
+        lock.lock();
+      }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<Job> _jobs;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+  };
 
-  mutable std::mutex mutex;
+  // This is declared last so that its threads are joined before anything
+  // that their jobs use is destroyed
+  mutable PrefetchPool prefetch_pool;
 };
 
 //==============================================================================
@@ -210,6 +909,298 @@ TravelEstimator::TravelEstimator(const Parameters& parameters)
   // Do nothing
 }
 
+//==============================================================================
+std::shared_ptr<TravelEstimator> TravelEstimator::shared(
+  const Parameters& parameters)
+{
+  // Parameters whose power sinks cannot be fingerprinted by value only share
+  // an estimator if they use the very same sink objects
+  struct Key
+  {
+    uint64_t fingerprint;
+    const void* motion_sink;
+    const void* ambient_sink;
+
+    bool operator==(const Key& other) const
+    {
+      return fingerprint == other.fingerprint
+        && motion_sink == other.motion_sink
+        && ambient_sink == other.ambient_sink;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return std::hash<uint64_t>()(key.fingerprint)
+        ^ std::hash<const void*>()(key.motion_sink)
+        ^ (std::hash<const void*>()(key.ambient_sink) << 1);
+    }
+  };
+
+  Key key{travel_table_fingerprint(parameters), nullptr, nullptr};
+  if (!travel_table_fingerprint_is_complete(parameters))
+  {
+    key.motion_sink = parameters.motion_sink().get();
+    key.ambient_sink = parameters.ambient_sink().get();
+  }
+
+  static std::mutex registry_mutex;
+  static std::unordered_map<Key, std::weak_ptr<TravelEstimator>, KeyHash>
+  registry;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (auto it = registry.begin(); it != registry.end(); )
+  {
+    if (it->second.expired())
+      it = registry.erase(it);
+    else
+      ++it;
+  }
+
+  auto& entry = registry[key];
+  if (auto estimator = entry.lock())
+    return estimator;
+
+  auto estimator = std::make_shared<TravelEstimator>(parameters);
+  entry = estimator;
+  return estimator;
+}
+
+//==============================================================================
+std::shared_ptr<TravelEstimator> TravelEstimator::straight_line(
+  const Parameters& parameters)
+{
+  auto estimator = std::make_shared<TravelEstimator>(parameters);
+  estimator->_pimpl->straight_line = true;
+  return estimator;
+}
+
+//==============================================================================
+std::shared_ptr<TravelEstimator> TravelEstimator::hierarchical(
+  const Parameters& parameters,
+  const std::size_t region_size,
+  const double tolerance)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (region_size == 0)
+  {
+    throw std::invalid_argument(
+      "The regions of a hierarchical TravelEstimator must hold at least one "
+      "waypoint");
+  }
+
+  if (!(tolerance > 0.0))
+  {
+    throw std::invalid_argument(
+      "The tolerance of a hierarchical TravelEstimator must be positive, but "
+      "[" + std::to_string(tolerance) + "] was given");
+  }
+  // *INDENT-ON*
+
+  auto estimator = std::make_shared<TravelEstimator>(parameters);
+  auto& impl = *estimator->_pimpl;
+  const auto& configuration = parameters.planner()->get_configuration();
+  impl.hierarchy = TravelHierarchy::build(configuration, region_size);
+
+  const auto& linear = configuration.vehicle_traits().linear();
+  const double acceleration = linear.get_nominal_acceleration();
+  if (impl.hierarchy && acceleration > 0.0)
+    impl.hierarchy_overhead = linear.get_nominal_velocity() / acceleration;
+
+  impl.hierarchy_threshold = impl.hierarchy_overhead / tolerance;
+  return estimator;
+}
+
+//==============================================================================
+std::size_t TravelEstimator::hierarchy_memory() const
+{
+  if (!_pimpl->hierarchy)
+    return 0;
+
+  return _pimpl->hierarchy->memory();
+}
+
+//==============================================================================
+TravelEstimator::TravelEstimator(
+  const Parameters& parameters,
+  const std::string& table_path)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>(parameters))
+{
+  _pimpl->table = TravelTable::load(table_path, parameters);
+}
+
+//==============================================================================
+void TravelEstimator::build_table(
+  const Parameters& parameters,
+  const std::string& table_path,
+  const std::size_t num_threads)
+{
+  const Implementation estimator(parameters);
+  const std::size_t N =
+    parameters.planner()->get_configuration().graph().num_waypoints();
+
+  std::vector<TravelTable::Record> records(N * N, {0, 0.0, 0});
+  std::atomic_size_t next_start = 0;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  // Each thread takes the next start waypoint that nobody has worked on yet
+  // and fills in its whole row of the table
+  const auto work = [&]()
+    {
+      try
+      {
+        std::size_t start;
+        while ((start = next_start++) < N)
+        {
+          const rmf_traffic::agv::Plan::Start from(
+            rmf_traffic::Time(), start, 0.0);
+          for (std::size_t goal = 0; goal < N; ++goal)
+          {
+            const auto result = estimator.calculate_result(
+              from, rmf_traffic::agv::Plan::Goal(goal));
+            if (!result.has_value())
+              continue;
+
+            records[start * N + goal] = TravelTable::Record{
+              result->duration().count(), result->change_in_charge(), 1};
+          }
+        }
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+
+        next_start = N;
+      }
+    };
+
+  std::size_t threads = num_threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < std::min(threads, N); ++i)
+    workers.emplace_back(work);
+
+  work();
+  for (auto& worker : workers)
+    worker.join();
+
+  if (error)
+    std::rethrow_exception(error);
+
+  TravelTable::write(table_path, parameters, records);
+}
+
+//==============================================================================
+auto TravelEstimator::estimate(
+  const rmf_traffic::agv::Plan::Start& start,
+  const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const
+-> std::vector<std::optional<Result>>
+{
+  return _pimpl->estimate(start, goals);
+}
+
+//==============================================================================
+rmf_traffic::Duration TravelEstimator::lower_bound(
+  const std::size_t start_waypoint,
+  const std::size_t goal_waypoint) const
+{
+  return _pimpl->lower_bound(start_waypoint, goal_waypoint);
+}
+
+//==============================================================================
+std::size_t TravelEstimator::update_planner(
+  std::shared_ptr<const rmf_traffic::agv::Planner> planner)
+{
+  return _pimpl->update_planner(std::move(planner));
+}
+
+//==============================================================================
+std::shared_future<void> TravelEstimator::prefetch(
+  const std::vector<rmf_traffic::agv::Plan::Start>& starts,
+  const std::vector<rmf_traffic::agv::Plan::Goal>& goals) const
+{
+  return _pimpl->prefetch(starts, goals);
+}
+
+//==============================================================================
+TravelEstimator& TravelEstimator::cache_capacity(
+  const std::optional<std::size_t> capacity)
+{
+  _pimpl->cache.capacity(capacity);
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> TravelEstimator::cache_capacity() const
+{
+  return _pimpl->cache.capacity();
+}
+
+//==============================================================================
+std::size_t TravelEstimator::cache_size() const
+{
+  return _pimpl->cache.size();
+}
+
+//==============================================================================
+std::size_t TravelEstimator::cache_evictions() const
+{
+  return _pimpl->cache.evictions();
+}
+
+//==============================================================================
+std::size_t TravelEstimator::cache_memory() const
+{
+  return _pimpl->cache.memory();
+}
+
+//==============================================================================
+TravelEstimator& TravelEstimator::profile(ConstTravelProfilePtr profile)
+{
+  _pimpl->profile = std::move(profile);
+  ++_pimpl->generation;
+  return *this;
+}
+
+//==============================================================================
+const ConstTravelProfilePtr& TravelEstimator::profile() const
+{
+  return _pimpl->profile;
+}
+
+//==============================================================================
+std::size_t TravelEstimator::generation() const
+{
+  return _pimpl->generation.load();
+}
+
+//==============================================================================
+std::size_t TravelEstimator::save_cache(const std::string& path) const
+{
+  return _pimpl->save(path);
+}
+
+//==============================================================================
+std::size_t TravelEstimator::load_cache(const std::string& path)
+{
+  return _pimpl->load(path);
+}
+
+//==============================================================================
+void TravelEstimator::persist_cache(
+  const std::string& path,
+  const rmf_traffic::Duration period)
+{
+  _pimpl->persist(path, period);
+}
+
 //==============================================================================
 rmf_traffic::Duration TravelEstimator::Result::duration() const
 {
@@ -236,4 +1227,16 @@ auto TravelEstimator::estimate(
   return _pimpl->estimate(start, goal);
 }
 
+//==============================================================================
+std::size_t TravelEstimator::cache_hits() const
+{
+  return _pimpl->hits;
+}
+
+//==============================================================================
+std::size_t TravelEstimator::cache_misses() const
+{
+  return _pimpl->misses;
+}
+
 } // namespace rmf_task
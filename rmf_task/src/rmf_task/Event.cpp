@@ -19,24 +19,6 @@
 
 namespace rmf_task {
 
-namespace {
-//==============================================================================
-std::vector<Event::ConstStatePtr> snapshot_dependencies(
-  const std::vector<Event::ConstStatePtr>& queue)
-{
-  // NOTE(MXG): This implementation is using recursion. That should be fine
-  // since I don't expect much depth in the trees of dependencies, but we may
-  // want to revisit this and implement it as a queue instead if we ever find
-  // a use-case with deep recursion.
-  std::vector<Event::ConstStatePtr> output;
-  output.reserve(queue.size());
-  for (const auto& c : queue)
-    output.push_back(Event::Snapshot::make(*c));
-
-  return output;
-}
-} // anonymous namespace
-
 //==============================================================================
 Event::Status Event::sequence_status(Status earlier, Status later)
 {
@@ -76,6 +58,12 @@ bool Event::State::finished() const
   }
 }
 
+//==============================================================================
+std::optional<uint64_t> Event::State::version() const
+{
+  return std::nullopt;
+}
+
 //==============================================================================
 class Event::Snapshot::Implementation
 {
@@ -87,21 +75,66 @@ public:
   VersionedString::View detail;
   Log::View log;
   std::vector<ConstStatePtr> dependencies;
+  std::optional<uint64_t> version;
 
+  static const Implementation& get(const Snapshot& snapshot)
+  {
+    return *snapshot._pimpl;
+  }
 };
 
 //==============================================================================
-auto Event::Snapshot::make(const State& other) -> ConstSnapshotPtr
+auto Event::Snapshot::make(
+  const State& other,
+  const ConstSnapshotPtr& previous) -> ConstSnapshotPtr
 {
+  // NOTE(MXG): This implementation is using recursion. That should be fine
+  // since I don't expect much depth in the trees of dependencies, but we may
+  // want to revisit this and implement it as a queue instead if we ever find
+  // a use-case with deep recursion.
+
+  // Get the version before anything else so that any change which happens
+  // while the snapshot is being made gets noticed by the next snapshot.
+  const auto version = other.version();
+  const auto id = other.id();
+
+  const Implementation* last = nullptr;
+  if (previous && previous->id() == id)
+    last = &Implementation::get(*previous);
+
+  const auto dependencies = other.dependencies();
+  std::vector<ConstStatePtr> snapshots;
+  snapshots.reserve(dependencies.size());
+  bool reused_dependencies =
+    last && last->dependencies.size() == dependencies.size();
+
+  for (std::size_t i = 0; i < dependencies.size(); ++i)
+  {
+    ConstSnapshotPtr last_dependency;
+    if (last && i < last->dependencies.size())
+    {
+      last_dependency =
+        std::dynamic_pointer_cast<const Snapshot>(last->dependencies[i]);
+    }
+
+    auto snapshot = make(*dependencies[i], last_dependency);
+    reused_dependencies = reused_dependencies && snapshot == last_dependency;
+    snapshots.push_back(std::move(snapshot));
+  }
+
+  if (reused_dependencies && version.has_value() && last->version == version)
+    return previous;
+
   Snapshot output;
   output._pimpl = rmf_utils::make_impl<Implementation>(
     Implementation{
-      other.id(),
+      id,
       other.status(),
       other.name(),
       other.detail(),
       other.log(),
-      snapshot_dependencies(other.dependencies())
+      std::move(snapshots),
+      version
     });
 
   return std::make_shared<Snapshot>(std::move(output));
@@ -143,6 +176,12 @@ std::vector<Event::ConstStatePtr> Event::Snapshot::dependencies() const
   return _pimpl->dependencies;
 }
 
+//==============================================================================
+std::optional<uint64_t> Event::Snapshot::version() const
+{
+  return _pimpl->version;
+}
+
 //==============================================================================
 Event::Snapshot::Snapshot()
 {
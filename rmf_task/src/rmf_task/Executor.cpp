@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/Executor.hpp>
+#include <rmf_task/TimerWheel.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+//==============================================================================
+class ThreadPool : public Executor
+{
+public:
+
+  ThreadPool(std::size_t num_threads)
+  : _queue(std::make_shared<Queue>())
+  {
+    _threads.reserve(num_threads);
+    for (std::size_t i = 0; i < num_threads; ++i)
+      _threads.emplace_back([queue = _queue]() { queue->work(); });
+  }
+
+  void post(Job job) final
+  {
+    {
+      std::lock_guard<std::mutex> lock(_queue->mutex);
+      _queue->jobs.push_back(std::move(job));
+    }
+    _queue->wake.notify_one();
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_queue->mutex);
+      _queue->stop = true;
+    }
+    _queue->wake.notify_all();
+
+    // The last owner of the pool might be a job that is running on one of its
+    // own threads. That thread cannot be joined, so it is left to finish on
+    // its own. The queue is shared with the threads so it outlives the pool.
+    for (auto& t : _threads)
+    {
+      if (t.get_id() == std::this_thread::get_id())
+        t.detach();
+      else
+        t.join();
+    }
+  }
+
+private:
+
+  struct Queue
+  {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    bool stop = false;
+
+    void work()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true)
+      {
+        wake.wait(lock, [&]() { return stop || !jobs.empty(); });
+
+        // Jobs that were posted before the pool was destroyed still get run
+        if (jobs.empty())
+          return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+
+        // Release whatever the job holds before the lock is taken again
+        job = nullptr;
+        lock.lock();
+      }
+    }
+  };
+
+  std::shared_ptr<Queue> _queue;
+  std::vector<std::thread> _threads;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+std::shared_ptr<Executor> Executor::make_thread_pool(std::size_t num_threads)
+{
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  return std::make_shared<ThreadPool>(num_threads);
+}
+
+//==============================================================================
+void Executor::post_after(
+  std::shared_ptr<Executor> executor,
+  const rmf_traffic::Duration delay,
+  Job job)
+{
+  TimerWheel::shared().arm(
+    delay,
+    [executor = std::move(executor), job = std::move(job)]() mutable
+    {
+      if (executor)
+        executor->post(std::move(job));
+      else
+        job();
+    });
+}
+
+//==============================================================================
+class Strand::Implementation
+{
+public:
+
+  Implementation(ExecutorPtr executor_)
+  : executor(std::move(executor_))
+  {
+    // Do nothing
+  }
+
+  ExecutorPtr executor;
+
+  std::mutex mutex;
+  std::deque<Job> jobs;
+
+  // True while a job of this strand has been posted to the executor and has
+  // not finished running the queue yet
+  bool running = false;
+
+  std::weak_ptr<Strand> weak_self;
+};
+
+//==============================================================================
+std::shared_ptr<Strand> Strand::make(ExecutorPtr executor)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!executor)
+  {
+    throw std::runtime_error(
+      "[rmf_task::Strand::make] The executor of a strand must not be null");
+  }
+  // *INDENT-ON*
+
+  auto strand = std::shared_ptr<Strand>(new Strand);
+  strand->_pimpl = rmf_utils::make_unique_impl<Implementation>(
+    std::move(executor));
+  strand->_pimpl->weak_self = strand;
+  return strand;
+}
+
+//==============================================================================
+void Strand::post(Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(_pimpl->mutex);
+    _pimpl->jobs.push_back(std::move(job));
+    if (_pimpl->running)
+      return;
+
+    _pimpl->running = true;
+  }
+
+  // The posted job keeps the strand alive until its queue has been emptied
+  _pimpl->executor->post(
+    [self = _pimpl->weak_self.lock()]()
+    {
+      auto& impl = *self->_pimpl;
+      std::unique_lock<std::mutex> lock(impl.mutex);
+      while (!impl.jobs.empty())
+      {
+        Job next = std::move(impl.jobs.front());
+        impl.jobs.pop_front();
+        lock.unlock();
+        next();
+        lock.lock();
+      }
+
+      impl.running = false;
+    });
+}
+
+//==============================================================================
+const ExecutorPtr& Strand::executor() const
+{
+  return _pimpl->executor;
+}
+
+//==============================================================================
+Strand::Strand()
+{
+  // Do nothing
+}
+
+} // namespace rmf_task
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "Filter.hpp"
+
+namespace rmf_task {
+
+//==============================================================================
+namespace {
+std::uint64_t mix(std::uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+} // anonymous namespace
+
+//==============================================================================
+Filter::Filter(Type type, const std::size_t N_tasks)
+: _type(type),
+  _N_tasks(N_tasks),
+  _trie(type == Type::Trie ? N_tasks : 0),
+  _set(type == Type::Hash ? N_tasks : 0)
+{
+  // Do nothing
+}
+
+//==============================================================================
+bool Filter::ignore(const Node& node)
+{
+  if (_type == Type::Passthrough)
+    return false;
+
+  const bool seen = _type == Type::Hash ?
+    !_set.insert(node.fingerprint).second :
+    !_trie.insert(node.assigned_tasks);
+
+  if (!seen)
+    ++_size;
+
+  return seen;
+}
+
+//==============================================================================
+std::size_t Filter::memory_usage() const
+{
+  if (_type == Type::Hash)
+  {
+    // Each element is held by a separately allocated node which carries a
+    // pointer to the next node and a cached hash
+    const std::size_t node_size =
+      sizeof(AssignmentFingerprint) + 2 * sizeof(void*);
+    return _set.size() * node_size + _set.bucket_count() * sizeof(void*);
+  }
+
+  if (_type == Type::Trie)
+    return _trie.memory_usage();
+
+  return 0;
+}
+
+//==============================================================================
+std::size_t Filter::size() const
+{
+  return _size;
+}
+
+//==============================================================================
+void Filter::clear()
+{
+  *this = Filter(_type, _N_tasks);
+}
+
+//==============================================================================
+Filter::Trie::Trie(std::size_t expected_nodes)
+: _terminal(1, false)
+{
+  std::size_t capacity = 16;
+  while (capacity < 2 * expected_nodes)
+    capacity *= 2;
+
+  _edges.resize(capacity);
+}
+
+//==============================================================================
+bool Filter::Trie::insert(const Node::AssignedTasks& assigned_tasks)
+{
+  std::uint32_t current = 0;
+  for (std::size_t a = 0; a < assigned_tasks.size(); ++a)
+  {
+    for (const auto& assignment : *assigned_tasks[a])
+    {
+      const std::uint64_t label =
+        (static_cast<std::uint64_t>(a) << 32)
+        ^ static_cast<std::uint64_t>(assignment.internal_id);
+      current = _child(current, label);
+    }
+  }
+
+  if (_terminal[current])
+    return false;
+
+  _terminal[current] = true;
+  return true;
+}
+
+//==============================================================================
+std::size_t Filter::Trie::memory_usage() const
+{
+  return _edges.capacity() * sizeof(Edge) + _terminal.capacity() / 8;
+}
+
+//==============================================================================
+std::uint32_t Filter::Trie::_child(std::uint32_t parent, std::uint64_t label)
+{
+  const std::size_t mask = _edges.size() - 1;
+  std::size_t i = mix(label ^ mix(parent)) & mask;
+  while (_edges[i].parent != Empty)
+  {
+    const auto& edge = _edges[i];
+    if (edge.parent == parent && edge.label == label)
+      return edge.child;
+
+    i = (i + 1) & mask;
+  }
+
+  const auto child = static_cast<std::uint32_t>(_terminal.size());
+  _terminal.push_back(false);
+  _edges[i] = Edge{parent, child, label};
+
+  // Keep the table at most half full so that probe sequences stay short
+  if (2 * (++_num_edges) > _edges.size())
+    _grow();
+
+  return child;
+}
+
+//==============================================================================
+void Filter::Trie::_grow()
+{
+  std::vector<Edge> old_edges(_edges.size() * 2);
+  std::swap(old_edges, _edges);
+
+  const std::size_t mask = _edges.size() - 1;
+  for (const auto& edge : old_edges)
+  {
+    if (edge.parent == Empty)
+      continue;
+
+    std::size_t i = mix(edge.label ^ mix(edge.parent)) & mask;
+    while (_edges[i].parent != Empty)
+      i = (i + 1) & mask;
+
+    _edges[i] = edge;
+  }
+}
+
+} // namespace rmf_task
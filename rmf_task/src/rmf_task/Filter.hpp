@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__FILTER_HPP
+#define SRC__RMF_TASK__FILTER_HPP
+
+#include "internal_task_planning.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// Detects nodes whose set of assignments has already been seen by the search
+class Filter
+{
+public:
+
+  using Type = TaskPlanner::FilterType;
+
+  Filter(Type type, const std::size_t N_tasks);
+
+  /// Returns true if a node with the same assignments has been seen before.
+  /// Otherwise the node is recorded and false is returned.
+  bool ignore(const Node& node);
+
+  /// An estimate of the number of bytes that the filter is using
+  std::size_t memory_usage() const;
+
+  /// The number of nodes that the filter has recorded
+  std::size_t size() const;
+
+  /// Forget every node that has been recorded and release the memory that
+  /// was used to record them
+  void clear();
+
+private:
+
+  // A trie over the sequence of (agent, internal_id) pairs of a node. All the
+  // trie nodes live in one pool and all the edges live in one open-addressing
+  // table, so growing the trie does not allocate anything per node.
+  class Trie
+  {
+  public:
+
+    Trie(std::size_t expected_nodes);
+
+    // Insert the assignments of a node. Returns false if they were already
+    // present.
+    bool insert(const Node::AssignedTasks& assigned_tasks);
+
+    std::size_t memory_usage() const;
+
+  private:
+
+    static constexpr std::uint32_t Empty =
+      std::numeric_limits<std::uint32_t>::max();
+
+    struct Edge
+    {
+      std::uint32_t parent = Empty;
+      std::uint32_t child = Empty;
+      std::uint64_t label = 0;
+    };
+
+    std::uint32_t _child(std::uint32_t parent, std::uint64_t label);
+
+    void _grow();
+
+    // Whether a node of the search ends at each trie node
+    std::vector<bool> _terminal;
+    std::vector<Edge> _edges;
+    std::size_t _num_edges = 0;
+  };
+
+  struct FingerprintHash
+  {
+    std::size_t operator()(const AssignmentFingerprint& f) const
+    {
+      return static_cast<std::size_t>(f.low);
+    }
+  };
+
+  // Only the fingerprints of the nodes that have been seen are stored
+  using Set = std::unordered_set<AssignmentFingerprint, FingerprintHash>;
+
+  Type _type;
+  std::size_t _N_tasks;
+  std::size_t _size = 0;
+  Trie _trie;
+  Set _set;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__FILTER_HPP
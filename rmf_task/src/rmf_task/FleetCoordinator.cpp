@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/FleetCoordinator.hpp>
+#include <rmf_task/Executor.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+// Run job(i) for every i in [0, num_jobs) on the executor and wait until all
+// of them are finished
+void run_all(
+  const ExecutorPtr& executor,
+  const std::size_t num_jobs,
+  const std::function<void(std::size_t)>& job)
+{
+  if (!executor || num_jobs <= 1)
+  {
+    for (std::size_t i = 0; i < num_jobs; ++i)
+      job(i);
+
+    return;
+  }
+
+  std::mutex mutex;
+  std::condition_variable done;
+  std::size_t remaining = num_jobs;
+  std::exception_ptr error;
+  for (std::size_t i = 0; i < num_jobs; ++i)
+  {
+    executor->post(
+      [&, i]()
+      {
+        std::exception_ptr job_error;
+        try
+        {
+          job(i);
+        }
+        catch (...)
+        {
+          job_error = std::current_exception();
+        }
+
+        // Notify while locked so that the waiter cannot return and destroy
+        // the condition variable before this is done with it
+        std::lock_guard<std::mutex> lock(mutex);
+        if (job_error && !error)
+          error = job_error;
+
+        --remaining;
+        done.notify_all();
+      });
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&]() { return remaining == 0; });
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class FleetCoordinator::Implementation
+{
+public:
+
+  std::vector<TaskPlanner> planners;
+  std::vector<std::vector<State>> agents;
+  ExecutorPtr executor;
+
+  std::size_t check(const std::size_t fleet) const
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (fleet >= planners.size())
+    {
+      throw std::out_of_range(
+        "[FleetCoordinator] Fleet [" + std::to_string(fleet)
+        + "] is out of range for a coordinator of ["
+        + std::to_string(planners.size()) + "] fleets");
+    }
+    // *INDENT-ON*
+
+    return fleet;
+  }
+};
+
+//==============================================================================
+FleetCoordinator::FleetCoordinator(
+  std::vector<Fleet> fleets,
+  TaskPlanner::Options options,
+  const std::size_t num_threads)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  for (auto& fleet : fleets)
+  {
+    auto configuration = std::move(fleet.configuration);
+    if (!configuration.travel_estimator())
+    {
+      configuration.travel_estimator(
+        TravelEstimator::shared(configuration.parameters()));
+    }
+
+    _pimpl->planners.emplace_back(
+      fleet.name, std::move(configuration), options);
+    _pimpl->agents.push_back(std::move(fleet.agents));
+  }
+
+  if (_pimpl->planners.size() > 1)
+    _pimpl->executor = Executor::make_thread_pool(num_threads);
+}
+
+//==============================================================================
+std::size_t FleetCoordinator::num_fleets() const
+{
+  return _pimpl->planners.size();
+}
+
+//==============================================================================
+const TaskPlanner& FleetCoordinator::planner(const std::size_t fleet) const
+{
+  return _pimpl->planners[_pimpl->check(fleet)];
+}
+
+//==============================================================================
+const std::vector<State>& FleetCoordinator::agents(
+  const std::size_t fleet) const
+{
+  return _pimpl->agents[_pimpl->check(fleet)];
+}
+
+//==============================================================================
+FleetCoordinator& FleetCoordinator::agents(
+  const std::size_t fleet,
+  std::vector<State> agents)
+{
+  _pimpl->agents[_pimpl->check(fleet)] = std::move(agents);
+  return *this;
+}
+
+//==============================================================================
+auto FleetCoordinator::assign(
+  const rmf_traffic::Time time_now,
+  const std::vector<ConstRequestPtr>& requests) -> Result
+{
+  auto& planners = _pimpl->planners;
+  const auto& agents = _pimpl->agents;
+  const auto& executor = _pimpl->executor;
+  const std::size_t num_fleets = planners.size();
+
+  Result result;
+  result.assignments.resize(num_fleets);
+  for (std::size_t f = 0; f < num_fleets; ++f)
+    result.assignments[f].resize(agents[f].size());
+
+  // Requests that can start sooner are auctioned first
+  std::vector<ConstRequestPtr> auction = requests;
+  std::stable_sort(auction.begin(), auction.end(),
+    [](const ConstRequestPtr& a, const ConstRequestPtr& b)
+    {
+      return a->booking()->earliest_start_time()
+      < b->booking()->earliest_start_time();
+    });
+
+  std::vector<std::vector<ConstRequestPtr>> won(num_fleets);
+  std::vector<std::optional<TaskPlanner::Insertion>> bids(num_fleets);
+  for (const auto& request : auction)
+  {
+    run_all(executor, num_fleets,
+      [&](const std::size_t f)
+      {
+        bids[f] = planners[f].evaluate_insertion(
+          time_now, agents[f], result.assignments[f], request);
+      });
+
+    std::optional<std::size_t> winner;
+    for (std::size_t f = 0; f < num_fleets; ++f)
+    {
+      if (!bids[f].has_value())
+        continue;
+
+      if (!winner.has_value()
+        || bids[f]->additional_cost < bids[*winner]->additional_cost)
+        winner = f;
+    }
+
+    if (!winner.has_value())
+    {
+      result.unassigned.push_back(request->booking()->id());
+      continue;
+    }
+
+    result.assignments[*winner] = std::move(bids[*winner]->assignments);
+    won[*winner].push_back(request);
+  }
+
+  // Each fleet plans the requests that it won on its own, which is where
+  // charging tasks and finishing requests get added
+  result.costs.resize(num_fleets, 0.0);
+  run_all(executor, num_fleets,
+    [&](const std::size_t f)
+    {
+      auto& assignments = result.assignments[f];
+      double cost = planners[f].compute_cost(assignments);
+      if (!won[f].empty())
+      {
+        const auto planned = planners[f].plan(time_now, agents[f], won[f]);
+        const auto* plan = std::get_if<TaskPlanner::Assignments>(&planned);
+        if (plan)
+        {
+          const double plan_cost = planners[f].compute_cost(*plan);
+          if (plan_cost < cost)
+          {
+            assignments = *plan;
+            cost = plan_cost;
+          }
+        }
+      }
+
+      result.costs[f] = cost;
+    });
+
+  return result;
+}
+
+} // namespace rmf_task
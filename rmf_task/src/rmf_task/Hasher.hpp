@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__HASHER_HPP
+#define SRC__RMF_TASK__HASHER_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace rmf_task {
+
+//==============================================================================
+// 64-bit FNV-1a, for fingerprinting the content of objects
+class Hasher
+{
+public:
+
+  Hasher& operator<<(const std::string& value)
+  {
+    *this << static_cast<uint64_t>(value.size());
+    add(value.data(), value.size());
+    return *this;
+  }
+
+  Hasher& operator<<(double value)
+  {
+    add(&value, sizeof(value));
+    return *this;
+  }
+
+  Hasher& operator<<(uint64_t value)
+  {
+    add(&value, sizeof(value));
+    return *this;
+  }
+
+  uint64_t value() const
+  {
+    return _hash;
+  }
+
+private:
+
+  void add(const void* data, const std::size_t size)
+  {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      _hash ^= bytes[i];
+      _hash *= 0x100000001b3;
+    }
+  }
+
+  uint64_t _hash = 0xcbf29ce484222325;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__HASHER_HPP
@@ -17,6 +17,9 @@
 
 #include <rmf_task/Header.hpp>
 
+#include <memory>
+#include <mutex>
+
 namespace rmf_task {
 
 //==============================================================================
@@ -24,8 +27,17 @@ class Header::Implementation
 {
 public:
 
+  // The details are shared between copies of a header so that lazy details
+  // are only generated once
+  struct Detail
+  {
+    std::function<std::string()> make;
+    std::once_flag generated;
+    std::string value;
+  };
+
   std::string category;
-  std::string detail;
+  std::shared_ptr<Detail> detail;
   rmf_traffic::Duration duration;
 
 };
@@ -37,10 +49,27 @@ Header::Header(
   rmf_traffic::Duration estimate_)
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
-        std::move(category_), std::move(detail_), estimate_
+        std::move(category_),
+        std::make_shared<Implementation::Detail>(),
+        estimate_
+      }))
+{
+  _pimpl->detail->value = std::move(detail_);
+}
+
+//==============================================================================
+Header::Header(
+  std::string category_,
+  std::function<std::string()> make_detail_,
+  rmf_traffic::Duration estimate_)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        std::move(category_),
+        std::make_shared<Implementation::Detail>(),
+        estimate_
       }))
 {
-  // Do nothing
+  _pimpl->detail->make = std::move(make_detail_);
 }
 
 //==============================================================================
@@ -52,7 +81,16 @@ const std::string& Header::category() const
 //==============================================================================
 const std::string& Header::detail() const
 {
-  return _pimpl->detail;
+  auto& detail = *_pimpl->detail;
+  if (detail.make)
+  {
+    std::call_once(detail.generated, [&detail]()
+      {
+        detail.value = detail.make();
+      });
+  }
+
+  return detail.value;
 }
 
 //==============================================================================
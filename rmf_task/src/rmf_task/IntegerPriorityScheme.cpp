@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/IntegerPriorityScheme.hpp>
+
+#include "BinaryPriority.hpp"
+#include "BinaryPriorityCostCalculator.hpp"
+
+namespace rmf_task {
+
+//==============================================================================
+std::shared_ptr<Priority> IntegerPriorityScheme::make_priority(
+  const std::size_t level)
+{
+  if (level == 0)
+    return nullptr;
+
+  return std::make_shared<BinaryPriority>(level);
+}
+
+//==============================================================================
+std::size_t IntegerPriorityScheme::level(const ConstPriorityPtr& priority)
+{
+  return BinaryPriority::level(priority);
+}
+
+//==============================================================================
+std::shared_ptr<CostCalculator> IntegerPriorityScheme::make_cost_calculator()
+{
+  return std::make_shared<BinaryPriorityCostCalculator>();
+}
+
+} // namespace rmf_task
@@ -19,64 +19,48 @@
 
 #include <cassert>
 #include <algorithm>
+#include <functional>
 
 namespace rmf_task {
 
 //==============================================================================
 InvariantHeuristicQueue::InvariantHeuristicQueue(
-  std::vector<double> initial_values)
+  std::vector<Ticks> initial_values)
+: _ends(std::move(initial_values))
 {
-  assert(!initial_values.empty());
-  std::sort(initial_values.begin(), initial_values.end());
-
-  for (const auto value : initial_values)
-    _stacks.push_back({{0, value}});
+  assert(!_ends.empty());
+  std::make_heap(_ends.begin(), _ends.end(), std::greater<Ticks>());
 }
 
 //==============================================================================
 void InvariantHeuristicQueue::add(
-  const double earliest_start_time, const double earliest_finish_time)
+  const Ticks earliest_start_time, const Ticks earliest_finish_time)
 {
-  double prev_end_value = _stacks[0].back().end;
-  double new_end_value = prev_end_value +
-    (earliest_finish_time - earliest_start_time);
-  _stacks[0].push_back({earliest_start_time, new_end_value});
+  // The task goes onto the stack that currently ends the earliest
+  std::pop_heap(_ends.begin(), _ends.end(), std::greater<Ticks>());
+  Ticks& end = _ends.back();
+  end += earliest_finish_time - earliest_start_time;
 
-  // Find the largest stack that is still smaller than the current front
-  const auto next_it = _stacks.begin() + 1;
-  auto end_it = next_it;
-  for (; end_it != _stacks.end(); ++end_it)
-  {
-    if (new_end_value <= end_it->back().end)
-      break;
-  }
+  // Set lower bound of 0 to account for case where optimistically calculated
+  // end time is smaller than earliest start time. The bottom element of each
+  // stack is never added here because it represents a component of the cost
+  // that is already accounted for by g(n) and the variant component of h(n).
+  _cost += std::max<Ticks>(0, end - earliest_start_time);
 
-  if (next_it != end_it)
-  {
-    // Rotate the vector elements to move the front stack to its new place
-    // in the order
-    std::rotate(_stacks.begin(), next_it, end_it);
-  }
+  std::push_heap(_ends.begin(), _ends.end(), std::greater<Ticks>());
 }
 
 //==============================================================================
 double InvariantHeuristicQueue::compute_cost() const
 {
-  double total_cost = 0.0;
-  for (const auto& stack : _stacks)
-  {
-    // NOTE: We start iterating from i=1 because i=0 represents a component of
-    // the cost that is already accounted for by g(n) and the variant
-    // component of h(n)
-    for (std::size_t i = 1; i < stack.size(); ++i)
-    {
-      // Set lower bound of 0 to account for case where optimistically calculated
-      // end time is smaller than earliest start time
-      total_cost += std::max(0.0, (stack[i].end - stack[i].start));
-    }
-  }
+  return ticks_to_seconds(_cost);
+}
 
-  return total_cost;
+//==============================================================================
+std::vector<Ticks> InvariantHeuristicQueue::release()
+{
+  _cost = 0;
+  return std::move(_ends);
 }
 
 } // namespace rmf_task
@@ -15,6 +15,8 @@
  *
 */
 
+#include <rmf_traffic/Time.hpp>
+
 #include <vector>
 
 #ifndef SRC__RMF_TASK__INVARIANTHEURISTICQUEUE_HPP
@@ -22,23 +24,53 @@
 
 namespace rmf_task {
 
+// Times and durations inside the search are kept as integer ticks of
+// rmf_traffic::Duration, so that adding them up is exact and does not depend
+// on the platform. They are only converted to seconds to produce a cost.
+using Ticks = rmf_traffic::Duration::rep;
+
+inline Ticks to_ticks(const rmf_traffic::Time time)
+{
+  return time.time_since_epoch().count();
+}
+
+inline Ticks to_ticks(const rmf_traffic::Duration duration)
+{
+  return duration.count();
+}
+
+inline double ticks_to_seconds(const Ticks ticks)
+{
+  return rmf_traffic::time::to_seconds(rmf_traffic::Duration(ticks));
+}
+
 // Sorts and distributes tasks among agents based on the earliest finish time
 // possible for each task (i.e. not accounting for any variant costs). Guaranteed
 // to underestimate actual cost when the earliest start times for each task are
 // similar (enforced by the segmentation_threshold).
+//
+// Each agent is modelled as a stack of tasks, but only the end time of each
+// stack affects where later tasks go, and the cost of a task is known as soon
+// as it is added. The queue therefore keeps a min-heap of stack end times and
+// a running total instead of the stacks themselves.
 class InvariantHeuristicQueue
 {
 public:
 
-  InvariantHeuristicQueue(std::vector<double> initial_values);
+  InvariantHeuristicQueue(std::vector<Ticks> initial_values);
 
-  void add(const double earliest_start_time, const double earliest_finish_time);
+  void add(const Ticks earliest_start_time, const Ticks earliest_finish_time);
 
+  // The cost in seconds
   double compute_cost() const;
 
+  // Take back the storage of the queue so that it can be reused by another
+  // queue without allocating
+  std::vector<Ticks> release();
+
 private:
-  struct element { double start; double end; };
-  std::vector<std::vector<element>> _stacks;
+  std::vector<Ticks> _ends;
+  Ticks _cost = 0;
 };
 
 } // namespace rmf_task
@@ -16,39 +16,146 @@
 */
 
 #include <rmf_task/Log.hpp>
+#include <rmf_task/Metrics.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <optional>
 #include <mutex>
+#include <sstream>
 #include <stdexcept>
-#include <list>
 #include <unordered_map>
+#include <vector>
 
 namespace rmf_task {
 
+namespace {
 //==============================================================================
-class Log::Implementation
+struct Slot
+{
+  // Set once the entry has been written
+  std::atomic_bool ready = false;
+  std::optional<Log::Entry> entry;
+};
+
+//==============================================================================
+// A block of consecutive entries. Each entry has a position, which counts
+// every entry that was ever added to the log. The storage of a chunk never
+// moves, so readers can read the entries that were added before they got
+// their View while new entries are being added to the same chunk.
+struct Chunk
+{
+  Chunk(uint64_t begin_)
+  : begin(begin_),
+    slots(new Slot[Log::ChunkSize])
+  {
+    // Do nothing
+  }
+
+  // The position of the first entry of this chunk
+  const uint64_t begin;
+
+  std::unique_ptr<Slot[]> slots;
+
+  // The next chunk of the log. Whichever producer first needs the next chunk
+  // sets this pointer, and then hands ownership of the chunk to next_owner.
+  std::atomic<Chunk*> next = nullptr;
+  std::shared_ptr<Chunk> next_owner;
+  std::atomic_bool owned = false;
+};
+
+//==============================================================================
+// Each chunk owns the next one, so releasing a long chain would recurse once
+// per chunk. Instead, the chunks that get released while another chunk is
+// being deleted are queued and deleted one after another.
+void delete_chunk(Chunk* chunk)
+{
+  thread_local std::vector<Chunk*>* queue = nullptr;
+  if (queue)
+  {
+    queue->push_back(chunk);
+    return;
+  }
+
+  std::vector<Chunk*> pending = {chunk};
+  queue = &pending;
+  while (!pending.empty())
+  {
+    Chunk* next = pending.back();
+    pending.pop_back();
+    delete next;
+  }
+  queue = nullptr;
+}
+
+//==============================================================================
+std::shared_ptr<Chunk> make_chunk(uint64_t begin)
+{
+  return std::shared_ptr<Chunk>(new Chunk(begin), delete_chunk);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class Log::Format::Implementation
 {
 public:
-  std::function<rmf_traffic::Time()> clock;
-  std::shared_ptr<std::list<Log::Entry>> entries;
-  mutable std::mutex mutex;
-  uint32_t seq = 0;
+  std::string pattern;
 
-  Implementation(std::function<rmf_traffic::Time()> clock_)
-  : clock(std::move(clock_)),
-    entries(std::make_shared<std::list<Log::Entry>>())
+  // The text around the placeholders. There is one more piece than there are
+  // placeholders.
+  std::vector<std::string> pieces;
+
+  static const Implementation* get(const Format& format)
   {
-    if (!clock)
+    return format._pimpl;
+  }
+
+  static const Implementation* intern(const std::string& pattern)
+  {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<Implementation>>
+    formats;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& format = formats[pattern];
+    if (!format)
     {
-      clock = []()
-        {
-          return rmf_traffic::Time(
-            rmf_traffic::Duration(
-              std::chrono::system_clock::now().time_since_epoch()));
-        };
+      format = std::make_unique<Implementation>();
+      format->pattern = pattern;
+
+      std::size_t start = 0;
+      std::size_t placeholder = pattern.find("{}");
+      while (placeholder != std::string::npos)
+      {
+        format->pieces.push_back(pattern.substr(start, placeholder - start));
+        start = placeholder + 2;
+        placeholder = pattern.find("{}", start);
+      }
+      format->pieces.push_back(pattern.substr(start));
     }
+
+    return format.get();
   }
 
+  std::string render(const std::vector<Argument>& arguments) const
+  {
+    std::string text = pieces.front();
+    for (std::size_t i = 1; i < pieces.size(); ++i)
+    {
+      if (i - 1 < arguments.size())
+        text += arguments[i - 1].render();
+      else
+        text += "{}";
+
+      text += pieces[i];
+    }
+
+    for (std::size_t i = pieces.size() - 1; i < arguments.size(); ++i)
+      text += " " + arguments[i].render();
+
+    return text;
+  }
 };
 
 //==============================================================================
@@ -63,48 +170,338 @@ public:
     std::string text)
   {
     Log::Entry output;
-    output._pimpl = rmf_utils::make_impl<Implementation>(
-      Implementation{
-        tier,
-        seq,
-        time,
-        std::move(text)
-      });
+    output._pimpl = rmf_utils::make_impl<Implementation>(tier, seq, time);
+    output._pimpl->plain = std::move(text);
+    return output;
+  }
 
+  static Entry make(
+    Tier tier,
+    uint32_t seq,
+    rmf_traffic::Time time,
+    const Format::Implementation* format,
+    std::vector<Argument> arguments)
+  {
+    Log::Entry output;
+    output._pimpl = rmf_utils::make_impl<Implementation>(tier, seq, time);
+    output._pimpl->format = format;
+    output._pimpl->arguments = std::move(arguments);
     return output;
   }
 
+  static void set_seq(Entry& entry, uint32_t seq)
+  {
+    entry._pimpl->seq = seq;
+  }
+
+  // The approximate number of bytes used by an entry, without rendering it
+  static std::size_t bytes(const Entry& entry)
+  {
+    const auto& impl = *entry._pimpl;
+    std::size_t output = sizeof(Slot) + sizeof(Implementation)
+      + impl.plain.capacity()
+      + impl.arguments.capacity() * sizeof(Argument);
+
+    for (const auto& argument : impl.arguments)
+    {
+      if (const auto* text = std::get_if<std::string>(&argument.value()))
+        output += text->capacity();
+    }
+
+    return output;
+  }
+
+  Implementation(Tier tier_, uint32_t seq_, rmf_traffic::Time time_)
+  : tier(tier_),
+    seq(seq_),
+    time(time_)
+  {
+    // Do nothing
+  }
+
+  Implementation(const Implementation& other)
+  : tier(other.tier),
+    seq(other.seq),
+    time(other.time),
+    plain(other.plain),
+    format(other.format),
+    arguments(other.arguments)
+  {
+    if (const auto* text = other.rendered.load(std::memory_order_acquire))
+      rendered = new std::string(*text);
+  }
+
+  Implementation& operator=(const Implementation& other)
+  {
+    if (this == &other)
+      return *this;
+
+    tier = other.tier;
+    seq = other.seq;
+    time = other.time;
+    plain = other.plain;
+    format = other.format;
+    arguments = other.arguments;
+
+    const auto* text = other.rendered.load(std::memory_order_acquire);
+    delete rendered.exchange(text ? new std::string(*text) : nullptr);
+    return *this;
+  }
+
+  ~Implementation()
+  {
+    delete rendered.load();
+  }
+
+  const std::string& text() const
+  {
+    if (!format)
+      return plain;
+
+    const std::string* text = rendered.load(std::memory_order_acquire);
+    if (text)
+      return *text;
+
+    // Several readers may render the same entry at once. Whichever finishes
+    // first provides the text for all of them.
+    auto* fresh = new std::string(format->render(arguments));
+    if (rendered.compare_exchange_strong(text, fresh))
+      return *fresh;
+
+    delete fresh;
+    return *text;
+  }
+
   Tier tier;
   uint32_t seq;
   rmf_traffic::Time time;
-  std::string text;
 
+  // The text of an entry that was given as a string
+  std::string plain;
+
+  // The format and arguments of an entry whose text is rendered when it is
+  // first asked for
+  const Format::Implementation* format = nullptr;
+  std::vector<Argument> arguments;
+  mutable std::atomic<const std::string*> rendered = nullptr;
 };
 
 //==============================================================================
-class Log::View::Implementation
+namespace {
+std::size_t approximate_bytes(const Log::Entry& entry)
+{
+  return Log::Entry::Implementation::bytes(entry);
+}
+} // anonymous namespace
+
+//==============================================================================
+// Producers append without taking any lock. Each one claims a position with a
+// single atomic increment, finds or creates the chunk of that position, writes
+// its entry into the slot, and marks the slot as ready. The entries become
+// visible once every position before them is ready as well. Advancing that
+// published position and evicting chunks only happens under the mutex, which
+// is taken by view() and by the other accessors, and only tried by producers.
+class Log::Implementation
 {
 public:
+  std::function<rmf_traffic::Time()> clock;
 
-  static View make(const Log& log)
+  // Views and readers use this to recognize the log
+  std::shared_ptr<const int> token = std::make_shared<const int>(0);
+
+  // The next position that a producer will claim
+  std::atomic<uint64_t> claimed = 0;
+
+  // The most recent chunk that a producer has needed. Its first position is
+  // never greater than any position that is still unclaimed.
+  std::atomic<Chunk*> hint;
+
+  // The number of producers that are currently appending. Evicted chunks are
+  // only released while there are none, because a producer may still be
+  // walking through them.
+  std::atomic_size_t writers = 0;
+
+  std::atomic_size_t bytes = 0;
+  std::atomic_bool limited = false;
+
+  // Everything below is guarded by this mutex
+  mutable std::mutex mutex;
+
+  std::shared_ptr<Chunk> head;
+
+  // The chunk of the published position
+  Chunk* frontier;
+
+  // The position of the oldest kept entry and one past the newest published
+  // entry
+  uint64_t begin = 0;
+  uint64_t published = 0;
+
+  std::optional<std::size_t> max_entries;
+  std::optional<std::size_t> max_bytes;
+  std::optional<rmf_traffic::Duration> max_age;
+
+  std::vector<std::shared_ptr<Chunk>> retired;
+
+  Implementation(std::function<rmf_traffic::Time()> clock_)
+  : clock(std::move(clock_)),
+    head(make_chunk(0))
   {
-    View output;
+    if (!clock)
+    {
+      clock = []()
+        {
+          return rmf_traffic::Time(
+            rmf_traffic::Duration(
+              std::chrono::system_clock::now().time_since_epoch()));
+        };
+    }
+
+    hint = head.get();
+    frontier = head.get();
+  }
+
+  void append(Log::Entry entry, bool assign_seq)
+  {
+    Metrics::add(Metrics::Counter::log_entries);
+    writers.fetch_add(1);
+    Chunk* chunk = hint.load();
+    const uint64_t position = claimed.fetch_add(1);
+
+    while (chunk->begin + Log::ChunkSize <= position)
+    {
+      Chunk* next = chunk->next.load(std::memory_order_acquire);
+      if (!next)
+      {
+        auto fresh = make_chunk(chunk->begin + Log::ChunkSize);
+        if (chunk->next.compare_exchange_strong(next, fresh.get()))
+        {
+          next = fresh.get();
+          chunk->next_owner = std::move(fresh);
+          chunk->owned.store(true, std::memory_order_release);
+        }
+      }
+
+      chunk = next;
+    }
+
+    Chunk* current_hint = hint.load();
+    while (current_hint->begin < chunk->begin
+      && !hint.compare_exchange_weak(current_hint, chunk))
+    {
+      // Keep trying until the hint is at least as new as this chunk
+    }
+
+    if (assign_seq)
+      Entry::Implementation::set_seq(entry, static_cast<uint32_t>(position));
+
+    bytes.fetch_add(approximate_bytes(entry));
+    Slot& slot = chunk->slots[position - chunk->begin];
+    slot.entry.emplace(std::move(entry));
+    slot.ready.store(true, std::memory_order_release);
+    writers.fetch_sub(1);
+
+    if (limited.load(std::memory_order_relaxed))
+    {
+      // Producers never wait for the mutex. If someone else holds it, they
+      // will evict the chunks or the next append will.
+      std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+      if (lock.owns_lock())
+      {
+        publish();
+        evict();
+      }
+    }
+  }
 
-    if (log._pimpl->entries->empty())
+  // Must be called while holding the mutex
+  void publish()
+  {
+    while (true)
     {
-      output._pimpl = rmf_utils::make_impl<Implementation>(
-        Implementation{log._pimpl->entries, std::nullopt, std::nullopt});
+      const uint64_t offset = published - frontier->begin;
+      if (offset == Log::ChunkSize)
+      {
+        Chunk* next = frontier->next.load(std::memory_order_acquire);
+        if (!next)
+          return;
+
+        frontier = next;
+        continue;
+      }
+
+      if (!frontier->slots[offset].ready.load(std::memory_order_acquire))
+        return;
+
+      ++published;
     }
-    else
+  }
+
+  // Must be called while holding the mutex
+  void evict()
+  {
+    if (!max_entries && !max_bytes && !max_age)
+      return;
+
+    std::optional<rmf_traffic::Time> oldest_allowed;
+    if (max_age)
+      oldest_allowed = clock() - *max_age;
+
+    const Chunk* const newest = hint.load();
+    while (head.get() != newest && head.get() != frontier
+      && head->owned.load(std::memory_order_acquire))
     {
-      output._pimpl = rmf_utils::make_impl<Implementation>(
-        Implementation{
-          log._pimpl->entries,
-          log._pimpl->entries->cbegin(),
-          --log._pimpl->entries->cend()
-        });
+      std::size_t chunk_bytes = 0;
+      rmf_traffic::Time chunk_time = rmf_traffic::Time::min();
+      for (std::size_t i = 0; i < Log::ChunkSize; ++i)
+      {
+        const auto& entry = *head->slots[i].entry;
+        chunk_bytes += approximate_bytes(entry);
+        chunk_time = std::max(chunk_time, entry.time());
+      }
+
+      const bool too_many = max_entries && published - begin > *max_entries;
+      const bool too_big = max_bytes && bytes.load() > *max_bytes;
+      const bool too_old = oldest_allowed && chunk_time < *oldest_allowed;
+      if (!too_many && !too_big && !too_old)
+        break;
+
+      // Views that still hold this chunk can keep reading it
+      begin += Log::ChunkSize;
+      bytes.fetch_sub(chunk_bytes);
+      retired.push_back(head);
+      head = head->next_owner;
     }
 
+    if (!retired.empty() && writers.load() == 0)
+      retired.clear();
+  }
+
+  void update_limits()
+  {
+    limited = max_entries || max_bytes || max_age;
+    publish();
+    evict();
+  }
+};
+
+//==============================================================================
+class Log::View::Implementation
+{
+public:
+
+  static View make(const Log& log)
+  {
+    View output;
+    output._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{
+        log._pimpl->token,
+        log._pimpl->head,
+        log._pimpl->frontier,
+        log._pimpl->begin,
+        log._pimpl->published
+      });
+
     return output;
   }
 
@@ -113,15 +510,96 @@ public:
     return *view._pimpl;
   }
 
-  std::shared_ptr<const std::list<Log::Entry>> shared;
+  // Get the chunk that holds a position of this view. Recent positions are
+  // found right away in the last chunk.
+  const Chunk* find(uint64_t position) const
+  {
+    if (last->begin <= position)
+      return last;
+
+    const Chunk* chunk = first.get();
+    while (chunk->begin + Log::ChunkSize <= position)
+      chunk = chunk->next.load(std::memory_order_acquire);
+
+    return chunk;
+  }
+
+  // Get the position of the most recent entry of this view whose sequence
+  // number is seq
+  std::optional<uint64_t> find_seq(uint32_t seq) const
+  {
+    if (begin == end)
+      return std::nullopt;
+
+    // Pushed entries have the lower bits of their position as their sequence
+    // number, so the entry can usually be found directly.
+    const uint64_t newest = end - 1;
+    const uint64_t distance =
+      static_cast<uint32_t>(static_cast<uint32_t>(newest) - seq);
+    if (distance <= newest - begin)
+    {
+      const uint64_t position = newest - distance;
+      if (entry(position).seq() == seq)
+        return position;
+    }
+
+    // Inserted entries keep the sequence numbers that they came with, so fall
+    // back to searching for them
+    std::optional<uint64_t> found;
+    const Chunk* chunk = first.get();
+    for (uint64_t position = begin; position < end; ++position)
+    {
+      while (chunk->begin + Log::ChunkSize <= position)
+        chunk = chunk->next.load(std::memory_order_acquire);
+
+      if (chunk->slots[position - chunk->begin].entry->seq() == seq)
+        found = position;
+    }
 
-  /// begin is the iterator for the first entry in the entire log
-  std::optional<std::list<Log::Entry>::const_iterator> begin;
+    return found;
+  }
 
-  /// last is the iterator for the last entry that will be provided by this
-  /// view. This is NOT the usual end() iterator, but instead it is one-before
-  /// the usual end() iterator.
-  std::optional<std::list<Log::Entry>::const_iterator> last;
+  const Log::Entry& entry(uint64_t position) const
+  {
+    const Chunk* chunk = find(position);
+    return *chunk->slots[position - chunk->begin].entry;
+  }
+
+  // Append the entries in [from, end) to the output
+  std::size_t collect(uint64_t from, std::vector<const Entry*>& output) const
+  {
+    if (from >= end)
+      return 0;
+
+    const std::size_t count = static_cast<std::size_t>(end - from);
+    output.reserve(output.size() + count);
+
+    const Chunk* chunk = find(from);
+    for (uint64_t position = from; position < end; ++position)
+    {
+      if (position == chunk->begin + Log::ChunkSize)
+        chunk = chunk->next.load(std::memory_order_acquire);
+
+      output.push_back(&*chunk->slots[position - chunk->begin].entry);
+    }
+
+    return count;
+  }
+
+  std::shared_ptr<const int> token;
+
+  /// The oldest chunk that the log still kept when this view was made. This
+  /// keeps every newer chunk alive as well.
+  std::shared_ptr<const Chunk> first;
+
+  /// The newest chunk that this view reaches
+  const Chunk* last;
+
+  /// The position of the first entry that this view provides
+  uint64_t begin;
+
+  /// One past the position of the last entry that this view provides
+  uint64_t end;
 };
 
 //==============================================================================
@@ -131,17 +609,18 @@ public:
 
   struct Memory
   {
-    std::weak_ptr<const std::list<Log::Entry>> weak;
-    std::optional<std::list<Log::Entry>::const_iterator> last;
+    std::weak_ptr<const int> weak;
 
-    Memory()
-    {
-      // Do nothing
-    }
+    // The position of the next entry that this reader has not read yet
+    uint64_t next = 0;
   };
 
   std::unordered_map<const void*, Memory> memories;
 
+  // Get the position of the first entry of the view that this reader has not
+  // read yet, and mark the whole view as read
+  uint64_t advance(const View& view, std::size_t& truncated);
+
   Iterable read(const View& view);
 };
 
@@ -149,111 +628,114 @@ public:
 class Log::Reader::Iterable::Implementation
 {
 public:
-  using base_iterator = std::list<Log::Entry>::const_iterator;
-  std::shared_ptr<const std::list<Log::Entry>> shared;
+  std::shared_ptr<const Chunk> shared;
   std::optional<iterator> begin;
+  std::size_t truncated = 0;
 
   static Log::Reader::Iterable make(
-    std::shared_ptr<const std::list<Log::Entry>> shared,
-    std::optional<base_iterator> begin,
-    std::optional<base_iterator> last);
+    std::shared_ptr<const Chunk> shared,
+    uint64_t begin,
+    uint64_t end,
+    std::size_t truncated);
 };
 
 //==============================================================================
 class Log::Reader::Iterable::iterator::Implementation
 {
 public:
-  using base_iterator = std::list<Log::Entry>::const_iterator;
-  base_iterator it;
-  base_iterator last;
+  const Chunk* chunk;
+  uint64_t position;
+  uint64_t end;
 
-  static iterator make(base_iterator it, base_iterator last)
+  static iterator make(const Chunk* chunk, uint64_t position, uint64_t end)
   {
     iterator output;
     output._pimpl = rmf_utils::make_impl<Implementation>(
-      Implementation{std::move(it), std::move(last)});
+      Implementation{chunk, position, end});
 
     return output;
   }
 
-  static iterator end()
+  static iterator end_iterator()
   {
     return iterator();
   }
+
+  const Entry& entry() const
+  {
+    return *chunk->slots[position - chunk->begin].entry;
+  }
 };
 
 //==============================================================================
 Log::Reader::Iterable Log::Reader::Iterable::Implementation::make(
-  std::shared_ptr<const std::list<Log::Entry>> shared,
-  std::optional<base_iterator> begin,
-  std::optional<base_iterator> last_in_view)
+  std::shared_ptr<const Chunk> shared,
+  uint64_t begin,
+  uint64_t end,
+  std::size_t truncated)
 {
   Iterable iterable;
   iterable._pimpl = rmf_utils::make_impl<Implementation>();
-  iterable._pimpl->shared = std::move(shared);
-  if (begin.has_value())
+  iterable._pimpl->truncated = truncated;
+  if (begin < end)
   {
+    const Chunk* chunk = shared.get();
+    while (chunk->begin + Log::ChunkSize <= begin)
+      chunk = chunk->next.load(std::memory_order_acquire);
+
     iterable._pimpl->begin =
-      iterator::Implementation::make(*begin, last_in_view.value());
+      iterator::Implementation::make(chunk, begin, end);
   }
   else
   {
-    iterable._pimpl->begin = iterator::Implementation::end();
+    iterable._pimpl->begin = iterator::Implementation::end_iterator();
   }
 
+  iterable._pimpl->shared = std::move(shared);
   return iterable;
 }
 
 //==============================================================================
-auto Log::Reader::Implementation::read(const View& view) -> Iterable
+uint64_t Log::Reader::Implementation::advance(
+  const View& view,
+  std::size_t& truncated)
 {
   const auto& v = View::Implementation::get(view);
-  const auto it = memories.insert({v.shared.get(), Memory()}).first;
-  auto& memory = it->second;
-  if (memory.weak.lock())
+  auto& memory = memories[v.token.get()];
+  if (!memory.weak.lock())
   {
-    if (!memory.last.has_value())
-    {
-      memory.last = v.begin;
-    }
-    else if (v.last.has_value())
-    {
-      if ((*memory.last)->seq() >= (*v.last)->seq())
-      {
-        // If the last memory of this reader is more recent than this view, then
-        // we will return an empty iterable.
-        return Iterable::Implementation::make(
-          v.shared, std::nullopt, std::nullopt);
-      }
-      else
-      {
-        // If the last memory of this reader is behind the last value in the
-        // view, then we will move it forward by one.
-        ++(*memory.last);
-      }
-    }
-    else
-    {
-      // The view is missing a "last" value, meaning it's an empty view.
-      // TODO(MXG): We should write explicit unit tests for this.
-      return Iterable::Implementation::make(
-        v.shared, std::nullopt, std::nullopt);
-    }
+    // Reset this memory, because it belongs to an expired log whose memory
+    // address is being recycled.
+    memory.weak = v.token;
+    memory.next = 0;
   }
-  else
+
+  uint64_t begin = memory.next;
+  truncated = 0;
+  if (begin < v.begin)
   {
-    // Reset this memory, because it points at an expired list whose memory
-    // address is being recycled.
-    memory.weak = v.shared;
-    memory.last = v.begin;
+    // The log evicted some entries before this reader could read them
+    truncated = static_cast<std::size_t>(v.begin - begin);
+    begin = v.begin;
   }
 
-  auto iterable = Iterable::Implementation::make(
-    v.shared, memory.last, v.last);
+  memory.next = std::max(begin, v.end);
+  return begin;
+}
 
-  memory.last = v.last;
+//==============================================================================
+auto Log::Reader::Implementation::read(const View& view) -> Iterable
+{
+  const auto& v = View::Implementation::get(view);
+  std::size_t truncated = 0;
+  const uint64_t begin = advance(view, truncated);
+  if (begin >= v.end)
+  {
+    // This reader has already read everything in this view
+    return Iterable::Implementation::make(v.first, 0, 0, truncated);
+  }
 
-  return iterable;
+  return Iterable::Implementation::make(v.first, begin, v.end, truncated);
 }
 
 //==============================================================================
@@ -292,25 +774,136 @@ void Log::push(Tier tier, std::string text)
     // *INDENT-ON*
   }
 
-  std::lock_guard<std::mutex> lock(_pimpl->mutex);
-  _pimpl->entries->emplace_back(
+  _pimpl->append(
+    Entry::Implementation::make(tier, 0, _pimpl->clock(), std::move(text)),
+    true);
+}
+
+//==============================================================================
+void Log::info(const Format& format, std::vector<Argument> arguments)
+{
+  push(Tier::Info, format, std::move(arguments));
+}
+
+//==============================================================================
+void Log::warn(const Format& format, std::vector<Argument> arguments)
+{
+  push(Tier::Warning, format, std::move(arguments));
+}
+
+//==============================================================================
+void Log::error(const Format& format, std::vector<Argument> arguments)
+{
+  push(Tier::Error, format, std::move(arguments));
+}
+
+//==============================================================================
+void Log::push(
+  Tier tier,
+  const Format& format,
+  std::vector<Argument> arguments)
+{
+  if (Tier::Uninitialized == tier)
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[Log::push] Tier was set to Uninitialized, which is illegal.");
+    // *INDENT-ON*
+  }
+
+  _pimpl->append(
     Entry::Implementation::make(
-      tier, _pimpl->seq++, _pimpl->clock(), std::move(text)));
+      tier, 0, _pimpl->clock(), Format::Implementation::get(format),
+      std::move(arguments)),
+    true);
 }
 
 //==============================================================================
 void Log::insert(Log::Entry entry)
 {
-  _pimpl->entries->emplace_back(std::move(entry));
+  _pimpl->append(std::move(entry), false);
 }
 
 //==============================================================================
 Log::View Log::view() const
 {
   std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->publish();
+  _pimpl->evict();
   return View::Implementation::make(*this);
 }
 
+//==============================================================================
+Log& Log::max_entries(std::optional<std::size_t> value)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->max_entries = value;
+  _pimpl->update_limits();
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> Log::max_entries() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->max_entries;
+}
+
+//==============================================================================
+Log& Log::max_bytes(std::optional<std::size_t> value)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->max_bytes = value;
+  _pimpl->update_limits();
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> Log::max_bytes() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->max_bytes;
+}
+
+//==============================================================================
+Log& Log::max_age(std::optional<rmf_traffic::Duration> value)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->max_age = value;
+  _pimpl->update_limits();
+  return *this;
+}
+
+//==============================================================================
+std::optional<rmf_traffic::Duration> Log::max_age() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->max_age;
+}
+
+//==============================================================================
+std::size_t Log::size() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->publish();
+  return static_cast<std::size_t>(_pimpl->published - _pimpl->begin);
+}
+
+//==============================================================================
+std::size_t Log::evicted() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return static_cast<std::size_t>(_pimpl->begin);
+}
+
+//==============================================================================
+uint64_t Log::version() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->publish();
+  return _pimpl->published;
+}
+
 //==============================================================================
 auto Log::Entry::tier() const -> Tier
 {
@@ -332,7 +925,93 @@ rmf_traffic::Time Log::Entry::time() const
 //==============================================================================
 const std::string& Log::Entry::text() const
 {
-  return _pimpl->text;
+  return _pimpl->text();
+}
+
+//==============================================================================
+Log::Format::Format(const std::string& pattern)
+: _pimpl(Implementation::intern(pattern))
+{
+  // Do nothing
+}
+
+//==============================================================================
+const std::string& Log::Format::pattern() const
+{
+  return _pimpl->pattern;
+}
+
+//==============================================================================
+Log::Argument::Argument(std::string value)
+: _value(std::move(value))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Log::Argument::Argument(const char* value)
+: _value(std::string(value))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Log::Argument::Argument(double value)
+: _value(value)
+{
+  // Do nothing
+}
+
+//==============================================================================
+Log::Argument::Argument(rmf_traffic::Time value)
+: _value(value)
+{
+  // Do nothing
+}
+
+//==============================================================================
+Log::Argument::Argument(rmf_traffic::Duration value)
+: _value(value)
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Log::Argument::value() const -> const Value&
+{
+  return _value;
+}
+
+//==============================================================================
+std::string Log::Argument::render() const
+{
+  const auto seconds = [](rmf_traffic::Duration duration)
+    {
+      std::ostringstream stream;
+      stream << rmf_traffic::time::to_seconds(duration);
+      return stream.str();
+    };
+
+  if (const auto* text = std::get_if<std::string>(&_value))
+    return *text;
+
+  if (const auto* integer = std::get_if<int64_t>(&_value))
+    return std::to_string(*integer);
+
+  if (const auto* integer = std::get_if<uint64_t>(&_value))
+    return std::to_string(*integer);
+
+  if (const auto* number = std::get_if<double>(&_value))
+  {
+    std::ostringstream stream;
+    stream << *number;
+    return stream.str();
+  }
+
+  if (const auto* time = std::get_if<rmf_traffic::Time>(&_value))
+    return seconds(time->time_since_epoch());
+
+  return seconds(std::get<rmf_traffic::Duration>(_value)) + "s";
 }
 
 //==============================================================================
@@ -341,6 +1020,27 @@ Log::Entry::Entry()
   // Do nothing
 }
 
+//==============================================================================
+std::size_t Log::View::size() const
+{
+  return static_cast<std::size_t>(_pimpl->end - _pimpl->begin);
+}
+
+//==============================================================================
+std::size_t Log::View::entries_after(
+  std::optional<uint32_t> seq,
+  std::vector<const Entry*>& output) const
+{
+  if (!seq.has_value())
+    return _pimpl->collect(_pimpl->begin, output);
+
+  const auto position = _pimpl->find_seq(*seq);
+  if (!position.has_value())
+    return _pimpl->collect(_pimpl->begin, output);
+
+  return _pimpl->collect(*position + 1, output);
+}
+
 //==============================================================================
 Log::View::View()
 {
@@ -360,28 +1060,44 @@ auto Log::Reader::read(const View& view) -> Iterable
   return _pimpl->read(view);
 }
 
+//==============================================================================
+std::size_t Log::Reader::read(
+  const View& view,
+  std::vector<const Entry*>& output)
+{
+  std::size_t truncated = 0;
+  const uint64_t begin = _pimpl->advance(view, truncated);
+  return View::Implementation::get(view).collect(begin, output);
+}
+
 //==============================================================================
 auto Log::Reader::Iterable::begin() const -> iterator
 {
-  return _pimpl->begin.value_or(iterator::Implementation::end());
+  return _pimpl->begin.value_or(iterator::Implementation::end_iterator());
 }
 
 //==============================================================================
 auto Log::Reader::Iterable::end() const -> iterator
 {
-  return iterator::Implementation::end();
+  return iterator::Implementation::end_iterator();
+}
+
+//==============================================================================
+std::size_t Log::Reader::Iterable::truncated() const
+{
+  return _pimpl->truncated;
 }
 
 //==============================================================================
 auto Log::Reader::Iterable::iterator::operator*() const -> const Entry&
 {
-  return *_pimpl->it;
+  return _pimpl->entry();
 }
 
 //==============================================================================
 auto Log::Reader::Iterable::iterator::operator->() const -> const Entry*
 {
-  return &(*_pimpl->it);
+  return &_pimpl->entry();
 }
 
 //==============================================================================
@@ -390,10 +1106,16 @@ auto Log::Reader::Iterable::iterator::operator++() -> iterator&
   if (!_pimpl.get())
     return *this;
 
-  if (_pimpl->it == _pimpl->last)
+  ++_pimpl->position;
+  if (_pimpl->position == _pimpl->end)
+  {
     _pimpl = nullptr;
-  else
-    ++_pimpl->it;
+  }
+  else if (_pimpl->position == _pimpl->chunk->begin + Log::ChunkSize)
+  {
+    _pimpl->chunk =
+      _pimpl->chunk->next.load(std::memory_order_acquire);
+  }
 
   return *this;
 }
@@ -412,7 +1134,7 @@ bool Log::Reader::Iterable::iterator::operator==(const iterator& other) const
   if (!_pimpl.get() || !other._pimpl.get())
     return _pimpl.get() == other._pimpl.get();
 
-  return _pimpl->it == other._pimpl->it;
+  return _pimpl->position == other._pimpl->position;
 }
 
 //==============================================================================
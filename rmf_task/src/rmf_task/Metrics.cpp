@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/Metrics.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+constexpr std::array<double, Metrics::NumBounds> bounds = {
+  1e-5, 4e-5, 1.6e-4, 6.4e-4, 2.56e-3, 1.024e-2,
+  4.096e-2, 0.16384, 0.65536, 2.62144, 10.48576, 41.94304
+};
+
+//==============================================================================
+// Only the thread that owns a block ever changes it, so its values can be
+// updated with plain relaxed loads and stores instead of atomic increments.
+// Scraping threads read them with relaxed loads.
+struct Block
+{
+  struct Latency
+  {
+    std::array<std::atomic<uint64_t>, Metrics::NumBounds + 1> buckets = {};
+    std::atomic<uint64_t> nanoseconds = 0;
+  };
+
+  std::array<std::atomic<uint64_t>, Metrics::NumCounters> counters = {};
+  std::array<Latency, Metrics::NumLatencies> latencies = {};
+};
+
+//==============================================================================
+void bump(std::atomic<uint64_t>& value, const uint64_t amount)
+{
+  value.store(
+    value.load(std::memory_order_relaxed) + amount,
+    std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Keeps track of the block of every thread. The totals of threads that have
+// exited are folded into retired.
+class Registry
+{
+public:
+
+  static Registry& get()
+  {
+    // Never destroyed, since threads may exit after static destruction
+    static Registry* registry = new Registry;
+    return *registry;
+  }
+
+  void add(Block* block)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _live.push_back(block);
+  }
+
+  void retire(Block* block)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (std::size_t i = 0; i < Metrics::NumCounters; ++i)
+      bump(_retired.counters[i], block->counters[i].load());
+
+    for (std::size_t i = 0; i < Metrics::NumLatencies; ++i)
+    {
+      auto& from = block->latencies[i];
+      auto& to = _retired.latencies[i];
+      for (std::size_t b = 0; b < from.buckets.size(); ++b)
+        bump(to.buckets[b], from.buckets[b].load());
+
+      bump(to.nanoseconds, from.nanoseconds.load());
+    }
+
+    _live.erase(std::find(_live.begin(), _live.end(), block));
+  }
+
+  template<typename F>
+  void for_each(F&& f) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    f(_retired);
+    for (const auto* block : _live)
+      f(*block);
+  }
+
+private:
+  mutable std::mutex _mutex;
+  std::vector<Block*> _live;
+  Block _retired;
+};
+
+//==============================================================================
+struct LocalBlock
+{
+  LocalBlock()
+  {
+    Registry::get().add(&block);
+  }
+
+  ~LocalBlock()
+  {
+    Registry::get().retire(&block);
+  }
+
+  Block block;
+};
+
+//==============================================================================
+Block& local_block()
+{
+  thread_local LocalBlock local;
+  return local.block;
+}
+
+//==============================================================================
+constexpr std::array<const char*, Metrics::NumCounters> counter_names = {
+  "rmf_task_plans_total",
+  "rmf_task_plan_nodes_expanded_total",
+  "rmf_task_plan_nodes_generated_total",
+  "rmf_task_travel_estimate_hits_total",
+  "rmf_task_travel_estimate_misses_total",
+  "rmf_task_log_entries_total",
+  "rmf_task_backup_writes_total",
+  "rmf_task_backup_bytes_total",
+  "rmf_task_phase_snapshots_total",
+  "rmf_task_task_backups_total"
+};
+
+//==============================================================================
+constexpr std::array<const char*, Metrics::NumLatencies> latency_names = {
+  "rmf_task_plan_seconds",
+  "rmf_task_backup_write_seconds",
+  "rmf_task_plan_queueing_seconds"
+};
+
+} // anonymous namespace
+
+//==============================================================================
+const std::array<double, Metrics::NumBounds>& Metrics::bucket_bounds()
+{
+  return bounds;
+}
+
+//==============================================================================
+void Metrics::add(const Counter counter, const uint64_t amount)
+{
+  bump(local_block().counters[static_cast<std::size_t>(counter)], amount);
+}
+
+//==============================================================================
+void Metrics::observe(
+  const Latency latency,
+  const rmf_traffic::Duration duration)
+{
+  const double seconds = rmf_traffic::time::to_seconds(duration);
+  const auto bucket = static_cast<std::size_t>(
+    std::lower_bound(bounds.begin(), bounds.end(), seconds) - bounds.begin());
+
+  auto& histogram = local_block().latencies[static_cast<std::size_t>(latency)];
+  bump(histogram.buckets[bucket], 1);
+
+  const auto nanoseconds =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  bump(histogram.nanoseconds, static_cast<uint64_t>(std::max<int64_t>(
+      nanoseconds, 0)));
+}
+
+//==============================================================================
+uint64_t Metrics::total(const Counter counter)
+{
+  const auto index = static_cast<std::size_t>(counter);
+  uint64_t total = 0;
+  Registry::get().for_each(
+    [&](const Block& block)
+    {
+      total += block.counters[index].load(std::memory_order_relaxed);
+    });
+
+  return total;
+}
+
+//==============================================================================
+auto Metrics::histogram(const Latency latency) -> Histogram
+{
+  const auto index = static_cast<std::size_t>(latency);
+  Histogram output;
+  uint64_t nanoseconds = 0;
+  Registry::get().for_each(
+    [&](const Block& block)
+    {
+      const auto& h = block.latencies[index];
+      for (std::size_t b = 0; b < output.buckets.size(); ++b)
+        output.buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+
+      nanoseconds += h.nanoseconds.load(std::memory_order_relaxed);
+    });
+
+  for (const auto b : output.buckets)
+    output.count += b;
+
+  output.sum = static_cast<double>(nanoseconds) * 1e-9;
+  return output;
+}
+
+//==============================================================================
+void Metrics::scrape(Sink& sink)
+{
+  // Everything is aggregated before the sink is called, so the sink may take
+  // as long as it needs without holding up any thread that records metrics
+  std::array<uint64_t, NumCounters> counters = {};
+  std::array<Histogram, NumLatencies> histograms;
+  for (std::size_t i = 0; i < NumCounters; ++i)
+    counters[i] = total(static_cast<Counter>(i));
+
+  for (std::size_t i = 0; i < NumLatencies; ++i)
+    histograms[i] = histogram(static_cast<Latency>(i));
+
+  for (std::size_t i = 0; i < NumCounters; ++i)
+    sink.counter(counter_names[i], counters[i]);
+
+  for (std::size_t i = 0; i < NumLatencies; ++i)
+    sink.histogram(latency_names[i], histograms[i]);
+}
+
+//==============================================================================
+const char* Metrics::name(const Counter counter)
+{
+  return counter_names.at(static_cast<std::size_t>(counter));
+}
+
+//==============================================================================
+const char* Metrics::name(const Latency latency)
+{
+  return latency_names.at(static_cast<std::size_t>(latency));
+}
+
+//==============================================================================
+Metrics::ScopedLatency::ScopedLatency(const Latency latency)
+: _latency(latency),
+  _start(std::chrono::steady_clock::now())
+{
+  // Do nothing
+}
+
+//==============================================================================
+Metrics::ScopedLatency::~ScopedLatency()
+{
+  observe(_latency, std::chrono::steady_clock::now() - _start);
+}
+
+} // namespace rmf_task
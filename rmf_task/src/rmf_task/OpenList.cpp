@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include "OpenList.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace rmf_task {
+
+//==============================================================================
+OpenList::OpenList(
+  const double weight,
+  const TieBreak tie_break,
+  const bool ordered)
+: _weight(weight),
+  _tie_break(tie_break),
+  _ordered(ordered)
+{
+  // Do nothing
+}
+
+//==============================================================================
+void OpenList::push(ConstNodePtr node)
+{
+  double tie = 0.0;
+  if (_tie_break == TieBreak::Cost)
+    tie = -node->accumulated_cost;
+  else if (_tie_break == TieBreak::Depth)
+    tie = static_cast<double>(node->unassigned_tasks.size());
+
+  const auto cost_estimate = node->cost_estimate;
+  const auto heuristic_cost = node->heuristic_cost;
+  _heap.push_back(
+    Entry{
+      key(cost_estimate, heuristic_cost),
+      tie,
+      cost_estimate,
+      heuristic_cost,
+      -std::numeric_limits<double>::infinity(),
+      _pushes++,
+      take_slot(std::move(node))
+    });
+  sift_up(_heap.size() - 1);
+}
+
+//==============================================================================
+void OpenList::push_deferred(
+  ConstNodePtr node,
+  const double key,
+  const double cost_estimate,
+  const double expanded_up_to)
+{
+  _heap.push_back(
+    Entry{
+      key,
+      0.0,
+      cost_estimate,
+      0.0,
+      expanded_up_to,
+      _pushes++,
+      take_slot(std::move(node))
+    });
+  sift_up(_heap.size() - 1);
+}
+
+//==============================================================================
+auto OpenList::top() const -> Top
+{
+  const auto& entry = _heap.front();
+  return Top{entry.key, entry.expanded_up_to};
+}
+
+//==============================================================================
+ConstNodePtr OpenList::pop()
+{
+  const std::size_t slot = _heap.front().slot;
+  _heap.front() = _heap.back();
+  _heap.pop_back();
+  if (!_heap.empty())
+    sift_down(0);
+
+  _free_slots.push_back(slot);
+  return std::move(_nodes[slot]);
+}
+
+//==============================================================================
+bool OpenList::empty() const
+{
+  return _heap.empty();
+}
+
+//==============================================================================
+std::size_t OpenList::size() const
+{
+  return _heap.size();
+}
+
+//==============================================================================
+std::size_t OpenList::memory_usage() const
+{
+  return _heap.capacity() * sizeof(Entry)
+    + _nodes.capacity() * sizeof(ConstNodePtr)
+    + _free_slots.capacity() * sizeof(std::size_t);
+}
+
+//==============================================================================
+void OpenList::weight(const double value)
+{
+  if (value == _weight)
+    return;
+
+  _weight = value;
+  for (auto& entry : _heap)
+    entry.key = key(entry.cost_estimate, entry.heuristic_cost);
+
+  rebuild();
+}
+
+//==============================================================================
+double OpenList::weight() const
+{
+  return _weight;
+}
+
+//==============================================================================
+double OpenList::key(const Node& node) const
+{
+  return key(node.cost_estimate, node.heuristic_cost);
+}
+
+//==============================================================================
+double OpenList::lowest_cost_estimate() const
+{
+  double lowest = std::numeric_limits<double>::infinity();
+  for (const auto& entry : _heap)
+    lowest = std::min(lowest, entry.cost_estimate);
+
+  return lowest;
+}
+
+//==============================================================================
+std::optional<double> OpenList::truncate(const std::size_t count)
+{
+  if (_heap.size() <= count)
+    return std::nullopt;
+
+  const auto keep = _heap.begin() + count;
+  std::nth_element(
+    _heap.begin(), keep, _heap.end(),
+    [&](const Entry& a, const Entry& b) { return before(a, b); });
+
+  double dropped = std::numeric_limits<double>::infinity();
+  for (auto it = keep; it != _heap.end(); ++it)
+  {
+    dropped = std::min(dropped, it->cost_estimate);
+    _nodes[it->slot] = nullptr;
+    _free_slots.push_back(it->slot);
+  }
+
+  _heap.erase(keep, _heap.end());
+  rebuild();
+  return dropped;
+}
+
+//==============================================================================
+double OpenList::key(
+  const double cost_estimate,
+  const double heuristic_cost) const
+{
+  return cost_estimate + (_weight - 1.0) * heuristic_cost;
+}
+
+//==============================================================================
+bool OpenList::before(const Entry& a, const Entry& b) const
+{
+  if (a.key != b.key)
+    return a.key < b.key;
+
+  if (!_ordered || a.tie != b.tie)
+    return a.tie < b.tie;
+
+  return a.order < b.order;
+}
+
+//==============================================================================
+std::size_t OpenList::take_slot(ConstNodePtr node)
+{
+  std::size_t slot;
+  if (_free_slots.empty())
+  {
+    slot = _nodes.size();
+    _nodes.push_back(nullptr);
+  }
+  else
+  {
+    slot = _free_slots.back();
+    _free_slots.pop_back();
+  }
+
+  _nodes[slot] = std::move(node);
+  return slot;
+}
+
+//==============================================================================
+void OpenList::sift_up(std::size_t index)
+{
+  const Entry entry = _heap[index];
+  while (index > 0)
+  {
+    const std::size_t parent = (index - 1) / Arity;
+    if (!before(entry, _heap[parent]))
+      break;
+
+    _heap[index] = _heap[parent];
+    index = parent;
+  }
+
+  _heap[index] = entry;
+}
+
+//==============================================================================
+void OpenList::sift_down(std::size_t index)
+{
+  const Entry entry = _heap[index];
+  const std::size_t size = _heap.size();
+  while (true)
+  {
+    const std::size_t first_child = Arity * index + 1;
+    if (first_child >= size)
+      break;
+
+    std::size_t best = first_child;
+    const std::size_t last_child = std::min(first_child + Arity, size);
+    for (std::size_t child = first_child + 1; child < last_child; ++child)
+    {
+      if (before(_heap[child], _heap[best]))
+        best = child;
+    }
+
+    if (!before(_heap[best], entry))
+      break;
+
+    _heap[index] = _heap[best];
+    index = best;
+  }
+
+  _heap[index] = entry;
+}
+
+//==============================================================================
+void OpenList::rebuild()
+{
+  if (_heap.size() < 2)
+    return;
+
+  for (std::size_t i = (_heap.size() - 2) / Arity + 1; i-- > 0; )
+    sift_down(i);
+}
+
+} // namespace rmf_task
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef SRC__RMF_TASK__OPENLIST_HPP
+#define SRC__RMF_TASK__OPENLIST_HPP
+
+#include "internal_task_planning.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// The nodes that the optimal search has generated but not expanded yet,
+// ordered by g + w*h so that the cheapest one comes out first.
+//
+// The ordering lives in a 4-ary heap of small entries that keep a copy of the
+// cost estimate of their node, so comparing two entries never dereferences a
+// node. The nodes themselves sit in a separate pool of slots and are only
+// touched when they are pushed or popped. A 4-ary heap is shallower than a
+// binary one, and the four children of an entry are next to each other in
+// memory.
+//
+// For a partial expansion, a node that has already been expanded can be put
+// back into the list with the key of the cheapest child that it has not
+// produced yet.
+//
+// An ordered list gives the remaining ties to the node that was pushed first,
+// so the order of the nodes does not depend on how the heap arranges them.
+class OpenList
+{
+public:
+
+  using TieBreak = TaskPlanner::TieBreak;
+
+  OpenList(
+    double weight = 1.0,
+    TieBreak tie_break = TieBreak::None,
+    bool ordered = false);
+
+  void push(ConstNodePtr node);
+
+  // Put a partially expanded node back into the list. Its children with keys
+  // up to expanded_up_to are already in the list, and the cheapest of the
+  // rest has the given key and cost estimate. The weight must not be changed
+  // while the list holds such a node, since the key belongs to the old weight.
+  void push_deferred(
+    ConstNodePtr node,
+    double key,
+    double cost_estimate,
+    double expanded_up_to);
+
+  struct Top
+  {
+    double key;
+
+    // The children of the node with keys up to this have already been put
+    // in the list. This is -infinity for a node that has not been expanded.
+    double expanded_up_to;
+  };
+
+  // What is known about the node with the lowest key. The list must not be
+  // empty.
+  Top top() const;
+
+  // Remove the node with the lowest key. The list must not be empty.
+  ConstNodePtr pop();
+
+  bool empty() const;
+
+  std::size_t size() const;
+
+  // An estimate of the number of bytes that the list is using
+  std::size_t memory_usage() const;
+
+  // Change the weight of the heuristic, which reorders the whole list
+  void weight(double value);
+
+  double weight() const;
+
+  // The key that a node gets with the current weight
+  double key(const Node& node) const;
+
+  // The lowest cost estimate of any node in the list, regardless of the
+  // weight, or infinity if the list is empty
+  double lowest_cost_estimate() const;
+
+  // Keep only the count nodes with the lowest keys. Returns the lowest cost
+  // estimate of the nodes that were dropped, if any were.
+  std::optional<double> truncate(std::size_t count);
+
+private:
+
+  struct Entry
+  {
+    double key;
+    // Breaks ties between equal keys, where lower comes first
+    double tie;
+    double cost_estimate;
+    double heuristic_cost;
+    double expanded_up_to;
+    // The number of pushes before this one
+    uint64_t order;
+    std::size_t slot;
+  };
+
+  static constexpr std::size_t Arity = 4;
+
+  double key(double cost_estimate, double heuristic_cost) const;
+
+  bool before(const Entry& a, const Entry& b) const;
+
+  std::size_t take_slot(ConstNodePtr node);
+
+  void sift_up(std::size_t index);
+
+  void sift_down(std::size_t index);
+
+  void rebuild();
+
+  double _weight;
+  TieBreak _tie_break;
+  bool _ordered;
+  uint64_t _pushes = 0;
+  std::vector<Entry> _heap;
+  std::vector<ConstNodePtr> _nodes;
+  std::vector<std::size_t> _free_slots;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__OPENLIST_HPP
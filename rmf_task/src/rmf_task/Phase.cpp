@@ -15,7 +15,9 @@
  *
 */
 
+#include <rmf_task/Metrics.hpp>
 #include <rmf_task/Phase.hpp>
+#include <rmf_task/Trace.hpp>
 
 namespace rmf_task {
 
@@ -107,14 +109,37 @@ public:
 };
 
 //==============================================================================
-Phase::ConstSnapshotPtr Phase::Snapshot::make(const Active& active)
+Phase::ConstSnapshotPtr Phase::Snapshot::make(
+  const Active& active,
+  const ConstSnapshotPtr& previous)
 {
+  RMF_TASK_TRACE_SPAN("Phase::Snapshot::make");
+  Metrics::add(Metrics::Counter::phase_snapshots);
+  Event::ConstSnapshotPtr previous_event;
+  if (previous)
+  {
+    previous_event = std::dynamic_pointer_cast<const Event::Snapshot>(
+      previous->_pimpl->finish_event);
+  }
+
+  auto tag = active.tag();
+  auto finish_event =
+    Event::Snapshot::make(*active.final_event(), previous_event);
+  const auto estimate = active.estimate_remaining_time();
+
+  if (previous && previous_event && finish_event == previous_event
+    && tag == previous->_pimpl->tag
+    && estimate == previous->_pimpl->estimated_remaining_time)
+  {
+    return previous;
+  }
+
   Snapshot output;
   output._pimpl = rmf_utils::make_impl<Implementation>(
     Implementation{
-      active.tag(),
-      Event::Snapshot::make(*active.final_event()),
-      active.estimate_remaining_time()
+      std::move(tag),
+      std::move(finish_event),
+      estimate
     });
 
   return std::make_shared<Snapshot>(std::move(output));
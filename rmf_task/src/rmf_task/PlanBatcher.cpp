@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/Metrics.hpp>
+#include <rmf_task/PlanBatcher.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+using SteadyClock = std::chrono::steady_clock;
+using SteadyTicks = SteadyClock::duration::rep;
+constexpr SteadyTicks never = std::numeric_limits<SteadyTicks>::max();
+
+} // anonymous namespace
+
+//==============================================================================
+class PlanBatcher::Implementation
+{
+public:
+
+  Implementation(
+    TaskPlanner planner_,
+    GetAgents agents_,
+    Deliver deliver_,
+    rmf_traffic::Duration window_,
+    std::size_t max_batch_size_,
+    Clock clock_)
+  : planner(std::move(planner_)),
+    get_agents(std::move(agents_)),
+    deliver(std::move(deliver_)),
+    window(window_),
+    max_batch_size(max_batch_size_),
+    clock(std::move(clock_))
+  {
+    if (!clock)
+      clock = []() { return std::chrono::steady_clock::now(); };
+  }
+
+  // The batch is closed once this returns true. The mutex must be locked.
+  bool due() const
+  {
+    if (stop || flush_requested)
+      return true;
+
+    if (!opened.has_value())
+      return false;
+
+    if (max_batch_size > 0 && pending >= max_batch_size)
+      return true;
+
+    return SteadyClock::now() >= *opened + window;
+  }
+
+  // Tell a running plan that a newer batch has closed. The mutex must be
+  // locked.
+  void check_stale()
+  {
+    if (running && due())
+      stale = true;
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      while (!due())
+      {
+        if (opened.has_value())
+          wake.wait_until(lock, *opened + window);
+        else
+          wake.wait(lock);
+      }
+
+      if (stop)
+        return;
+
+      const auto started = SteadyClock::now();
+      Batch batch;
+      batch.new_requests = pending;
+      if (opened.has_value())
+        batch.queueing_latency = started - *opened;
+
+      batch.requests.reserve(requests.size());
+      for (const auto& r : requests)
+        batch.requests.push_back(r.second);
+
+      opened = std::nullopt;
+      deadline = never;
+      pending = 0;
+      flush_requested = false;
+      stale = false;
+      running = true;
+      ++started_count;
+      lock.unlock();
+
+      if (batch.new_requests > 0)
+      {
+        Metrics::observe(
+          Metrics::Latency::plan_queueing, batch.queueing_latency);
+      }
+
+      auto options = planner.default_options();
+      options.interrupter(
+        [interrupter = options.interrupter(), this]()
+        {
+          const auto now = SteadyClock::now().time_since_epoch().count();
+          if (stale || now >= deadline.load())
+            return true;
+
+          return interrupter && interrupter();
+        });
+
+      const auto time_now = clock();
+      batch.result = planner.plan(
+        time_now, get_agents(), batch.requests, std::move(options));
+      batch.planning_latency = SteadyClock::now() - started;
+
+      lock.lock();
+      running = false;
+      if (stale || due())
+      {
+        // A newer batch has closed, so this result is already out of date
+        ++superseded_count;
+        idle.notify_all();
+        continue;
+      }
+
+      lock.unlock();
+      deliver(std::move(batch));
+      lock.lock();
+      idle.notify_all();
+    }
+  }
+
+  TaskPlanner planner;
+  GetAgents get_agents;
+  Deliver deliver;
+  rmf_traffic::Duration window;
+  std::size_t max_batch_size;
+  Clock clock;
+
+  // Ordered by when each request was first submitted
+  std::map<uint64_t, ConstRequestPtr> requests;
+  std::unordered_map<std::string, uint64_t> order;
+  uint64_t next_order = 0;
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  mutable std::condition_variable idle;
+
+  // When the first request of the current batch arrived
+  std::optional<SteadyClock::time_point> opened;
+  std::size_t pending = 0;
+  bool flush_requested = false;
+  bool running = false;
+  bool stop = false;
+  std::size_t started_count = 0;
+  std::size_t superseded_count = 0;
+
+  // These are read by the interrupter of the running plan without the mutex
+  std::atomic_bool stale = false;
+  std::atomic<SteadyTicks> deadline = never;
+
+  std::thread thread;
+};
+
+//==============================================================================
+PlanBatcher::PlanBatcher(
+  TaskPlanner planner,
+  GetAgents agents,
+  Deliver deliver,
+  const rmf_traffic::Duration window,
+  const std::size_t max_batch_size,
+  Clock clock)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>(
+      std::move(planner), std::move(agents), std::move(deliver), window,
+      max_batch_size, std::move(clock)))
+{
+  _pimpl->thread = std::thread([impl = _pimpl.get()]() { impl->run(); });
+}
+
+//==============================================================================
+PlanBatcher& PlanBatcher::submit(ConstRequestPtr request)
+{
+  const auto now = SteadyClock::now();
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto& id = request->booking()->id();
+  const auto inserted = _pimpl->order.insert({id, _pimpl->next_order});
+  if (inserted.second)
+    ++_pimpl->next_order;
+
+  _pimpl->requests[inserted.first->second] = std::move(request);
+
+  ++_pimpl->pending;
+  if (!_pimpl->opened.has_value())
+  {
+    _pimpl->opened = now;
+    _pimpl->deadline = (now + _pimpl->window).time_since_epoch().count();
+  }
+
+  _pimpl->check_stale();
+  _pimpl->wake.notify_one();
+  return *this;
+}
+
+//==============================================================================
+bool PlanBatcher::retire(const std::string& request_id)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->order.find(request_id);
+  if (it == _pimpl->order.end())
+    return false;
+
+  _pimpl->requests.erase(it->second);
+  _pimpl->order.erase(it);
+  return true;
+}
+
+//==============================================================================
+void PlanBatcher::flush()
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->flush_requested = true;
+  _pimpl->check_stale();
+  _pimpl->wake.notify_one();
+}
+
+//==============================================================================
+void PlanBatcher::wait_until_idle() const
+{
+  std::unique_lock<std::mutex> lock(_pimpl->mutex);
+  _pimpl->idle.wait(lock, [&]()
+    {
+      return !_pimpl->running && !_pimpl->opened.has_value()
+      && !_pimpl->flush_requested;
+    });
+}
+
+//==============================================================================
+std::size_t PlanBatcher::outstanding() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->requests.size();
+}
+
+//==============================================================================
+std::size_t PlanBatcher::pending() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->pending;
+}
+
+//==============================================================================
+std::size_t PlanBatcher::plans_started() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->started_count;
+}
+
+//==============================================================================
+std::size_t PlanBatcher::plans_superseded() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->superseded_count;
+}
+
+//==============================================================================
+PlanBatcher::~PlanBatcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(_pimpl->mutex);
+    _pimpl->stop = true;
+    _pimpl->stale = true;
+  }
+  _pimpl->wake.notify_one();
+  _pimpl->thread.join();
+}
+
+} // namespace rmf_task
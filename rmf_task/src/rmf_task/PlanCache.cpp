@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "PlanCache.hpp"
+#include "BinaryPriority.hpp"
+
+#include <cstring>
+#include <unordered_map>
+#include <type_traits>
+#include <typeinfo>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+class KeyWriter
+{
+public:
+
+  KeyWriter(std::string& words)
+  : _words(words)
+  {
+    // Do nothing
+  }
+
+  template<typename T>
+  KeyWriter& operator<<(const T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    _words.append(bytes, sizeof(T));
+    return *this;
+  }
+
+  template<typename T>
+  KeyWriter& operator<<(const std::optional<T>& value)
+  {
+    *this << value.has_value();
+    if (value.has_value())
+      *this << *value;
+
+    return *this;
+  }
+
+  KeyWriter& operator<<(const std::string& value)
+  {
+    *this << value.size();
+    _words.append(value);
+    return *this;
+  }
+
+private:
+  std::string& _words;
+};
+
+//==============================================================================
+std::optional<int64_t> count(const std::optional<rmf_traffic::Time>& time)
+{
+  if (!time.has_value())
+    return std::nullopt;
+
+  return time->time_since_epoch().count();
+}
+
+} // anonymous namespace
+
+//==============================================================================
+PlanCache::PlanCache(
+  const std::size_t capacity,
+  const rmf_traffic::Duration time_resolution)
+: _capacity(capacity),
+  _time_resolution(time_resolution)
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto PlanCache::make_key(
+  const rmf_traffic::Time time_now,
+  const std::vector<State>& initial_states,
+  const std::vector<ConstRequestPtr>& requests,
+  const TaskPlanner::Options& options,
+  const TravelEstimator& travel_estimator) const -> std::optional<Key>
+{
+  if (_capacity == 0)
+    return std::nullopt;
+
+  if (travel_estimator.profile())
+    return std::nullopt;
+
+  if (options.interrupter() || options.time_budget().has_value()
+    || options.refinement_time().has_value() || options.segment_callback()
+    || !options.capture_path().empty())
+    return std::nullopt;
+
+  Key key;
+  key.finishing_request = options.finishing_request();
+  KeyWriter writer(key.words);
+
+  // Plans that are requested within the same interval of the time resolution
+  // share their result
+  const auto since_epoch = time_now.time_since_epoch();
+  if (_time_resolution.count() > 0)
+    writer << since_epoch / _time_resolution;
+  else
+    writer << since_epoch.count();
+
+  // Changes to the travel times of the estimator make earlier plans stale
+  writer << travel_estimator.generation();
+
+  writer
+    << options.greedy() << options.anytime() << options.heuristic_weight()
+    << options.max_open_nodes() << options.filter_type() << options.tie_break()
+    << options.partial_expansion().has_value()
+    << options.partial_expansion().value_or(0.0)
+    << options.decompose() << options.portfolio()
+    << options.branch_and_bound() << options.regret_insertion()
+    << options.auction()
+    << options.symmetry_breaking() << options.symmetry_tolerance()
+    << options.planning_horizon().has_value()
+    << options.planning_horizon().value_or(rmf_traffic::Duration(0)).count()
+    << options.deterministic() << options.approximate_candidates()
+    << options.adaptive_segmentation()
+    << static_cast<const void*>(key.finishing_request.get());
+
+  writer << initial_states.size();
+  for (const auto& state : initial_states)
+  {
+    writer
+      << state.waypoint() << state.orientation() << count(state.time())
+      << state.dedicated_charging_waypoint() << state.battery_soc();
+  }
+
+  writer << requests.size();
+  for (const auto& request : requests)
+  {
+    const auto& booking = *request->booking();
+    std::optional<std::size_t> priority;
+    if (booking.priority())
+    {
+      const auto binary =
+        std::dynamic_pointer_cast<const BinaryPriority>(booking.priority());
+      if (!binary)
+        return std::nullopt;
+
+      priority = binary->value();
+    }
+
+    const auto& description = *request->description();
+    const auto model_hash = description.model_hash();
+    if (!model_hash.has_value())
+      return std::nullopt;
+
+    writer
+      << booking.id() << count(booking.earliest_start_time()) << priority
+      << booking.automatic() << typeid(description).hash_code()
+      << *model_hash;
+
+    writer << booking.dependencies().size();
+    for (const auto& dependency : booking.dependencies())
+      writer << dependency;
+  }
+
+  return key;
+}
+
+//==============================================================================
+auto PlanCache::get(
+  const Key& key,
+  const std::vector<ConstRequestPtr>& requests) -> std::optional<Entry>
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto it = _entries.find(key.words);
+  if (it == _entries.end())
+  {
+    ++_misses;
+    return std::nullopt;
+  }
+
+  ++_hits;
+  _recent.splice(_recent.begin(), _recent, it->second);
+  const auto& stored = *it->second;
+  if (const auto* error =
+    std::get_if<TaskPlanner::TaskPlannerError>(&stored.result))
+    return Entry{*error, stored.suboptimality_bound};
+
+  const auto& stored_agents =
+    std::get<std::vector<std::vector<StoredAssignment>>>(stored.result);
+  TaskPlanner::Assignments assignments;
+  assignments.reserve(stored_agents.size());
+  for (const auto& stored_agent : stored_agents)
+  {
+    auto& agent = assignments.emplace_back();
+    agent.reserve(stored_agent.size());
+    for (const auto& a : stored_agent)
+    {
+      agent.emplace_back(
+        a.request_index.has_value() ? requests[*a.request_index] : a.generated,
+        a.finish_state,
+        a.deployment_time);
+    }
+  }
+
+  return Entry{std::move(assignments), stored.suboptimality_bound};
+}
+
+//==============================================================================
+void PlanCache::insert(
+  Key key,
+  const Entry& entry,
+  const std::vector<ConstRequestPtr>& requests)
+{
+  if (_capacity == 0)
+    return;
+
+  auto result = store(entry.result, requests);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto it = _entries.find(key.words);
+  if (it != _entries.end())
+  {
+    it->second->result = std::move(result);
+    it->second->suboptimality_bound = entry.suboptimality_bound;
+    _recent.splice(_recent.begin(), _recent, it->second);
+    return;
+  }
+
+  auto words = key.words;
+  _recent.push_front(
+    Stored{std::move(key), std::move(result), entry.suboptimality_bound});
+  _entries.insert({std::move(words), _recent.begin()});
+  while (_entries.size() > _capacity)
+  {
+    _entries.erase(_recent.back().key.words);
+    _recent.pop_back();
+  }
+}
+
+//==============================================================================
+auto PlanCache::store(
+  const TaskPlanner::Result& result,
+  const std::vector<ConstRequestPtr>& requests) -> StoredResult
+{
+  if (const auto* error = std::get_if<TaskPlanner::TaskPlannerError>(&result))
+    return *error;
+
+  std::unordered_map<const Request*, std::size_t> indices;
+  for (std::size_t i = 0; i < requests.size(); ++i)
+    indices.insert({requests[i].get(), i});
+
+  const auto& assignments = std::get<TaskPlanner::Assignments>(result);
+  std::vector<std::vector<StoredAssignment>> stored;
+  stored.reserve(assignments.size());
+  for (const auto& agent : assignments)
+  {
+    auto& stored_agent = stored.emplace_back();
+    stored_agent.reserve(agent.size());
+    for (const auto& a : agent)
+    {
+      StoredAssignment s{
+        std::nullopt, nullptr, a.finish_state(), a.deployment_time()};
+      const auto it = indices.find(a.request().get());
+      if (it != indices.end())
+        s.request_index = it->second;
+      else
+        s.generated = a.request();
+
+      stored_agent.push_back(std::move(s));
+    }
+  }
+
+  return stored;
+}
+
+//==============================================================================
+std::size_t PlanCache::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _entries.size();
+}
+
+//==============================================================================
+std::size_t PlanCache::hits() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _hits;
+}
+
+//==============================================================================
+std::size_t PlanCache::misses() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _misses;
+}
+
+} // namespace rmf_task
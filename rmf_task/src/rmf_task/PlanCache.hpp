@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__PLANCACHE_HPP
+#define SRC__RMF_TASK__PLANCACHE_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// Keeps the results of recent plan() calls so that a call with the same inputs
+// can return the same result without searching again.
+//
+// The key of a plan records time_now rounded down to the time resolution of
+// the cache, the generation of the travel estimator, the basic components of
+// each initial state, the booking and the Task::Description::model_hash() of
+// each request, and the options that can change the result. Plans whose
+// results cannot be reused are not cached, which is the case for requests
+// that do not provide a model hash or that have a priority other than the
+// binary priority scheme, for options that depend on wall-clock time or that
+// have side effects, like an interrupter, a time budget, a refinement time, a
+// segment callback or a capture path, and for estimators with a time-of-day
+// profile, since a profile can keep learning without the estimator knowing.
+//
+// The key leaves out the parts of a booking that do not change a plan, like
+// its requester and labels, so the assignments of an entry refer to the
+// requests of a plan by their index. Each hit hands back the requests of its
+// own caller.
+//
+// Each planner has its own cache. It is shared with the copies of the planner
+// that run plan_async(), so it is safe to use from several threads at once.
+class PlanCache
+{
+public:
+
+  struct Entry
+  {
+    TaskPlanner::Result result;
+    std::optional<double> suboptimality_bound;
+  };
+
+  class Key
+  {
+  public:
+    std::string words;
+
+    // Kept so that the address of the finishing request is not reused while
+    // the key exists
+    ConstRequestFactoryPtr finishing_request;
+  };
+
+  PlanCache(std::size_t capacity, rmf_traffic::Duration time_resolution);
+
+  // Make the key of a plan, or std::nullopt if its result cannot be reused
+  std::optional<Key> make_key(
+    rmf_traffic::Time time_now,
+    const std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    const TaskPlanner::Options& options,
+    const TravelEstimator& travel_estimator) const;
+
+  // Get the result of an earlier plan with the same key, assigning the
+  // requests of this plan
+  std::optional<Entry> get(
+    const Key& key,
+    const std::vector<ConstRequestPtr>& requests);
+
+  // Keep the result of a plan for the requests that it was given
+  void insert(
+    Key key,
+    const Entry& entry,
+    const std::vector<ConstRequestPtr>& requests);
+
+  std::size_t size() const;
+
+  std::size_t hits() const;
+
+  std::size_t misses() const;
+
+private:
+
+  struct StoredAssignment
+  {
+    // The index of the request of the plan that was assigned, or
+    // std::nullopt for a request that the planner generated itself
+    std::optional<std::size_t> request_index;
+    ConstRequestPtr generated;
+    State finish_state;
+    rmf_traffic::Time deployment_time;
+  };
+
+  using StoredResult = std::variant<
+    std::vector<std::vector<StoredAssignment>>,
+    TaskPlanner::TaskPlannerError>;
+
+  struct Stored
+  {
+    Key key;
+    StoredResult result;
+    std::optional<double> suboptimality_bound;
+  };
+
+  static StoredResult store(
+    const TaskPlanner::Result& result,
+    const std::vector<ConstRequestPtr>& requests);
+
+  std::size_t _capacity;
+  rmf_traffic::Duration _time_resolution;
+  std::size_t _hits = 0;
+  std::size_t _misses = 0;
+
+  mutable std::mutex _mutex;
+  std::list<Stored> _recent;
+  std::unordered_map<std::string, std::list<Stored>::iterator> _entries;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__PLANCACHE_HPP
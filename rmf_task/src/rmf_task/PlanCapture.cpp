@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "PlanCapture.hpp"
+#include "BinaryPriority.hpp"
+
+#include <rmf_task/BinaryPriorityScheme.hpp>
+#include <rmf_task/requests/ChargeBattery.hpp>
+#include <rmf_task/requests/Clean.hpp>
+#include <rmf_task/requests/Delivery.hpp>
+#include <rmf_task/requests/Loop.hpp>
+
+#include <rmf_battery/agv/SimpleDevicePowerSink.hpp>
+#include <rmf_battery/agv/SimpleMotionPowerSink.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+const std::string capture_header = "rmf_task_plan_capture";
+const int capture_version = 1;
+
+//==============================================================================
+int64_t to_count(rmf_traffic::Duration duration)
+{
+  return duration.count();
+}
+
+//==============================================================================
+int64_t to_count(rmf_traffic::Time time)
+{
+  return time.time_since_epoch().count();
+}
+
+//==============================================================================
+// Writes each field preceded by a space. Missing values are written as "-".
+class Writer
+{
+public:
+
+  Writer(std::ostream& out, const std::string& keyword)
+  : _out(out)
+  {
+    _out << keyword;
+  }
+
+  Writer& operator<<(double value)
+  {
+    _out << ' ' << value;
+    return *this;
+  }
+
+  Writer& operator<<(int64_t value)
+  {
+    _out << ' ' << value;
+    return *this;
+  }
+
+  Writer& operator<<(std::size_t value)
+  {
+    _out << ' ' << value;
+    return *this;
+  }
+
+  Writer& operator<<(bool value)
+  {
+    _out << ' ' << (value ? 1 : 0);
+    return *this;
+  }
+
+  Writer& operator<<(const std::string& value)
+  {
+    _out << ' ' << std::quoted(value);
+    return *this;
+  }
+
+  template<typename T>
+  Writer& operator<<(const std::optional<T>& value)
+  {
+    if (value.has_value())
+      return *this << *value;
+
+    _out << " -";
+    return *this;
+  }
+
+  ~Writer()
+  {
+    _out << '\n';
+  }
+
+private:
+  std::ostream& _out;
+};
+
+//==============================================================================
+void write_unsupported(std::ostream& out, const std::string& what)
+{
+  Writer(out, "unsupported") << what;
+}
+
+//==============================================================================
+std::optional<std::size_t> priority_value(const ConstPriorityPtr& priority)
+{
+  if (!priority)
+    return std::nullopt;
+
+  const auto binary = std::dynamic_pointer_cast<const BinaryPriority>(priority);
+  if (!binary)
+    return std::nullopt;
+
+  return binary->value();
+}
+
+//==============================================================================
+void write_request(std::ostream& out, const Request& request)
+{
+  const auto& booking = *request.booking();
+  const auto& description = request.description();
+
+  if (booking.priority() && !priority_value(booking.priority()).has_value())
+  {
+    write_unsupported(out, "priority of request " + booking.id());
+    return;
+  }
+
+  const auto delivery = std::dynamic_pointer_cast<
+    const requests::Delivery::Description>(description);
+  const auto loop = std::dynamic_pointer_cast<
+    const requests::Loop::Description>(description);
+  const auto clean = std::dynamic_pointer_cast<
+    const requests::Clean::Description>(description);
+  const auto charge = std::dynamic_pointer_cast<
+    const requests::ChargeBattery::Description>(description);
+
+  if (!delivery && !loop && !clean && !charge)
+  {
+    write_unsupported(out, "description of request " + booking.id());
+    return;
+  }
+
+  const std::string type =
+    delivery ? "delivery" : loop ? "loop" : clean ? "clean" : "charge";
+
+  Writer writer(out, "request");
+  writer << type << booking.id() << to_count(booking.earliest_start_time())
+         << priority_value(booking.priority()) << booking.automatic();
+
+  if (delivery)
+  {
+    writer
+      << delivery->pickup_waypoint() << to_count(delivery->pickup_wait())
+      << delivery->dropoff_waypoint() << to_count(delivery->dropoff_wait())
+      << delivery->pickup_from_dispenser() << delivery->dropoff_to_ingestor();
+  }
+  else if (loop)
+  {
+    writer
+      << loop->start_waypoint() << loop->finish_waypoint()
+      << loop->num_loops();
+  }
+  else if (clean)
+  {
+    const auto& path = clean->cleaning_path();
+    writer << clean->start_waypoint() << clean->end_waypoint() << path.size();
+    for (const auto& waypoint : path)
+    {
+      const Eigen::Vector3d p = waypoint.position();
+      const Eigen::Vector3d v = waypoint.velocity();
+      writer << to_count(waypoint.time())
+             << p[0] << p[1] << p[2] << v[0] << v[1] << v[2];
+    }
+  }
+  else
+  {
+    writer << charge->indefinite();
+  }
+}
+
+//==============================================================================
+void write_parameters(std::ostream& out, const Parameters& parameters)
+{
+  using namespace rmf_battery::agv;
+
+  const auto& battery = parameters.battery_system();
+  Writer(out, "battery")
+    << battery.nominal_voltage() << battery.capacity()
+    << battery.charging_current();
+
+  if (const auto motion = std::dynamic_pointer_cast<
+      const SimpleMotionPowerSink>(parameters.motion_sink()))
+  {
+    const auto& mechanical = motion->mechanical_system();
+    Writer(out, "motion_sink")
+      << mechanical.mass() << mechanical.moment_of_inertia()
+      << mechanical.friction_coefficient();
+  }
+  else
+  {
+    write_unsupported(out, "motion_sink");
+  }
+
+  const auto write_device_sink = [&](
+    const std::string& keyword,
+    const rmf_battery::ConstDevicePowerSinkPtr& sink)
+    {
+      if (!sink)
+        return;
+
+      if (const auto device =
+        std::dynamic_pointer_cast<const SimpleDevicePowerSink>(sink))
+        Writer(out, keyword) << device->power_system().nominal_power();
+      else
+        write_unsupported(out, keyword);
+    };
+
+  write_device_sink("ambient_sink", parameters.ambient_sink());
+  write_device_sink("tool_sink", parameters.tool_sink());
+
+  const auto& configuration = parameters.planner()->get_configuration();
+  const auto& traits = configuration.vehicle_traits();
+  Writer(out, "traits")
+    << traits.linear().get_nominal_velocity()
+    << traits.linear().get_nominal_acceleration()
+    << traits.rotational().get_nominal_velocity()
+    << traits.rotational().get_nominal_acceleration()
+    << traits.profile().footprint()->get_characteristic_length()
+    << traits.profile().vicinity()->get_characteristic_length();
+
+  const auto& graph = configuration.graph();
+  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+  {
+    const auto& waypoint = graph.get_waypoint(i);
+    const Eigen::Vector2d location = waypoint.get_location();
+    Writer(out, "waypoint")
+      << waypoint.get_map_name() << location[0] << location[1]
+      << waypoint.is_charger() << waypoint.is_holding_point()
+      << waypoint.is_passthrough_point() << waypoint.is_parking_spot();
+  }
+
+  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+  {
+    const auto& lane = graph.get_lane(i);
+    Writer(out, "lane")
+      << lane.entry().waypoint_index() << lane.exit().waypoint_index();
+  }
+}
+
+//==============================================================================
+// Reads the fields of one record of the capture
+class Reader
+{
+public:
+
+  Reader(const std::string& line, std::size_t line_number)
+  : _in(line),
+    _line_number(line_number)
+  {
+    // Do nothing
+  }
+
+  template<typename T>
+  T next()
+  {
+    T value;
+    if (!(_in >> value))
+      fail("missing or malformed field");
+
+    return value;
+  }
+
+  template<typename T>
+  std::optional<T> next_optional()
+  {
+    _in >> std::ws;
+    if (_in.peek() == '-')
+    {
+      std::string dash;
+      _in >> dash;
+      if (dash == "-")
+        return std::nullopt;
+
+      fail("malformed field [" + dash + "]");
+    }
+
+    return next<T>();
+  }
+
+  std::string next_string()
+  {
+    std::string value;
+    if (!(_in >> std::quoted(value)))
+      fail("missing or malformed string");
+
+    return value;
+  }
+
+  bool next_bool()
+  {
+    return next<int>() != 0;
+  }
+
+  rmf_traffic::Duration next_duration()
+  {
+    return rmf_traffic::Duration(next<int64_t>());
+  }
+
+  rmf_traffic::Time next_time()
+  {
+    return rmf_traffic::Time(next_duration());
+  }
+
+  void fail(const std::string& what) const
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::runtime_error(
+      "Line " + std::to_string(_line_number) + " of the plan capture: " + what);
+    // *INDENT-ON*
+  }
+
+private:
+  std::istringstream _in;
+  std::size_t _line_number;
+};
+
+//==============================================================================
+ConstRequestPtr read_request(Reader& reader)
+{
+  const auto type = reader.next<std::string>();
+  const auto id = reader.next_string();
+  const auto earliest_start_time = reader.next_time();
+  const auto priority_value = reader.next_optional<std::size_t>();
+  const bool automatic = reader.next_bool();
+
+  ConstPriorityPtr priority = nullptr;
+  if (priority_value.has_value())
+    priority = std::make_shared<BinaryPriority>(*priority_value);
+
+  Task::ConstDescriptionPtr description;
+  if (type == "delivery")
+  {
+    const auto pickup = reader.next<std::size_t>();
+    const auto pickup_wait = reader.next_duration();
+    const auto dropoff = reader.next<std::size_t>();
+    const auto dropoff_wait = reader.next_duration();
+    const auto dispenser = reader.next_string();
+    const auto ingestor = reader.next_string();
+    description = requests::Delivery::Description::make(
+      pickup, pickup_wait, dropoff, dropoff_wait, {{}}, dispenser, ingestor);
+  }
+  else if (type == "loop")
+  {
+    const auto start = reader.next<std::size_t>();
+    const auto finish = reader.next<std::size_t>();
+    const auto num_loops = reader.next<std::size_t>();
+    description = requests::Loop::Description::make(start, finish, num_loops);
+  }
+  else if (type == "clean")
+  {
+    const auto start = reader.next<std::size_t>();
+    const auto end = reader.next<std::size_t>();
+    const auto num_points = reader.next<std::size_t>();
+    rmf_traffic::Trajectory path;
+    for (std::size_t i = 0; i < num_points; ++i)
+    {
+      const auto time = reader.next_time();
+      Eigen::Vector3d p;
+      Eigen::Vector3d v;
+      for (std::size_t k = 0; k < 3; ++k)
+        p[k] = reader.next<double>();
+      for (std::size_t k = 0; k < 3; ++k)
+        v[k] = reader.next<double>();
+
+      path.insert(time, p, v);
+    }
+
+    description = requests::Clean::Description::make(start, end, path);
+  }
+  else if (type == "charge")
+  {
+    if (reader.next_bool())
+      description = requests::ChargeBattery::Description::make_indefinite();
+    else
+      description = requests::ChargeBattery::Description::make();
+  }
+  else
+  {
+    reader.fail("unknown request type [" + type + "]");
+  }
+
+  return std::make_shared<Request>(
+    std::make_shared<Task::Booking>(
+      id, earliest_start_time, std::move(priority), automatic),
+    std::move(description));
+}
+
+} // anonymous namespace
+
+//==============================================================================
+void write_plan_capture(
+  std::ostream& out,
+  rmf_traffic::Time time_now,
+  const TaskPlanner::Configuration& configuration,
+  const TaskPlanner::Options& options,
+  const std::vector<State>& initial_states,
+  const std::vector<ConstRequestPtr>& requests)
+{
+  const auto precision = out.precision();
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+  Writer(out, capture_header) << static_cast<int64_t>(capture_version);
+  Writer(out, "time_now") << to_count(time_now);
+
+  const auto& constraints = configuration.constraints();
+  Writer(out, "constraints")
+    << constraints.threshold_soc() << constraints.recharge_soc()
+    << constraints.drain_battery();
+
+  Writer(out, "options")
+    << options.greedy() << options.anytime() << options.heuristic_weight()
+    << options.max_open_nodes()
+    << static_cast<std::size_t>(options.filter_type())
+    << options.decompose() << options.arena_allocation()
+    << options.portfolio() << options.expansion_threads()
+    << options.initialization_threads();
+
+  if (options.finishing_request())
+    write_unsupported(out, "finishing_request");
+
+  write_parameters(out, configuration.parameters());
+
+  for (const auto& state : initial_states)
+  {
+    std::optional<int64_t> time;
+    if (const auto t = state.time())
+      time = to_count(*t);
+
+    Writer(out, "agent")
+      << state.waypoint() << state.orientation() << time
+      << state.dedicated_charging_waypoint() << state.battery_soc();
+  }
+
+  for (const auto& request : requests)
+    write_request(out, *request);
+
+  out << std::setprecision(precision);
+  out.flush();
+}
+
+//==============================================================================
+PlanCapture read_plan_capture(std::istream& in)
+{
+  using namespace rmf_battery::agv;
+
+  PlanCapture capture;
+
+  std::optional<Constraints> constraints;
+  std::optional<BatterySystem> battery;
+  std::optional<MechanicalSystem> mechanical;
+  std::optional<PowerSystem> ambient;
+  std::optional<PowerSystem> tool;
+  std::optional<rmf_traffic::agv::VehicleTraits> traits;
+  rmf_traffic::agv::Graph graph;
+
+  std::string line;
+  std::size_t line_number = 0;
+  while (std::getline(in, line))
+  {
+    ++line_number;
+    if (line.empty())
+      continue;
+
+    Reader reader(line, line_number);
+    const auto keyword = reader.next<std::string>();
+    if (line_number == 1)
+    {
+      if (keyword != capture_header)
+        reader.fail("this is not a plan capture");
+
+      if (reader.next<int>() != capture_version)
+        reader.fail("unsupported version");
+    }
+    else if (keyword == "time_now")
+    {
+      capture.time_now = reader.next_time();
+    }
+    else if (keyword == "constraints")
+    {
+      const auto threshold_soc = reader.next<double>();
+      const auto recharge_soc = reader.next<double>();
+      const auto drain_battery = reader.next_bool();
+      constraints.emplace(threshold_soc, recharge_soc, drain_battery);
+    }
+    else if (keyword == "options")
+    {
+      capture.options.greedy(reader.next_bool());
+      capture.options.anytime(reader.next_bool());
+      capture.options.heuristic_weight(reader.next<double>());
+      capture.options.max_open_nodes(reader.next<std::size_t>());
+      capture.options.filter_type(
+        static_cast<TaskPlanner::FilterType>(reader.next<std::size_t>()));
+      capture.options.decompose(reader.next_bool());
+      capture.options.arena_allocation(reader.next_bool());
+      capture.options.portfolio(reader.next_bool());
+      capture.options.expansion_threads(reader.next<std::size_t>());
+      capture.options.initialization_threads(reader.next<std::size_t>());
+    }
+    else if (keyword == "battery")
+    {
+      const auto voltage = reader.next<double>();
+      const auto capacity = reader.next<double>();
+      const auto current = reader.next<double>();
+      battery = BatterySystem::make(voltage, capacity, current);
+      if (!battery)
+        reader.fail("invalid battery system");
+    }
+    else if (keyword == "motion_sink")
+    {
+      const auto mass = reader.next<double>();
+      const auto inertia = reader.next<double>();
+      const auto friction = reader.next<double>();
+      mechanical = MechanicalSystem::make(mass, inertia, friction);
+      if (!mechanical)
+        reader.fail("invalid mechanical system");
+    }
+    else if (keyword == "ambient_sink" || keyword == "tool_sink")
+    {
+      auto& power = keyword == "ambient_sink" ? ambient : tool;
+      power = PowerSystem::make(reader.next<double>());
+      if (!power)
+        reader.fail("invalid power system");
+    }
+    else if (keyword == "traits")
+    {
+      const auto linear_velocity = reader.next<double>();
+      const auto linear_acceleration = reader.next<double>();
+      const auto angular_velocity = reader.next<double>();
+      const auto angular_acceleration = reader.next<double>();
+      const auto footprint = rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Circle>(reader.next<double>());
+      const auto vicinity = rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Circle>(reader.next<double>());
+      traits.emplace(
+        rmf_traffic::agv::VehicleTraits::Limits{
+          linear_velocity, linear_acceleration},
+        rmf_traffic::agv::VehicleTraits::Limits{
+          angular_velocity, angular_acceleration},
+        rmf_traffic::Profile{footprint, vicinity});
+    }
+    else if (keyword == "waypoint")
+    {
+      const auto map_name = reader.next_string();
+      const auto x = reader.next<double>();
+      const auto y = reader.next<double>();
+      auto& waypoint = graph.add_waypoint(map_name, {x, y});
+      waypoint.set_charger(reader.next_bool());
+      waypoint.set_holding_point(reader.next_bool());
+      waypoint.set_passthrough_point(reader.next_bool());
+      waypoint.set_parking_spot(reader.next_bool());
+    }
+    else if (keyword == "lane")
+    {
+      const auto entry = reader.next<std::size_t>();
+      const auto exit = reader.next<std::size_t>();
+      if (entry >= graph.num_waypoints() || exit >= graph.num_waypoints())
+        reader.fail("lane refers to an unknown waypoint");
+
+      graph.add_lane(entry, exit);
+    }
+    else if (keyword == "agent")
+    {
+      State state;
+      if (const auto waypoint = reader.next_optional<std::size_t>())
+        state.waypoint(*waypoint);
+      if (const auto orientation = reader.next_optional<double>())
+        state.orientation(*orientation);
+      if (const auto time = reader.next_optional<int64_t>())
+        state.time(rmf_traffic::Time(rmf_traffic::Duration(*time)));
+      if (const auto charger = reader.next_optional<std::size_t>())
+        state.dedicated_charging_waypoint(*charger);
+      if (const auto soc = reader.next_optional<double>())
+        state.battery_soc(*soc);
+
+      capture.initial_states.push_back(std::move(state));
+    }
+    else if (keyword == "request")
+    {
+      capture.requests.push_back(read_request(reader));
+    }
+    else if (keyword == "unsupported")
+    {
+      capture.warnings.push_back(
+        "The capture could not record the " + reader.next_string());
+    }
+    else
+    {
+      reader.fail("unknown record [" + keyword + "]");
+    }
+  }
+
+  if (line_number == 0)
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::runtime_error("The plan capture is empty");
+    // *INDENT-ON*
+  }
+
+  if (!constraints || !battery || !traits)
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::runtime_error(
+      "The plan capture is missing its constraints, battery or vehicle traits");
+    // *INDENT-ON*
+  }
+
+  auto planner = std::make_shared<rmf_traffic::agv::Planner>(
+    rmf_traffic::agv::Planner::Configuration{graph, *traits},
+    rmf_traffic::agv::Planner::Options{nullptr});
+
+  rmf_battery::ConstMotionPowerSinkPtr motion_sink = nullptr;
+  if (mechanical)
+  {
+    motion_sink =
+      std::make_shared<SimpleMotionPowerSink>(*battery, *mechanical);
+  }
+
+  rmf_battery::ConstDevicePowerSinkPtr ambient_sink = nullptr;
+  if (ambient)
+    ambient_sink = std::make_shared<SimpleDevicePowerSink>(*battery, *ambient);
+
+  rmf_battery::ConstDevicePowerSinkPtr tool_sink = nullptr;
+  if (tool)
+    tool_sink = std::make_shared<SimpleDevicePowerSink>(*battery, *tool);
+
+  capture.configuration.emplace(
+    Parameters{
+      std::move(planner),
+      *battery,
+      std::move(motion_sink),
+      std::move(ambient_sink),
+      std::move(tool_sink)},
+    *constraints,
+    BinaryPriorityScheme::make_cost_calculator());
+
+  return capture;
+}
+
+} // namespace rmf_task
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__PLANCAPTURE_HPP
+#define SRC__RMF_TASK__PLANCAPTURE_HPP
+
+#include <rmf_task/TaskPlanner.hpp>
+
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// The inputs of one TaskPlanner::plan() call, as recovered from a capture.
+//
+// A capture is a line-oriented text file. It records the constraints, the
+// planning options, the initial states, the requests and time_now exactly.
+// The parameters are rebuilt from the navigation graph (waypoints and lanes,
+// without lane events or orientation constraints), the vehicle traits (with
+// circular footprint and vicinity) and the battery system and power sinks,
+// which must be the simple sinks provided by rmf_battery. The only supported
+// requests are the built-in Delivery, Loop, Clean and ChargeBattery requests,
+// and the cost calculator is always the binary priority scheme.
+//
+// Anything that could not be captured is written as an "unsupported" record
+// and reported through warnings when the capture is read back.
+struct PlanCapture
+{
+  rmf_traffic::Time time_now;
+  std::optional<TaskPlanner::Configuration> configuration;
+  TaskPlanner::Options options = TaskPlanner::Options(false);
+  std::vector<State> initial_states;
+  std::vector<ConstRequestPtr> requests;
+  std::vector<std::string> warnings;
+};
+
+//==============================================================================
+void write_plan_capture(
+  std::ostream& out,
+  rmf_traffic::Time time_now,
+  const TaskPlanner::Configuration& configuration,
+  const TaskPlanner::Options& options,
+  const std::vector<State>& initial_states,
+  const std::vector<ConstRequestPtr>& requests);
+
+//==============================================================================
+// Throws std::runtime_error if the input is not a valid capture.
+PlanCapture read_plan_capture(std::istream& in);
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__PLANCAPTURE_HPP
@@ -0,0 +1,1180 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/PlannerService.hpp>
+#include <rmf_task/requests/ChargeBattery.hpp>
+#include <rmf_task/requests/Clean.hpp>
+#include <rmf_task/requests/Delivery.hpp>
+#include <rmf_task/requests/Loop.hpp>
+
+#include "BinaryPriority.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+class WireWriter
+{
+public:
+
+  template<typename T>
+  WireWriter& put(const T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto size = _bytes.size();
+    _bytes.resize(size + sizeof(T));
+    std::memcpy(&_bytes[size], &value, sizeof(T));
+    return *this;
+  }
+
+  WireWriter& put_string(const std::string& value)
+  {
+    put<uint32_t>(static_cast<uint32_t>(value.size()));
+    _bytes.append(value);
+    return *this;
+  }
+
+  template<typename T>
+  WireWriter& put_optional(const std::optional<T>& value)
+  {
+    put<uint8_t>(value.has_value());
+    if (value.has_value())
+      put<T>(*value);
+
+    return *this;
+  }
+
+  WireWriter& put_time(rmf_traffic::Time time)
+  {
+    return put<int64_t>(time.time_since_epoch().count());
+  }
+
+  const std::string& bytes() const
+  {
+    return _bytes;
+  }
+
+private:
+  std::string _bytes;
+};
+
+//==============================================================================
+class WireReader
+{
+public:
+
+  WireReader(const char* data, std::size_t size)
+  : _data(data),
+    _size(size),
+    _offset(0)
+  {
+    // Do nothing
+  }
+
+  template<typename T>
+  T get()
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, _data + _offset, sizeof(T));
+    _offset += sizeof(T);
+    return value;
+  }
+
+  std::string get_string()
+  {
+    const std::size_t size = get<uint32_t>();
+    require(size);
+    std::string value(_data + _offset, size);
+    _offset += size;
+    return value;
+  }
+
+  template<typename T>
+  std::optional<T> get_optional()
+  {
+    if (get<uint8_t>() == 0)
+      return std::nullopt;
+
+    return get<T>();
+  }
+
+  rmf_traffic::Time get_time()
+  {
+    return rmf_traffic::Time(rmf_traffic::Duration(get<int64_t>()));
+  }
+
+private:
+
+  void require(std::size_t size) const
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (_size - _offset < size)
+      throw std::runtime_error("A planner service message is truncated");
+    // *INDENT-ON*
+  }
+
+  const char* _data;
+  std::size_t _size;
+  std::size_t _offset;
+};
+
+//==============================================================================
+enum class RequestType : uint8_t
+{
+  Delivery = 0,
+  Loop = 1,
+  Clean = 2,
+  ChargeBattery = 3
+};
+
+//==============================================================================
+enum class ResultKind : uint8_t
+{
+  Assignments = 0,
+  PlannerError = 1,
+  Refused = 2
+};
+
+//==============================================================================
+void put_duration(WireWriter& writer, rmf_traffic::Duration duration)
+{
+  writer.put<int64_t>(duration.count());
+}
+
+//==============================================================================
+rmf_traffic::Duration get_duration(WireReader& reader)
+{
+  return rmf_traffic::Duration(reader.get<int64_t>());
+}
+
+//==============================================================================
+void put_state(WireWriter& writer, const State& state)
+{
+  std::optional<int64_t> time;
+  if (const auto t = state.time())
+    time = t->time_since_epoch().count();
+
+  std::optional<uint64_t> waypoint;
+  if (const auto w = state.waypoint())
+    waypoint = *w;
+
+  std::optional<uint64_t> charger;
+  if (const auto c = state.dedicated_charging_waypoint())
+    charger = *c;
+
+  writer
+  .put_optional(waypoint)
+  .put_optional(state.orientation())
+  .put_optional(time)
+  .put_optional(charger)
+  .put_optional(state.battery_soc());
+}
+
+//==============================================================================
+State get_state(WireReader& reader)
+{
+  State state;
+  if (const auto waypoint = reader.get_optional<uint64_t>())
+    state.waypoint(*waypoint);
+  if (const auto orientation = reader.get_optional<double>())
+    state.orientation(*orientation);
+  if (const auto time = reader.get_optional<int64_t>())
+    state.time(rmf_traffic::Time(rmf_traffic::Duration(*time)));
+  if (const auto charger = reader.get_optional<uint64_t>())
+    state.dedicated_charging_waypoint(*charger);
+  if (const auto soc = reader.get_optional<double>())
+    state.battery_soc(*soc);
+
+  return state;
+}
+
+//==============================================================================
+void put_request(WireWriter& writer, const Request& request)
+{
+  const auto& booking = *request.booking();
+  const auto& description = request.description();
+
+  std::optional<uint64_t> priority;
+  if (booking.priority())
+  {
+    const auto binary =
+      std::dynamic_pointer_cast<const BinaryPriority>(booking.priority());
+
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (!binary)
+      throw std::invalid_argument(
+        "The planner service does not support the priority of request ["
+        + booking.id() + "]");
+    // *INDENT-ON*
+
+    priority = binary->value();
+  }
+
+  const auto delivery = std::dynamic_pointer_cast<
+    const requests::Delivery::Description>(description);
+  const auto loop = std::dynamic_pointer_cast<
+    const requests::Loop::Description>(description);
+  const auto clean = std::dynamic_pointer_cast<
+    const requests::Clean::Description>(description);
+  const auto charge = std::dynamic_pointer_cast<
+    const requests::ChargeBattery::Description>(description);
+
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!delivery && !loop && !clean && !charge)
+    throw std::invalid_argument(
+      "The planner service does not support the description of request ["
+      + booking.id() + "]");
+  // *INDENT-ON*
+
+  std::optional<int64_t> request_time;
+  if (booking.request_time().has_value())
+    request_time = booking.request_time()->time_since_epoch().count();
+
+  writer
+  .put_string(booking.id())
+  .put_time(booking.earliest_start_time())
+  .put_optional(priority)
+  .put<uint8_t>(booking.automatic())
+  .put<uint8_t>(booking.requester().has_value());
+  if (booking.requester().has_value())
+    writer.put_string(*booking.requester());
+  writer.put_optional(request_time);
+
+  if (delivery)
+  {
+    writer.put(RequestType::Delivery)
+    .put<uint64_t>(delivery->pickup_waypoint());
+    put_duration(writer, delivery->pickup_wait());
+    writer.put<uint64_t>(delivery->dropoff_waypoint());
+    put_duration(writer, delivery->dropoff_wait());
+    writer
+    .put_string(delivery->pickup_from_dispenser())
+    .put_string(delivery->dropoff_to_ingestor());
+  }
+  else if (loop)
+  {
+    writer.put(RequestType::Loop)
+    .put<uint64_t>(loop->start_waypoint())
+    .put<uint64_t>(loop->finish_waypoint())
+    .put<uint64_t>(loop->num_loops());
+  }
+  else if (clean)
+  {
+    const auto& path = clean->cleaning_path();
+    writer.put(RequestType::Clean)
+    .put<uint64_t>(clean->start_waypoint())
+    .put<uint64_t>(clean->end_waypoint())
+    .put<uint64_t>(path.size());
+    for (const auto& waypoint : path)
+    {
+      const Eigen::Vector3d p = waypoint.position();
+      const Eigen::Vector3d v = waypoint.velocity();
+      writer.put_time(waypoint.time());
+      for (std::size_t k = 0; k < 3; ++k)
+        writer.put<double>(p[k]);
+      for (std::size_t k = 0; k < 3; ++k)
+        writer.put<double>(v[k]);
+    }
+  }
+  else
+  {
+    writer.put(RequestType::ChargeBattery)
+    .put<uint8_t>(charge->indefinite());
+  }
+}
+
+//==============================================================================
+ConstRequestPtr get_request(WireReader& reader)
+{
+  const auto id = reader.get_string();
+  const auto earliest_start_time = reader.get_time();
+  const auto priority_value = reader.get_optional<uint64_t>();
+  const bool automatic = reader.get<uint8_t>() != 0;
+  std::optional<std::string> requester;
+  if (reader.get<uint8_t>() != 0)
+    requester = reader.get_string();
+  const auto request_time = reader.get_optional<int64_t>();
+
+  ConstPriorityPtr priority = nullptr;
+  if (priority_value.has_value())
+    priority = std::make_shared<BinaryPriority>(*priority_value);
+
+  Task::ConstDescriptionPtr description;
+  switch (reader.get<RequestType>())
+  {
+    case RequestType::Delivery:
+    {
+      const auto pickup = reader.get<uint64_t>();
+      const auto pickup_wait = get_duration(reader);
+      const auto dropoff = reader.get<uint64_t>();
+      const auto dropoff_wait = get_duration(reader);
+      const auto dispenser = reader.get_string();
+      const auto ingestor = reader.get_string();
+      description = requests::Delivery::Description::make(
+        pickup, pickup_wait, dropoff, dropoff_wait, {{}}, dispenser, ingestor);
+      break;
+    }
+    case RequestType::Loop:
+    {
+      const auto start = reader.get<uint64_t>();
+      const auto finish = reader.get<uint64_t>();
+      const auto num_loops = reader.get<uint64_t>();
+      description = requests::Loop::Description::make(start, finish, num_loops);
+      break;
+    }
+    case RequestType::Clean:
+    {
+      const auto start = reader.get<uint64_t>();
+      const auto end = reader.get<uint64_t>();
+      const auto num_points = reader.get<uint64_t>();
+      rmf_traffic::Trajectory path;
+      for (std::size_t i = 0; i < num_points; ++i)
+      {
+        const auto time = reader.get_time();
+        Eigen::Vector3d p;
+        Eigen::Vector3d v;
+        for (std::size_t k = 0; k < 3; ++k)
+          p[k] = reader.get<double>();
+        for (std::size_t k = 0; k < 3; ++k)
+          v[k] = reader.get<double>();
+
+        path.insert(time, p, v);
+      }
+
+      description = requests::Clean::Description::make(start, end, path);
+      break;
+    }
+    case RequestType::ChargeBattery:
+    {
+      if (reader.get<uint8_t>() != 0)
+        description = requests::ChargeBattery::Description::make_indefinite();
+      else
+        description = requests::ChargeBattery::Description::make();
+      break;
+    }
+    default:
+    {
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::runtime_error(
+        "A planner service message has an unknown type for request ["
+        + id + "]");
+      // *INDENT-ON*
+    }
+  }
+
+  std::shared_ptr<Task::Booking> booking;
+  if (requester.has_value() && request_time.has_value())
+  {
+    booking = std::make_shared<Task::Booking>(
+      id, earliest_start_time, std::move(priority), *requester,
+      rmf_traffic::Time(rmf_traffic::Duration(*request_time)), automatic);
+  }
+  else
+  {
+    booking = std::make_shared<Task::Booking>(
+      id, earliest_start_time, std::move(priority), automatic);
+  }
+
+  return std::make_shared<Request>(std::move(booking), std::move(description));
+}
+
+//==============================================================================
+std::string encode_refusal(const std::string& message)
+{
+  WireWriter writer;
+  writer.put(ResultKind::Refused).put_string(message);
+  return writer.bytes();
+}
+
+//==============================================================================
+/// Encode the result of a plan. Assignments of the requests that the client
+/// submitted refer to them by their index, which is found from the booking
+/// id since a result may come from the plan cache of the planner. The
+/// requests that the planner generated, such as automatic charging, are
+/// written in full.
+std::string encode_result(
+  const TaskPlanner::Result& result,
+  const std::vector<ConstRequestPtr>& requests)
+{
+  WireWriter writer;
+  if (const auto* error = std::get_if<TaskPlanner::TaskPlannerError>(&result))
+  {
+    writer.put(ResultKind::PlannerError).put<uint32_t>(
+      static_cast<uint32_t>(*error));
+    return writer.bytes();
+  }
+
+  std::unordered_map<std::string, uint32_t> indices;
+  for (std::size_t i = 0; i < requests.size(); ++i)
+    indices.insert({requests[i]->booking()->id(), static_cast<uint32_t>(i)});
+
+  const auto& assignments = std::get<TaskPlanner::Assignments>(result);
+  writer.put(ResultKind::Assignments).put<uint32_t>(
+    static_cast<uint32_t>(assignments.size()));
+  for (const auto& agent : assignments)
+  {
+    writer.put<uint32_t>(static_cast<uint32_t>(agent.size()));
+    for (const auto& assignment : agent)
+    {
+      const auto it = indices.find(assignment.request()->booking()->id());
+      if (it != indices.end())
+      {
+        writer.put<uint8_t>(0).put<uint32_t>(it->second);
+      }
+      else
+      {
+        writer.put<uint8_t>(1);
+        put_request(writer, *assignment.request());
+      }
+
+      put_state(writer, assignment.finish_state());
+      writer.put_time(assignment.deployment_time());
+    }
+  }
+
+  return writer.bytes();
+}
+
+//==============================================================================
+TaskPlanner::Result decode_result(
+  WireReader& reader,
+  const std::vector<ConstRequestPtr>& requests)
+{
+  switch (reader.get<ResultKind>())
+  {
+    case ResultKind::Assignments:
+      break;
+    case ResultKind::PlannerError:
+      return static_cast<TaskPlanner::TaskPlannerError>(reader.get<uint32_t>());
+    case ResultKind::Refused:
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::runtime_error(
+        "The planner service refused the request: " + reader.get_string());
+      // *INDENT-ON*
+    default:
+      throw std::runtime_error("A planner service result has an unknown kind");
+  }
+
+  TaskPlanner::Assignments assignments;
+  assignments.resize(reader.get<uint32_t>());
+  for (auto& agent : assignments)
+  {
+    const std::size_t count = reader.get<uint32_t>();
+    agent.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      ConstRequestPtr request;
+      if (reader.get<uint8_t>() == 0)
+      {
+        request = requests.at(reader.get<uint32_t>());
+      }
+      else
+      {
+        request = get_request(reader);
+      }
+
+      auto finish_state = get_state(reader);
+      const auto deployment_time = reader.get_time();
+      agent.emplace_back(
+        std::move(request), std::move(finish_state), deployment_time);
+    }
+  }
+
+  return assignments;
+}
+
+#ifndef _WIN32
+//==============================================================================
+constexpr uint64_t RegionMagic = 0x31766e53'6b736154; // "TaskSnv1"
+constexpr uint32_t RegionVersion = 1;
+constexpr std::size_t RegionAlignment = 64;
+
+//==============================================================================
+std::size_t align(std::size_t size)
+{
+  return (size + RegionAlignment - 1) / RegionAlignment * RegionAlignment;
+}
+
+//==============================================================================
+enum class SlotStatus : uint32_t
+{
+  /// No client is using the slot
+  Free = 0,
+
+  /// A client is writing a request into the slot
+  Writing = 1,
+
+  /// The request is waiting for the service
+  Submitted = 2,
+
+  /// The service is planning the request
+  Planning = 3,
+
+  /// The service has written the result into the slot
+  Answered = 4,
+
+  /// The client stopped waiting while the service was planning, so the
+  /// service should free the slot when it finishes
+  Abandoned = 5
+};
+
+//==============================================================================
+struct RegionHeader
+{
+  uint64_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+  uint64_t slot_capacity;
+  uint64_t next_ticket;
+  uint32_t serving;
+  uint32_t padding;
+  pthread_mutex_t mutex;
+
+  /// Signaled when a request is submitted
+  pthread_cond_t submitted;
+
+  /// Broadcast when a slot is answered or freed, or the service stops
+  pthread_cond_t changed;
+};
+
+//==============================================================================
+struct SlotHeader
+{
+  SlotStatus status;
+  uint32_t padding;
+  uint64_t ticket;
+  uint64_t size;
+};
+
+//==============================================================================
+timespec deadline_after(rmf_traffic::Duration timeout)
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::max(timeout, rmf_traffic::Duration(0))).count();
+  const int64_t total = now.tv_nsec + ns % 1000000000;
+  timespec deadline;
+  deadline.tv_sec = now.tv_sec + ns / 1000000000 + total / 1000000000;
+  deadline.tv_nsec = total % 1000000000;
+  return deadline;
+}
+
+//==============================================================================
+class Region
+{
+public:
+
+  static std::shared_ptr<Region> create(
+    const std::string& path,
+    std::size_t num_slots,
+    std::size_t slot_capacity)
+  {
+    ::unlink(path.c_str());
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (fd < 0)
+      throw std::runtime_error(
+        "Could not create the planner service file " + path);
+    // *INDENT-ON*
+
+    slot_capacity = align(std::max<std::size_t>(slot_capacity, 1));
+    const auto size = region_size(num_slots, slot_capacity);
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+      ::close(fd);
+      ::unlink(path.c_str());
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::runtime_error(
+        "Could not size the planner service file " + path);
+      // *INDENT-ON*
+    }
+
+    auto region = std::shared_ptr<Region>(new Region(path, fd, size));
+    auto& header = region->header();
+    header.magic = 0;
+    header.version = RegionVersion;
+    header.num_slots = static_cast<uint32_t>(num_slots);
+    header.slot_capacity = slot_capacity;
+    header.next_ticket = 0;
+    header.serving = 1;
+
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header.mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&header.submitted, &cond_attr);
+    pthread_cond_init(&header.changed, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    for (std::size_t i = 0; i < num_slots; ++i)
+      region->slot(i) = SlotHeader{SlotStatus::Free, 0, 0, 0};
+
+    // Clients only accept the region once the magic number is written
+    reinterpret_cast<std::atomic<uint64_t>*>(&header.magic)->store(
+      RegionMagic, std::memory_order_release);
+
+    return region;
+  }
+
+  static std::shared_ptr<Region> open(const std::string& path)
+  {
+    const int fd = ::open(path.c_str(), O_RDWR);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (fd < 0)
+      throw std::runtime_error("There is no planner service at " + path);
+    // *INDENT-ON*
+
+    const auto size = ::lseek(fd, 0, SEEK_END);
+    if (size < static_cast<off_t>(sizeof(RegionHeader)))
+    {
+      ::close(fd);
+      throw std::runtime_error("There is no planner service at " + path);
+    }
+
+    auto region = std::shared_ptr<Region>(
+      new Region(path, fd, static_cast<std::size_t>(size)));
+    const auto& header = region->header();
+    const auto magic = reinterpret_cast<const std::atomic<uint64_t>*>(
+      &header.magic)->load(std::memory_order_acquire);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (magic != RegionMagic || header.version != RegionVersion
+      || region_size(header.num_slots, header.slot_capacity) > region->_size)
+      throw std::runtime_error(
+        "The file at " + path + " does not belong to a planner service");
+    // *INDENT-ON*
+
+    return region;
+  }
+
+  RegionHeader& header()
+  {
+    return *static_cast<RegionHeader*>(_data);
+  }
+
+  SlotHeader& slot(std::size_t i)
+  {
+    return *reinterpret_cast<SlotHeader*>(slot_data(i));
+  }
+
+  char* payload(std::size_t i)
+  {
+    return slot_data(i) + align(sizeof(SlotHeader));
+  }
+
+  std::size_t capacity()
+  {
+    return header().slot_capacity;
+  }
+
+  /// Lock the mutex of the region. If a process died while it held the mutex,
+  /// the slots are left as they were, since each status change is a single
+  /// write.
+  void lock()
+  {
+    if (pthread_mutex_lock(&header().mutex) == EOWNERDEAD)
+      pthread_mutex_consistent(&header().mutex);
+  }
+
+  void unlock()
+  {
+    pthread_mutex_unlock(&header().mutex);
+  }
+
+  /// Wait on a condition until the deadline. Returns false on a timeout.
+  bool wait(pthread_cond_t& condition, const timespec& deadline)
+  {
+    const int r =
+      pthread_cond_timedwait(&condition, &header().mutex, &deadline);
+    if (r == EOWNERDEAD)
+      pthread_mutex_consistent(&header().mutex);
+
+    return r != ETIMEDOUT;
+  }
+
+  void wait(pthread_cond_t& condition)
+  {
+    if (pthread_cond_wait(&condition, &header().mutex) == EOWNERDEAD)
+      pthread_mutex_consistent(&header().mutex);
+  }
+
+  const std::string& path() const
+  {
+    return _path;
+  }
+
+  ~Region()
+  {
+    ::munmap(_data, _size);
+    ::close(_fd);
+  }
+
+private:
+
+  Region(std::string path, int fd, std::size_t size)
+  : _path(std::move(path)),
+    _fd(fd),
+    _size(size)
+  {
+    _data = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (_data == MAP_FAILED)
+    {
+      ::close(_fd);
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::runtime_error(
+        "Could not map the planner service file " + _path);
+      // *INDENT-ON*
+    }
+  }
+
+  static std::size_t region_size(
+    std::size_t num_slots,
+    std::size_t slot_capacity)
+  {
+    return align(sizeof(RegionHeader))
+      + num_slots * (align(sizeof(SlotHeader)) + slot_capacity);
+  }
+
+  char* slot_data(std::size_t i)
+  {
+    return static_cast<char*>(_data) + align(sizeof(RegionHeader))
+      + i * (align(sizeof(SlotHeader)) + capacity());
+  }
+
+  std::string _path;
+  int _fd;
+  std::size_t _size;
+  void* _data;
+};
+
+//==============================================================================
+class RegionLock
+{
+public:
+
+  RegionLock(Region& region)
+  : _region(region)
+  {
+    _region.lock();
+  }
+
+  ~RegionLock()
+  {
+    _region.unlock();
+  }
+
+private:
+  Region& _region;
+};
+#endif // _WIN32
+
+} // anonymous namespace
+
+#ifndef _WIN32
+//==============================================================================
+class PlannerService::Implementation
+{
+public:
+
+  std::shared_ptr<Region> region;
+  std::string path;
+
+  std::mutex fleets_mutex;
+  std::unordered_map<std::string, std::shared_ptr<TaskPlanner>> fleets;
+
+  std::atomic_size_t served = 0;
+  std::vector<std::thread> workers;
+
+  void serve()
+  {
+    auto& header = region->header();
+    while (true)
+    {
+      std::optional<std::size_t> next;
+      {
+        RegionLock lock(*region);
+        while (header.serving && !(next = take_next()).has_value())
+          region->wait(header.submitted);
+
+        if (!next.has_value())
+          return;
+
+        region->slot(*next).status = SlotStatus::Planning;
+      }
+
+      const auto i = *next;
+      const auto size = static_cast<std::size_t>(region->slot(i).size);
+      auto result = size > region->capacity() ?
+        encode_refusal("the request does not fit in a request slot") :
+        answer(std::string(region->payload(i), size));
+
+      if (result.size() > region->capacity())
+        result = encode_refusal("the result does not fit in a request slot");
+
+      std::memcpy(region->payload(i), result.data(), result.size());
+
+      RegionLock lock(*region);
+      auto& slot = region->slot(i);
+      slot.size = result.size();
+      if (slot.status == SlotStatus::Abandoned)
+        slot.status = SlotStatus::Free;
+      else
+        slot.status = SlotStatus::Answered;
+
+      ++served;
+      pthread_cond_broadcast(&header.changed);
+    }
+  }
+
+  /// Find the submitted request that has been waiting the longest. The mutex
+  /// of the region must be locked.
+  std::optional<std::size_t> take_next()
+  {
+    std::optional<std::size_t> next;
+    for (std::size_t i = 0; i < region->header().num_slots; ++i)
+    {
+      const auto& slot = region->slot(i);
+      if (slot.status != SlotStatus::Submitted)
+        continue;
+
+      if (!next.has_value() || slot.ticket < region->slot(*next).ticket)
+        next = i;
+    }
+
+    return next;
+  }
+
+  std::string answer(const std::string& request)
+  {
+    try
+    {
+      WireReader reader(request.data(), request.size());
+      const auto fleet = reader.get_string();
+      const auto time_now = reader.get_time();
+
+      std::vector<State> agents;
+      agents.resize(reader.get<uint32_t>());
+      for (auto& agent : agents)
+        agent = get_state(reader);
+
+      std::vector<ConstRequestPtr> requests;
+      requests.resize(reader.get<uint32_t>());
+      for (auto& r : requests)
+        r = get_request(reader);
+
+      std::shared_ptr<TaskPlanner> planner;
+      {
+        std::lock_guard<std::mutex> lock(fleets_mutex);
+        const auto it = fleets.find(fleet);
+        if (it != fleets.end())
+          planner = it->second;
+      }
+
+      if (!planner)
+        return encode_refusal("unknown fleet [" + fleet + "]");
+
+      return encode_result(
+        planner->plan(time_now, agents, requests), requests);
+    }
+    catch (const std::exception& e)
+    {
+      return encode_refusal(e.what());
+    }
+  }
+
+  ~Implementation()
+  {
+    if (!region)
+      return;
+
+    {
+      RegionLock lock(*region);
+      auto& header = region->header();
+      header.serving = 0;
+      pthread_cond_broadcast(&header.submitted);
+      pthread_cond_broadcast(&header.changed);
+    }
+
+    for (auto& worker : workers)
+      worker.join();
+
+    ::unlink(path.c_str());
+  }
+};
+
+//==============================================================================
+class PlannerService::Client::Implementation
+{
+public:
+
+  std::shared_ptr<Region> region;
+
+  std::string exchange(
+    const std::string& request,
+    rmf_traffic::Duration timeout) const
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (request.size() > region->capacity())
+      throw std::runtime_error(
+        "The planner service refused the request: it does not fit in a "
+        "request slot");
+    // *INDENT-ON*
+
+    const auto deadline = deadline_after(timeout);
+    auto& header = region->header();
+
+    RegionLock lock(*region);
+    std::optional<std::size_t> claimed;
+    while (!claimed.has_value())
+    {
+      if (!header.serving)
+        throw std::runtime_error("The planner service has stopped");
+
+      for (std::size_t i = 0; i < header.num_slots; ++i)
+      {
+        if (region->slot(i).status == SlotStatus::Free)
+        {
+          claimed = i;
+          break;
+        }
+      }
+
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      if (!claimed.has_value() && !region->wait(header.changed, deadline))
+        throw std::runtime_error(
+          "Timed out waiting for a free slot of the planner service");
+      // *INDENT-ON*
+    }
+
+    const auto i = *claimed;
+    auto& slot = region->slot(i);
+    slot.status = SlotStatus::Writing;
+    slot.ticket = header.next_ticket++;
+
+    // Writing into a claimed slot does not need the lock, but the copy is
+    // small next to the plan, so it is simpler to keep holding it.
+    std::memcpy(region->payload(i), request.data(), request.size());
+    slot.size = request.size();
+    slot.status = SlotStatus::Submitted;
+    pthread_cond_signal(&header.submitted);
+
+    while (slot.status != SlotStatus::Answered)
+    {
+      if (!header.serving)
+        throw std::runtime_error("The planner service has stopped");
+
+      if (!region->wait(header.changed, deadline))
+      {
+        if (slot.status == SlotStatus::Submitted)
+        {
+          slot.status = SlotStatus::Free;
+        }
+        else if (slot.status == SlotStatus::Planning)
+        {
+          slot.status = SlotStatus::Abandoned;
+        }
+        else
+        {
+          // The answer arrived just as the wait timed out
+          continue;
+        }
+
+        pthread_cond_broadcast(&header.changed);
+        throw std::runtime_error("Timed out waiting for the planner service");
+      }
+    }
+
+    std::string result(
+      region->payload(i), static_cast<std::size_t>(slot.size));
+    slot.status = SlotStatus::Free;
+    pthread_cond_broadcast(&header.changed);
+    return result;
+  }
+};
+
+//==============================================================================
+PlannerService::PlannerService(
+  std::string path,
+  std::size_t threads,
+  std::size_t slots,
+  std::size_t slot_capacity)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  _pimpl->region =
+    Region::create(path, std::max<std::size_t>(slots, 1), slot_capacity);
+  _pimpl->path = std::move(path);
+
+  threads = std::max<std::size_t>(threads, 1);
+  _pimpl->workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i)
+    _pimpl->workers.emplace_back([pimpl = _pimpl.get()]() { pimpl->serve(); });
+}
+
+//==============================================================================
+PlannerService& PlannerService::add_fleet(
+  const std::string& fleet,
+  std::shared_ptr<TaskPlanner> planner)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->fleets_mutex);
+  _pimpl->fleets[fleet] = std::move(planner);
+  return *this;
+}
+
+//==============================================================================
+const std::string& PlannerService::path() const
+{
+  return _pimpl->path;
+}
+
+//==============================================================================
+std::size_t PlannerService::served() const
+{
+  return _pimpl->served.load();
+}
+
+//==============================================================================
+PlannerService::~PlannerService() = default;
+
+//==============================================================================
+PlannerService::Client::Client(const std::string& path)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{Region::open(path)}))
+{
+  // Do nothing
+}
+
+//==============================================================================
+TaskPlanner::Result PlannerService::Client::plan(
+  const std::string& fleet,
+  rmf_traffic::Time time_now,
+  const std::vector<State>& agents,
+  const std::vector<ConstRequestPtr>& requests,
+  rmf_traffic::Duration timeout) const
+{
+  WireWriter writer;
+  writer.put_string(fleet).put_time(time_now);
+  writer.put<uint32_t>(static_cast<uint32_t>(agents.size()));
+  for (const auto& agent : agents)
+    put_state(writer, agent);
+
+  writer.put<uint32_t>(static_cast<uint32_t>(requests.size()));
+  for (const auto& request : requests)
+    put_request(writer, *request);
+
+  const auto result = _pimpl->exchange(writer.bytes(), timeout);
+  WireReader reader(result.data(), result.size());
+  return decode_result(reader, requests);
+}
+#else
+//==============================================================================
+class PlannerService::Implementation
+{
+public:
+  std::string path;
+};
+
+//==============================================================================
+class PlannerService::Client::Implementation
+{
+};
+
+//==============================================================================
+PlannerService::PlannerService(
+  std::string path,
+  std::size_t,
+  std::size_t,
+  std::size_t)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  throw std::runtime_error(
+    "The planner service is not supported on this platform: " + path);
+  // *INDENT-ON*
+}
+
+//==============================================================================
+PlannerService& PlannerService::add_fleet(
+  const std::string&,
+  std::shared_ptr<TaskPlanner>)
+{
+  return *this;
+}
+
+//==============================================================================
+const std::string& PlannerService::path() const
+{
+  return _pimpl->path;
+}
+
+//==============================================================================
+std::size_t PlannerService::served() const
+{
+  return 0;
+}
+
+//==============================================================================
+PlannerService::~PlannerService() = default;
+
+//==============================================================================
+PlannerService::Client::Client(const std::string& path)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  throw std::runtime_error(
+    "The planner service is not supported on this platform: " + path);
+  // *INDENT-ON*
+}
+
+//==============================================================================
+TaskPlanner::Result PlannerService::Client::plan(
+  const std::string&,
+  rmf_traffic::Time,
+  const std::vector<State>&,
+  const std::vector<ConstRequestPtr>&,
+  rmf_traffic::Duration) const
+{
+  return TaskPlanner::TaskPlannerError::low_battery;
+}
+#endif // _WIN32
+
+} // namespace rmf_task
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/SnapshotHub.hpp>
+#include <rmf_task/CborWriter.hpp>
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rmf_task {
+
+//==============================================================================
+class SnapshotHub::Implementation
+{
+public:
+
+  struct Format
+  {
+    std::shared_ptr<const Encoder> encoder;
+    std::map<uint64_t, std::shared_ptr<const Subscriber>> subscribers;
+  };
+
+  struct Entry
+  {
+    Phase::ConstSnapshotPtr snapshot;
+    // The buffers of the snapshot that have been encoded so far, by format
+    std::unordered_map<std::string, Buffer> encoded;
+  };
+
+  // Get the buffer of a snapshot in a format, encoding it if this is the
+  // first time that the format is needed. The mutex must be locked.
+  Buffer encode(Entry& entry, const std::string& format_name)
+  {
+    const auto format = formats.find(format_name);
+    if (format == formats.end())
+    {
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::invalid_argument(
+        "[rmf_task::SnapshotHub] Unknown format [" + format_name + "]");
+      // *INDENT-ON*
+    }
+
+    auto& buffer = entry.encoded[format_name];
+    if (!buffer)
+    {
+      buffer = std::make_shared<const std::vector<uint8_t>>(
+        (*format->second.encoder)(*entry.snapshot));
+      ++encodings;
+    }
+
+    return buffer;
+  }
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, Format> formats;
+  // Which format each subscriber belongs to
+  std::unordered_map<uint64_t, std::string> subscriptions;
+  std::unordered_map<std::string, Entry> tasks;
+  uint64_t next_subscriber = 0;
+  std::size_t encodings = 0;
+};
+
+//==============================================================================
+SnapshotHub::SnapshotHub()
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  add_format("cbor", &SnapshotHub::encode_cbor);
+}
+
+//==============================================================================
+SnapshotHub& SnapshotHub::add_format(std::string format, Encoder encoder)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  for (auto& [task, entry] : _pimpl->tasks)
+    entry.encoded.erase(format);
+
+  _pimpl->formats[std::move(format)].encoder =
+    std::make_shared<const Encoder>(std::move(encoder));
+
+  return *this;
+}
+
+//==============================================================================
+std::vector<uint8_t> SnapshotHub::encode_cbor(const Phase::Snapshot& snapshot)
+{
+  std::vector<uint8_t> buffer;
+  CborWriter(buffer).write(snapshot);
+  return buffer;
+}
+
+//==============================================================================
+uint64_t SnapshotHub::subscribe(
+  const std::string& format,
+  Subscriber subscriber)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->formats.find(format);
+  if (it == _pimpl->formats.end())
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "[rmf_task::SnapshotHub::subscribe] Unknown format [" + format + "]");
+    // *INDENT-ON*
+  }
+
+  const auto id = _pimpl->next_subscriber++;
+  it->second.subscribers[id] =
+    std::make_shared<const Subscriber>(std::move(subscriber));
+  _pimpl->subscriptions[id] = format;
+  return id;
+}
+
+//==============================================================================
+void SnapshotHub::unsubscribe(const uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->subscriptions.find(id);
+  if (it == _pimpl->subscriptions.end())
+    return;
+
+  _pimpl->formats.at(it->second).subscribers.erase(id);
+  _pimpl->subscriptions.erase(it);
+}
+
+//==============================================================================
+void SnapshotHub::publish(
+  const std::string& task,
+  Phase::ConstSnapshotPtr snapshot)
+{
+  if (!snapshot)
+    return;
+
+  std::vector<std::pair<Buffer, std::vector<std::shared_ptr<const Subscriber>>>>
+  deliveries;
+  {
+    std::lock_guard<std::mutex> lock(_pimpl->mutex);
+    auto& entry = _pimpl->tasks[task];
+    if (entry.snapshot == snapshot)
+      return;
+
+    entry.snapshot = std::move(snapshot);
+    entry.encoded.clear();
+
+    for (const auto& [name, format] : _pimpl->formats)
+    {
+      if (format.subscribers.empty())
+        continue;
+
+      std::vector<std::shared_ptr<const Subscriber>> subscribers;
+      subscribers.reserve(format.subscribers.size());
+      for (const auto& [id, subscriber] : format.subscribers)
+        subscribers.push_back(subscriber);
+
+      deliveries.emplace_back(
+        _pimpl->encode(entry, name), std::move(subscribers));
+    }
+  }
+
+  for (const auto& [buffer, subscribers] : deliveries)
+  {
+    for (const auto& subscriber : subscribers)
+      (*subscriber)(task, buffer);
+  }
+}
+
+//==============================================================================
+Phase::ConstSnapshotPtr SnapshotHub::latest(const std::string& task) const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->tasks.find(task);
+  if (it == _pimpl->tasks.end())
+    return nullptr;
+
+  return it->second.snapshot;
+}
+
+//==============================================================================
+auto SnapshotHub::encoded(const std::string& task, const std::string& format)
+-> Buffer
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->tasks.find(task);
+  if (it == _pimpl->tasks.end())
+  {
+    if (_pimpl->formats.count(format) == 0)
+    {
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::invalid_argument(
+        "[rmf_task::SnapshotHub::encoded] Unknown format [" + format + "]");
+      // *INDENT-ON*
+    }
+
+    return nullptr;
+  }
+
+  return _pimpl->encode(it->second, format);
+}
+
+//==============================================================================
+void SnapshotHub::erase(const std::string& task)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->tasks.erase(task);
+}
+
+//==============================================================================
+std::size_t SnapshotHub::encodings() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->encodings;
+}
+
+} // namespace rmf_task
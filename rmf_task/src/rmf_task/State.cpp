@@ -169,4 +169,38 @@ std::optional<rmf_traffic::agv::Plan::Start> State::extract_plan_start() const
   return rmf_traffic::agv::Plan::Start(t->value, wp->value, ori->value);
 }
 
+//==============================================================================
+std::optional<PlanningState> PlanningState::from(const State& state)
+{
+  const auto* wp = state.get<State::CurrentWaypoint>();
+  const auto* ori = state.get<State::CurrentOrientation>();
+  const auto* t = state.get<State::CurrentTime>();
+  const auto* charger = state.get<State::DedicatedChargingPoint>();
+  const auto* soc = state.get<State::CurrentBatterySoC>();
+  if (!wp || !ori || !t || !charger || !soc)
+    return std::nullopt;
+
+  return PlanningState{
+    wp->value,
+    ori->value,
+    t->value,
+    charger->value,
+    soc->value
+  };
+}
+
+//==============================================================================
+State PlanningState::to_state() const
+{
+  State state;
+  state.load_basic(plan_start(), dedicated_charging_waypoint, battery_soc);
+  return state;
+}
+
+//==============================================================================
+rmf_traffic::agv::Plan::Start PlanningState::plan_start() const
+{
+  return rmf_traffic::agv::Plan::Start(time, waypoint, orientation);
+}
+
 } // namespace rmf_task
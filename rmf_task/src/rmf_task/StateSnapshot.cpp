@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/StateSnapshot.hpp>
+
+#include <mutex>
+
+namespace rmf_task {
+
+//==============================================================================
+class StateSnapshot::Implementation
+{
+public:
+
+  Implementation(GetState get_state_)
+  : get_state(std::move(get_state_))
+  {
+    // Do nothing
+  }
+
+  std::shared_ptr<const State> get()
+  {
+    uint64_t tick;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (current)
+        return current;
+
+      tick = ticks;
+    }
+
+    // The state is built without holding the lock in case get_state asks for
+    // the snapshot itself
+    auto state = std::make_shared<const State>(get_state());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++builds;
+    // Someone else may have built the state of this tick in the meantime, and
+    // a state that was built before a tick must not be kept after it
+    if (tick == ticks && !current)
+      current = state;
+
+    return state;
+  }
+
+  void tick()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++ticks;
+    current = nullptr;
+  }
+
+  GetState get_state;
+
+  mutable std::mutex mutex;
+  std::shared_ptr<const State> current;
+  uint64_t ticks = 0;
+  std::size_t builds = 0;
+};
+
+//==============================================================================
+StateSnapshot::StateSnapshot(GetState get_state)
+: _pimpl(std::make_shared<Implementation>(std::move(get_state)))
+{
+  // Do nothing
+}
+
+//==============================================================================
+void StateSnapshot::tick()
+{
+  _pimpl->tick();
+}
+
+//==============================================================================
+std::shared_ptr<const State> StateSnapshot::get() const
+{
+  return _pimpl->get();
+}
+
+//==============================================================================
+auto StateSnapshot::provider() const -> GetState
+{
+  return [impl = _pimpl]() -> State
+    {
+      return *impl->get();
+    };
+}
+
+//==============================================================================
+std::size_t StateSnapshot::builds() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->builds;
+}
+
+} // namespace rmf_task
@@ -19,19 +19,24 @@
 
 #include <rmf_task/Task.hpp>
 
+#include <algorithm>
+
 namespace rmf_task {
 
 //==============================================================================
 class Task::Booking::Implementation
 {
 public:
-  std::string id;
+  // The fields that are read while sorting and filtering bookings come first
+  // so they share the first cache line of the implementation.
   rmf_traffic::Time earliest_start_time;
   rmf_task::ConstPriorityPtr priority;
-  std::optional<std::string> requester;
-  std::optional<rmf_traffic::Time> request_time;
   bool automatic;
+  std::string id;
+  std::optional<rmf_traffic::Time> request_time;
+  std::optional<std::string> requester;
   std::vector<std::string> labels;
+  std::vector<std::string> dependencies;
 };
 
 //==============================================================================
@@ -43,13 +48,14 @@ Task::Booking::Booking(
   const std::vector<std::string>& labels)
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
-        std::move(id),
         earliest_start_time,
         std::move(priority),
+        automatic,
+        std::move(id),
         std::nullopt,
         std::nullopt,
-        automatic,
         labels,
+        {}
       }))
 {
   // Do nothing
@@ -66,13 +72,14 @@ Task::Booking::Booking(
   const std::vector<std::string>& labels)
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
-        std::move(id),
         earliest_start_time,
         std::move(priority),
-        requester,
-        std::move(request_time),
         automatic,
+        std::move(id),
+        request_time,
+        requester,
         labels,
+        {}
       }))
 {
   // Do nothing
@@ -91,19 +98,20 @@ rmf_traffic::Time Task::Booking::earliest_start_time() const
 }
 
 //==============================================================================
-ConstPriorityPtr Task::Booking::priority() const
+const ConstPriorityPtr& Task::Booking::priority() const
 {
   return _pimpl->priority;
 }
 
 //==============================================================================
-std::optional<std::string> Task::Booking::requester() const
+const std::optional<std::string>& Task::Booking::requester() const
 {
   return _pimpl->requester;
 }
 
 //==============================================================================
-std::optional<rmf_traffic::Time> Task::Booking::request_time() const
+auto Task::Booking::request_time() const
+-> const std::optional<rmf_traffic::Time>&
 {
   return _pimpl->request_time;
 }
@@ -115,11 +123,32 @@ bool Task::Booking::automatic() const
 }
 
 //==============================================================================
-std::vector<std::string> Task::Booking::labels() const
+const std::vector<std::string>& Task::Booking::labels() const
 {
   return _pimpl->labels;
 }
 
+//==============================================================================
+bool Task::Booking::has_label(const std::string_view label) const
+{
+  const auto& labels = _pimpl->labels;
+  return std::find(labels.begin(), labels.end(), label) != labels.end();
+}
+
+//==============================================================================
+auto Task::Booking::dependencies(std::vector<std::string> booking_ids)
+-> Booking&
+{
+  _pimpl->dependencies = std::move(booking_ids);
+  return *this;
+}
+
+//==============================================================================
+const std::vector<std::string>& Task::Booking::dependencies() const
+{
+  return _pimpl->dependencies;
+}
+
 //==============================================================================
 class Task::Tag::Implementation
 {
@@ -153,6 +182,82 @@ const Header& Task::Tag::header() const
   return _pimpl->header;
 }
 
+//==============================================================================
+std::vector<std::optional<Estimate>> Task::Model::estimate_finish_batch(
+  const std::vector<State>& initial_states,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  std::vector<std::optional<Estimate>> estimates;
+  estimates.reserve(initial_states.size());
+  for (const auto& state : initial_states)
+  {
+    estimates.push_back(
+      estimate_finish(state, task_planning_constraints, travel_estimator));
+  }
+
+  return estimates;
+}
+
+//==============================================================================
+bool Task::Model::uses_planning_state() const
+{
+  return false;
+}
+
+//==============================================================================
+auto Task::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  const auto estimate = estimate_finish(
+    initial_state.to_state(), task_planning_constraints, travel_estimator);
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  const auto finish_state = PlanningState::from(estimate->finish_state());
+  if (!finish_state.has_value())
+    return std::nullopt;
+
+  return PlanningEstimate{*finish_state, estimate->wait_until()};
+}
+
+//==============================================================================
+void Task::Model::materialize(const TravelEstimator&) const
+{
+  // Do nothing
+}
+
+//==============================================================================
+Task::ConstModelPtr Task::Description::make_model(
+  rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters,
+  const TravelEstimator&) const
+{
+  return make_model(earliest_start_time, parameters);
+}
+
+//==============================================================================
+Task::ConstModelPtr Task::Model::with_earliest_start_time(
+  rmf_traffic::Time) const
+{
+  return nullptr;
+}
+
+//==============================================================================
+std::optional<std::size_t> Task::Description::model_hash() const
+{
+  return std::nullopt;
+}
+
+//==============================================================================
+std::size_t Task::Active::suppressed_updates() const
+{
+  return 0;
+}
+
 //==============================================================================
 Task::Active::Resume Task::Active::make_resumer(std::function<void()> callback)
 {
@@ -16,17 +16,40 @@
 */
 
 #include <rmf_task/Estimate.hpp>
+#include <rmf_task/Executor.hpp>
+#include <rmf_task/Metrics.hpp>
 #include <rmf_task/State.hpp>
+#include <rmf_task/Trace.hpp>
 #include <rmf_task/BinaryPriorityScheme.hpp>
 #include <rmf_task/requests/ChargeBattery.hpp>
 
 #include "BinaryPriorityCostCalculator.hpp"
+#include "ChargerPool.hpp"
+#include "ChargerReachability.hpp"
+#include "Filter.hpp"
+#include "OpenList.hpp"
+#include "PlanCache.hpp"
+#include "PlanCapture.hpp"
 
 #include <rmf_traffic/Time.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <queue>
+#include <random>
+#include <stdexcept>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
 
 namespace rmf_task {
 
@@ -38,6 +61,13 @@ public:
   Parameters parameters;
   Constraints constraints;
   ConstCostCalculatorPtr cost_calculator;
+  ConstTravelEstimatorPtr travel_estimator = nullptr;
+  std::size_t model_cache_capacity = 1000;
+  std::size_t plan_cache_capacity = 0;
+  rmf_traffic::Duration plan_cache_time_resolution = std::chrono::seconds(1);
+  std::size_t worker_pool_size = 0;
+  std::size_t arena_pool_capacity = 0;
+  std::vector<std::size_t> charger_pool = {};
 };
 
 //==============================================================================
@@ -98,6 +128,106 @@ auto TaskPlanner::Configuration::cost_calculator(
   return *this;
 }
 
+//==============================================================================
+const ConstTravelEstimatorPtr&
+TaskPlanner::Configuration::travel_estimator() const
+{
+  return _pimpl->travel_estimator;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::travel_estimator(
+  ConstTravelEstimatorPtr travel_estimator) -> Configuration&
+{
+  _pimpl->travel_estimator = std::move(travel_estimator);
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Configuration::model_cache_capacity() const
+{
+  return _pimpl->model_cache_capacity;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::model_cache_capacity(
+  const std::size_t capacity) -> Configuration&
+{
+  _pimpl->model_cache_capacity = capacity;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Configuration::plan_cache_capacity() const
+{
+  return _pimpl->plan_cache_capacity;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::plan_cache_capacity(
+  const std::size_t capacity) -> Configuration&
+{
+  _pimpl->plan_cache_capacity = capacity;
+  return *this;
+}
+
+//==============================================================================
+rmf_traffic::Duration
+TaskPlanner::Configuration::plan_cache_time_resolution() const
+{
+  return _pimpl->plan_cache_time_resolution;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::plan_cache_time_resolution(
+  const rmf_traffic::Duration value) -> Configuration&
+{
+  _pimpl->plan_cache_time_resolution = value;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Configuration::worker_pool_size() const
+{
+  return _pimpl->worker_pool_size;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::worker_pool_size(const std::size_t value)
+-> Configuration&
+{
+  _pimpl->worker_pool_size = value;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Configuration::arena_pool_capacity() const
+{
+  return _pimpl->arena_pool_capacity;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::arena_pool_capacity(const std::size_t bytes)
+-> Configuration&
+{
+  _pimpl->arena_pool_capacity = bytes;
+  return *this;
+}
+
+//==============================================================================
+const std::vector<std::size_t>& TaskPlanner::Configuration::charger_pool() const
+{
+  return _pimpl->charger_pool;
+}
+
+//==============================================================================
+auto TaskPlanner::Configuration::charger_pool(std::vector<std::size_t> chargers)
+-> Configuration&
+{
+  _pimpl->charger_pool = std::move(chargers);
+  return *this;
+}
+
 //==============================================================================
 class TaskPlanner::Options::Implementation
 {
@@ -106,6 +236,33 @@ public:
   bool greedy;
   std::function<bool()> interrupter;
   ConstRequestFactoryPtr finishing_request;
+  bool arena_allocation = false;
+  std::size_t expansion_threads = 1;
+  std::size_t initialization_threads = 1;
+  bool portfolio = false;
+  bool anytime = false;
+  double heuristic_weight = 1.0;
+  std::size_t max_open_nodes = 0;
+  FilterType filter_type = FilterType::Hash;
+  TieBreak tie_break = TieBreak::None;
+  std::optional<double> partial_expansion = std::nullopt;
+  bool decompose = false;
+  bool branch_and_bound = false;
+  std::optional<rmf_traffic::Duration> time_budget = std::nullopt;
+  std::size_t regret_insertion = 0;
+  bool auction = false;
+  std::optional<rmf_traffic::Duration> refinement_time = std::nullopt;
+  std::size_t refinement_threads = 1;
+  SegmentCallback segment_callback = nullptr;
+  bool symmetry_breaking = false;
+  double symmetry_tolerance = 0.0;
+  std::string capture_path = {};
+  std::size_t pinned_assignments = 0;
+  std::optional<rmf_traffic::Time> pinned_horizon = std::nullopt;
+  std::optional<rmf_traffic::Duration> planning_horizon = std::nullopt;
+  bool deterministic = false;
+  std::size_t approximate_candidates = 0;
+  bool adaptive_segmentation = false;
 };
 
 //==============================================================================
@@ -150,6 +307,46 @@ const std::function<bool()>& TaskPlanner::Options::interrupter() const
   return _pimpl->interrupter;
 }
 
+//==============================================================================
+auto TaskPlanner::Options::time_budget(
+  std::optional<rmf_traffic::Duration> value) -> Options&
+{
+  _pimpl->time_budget = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<rmf_traffic::Duration> TaskPlanner::Options::time_budget() const
+{
+  return _pimpl->time_budget;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::regret_insertion(std::size_t k) -> Options&
+{
+  _pimpl->regret_insertion = k;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Options::regret_insertion() const
+{
+  return _pimpl->regret_insertion;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::auction(bool value) -> Options&
+{
+  _pimpl->auction = value;
+  return *this;
+}
+
+//==============================================================================
+bool TaskPlanner::Options::auction() const
+{
+  return _pimpl->auction;
+}
+
 //==============================================================================
 auto TaskPlanner::Options::finishing_request(
   ConstRequestFactoryPtr finishing_request) -> Options&
@@ -165,944 +362,3817 @@ ConstRequestFactoryPtr TaskPlanner::Options::finishing_request() const
 }
 
 //==============================================================================
-class TaskPlanner::Assignment::Implementation
+auto TaskPlanner::Options::arena_allocation(bool value) -> Options&
 {
-public:
+  _pimpl->arena_allocation = value;
+  return *this;
+}
 
-  rmf_task::ConstRequestPtr request;
-  State state;
-  rmf_traffic::Time deployment_time;
-};
+//==============================================================================
+bool TaskPlanner::Options::arena_allocation() const
+{
+  return _pimpl->arena_allocation;
+}
 
 //==============================================================================
-TaskPlanner::Assignment::Assignment(
-  rmf_task::ConstRequestPtr request,
-  State state,
-  rmf_traffic::Time deployment_time)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        std::move(request),
-        std::move(state),
-        deployment_time
-      }))
+auto TaskPlanner::Options::expansion_threads(std::size_t value) -> Options&
 {
-  // Do nothing
+  _pimpl->expansion_threads = value;
+  return *this;
 }
 
 //==============================================================================
-const rmf_task::ConstRequestPtr& TaskPlanner::Assignment::request() const
+std::size_t TaskPlanner::Options::expansion_threads() const
 {
-  return _pimpl->request;
+  return _pimpl->expansion_threads;
 }
 
 //==============================================================================
-const State& TaskPlanner::Assignment::finish_state() const
+auto TaskPlanner::Options::initialization_threads(std::size_t value)
+-> Options&
 {
-  return _pimpl->state;
+  _pimpl->initialization_threads = value;
+  return *this;
 }
 
 //==============================================================================
-const rmf_traffic::Time TaskPlanner::Assignment::deployment_time() const
+std::size_t TaskPlanner::Options::initialization_threads() const
 {
-  return _pimpl->deployment_time;
+  return _pimpl->initialization_threads;
 }
 
 //==============================================================================
+auto TaskPlanner::Options::portfolio(bool value) -> Options&
+{
+  _pimpl->portfolio = value;
+  return *this;
+}
 
-namespace {
+//==============================================================================
+bool TaskPlanner::Options::portfolio() const
+{
+  return _pimpl->portfolio;
+}
 
-// ============================================================================
-// The type of filter used for solving the task assignment problem
-enum class FilterType
+//==============================================================================
+auto TaskPlanner::Options::anytime(bool value) -> Options&
 {
-  Passthrough,
-  Trie,
-  Hash
-};
+  _pimpl->anytime = value;
+  return *this;
+}
 
-// ============================================================================
-class Filter
+//==============================================================================
+bool TaskPlanner::Options::anytime() const
 {
-public:
+  return _pimpl->anytime;
+}
 
-  Filter(FilterType type, const std::size_t N_tasks)
-  : _type(type),
-    _set(N_tasks, AssignmentHash(N_tasks))
+//==============================================================================
+auto TaskPlanner::Options::heuristic_weight(double value) -> Options&
+{
+  if (!(value >= 1.0))
   {
-    // Do nothing
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "The heuristic weight of the task planner needs to be at least 1.0.");
+    // *INDENT-ON*
   }
 
-  bool ignore(const Node& node);
-
-private:
+  _pimpl->heuristic_weight = value;
+  return *this;
+}
 
-  struct TaskTable;
+//==============================================================================
+double TaskPlanner::Options::heuristic_weight() const
+{
+  return _pimpl->heuristic_weight;
+}
 
-  struct AgentTable
-  {
-    std::unordered_map<std::size_t, std::unique_ptr<TaskTable>> agent;
-  };
+//==============================================================================
+auto TaskPlanner::Options::max_open_nodes(std::size_t value) -> Options&
+{
+  _pimpl->max_open_nodes = value;
+  return *this;
+}
 
-  struct TaskTable
-  {
-    std::unordered_map<std::size_t, std::unique_ptr<AgentTable>> task;
-  };
+//==============================================================================
+std::size_t TaskPlanner::Options::max_open_nodes() const
+{
+  return _pimpl->max_open_nodes;
+}
 
-  struct AssignmentHash
-  {
-    AssignmentHash(std::size_t N)
-    {
-      // We add 1 to N because
-      _shift = std::ceil(std::log2(N+1));
-    }
+//==============================================================================
+auto TaskPlanner::Options::filter_type(FilterType value) -> Options&
+{
+  _pimpl->filter_type = value;
+  return *this;
+}
 
-    std::size_t operator()(const Node::AssignedTasks& assignments) const
-    {
-      std::size_t output = 0;
-      std::size_t count = 0;
-      for (const auto& a : assignments)
-      {
-        for (const auto& s : a)
-        {
-          // We add 1 to the task_id to differentiate between task_id == 0 and
-          // a task being unassigned.
-          const std::size_t id = s.internal_id + 1;
-          output += id << (_shift * (count++));
-        }
-      }
+//==============================================================================
+auto TaskPlanner::Options::filter_type() const -> FilterType
+{
+  return _pimpl->filter_type;
+}
 
-      return output;
-    }
+//==============================================================================
+auto TaskPlanner::Options::tie_break(TieBreak value) -> Options&
+{
+  _pimpl->tie_break = value;
+  return *this;
+}
 
-    std::size_t _shift;
-  };
+//==============================================================================
+auto TaskPlanner::Options::tie_break() const -> TieBreak
+{
+  return _pimpl->tie_break;
+}
 
-  struct AssignmentEqual
+//==============================================================================
+auto TaskPlanner::Options::partial_expansion(
+  const std::optional<double> margin) -> Options&
+{
+  if (margin.has_value() && !(*margin >= 0.0))
   {
-    bool operator()(
-      const Node::AssignedTasks& A, const Node::AssignedTasks& B) const
-    {
-      if (A.size() != B.size())
-        return false;
-
-      for (std::size_t i = 0; i < A.size(); ++i)
-      {
-        const auto& a = A[i];
-        const auto& b = B[i];
-
-        if (a.size() != b.size())
-          return false;
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "The partial expansion margin of the task planner cannot be negative.");
+    // *INDENT-ON*
+  }
 
-        for (std::size_t j = 0; j < a.size(); ++j)
-        {
-          if (a[j].internal_id != b[j].internal_id)
-          {
-            return false;
-          }
-        }
-      }
+  _pimpl->partial_expansion = margin;
+  return *this;
+}
 
-      return true;
-    }
-  };
+//==============================================================================
+std::optional<double> TaskPlanner::Options::partial_expansion() const
+{
+  return _pimpl->partial_expansion;
+}
 
-  using Set = std::unordered_set<Node::AssignedTasks, AssignmentHash,
-      AssignmentEqual>;
+//==============================================================================
+auto TaskPlanner::Options::decompose(bool value) -> Options&
+{
+  _pimpl->decompose = value;
+  return *this;
+}
 
-  FilterType _type;
-  AgentTable _root;
-  Set _set;
-};
+//==============================================================================
+bool TaskPlanner::Options::decompose() const
+{
+  return _pimpl->decompose;
+}
 
-bool Filter::ignore(const Node& node)
+//==============================================================================
+auto TaskPlanner::Options::branch_and_bound(bool value) -> Options&
 {
-  if (_type == FilterType::Passthrough)
-    return false;
+  _pimpl->branch_and_bound = value;
+  return *this;
+}
 
-  if (_type == FilterType::Hash)
-    return !_set.insert(node.assigned_tasks).second;
+//==============================================================================
+bool TaskPlanner::Options::branch_and_bound() const
+{
+  return _pimpl->branch_and_bound;
+}
 
-  bool new_node = false;
+//==============================================================================
+auto TaskPlanner::Options::symmetry_breaking(bool value) -> Options&
+{
+  _pimpl->symmetry_breaking = value;
+  return *this;
+}
 
-  AgentTable* agent_table = &_root;
-  std::size_t a = 0;
-  std::size_t t = 0;
-  while (a < node.assigned_tasks.size())
-  {
-    const auto& current_agent = node.assigned_tasks.at(a);
+//==============================================================================
+bool TaskPlanner::Options::symmetry_breaking() const
+{
+  return _pimpl->symmetry_breaking;
+}
 
-    if (t < current_agent.size())
-    {
-      const auto& task_id = current_agent[t].internal_id;
-      const auto agent_insertion = agent_table->agent.insert({a, nullptr});
-      if (agent_insertion.second)
-        agent_insertion.first->second = std::make_unique<TaskTable>();
+//==============================================================================
+auto TaskPlanner::Options::symmetry_tolerance(double value) -> Options&
+{
+  _pimpl->symmetry_tolerance = value;
+  return *this;
+}
 
-      auto* task_table = agent_insertion.first->second.get();
+//==============================================================================
+double TaskPlanner::Options::symmetry_tolerance() const
+{
+  return _pimpl->symmetry_tolerance;
+}
 
-      const auto task_insertion = task_table->task.insert({task_id, nullptr});
-      if (task_insertion.second)
-      {
-        new_node = true;
-        task_insertion.first->second = std::make_unique<AgentTable>();
-      }
+//==============================================================================
+auto TaskPlanner::Options::refinement_time(
+  std::optional<rmf_traffic::Duration> value) -> Options&
+{
+  _pimpl->refinement_time = value;
+  return *this;
+}
 
-      agent_table = task_insertion.first->second.get();
-      ++t;
-    }
-    else
-    {
-      t = 0;
-      ++a;
-    }
-  }
+//==============================================================================
+std::optional<rmf_traffic::Duration>
+TaskPlanner::Options::refinement_time() const
+{
+  return _pimpl->refinement_time;
+}
 
-  return !new_node;
+//==============================================================================
+auto TaskPlanner::Options::refinement_threads(std::size_t value) -> Options&
+{
+  _pimpl->refinement_threads = value;
+  return *this;
 }
 
-// ============================================================================
-const rmf_traffic::Duration segmentation_threshold =
+//==============================================================================
+std::size_t TaskPlanner::Options::refinement_threads() const
+{
+  return _pimpl->refinement_threads;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::segment_callback(SegmentCallback callback)
+-> Options&
+{
+  _pimpl->segment_callback = std::move(callback);
+  return *this;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::segment_callback() const -> const SegmentCallback&
+{
+  return _pimpl->segment_callback;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::capture_path(std::string value) -> Options&
+{
+  _pimpl->capture_path = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+const std::string& TaskPlanner::Options::capture_path() const
+{
+  return _pimpl->capture_path;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::pinned_assignments(std::size_t value) -> Options&
+{
+  _pimpl->pinned_assignments = value;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Options::pinned_assignments() const
+{
+  return _pimpl->pinned_assignments;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::pinned_horizon(
+  std::optional<rmf_traffic::Time> value) -> Options&
+{
+  _pimpl->pinned_horizon = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<rmf_traffic::Time> TaskPlanner::Options::pinned_horizon() const
+{
+  return _pimpl->pinned_horizon;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::planning_horizon(
+  std::optional<rmf_traffic::Duration> value) -> Options&
+{
+  _pimpl->planning_horizon = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<rmf_traffic::Duration> TaskPlanner::Options::planning_horizon()
+const
+{
+  return _pimpl->planning_horizon;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::deterministic(bool value) -> Options&
+{
+  _pimpl->deterministic = value;
+  return *this;
+}
+
+//==============================================================================
+bool TaskPlanner::Options::deterministic() const
+{
+  return _pimpl->deterministic;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::approximate_candidates(const std::size_t value)
+-> Options&
+{
+  _pimpl->approximate_candidates = value;
+  return *this;
+}
+
+//==============================================================================
+std::size_t TaskPlanner::Options::approximate_candidates() const
+{
+  return _pimpl->approximate_candidates;
+}
+
+//==============================================================================
+auto TaskPlanner::Options::adaptive_segmentation(bool value) -> Options&
+{
+  _pimpl->adaptive_segmentation = value;
+  return *this;
+}
+
+//==============================================================================
+bool TaskPlanner::Options::adaptive_segmentation() const
+{
+  return _pimpl->adaptive_segmentation;
+}
+
+//==============================================================================
+class TaskPlanner::Assignment::Implementation
+{
+public:
+
+  rmf_task::ConstRequestPtr request;
+  State state;
+  rmf_traffic::Time deployment_time;
+};
+
+//==============================================================================
+TaskPlanner::Assignment::Assignment(
+  rmf_task::ConstRequestPtr request,
+  State state,
+  rmf_traffic::Time deployment_time)
+: _pimpl(std::make_shared<const Implementation>(
+      Implementation{
+        std::move(request),
+        std::move(state),
+        deployment_time
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+const rmf_task::ConstRequestPtr& TaskPlanner::Assignment::request() const
+{
+  return _pimpl->request;
+}
+
+//==============================================================================
+const State& TaskPlanner::Assignment::finish_state() const
+{
+  return _pimpl->state;
+}
+
+//==============================================================================
+const rmf_traffic::Time TaskPlanner::Assignment::deployment_time() const
+{
+  return _pimpl->deployment_time;
+}
+
+//==============================================================================
+
+namespace {
+
+// ============================================================================
+// A fixed set of threads that share the jobs of each call to run() with the
+// thread that calls it.
+class ExpansionWorkers
+{
+public:
+
+  using Job = std::function<void(std::size_t)>;
+
+  ExpansionWorkers(const std::size_t num_threads)
+  {
+    for (std::size_t i = 1; i < num_threads; ++i)
+      _threads.emplace_back([this]() { _work(); });
+  }
+
+  ~ExpansionWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+
+    for (auto& t : _threads)
+      t.join();
+  }
+
+  std::size_t size() const
+  {
+    return _threads.size() + 1;
+  }
+
+  // Run job(i) for every i in [0, num_jobs) and wait until all are finished
+  void run(const std::size_t num_jobs, const Job& job)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _job = &job;
+      _num_jobs = num_jobs;
+      _next = 0;
+      _busy = _threads.size();
+      _error = nullptr;
+      ++_generation;
+    }
+    _wake.notify_all();
+
+    _drain();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&]() { return _busy == 0; });
+    _job = nullptr;
+
+    if (_error)
+      std::rethrow_exception(_error);
+  }
+
+private:
+
+  void _drain()
+  {
+    std::size_t i;
+    while ((i = _next++) < _num_jobs)
+    {
+      try
+      {
+        (*_job)(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error)
+          _error = std::current_exception();
+      }
+    }
+  }
+
+  void _work()
+  {
+    std::size_t generation = 0;
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [&]() { return _stop || _generation != generation; });
+        if (_stop)
+          return;
+
+        generation = _generation;
+      }
+
+      _drain();
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_busy;
+      }
+      _done.notify_one();
+    }
+  }
+
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _done;
+  const Job* _job = nullptr;
+  std::size_t _num_jobs = 0;
+  std::atomic_size_t _next = 0;
+  std::size_t _busy = 0;
+  std::size_t _generation = 0;
+  bool _stop = false;
+  std::exception_ptr _error;
+};
+
+// ============================================================================
+// Keeps the ExpansionWorkers of finished searches so that later searches can
+// use their threads instead of starting new ones. Each set of workers is lent
+// to one search at a time. It is shared by copies of a planner, so it is safe
+// to use from several threads at once.
+class WorkerPool : public std::enable_shared_from_this<WorkerPool>
+{
+public:
+
+  using Lease = std::unique_ptr<
+    ExpansionWorkers, std::function<void(ExpansionWorkers*)>>;
+
+  // The pool keeps at most this many idle threads between searches
+  WorkerPool(const std::size_t max_idle_threads)
+  : _max_idle_threads(max_idle_threads)
+  {
+    // Do nothing
+  }
+
+  // Get workers with this many threads, counting the thread that calls run()
+  Lease lease(const std::size_t num_threads)
+  {
+    std::unique_ptr<ExpansionWorkers> workers;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto& idle = _idle[num_threads];
+      if (!idle.empty())
+      {
+        workers = std::move(idle.back());
+        idle.pop_back();
+        _idle_threads -= num_threads - 1;
+      }
+    }
+
+    if (!workers)
+      workers = std::make_unique<ExpansionWorkers>(num_threads);
+
+    return Lease(
+      workers.release(),
+      [pool = shared_from_this()](ExpansionWorkers* returned)
+      {
+        pool->_give_back(std::unique_ptr<ExpansionWorkers>(returned));
+      });
+  }
+
+private:
+
+  void _give_back(std::unique_ptr<ExpansionWorkers> workers)
+  {
+    const std::size_t threads = workers->size() - 1;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_idle_threads + threads <= _max_idle_threads)
+      {
+        _idle_threads += threads;
+        _idle[workers->size()].push_back(std::move(workers));
+        return;
+      }
+    }
+
+    // The threads of workers that are not kept get joined out here, so that
+    // the pool is not locked while they stop
+  }
+
+  std::size_t _max_idle_threads;
+  std::size_t _idle_threads = 0;
+  std::mutex _mutex;
+  std::unordered_map<std::size_t,
+    std::vector<std::unique_ptr<ExpansionWorkers>>> _idle;
+};
+
+// ============================================================================
+// Keeps the initial buffers of the arenas of finished plans. The next arena
+// starts with a buffer as large as everything the last arena used, up to the
+// capacity, so a planner that keeps planning similar problems stops going to
+// the heap for its nodes. It is safe to use from several threads at once.
+class ArenaPool
+{
+public:
+
+  using Buffer = std::vector<std::byte>;
+
+  // A buffer that is lent to one plan, along with the upstream resource that
+  // its arena should use once the buffer runs out. The buffer is given back
+  // when the lease is destroyed, so the lease must outlive the arena.
+  class Lease
+  {
+  public:
+
+    Lease(ArenaPool& pool)
+    : _pool(pool),
+      _buffer(pool._take())
+    {
+      // Do nothing
+    }
+
+    ~Lease()
+    {
+      const std::size_t used = _buffer.size() + _allocated;
+      _pool._give_back(std::move(_buffer), used);
+    }
+
+    void make_arena(std::optional<std::pmr::monotonic_buffer_resource>& arena)
+    {
+      if (_buffer.empty())
+        arena.emplace(&_upstream);
+      else
+        arena.emplace(_buffer.data(), _buffer.size(), &_upstream);
+    }
+
+  private:
+    ArenaPool& _pool;
+    Buffer _buffer;
+    // Counts how many bytes the arena had to take from the heap
+    std::atomic_size_t _allocated = 0;
+    CountingResource _upstream{std::pmr::new_delete_resource(), _allocated};
+  };
+
+  ArenaPool(const std::size_t capacity)
+  : _capacity(capacity)
+  {
+    // Do nothing
+  }
+
+private:
+
+  Buffer _take()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::size_t size = std::min(_last_used, _capacity);
+    if (_idle.empty())
+      return Buffer(size);
+
+    auto buffer = std::move(_idle.back());
+    _idle.pop_back();
+    if (buffer.size() < size)
+      buffer.resize(size);
+
+    return buffer;
+  }
+
+  void _give_back(Buffer buffer, const std::size_t used)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _last_used = used;
+    if (_capacity > 0 && _idle.size() < max_idle_buffers)
+      _idle.push_back(std::move(buffer));
+  }
+
+  static constexpr std::size_t max_idle_buffers = 4;
+  std::size_t _capacity;
+  std::size_t _last_used = 0;
+  std::mutex _mutex;
+  std::vector<Buffer> _idle;
+};
+
+// ============================================================================
+// The best complete node that has been found so far by any of the searches
+// that are running concurrently for the same segment.
+class Incumbent
+{
+public:
+
+  // An ordered incumbent breaks ties between solutions of equal cost with
+  // precedes(), so the solution that it ends up with does not depend on the
+  // order that they were offered in.
+  Incumbent(bool ordered = false)
+  : _ordered(ordered)
+  {
+    // Do nothing
+  }
+
+  void offer(ConstNodePtr node)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_node && !(node->cost_estimate < _node->cost_estimate))
+    {
+      const bool tie = _ordered
+        && node->cost_estimate == _node->cost_estimate
+        && precedes(*node, *_node);
+      if (!tie)
+        return;
+    }
+
+    _cost = node->cost_estimate;
+    _node = std::move(node);
+  }
+
+  ConstNodePtr node() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _node;
+  }
+
+  // Nodes that cost more than this cannot lead to a better solution
+  double cost() const
+  {
+    return _cost.load();
+  }
+
+  // Compare the internal IDs of the tasks of each agent in turn, starting
+  // from the agent with the lowest index
+  static bool precedes(const Node& a, const Node& b)
+  {
+    const auto less = [](
+      const Node::AssignmentWrapper& x,
+      const Node::AssignmentWrapper& y)
+      {
+        return x.internal_id < y.internal_id;
+      };
+
+    for (std::size_t i = 0; i < a.assigned_tasks.size(); ++i)
+    {
+      const auto& x = *a.assigned_tasks[i];
+      const auto& y = *b.assigned_tasks[i];
+      if (std::lexicographical_compare(
+          x.begin(), x.end(), y.begin(), y.end(), less))
+        return true;
+
+      if (std::lexicographical_compare(
+          y.begin(), y.end(), x.begin(), x.end(), less))
+        return false;
+    }
+
+    return false;
+  }
+
+private:
+  bool _ordered;
+  mutable std::mutex _mutex;
+  ConstNodePtr _node;
+  std::atomic<double> _cost = std::numeric_limits<double>::infinity();
+};
+
+// ============================================================================
+// The wall-clock deadline of one plan() call. The clock is only read once every
+// few checks and the deadline stays expired once it has passed, so it is cheap
+// enough to check in every loop. It may be checked from several threads.
+class Deadline
+{
+public:
+
+  Deadline(
+    std::optional<rmf_traffic::Duration> budget,
+    std::shared_ptr<const std::atomic_bool> cancelled = nullptr)
+  : _cancelled(std::move(cancelled))
+  {
+    if (budget.has_value())
+      _time = std::chrono::steady_clock::now() + *budget;
+  }
+
+  bool expired()
+  {
+    // A cancelled plan stops the same way as one that is out of time
+    if (_cancelled && _cancelled->load(std::memory_order_relaxed))
+      return true;
+
+    if (!_time.has_value())
+      return false;
+
+    if (_expired.load(std::memory_order_relaxed))
+      return true;
+
+    if (_checks.fetch_add(1, std::memory_order_relaxed) % check_interval != 0)
+      return false;
+
+    if (std::chrono::steady_clock::now() < *_time)
+      return false;
+
+    _expired.store(true, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  static constexpr std::size_t check_interval = 16;
+  std::shared_ptr<const std::atomic_bool> _cancelled;
+  std::optional<rmf_traffic::Time> _time;
+  std::atomic<std::size_t> _checks = 0;
+  std::atomic<bool> _expired = false;
+};
+
+// ============================================================================
+// The pool of threads that runs the plans of TaskPlanner::plan_async()
+struct AsyncWorkers
+{
+  std::mutex mutex;
+  ExecutorPtr executor;
+
+  ExecutorPtr get()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!executor)
+      executor = Executor::make_thread_pool();
+
+    return executor;
+  }
+};
+
+// ============================================================================
+// Settings for one run of the A* search over a planning segment
+struct SearchOptions
+{
+  std::function<bool()> interrupter;
+  std::size_t num_threads = 1;
+  bool anytime = false;
+  double heuristic_weight = 1.0;
+  std::size_t max_open_nodes = 0;
+  TaskPlanner::FilterType filter_type = TaskPlanner::FilterType::Hash;
+  TaskPlanner::TieBreak tie_break = TaskPlanner::TieBreak::None;
+  std::optional<double> partial_expansion;
+  bool branch_and_bound = false;
+  // Tolerance for equivalent agents, if symmetry breaking is enabled
+  std::optional<double> symmetry_tolerance;
+  Incumbent* incumbent = nullptr;
+  bool deterministic = false;
+  // When given, solve() collects this many of the cheapest complete nodes in
+  // here instead of stopping at the first one
+  std::vector<ConstNodePtr>* candidates = nullptr;
+  std::size_t num_candidates = 0;
+};
+
+// ============================================================================
+// What the approximate search of Options::approximate_candidates() plans
+// with. It is only made once it is first needed, and then it is shared by the
+// copies of the planner.
+struct ApproximateStage
+{
+  std::once_flag once;
+  std::optional<TaskPlanner::Configuration> config;
+  ConstTravelEstimatorPtr travel_estimator;
+  std::shared_ptr<SharedModelCache> shared_models;
+  std::shared_ptr<const ChargerPool> charger_pool;
+  Task::ConstModelPtr charging_model;
+};
+
+// ============================================================================
+// Unless a larger heuristic weight is given, the anytime search starts with
+// its heuristic inflated by this weight and lowers the weight by the step each
+// time it finds a better solution, until it reaches a weight of 1 and is back
+// to a plain A* search.
+const double anytime_initial_weight = 2.0;
+const double anytime_weight_step = 0.5;
+
+// ============================================================================
+ConstTravelEstimatorPtr make_travel_estimator(
+  const TaskPlanner::Configuration& configuration)
+{
+  if (configuration.travel_estimator())
+    return configuration.travel_estimator();
+
+  return std::make_shared<TravelEstimator>(configuration.parameters());
+}
+
+// ============================================================================
+std::shared_ptr<const ChargerPool> make_charger_pool(
+  const TaskPlanner::Configuration& configuration,
+  const ConstTravelEstimatorPtr& travel_estimator)
+{
+  if (configuration.charger_pool().empty())
+    return nullptr;
+
+  return std::make_shared<ChargerPool>(
+    configuration.charger_pool(), travel_estimator,
+    configuration.parameters().planner()->get_configuration().graph()
+    .num_waypoints());
+}
+
+// ============================================================================
+// The model of every implicit charging task. Its estimates do not depend on
+// the request or the start time, so one model serves the whole search.
+Task::ConstModelPtr make_charging_model(
+  const Parameters& parameters,
+  const std::shared_ptr<const ChargerPool>& charger_pool)
+{
+  auto model =
+    rmf_task::requests::ChargeBattery::Description::make()->make_model(
+    rmf_traffic::Time(), parameters);
+
+  if (!charger_pool)
+    return model;
+
+  return std::make_shared<PooledChargingModel>(std::move(model), charger_pool);
+}
+
+// ============================================================================
+std::size_t resolve_thread_count(const std::size_t requested)
+{
+  if (requested > 0)
+    return requested;
+
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// ============================================================================
+// For each agent, the nearest agent with a lower index whose state is
+// interchangeable with it, or the agent itself if there is none
+std::vector<std::size_t> find_equivalent_agents(
+  const std::vector<State>& states,
+  const double soc_tolerance)
+{
+  const auto equivalent = [&](const State& a, const State& b)
+    {
+      if (a.waypoint() != b.waypoint()
+        || a.orientation() != b.orientation()
+        || a.time() != b.time()
+        || a.dedicated_charging_waypoint() != b.dedicated_charging_waypoint())
+        return false;
+
+      const auto soc_a = a.battery_soc();
+      const auto soc_b = b.battery_soc();
+      if (soc_a.has_value() != soc_b.has_value())
+        return false;
+
+      return !soc_a || std::abs(*soc_a - *soc_b) <= soc_tolerance;
+    };
+
+  std::vector<std::size_t> previous(states.size());
+  for (std::size_t j = 0; j < states.size(); ++j)
+  {
+    previous[j] = j;
+    for (std::size_t i = j; i > 0; --i)
+    {
+      if (equivalent(states[i-1], states[j]))
+      {
+        previous[j] = i-1;
+        break;
+      }
+    }
+  }
+
+  return previous;
+}
+
+// ============================================================================
+// An idle agent does not need to be expanded while an equivalent agent with a
+// lower index is also idle, because both would produce equivalent children
+bool is_redundant(
+  const Node& node,
+  const std::size_t agent,
+  const std::vector<std::size_t>* equivalent_agents)
+{
+  if (!equivalent_agents)
+    return false;
+
+  const std::size_t other = (*equivalent_agents)[agent];
+  return other != agent
+    && node.assigned_tasks[agent]->empty()
+    && node.assigned_tasks[other]->empty();
+}
+
+// ============================================================================
+// The largest number of related tasks that the refinement removes from a
+// solution at once and then reinserts
+const std::size_t refinement_max_removed = 5;
+
+// ============================================================================
+// How close to the latest time of a segment a task must be able to begin to be
+// planned in that segment, unless the segmentation is adaptive
+const rmf_traffic::Duration default_segmentation_threshold =
   rmf_traffic::time::from_seconds(1.0);
 
-} // anonymous namespace
+} // anonymous namespace
+
+// ============================================================================
+class TaskPlanner::Implementation
+{
+public:
+  Configuration config;
+  Options default_options;
+  ConstTravelEstimatorPtr travel_estimator;
+  std::string planner_id;
+  bool check_priority = false;
+  ConstCostCalculatorPtr cost_calculator = nullptr;
+
+  // The memory resource that search nodes are allocated from during the
+  // current call to complete_solve()
+  std::pmr::memory_resource* memory = std::pmr::new_delete_resource();
+
+  // The memory resource that candidate tables are allocated from
+  std::pmr::memory_resource* candidate_memory =
+    std::pmr::new_delete_resource();
+
+  // The suboptimality bound of the assignments from the latest plan
+  std::optional<double> suboptimality_bound = std::nullopt;
+
+  // The segmentation threshold of the segment that is being planned
+  rmf_traffic::Duration segmentation_threshold =
+    default_segmentation_threshold;
+
+  // The chargers that the agents share, if the configuration has any
+  std::shared_ptr<const ChargerPool> charger_pool =
+    make_charger_pool(config, travel_estimator);
+
+  Task::ConstModelPtr charging_model =
+    make_charging_model(config.parameters(), charger_pool);
+
+  // The models of recurring requests, which are kept between plan() calls
+  std::shared_ptr<SharedModelCache> shared_models =
+    std::make_shared<SharedModelCache>(config.model_cache_capacity());
+
+  // The task models built during the current plan() call. Copies of this
+  // Implementation that plan parts of the same problem share the cache.
+  std::shared_ptr<ModelCache> models =
+    std::make_shared<ModelCache>(shared_models);
+
+  // The results of recent plan() calls
+  std::shared_ptr<PlanCache> plan_cache = std::make_shared<PlanCache>(
+    config.plan_cache_capacity(), config.plan_cache_time_resolution());
+
+  // The counters of the current plan() call, which are also shared by copies
+  // of this Implementation, and the statistics of that call
+  std::shared_ptr<PlanCounters> counters = std::make_shared<PlanCounters>();
+  TaskPlanner::Statistics statistics = {};
+
+  // The results of the latest plan() call to finish. Every call plans with a
+  // copy of this Implementation of its own and then publishes its results
+  // here, so the same planner can plan on several threads at once.
+  struct LatestPlan
+  {
+    std::mutex mutex;
+    TaskPlanner::Statistics statistics = {};
+    std::optional<double> suboptimality_bound = std::nullopt;
+  };
+  std::shared_ptr<LatestPlan> latest = std::make_shared<LatestPlan>();
+
+  // How much battery the agents of the current plan() call need to get back
+  // to their chargers, shared in the same way
+  std::shared_ptr<const ChargerReachability> reachability = nullptr;
+
+  // The time budget of the current plan() call, shared in the same way
+  std::shared_ptr<Deadline> deadline = std::make_shared<Deadline>(std::nullopt);
+
+  // Set on the copies that run plan_async(), so that their plans can be
+  // cancelled
+  std::shared_ptr<const std::atomic_bool> cancelled = nullptr;
+
+  // The threads and arena buffers that are recycled between searches, which
+  // are shared by copies of this planner
+  std::shared_ptr<WorkerPool> worker_pool =
+    std::make_shared<WorkerPool>(config.worker_pool_size());
+  std::shared_ptr<ArenaPool> arena_pool =
+    std::make_shared<ArenaPool>(config.arena_pool_capacity());
+
+  // The threads that run plan_async(), which are shared by copies of this
+  // planner. The pool is only made once it is first needed.
+  std::shared_ptr<AsyncWorkers> async_workers =
+    std::make_shared<AsyncWorkers>();
+
+  // The approximate search, shared in the same way
+  std::shared_ptr<ApproximateStage> approximate_stage =
+    std::make_shared<ApproximateStage>();
+
+  static constexpr std::string_view DefaultTaskPlannerName = "task_planner";
+
+  // The description that every charging task of the search shares
+  Task::ConstDescriptionPtr charging_description =
+    rmf_task::requests::ChargeBattery::Description::make();
+
+  // The ID of the charging tasks of the search, until finalize() gives them
+  // an ID of their own
+  static constexpr std::string_view PlaceholderChargingId = "Charge";
+
+  // Most of the charging tasks that the search creates are discarded along
+  // with their nodes, and the search only looks at their bookings and
+  // descriptions, so they share one description and a placeholder ID. Each
+  // one that makes it into a result gets a request of its own in finalize().
+  ConstRequestPtr make_charging_request(
+    rmf_traffic::Time start_time,
+    rmf_traffic::Time time_now) const
+  {
+    return std::make_shared<Request>(
+      std::make_shared<const Task::Booking>(
+        std::string(PlaceholderChargingId),
+        start_time,
+        nullptr,
+        planner_id,
+        time_now,
+        true),
+      charging_description);
+  }
+
+  // Make the request of a charging task for a result
+  ConstRequestPtr make_final_charging_request(
+    rmf_traffic::Time start_time,
+    rmf_traffic::Time time_now) const
+  {
+    return rmf_task::requests::ChargeBattery::make(
+      start_time,
+      planner_id,
+      time_now,
+      nullptr,
+      true);
+  }
+
+  // Get the assignment of a node in the form that goes into a result
+  TaskPlanner::Assignment finalize(const Node::AssignmentWrapper& a) const
+  {
+    if (!a.generated())
+      return a.assignment;
+
+    const auto& booking = *a.assignment.request()->booking();
+    return TaskPlanner::Assignment{
+      make_final_charging_request(
+        booking.earliest_start_time(), booking.request_time().value()),
+      a.assignment.finish_state(),
+      a.assignment.deployment_time()};
+  }
+
+  // Estimate an implicit charging task that starts from the given state.
+  // Requests are only made for the charging tasks that get assigned. A robot
+  // that cannot make it to its charger is ruled out without an estimate.
+  std::optional<EstimatedFinish> estimate_charging(
+    const State& state,
+    const Constraints& constraints) const
+  {
+    if (reachability && !reachability->can_reach(state, constraints))
+      return std::nullopt;
+
+    ++counters->estimate_finish_calls;
+    return FinishEstimator(
+      state, constraints, *travel_estimator)(*charging_model);
+  }
+
+  // With a charger pool, an agent may not charge at a charger that another
+  // agent of the node holds. If the charger of the estimate is held, charging
+  // is estimated at the nearest charger that is free instead, and moved is
+  // set.
+  std::optional<EstimatedFinish> claim_charger(
+    const Node& node,
+    const std::size_t agent,
+    const State& state,
+    std::optional<EstimatedFinish> estimate,
+    bool* moved = nullptr) const
+  {
+    if (!charger_pool || !estimate.has_value() || node.chargers.empty())
+      return estimate;
+
+    const auto charger = estimate->finish_state.dedicated_charging_waypoint();
+    if (!charger.has_value() || !node.charger_held(*charger, agent))
+      return estimate;
+
+    const auto free = charger_pool->nearest_available(
+      state.waypoint().value_or(std::numeric_limits<std::size_t>::max()),
+      [&](const std::size_t c) { return node.charger_held(c, agent); });
+
+    if (!free.has_value())
+      return std::nullopt;
+
+    if (moved)
+      *moved = true;
+
+    State at_free = state;
+    at_free.dedicated_charging_waypoint(*free);
+    ++counters->estimate_finish_calls;
+    return FinishEstimator(
+      at_free, config.constraints(), *travel_estimator)(
+      static_cast<const PooledChargingModel&>(*charging_model).base());
+  }
+
+  void prune_assignments(TaskPlanner::Assignments& assignments)
+  {
+    for (std::size_t a = 0; a < assignments.size(); ++a)
+    {
+      if (assignments[a].empty())
+        continue;
+
+      // Remove charging task at end of assignments if any
+      // TODO(YV): Remove this after fixing the planner
+      if (std::dynamic_pointer_cast<
+          const rmf_task::requests::ChargeBattery::Description>(
+          assignments[a].back().request()->description()))
+        assignments[a].pop_back();
+    }
+  }
+
+  template<typename... Args>
+  std::shared_ptr<Node> make_node(Args&&... args)
+  {
+    return std::allocate_shared<Node>(
+      PlanAllocator<Node>(memory), std::forward<Args>(args)...);
+  }
+
+  // Add an assignment to a node along with the cost that it contributes
+  void push_assignment(
+    Node& node,
+    std::size_t agent,
+    Node::AssignmentWrapper assignment) const
+  {
+    // The charging tasks that the planner adds have no pending task, and the
+    // charging flag of every other assignment comes from its pending task
+    assert(assignment.generated() ? assignment.is_charging :
+      (node.unassigned_tasks.find(assignment.internal_id)
+      != node.unassigned_tasks.end()
+      && node.unassigned_tasks.find(assignment.internal_id)->second
+      .is_charging() == assignment.is_charging));
+
+    assignment.cost = cost_calculator->compute_assignment_cost(assignment);
+    node.push_assignment(agent, std::move(assignment));
+  }
+
+  ConstNodePtr prune_assignments(ConstNodePtr parent)
+  {
+    auto node = make_node(*parent);
+
+    for (std::size_t a = 0; a < node->assigned_tasks.size(); ++a)
+    {
+      const auto& agent = *node->assigned_tasks[a];
+      if (agent.empty())
+        continue;
+
+      if (agent.back().generated())
+        node->pop_assignment(a);
+    }
+
+    return node;
+  }
+
+  void append_finishing_request(
+    const RequestFactory& factory,
+    TaskPlanner::Assignments& complete_assignments,
+    rmf_traffic::Time time_now)
+  {
+    ScopedTimer timer(counters->finishing_time);
+
+    // The factory makes a new request for every agent, but their models
+    // usually only differ by their start time, so the agents share them
+    // through the model cache. Without a model cache they are still shared
+    // within this call.
+    ModelCache finishing_models(
+      config.model_cache_capacity() > 0 ? shared_models :
+      std::make_shared<SharedModelCache>(complete_assignments.size()));
+
+    for (auto& agent : complete_assignments)
+    {
+      // Out of time, so the remaining agents do without a finishing request
+      if (deadline->expired())
+        break;
+
+      if (agent.empty())
+      {
+        continue;
+      }
+
+      const auto& state = agent.back().finish_state();
+      const auto request = factory.make_request(state);
+
+      // TODO(YV) Currently we are unable to recursively call complete_solve()
+      // here as the prune_assignments() function will remove any ChargeBattery
+      // requests at the back of the assignments. But the finishing factory
+      // could be a ChargeBattery request and hence this approach does not work.
+      // When we fix the logic with unnecessary ChargeBattery tasks, we should
+      // revist making this a recursive call.
+      auto model = finishing_models.get(
+        request, state.time().value(), config.parameters(), *travel_estimator);
+      ++counters->estimate_finish_calls;
+      auto estimate = model->estimate_finish(
+        state, config.constraints(), *travel_estimator);
+      if (estimate.has_value())
+      {
+        agent.push_back(
+          Assignment
+          {
+            request,
+            estimate.value().finish_state(),
+            estimate.value().wait_until()
+          });
+      }
+      else
+      {
+        // Insufficient battery to perform the finishing request. We check if
+        // adding a ChargeBattery task before will allow for it to be performed
+        const auto charge_battery_estimate =
+          estimate_charging(state, config.constraints());
+        if (charge_battery_estimate.has_value())
+        {
+          model = finishing_models.get(
+            request,
+            charge_battery_estimate->finish_state.time().value(),
+            config.parameters(),
+            *travel_estimator);
+          ++counters->estimate_finish_calls;
+          estimate = model->estimate_finish(
+            charge_battery_estimate->finish_state,
+            config.constraints(),
+            *travel_estimator);
+          if (estimate.has_value())
+          {
+            // Append the ChargeBattery and finishing request
+            agent.push_back(
+              Assignment{
+                make_final_charging_request(state.time().value(), time_now),
+                charge_battery_estimate->finish_state,
+                charge_battery_estimate->wait_until
+              });
+            agent.push_back(
+              Assignment
+              {
+                request,
+                estimate.value().finish_state(),
+                estimate.value().wait_until()
+              });
+          }
+        }
+      }
+    }
+  }
+
+  // Split the agents into clusters that share at least one request that they
+  // are able to perform, then plan each cluster concurrently. Returns nullopt
+  // if everything belongs to a single cluster.
+  std::optional<Result> decomposed_solve(
+    rmf_traffic::Time time_now,
+    const std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    const Options& options,
+    const TaskPlanner::Assignments* previous)
+  {
+    memory = std::pmr::new_delete_resource();
+    candidate_memory = memory;
+    cost_calculator = config.cost_calculator() ? config.cost_calculator() :
+      rmf_task::BinaryPriorityScheme::make_cost_calculator();
+
+    TaskPlannerError error;
+    const auto root = make_initial_node(
+      initial_states, requests, time_now, error,
+      resolve_thread_count(options.initialization_threads()));
+    if (!root)
+      return Result{error};
+
+    // Union the agents that can perform the same request
+    const std::size_t num_agents = initial_states.size();
+    std::vector<std::size_t> parent(num_agents);
+    for (std::size_t a = 0; a < num_agents; ++a)
+      parent[a] = a;
+
+    const auto find = [&](std::size_t a)
+      {
+        while (parent[a] != a)
+        {
+          parent[a] = parent[parent[a]];
+          a = parent[a];
+        }
+        return a;
+      };
+
+    std::vector<std::size_t> request_agent(requests.size());
+    std::size_t r = 0;
+    for (const auto& u : root->unassigned_tasks)
+    {
+      std::optional<std::size_t> first;
+      for (std::size_t a = 0; a < num_agents; ++a)
+      {
+        if (!u.second.candidates->find(a))
+          continue;
+
+        if (!first.has_value())
+          first = a;
+        else
+          parent[find(a)] = find(*first);
+      }
+
+      assert(first.has_value());
+      request_agent[r++] = *first;
+    }
+
+    // Requests that depend on each other must be planned together. Internal
+    // IDs are handed out in the order of the requests, starting from 1.
+    for (const auto& u : root->unassigned_tasks)
+    {
+      for (const auto d : u.second.dependencies())
+        parent[find(request_agent[u.first - 1])] = find(request_agent[d - 1]);
+    }
+
+    // Gather the agents and requests of each cluster, in their original order
+    std::vector<std::size_t> cluster_of(num_agents, num_agents);
+    std::vector<std::vector<std::size_t>> cluster_agents;
+    std::vector<std::vector<ConstRequestPtr>> cluster_requests;
+    const auto cluster_index = [&](std::size_t a)
+      {
+        const std::size_t root_agent = find(a);
+        if (cluster_of[root_agent] == num_agents)
+        {
+          cluster_of[root_agent] = cluster_agents.size();
+          cluster_agents.emplace_back();
+          cluster_requests.emplace_back();
+        }
+        return cluster_of[root_agent];
+      };
+
+    for (std::size_t i = 0; i < requests.size(); ++i)
+      cluster_requests[cluster_index(request_agent[i])].push_back(requests[i]);
+
+    if (cluster_agents.size() <= 1)
+      return std::nullopt;
+
+    for (std::size_t a = 0; a < num_agents; ++a)
+    {
+      const std::size_t root_agent = find(a);
+      if (cluster_of[root_agent] != num_agents)
+        cluster_agents[cluster_of[root_agent]].push_back(a);
+    }
+
+    const std::size_t num_clusters = cluster_agents.size();
+    auto cluster_options = options;
+    cluster_options.decompose(false);
+    cluster_options.segment_callback(nullptr);
+
+    std::vector<Implementation> planners(num_clusters, *this);
+    std::vector<std::optional<Result>> results(num_clusters);
+    const auto solve_cluster = [&](const std::size_t c)
+      {
+        std::vector<State> states;
+        TaskPlanner::Assignments cluster_previous;
+        for (const auto a : cluster_agents[c])
+        {
+          states.push_back(initial_states[a]);
+          if (previous && a < previous->size())
+            cluster_previous.push_back((*previous)[a]);
+        }
+
+        const bool has_previous =
+          previous && cluster_previous.size() == states.size();
+
+        results[c] = planners[c].complete_solve(
+          time_now, states, cluster_requests[c], cluster_options,
+          has_previous ? &cluster_previous : nullptr);
+      };
+
+    const auto workers = worker_pool->lease(
+      std::min(num_clusters, resolve_thread_count(0)));
+    workers->run(num_clusters, solve_cluster);
+
+    // Merge the clusters back into the original order of the agents
+    TaskPlanner::Assignments assignments(num_agents);
+    suboptimality_bound = 1.0;
+    for (std::size_t c = 0; c < num_clusters; ++c)
+    {
+      auto& result = *results[c];
+      if (const auto* e = std::get_if<TaskPlannerError>(&result))
+      {
+        suboptimality_bound = std::nullopt;
+        return Result{*e};
+      }
+
+      auto& cluster = std::get<TaskPlanner::Assignments>(result);
+      if (cluster.size() != cluster_agents[c].size())
+      {
+        // The search of this cluster was interrupted
+        suboptimality_bound = std::nullopt;
+        return Result{};
+      }
+
+      for (std::size_t k = 0; k < cluster.size(); ++k)
+        assignments[cluster_agents[c][k]] = std::move(cluster[k]);
+
+      // The total cost is within the largest bound of any cluster
+      const auto& bound = planners[c].suboptimality_bound;
+      if (!bound.has_value())
+        suboptimality_bound = std::nullopt;
+      else if (suboptimality_bound.has_value())
+        suboptimality_bound = std::max(*suboptimality_bound, *bound);
+    }
+
+    if (options.segment_callback())
+      options.segment_callback()(assignments);
+
+    return Result{std::move(assignments)};
+  }
+
+  // The entry point of every call to plan() and replan()
+  // Plan with a copy of this Implementation, which shares the configuration,
+  // the travel estimator, the caches and the pools with this one but keeps
+  // the state of the call to itself
+  Result plan_in_context(
+    rmf_traffic::Time time_now,
+    std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    const Options& options,
+    const TaskPlanner::Assignments* previous = nullptr) const
+  {
+    Implementation context(*this);
+    auto result =
+      context.plan(time_now, initial_states, requests, options, previous);
+
+    std::lock_guard<std::mutex> lock(latest->mutex);
+    latest->statistics = context.statistics;
+    latest->suboptimality_bound = context.suboptimality_bound;
+    return result;
+  }
+
+  Result plan(
+    rmf_traffic::Time time_now,
+    std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    const Options& options,
+    const TaskPlanner::Assignments* previous = nullptr)
+  {
+    RMF_TASK_TRACE_SPAN("TaskPlanner::plan");
+    Metrics::add(Metrics::Counter::plans);
+    const Metrics::ScopedLatency latency(Metrics::Latency::plan);
+    if (!options.capture_path().empty())
+    {
+      std::ofstream capture(options.capture_path());
+      if (capture)
+      {
+        write_plan_capture(
+          capture, time_now, config, options, initial_states, requests);
+      }
+    }
+
+    // Replans are never cached since their search is seeded by the previous
+    // assignments
+    std::optional<PlanCache::Key> cache_key;
+    if (!previous)
+    {
+      cache_key = plan_cache->make_key(
+        time_now, initial_states, requests, options, *travel_estimator);
+    }
+
+    if (cache_key.has_value())
+    {
+      if (const auto entry = plan_cache->get(*cache_key, requests))
+      {
+        statistics = {};
+        statistics.plan_cache_hit = true;
+        suboptimality_bound = entry->suboptimality_bound;
+        return entry->result;
+      }
+    }
+
+    deadline = std::make_shared<Deadline>(options.time_budget(), cancelled);
+    models = std::make_shared<ModelCache>(shared_models);
+    counters = std::make_shared<PlanCounters>();
+
+    // The reachability of the dedicated chargers says nothing about the
+    // chargers of a pool
+    reachability = charger_pool ? nullptr :
+      std::make_shared<ChargerReachability>(
+      initial_states, travel_estimator,
+      config.parameters().planner()->get_configuration().graph()
+      .num_waypoints());
+    const std::size_t initial_hits = travel_estimator->cache_hits();
+    const std::size_t initial_misses = travel_estimator->cache_misses();
+    const std::size_t initial_model_hits = shared_models->hits();
+    const std::size_t initial_model_misses = shared_models->misses();
+
+    auto result = complete_solve(
+      time_now, initial_states, requests, options, previous);
+
+    statistics.nodes_expanded = counters->nodes_expanded;
+    statistics.nodes_generated = counters->nodes_generated;
+    statistics.filter_rejections = counters->filter_rejections;
+    statistics.peak_open_nodes = counters->peak_open_nodes;
+    statistics.segments = counters->segments;
+    statistics.deferred_segments = counters->deferred_segments;
+    statistics.estimate_finish_calls = counters->estimate_finish_calls;
+    statistics.grouped_requests = counters->grouped_requests;
+    statistics.carried_candidates = counters->carried_candidates;
+    statistics.travel_estimator_hits =
+      travel_estimator->cache_hits() - initial_hits;
+    statistics.travel_estimator_misses =
+      travel_estimator->cache_misses() - initial_misses;
+    statistics.model_cache_hits = shared_models->hits() - initial_model_hits;
+    statistics.model_cache_misses =
+      shared_models->misses() - initial_model_misses;
+    statistics.initialization_time =
+      rmf_traffic::Duration(counters->initialization_time);
+    statistics.search_time = rmf_traffic::Duration(counters->search_time);
+    statistics.finishing_time =
+      rmf_traffic::Duration(counters->finishing_time);
+    statistics.node_bytes = counters->node_bytes;
+    statistics.candidate_bytes = counters->candidate_bytes;
+    statistics.filter_bytes = counters->peak_filter_bytes;
+    statistics.open_list_bytes = counters->peak_open_list_bytes;
+    statistics.bytes_per_node = counters->nodes_generated > 0 ?
+      static_cast<double>(statistics.node_bytes + statistics.candidate_bytes)
+      / static_cast<double>(counters->nodes_generated) : 0.0;
+    statistics.plan_cache_hit = false;
+
+    Metrics::add(
+      Metrics::Counter::plan_nodes_expanded, statistics.nodes_expanded);
+    Metrics::add(
+      Metrics::Counter::plan_nodes_generated, statistics.nodes_generated);
+
+    if (cache_key.has_value() && !(cancelled && cancelled->load()))
+    {
+      plan_cache->insert(
+        std::move(*cache_key), PlanCache::Entry{result, suboptimality_bound},
+        requests);
+    }
+
+    return result;
+  }
+
+  Result complete_solve(
+    rmf_traffic::Time time_now,
+    std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    const Options& options,
+    const TaskPlanner::Assignments* previous = nullptr)
+  {
+    if (options.decompose() && !requests.empty())
+    {
+      if (auto result = decomposed_solve(
+          time_now, initial_states, requests, options, previous))
+        return std::move(*result);
+    }
+
+    const auto& finishing_request = options.finishing_request();
+    const bool portfolio = options.portfolio();
+    const bool auction = options.auction() && !portfolio;
+    const bool greedy = (options.greedy() || auction) && !portfolio;
+    const auto planning_horizon = options.planning_horizon();
+    const std::size_t num_candidates = options.approximate_candidates();
+    const std::size_t num_threads =
+      greedy ? 1 : resolve_thread_count(options.expansion_threads());
+    const std::size_t initialization_threads =
+      resolve_thread_count(options.initialization_threads());
+    const auto refinement_time = options.refinement_time();
+    const std::size_t refinement_threads = refinement_time ?
+      resolve_thread_count(options.refinement_threads()) : 1;
+
+    // When no other thread takes part in the search, the nodes can share
+    // their values without atomic reference counting
+    const bool single_threaded = num_threads <= 1
+      && initialization_threads <= 1 && refinement_threads <= 1 && !portfolio;
+    std::optional<SingleThreadedScope> single_threaded_scope;
+    if (single_threaded)
+      single_threaded_scope.emplace();
+
+    // The arena must be declared before any node so that it outlives them all,
+    // and the lease of its buffer must outlive the arena
+    std::optional<ArenaPool::Lease> arena_lease;
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+    std::optional<std::pmr::synchronized_pool_resource> shared_arena;
+    if (options.arena_allocation())
+    {
+      arena_lease.emplace(*arena_pool);
+      arena_lease->make_arena(arena);
+      memory = &arena.value();
+
+      // The monotonic arena is not thread-safe on its own
+      if (!single_threaded)
+      {
+        shared_arena.emplace(&arena.value());
+        memory = &shared_arena.value();
+      }
+    }
+    else
+    {
+      memory = std::pmr::new_delete_resource();
+    }
+
+    // Count how much the nodes and the candidate tables draw from the memory
+    // resource. These must also outlive every node.
+    CountingResource node_memory(memory, counters->node_bytes);
+    CountingResource counted_candidate_memory(
+      memory, counters->candidate_bytes);
+    memory = &node_memory;
+    candidate_memory = &counted_candidate_memory;
+
+    cost_calculator = config.cost_calculator() ? config.cost_calculator() :
+      rmf_task::BinaryPriorityScheme::make_cost_calculator();
+
+    // Also check if a high priority task exists among the requests.
+    // If so the cost function for a node will be modified accordingly.
+    for (const auto& request : requests)
+    {
+      if (request->booking()->priority())
+      {
+        check_priority = true;
+        break;
+      }
+    }
+
+    SearchOptions search;
+    search.interrupter = options.interrupter();
+    search.num_threads = num_threads;
+    search.anytime = options.anytime();
+    search.heuristic_weight = options.heuristic_weight();
+    search.max_open_nodes = options.max_open_nodes();
+    search.filter_type = options.filter_type();
+    search.tie_break = options.tie_break();
+    search.partial_expansion = options.partial_expansion();
+    search.branch_and_bound = options.branch_and_bound();
+    search.deterministic = options.deterministic();
+    if (options.symmetry_breaking())
+      search.symmetry_tolerance = options.symmetry_tolerance();
+
+    suboptimality_bound = std::nullopt;
+    TaskPlannerError error;
+    auto node = make_initial_node(
+      initial_states, requests, time_now, error, initialization_threads);
+    if (!node)
+      return error;
+
+    // The greedy search does not give any guarantee on its solution
+    if (!greedy)
+      suboptimality_bound = 1.0;
+
+    TaskPlanner::Assignments complete_assignments;
+    complete_assignments.resize(node->assigned_tasks.size());
+
+    // Later segments need to know when the bookings that their requests
+    // depend on were finished by earlier segments
+    const bool has_dependencies = std::any_of(requests.begin(), requests.end(),
+        [](const ConstRequestPtr& request)
+        {
+          return !request->booking()->dependencies().empty();
+        });
+    ReleaseTimes released;
+
+    while (node)
+    {
+      ++counters->segments;
+      segmentation_threshold = options.adaptive_segmentation() ?
+        adaptive_segmentation_threshold(*node) :
+        default_segmentation_threshold;
+      std::optional<double> lower_bound;
+
+      // A segment whose requests all start beyond the planning horizon is
+      // only given a greedy placeholder
+      const bool beyond_horizon = planning_horizon.has_value()
+        && earliest_start_time(*node) > time_now + *planning_horizon;
+      if (beyond_horizon)
+        ++counters->deferred_segments;
+      {
+        ScopedTimer timer(counters->search_time);
+
+        // Seed the search of this segment with what remains of a previous
+        // plan
+        ConstNodePtr seed = previous ?
+          warm_start(node, *previous, initial_states, time_now) : nullptr;
+        std::optional<Incumbent> seeded;
+        SearchOptions segment_search = search;
+        if (seed)
+        {
+          seeded.emplace(search.deterministic).offer(seed);
+          segment_search.incumbent = &seeded.value();
+        }
+
+        const ConstNodePtr root = node;
+        if (beyond_horizon)
+        {
+          node = greedy_solve(node, initial_states, time_now);
+          if (seed && (!node || seed->cost_estimate < node->cost_estimate))
+            node = seed;
+        }
+        else if (portfolio)
+          node = portfolio_solve(node, initial_states,
+              requests.size(), time_now, segment_search, lower_bound);
+        else if (greedy)
+        {
+          if (auction)
+            node = auction_solve(node, initial_states, time_now);
+          else if (options.regret_insertion() >= 2)
+          {
+            node = regret_solve(
+              node, initial_states, time_now, options.regret_insertion());
+          }
+          else
+            node = greedy_solve(node, initial_states, time_now);
+
+          if (seed && (!node || seed->cost_estimate < node->cost_estimate))
+            node = seed;
+        }
+        else if (num_candidates > 0)
+        {
+          node = approximate_solve(node, initial_states, requests.size(),
+              time_now, segment_search, num_candidates, &released);
+        }
+        else
+          node = solve(node, initial_states,
+              requests.size(), time_now, segment_search, lower_bound);
+
+        // Spend the refinement budget on improving the solution of this
+        // segment
+        if (node && refinement_time && !beyond_horizon)
+        {
+          node = refine(root, std::move(node), initial_states,
+              requests.size(), time_now, search, *refinement_time,
+              refinement_threads);
+        }
+      }
+
+      if (!node)
+      {
+        suboptimality_bound = std::nullopt;
+        return {};
+      }
+
+      if (beyond_horizon)
+        suboptimality_bound = std::nullopt;
+      else if (!greedy)
+        update_suboptimality_bound(*node, lower_bound);
+
+      // The candidates of the agents that were not assigned anything in this
+      // segment, not even a charging task that gets pruned, still apply to
+      // the next one
+      CarriedTasks carried;
+      carried.changed.resize(node->assigned_tasks.size());
+      for (std::size_t i = 0; i < carried.changed.size(); ++i)
+        carried.changed[i] = !node->assigned_tasks[i]->empty();
+
+      // Here we prune assignments to remove any charging tasks at the back of
+      // the assignment list
+      node = prune_assignments(node);
+      assert(complete_assignments.size() == node->assigned_tasks.size());
+      TaskPlanner::Assignments segment(node->assigned_tasks.size());
+      for (std::size_t i = 0; i < complete_assignments.size(); ++i)
+      {
+        auto& all_assignments = complete_assignments[i];
+        const auto& new_assignments = *node->assigned_tasks[i];
+        for (const auto& a : new_assignments)
+        {
+          segment[i].push_back(finalize(a));
+          all_assignments.push_back(segment[i].back());
+          if (has_dependencies && !a.generated())
+          {
+            released[a.assignment.request()->booking()->id()] =
+              a.assignment.finish_state().time().value();
+          }
+        }
+      }
+
+      // Let the caller act on this segment while the next one is planned
+      if (const auto& segment_callback = options.segment_callback())
+        segment_callback(segment);
+
+      if (node->unassigned_tasks.empty())
+      {
+        prune_assignments(complete_assignments);
+        if (finishing_request != nullptr)
+        {
+          append_finishing_request(
+            *finishing_request,
+            complete_assignments,
+            time_now);
+        }
+
+        return Result{std::move(complete_assignments)};
+      }
+
+      std::vector<ConstRequestPtr> new_tasks;
+      for (const auto& u : node->unassigned_tasks)
+      {
+        new_tasks.push_back(u.second.request());
+        carried.tasks.push_back(&u.second);
+      }
+
+      // The next segment starts from the final state estimates of this one
+      std::vector<State> estimates;
+      estimates.reserve(node->assigned_tasks.size());
+      for (std::size_t i = 0; i < node->assigned_tasks.size(); ++i)
+      {
+        const auto& assignments = *node->assigned_tasks[i];
+        if (assignments.empty())
+          estimates.push_back(initial_states[i]);
+        else
+          estimates.push_back(assignments.back().assignment.finish_state());
+      }
+
+      node = make_initial_node(
+        estimates, new_tasks, time_now, error, initialization_threads,
+        &released, &carried);
+      if (!node)
+      {
+        suboptimality_bound = std::nullopt;
+        return error;
+      }
+      initial_states = std::move(estimates);
+    }
+
+    // If a finishing_request is present, accommodate the request at the end of
+    // the assignments for each agent
+    if (finishing_request != nullptr)
+    {
+      append_finishing_request(
+        *finishing_request,
+        complete_assignments,
+        time_now);
+    }
+
+    return Result{std::move(complete_assignments)};
+  }
+
+  // The median duration of the best candidates of the unassigned tasks of a
+  // node, or the default threshold if that is longer
+  static rmf_traffic::Duration adaptive_segmentation_threshold(const Node& node)
+  {
+    std::vector<rmf_traffic::Duration> durations;
+    for (const auto& u : node.unassigned_tasks)
+    {
+      const auto best = u.second.candidates->best_candidates();
+      if (best.begin == best.end)
+        continue;
+
+      durations.push_back(best.begin->state.time().value()
+        - best.begin->wait_until);
+    }
+
+    if (durations.empty())
+      return default_segmentation_threshold;
+
+    const auto median = durations.begin() + durations.size() / 2;
+    std::nth_element(durations.begin(), median, durations.end());
+    return std::max(default_segmentation_threshold, *median);
+  }
+
+  // The earliest time that any unassigned request of a node may start
+  static rmf_traffic::Time earliest_start_time(const Node& node)
+  {
+    auto earliest = rmf_traffic::Time::max();
+    for (const auto& u : node.unassigned_tasks)
+    {
+      earliest = std::min(
+        earliest, u.second.request()->booking()->earliest_start_time());
+    }
+
+    return earliest;
+  }
+
+  // Combine the bound of a segment's solution with the bound of the segments
+  // before it
+  void update_suboptimality_bound(
+    const Node& solution,
+    const std::optional<double>& lower_bound)
+  {
+    if (!suboptimality_bound.has_value())
+      return;
+
+    if (!lower_bound.has_value())
+    {
+      suboptimality_bound = std::nullopt;
+      return;
+    }
+
+    if (solution.cost_estimate <= *lower_bound)
+      return;
+
+    if (*lower_bound <= 0.0)
+    {
+      suboptimality_bound = std::nullopt;
+      return;
+    }
+
+    suboptimality_bound = std::max(
+      *suboptimality_bound, solution.cost_estimate / *lower_bound);
+  }
+
+  // Reassign the unassigned tasks of this segment to the same agents and in
+  // the same order as they had in a previous plan, for as long as that plan
+  // still applies, and then assign whatever is left greedily.
+  ConstNodePtr warm_start(
+    ConstNodePtr node,
+    const TaskPlanner::Assignments& previous,
+    const std::vector<State>& initial_states,
+    rmf_traffic::Time time_now)
+  {
+    const std::size_t num_agents =
+      std::min(previous.size(), node->assigned_tasks.size());
+    for (std::size_t a = 0; a < num_agents; ++a)
+    {
+      for (const auto& assignment : previous[a])
+      {
+        // Automatic requests like charging will be added again if needed
+        const auto& booking = *assignment.request()->booking();
+        if (booking.automatic())
+          continue;
+
+        // The request may have been cancelled or assigned by an earlier segment
+        const auto u = std::find_if(
+          node->unassigned_tasks.begin(), node->unassigned_tasks.end(),
+          [&](const Node::UnassignedTasks::value_type& pending)
+          {
+            return pending.second.request()->booking()->id() == booking.id();
+          });
+        if (u == node->unassigned_tasks.end())
+          continue;
+
+        const auto* entry = u->second.candidates->find(a);
+        if (!entry)
+          break;
+
+        auto next = expand_candidate(*entry, *u, node, nullptr, time_now);
+        if (!next)
+          break;
+
+        node = std::move(next);
+      }
+    }
+
+    return greedy_solve(node, initial_states, time_now);
+  }
+
+  // The finish times of the bookings that were assigned by earlier segments
+  // of the current plan, for the bookings that other bookings depend on
+  using ReleaseTimes = std::unordered_map<std::string, rmf_traffic::Time>;
+
+  // The pending tasks that a segment left unassigned, in the order of the
+  // requests of the next segment, and the agents that the segment assigned
+  // anything to
+  struct CarriedTasks
+  {
+    std::vector<const PendingTask*> tasks;
+    std::vector<bool> changed;
+  };
+
+  ConstNodePtr make_initial_node(
+    const std::vector<State>& initial_states,
+    const std::vector<ConstRequestPtr>& requests,
+    rmf_traffic::Time time_now,
+    TaskPlannerError& error,
+    std::size_t num_threads = 1,
+    const ReleaseTimes* released = nullptr,
+    const CarriedTasks* carried = nullptr)
+  {
+    RMF_TASK_TRACE_SPAN("TaskPlanner::make_initial_node");
+    ScopedTimer timer(counters->initialization_time);
+    auto initial_node = make_node(memory);
+
+    initial_node->assigned_tasks.resize(initial_states.size());
+    if (charger_pool)
+    {
+      auto chargers = std::make_shared<std::vector<std::size_t>>();
+      for (const auto& state : initial_states)
+      {
+        chargers->push_back(state.dedicated_charging_waypoint().value_or(
+            std::numeric_limits<std::size_t>::max()));
+      }
+
+      initial_node->chargers = *chargers;
+      initial_node->initial_chargers = std::move(chargers);
+    }
+
+    // Building each pending task is independent of the others, so they may be
+    // built concurrently. Every task reports its own error so that the result
+    // is the same as building them one after another.
+    std::vector<std::shared_ptr<PendingTask>> pending_tasks(requests.size());
+    std::vector<std::optional<TaskPlannerError>> errors(requests.size());
+
+    // The candidates of every task begin from the same initial states
+    std::vector<Candidates::ConstStatePtr> shared_initial_states;
+    shared_initial_states.reserve(initial_states.size());
+    for (const auto& state : initial_states)
+      shared_initial_states.push_back(std::make_shared<const State>(state));
+
+    // Requests that are equivalent, i.e. their descriptions have the same type
+    // and model hash and they share an earliest start time, have the same
+    // model and candidates, so only the first request of each group gets
+    // estimated and the rest of the group shares its pending task. That keeps
+    // the cost of a bulk of identical requests close to the cost of one.
+    std::vector<std::size_t> leader(requests.size());
+    std::vector<std::size_t> leaders;
+    {
+      using GroupKey = std::tuple<std::type_index, std::size_t,
+          rmf_traffic::Time::rep>;
+      std::map<GroupKey, std::size_t> groups;
+      for (std::size_t i = 0; i < requests.size(); ++i)
+      {
+        leader[i] = i;
+        const auto& description = *requests[i]->description();
+        const auto hash = description.model_hash();
+
+        // The requests of a carried segment keep the tables that they already
+        // have, so there is nothing to share
+        if (hash.has_value() && !carried)
+        {
+          const auto earliest_start_time = std::max(
+            time_now, requests[i]->booking()->earliest_start_time());
+          const GroupKey key{
+            typeid(description), *hash,
+            earliest_start_time.time_since_epoch().count()};
+          leader[i] = groups.insert({key, i}).first->second;
+        }
+
+        if (leader[i] == i)
+          leaders.push_back(i);
+      }
+    }
+
+    const auto make_pending_task = [&](const std::size_t k)
+      {
+        const std::size_t i = leaders[k];
+        if (carried)
+        {
+          pending_tasks[i] = PendingTask::carry(
+            *carried->tasks[i],
+            carried->changed,
+            initial_states,
+            config.constraints(),
+            *charging_model,
+            *travel_estimator,
+            errors[i],
+            candidate_memory,
+            counters.get(),
+            &shared_initial_states);
+          return;
+        }
+
+        pending_tasks[i] = PendingTask::make(
+          time_now,
+          initial_states,
+          config.constraints(),
+          config.parameters(),
+          requests[i],
+          *charging_model,
+          *travel_estimator,
+          errors[i],
+          candidate_memory,
+          models.get(),
+          counters.get(),
+          &shared_initial_states);
+      };
+
+    num_threads = std::min(num_threads, leaders.size());
+    if (num_threads > 1)
+    {
+      const auto workers = worker_pool->lease(num_threads);
+      workers->run(leaders.size(), make_pending_task);
+    }
+    else
+    {
+      for (std::size_t k = 0; k < leaders.size(); ++k)
+      {
+        make_pending_task(k);
+        if (!pending_tasks[leaders[k]])
+          break;
+      }
+    }
+
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+      const std::size_t l = leader[i];
+      if (errors[l].has_value())
+        error = *errors[l];
+
+      if (!pending_tasks[l])
+        return nullptr;
+
+      if (l != i)
+      {
+        pending_tasks[i] = PendingTask::share(*pending_tasks[l], requests[i]);
+        ++counters->grouped_requests;
+      }
+
+      // Generate a unique internal id for the request. Currently, multiple
+      // requests with the same string id will be assigned different internal ids
+      std::size_t internal_id = initial_node->get_available_internal_id();
+      initial_node->unassigned_tasks.insert(
+        {
+          internal_id,
+          std::move(*pending_tasks[i])
+        });
+    }
+
+    if (!link_dependencies(*initial_node, released, error))
+      return nullptr;
+
+    evaluate_cost(*initial_node, time_now);
+
+    initial_node->sort_invariants();
+
+    initial_node->latest_time = [&]() -> rmf_traffic::Time
+      {
+        rmf_traffic::Time latest = rmf_traffic::Time::min();
+        for (const auto& s : initial_states)
+        {
+          if (latest < s.time().value())
+            latest = s.time().value();
+        }
+
+        return latest;
+      } ();
+
+    initial_node->update_earliest_wait_until();
+    const auto wait_until = initial_node->earliest_wait_until;
+    if (initial_node->latest_time < wait_until)
+      initial_node->latest_time = wait_until;
+
+    return initial_node;
+  }
+
+  // Give each task of the initial node the internal IDs of the tasks that it
+  // depends on, and delay the tasks whose dependencies were assigned by an
+  // earlier segment. Returns false if the dependencies form a cycle or a
+  // delayed task can no longer be done by any agent.
+  bool link_dependencies(
+    Node& node,
+    const ReleaseTimes* released,
+    TaskPlannerError& error)
+  {
+    auto& tasks = node.unassigned_tasks;
+    const bool any_dependencies = std::any_of(tasks.begin(), tasks.end(),
+        [](const Node::UnassignedTasks::value_type& u)
+        {
+          return !u.second.request()->booking()->dependencies().empty();
+        });
+    if (!any_dependencies)
+      return true;
+
+    std::unordered_map<std::string, std::size_t> internal_ids;
+    for (const auto& u : tasks)
+      internal_ids.insert({u.second.request()->booking()->id(), u.first});
+
+    // The number of unmet dependencies of each task, for finding cycles
+    std::unordered_map<std::size_t, std::size_t> unmet;
+    std::unordered_map<std::size_t, std::vector<std::size_t>> dependents;
+    for (auto& u : tasks)
+    {
+      std::vector<std::size_t> ids;
+      auto release_time = rmf_traffic::Time::min();
+      for (const auto& d : u.second.request()->booking()->dependencies())
+      {
+        const auto it = internal_ids.find(d);
+        if (it != internal_ids.end())
+        {
+          if (it->second != u.first
+            && std::find(ids.begin(), ids.end(), it->second) == ids.end())
+          {
+            ids.push_back(it->second);
+            dependents[it->second].push_back(u.first);
+          }
+
+          continue;
+        }
+
+        if (!released)
+          continue;
+
+        const auto r = released->find(d);
+        if (r != released->end() && release_time < r->second)
+          release_time = r->second;
+      }
+
+      unmet[u.first] = ids.size();
+      if (!ids.empty())
+        u.second.dependencies(std::move(ids));
+
+      if (release_time > rmf_traffic::Time::min())
+      {
+        u.second.release_time = release_time;
+        const bool feasible = u.second.candidates.mutate().delay(
+          release_time, config.constraints(), *u.second.model(),
+          *charging_model, *travel_estimator, counters.get());
+
+        if (!feasible)
+        {
+          error = TaskPlannerError::limited_capacity;
+          return false;
+        }
+      }
+    }
+
+    std::vector<std::size_t> ready;
+    for (const auto& [id, count] : unmet)
+    {
+      if (count == 0)
+        ready.push_back(id);
+    }
+
+    std::size_t ordered = 0;
+    while (!ready.empty())
+    {
+      const auto id = ready.back();
+      ready.pop_back();
+      ++ordered;
+
+      const auto it = dependents.find(id);
+      if (it == dependents.end())
+        continue;
+
+      tasks.find(id)->second.has_dependents(true);
+      for (const auto d : it->second)
+      {
+        if (--unmet[d] == 0)
+          ready.push_back(d);
+      }
+    }
+
+    if (ordered < unmet.size())
+    {
+      error = TaskPlannerError::cyclic_dependencies;
+      return false;
+    }
+
+    return true;
+  }
+
+  void evaluate_cost(Node& node, rmf_traffic::Time time_now)
+  {
+    const auto cost = cost_calculator->compute_node_cost(
+      node, time_now, check_priority);
+    node.cost_estimate = cost.total;
+    node.heuristic_cost = cost.heuristic;
+  }
+
+  // Compute the costs of nodes that were generated with defer_cost, in one
+  // call to the cost calculator
+  void evaluate_costs(
+    const NodePtr* nodes,
+    const std::size_t count,
+    rmf_traffic::Time time_now)
+  {
+    thread_local std::vector<const Node*> batch;
+    thread_local std::vector<CostCalculator::NodeCost> costs;
+    batch.clear();
+    for (std::size_t i = 0; i < count; ++i)
+      batch.push_back(nodes[i].get());
+
+    costs.resize(count);
+    cost_calculator->compute_node_costs(
+      batch.data(), count, time_now, check_priority, costs.data());
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      nodes[i]->cost_estimate = costs[i].total;
+      nodes[i]->heuristic_cost = costs[i].heuristic;
+    }
+  }
+
+  // Estimate the finish of a pending task from a state, waiting for the
+  // release time of the task if the state comes before it
+  std::optional<EstimatedFinish> estimate_pending(
+    const FinishEstimator& estimator,
+    const State& state,
+    const PendingTask& task) const
+  {
+    if (task.release_time <= state.time().value())
+      return estimator(*task.model());
+
+    State delayed = state;
+    delayed.time(task.release_time);
+    return FinishEstimator(
+      delayed, config.constraints(), *travel_estimator)(*task.model());
+  }
+
+  rmf_traffic::Time get_latest_time(const Node& node)
+  {
+    // The node keeps this up to date as its assignments change
+    assert(node.latest_finish_time > rmf_traffic::Time::min());
+    return node.latest_finish_time;
+  }
+
+  // With defer_cost the cost of the new node is left for evaluate_costs(),
+  // and the filter should be applied by the caller once it is known
+  NodePtr expand_candidate(
+    const Candidates::Entry& candidate_entry,
+    const Node::UnassignedTasks::value_type& u,
+    const ConstNodePtr& parent,
+    Filter* filter,
+    rmf_traffic::Time time_now,
+    const bool defer_cost = false)
+  {
+    const auto& constraints = config.constraints();
+
+    const auto latest_time = parent->latest_time + segmentation_threshold;
+    if (latest_time < candidate_entry.wait_until)
+    {
+
+      // No need to assign task as timeline is not relevant
+      return nullptr;
+    }
+
+    // Never assign a task before the tasks that it depends on
+    if (parent->blocked(u.second))
+      return nullptr;
+
+    auto new_node = make_node(*parent);
+
+    // Assign the unassigned task after checking for implicit charging requests
+    std::optional<Candidates::Entry> rerouted;
+    if (candidate_entry.require_charge_battery)
+    {
+      // Check if a battery task already precedes the latest assignment
+      const auto& assignments =
+        *new_node->assigned_tasks[candidate_entry.candidate];
+      if (assignments.empty() || !assignments.back().is_charging)
+      {
+        bool moved = false;
+        auto battery_estimate = claim_charger(
+          *new_node, candidate_entry.candidate, *candidate_entry.previous_state,
+          estimate_charging(*candidate_entry.previous_state, constraints),
+          &moved);
+
+        // The task was estimated to start from the nearest charger, so it
+        // needs a new estimate if another agent holds that charger
+        if (moved && battery_estimate.has_value())
+        {
+          const auto& charged = battery_estimate->finish_state;
+          ++counters->estimate_finish_calls;
+          auto finish = estimate_pending(
+            FinishEstimator(charged, constraints, *travel_estimator),
+            charged, u.second);
+          if (!finish.has_value())
+            return nullptr;
+
+          rerouted = Candidates::Entry{
+            candidate_entry.candidate,
+            std::move(finish->finish_state),
+            finish->wait_until,
+            candidate_entry.previous_state,
+            true
+          };
+        }
+
+        if (battery_estimate.has_value())
+        {
+          auto charge_battery = make_charging_request(
+            candidate_entry.previous_state->time().value(), time_now);
+          push_assignment(
+            *new_node,
+            candidate_entry.candidate,
+            Node::AssignmentWrapper
+            { new_node->get_available_internal_id(true),
+              Assignment
+              {
+                charge_battery,
+                battery_estimate->finish_state,
+                battery_estimate->wait_until
+              },
+              true
+            }
+          );
+        }
+      }
+    }
+    const Candidates::Entry& entry = rerouted ? *rerouted : candidate_entry;
+    Node::AssignmentWrapper assignment{u.first,
+      Assignment{u.second.request(), entry.state, entry.wait_until}};
+    assignment.is_charging = u.second.is_charging();
+    assignment.priority_level = u.second.priority_level();
+    push_assignment(*new_node, entry.candidate, std::move(assignment));
+
+    // Erase the assigned task from unassigned tasks
+    new_node->pop_unassigned(u.first);
+
+    // The tasks that depend on this one may not begin until it finishes
+    if (u.second.has_dependents())
+    {
+      const auto finish_time = entry.state.time().value();
+      for (auto& new_u : new_node->unassigned_tasks)
+      {
+        const auto& dependencies = new_u.second.dependencies();
+        if (std::find(dependencies.begin(), dependencies.end(), u.first)
+          == dependencies.end())
+          continue;
+
+        if (finish_time <= new_u.second.release_time)
+          continue;
+
+        new_u.second.release_time = finish_time;
+        const bool feasible = new_u.second.candidates.mutate().delay(
+          finish_time, constraints, *new_u.second.model(), *charging_model,
+          *travel_estimator, counters.get());
+
+        if (!feasible)
+          return nullptr;
+      }
+    }
+
+    // Update states of unassigned tasks for the candidate
+    bool add_charger = false;
+    const auto previous_state = std::make_shared<const State>(entry.state);
+    const FinishEstimator estimate_from_entry(
+      entry.state, constraints, *travel_estimator);
+    for (auto& new_u : new_node->unassigned_tasks)
+    {
+      ++counters->estimate_finish_calls;
+      auto finish =
+        estimate_pending(estimate_from_entry, entry.state, new_u.second);
+
+      if (finish.has_value())
+      {
+        new_u.second.candidates.mutate().update_candidate(
+          entry.candidate,
+          std::move(finish->finish_state),
+          finish->wait_until,
+          previous_state,
+          false);
+      }
+      else
+      {
+        // TODO(YV): Revisit this strategy
+        // auto battery_estimate =
+        //   config->charge_battery_request()->estimate_finish(entry.state, constraints);
+        // if (battery_estimate.has_value())
+        // {
+        //   auto new_finish =
+        //     new_u.second.request->estimate_finish(
+        //       battery_estimate->finish_state,
+        //       constraints);
+        //   assert(new_finish.has_value());
+        //   new_u.second.candidates.update_candidate(
+        //     entry.candidate,
+        //     new_finish.value().finish_state(),
+        //     new_finish.value().wait_until());
+        // }
+        // else
+        // {
+        //   // Unable to reach charger
+        //   return nullptr;
+        // }
+
+        add_charger = true;
+        break;
+      }
+    }
+
+    if (add_charger)
+    {
+      auto battery_estimate = claim_charger(
+        *new_node, entry.candidate, entry.state,
+        estimate_charging(entry.state, constraints));
+      if (battery_estimate.has_value())
+      {
+        auto charge_battery = make_charging_request(
+          entry.state.time().value(), time_now);
+        push_assignment(
+          *new_node,
+          entry.candidate,
+          { new_node->get_available_internal_id(true),
+            Assignment
+            {
+              charge_battery,
+              battery_estimate->finish_state,
+              battery_estimate->wait_until
+            },
+            true});
+        const FinishEstimator estimate_from_charger(
+          battery_estimate->finish_state, constraints, *travel_estimator);
+        for (auto& new_u : new_node->unassigned_tasks)
+        {
+          ++counters->estimate_finish_calls;
+          auto finish = estimate_pending(
+            estimate_from_charger, battery_estimate->finish_state,
+            new_u.second);
+          if (finish.has_value())
+          {
+            new_u.second.candidates.mutate().update_candidate(
+              entry.candidate, std::move(finish->finish_state),
+              finish->wait_until, previous_state, false);
+          }
+          else
+          {
+            // We should stop expanding this node
+            return nullptr;
+          }
+        }
+
+      }
+      else
+      {
+        // Agent cannot make it back to the charger
+        return nullptr;
+      }
+    }
+
+    // Update the cost estimate for new_node
+    if (!defer_cost)
+      evaluate_cost(*new_node, time_now);
+
+    new_node->latest_time = get_latest_time(*new_node);
+    new_node->update_earliest_wait_until();
+
+    ++counters->nodes_generated;
+
+    // Apply filter
+    if (filter && filter->ignore(*new_node))
+    {
+      ++counters->filter_rejections;
+      return nullptr;
+    }
+
+    return new_node;
+
+  }
+
+  ConstNodePtr expand_charger(
+    const ConstNodePtr& parent,
+    const std::size_t agent,
+    const std::vector<State>&,
+    rmf_traffic::Time time_now)
+  {
+    const auto& assignments = *parent->assigned_tasks[agent];
+
+    // If the assignment set for a candidate is empty we do not want to add a
+    // charging task as this is taken care of in expand_candidate(). Without this
+    // step there is chance for the planner to get stuck in an infinite loop when
+    // a charging task is required before any other task can be assigned.
+    if (assignments.empty() || assignments.back().is_charging)
+      return nullptr;
+
+    const State& state = assignments.back().assignment.finish_state();
+    auto estimate = claim_charger(
+      *parent, agent, state, estimate_charging(state, config.constraints()));
+    if (!estimate.has_value())
+      return nullptr;
+
+    auto new_node = make_node(*parent);
+    if (!push_charger(*new_node, agent, state, *estimate, time_now))
+      return nullptr;
+
+    return new_node;
+  }
+
+  // Assign a charging task to the end of the assignments of an agent, which
+  // finishes as estimated from the given state. This is false if some
+  // unassigned task cannot be done after charging.
+  bool push_charger(
+    Node& node,
+    const std::size_t agent,
+    const State& state,
+    const EstimatedFinish& estimate,
+    rmf_traffic::Time time_now)
+  {
+    auto charge_battery =
+      make_charging_request(state.time().value(), time_now);
+    push_assignment(
+      node,
+      agent,
+      Node::AssignmentWrapper
+      {
+        node.get_available_internal_id(true),
+        Assignment
+        {
+          charge_battery,
+          estimate.finish_state,
+          estimate.wait_until
+        },
+        true
+      });
+    const auto previous_state = std::make_shared<const State>(state);
+    const FinishEstimator estimate_from_charger(
+      estimate.finish_state, config.constraints(), *travel_estimator);
+    for (auto& new_u : node.unassigned_tasks)
+    {
+      ++counters->estimate_finish_calls;
+      auto finish = estimate_pending(
+        estimate_from_charger, estimate.finish_state, new_u.second);
+      if (!finish.has_value())
+        return false;
+
+      new_u.second.candidates.mutate().update_candidate(
+        agent,
+        std::move(finish->finish_state),
+        finish->wait_until,
+        previous_state,
+        false);
+    }
+
+    evaluate_cost(node, time_now);
+    node.latest_time = get_latest_time(node);
+    node.update_earliest_wait_until();
+    ++counters->nodes_generated;
+    return true;
+  }
+
+  // When an agent does not have enough charge for its next task, drop its
+  // latest assignments one at a time until a charging task fits after the
+  // ones that are left. Whether the charger can be reached is checked against
+  // the finish state of each assignment where it is, so the node only gets
+  // copied for the positions where charging is possible.
+  ConstNodePtr backtrack_charger(
+    const ConstNodePtr& node,
+    const std::size_t agent,
+    rmf_traffic::Time time_now)
+  {
+    const auto& assignments = *node->assigned_tasks[agent];
+    for (std::size_t kept = assignments.size(); kept-- > 1;)
+    {
+      const auto& last = assignments[kept - 1];
+      if (last.is_charging)
+        continue;
+
+      // Dropping the assignments of this agent does not change which
+      // chargers the other agents hold
+      const State& state = last.assignment.finish_state();
+      const auto estimate = claim_charger(
+        *node, agent, state, estimate_charging(state, config.constraints()));
+      if (!estimate.has_value())
+        continue;
 
-// ============================================================================
-class TaskPlanner::Implementation
-{
-public:
-  Configuration config;
-  Options default_options;
-  ConstTravelEstimatorPtr travel_estimator;
-  std::string planner_id;
-  bool check_priority = false;
-  ConstCostCalculatorPtr cost_calculator = nullptr;
+      auto new_node = make_node(*node);
+      while (new_node->assigned_tasks[agent]->size() > kept)
+        new_node->pop_assignment(agent);
 
-  static constexpr std::string_view DefaultTaskPlannerName = "task_planner";
+      if (push_charger(*new_node, agent, state, *estimate, time_now))
+        return new_node;
+    }
 
-  ConstRequestPtr make_charging_request(
-    rmf_traffic::Time start_time,
+    return nullptr;
+  }
+
+  ConstNodePtr greedy_solve(
+    ConstNodePtr node,
+    const std::vector<State>& initial_states,
     rmf_traffic::Time time_now)
   {
-    return rmf_task::requests::ChargeBattery::make(
-      start_time,
-      planner_id,
-      time_now,
-      nullptr,
-      true);
+    while (!finished(*node))
+    {
+      if (deadline->expired())
+        return nullptr;
+
+      ++counters->nodes_expanded;
+      node = greedy_step(node, initial_states, time_now);
+      assert(node);
+    }
+
+    return node;
   }
 
-  TaskPlanner::Assignments prune_assignments(
-    TaskPlanner::Assignments& assignments)
+  // Take the cheapest expansion of any unassigned task
+  ConstNodePtr greedy_step(
+    const ConstNodePtr& node,
+    const std::vector<State>&,
+    rmf_traffic::Time time_now)
   {
-    for (std::size_t a = 0; a < assignments.size(); ++a)
+    ConstNodePtr next_node = nullptr;
+    for (const auto& u : node->unassigned_tasks)
     {
-      if (assignments[a].empty())
+      if (node->blocked(u.second))
         continue;
 
-      // Remove charging task at end of assignments if any
-      // TODO(YV): Remove this after fixing the planner
-      if (std::dynamic_pointer_cast<
-          const rmf_task::requests::ChargeBattery::Description>(
-          assignments[a].back().request()->description()))
-        assignments[a].pop_back();
+      const auto& range = u.second.candidates->best_candidates();
+      for (auto it = range.begin; it != range.end; ++it)
+      {
+        if (auto n = expand_candidate(
+            *it, u, node, nullptr, time_now))
+        {
+          if (!next_node || (n->cost_estimate < next_node->cost_estimate))
+          {
+            next_node = std::move(n);
+          }
+        }
+        else
+        {
+          // expand_candidate returned nullptr either due to start time
+          // segmentation or insufficient charge to return to its charger.
+          // For the later case, we aim to backtrack and assign a charging
+          // task to the agent.
+          if (node->latest_time + segmentation_threshold >
+            it->wait_until)
+          {
+            if (auto n = backtrack_charger(node, it->candidate, time_now))
+              next_node = std::move(n);
+          }
+        }
+      }
     }
 
-    return assignments;
+    return next_node;
   }
 
-  ConstNodePtr prune_assignments(ConstNodePtr parent)
+  // Like greedy_solve(), but each step assigns the task that would lose the
+  // most by waiting: the one whose best agents are furthest ahead of its
+  // k-th best agent. Only that task is expanded, so a step is cheaper than a
+  // greedy step. When none of the tasks can be expanded onto its best agents,
+  // e.g. because an agent needs to charge first, the step falls back to
+  // greedy_step().
+  ConstNodePtr regret_solve(
+    ConstNodePtr node,
+    const std::vector<State>& initial_states,
+    rmf_traffic::Time time_now,
+    const std::size_t k)
   {
-    auto node = std::make_shared<Node>(*parent);
-
-    for (auto& agent : node->assigned_tasks)
+    using TaskRegret =
+      std::pair<double, const Node::UnassignedTasks::value_type*>;
+    std::vector<TaskRegret> order;
+    while (!finished(*node))
     {
-      if (agent.empty())
-        continue;
+      if (deadline->expired())
+        return nullptr;
 
-      if (std::dynamic_pointer_cast<
-          const rmf_task::requests::ChargeBattery::Description>(
-          agent.back().assignment.request()->description()))
-        agent.pop_back();
+      ++counters->nodes_expanded;
+
+      // Rank the tasks by regret, breaking ties with the earliest finish
+      order.clear();
+      for (const auto& u : node->unassigned_tasks)
+      {
+        if (!node->blocked(u.second))
+          order.push_back({u.second.candidates->regret(k), &u});
+      }
+
+      std::sort(order.begin(), order.end(),
+        [](const TaskRegret& a, const TaskRegret& b)
+        {
+          if (a.first != b.first)
+            return a.first > b.first;
+
+          return a.second->second.candidates->best_finish_time()
+          < b.second->second.candidates->best_finish_time();
+        });
+
+      ConstNodePtr next_node = nullptr;
+      for (const auto& [regret, u] : order)
+      {
+        const auto& range = u->second.candidates->best_candidates();
+        for (auto it = range.begin; it != range.end; ++it)
+        {
+          auto n = expand_candidate(*it, *u, node, nullptr, time_now);
+          if (n && (!next_node || n->cost_estimate < next_node->cost_estimate))
+            next_node = std::move(n);
+        }
+
+        if (next_node)
+          break;
+      }
+
+      if (!next_node)
+        next_node = greedy_step(node, initial_states, time_now);
+
+      node = std::move(next_node);
+      assert(node);
     }
 
     return node;
   }
 
-  void append_finishing_request(
-    const RequestFactory& factory,
-    TaskPlanner::Assignments& complete_assignments,
+  // Auction the tasks one at a time in order of their earliest start time.
+  // Each task goes to whichever of its best agents can take it for the lowest
+  // cost, so a step only expands the candidates of a single task. When none
+  // of those can be expanded, e.g. because the agent needs to charge first,
+  // the step falls back to greedy_step().
+  ConstNodePtr auction_solve(
+    ConstNodePtr node,
+    const std::vector<State>& initial_states,
     rmf_traffic::Time time_now)
   {
-    for (auto& agent : complete_assignments)
+    while (!finished(*node))
     {
-      if (agent.empty())
-      {
-        continue;
-      }
+      if (deadline->expired())
+        return nullptr;
 
-      const auto& state = agent.back().finish_state();
-      const auto request = factory.make_request(state);
+      ++counters->nodes_expanded;
 
-      // TODO(YV) Currently we are unable to recursively call complete_solve()
-      // here as the prune_assignments() function will remove any ChargeBattery
-      // requests at the back of the assignments. But the finishing factory
-      // could be a ChargeBattery request and hence this approach does not work.
-      // When we fix the logic with unnecessary ChargeBattery tasks, we should
-      // revist making this a recursive call.
-      auto model = request->description()->make_model(
-        state.time().value(),
-        config.parameters());
-      auto estimate = model->estimate_finish(
-        state, config.constraints(), *travel_estimator);
-      if (estimate.has_value())
+      // The next task up for auction, breaking ties with the earliest finish
+      const Node::UnassignedTasks::value_type* next = nullptr;
+      for (const auto& u : node->unassigned_tasks)
       {
-        agent.push_back(
-          Assignment
-          {
-            request,
-            estimate.value().finish_state(),
-            estimate.value().wait_until()
-          });
+        if (node->blocked(u.second))
+          continue;
+
+        if (!next)
+        {
+          next = &u;
+          continue;
+        }
+
+        const auto start = u.second.request()->booking()->earliest_start_time();
+        const auto next_start =
+          next->second.request()->booking()->earliest_start_time();
+        if (start < next_start || (start == next_start
+          && u.second.candidates->best_finish_time()
+          < next->second.candidates->best_finish_time()))
+          next = &u;
       }
-      else
+
+      ConstNodePtr next_node = nullptr;
+      if (next)
       {
-        // Insufficient battery to perform the finishing request. We check if
-        // adding a ChargeBattery task before will allow for it to be performed
-        const auto charging_request =
-          make_charging_request(state.time().value(), time_now);
-        const auto charge_battery_model =
-          charging_request->description()->make_model(
-          state.time().value(),
-          config.parameters());
-        const auto charge_battery_estimate =
-          charge_battery_model->estimate_finish(
-          state, config.constraints(), *travel_estimator);
-        if (charge_battery_estimate.has_value())
+        const auto& range = next->second.candidates->best_candidates();
+        for (auto it = range.begin; it != range.end; ++it)
         {
-          model = request->description()->make_model(
-            charge_battery_estimate.value().finish_state().time().value(),
-            config.parameters());
-          estimate = model->estimate_finish(
-            charge_battery_estimate.value().finish_state(),
-            config.constraints(),
-            *travel_estimator);
-          if (estimate.has_value())
-          {
-            // Append the ChargeBattery and finishing request
-            agent.push_back(
-              Assignment{
-                charging_request,
-                charge_battery_estimate.value().finish_state(),
-                charge_battery_estimate.value().wait_until()
-              });
-            agent.push_back(
-              Assignment
-              {
-                request,
-                estimate.value().finish_state(),
-                estimate.value().wait_until()
-              });
-          }
+          auto n = expand_candidate(*it, *next, node, nullptr, time_now);
+          if (n && (!next_node || n->cost_estimate < next_node->cost_estimate))
+            next_node = std::move(n);
         }
       }
+
+      if (!next_node)
+        next_node = greedy_step(node, initial_states, time_now);
+
+      node = std::move(next_node);
+      assert(node);
     }
+
+    return node;
   }
 
-  Result complete_solve(
+  // Make the children of a node. The children that assign a task are checked
+  // against the filter, unless it is a nullptr.
+  std::vector<ConstNodePtr> expand(
+    const ConstNodePtr& parent,
+    Filter* filter,
+    const std::vector<State>& initial_states,
     rmf_traffic::Time time_now,
-    std::vector<State>& initial_states,
-    const std::vector<ConstRequestPtr>& requests,
-    const std::function<bool()> interrupter,
-    ConstRequestFactoryPtr finishing_request,
-    bool greedy)
+    ExpansionWorkers* workers,
+    const std::vector<std::size_t>* equivalent_agents = nullptr)
   {
+    if (workers)
+      return parallel_expand(
+        parent, filter, initial_states, time_now, *workers, equivalent_agents);
 
-    cost_calculator = config.cost_calculator() ? config.cost_calculator() :
-      rmf_task::BinaryPriorityScheme::make_cost_calculator();
+    // A batched cost calculator gets the costs of all the children at once
+    const bool batched = cost_calculator->batched();
+    thread_local std::vector<NodePtr> deferred;
+    deferred.clear();
 
-    // Also check if a high priority task exists among the requests.
-    // If so the cost function for a node will be modified accordingly.
-    for (const auto& request : requests)
+    std::vector<ConstNodePtr> new_nodes;
+    new_nodes.reserve(
+      parent->unassigned_tasks.size() + parent->assigned_tasks.size());
+    for (const auto& u : parent->unassigned_tasks)
     {
-      if (request->booking()->priority())
+      if (parent->blocked(u.second))
+        continue;
+
+      const auto& range = u.second.candidates->best_candidates();
+      for (auto it = range.begin; it != range.end; it++)
       {
-        check_priority = true;
-        break;
+        if (is_redundant(*parent, it->candidate, equivalent_agents))
+          continue;
+
+        if (batched)
+        {
+          if (auto new_node = expand_candidate(
+              *it, u, parent, nullptr, time_now, true))
+            deferred.push_back(std::move(new_node));
+        }
+        else if (auto new_node = expand_candidate(
+            *it, u, parent, filter, time_now))
+          new_nodes.push_back(std::move(new_node));
       }
     }
 
-    TaskPlannerError error;
-    auto node = make_initial_node(
-      initial_states, requests, time_now, error);
-    if (!node)
-      return error;
+    if (batched)
+    {
+      evaluate_costs(deferred.data(), deferred.size(), time_now);
+      for (auto& n : deferred)
+      {
+        if (filter && filter->ignore(*n))
+        {
+          ++counters->filter_rejections;
+          continue;
+        }
 
-    TaskPlanner::Assignments complete_assignments;
-    complete_assignments.resize(node->assigned_tasks.size());
+        new_nodes.push_back(std::move(n));
+      }
+      deferred.clear();
+    }
 
-    while (node)
+    // Assign charging task to each robot
+    for (std::size_t i = 0; i < parent->assigned_tasks.size(); ++i)
     {
-      if (greedy)
-        node = greedy_solve(node, initial_states, time_now);
-      else
-        node = solve(node, initial_states,
-            requests.size(), time_now, interrupter);
+      if (is_redundant(*parent, i, equivalent_agents))
+        continue;
 
-      if (!node)
+      if (auto new_node = expand_charger(
+          parent, i, initial_states, time_now))
+        new_nodes.push_back(std::move(new_node));
+    }
+
+    return new_nodes;
+  }
+
+  // Produces the same nodes in the same order as the serial expand(), but the
+  // candidates and chargers are evaluated by the workers. The filter is not
+  // thread-safe, so it is applied afterwards in the original order.
+  std::vector<ConstNodePtr> parallel_expand(
+    const ConstNodePtr& parent,
+    Filter* filter,
+    const std::vector<State>& initial_states,
+    rmf_traffic::Time time_now,
+    ExpansionWorkers& workers,
+    const std::vector<std::size_t>* equivalent_agents)
+  {
+    using Candidate = std::pair<
+      const Node::UnassignedTasks::value_type*,
+      const Candidates::Entry*>;
+
+    std::vector<Candidate> candidates;
+    for (const auto& u : parent->unassigned_tasks)
+    {
+      if (parent->blocked(u.second))
+        continue;
+
+      const auto& range = u.second.candidates->best_candidates();
+      for (auto it = range.begin; it != range.end; it++)
       {
-        return {};
+        if (!is_redundant(*parent, it->candidate, equivalent_agents))
+          candidates.push_back({&u, &*it});
       }
+    }
 
-      // Here we prune assignments to remove any charging tasks at the back of
-      // the assignment list
-      node = prune_assignments(node);
-      assert(complete_assignments.size() == node->assigned_tasks.size());
-      for (std::size_t i = 0; i < complete_assignments.size(); ++i)
+    const bool batched = cost_calculator->batched();
+    const std::size_t num_agents = parent->assigned_tasks.size();
+    std::vector<NodePtr> children(candidates.size());
+    std::vector<ConstNodePtr> results(candidates.size() + num_agents);
+    workers.run(
+      results.size(),
+      [&](const std::size_t i)
       {
-        auto& all_assignments = complete_assignments[i];
-        const auto& new_assignments = node->assigned_tasks[i];
-        for (const auto& a : new_assignments)
+        if (i < candidates.size())
         {
-          all_assignments.push_back(a.assignment);
+          const auto& c = candidates[i];
+          children[i] = expand_candidate(
+            *c.second, *c.first, parent, nullptr, time_now, batched);
         }
-      }
+        else
+        {
+          const std::size_t agent = i - candidates.size();
+          if (!is_redundant(*parent, agent, equivalent_agents))
+          {
+            results[i] = expand_charger(
+              parent, agent, initial_states, time_now);
+          }
+        }
+      });
 
-      if (node->unassigned_tasks.empty())
-      {
-        auto pruned_assignments = prune_assignments(complete_assignments);
-        if (finishing_request != nullptr)
+    if (batched)
+    {
+      // Each worker computes the costs of one contiguous run of children
+      const auto end = std::remove(children.begin(), children.end(), nullptr);
+      const std::size_t count = end - children.begin();
+      const std::size_t chunk = (count + workers.size() - 1) / workers.size();
+      workers.run(
+        workers.size(),
+        [&](const std::size_t i)
         {
-          append_finishing_request(
-            *finishing_request,
-            pruned_assignments,
+          const std::size_t begin = std::min(count, i * chunk);
+          evaluate_costs(
+            children.data() + begin, std::min(count, begin + chunk) - begin,
             time_now);
-        }
+        });
 
-        return pruned_assignments;
-      }
+      // The children kept their order, and the filter only needs them to
+      // come before the chargers
+      for (std::size_t i = 0; i < count; ++i)
+        results[i] = std::move(children[i]);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < candidates.size(); ++i)
+        results[i] = std::move(children[i]);
+    }
 
-      std::vector<ConstRequestPtr> new_tasks;
-      for (const auto& u : node->unassigned_tasks)
-        new_tasks.push_back(u.second.request);
+    std::vector<ConstNodePtr> new_nodes;
+    new_nodes.reserve(results.size());
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+      auto& n = results[i];
+      if (!n)
+        continue;
 
-      // copy final state estimates
-      std::vector<State> estimates;
-      rmf_traffic::agv::Plan::Start empty_new_location{
-        time_now, 0, 0.0};
-      estimates.resize(
-        node->assigned_tasks.size(),
-        State().load_basic(empty_new_location, 0, 0.0));
-      for (std::size_t i = 0; i < node->assigned_tasks.size(); ++i)
+      if (filter && i < candidates.size() && filter->ignore(*n))
       {
-        const auto& assignments = node->assigned_tasks[i];
-        if (assignments.empty())
-          estimates[i] = initial_states[i];
-        else
-          estimates[i] = assignments.back().assignment.finish_state();
+        ++counters->filter_rejections;
+        continue;
       }
 
-      node = make_initial_node(
-        estimates, new_tasks, time_now, error);
-      if (!node)
-        return error;
-      initial_states = estimates;
+      new_nodes.push_back(std::move(n));
     }
 
-    // If a finishing_request is present, accommodate the request at the end of
-    // the assignments for each agent
-    if (finishing_request != nullptr)
-    {
-      append_finishing_request(
-        *finishing_request,
-        complete_assignments,
-        time_now);
-    }
+    return new_nodes;
+  }
+
+  bool finished(const Node& node)
+  {
+    // Every node caches the earliest wait of the best candidates of its
+    // unassigned tasks, so this does not need to visit the tasks
+    if (node.earliest_wait_until == rmf_traffic::Time::max())
+      return true;
 
-    return complete_assignments;
+    return node.latest_time + segmentation_threshold
+      < node.earliest_wait_until;
   }
 
-  ConstNodePtr make_initial_node(
-    std::vector<State> initial_states,
-    std::vector<ConstRequestPtr> requests,
+  // Search for the lowest cost node that finishes this planning segment. When
+  // the search returns a node, lower_bound is set to a lower bound on the cost
+  // of the optimal node, if one is known.
+  ConstNodePtr solve(
+    ConstNodePtr initial_node,
+    const std::vector<State>& initial_states,
+    const std::size_t num_tasks,
     rmf_traffic::Time time_now,
-    TaskPlannerError& error)
+    const SearchOptions& search,
+    std::optional<double>& lower_bound)
   {
-    auto initial_node = std::make_shared<Node>();
+    RMF_TASK_TRACE_SPAN("TaskPlanner::solve");
+    OpenList open_list(
+      search.heuristic_weight, search.tie_break, search.deterministic);
+    const auto push = [&](ConstNodePtr n)
+      {
+        open_list.push(std::move(n));
+        counters->update_peak_open_nodes(open_list.size());
+      };
 
-    initial_node->assigned_tasks.resize(initial_states.size());
+    // The anytime search needs somewhere to keep its best solution so far
+    std::optional<Incumbent> anytime_incumbent;
+    Incumbent* incumbent = search.incumbent;
 
-    for (const auto& request : requests)
+    // For branch and bound, a greedy solution gives the first upper bound
+    // unless an incumbent has already been provided
+    if (search.branch_and_bound && !incumbent)
     {
-      // Generate a unique internal id for the request. Currently, multiple
-      // requests with the same string id will be assigned different internal ids
-      std::size_t internal_id = initial_node->get_available_internal_id();
-      const auto pending_task = PendingTask::make(
-        time_now,
-        initial_states,
-        config.constraints(),
-        config.parameters(),
-        request,
-        *travel_estimator,
-        planner_id,
-        error);
-
-      if (!pending_task)
-        return nullptr;
-
-      initial_node->unassigned_tasks.insert(
-        {
-          internal_id,
-          *pending_task
-        });
+      incumbent = &anytime_incumbent.emplace();
+      if (auto n = greedy_solve(initial_node, initial_states, time_now))
+        incumbent->offer(std::move(n));
+    }
+    if (search.anytime)
+    {
+      open_list.weight(std::max(open_list.weight(), anytime_initial_weight));
+      if (!incumbent)
+        incumbent = &anytime_incumbent.emplace();
     }
 
-    initial_node->cost_estimate = cost_calculator->compute_cost(
-      *initial_node, time_now, check_priority);
-
-    initial_node->sort_invariants();
-
-    initial_node->latest_time = [&]() -> rmf_traffic::Time
+    // Nodes that cannot cost less than the incumbent are not worth exploring
+    const auto can_improve = [&](const Node& n)
       {
-        rmf_traffic::Time latest = rmf_traffic::Time::min();
-        for (const auto& s : initial_states)
+        return !incumbent || n.cost_estimate < incumbent->cost();
+      };
+
+    Filter filter{search.filter_type, num_tasks};
+
+    // When the open list grows past its limit, the worst half of it is dropped.
+    // The optimal node might descend from a dropped node, so the cheapest of
+    // them is kept as a lower bound. The filter is bounded along with it by
+    // forgetting everything once it holds twice as many nodes as the limit,
+    // which only means that some duplicate nodes get explored again.
+    std::optional<double> dropped_cost;
+    const auto enforce_limit = [&]()
+      {
+        const std::size_t limit = search.max_open_nodes;
+        if (limit == 0)
+          return;
+
+        if (filter.size() > 2 * limit)
         {
-          if (latest < s.time().value())
-            latest = s.time().value();
+          PlanCounters::update_peak(
+            counters->peak_filter_bytes, filter.memory_usage());
+          filter.clear();
         }
 
-        return latest;
-      } ();
+        if (open_list.size() <= limit)
+          return;
 
-    rmf_traffic::Time wait_until = rmf_traffic::Time::max();
+        const auto cost = open_list.truncate(std::max<std::size_t>(
+              1, limit / 2));
+        if (cost.has_value())
+          dropped_cost = dropped_cost ? std::min(*dropped_cost, *cost) : *cost;
+      };
 
-    for (const auto& u : initial_node->unassigned_tasks)
+    const ConstNodePtr root = initial_node;
+    push(std::move(initial_node));
+
+    // Record how much memory the filter and the open list reached, however
+    // the search ends
+    struct MemoryReport
     {
-      const auto& range = u.second.candidates.best_candidates();
-      for (auto it = range.begin; it != range.end; ++it)
+      ~MemoryReport()
       {
-        if (it->second.wait_until < wait_until)
-          wait_until = it->second.wait_until;
+        PlanCounters::update_peak(
+          counters.peak_filter_bytes, filter.memory_usage());
+        PlanCounters::update_peak(
+          counters.peak_open_list_bytes, open_list.memory_usage());
       }
-    }
 
-    if (initial_node->latest_time < wait_until)
-      initial_node->latest_time = wait_until;
+      PlanCounters& counters;
+      const Filter& filter;
+      const OpenList& open_list;
+    } memory_report{*counters, filter, open_list};
 
-    return initial_node;
-  }
+    // A partial expansion relies on the keys of the open list staying the
+    // same, which the anytime search does not do
+    const std::optional<double> partial_expansion =
+      search.anytime ? std::nullopt : search.partial_expansion;
 
-  rmf_traffic::Time get_latest_time(const Node& node)
-  {
-    rmf_traffic::Time latest = rmf_traffic::Time::min();
-    for (const auto& a : node.assigned_tasks)
+    std::optional<std::vector<std::size_t>> equivalent_agents;
+    if (search.symmetry_tolerance.has_value())
     {
-      if (a.empty())
-        continue;
-
-      const auto finish_time =
-        a.back().assignment.finish_state().time().value();
-
-      if (latest < finish_time)
-        latest = finish_time;
+      equivalent_agents = find_equivalent_agents(
+        initial_states, *search.symmetry_tolerance);
     }
+    ConstNodePtr top = nullptr;
 
-    assert(latest > rmf_traffic::Time::min());
-    return latest;
-  }
-
-  ConstNodePtr expand_candidate(
-    const Candidates::Map::const_iterator& it,
-    const Node::UnassignedTasks::value_type& u,
-    const ConstNodePtr& parent,
-    Filter* filter,
-    rmf_traffic::Time time_now)
-  {
-    const auto& entry = it->second;
-    const auto& constraints = config.constraints();
+    WorkerPool::Lease workers;
+    if (search.num_threads > 1)
+      workers = worker_pool->lease(search.num_threads);
 
-    if (parent->latest_time + segmentation_threshold < entry.wait_until)
+    bool interrupted = false;
+    while (!open_list.empty())
     {
+      if (deadline->expired() || (search.interrupter && search.interrupter()))
+      {
+        interrupted = true;
+        break;
+      }
 
-      // No need to assign task as timeline is not relevant
-      return nullptr;
-    }
+      // Pop the top of the open list
+      const auto top_info = open_list.top();
+      top = open_list.pop();
 
-    auto new_node = std::make_shared<Node>(*parent);
+      // The incumbent may have improved since this node was queued
+      if (!can_improve(*top))
+        continue;
 
-    // Assign the unassigned task after checking for implicit charging requests
-    if (entry.require_charge_battery)
-    {
-      // Check if a battery task already precedes the latest assignment
-      auto& assignments = new_node->assigned_tasks[entry.candidate];
-      if (assignments.empty() || !std::dynamic_pointer_cast<
-          const rmf_task::requests::ChargeBattery::Description>(
-          assignments.back().assignment.request()->description()))
+      // Check if unassigned tasks is empty -> solution found
+      if (finished(*top))
       {
-        auto charge_battery = make_charging_request(
-          entry.previous_state.time().value(), time_now);
-        const auto charge_battery_model =
-          charge_battery->description()->make_model(
-          charge_battery->booking()->earliest_start_time(),
-          config.parameters());
-        auto battery_estimate = charge_battery_model->estimate_finish(
-          entry.previous_state, constraints, *travel_estimator);
-        if (battery_estimate.has_value())
+        // Complete nodes leave the open list in the order of their cost, so
+        // the first ones to leave are the cheapest
+        if (search.candidates)
         {
-          assignments.push_back(
-            Node::AssignmentWrapper
-            { u.first,
-              Assignment
-              {
-                charge_battery,
-                battery_estimate.value().finish_state(),
-                battery_estimate.value().wait_until()
-              }
-            }
-          );
+          search.candidates->push_back(top);
+          if (search.candidates->size() < search.num_candidates)
+            continue;
+
+          return search.candidates->front();
         }
-      }
-    }
-    new_node->assigned_tasks[entry.candidate].push_back(
-      Node::AssignmentWrapper{u.first,
-        Assignment{u.second.request, entry.state, entry.wait_until}});
 
-    // Erase the assigned task from unassigned tasks
-    new_node->pop_unassigned(u.first);
+        if (!search.anytime || open_list.weight() <= 1.0)
+        {
+          // With an inflated heuristic, a cheaper node might still be waiting
+          // in the open list
+          double lowest_cost = top->cost_estimate;
+          if (open_list.weight() > 1.0)
+          {
+            lowest_cost =
+              std::min(lowest_cost, open_list.lowest_cost_estimate());
+          }
 
-    // Update states of unassigned tasks for the candidate
-    bool add_charger = false;
-    for (auto& new_u : new_node->unassigned_tasks)
-    {
-      const auto finish =
-        new_u.second.model->estimate_finish(
-        entry.state, constraints, *travel_estimator);
+          if (dropped_cost)
+            lowest_cost = std::min(lowest_cost, *dropped_cost);
 
-      if (finish.has_value())
-      {
-        new_u.second.candidates.update_candidate(
-          entry.candidate,
-          finish.value().finish_state(),
-          finish.value().wait_until(),
-          entry.state,
-          false);
-      }
-      else
-      {
-        // TODO(YV): Revisit this strategy
-        // auto battery_estimate =
-        //   config->charge_battery_request()->estimate_finish(entry.state, constraints);
-        // if (battery_estimate.has_value())
-        // {
-        //   auto new_finish =
-        //     new_u.second.request->estimate_finish(
-        //       battery_estimate.value().finish_state(),
-        //       constraints);
-        //   assert(new_finish.has_value());
-        //   new_u.second.candidates.update_candidate(
-        //     entry.candidate,
-        //     new_finish.value().finish_state(),
-        //     new_finish.value().wait_until());
-        // }
-        // else
-        // {
-        //   // Unable to reach charger
-        //   return nullptr;
-        // }
+          lower_bound = lowest_cost;
+          return top;
+        }
 
-        add_charger = true;
-        break;
+        // Keep this solution and continue with a less inflated heuristic
+        incumbent->offer(top);
+        open_list.weight(
+          std::max(1.0, open_list.weight() - anytime_weight_step));
+        continue;
       }
-    }
 
-    if (add_charger)
-    {
-      auto charge_battery = make_charging_request(
-        entry.state.time().value(), time_now);
+      // Apply possible actions to expand the node. A partial expansion
+      // checks its children against the filter once they are kept.
+      ++counters->nodes_expanded;
+      auto new_nodes = expand(
+        top, partial_expansion ? nullptr : &filter, initial_states, time_now,
+        workers.get(), equivalent_agents ? &*equivalent_agents : nullptr);
 
-      const auto charge_battery_model =
-        charge_battery->description()->make_model(
-        charge_battery->booking()->earliest_start_time(),
-        config.parameters());
-      auto battery_estimate = charge_battery_model->estimate_finish(
-        entry.state, constraints, *travel_estimator);
-      if (battery_estimate.has_value())
+      // Only keep the children that are within the margin of the node. The
+      // node goes back into the open list to stand in for the rest.
+      if (partial_expansion)
       {
-        new_node->assigned_tasks[entry.candidate].push_back(
-          { new_node->get_available_internal_id(true),
-            Assignment
-            {
-              charge_battery,
-              battery_estimate.value().finish_state(),
-              battery_estimate.value().wait_until()
-            }});
-        for (auto& new_u : new_node->unassigned_tasks)
+        const double expand_up_to = top_info.key + *partial_expansion;
+        double deferred_key = std::numeric_limits<double>::infinity();
+        double deferred_cost = deferred_key;
+        std::size_t kept = 0;
+        for (auto& n : new_nodes)
         {
-          const auto finish =
-            new_u.second.model->estimate_finish(
-            battery_estimate.value().finish_state(),
-            constraints, *travel_estimator);
-          if (finish.has_value())
+          const double key = open_list.key(*n);
+          if (key <= top_info.expanded_up_to)
+            continue;
+
+          if (key > expand_up_to)
           {
-            new_u.second.candidates.update_candidate(
-              entry.candidate, finish.value().finish_state(),
-              finish.value().wait_until(), entry.state, false);
+            deferred_key = std::min(deferred_key, key);
+            deferred_cost = std::min(deferred_cost, n->cost_estimate);
+            continue;
           }
-          else
+
+          // Children that send an agent to charge do not assign a task, and
+          // they are never filtered
+          const bool assigns_task =
+            n->unassigned_tasks.size() < top->unassigned_tasks.size();
+          if (assigns_task && filter.ignore(*n))
           {
-            // We should stop expanding this node
-            return nullptr;
+            ++counters->filter_rejections;
+            continue;
           }
+
+          new_nodes[kept++] = std::move(n);
         }
+        new_nodes.resize(kept);
 
+        if (std::isfinite(deferred_key))
+        {
+          open_list.push_deferred(
+            top, deferred_key, deferred_cost, expand_up_to);
+          counters->update_peak_open_nodes(open_list.size());
+        }
       }
-      else
+
+      // Add copies and with a newly assigned task to queue
+      for (auto& n : new_nodes)
       {
-        // Agent cannot make it back to the charger
-        return nullptr;
+        // A complete node can tighten the bound as soon as it is generated
+        if (search.branch_and_bound && finished(*n))
+        {
+          incumbent->offer(std::move(n));
+          continue;
+        }
+
+        if (can_improve(*n))
+          push(std::move(n));
       }
+
+      enforce_limit();
     }
 
-    // Update the cost estimate for new_node
-    new_node->cost_estimate = cost_calculator->compute_cost(
-      *new_node, time_now, check_priority);
-    new_node->latest_time = get_latest_time(*new_node);
+    if (search.candidates && !search.candidates->empty())
+      return search.candidates->front();
 
-    // Apply filter
-    if (filter && filter->ignore(*new_node))
+    // If the open list limit dropped every path to a solution, degrade to a
+    // greedy solution
+    if (dropped_cost && !(incumbent && incumbent->node()))
     {
-      return nullptr;
+      if (!incumbent)
+        incumbent = &anytime_incumbent.emplace();
+
+      if (auto n = greedy_solve(root, initial_states, time_now))
+        incumbent->offer(std::move(n));
     }
 
-    return new_node;
+    if (!incumbent)
+      return nullptr;
+
+    // If the search ran to completion then nothing can beat the incumbent.
+    // Otherwise the optimal node costs at least as much as the cheapest node
+    // that was still waiting to be explored.
+    const double incumbent_cost = incumbent->cost();
+    double lowest_cost = incumbent_cost;
+    if (interrupted)
+      lowest_cost = std::min(lowest_cost, open_list.lowest_cost_estimate());
+
+    if (dropped_cost)
+      lowest_cost = std::min(lowest_cost, *dropped_cost);
+
+    if (std::isfinite(lowest_cost))
+      lower_bound = lowest_cost;
 
+    return incumbent->node();
   }
 
-  ConstNodePtr expand_charger(
-    ConstNodePtr parent,
-    const std::size_t agent,
+  // Search with straight-line travel estimates for the cheapest few complete
+  // nodes. Each of them is then estimated exactly by assigning its tasks to
+  // the same agents in the same order, starting from the exact root, and the
+  // cheapest of those exact nodes is returned.
+  ConstNodePtr approximate_solve(
+    const ConstNodePtr& root,
     const std::vector<State>& initial_states,
-    rmf_traffic::Time time_now)
+    const std::size_t num_tasks,
+    rmf_traffic::Time time_now,
+    SearchOptions search,
+    const std::size_t num_candidates,
+    const ReleaseTimes* released)
   {
-    auto new_node = std::make_shared<Node>(*parent);
-    // Assign charging task to an agent
-    State state = initial_states[agent];
-    auto& assignments = new_node->assigned_tasks[agent];
+    RMF_TASK_TRACE_SPAN("TaskPlanner::approximate_solve");
+    auto approximate = make_approximate_context(initial_states);
 
-    // If the assignment set for a candidate is empty we do not want to add a
-    // charging task as this is taken care of in expand_candidate(). Without this
-    // step there is chance for the planner to get stuck in an infinite loop when
-    // a charging task is required before any other task can be assigned.
-    if (assignments.empty())
-      return nullptr;
+    std::vector<ConstRequestPtr> requests;
+    requests.reserve(root->unassigned_tasks.size());
+    for (const auto& u : root->unassigned_tasks)
+      requests.push_back(u.second.request());
+
+    // A previous plan that seeded this search is one more exact candidate
+    ConstNodePtr best = search.incumbent ? search.incumbent->node() : nullptr;
+
+    // Pruning against an incumbent would cut off every candidate except the
+    // cheapest one
+    search.anytime = false;
+    search.branch_and_bound = false;
+    search.incumbent = nullptr;
 
-    if (!assignments.empty())
+    std::vector<ConstNodePtr> candidates;
+    search.candidates = &candidates;
+    search.num_candidates = num_candidates;
+
+    TaskPlannerError error;
+    const auto approximate_root = approximate.make_initial_node(
+      initial_states, requests, time_now, error, 1, released);
+    if (approximate_root)
     {
-      if (std::dynamic_pointer_cast<
-          const rmf_task::requests::ChargeBattery::Description>(
-          assignments.back().assignment.request()->description()))
-        return nullptr;
-      state = assignments.back().assignment.finish_state();
+      std::optional<double> lower_bound;
+      approximate.solve(approximate_root, initial_states, num_tasks, time_now,
+        search, lower_bound);
     }
 
-    auto charge_battery = make_charging_request(state.time().value(), time_now);
-    const auto charge_battery_model =
-      charge_battery->description()->make_model(
-      charge_battery->booking()->earliest_start_time(),
-      config.parameters());
-    auto estimate = charge_battery_model->estimate_finish(
-      state, config.constraints(), *travel_estimator);
-    if (estimate.has_value())
+    for (const auto& candidate : candidates)
     {
-      new_node->assigned_tasks[agent].push_back(
-        Node::AssignmentWrapper
-        {
-          new_node->get_available_internal_id(true),
-          Assignment
-          {
-            charge_battery,
-            estimate.value().finish_state(),
-            estimate.value().wait_until()
-          }
-        });
-      for (auto& new_u : new_node->unassigned_tasks)
+      TaskPlanner::Assignments assignments(candidate->assigned_tasks.size());
+      for (std::size_t a = 0; a < assignments.size(); ++a)
       {
-        const auto finish =
-          new_u.second.model->estimate_finish(
-          estimate.value().finish_state(),
-          config.constraints(), *travel_estimator);
-        if (finish.has_value())
-        {
-          new_u.second.candidates.update_candidate(
-            agent,
-            finish.value().finish_state(),
-            finish.value().wait_until(),
-            state,
-            false);
-        }
-        else
-        {
-          return nullptr;
-        }
+        for (const auto& wrapper : *candidate->assigned_tasks[a])
+          assignments[a].push_back(wrapper.assignment);
       }
 
-      new_node->cost_estimate = cost_calculator->compute_cost(
-        *new_node, time_now, check_priority);
-      new_node->latest_time = get_latest_time(*new_node);
-      return new_node;
+      auto exact = warm_start(root, assignments, initial_states, time_now);
+      if (exact && (!best || exact->cost_estimate < best->cost_estimate))
+        best = std::move(exact);
     }
 
-    return nullptr;
+    if (best)
+      return best;
+
+    // The approximate search found nothing, e.g. because it ran out of time
+    return greedy_solve(root, initial_states, time_now);
   }
 
-  ConstNodePtr greedy_solve(
-    ConstNodePtr node,
+  // A copy of this Implementation that plans with the approximate stage
+  Implementation make_approximate_context(
+    const std::vector<State>& initial_states)
+  {
+    auto& stage = *approximate_stage;
+    std::call_once(stage.once, [&]()
+      {
+        // The task models work out their invariants with whatever travel
+        // estimator first asks for them, and models with the same planner
+        // share their invariants. The approximate models get a planner of
+        // their own so that they never share anything with the exact ones.
+        const auto& planner = *config.parameters().planner();
+        auto parameters = config.parameters();
+        parameters.planner(
+          std::make_shared<rmf_traffic::agv::Planner>(
+            planner.get_configuration(), planner.get_default_options()));
+
+        stage.config = config;
+        stage.config->parameters(parameters);
+        stage.travel_estimator = TravelEstimator::straight_line(parameters);
+        stage.shared_models =
+          std::make_shared<SharedModelCache>(config.model_cache_capacity());
+        stage.charger_pool =
+          make_charger_pool(*stage.config, stage.travel_estimator);
+        stage.charging_model =
+          make_charging_model(parameters, stage.charger_pool);
+      });
+
+    Implementation context(*this);
+    context.config = *stage.config;
+    context.travel_estimator = stage.travel_estimator;
+    context.shared_models = stage.shared_models;
+    context.models = std::make_shared<ModelCache>(stage.shared_models);
+    context.charger_pool = stage.charger_pool;
+    context.charging_model = stage.charging_model;
+    context.reachability = stage.charger_pool ? nullptr :
+      std::make_shared<ChargerReachability>(
+      initial_states, stage.travel_estimator,
+      config.parameters().planner()->get_configuration().graph()
+      .num_waypoints());
+    return context;
+  }
+
+  // Run greedy_solve() on a separate thread while solve() runs on this one.
+  // The greedy solution becomes the incumbent that solve() prunes against,
+  // and it is what gets returned if solve() is interrupted.
+  ConstNodePtr portfolio_solve(
+    const ConstNodePtr& initial_node,
     const std::vector<State>& initial_states,
-    rmf_traffic::Time time_now)
+    const std::size_t num_tasks,
+    rmf_traffic::Time time_now,
+    SearchOptions search,
+    std::optional<double>& lower_bound)
   {
-    while (!finished(*node))
-    {
-      ConstNodePtr next_node = nullptr;
-      for (const auto& u : node->unassigned_tasks)
+    // A warm start may have already provided an incumbent
+    std::optional<Incumbent> own_incumbent;
+    if (!search.incumbent)
+      search.incumbent = &own_incumbent.emplace(search.deterministic);
+
+    // In the deterministic mode the greedy solution is only combined with the
+    // optimal one after both searches are over, because the optimal search
+    // would otherwise prune by whichever bound it happened to see
+    Incumbent& incumbent = *search.incumbent;
+    std::optional<Incumbent> greedy_incumbent;
+    Incumbent& greedy_target = search.deterministic ?
+      greedy_incumbent.emplace(true) : incumbent;
+    std::exception_ptr greedy_error;
+    std::thread greedy_thread(
+      [&]()
       {
-        const auto& range = u.second.candidates.best_candidates();
-        for (auto it = range.begin; it != range.end; ++it)
+        try
         {
-          if (auto n = expand_candidate(
-              it, u, node, nullptr, time_now))
-          {
-            if (!next_node || (n->cost_estimate < next_node->cost_estimate))
-            {
-              next_node = std::move(n);
-            }
-          }
-          else
-          {
-            // expand_candidate returned nullptr either due to start time
-            // segmentation or insufficient charge to return to its charger.
-            // For the later case, we aim to backtrack and assign a charging
-            // task to the agent.
-            if (node->latest_time + segmentation_threshold >
-              it->second.wait_until)
-            {
-              auto parent_node = std::make_shared<Node>(*node);
-              while (!parent_node->assigned_tasks[it->second.candidate].empty())
-              {
-                parent_node->assigned_tasks[it->second.candidate].pop_back();
-                auto new_charge_node = expand_charger(
-                  parent_node,
-                  it->second.candidate,
-                  initial_states,
-                  time_now);
-                if (new_charge_node)
-                {
-                  next_node = std::move(new_charge_node);
-                  break;
-                }
-              }
-            }
-          }
+          if (auto n = greedy_solve(initial_node, initial_states, time_now))
+            greedy_target.offer(std::move(n));
         }
-      }
+        catch (...)
+        {
+          greedy_error = std::current_exception();
+        }
+      });
 
-      node = next_node;
-      assert(node);
+    ConstNodePtr optimal = nullptr;
+    try
+    {
+      optimal = solve(initial_node, initial_states, num_tasks, time_now,
+          search, lower_bound);
+    }
+    catch (...)
+    {
+      greedy_thread.join();
+      throw;
     }
 
-    return node;
+    greedy_thread.join();
+    if (greedy_error)
+      std::rethrow_exception(greedy_error);
+
+    if (greedy_incumbent.has_value())
+    {
+      if (auto n = greedy_incumbent->node())
+        incumbent.offer(std::move(n));
+    }
+
+    if (optimal)
+      incumbent.offer(std::move(optimal));
+
+    return incumbent.node();
   }
 
-  std::vector<ConstNodePtr> expand(
-    ConstNodePtr parent,
-    Filter& filter,
+  // Large neighborhood search over the solution of the segment that starts
+  // from root. Each worker repeatedly removes a few related tasks from the
+  // best solution so far, replays the rest of its assignments from root and
+  // reinserts the removed tasks with an exact search that is bounded by the
+  // best solution. The workers share the best solution and stop when the
+  // budget runs out.
+  ConstNodePtr refine(
+    const ConstNodePtr& root,
+    ConstNodePtr solution,
     const std::vector<State>& initial_states,
-    rmf_traffic::Time time_now)
+    const std::size_t num_tasks,
+    rmf_traffic::Time time_now,
+    const SearchOptions& search,
+    const rmf_traffic::Duration budget,
+    const std::size_t num_threads)
   {
-    std::vector<ConstNodePtr> new_nodes;
-    new_nodes.reserve(
-      parent->unassigned_tasks.size() + parent->assigned_tasks.size());
-    for (const auto& u : parent->unassigned_tasks)
+    std::size_t num_removable = 0;
+    for (const auto& assignments : solution->assigned_tasks)
     {
-      const auto& range = u.second.candidates.best_candidates();
-      for (auto it = range.begin; it != range.end; it++)
+      for (const auto& a : *assignments)
       {
-        if (auto new_node = expand_candidate(
-            it, u, parent, &filter, time_now))
-          new_nodes.push_back(std::move(new_node));
+        if (!a.generated())
+          ++num_removable;
       }
     }
 
-    // Assign charging task to each robot
-    for (std::size_t i = 0; i < parent->assigned_tasks.size(); ++i)
+    // Removing a single task and putting it back cannot improve anything
+    if (num_removable < 2)
+      return solution;
+
+    const auto finish_time = std::chrono::steady_clock::now() + budget;
+    const auto out_of_time = [&]()
+      {
+        return deadline->expired()
+          || std::chrono::steady_clock::now() >= finish_time
+          || (search.interrupter && search.interrupter());
+      };
+
+    Incumbent incumbent(search.deterministic);
+    incumbent.offer(std::move(solution));
+
+    if (search.deterministic)
     {
-      if (auto new_node = expand_charger(
-          parent, i, initial_states, time_now))
-        new_nodes.push_back(std::move(new_node));
+      return refine_in_rounds(
+        root, incumbent, initial_states, num_tasks, time_now, search,
+        finish_time, num_threads);
     }
 
-    return new_nodes;
+    const auto work = [&](const std::size_t worker)
+      {
+        std::mt19937 rng(static_cast<std::mt19937::result_type>(worker));
+        SearchOptions reinsert = search;
+        reinsert.interrupter = out_of_time;
+        reinsert.num_threads = 1;
+        reinsert.anytime = false;
+        reinsert.heuristic_weight = 1.0;
+        reinsert.incumbent = &incumbent;
+
+        while (!out_of_time())
+        {
+          const auto partial = remove_related_tasks(
+            root, *incumbent.node(), initial_states, time_now, rng);
+          if (!partial)
+            continue;
+
+          std::optional<double> lower_bound;
+          if (auto n = solve(partial, initial_states, num_tasks, time_now,
+            reinsert, lower_bound))
+            incumbent.offer(std::move(n));
+        }
+      };
+
+    if (num_threads > 1)
+    {
+      const auto workers = worker_pool->lease(num_threads);
+      workers->run(num_threads, work);
+    }
+    else
+    {
+      work(0);
+    }
+
+    return incumbent.node();
   }
 
-  bool finished(const Node& node)
+  // The deterministic version of refine(). In each round every worker makes
+  // one attempt on the best solution of the previous round, with a bound
+  // that only it can see, and the results are offered in the order of the
+  // workers. The refinement time is only checked between rounds.
+  ConstNodePtr refine_in_rounds(
+    const ConstNodePtr& root,
+    Incumbent& incumbent,
+    const std::vector<State>& initial_states,
+    const std::size_t num_tasks,
+    rmf_traffic::Time time_now,
+    const SearchOptions& search,
+    const rmf_traffic::Time finish_time,
+    const std::size_t num_threads)
   {
-    for (const auto& u : node.unassigned_tasks)
+    const auto interrupted = [&]()
+      {
+        return deadline->expired()
+          || (search.interrupter && search.interrupter());
+      };
+
+    std::vector<std::mt19937> rngs;
+    for (std::size_t i = 0; i < num_threads; ++i)
+      rngs.emplace_back(static_cast<std::mt19937::result_type>(i));
+
+    std::vector<ConstNodePtr> results(num_threads);
+    ConstNodePtr best;
+    const auto attempt = [&](const std::size_t worker)
+      {
+        results[worker] = nullptr;
+        const auto partial = remove_related_tasks(
+          root, *best, initial_states, time_now, rngs[worker]);
+        if (!partial)
+          return;
+
+        Incumbent bound(true);
+        bound.offer(best);
+
+        SearchOptions reinsert = search;
+        reinsert.interrupter = interrupted;
+        reinsert.num_threads = 1;
+        reinsert.anytime = false;
+        reinsert.heuristic_weight = 1.0;
+        reinsert.incumbent = &bound;
+
+        std::optional<double> lower_bound;
+        results[worker] = solve(partial, initial_states, num_tasks, time_now,
+            reinsert, lower_bound);
+      };
+
+    WorkerPool::Lease workers;
+    if (num_threads > 1)
+      workers = worker_pool->lease(num_threads);
+
+    while (!interrupted() && std::chrono::steady_clock::now() < finish_time)
     {
-      const auto range = u.second.candidates.best_candidates();
-      for (auto it = range.begin; it != range.end; ++it)
+      best = incumbent.node();
+      if (workers)
+        workers->run(num_threads, attempt);
+      else
+        attempt(0);
+
+      for (auto& n : results)
       {
-        const auto wait_time = it->second.wait_until;
-        if (wait_time <= node.latest_time + segmentation_threshold)
-          return false;
+        if (n)
+          incumbent.offer(std::move(n));
       }
     }
 
-    return true;
+    return incumbent.node();
   }
 
-  ConstNodePtr solve(
-    ConstNodePtr initial_node,
+  // Rebuild a solution from root without a few tasks that are related to a
+  // randomly chosen one, either by their finish time or by the location where
+  // they finish. Returns nullptr if the remaining assignments cannot be
+  // replayed.
+  ConstNodePtr remove_related_tasks(
+    const ConstNodePtr& root,
+    const Node& solution,
     const std::vector<State>& initial_states,
-    const std::size_t num_tasks,
     rmf_traffic::Time time_now,
-    std::function<bool()> interrupter)
+    std::mt19937& rng)
   {
-    using PriorityQueue = std::priority_queue<
-      ConstNodePtr,
-      std::vector<ConstNodePtr>,
-      LowestCostEstimate>;
+    struct Removable
+    {
+      std::size_t internal_id;
+      std::optional<std::size_t> waypoint;
+      rmf_traffic::Time finish_time;
+    };
+
+    std::vector<Removable> tasks;
+    for (const auto& assignments : solution.assigned_tasks)
+    {
+      for (const auto& a : *assignments)
+      {
+        if (a.generated())
+          continue;
 
-    PriorityQueue priority_queue;
-    priority_queue.push(std::move(initial_node));
+        const auto& state = a.assignment.finish_state();
+        tasks.push_back(
+          {a.internal_id, state.waypoint(), state.time().value()});
+      }
+    }
 
-    Filter filter{FilterType::Hash, num_tasks};
-    ConstNodePtr top = nullptr;
+    const auto& planner_config = config.parameters().planner()
+      ->get_configuration();
+    const auto& graph = planner_config.graph();
+    const double speed =
+      planner_config.vehicle_traits().linear().get_nominal_velocity();
 
-    while (!priority_queue.empty() && !(interrupter && interrupter()))
-    {
-      top = priority_queue.top();
+    const Removable seed = tasks[rng() % tasks.size()];
+    const bool by_location = seed.waypoint.has_value() && rng() % 2 == 0;
+    const auto relatedness = [&](const Removable& task)
+      {
+        if (by_location && task.waypoint.has_value())
+        {
+          const Eigen::Vector2d p0 =
+            graph.get_waypoint(*seed.waypoint).get_location();
+          const Eigen::Vector2d p1 =
+            graph.get_waypoint(*task.waypoint).get_location();
+          return (p1 - p0).norm() / speed;
+        }
 
-      // Pop the top of the priority queue
-      priority_queue.pop();
+        return std::abs(
+          rmf_traffic::time::to_seconds(task.finish_time - seed.finish_time));
+      };
 
-      // Check if unassigned tasks is empty -> solution found
-      if (finished(*top))
+    std::vector<std::pair<double, std::size_t>> ranked;
+    ranked.reserve(tasks.size());
+    for (const auto& task : tasks)
+      ranked.push_back({relatedness(task), task.internal_id});
+
+    const std::size_t num_removed = std::min(
+      tasks.size(), 2 + rng() % (refinement_max_removed - 1));
+    std::partial_sort(
+      ranked.begin(), ranked.begin() + num_removed, ranked.end());
+
+    std::vector<std::size_t> removed;
+    for (std::size_t i = 0; i < num_removed; ++i)
+      removed.push_back(ranked[i].second);
+
+    ConstNodePtr node = root;
+    for (std::size_t agent = 0; agent < solution.assigned_tasks.size(); ++agent)
+    {
+      for (const auto& a : *solution.assigned_tasks[agent])
       {
-        return top;
-      }
+        if (a.generated())
+        {
+          // The charge may no longer be needed without the removed tasks
+          if (auto n = expand_charger(node, agent, initial_states, time_now))
+            node = std::move(n);
+
+          continue;
+        }
 
-      // Apply possible actions to expand the node
-      const auto new_nodes = expand(
-        top, filter, initial_states, time_now);
+        if (std::find(removed.begin(), removed.end(), a.internal_id)
+          != removed.end())
+          continue;
 
-      // Add copies and with a newly assigned task to queue
-      for (const auto& n : new_nodes)
-        priority_queue.push(n);
+        const auto u = node->unassigned_tasks.find(a.internal_id);
+        if (u == node->unassigned_tasks.end())
+          return nullptr;
+
+        const auto* entry = u->second.candidates->find(agent);
+        if (!entry)
+          return nullptr;
+
+        node = expand_candidate(*entry, *u, node, nullptr, time_now);
+        if (!node)
+          return nullptr;
+      }
     }
 
-    return nullptr;
+    return node;
   }
 
 };
 
+// ============================================================================
+class TaskPlanner::AsyncPlan::Implementation
+{
+public:
+
+  std::shared_future<Result> result;
+  std::shared_ptr<std::atomic_bool> cancelled;
+
+  static AsyncPlan make(
+    std::shared_future<Result> result,
+    std::shared_ptr<std::atomic_bool> cancelled)
+  {
+    AsyncPlan plan;
+    plan._pimpl = std::make_shared<Implementation>(
+      Implementation{std::move(result), std::move(cancelled)});
+    return plan;
+  }
+};
+
+// ============================================================================
+auto TaskPlanner::AsyncPlan::result() const -> const std::shared_future<Result>&
+{
+  return _pimpl->result;
+}
+
+// ============================================================================
+void TaskPlanner::AsyncPlan::cancel()
+{
+  _pimpl->cancelled->store(true);
+}
+
+// ============================================================================
+bool TaskPlanner::AsyncPlan::cancelled() const
+{
+  return _pimpl->cancelled->load();
+}
+
+// ============================================================================
+TaskPlanner::AsyncPlan::AsyncPlan()
+{
+  // Do nothing
+}
+
 // ============================================================================
 TaskPlanner::TaskPlanner(
   Configuration configuration,
@@ -1111,7 +4181,7 @@ TaskPlanner::TaskPlanner(
       Implementation{
         configuration,
         default_options,
-        std::make_shared<TravelEstimator>(configuration.parameters()),
+        make_travel_estimator(configuration),
         std::string(Implementation::DefaultTaskPlannerName)
       }))
 {
@@ -1127,7 +4197,7 @@ TaskPlanner::TaskPlanner(
       Implementation{
         configuration,
         default_options,
-        std::make_shared<TravelEstimator>(configuration.parameters()),
+        make_travel_estimator(configuration),
         planner_id
       }))
 {
@@ -1140,13 +4210,11 @@ auto TaskPlanner::plan(
   std::vector<State> agents,
   std::vector<ConstRequestPtr> requests) -> Result
 {
-  return _pimpl->complete_solve(
+  return _pimpl->plan_in_context(
     time_now,
     agents,
     requests,
-    _pimpl->default_options.interrupter(),
-    _pimpl->default_options.finishing_request(),
-    _pimpl->default_options.greedy());
+    _pimpl->default_options);
 }
 
 // ============================================================================
@@ -1156,13 +4224,197 @@ auto TaskPlanner::plan(
   std::vector<ConstRequestPtr> requests,
   Options options) -> Result
 {
-  return _pimpl->complete_solve(
+  return _pimpl->plan_in_context(
+    time_now,
+    agents,
+    requests,
+    options);
+}
+
+// ============================================================================
+auto TaskPlanner::replan(
+  rmf_traffic::Time time_now,
+  std::vector<State> agents,
+  const Assignments& previous,
+  std::vector<ConstRequestPtr> new_requests,
+  const std::unordered_set<std::string>& cancelled_requests) -> Result
+{
+  return replan(
+    time_now,
+    std::move(agents),
+    previous,
+    std::move(new_requests),
+    cancelled_requests,
+    _pimpl->default_options);
+}
+
+// ============================================================================
+auto TaskPlanner::replan(
+  rmf_traffic::Time time_now,
+  std::vector<State> agents,
+  const Assignments& previous,
+  std::vector<ConstRequestPtr> new_requests,
+  const std::unordered_set<std::string>& cancelled_requests,
+  Options options) -> Result
+{
+  // New requests replace any previous request that has the same ID
+  std::unordered_set<std::string> ids;
+  std::vector<ConstRequestPtr> requests;
+  for (auto& request : new_requests)
+  {
+    const auto& id = request->booking()->id();
+    if (cancelled_requests.count(id) == 0 && ids.insert(id).second)
+      requests.push_back(std::move(request));
+  }
+
+  // Pinned assignments are kept out of the search entirely. Their agents are
+  // planned from the finish state of their last pinned assignment, and only
+  // the assignments after those seed the search.
+  const auto pinned_horizon = options.pinned_horizon();
+  const bool pinning =
+    options.pinned_assignments() > 0 || pinned_horizon.has_value();
+  Assignments pinned;
+  Assignments remaining;
+  if (pinning)
+  {
+    pinned.resize(previous.size());
+    remaining.resize(previous.size());
+    for (std::size_t a = 0; a < previous.size(); ++a)
+    {
+      for (std::size_t i = 0; i < previous[a].size(); ++i)
+      {
+        const auto& assignment = previous[a][i];
+        const auto& id = assignment.request()->booking()->id();
+        const bool within = i < options.pinned_assignments()
+          || (pinned_horizon.has_value()
+          && assignment.deployment_time() < *pinned_horizon);
+        const bool unchanged =
+          cancelled_requests.count(id) == 0 && ids.count(id) == 0;
+
+        if (a < agents.size() && remaining[a].empty() && within && unchanged)
+          pinned[a].push_back(assignment);
+        else
+          remaining[a].push_back(assignment);
+      }
+
+      if (!pinned[a].empty())
+        agents[a] = pinned[a].back().finish_state();
+    }
+
+    for (const auto& agent : pinned)
+    {
+      for (const auto& assignment : agent)
+        ids.insert(assignment.request()->booking()->id());
+    }
+  }
+
+  const Assignments& unpinned = pinning ? remaining : previous;
+  for (const auto& agent : unpinned)
+  {
+    for (const auto& assignment : agent)
+    {
+      const auto& request = assignment.request();
+      const auto& id = request->booking()->id();
+      if (request->booking()->automatic() || cancelled_requests.count(id) > 0)
+        continue;
+
+      if (ids.insert(id).second)
+        requests.push_back(request);
+    }
+  }
+
+  auto result = _pimpl->plan_in_context(
     time_now,
     agents,
     requests,
-    options.interrupter(),
-    options.finishing_request(),
-    options.greedy());
+    options,
+    &unpinned);
+
+  auto* assignments = std::get_if<Assignments>(&result);
+  if (!pinning || !assignments)
+    return result;
+
+  for (std::size_t a = 0; a < pinned.size() && a < assignments->size(); ++a)
+  {
+    auto& agent = (*assignments)[a];
+    agent.insert(agent.begin(), pinned[a].begin(), pinned[a].end());
+  }
+
+  return result;
+}
+
+// ============================================================================
+auto TaskPlanner::plan_async(
+  rmf_traffic::Time time_now,
+  std::vector<State> agents,
+  std::vector<ConstRequestPtr> requests,
+  std::optional<Options> options,
+  Options::SegmentCallback progress) const -> AsyncPlan
+{
+  auto promise = std::make_shared<std::promise<Result>>();
+  auto cancelled = std::make_shared<std::atomic_bool>(false);
+  auto plan = AsyncPlan::Implementation::make(
+    promise->get_future().share(), cancelled);
+
+  Options plan_options = options.has_value() ?
+    std::move(*options) : _pimpl->default_options;
+  if (progress)
+  {
+    auto segment_callback = plan_options.segment_callback();
+    plan_options.segment_callback(
+      [segment_callback = std::move(segment_callback),
+      progress = std::move(progress)](const Assignments& segment)
+      {
+        if (segment_callback)
+          segment_callback(segment);
+
+        progress(segment);
+      });
+  }
+
+  // The copy must not keep the pool alive, or else the last plan to finish
+  // could end up destroying the pool from one of its own threads
+  auto planner = std::make_shared<TaskPlanner>(*this);
+  planner->_pimpl->cancelled = std::move(cancelled);
+  planner->_pimpl->async_workers = nullptr;
+  planner->_pimpl->latest = std::make_shared<Implementation::LatestPlan>();
+
+  _pimpl->async_workers->get()->post(
+    [planner = std::move(planner),
+    promise = std::move(promise),
+    time_now,
+    agents = std::move(agents),
+    requests = std::move(requests),
+    plan_options = std::move(plan_options)]() mutable
+    {
+      try
+      {
+        promise->set_value(
+          planner->plan(
+            time_now, std::move(agents), std::move(requests),
+            std::move(plan_options)));
+      }
+      catch (...)
+      {
+        promise->set_exception(std::current_exception());
+      }
+    });
+
+  return plan;
+}
+
+// ============================================================================
+std::optional<double> TaskPlanner::last_suboptimality_bound() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->latest->mutex);
+  return _pimpl->latest->suboptimality_bound;
+}
+
+// ============================================================================
+auto TaskPlanner::last_statistics() const -> Statistics
+{
+  std::lock_guard<std::mutex> lock(_pimpl->latest->mutex);
+  return _pimpl->latest->statistics;
 }
 
 // ============================================================================
@@ -1176,6 +4428,263 @@ auto TaskPlanner::compute_cost(const Assignments& assignments) const -> double
   return cost_calculator->compute_cost(assignments);
 }
 
+// ============================================================================
+std::vector<double> TaskPlanner::compute_costs(
+  const std::vector<const Assignments*>& assignments,
+  const std::size_t num_threads) const
+{
+  // Resolve the cost calculator once for the whole batch
+  auto cost_calculator = _pimpl->config.cost_calculator();
+  if (!cost_calculator)
+    cost_calculator = rmf_task::BinaryPriorityScheme::make_cost_calculator();
+
+  std::vector<double> costs(assignments.size(), 0.0);
+  const std::size_t threads = std::min(
+    resolve_thread_count(num_threads), assignments.size());
+
+  if (threads <= 1)
+  {
+    for (std::size_t i = 0; i < assignments.size(); ++i)
+      costs[i] = cost_calculator->compute_cost(*assignments[i]);
+
+    return costs;
+  }
+
+  // Each job evaluates a contiguous block of the sets and writes into its own
+  // range of the result
+  const auto workers = _pimpl->worker_pool->lease(threads);
+  workers->run(
+    threads,
+    [&](const std::size_t job)
+    {
+      const std::size_t begin = job * assignments.size() / threads;
+      const std::size_t end = (job + 1) * assignments.size() / threads;
+      for (std::size_t i = begin; i < end; ++i)
+        costs[i] = cost_calculator->compute_cost(*assignments[i]);
+    });
+
+  return costs;
+}
+
+// ============================================================================
+bool TaskPlanner::AssignmentDiff::empty() const
+{
+  for (const auto& agent : agents)
+  {
+    if (!agent.changes.empty() || !agent.removed.empty())
+      return false;
+  }
+
+  return true;
+}
+
+// ============================================================================
+auto TaskPlanner::diff(
+  const Assignments& previous,
+  const Assignments& next) -> AssignmentDiff
+{
+  const auto is_charging = [](const Assignment& assignment)
+    {
+      return static_cast<bool>(std::dynamic_pointer_cast<
+          const rmf_task::requests::ChargeBattery::Description>(
+          assignment.request()->description()));
+    };
+
+  const auto same = [&](const Assignment& a, const Assignment& b)
+    {
+      const bool a_charging = is_charging(a);
+      if (a_charging || is_charging(b))
+        return a_charging && is_charging(b);
+
+      return a.request()->booking()->id() == b.request()->booking()->id();
+    };
+
+  using Location = std::pair<std::size_t, std::size_t>;
+  AssignmentDiff output;
+  output.agents.resize(next.size());
+  for (std::size_t a = 0; a < next.size(); ++a)
+  {
+    auto& prefix = output.agents[a].unchanged_prefix;
+    if (a >= previous.size())
+      continue;
+
+    const auto& before = previous[a];
+    const auto& after = next[a];
+    while (prefix < before.size() && prefix < after.size()
+      && same(before[prefix], after[prefix]))
+      ++prefix;
+  }
+
+  // Where each request was before, apart from the unchanged prefixes
+  std::unordered_map<std::string, Location> previous_location;
+  for (std::size_t a = 0; a < previous.size(); ++a)
+  {
+    const std::size_t prefix =
+      a < next.size() ? output.agents[a].unchanged_prefix : 0;
+    for (std::size_t i = prefix; i < previous[a].size(); ++i)
+    {
+      const auto& assignment = previous[a][i];
+      if (!is_charging(assignment))
+        previous_location[assignment.request()->booking()->id()] = {a, i};
+    }
+  }
+
+  // Which of the previous assignments are still held by the same agent
+  std::vector<std::vector<bool>> kept(previous.size());
+  for (std::size_t a = 0; a < previous.size(); ++a)
+    kept[a].resize(previous[a].size(), false);
+
+  for (std::size_t a = 0; a < next.size(); ++a)
+  {
+    auto& agent = output.agents[a];
+    for (std::size_t i = agent.unchanged_prefix; i < next[a].size(); ++i)
+    {
+      const auto& assignment = next[a][i];
+      if (is_charging(assignment))
+      {
+        agent.changes.push_back({AssignmentDiff::Kind::Charger, i, {}, {}});
+        continue;
+      }
+
+      const auto it =
+        previous_location.find(assignment.request()->booking()->id());
+      if (it == previous_location.end())
+      {
+        agent.changes.push_back({AssignmentDiff::Kind::Added, i, {}, {}});
+        continue;
+      }
+
+      const auto [previous_agent, previous_index] = it->second;
+      const auto kind = previous_agent == a ?
+        AssignmentDiff::Kind::Shifted : AssignmentDiff::Kind::Moved;
+      if (previous_agent == a)
+        kept[a][previous_index] = true;
+
+      agent.changes.push_back({kind, i, previous_agent, previous_index});
+    }
+  }
+
+  for (std::size_t a = 0; a < previous.size() && a < next.size(); ++a)
+  {
+    auto& agent = output.agents[a];
+    for (std::size_t i = agent.unchanged_prefix; i < previous[a].size(); ++i)
+    {
+      if (!kept[a][i])
+        agent.removed.push_back(i);
+    }
+  }
+
+  return output;
+}
+
+// ============================================================================
+auto TaskPlanner::evaluate_insertion(
+  const rmf_traffic::Time time_now,
+  const std::vector<State>& agents,
+  const Assignments& current_assignments,
+  ConstRequestPtr new_request) const -> std::optional<Insertion>
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (agents.size() != current_assignments.size())
+  {
+    throw std::invalid_argument(
+      "[TaskPlanner::evaluate_insertion] There are ["
+      + std::to_string(agents.size()) + "] agents but ["
+      + std::to_string(current_assignments.size())
+      + "] sets of assignments");
+  }
+  // *INDENT-ON*
+
+  auto cost_calculator = _pimpl->config.cost_calculator();
+  if (!cost_calculator)
+    cost_calculator = rmf_task::BinaryPriorityScheme::make_cost_calculator();
+
+  const auto& parameters = _pimpl->config.parameters();
+  const auto& constraints = _pimpl->config.constraints();
+  const auto& travel_estimator = *_pimpl->travel_estimator;
+
+  // The models of recurring requests are still reused from earlier plan()
+  // calls, but the current plan() call does not share the models made here
+  ModelCache models(_pimpl->shared_models);
+  const auto model_of = [&](const ConstRequestPtr& request)
+    {
+      const auto earliest_start_time = std::max(
+        time_now, request->booking()->earliest_start_time());
+      const auto model = models.get(
+        request, earliest_start_time, parameters, travel_estimator);
+      model->materialize(travel_estimator);
+      return model;
+    };
+
+  const auto new_model = model_of(new_request);
+  std::vector<std::vector<Task::ConstModelPtr>> current_models;
+  current_models.reserve(current_assignments.size());
+  for (const auto& assignments : current_assignments)
+  {
+    auto& agent_models = current_models.emplace_back();
+    agent_models.reserve(assignments.size());
+    for (const auto& assignment : assignments)
+      agent_models.push_back(model_of(assignment.request()));
+  }
+
+  const double current_cost =
+    cost_calculator->compute_cost(current_assignments);
+
+  std::optional<Insertion> best;
+  for (std::size_t a = 0; a < agents.size(); ++a)
+  {
+    const auto& current = current_assignments[a];
+    for (std::size_t p = 0; p <= current.size(); ++p)
+    {
+      const State& start = p == 0 ? agents[a] : current[p-1].finish_state();
+      auto finish =
+        FinishEstimator(start, constraints, travel_estimator)(*new_model);
+      if (!finish.has_value())
+        continue;
+
+      std::vector<Assignment> sequence;
+      sequence.reserve(current.size() + 1);
+      sequence.insert(sequence.end(), current.begin(), current.begin() + p);
+      sequence.emplace_back(
+        new_request, std::move(finish->finish_state), finish->wait_until);
+
+      // Everything that used to come after the position now starts later
+      bool feasible = true;
+      for (std::size_t i = p; i < current.size(); ++i)
+      {
+        auto next = FinishEstimator(
+          sequence.back().finish_state(), constraints, travel_estimator)(
+          *current_models[a][i]);
+
+        if (!next.has_value())
+        {
+          feasible = false;
+          break;
+        }
+
+        sequence.emplace_back(
+          current[i].request(),
+          std::move(next->finish_state),
+          next->wait_until);
+      }
+
+      if (!feasible)
+        continue;
+
+      auto candidate = current_assignments;
+      candidate[a] = std::move(sequence);
+      const double cost = cost_calculator->compute_cost(candidate);
+      if (!best.has_value() || cost < best->cost)
+      {
+        best = Insertion{
+          a, p, cost, cost - current_cost, std::move(candidate)};
+      }
+    }
+  }
+
+  return best;
+}
+
 // ============================================================================
 const rmf_task::TaskPlanner::Configuration& TaskPlanner::configuration()
 const
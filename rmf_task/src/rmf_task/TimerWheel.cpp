@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/TimerWheel.hpp>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+// Each level of the wheel has 2^SlotBits slots, and each slot of a level
+// covers one whole turn of the level below it
+constexpr unsigned int SlotBits = 8;
+constexpr std::size_t NumSlots = std::size_t(1) << SlotBits;
+constexpr std::size_t SlotMask = NumSlots - 1;
+constexpr std::size_t NumLevels = 4;
+
+// Timers that are further out than all of the levels wait in one extra list
+// until the top level comes around
+constexpr std::size_t Overflow = NumLevels * NumSlots;
+
+} // anonymous namespace
+
+//==============================================================================
+class TimerWheel::Implementation
+{
+public:
+
+  using SteadyClock = std::chrono::steady_clock;
+
+  // The timers are kept in a pool of nodes that are linked into the slots.
+  // A node is reused once its timer fires or is canceled, and its generation
+  // tells the IDs of its different timers apart.
+  struct Node
+  {
+    Callback callback;
+    uint64_t expiry = 0;
+    std::size_t prev = none;
+    std::size_t next = none;
+    std::size_t slot = none;
+    uint32_t generation = 0;
+  };
+
+  Implementation(rmf_traffic::Duration resolution_)
+  : resolution(std::max(resolution_, rmf_traffic::Duration(1)))
+  {
+    slots.fill(none);
+  }
+
+  ~Implementation()
+  {
+    if (!driver.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_one();
+    driver.join();
+  }
+
+  static Id make_id(std::size_t index, uint32_t generation)
+  {
+    return (static_cast<uint64_t>(generation) << 32) | index;
+  }
+
+  // Pick the slot for a timer. The lowest level whose higher bits match the
+  // current tick is the one that will come around to the timer first.
+  std::size_t slot_for(uint64_t expiry) const
+  {
+    if (expiry <= now)
+      return now & SlotMask;
+
+    for (std::size_t level = 0; level < NumLevels; ++level)
+    {
+      const auto shift = SlotBits * (level + 1);
+      if ((expiry >> shift) == (now >> shift))
+        return level * NumSlots + ((expiry >> (SlotBits * level)) & SlotMask);
+    }
+
+    return Overflow;
+  }
+
+  void link(std::size_t index)
+  {
+    auto& node = nodes[index];
+    node.slot = slot_for(node.expiry);
+    node.prev = none;
+    node.next = slots[node.slot];
+    if (node.next != none)
+      nodes[node.next].prev = index;
+
+    slots[node.slot] = index;
+  }
+
+  void unlink(std::size_t index)
+  {
+    auto& node = nodes[index];
+    if (node.prev != none)
+      nodes[node.prev].next = node.next;
+    else
+      slots[node.slot] = node.next;
+
+    if (node.next != none)
+      nodes[node.next].prev = node.prev;
+
+    node.slot = none;
+  }
+
+  void release(std::size_t index)
+  {
+    auto& node = nodes[index];
+    node.callback = nullptr;
+    ++node.generation;
+    free.push_back(index);
+    --count;
+  }
+
+  Id arm(uint64_t ticks, Callback callback)
+  {
+    std::size_t index;
+    if (free.empty())
+    {
+      index = nodes.size();
+      nodes.emplace_back();
+    }
+    else
+    {
+      index = free.back();
+      free.pop_back();
+    }
+
+    auto& node = nodes[index];
+    node.callback = std::move(callback);
+    node.expiry = now + std::max<uint64_t>(ticks, 1);
+    link(index);
+    ++count;
+
+    return make_id(index, node.generation);
+  }
+
+  bool cancel(Id id)
+  {
+    const std::size_t index = id & std::numeric_limits<uint32_t>::max();
+    const auto generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes.size())
+      return false;
+
+    const auto& node = nodes[index];
+    if (node.generation != generation || node.slot == none)
+      return false;
+
+    unlink(index);
+    release(index);
+    return true;
+  }
+
+  // Move the timers of a slot to wherever they belong now
+  void cascade(std::size_t slot)
+  {
+    auto index = slots[slot];
+    slots[slot] = none;
+    while (index != none)
+    {
+      const auto next = nodes[index].next;
+      link(index);
+      index = next;
+    }
+  }
+
+  // Move forward by some ticks while the mutex is locked and collect the
+  // callbacks of every timer that expires
+  void tick(std::size_t ticks, std::vector<Callback>& fired)
+  {
+    for (; ticks > 0; --ticks)
+    {
+      if (count == 0)
+      {
+        // Nothing is armed, so every slot is empty and there is nothing to
+        // move around
+        now += ticks;
+        return;
+      }
+
+      ++now;
+
+      // When a level finishes a turn, pull down the next slot of the level
+      // above it. The highest levels go first so their timers can keep
+      // falling through the lower levels during the same tick.
+      std::size_t turned = 0;
+      while (turned < NumLevels
+        && (now & ((uint64_t(1) << (SlotBits * (turned + 1))) - 1)) == 0)
+      {
+        ++turned;
+      }
+
+      for (std::size_t level = turned; level > 0; --level)
+      {
+        if (level == NumLevels)
+          cascade(Overflow);
+        else
+          cascade(level * NumSlots + ((now >> (SlotBits * level)) & SlotMask));
+      }
+
+      const std::size_t slot = now & SlotMask;
+      auto index = slots[slot];
+      slots[slot] = none;
+      while (index != none)
+      {
+        auto& node = nodes[index];
+        const auto next = node.next;
+        node.slot = none;
+        fired.push_back(std::move(node.callback));
+        release(index);
+        index = next;
+      }
+    }
+  }
+
+  // Move the wheel of the shared() instance forward in real time
+  void drive()
+  {
+    anchor = SteadyClock::now();
+    driver = std::thread([this]() { run(); });
+  }
+
+  void run()
+  {
+    std::vector<Callback> fired;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop)
+    {
+      if (count == 0)
+      {
+        wake.wait(lock);
+        continue;
+      }
+
+      const auto next_tick = anchor + resolution;
+      if (SteadyClock::now() < next_tick)
+      {
+        wake.wait_until(lock, next_tick);
+        continue;
+      }
+
+      const auto ticks = static_cast<std::size_t>(
+        (SteadyClock::now() - anchor) / resolution);
+      anchor += ticks * resolution;
+      tick(ticks, fired);
+
+      lock.unlock();
+      for (auto& callback : fired)
+        callback();
+
+      fired.clear();
+      lock.lock();
+    }
+  }
+
+  rmf_traffic::Duration resolution;
+  std::array<std::size_t, Overflow + 1> slots;
+  std::vector<Node> nodes;
+  std::vector<std::size_t> free;
+  std::size_t count = 0;
+  uint64_t now = 0;
+
+  mutable std::mutex mutex;
+
+  // These are only used by the shared() wheel. The anchor is the moment that
+  // the current tick began.
+  std::condition_variable wake;
+  std::thread driver;
+  SteadyClock::time_point anchor;
+  bool stop = false;
+};
+
+//==============================================================================
+TimerWheel::TimerWheel(rmf_traffic::Duration resolution)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>(resolution))
+{
+  // Do nothing
+}
+
+//==============================================================================
+TimerWheel& TimerWheel::shared()
+{
+  static TimerWheel wheel;
+  static const bool driven = (wheel._pimpl->drive(), true);
+  (void)(driven);
+  return wheel;
+}
+
+//==============================================================================
+auto TimerWheel::arm(rmf_traffic::Duration delay, Callback callback) -> Id
+{
+  const auto resolution = _pimpl->resolution;
+  if (delay < rmf_traffic::Duration(0))
+    delay = rmf_traffic::Duration(0);
+
+  Id id;
+  bool was_idle;
+  {
+    std::lock_guard<std::mutex> lock(_pimpl->mutex);
+    was_idle = _pimpl->count == 0;
+
+    uint64_t ticks;
+    if (_pimpl->driver.joinable())
+    {
+      // Count from the moment that the current tick began, so that the timer
+      // never fires before its delay has passed
+      const auto now = Implementation::SteadyClock::now();
+      if (was_idle)
+        _pimpl->anchor = now;
+
+      const auto wait = now + delay - _pimpl->anchor;
+      ticks = (wait + resolution - rmf_traffic::Duration(1)) / resolution;
+    }
+    else
+    {
+      ticks = (delay + resolution - rmf_traffic::Duration(1)) / resolution;
+    }
+
+    id = _pimpl->arm(ticks, std::move(callback));
+  }
+
+  if (was_idle)
+    _pimpl->wake.notify_one();
+
+  return id;
+}
+
+//==============================================================================
+bool TimerWheel::cancel(const Id id)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->cancel(id);
+}
+
+//==============================================================================
+std::size_t TimerWheel::advance(const std::size_t ticks)
+{
+  std::vector<Callback> fired;
+  {
+    std::lock_guard<std::mutex> lock(_pimpl->mutex);
+    _pimpl->tick(ticks, fired);
+  }
+
+  for (auto& callback : fired)
+    callback();
+
+  return fired.size();
+}
+
+//==============================================================================
+std::size_t TimerWheel::size() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->count;
+}
+
+//==============================================================================
+rmf_traffic::Duration TimerWheel::resolution() const
+{
+  return _pimpl->resolution;
+}
+
+} // namespace rmf_task
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/Trace.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+struct Event
+{
+  const char* name;
+  const char* category;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point finish;
+  std::size_t thread;
+};
+
+//==============================================================================
+class Recorder
+{
+public:
+
+  static Recorder& get()
+  {
+    static Recorder recorder;
+    return recorder;
+  }
+
+  // Threads are numbered in the order that they first finish a span, which
+  // is easier to read on a timeline than the hash of their IDs
+  static std::size_t thread_number()
+  {
+    static std::atomic_size_t next = 1;
+    thread_local const std::size_t number = next++;
+    return number;
+  }
+
+  void start()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _events.clear();
+    _origin = std::chrono::steady_clock::now();
+    _recording.store(true, std::memory_order_release);
+  }
+
+  void stop()
+  {
+    _recording.store(false, std::memory_order_release);
+  }
+
+  bool recording() const
+  {
+    return _recording.load(std::memory_order_acquire);
+  }
+
+  void record(Event event)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Drop spans that began before the current recording was started
+    if (!recording() || event.start < _origin)
+      return;
+
+    _events.push_back(event);
+  }
+
+  std::size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _events.size();
+  }
+
+  std::string chrome_json() const
+  {
+    const auto microseconds = [](const auto duration)
+      {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+          duration).count();
+      };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < _events.size(); ++i)
+    {
+      const auto& e = _events[i];
+      if (i > 0)
+        out << ",";
+
+      out << "{\"name\":";
+      write_string(out, e.name);
+      out << ",\"cat\":";
+      write_string(out, e.category);
+      out << ",\"ph\":\"X\",\"ts\":" << microseconds(e.start - _origin)
+          << ",\"dur\":" << microseconds(e.finish - e.start)
+          << ",\"pid\":1,\"tid\":" << e.thread << "}";
+    }
+    out << "]}";
+
+    return out.str();
+  }
+
+private:
+
+  static void write_string(std::ostringstream& out, const char* text)
+  {
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+      if (*c == '"' || *c == '\\')
+        out << '\\' << *c;
+      else if (static_cast<unsigned char>(*c) < 0x20)
+        out << ' ';
+      else
+        out << *c;
+    }
+    out << '"';
+  }
+
+  std::atomic_bool _recording = false;
+  mutable std::mutex _mutex;
+  std::vector<Event> _events;
+  std::chrono::steady_clock::time_point _origin;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+bool Trace::available()
+{
+#ifdef RMF_TASK_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+//==============================================================================
+void Trace::start()
+{
+  Recorder::get().start();
+}
+
+//==============================================================================
+void Trace::stop()
+{
+  Recorder::get().stop();
+}
+
+//==============================================================================
+bool Trace::recording()
+{
+  return Recorder::get().recording();
+}
+
+//==============================================================================
+std::size_t Trace::size()
+{
+  return Recorder::get().size();
+}
+
+//==============================================================================
+std::string Trace::chrome_json()
+{
+  return Recorder::get().chrome_json();
+}
+
+//==============================================================================
+void Trace::write(const std::string& path)
+{
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!file)
+  {
+    throw std::runtime_error(
+      "[rmf_task::Trace::write] Could not open file [" + path + "]");
+  }
+  // *INDENT-ON*
+
+  file << chrome_json();
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!file)
+  {
+    throw std::runtime_error(
+      "[rmf_task::Trace::write] Could not write file [" + path + "]");
+  }
+  // *INDENT-ON*
+}
+
+//==============================================================================
+Trace::Span::Span(const char* name, const char* category)
+: _name(name),
+  _category(category),
+  _active(Recorder::get().recording())
+{
+  // Reading the clock is skipped entirely while nothing is being recorded
+  if (_active)
+    _start = std::chrono::steady_clock::now();
+}
+
+//==============================================================================
+Trace::Span::~Span()
+{
+  if (!_active)
+    return;
+
+  auto& recorder = Recorder::get();
+  if (!recorder.recording())
+    return;
+
+  recorder.record(
+    Event{
+      _name,
+      _category,
+      _start,
+      std::chrono::steady_clock::now(),
+      Recorder::thread_number()
+    });
+}
+
+} // namespace rmf_task
@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "TravelCache.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+// Each thread always registers its lookups in the same reader slot, so that
+// threads rarely write to the same counter
+std::size_t reader_slot(const std::size_t num_slots)
+{
+  static thread_local const std::size_t slot =
+    std::hash<std::thread::id>()(std::this_thread::get_id()) % num_slots;
+  return slot;
+}
+
+//==============================================================================
+// Load the pointer in a slot, or fill the slot with a newly made object if it
+// is empty. If another thread fills the slot first, the new object is
+// discarded and the other thread's object is used.
+template<typename T, typename Make, typename Discard>
+T* acquire(
+  std::atomic<T*>& slot,
+  std::atomic_size_t& count,
+  Make make,
+  Discard discard)
+{
+  T* current = slot.load(std::memory_order_acquire);
+  if (current)
+    return current;
+
+  T* fresh = make();
+  if (slot.compare_exchange_strong(current, fresh, std::memory_order_acq_rel))
+  {
+    ++count;
+    return fresh;
+  }
+
+  discard(fresh);
+  return current;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+struct TravelCache::Entry
+{
+  std::atomic_bool ready = false;
+  std::atomic_bool referenced = true;
+  Value value;
+  Route route;
+
+  void touch()
+  {
+    // Avoid writing to the entry on every hit
+    if (!referenced.load(std::memory_order_relaxed))
+      referenced.store(true, std::memory_order_relaxed);
+  }
+};
+
+//==============================================================================
+struct TravelCache::Block
+{
+  std::atomic<Entry*> entries[BlockSize] = {};
+};
+
+//==============================================================================
+// Registers a lookup with the current epoch for as long as it exists. Entries
+// that are unlinked from the table are only deleted once every lookup that was
+// registered before they were unlinked has finished.
+class TravelCache::ReadGuard
+{
+public:
+
+  ReadGuard(const TravelCache& cache)
+  {
+    auto& counts = cache._readers[reader_slot(ReaderSlots)].count;
+    while (true)
+    {
+      const std::size_t epoch = cache._epoch.load();
+      auto& count = counts[epoch % 2];
+      ++count;
+
+      // If the epoch changed before this lookup was counted, a concurrent
+      // synchronize() may have missed it, so count it again in the new epoch
+      if (cache._epoch.load() == epoch)
+      {
+        _count = &count;
+        return;
+      }
+
+      --count;
+    }
+  }
+
+  ReadGuard(const ReadGuard&) = delete;
+  ReadGuard& operator=(const ReadGuard&) = delete;
+
+  ~ReadGuard()
+  {
+    _count->fetch_sub(1, std::memory_order_release);
+  }
+
+private:
+  std::atomic_size_t* _count = nullptr;
+};
+
+//==============================================================================
+TravelCache::TravelCache(const std::size_t num_waypoints)
+: _num_waypoints(num_waypoints),
+  _blocks_per_row((num_waypoints + BlockSize - 1) / BlockSize),
+  _rows(new std::atomic<Row*>[num_waypoints]()),
+  _readers(new ReaderCount[ReaderSlots])
+{
+  // Do nothing
+}
+
+//==============================================================================
+TravelCache::~TravelCache()
+{
+  for (std::size_t i = 0; i < _num_waypoints; ++i)
+  {
+    Row* row = _rows[i].load(std::memory_order_relaxed);
+    if (!row)
+      continue;
+
+    for (std::size_t j = 0; j < _blocks_per_row; ++j)
+    {
+      Block* block = row[j].load(std::memory_order_relaxed);
+      if (!block)
+        continue;
+
+      for (auto& entry : block->entries)
+        delete entry.load(std::memory_order_relaxed);
+
+      delete block;
+    }
+
+    delete[] row;
+  }
+}
+
+//==============================================================================
+auto TravelCache::get(
+  const Key& key,
+  const std::function<Value(Route& route)>& calculate,
+  bool& calculated) -> Value
+{
+  calculated = false;
+  if (!valid(key))
+  {
+    // The key cannot be cached, e.g. because the waypoints are not part of
+    // the graph
+    calculated = true;
+    Route ignore;
+    return calculate(ignore);
+  }
+
+  Entry* claimed = nullptr;
+  while (!claimed)
+  {
+    {
+      ReadGuard guard(*this);
+      auto& s = slot(key);
+      Entry* entry = s.load(std::memory_order_acquire);
+      if (!entry)
+      {
+        auto* fresh = new Entry;
+        if (!s.compare_exchange_strong(
+            entry, fresh, std::memory_order_acq_rel))
+        {
+          delete fresh;
+          continue;
+        }
+
+        ++_size;
+        claimed = fresh;
+        break;
+      }
+
+      if (entry->ready.load(std::memory_order_acquire))
+      {
+        entry->touch();
+        return entry->value;
+      }
+    }
+
+    // Another thread is calculating this value, so wait until it is either
+    // finished or abandoned
+    std::unique_lock<std::mutex> lock(_wait_mutex);
+    _wait.wait(lock, [&]()
+      {
+        ReadGuard guard(*this);
+        const Entry* entry = find(key);
+        return !entry || entry->ready.load(std::memory_order_acquire);
+      });
+  }
+
+  calculated = true;
+  Value value;
+  Route route;
+  try
+  {
+    value = calculate(route);
+  }
+  catch (...)
+  {
+    abandon(key, claimed);
+    throw;
+  }
+
+  claimed->value = value;
+  claimed->route = std::move(route);
+  claimed->ready.store(true, std::memory_order_release);
+  notify();
+  evict_if_needed();
+
+  return value;
+}
+
+//==============================================================================
+auto TravelCache::peek(const Key& key) const -> std::optional<Value>
+{
+  if (!valid(key))
+    return std::nullopt;
+
+  ReadGuard guard(*this);
+  Entry* entry = find(key);
+  if (!entry || !entry->ready.load(std::memory_order_acquire))
+    return std::nullopt;
+
+  entry->touch();
+  return entry->value;
+}
+
+//==============================================================================
+bool TravelCache::insert(const Key& key, Value value, Route route)
+{
+  if (!valid(key))
+    return false;
+
+  auto* fresh = new Entry;
+  fresh->value = std::move(value);
+  fresh->route = std::move(route);
+  fresh->ready.store(true, std::memory_order_relaxed);
+
+  Entry* expected = nullptr;
+  if (!slot(key).compare_exchange_strong(
+      expected, fresh, std::memory_order_acq_rel))
+  {
+    delete fresh;
+    return false;
+  }
+
+  ++_size;
+  evict_if_needed();
+  return true;
+}
+
+//==============================================================================
+std::size_t TravelCache::erase_if(
+  const std::function<bool(const Key&, const Value&, const Route&)>&
+  should_erase)
+{
+  std::lock_guard<std::mutex> lock(_reclaim_mutex);
+  std::vector<Entry*> retired;
+  for (std::size_t i = 0; i < _num_waypoints; ++i)
+  {
+    Row* row = _rows[i].load(std::memory_order_acquire);
+    if (!row)
+      continue;
+
+    for (std::size_t j = 0; j < _blocks_per_row; ++j)
+    {
+      Block* block = row[j].load(std::memory_order_acquire);
+      if (!block)
+        continue;
+
+      for (std::size_t k = 0; k < BlockSize; ++k)
+      {
+        auto& s = block->entries[k];
+        Entry* entry = s.load(std::memory_order_acquire);
+        if (!entry || !entry->ready.load(std::memory_order_acquire))
+          continue;
+
+        // Ready entries are only unlinked while holding _reclaim_mutex, so this
+        // entry cannot be deleted while it is being checked
+        const Key key{i, j * BlockSize + k};
+        if (!should_erase(key, entry->value, entry->route))
+          continue;
+
+        if (s.compare_exchange_strong(
+            entry, nullptr, std::memory_order_acq_rel))
+        {
+          retired.push_back(entry);
+          --_size;
+        }
+      }
+    }
+  }
+
+  if (retired.empty())
+    return 0;
+
+  synchronize();
+  for (const auto* entry : retired)
+    delete entry;
+
+  return retired.size();
+}
+
+//==============================================================================
+void TravelCache::for_each(
+  const std::function<void(const Key&, const Value&)>& f) const
+{
+  ReadGuard guard(*this);
+  for (std::size_t i = 0; i < _num_waypoints; ++i)
+  {
+    const Row* row = _rows[i].load(std::memory_order_acquire);
+    if (!row)
+      continue;
+
+    for (std::size_t j = 0; j < _blocks_per_row; ++j)
+    {
+      const Block* block = row[j].load(std::memory_order_acquire);
+      if (!block)
+        continue;
+
+      for (std::size_t k = 0; k < BlockSize; ++k)
+      {
+        const Entry* entry = block->entries[k].load(std::memory_order_acquire);
+        if (entry && entry->ready.load(std::memory_order_acquire))
+          f(Key{i, j * BlockSize + k}, entry->value);
+      }
+    }
+  }
+}
+
+//==============================================================================
+void TravelCache::capacity(const std::optional<std::size_t> value)
+{
+  _capacity = value.value_or(Unlimited);
+  evict_if_needed();
+}
+
+//==============================================================================
+std::optional<std::size_t> TravelCache::capacity() const
+{
+  const std::size_t value = _capacity;
+  if (value == Unlimited)
+    return std::nullopt;
+
+  return value;
+}
+
+//==============================================================================
+std::size_t TravelCache::size() const
+{
+  return _size;
+}
+
+//==============================================================================
+std::size_t TravelCache::evictions() const
+{
+  return _evictions;
+}
+
+//==============================================================================
+std::size_t TravelCache::memory() const
+{
+  return sizeof(TravelCache)
+    + _num_waypoints * sizeof(std::atomic<Row*>)
+    + ReaderSlots * sizeof(ReaderCount)
+    + _num_rows * _blocks_per_row * sizeof(Row)
+    + _num_blocks * sizeof(Block)
+    + _size * sizeof(Entry);
+}
+
+//==============================================================================
+bool TravelCache::valid(const Key& key) const
+{
+  return key.first < _num_waypoints && key.second < _num_waypoints;
+}
+
+//==============================================================================
+auto TravelCache::slot(const Key& key) -> std::atomic<Entry*>&
+{
+  Row* row = acquire(_rows[key.first], _num_rows, [&]()
+      {
+        return new Row[_blocks_per_row]();
+      }, [](Row* r) { delete[] r; });
+
+  Block* block = acquire(row[key.second / BlockSize], _num_blocks, []()
+      {
+        return new Block();
+      }, [](Block* b) { delete b; });
+
+  return block->entries[key.second % BlockSize];
+}
+
+//==============================================================================
+auto TravelCache::find(const Key& key) const -> Entry*
+{
+  const Row* row = _rows[key.first].load(std::memory_order_acquire);
+  if (!row)
+    return nullptr;
+
+  const Block* block =
+    row[key.second / BlockSize].load(std::memory_order_acquire);
+  if (!block)
+    return nullptr;
+
+  return block->entries[key.second % BlockSize].load(
+    std::memory_order_acquire);
+}
+
+//==============================================================================
+void TravelCache::evict_if_needed()
+{
+  const std::size_t capacity = _capacity.load(std::memory_order_relaxed);
+  if (capacity == Unlimited)
+    return;
+
+  if (_size.load(std::memory_order_relaxed) <= capacity)
+    return;
+
+  std::unique_lock<std::mutex> lock(_reclaim_mutex, std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+
+  // Evict a little more than needed so that this does not run on every insert
+  const std::size_t target = capacity - capacity / 10;
+  const std::size_t num_blocks = _num_waypoints * _blocks_per_row;
+
+  // The hand moves one block at a time. Going around the table twice is
+  // enough to clear the reference bit of every entry and then evict it.
+  std::vector<Entry*> retired;
+  for (std::size_t step = 0; step <= 2 * num_blocks; ++step)
+  {
+    if (_size.load(std::memory_order_relaxed) <= target)
+      break;
+
+    const std::size_t b = _clock_hand;
+    _clock_hand = (b + 1) % num_blocks;
+
+    Row* row = _rows[b / _blocks_per_row].load(std::memory_order_acquire);
+    if (!row)
+    {
+      // Skip the rest of the row
+      const std::size_t row_end = (b / _blocks_per_row + 1) * _blocks_per_row;
+      step += row_end - b - 1;
+      _clock_hand = row_end % num_blocks;
+      continue;
+    }
+
+    Block* block = row[b % _blocks_per_row].load(std::memory_order_acquire);
+    if (!block)
+      continue;
+
+    for (auto& s : block->entries)
+    {
+      Entry* entry = s.load(std::memory_order_acquire);
+      if (!entry || !entry->ready.load(std::memory_order_acquire))
+        continue;
+
+      if (entry->referenced.exchange(false, std::memory_order_relaxed))
+        continue;
+
+      if (s.compare_exchange_strong(entry, nullptr, std::memory_order_acq_rel))
+      {
+        retired.push_back(entry);
+        --_size;
+        ++_evictions;
+      }
+    }
+  }
+
+  if (retired.empty())
+    return;
+
+  synchronize();
+  for (const auto* entry : retired)
+    delete entry;
+}
+
+//==============================================================================
+void TravelCache::abandon(const Key& key, Entry* entry)
+{
+  Entry* expected = entry;
+  slot(key).compare_exchange_strong(
+    expected, nullptr, std::memory_order_acq_rel);
+  --_size;
+
+  {
+    std::lock_guard<std::mutex> lock(_reclaim_mutex);
+    synchronize();
+  }
+
+  delete entry;
+  notify();
+}
+
+//==============================================================================
+void TravelCache::synchronize()
+{
+  const std::size_t previous = _epoch.fetch_add(1) % 2;
+  for (std::size_t i = 0; i < ReaderSlots; ++i)
+  {
+    // Lookups are short and never block, so this only waits briefly
+    while (_readers[i].count[previous].load() != 0)
+      std::this_thread::yield();
+  }
+}
+
+//==============================================================================
+void TravelCache::notify()
+{
+  {
+    // Waiters check for their value while holding this mutex, so taking it
+    // here makes sure that none of them misses the notification
+    std::lock_guard<std::mutex> lock(_wait_mutex);
+  }
+  _wait.notify_all();
+}
+
+} // namespace rmf_task
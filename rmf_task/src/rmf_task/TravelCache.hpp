@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__TRAVELCACHE_HPP
+#define SRC__RMF_TASK__TRAVELCACHE_HPP
+
+#include <rmf_task/Estimate.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// The memoized results of a TravelEstimator.
+//
+// The cache is a table with an entry for every pair of waypoints. Each start
+// waypoint has a row of blocks of goal waypoints, and a block is only
+// allocated once one of its entries gets used. Looking up an entry takes a few
+// atomic loads, so cache hits never wait on another thread.
+//
+// When a capacity is set, entries are evicted with the CLOCK policy once the
+// cache grows past it. Evicted entries are only deleted after every lookup
+// that might still be reading them has finished, which is tracked by counting
+// the readers of two alternating epochs.
+//
+// Each entry can also remember the lanes of the route that its value was
+// planned along, so that erase_if() can drop the entries that a change to the
+// graph affects.
+class TravelCache
+{
+public:
+
+  using Key = std::pair<std::size_t, std::size_t>;
+  using Value = std::optional<TravelEstimator::Result>;
+
+  // The sorted lanes of a route, or std::nullopt if they are not known
+  using Route = std::optional<std::vector<std::size_t>>;
+
+  TravelCache(std::size_t num_waypoints);
+
+  TravelCache(const TravelCache&) = delete;
+  TravelCache& operator=(const TravelCache&) = delete;
+
+  ~TravelCache();
+
+  // Get the value for a key. If no thread has produced it yet, calculate() is
+  // called and its result is stored along with the route that calculate()
+  // fills in, and calculated is set to true. Any other thread that asks for
+  // the same key in the meantime waits for that result. If calculate() throws,
+  // the exception is passed on and a waiting thread will try to calculate the
+  // value itself.
+  Value get(
+    const Key& key,
+    const std::function<Value(Route& route)>& calculate,
+    bool& calculated);
+
+  // Get the value for a key if it has already been calculated, without
+  // claiming the key or waiting for anything
+  std::optional<Value> peek(const Key& key) const;
+
+  // Store a value unless the key already has one. Returns true if the value
+  // was stored.
+  bool insert(const Key& key, Value value, Route route = std::nullopt);
+
+  // Remove every value for which should_erase(key, value, route) is true.
+  // Entries that are still being calculated are not visited. Returns the
+  // number of values that were removed.
+  std::size_t erase_if(
+    const std::function<bool(const Key&, const Value&, const Route&)>&
+    should_erase);
+
+  // Call f(key, value) for every value in the cache
+  void for_each(const std::function<void(const Key&, const Value&)>& f) const;
+
+  // Set the largest number of entries to keep, or std::nullopt for no limit
+  void capacity(std::optional<std::size_t> value);
+
+  std::optional<std::size_t> capacity() const;
+
+  // The number of entries in the cache, including ones that are still being
+  // calculated
+  std::size_t size() const;
+
+  // The number of entries that have been evicted
+  std::size_t evictions() const;
+
+  // The approximate number of bytes used by the cache, not counting the
+  // overhead of the allocator or any heap memory held by the values and
+  // routes
+  std::size_t memory() const;
+
+private:
+
+  struct Entry;
+  struct Block;
+  using Row = std::atomic<Block*>;
+  class ReadGuard;
+
+  static constexpr std::size_t BlockSize = 64;
+  static constexpr std::size_t ReaderSlots = 16;
+  static constexpr std::size_t Unlimited = static_cast<std::size_t>(-1);
+
+  bool valid(const Key& key) const;
+
+  // Get the slot of a key, allocating its row and block if needed
+  std::atomic<Entry*>& slot(const Key& key);
+
+  // Evict entries until the cache is 10% below its capacity, unless another
+  // thread is already doing so
+  void evict_if_needed();
+
+  // Remove a claimed entry whose value could not be calculated
+  void abandon(const Key& key, Entry* entry);
+
+  // Get the entry of a key without allocating anything. Must be called from
+  // inside a ReadGuard.
+  Entry* find(const Key& key) const;
+
+  // Wait until no reader can still be holding a pointer that was unlinked
+  // before this call. Must hold _reclaim_mutex and must not be called from
+  // inside a ReadGuard.
+  void synchronize();
+
+  // Wake up the threads that are waiting for a value to be calculated
+  void notify();
+
+  std::size_t _num_waypoints;
+  std::size_t _blocks_per_row;
+  std::unique_ptr<std::atomic<Row*>[]> _rows;
+
+  std::atomic_size_t _capacity = Unlimited;
+  std::atomic_size_t _size = 0;
+  std::atomic_size_t _evictions = 0;
+  std::atomic_size_t _num_rows = 0;
+  std::atomic_size_t _num_blocks = 0;
+
+  struct alignas(64) ReaderCount
+  {
+    std::atomic_size_t count[2] = {};
+  };
+
+  std::atomic_size_t _epoch = 0;
+  std::unique_ptr<ReaderCount[]> _readers;
+
+  std::mutex _reclaim_mutex;
+  std::size_t _clock_hand = 0;
+
+  std::mutex _wait_mutex;
+  std::condition_variable _wait;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__TRAVELCACHE_HPP
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "TravelHierarchy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+constexpr float unreachable = std::numeric_limits<float>::infinity();
+
+//==============================================================================
+// Call the function for every index from 0 to count on all of the hardware
+// threads
+void parallel_for(
+  const std::size_t count,
+  const std::function<void(std::size_t)>& function)
+{
+  std::atomic_size_t next = 0;
+  const auto work = [&]()
+    {
+      std::size_t i;
+      while ((i = next++) < count)
+        function(i);
+    };
+
+  const std::size_t num_threads = std::min<std::size_t>(
+    count, std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(work);
+
+  work();
+  for (auto& t : threads)
+    t.join();
+}
+
+//==============================================================================
+// The fastest durations from a source to every node of a graph whose edges
+// are given by for_each_edge(node, visit(neighbor, duration))
+template<typename ForEachEdge>
+void fastest_durations(
+  const std::size_t source,
+  const ForEachEdge& for_each_edge,
+  float* output,
+  const std::size_t num_nodes)
+{
+  std::vector<double> best(num_nodes, std::numeric_limits<double>::infinity());
+  using Entry = std::pair<double, std::size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  best[source] = 0.0;
+  queue.push({0.0, source});
+  while (!queue.empty())
+  {
+    const auto [cost, node] = queue.top();
+    queue.pop();
+    if (cost > best[node])
+      continue;
+
+    for_each_edge(node, [&](const std::size_t neighbor, const double duration)
+      {
+        const double next = cost + duration;
+        if (next < best[neighbor])
+        {
+          best[neighbor] = next;
+          queue.push({next, neighbor});
+        }
+      });
+  }
+
+  for (std::size_t i = 0; i < num_nodes; ++i)
+    output[i] = static_cast<float>(best[i]);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+std::shared_ptr<const TravelHierarchy> TravelHierarchy::build(
+  const rmf_traffic::agv::Planner::Configuration& configuration,
+  const std::size_t region_size)
+{
+  const auto& graph = configuration.graph();
+  const double speed =
+    configuration.vehicle_traits().linear().get_nominal_velocity();
+  if (speed <= 0.0 || region_size == 0)
+    return nullptr;
+
+  // How long each open lane takes. Closed lanes are negative.
+  const auto& closures = configuration.lane_closures();
+  const std::size_t num_waypoints = graph.num_waypoints();
+  std::vector<double> lane_duration(graph.num_lanes(), -1.0);
+  std::vector<std::vector<std::size_t>> neighbors(num_waypoints);
+  for (std::size_t lane = 0; lane < graph.num_lanes(); ++lane)
+  {
+    if (closures.is_closed(lane))
+      continue;
+
+    const auto& l = graph.get_lane(lane);
+    const std::size_t entry = l.entry().waypoint_index();
+    const std::size_t exit = l.exit().waypoint_index();
+    double duration = (graph.get_waypoint(exit).get_location()
+      - graph.get_waypoint(entry).get_location()).norm() / speed;
+
+    if (const auto* event = l.entry().event())
+      duration += rmf_traffic::time::to_seconds(event->duration());
+
+    if (const auto* event = l.exit().event())
+      duration += rmf_traffic::time::to_seconds(event->duration());
+
+    lane_duration[lane] = duration;
+    neighbors[entry].push_back(exit);
+    neighbors[exit].push_back(entry);
+  }
+
+  std::shared_ptr<TravelHierarchy> hierarchy(new TravelHierarchy);
+  auto& region_of = hierarchy->_region_of;
+  auto& local_index = hierarchy->_local_index;
+  auto& regions = hierarchy->_regions;
+  region_of.assign(num_waypoints, none);
+  local_index.assign(num_waypoints, 0);
+
+  // Grow each region breadth-first from the lowest waypoint that does not
+  // belong to a region yet, until it runs out of waypoints or reaches its size
+  std::vector<bool> queued(num_waypoints, false);
+  for (std::size_t seed = 0; seed < num_waypoints; ++seed)
+  {
+    if (region_of[seed] != none)
+      continue;
+
+    Region region;
+    std::deque<std::size_t> frontier = {seed};
+    queued[seed] = true;
+    while (!frontier.empty() && region.members.size() < region_size)
+    {
+      const std::size_t wp = frontier.front();
+      frontier.pop_front();
+      region_of[wp] = static_cast<uint32_t>(regions.size());
+      local_index[wp] = static_cast<uint32_t>(region.members.size());
+      region.members.push_back(wp);
+
+      for (const auto n : neighbors[wp])
+      {
+        if (region_of[n] == none && !queued[n])
+        {
+          queued[n] = true;
+          frontier.push_back(n);
+        }
+      }
+    }
+
+    for (const auto wp : frontier)
+      queued[wp] = false;
+
+    regions.push_back(std::move(region));
+  }
+
+  // The portals are the waypoints of the lanes that cross between regions
+  std::vector<bool> is_portal(num_waypoints, false);
+  for (std::size_t lane = 0; lane < graph.num_lanes(); ++lane)
+  {
+    if (lane_duration[lane] < 0.0)
+      continue;
+
+    const auto& l = graph.get_lane(lane);
+    const std::size_t entry = l.entry().waypoint_index();
+    const std::size_t exit = l.exit().waypoint_index();
+    if (region_of[entry] != region_of[exit])
+    {
+      is_portal[entry] = true;
+      is_portal[exit] = true;
+    }
+  }
+
+  std::vector<std::size_t> portal_waypoints;
+  std::vector<uint32_t> portal_id(num_waypoints, none);
+  for (auto& region : regions)
+  {
+    for (std::size_t i = 0; i < region.members.size(); ++i)
+    {
+      const std::size_t wp = region.members[i];
+      if (!is_portal[wp])
+        continue;
+
+      portal_id[wp] = static_cast<uint32_t>(portal_waypoints.size());
+      region.portals.push_back(static_cast<uint32_t>(i));
+      region.portal_ids.push_back(portal_id[wp]);
+      portal_waypoints.push_back(wp);
+    }
+  }
+
+  // The fastest durations within each region
+  parallel_for(regions.size(), [&](const std::size_t r)
+    {
+      auto& region = regions[r];
+      const std::size_t n = region.members.size();
+      region.durations.resize(n * n);
+      const auto edges = [&](const std::size_t local, const auto& visit)
+        {
+          for (const auto lane : graph.lanes_from(region.members[local]))
+          {
+            if (lane_duration[lane] < 0.0)
+              continue;
+
+            const std::size_t exit =
+              graph.get_lane(lane).exit().waypoint_index();
+            if (region_of[exit] == r)
+              visit(local_index[exit], lane_duration[lane]);
+          }
+        };
+
+      for (std::size_t i = 0; i < n; ++i)
+        fastest_durations(i, edges, region.durations.data() + i * n, n);
+    });
+
+  // The fastest durations between the portals, over a graph whose edges are
+  // the routes between the portals of a region and the lanes between regions
+  const std::size_t num_portals = portal_waypoints.size();
+  std::vector<std::vector<std::pair<uint32_t, double>>> portal_edges(
+    num_portals);
+  for (std::size_t p = 0; p < num_portals; ++p)
+  {
+    const std::size_t wp = portal_waypoints[p];
+    const auto& region = regions[region_of[wp]];
+    for (std::size_t j = 0; j < region.portals.size(); ++j)
+    {
+      const float d = region.get(local_index[wp], region.portals[j]);
+      if (region.portal_ids[j] != p && d < unreachable)
+        portal_edges[p].push_back({region.portal_ids[j], d});
+    }
+
+    for (const auto lane : graph.lanes_from(wp))
+    {
+      if (lane_duration[lane] < 0.0)
+        continue;
+
+      const std::size_t exit = graph.get_lane(lane).exit().waypoint_index();
+      if (region_of[exit] != region_of[wp])
+        portal_edges[p].push_back({portal_id[exit], lane_duration[lane]});
+    }
+  }
+
+  hierarchy->_num_portals = num_portals;
+  hierarchy->_portal_durations.resize(num_portals * num_portals);
+  const auto edges = [&](const std::size_t p, const auto& visit)
+    {
+      for (const auto& [q, d] : portal_edges[p])
+        visit(q, d);
+    };
+
+  parallel_for(num_portals, [&](const std::size_t p)
+    {
+      fastest_durations(
+        p, edges, hierarchy->_portal_durations.data() + p * num_portals,
+        num_portals);
+    });
+
+  return hierarchy;
+}
+
+//==============================================================================
+std::optional<double> TravelHierarchy::duration(
+  const std::size_t start,
+  const std::size_t goal) const
+{
+  if (start >= _region_of.size() || goal >= _region_of.size())
+    return std::nullopt;
+
+  const auto& from = _regions[_region_of[start]];
+  const auto& to = _regions[_region_of[goal]];
+  const std::size_t s = _local_index[start];
+  const std::size_t g = _local_index[goal];
+
+  // A route within one region might still be beaten by a route that leaves
+  // it and comes back
+  float best = unreachable;
+  if (&from == &to)
+    best = from.get(s, g);
+
+  for (std::size_t i = 0; i < from.portals.size(); ++i)
+  {
+    const float exit = from.get(s, from.portals[i]);
+    if (!(exit < best))
+      continue;
+
+    const float* row = _portal_durations.data()
+      + static_cast<std::size_t>(from.portal_ids[i]) * _num_portals;
+    for (std::size_t j = 0; j < to.portals.size(); ++j)
+    {
+      const float d = exit + row[to.portal_ids[j]]
+        + to.get(to.portals[j], g);
+      best = std::min(best, d);
+    }
+  }
+
+  if (!(best < unreachable))
+    return std::nullopt;
+
+  return static_cast<double>(best);
+}
+
+//==============================================================================
+std::size_t TravelHierarchy::num_regions() const
+{
+  return _regions.size();
+}
+
+//==============================================================================
+std::size_t TravelHierarchy::num_portals() const
+{
+  return _num_portals;
+}
+
+//==============================================================================
+std::size_t TravelHierarchy::memory() const
+{
+  std::size_t bytes = _portal_durations.capacity() * sizeof(float)
+    + (_region_of.capacity() + _local_index.capacity()) * sizeof(uint32_t);
+
+  for (const auto& region : _regions)
+  {
+    bytes += sizeof(Region)
+      + region.members.capacity() * sizeof(std::size_t)
+      + (region.portals.capacity() + region.portal_ids.capacity())
+      * sizeof(uint32_t)
+      + region.durations.capacity() * sizeof(float);
+  }
+
+  return bytes;
+}
+
+} // namespace rmf_task
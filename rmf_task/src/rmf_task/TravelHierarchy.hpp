@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__TRAVELHIERARCHY_HPP
+#define SRC__RMF_TASK__TRAVELHIERARCHY_HPP
+
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// A two-level abstraction of a navigation graph for finding how long it takes
+// to travel between two waypoints without planning. The waypoints are split
+// into connected regions of a bounded size. Each region keeps the fastest
+// durations between all of its waypoints along routes that stay inside of it.
+// The portals of the regions, which are the waypoints with a lane to or from
+// another region, keep the fastest durations between each other across the
+// whole graph. Every route leaves the region of its start through a portal
+// and enters the region of its goal through a portal, so combining the two
+// levels gives the fastest duration over the whole graph.
+//
+// A lane takes as long as its length at the nominal velocity of the vehicle
+// plus the durations of the events at its entry and exit. Closed lanes are
+// left out.
+class TravelHierarchy
+{
+public:
+
+  // Build the hierarchy of a planner configuration whose vehicle has a
+  // positive nominal velocity. Returns nullptr otherwise.
+  static std::shared_ptr<const TravelHierarchy> build(
+    const rmf_traffic::agv::Planner::Configuration& configuration,
+    std::size_t region_size);
+
+  // The fastest duration in seconds between two waypoints, or nullopt if the
+  // goal cannot be reached or either waypoint is outside of the graph
+  std::optional<double> duration(std::size_t start, std::size_t goal) const;
+
+  std::size_t num_regions() const;
+
+  std::size_t num_portals() const;
+
+  // The number of bytes used by the tables
+  std::size_t memory() const;
+
+  struct Region
+  {
+    // The waypoints of the region, in the order of their local index
+    std::vector<std::size_t> members;
+
+    // The local index and the global portal index of each portal
+    std::vector<uint32_t> portals;
+    std::vector<uint32_t> portal_ids;
+
+    // The durations between the members in row-major order of their local
+    // indices, in seconds
+    std::vector<float> durations;
+
+    float get(std::size_t from, std::size_t to) const
+    {
+      return durations[from * members.size() + to];
+    }
+  };
+
+private:
+  TravelHierarchy() = default;
+
+  std::vector<uint32_t> _region_of;
+  std::vector<uint32_t> _local_index;
+  std::vector<Region> _regions;
+  std::size_t _num_portals = 0;
+
+  // The durations between the portals in row-major order, in seconds
+  std::vector<float> _portal_durations;
+};
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__TRAVELHIERARCHY_HPP
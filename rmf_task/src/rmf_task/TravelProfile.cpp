@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rmf_task/TravelProfile.hpp>
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+constexpr rmf_traffic::Duration one_day = std::chrono::hours(24);
+
+//==============================================================================
+uint64_t pair_key(const std::size_t start, const std::size_t goal)
+{
+  return (static_cast<uint64_t>(start) << 32) ^ static_cast<uint64_t>(goal);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class TravelProfile::Implementation
+{
+public:
+
+  // The values of one bucket. A bucket without samples has no values.
+  struct Cell
+  {
+    int64_t duration = 0;
+    double change_in_charge = 0.0;
+    uint64_t samples = 0;
+  };
+
+  Implementation(
+    const std::size_t num_buckets_,
+    const rmf_traffic::Time midnight_)
+  : num_buckets(num_buckets_),
+    midnight(midnight_),
+    bucket_length(one_day / num_buckets_)
+  {
+    // Do nothing
+  }
+
+  std::size_t bucket(const rmf_traffic::Time time) const
+  {
+    auto time_of_day = (time - midnight) % one_day;
+    if (time_of_day.count() < 0)
+      time_of_day += one_day;
+
+    // The remainder of the division of the day can spill into one more bucket
+    return std::min<std::size_t>(time_of_day / bucket_length, num_buckets - 1);
+  }
+
+  // Get the cell of a bucket, adding a row for the pair if it has none yet.
+  // The lock must be held exclusively.
+  Cell& cell(
+    const std::size_t start,
+    const std::size_t goal,
+    const std::size_t bucket)
+  {
+    const auto inserted = rows.insert({pair_key(start, goal), cells.size()});
+    if (inserted.second)
+      cells.resize(cells.size() + num_buckets);
+
+    return cells[inserted.first->second + bucket];
+  }
+
+  const std::size_t num_buckets;
+  const rmf_traffic::Time midnight;
+  const rmf_traffic::Duration bucket_length;
+
+  // The buckets of each pair are stored next to each other, so a lookup only
+  // needs the offset of its row
+  mutable std::shared_mutex mutex;
+  std::unordered_map<uint64_t, std::size_t> rows;
+  std::vector<Cell> cells;
+};
+
+//==============================================================================
+TravelProfile::TravelProfile(
+  const std::size_t num_buckets,
+  const rmf_traffic::Time midnight)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (num_buckets == 0)
+  {
+    throw std::invalid_argument(
+      "A TravelProfile needs at least one bucket for each day");
+  }
+  // *INDENT-ON*
+
+  _pimpl = rmf_utils::make_unique_impl<Implementation>(num_buckets, midnight);
+}
+
+//==============================================================================
+std::size_t TravelProfile::num_buckets() const
+{
+  return _pimpl->num_buckets;
+}
+
+//==============================================================================
+rmf_traffic::Duration TravelProfile::bucket_length() const
+{
+  return _pimpl->bucket_length;
+}
+
+//==============================================================================
+std::size_t TravelProfile::bucket(const rmf_traffic::Time time) const
+{
+  return _pimpl->bucket(time);
+}
+
+//==============================================================================
+TravelProfile& TravelProfile::set(
+  const std::size_t start_waypoint,
+  const std::size_t goal_waypoint,
+  const std::size_t bucket,
+  const rmf_traffic::Duration duration,
+  const double change_in_charge)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (bucket >= _pimpl->num_buckets)
+  {
+    throw std::out_of_range(
+      "Bucket [" + std::to_string(bucket) + "] is outside of a TravelProfile "
+      "with [" + std::to_string(_pimpl->num_buckets) + "] buckets");
+  }
+  // *INDENT-ON*
+
+  std::unique_lock<std::shared_mutex> lock(_pimpl->mutex);
+  _pimpl->cell(start_waypoint, goal_waypoint, bucket) =
+    Implementation::Cell{duration.count(), change_in_charge, 1};
+
+  return *this;
+}
+
+//==============================================================================
+TravelProfile& TravelProfile::record(
+  const std::size_t start_waypoint,
+  const std::size_t goal_waypoint,
+  const rmf_traffic::Time departure,
+  const rmf_traffic::Duration duration,
+  const double change_in_charge)
+{
+  const std::size_t bucket = _pimpl->bucket(departure);
+  std::unique_lock<std::shared_mutex> lock(_pimpl->mutex);
+  auto& cell = _pimpl->cell(start_waypoint, goal_waypoint, bucket);
+  const auto n = static_cast<int64_t>(++cell.samples);
+  cell.duration += (duration.count() - cell.duration) / n;
+  cell.change_in_charge +=
+    (change_in_charge - cell.change_in_charge) / static_cast<double>(n);
+
+  return *this;
+}
+
+//==============================================================================
+TravelProfile& TravelProfile::record(
+  const std::size_t start_waypoint,
+  const std::size_t goal_waypoint,
+  const rmf_traffic::Trajectory& trajectory,
+  const double change_in_charge)
+{
+  if (trajectory.size() < 2)
+    return *this;
+
+  const auto departure = *trajectory.start_time();
+  return record(
+    start_waypoint, goal_waypoint, departure,
+    *trajectory.finish_time() - departure, change_in_charge);
+}
+
+//==============================================================================
+auto TravelProfile::find(
+  const std::size_t start_waypoint,
+  const std::size_t goal_waypoint,
+  const rmf_traffic::Time departure) const -> std::optional<Entry>
+{
+  const std::size_t bucket = _pimpl->bucket(departure);
+  std::shared_lock<std::shared_mutex> lock(_pimpl->mutex);
+  const auto it = _pimpl->rows.find(pair_key(start_waypoint, goal_waypoint));
+  if (it == _pimpl->rows.end())
+    return std::nullopt;
+
+  const auto& cell = _pimpl->cells[it->second + bucket];
+  if (cell.samples == 0)
+    return std::nullopt;
+
+  return Entry{
+    rmf_traffic::Duration(cell.duration),
+    cell.change_in_charge,
+    static_cast<std::size_t>(cell.samples)
+  };
+}
+
+//==============================================================================
+std::size_t TravelProfile::num_pairs() const
+{
+  std::shared_lock<std::shared_mutex> lock(_pimpl->mutex);
+  return _pimpl->rows.size();
+}
+
+//==============================================================================
+std::size_t TravelProfile::memory() const
+{
+  std::shared_lock<std::shared_mutex> lock(_pimpl->mutex);
+  const auto row_size = sizeof(std::pair<const uint64_t, std::size_t>)
+    + sizeof(void*);
+  return _pimpl->cells.capacity() * sizeof(Implementation::Cell)
+    + _pimpl->rows.size() * row_size
+    + _pimpl->rows.bucket_count() * sizeof(void*);
+}
+
+} // namespace rmf_task
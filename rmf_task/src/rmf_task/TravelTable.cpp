@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "TravelTable.hpp"
+#include "Hasher.hpp"
+
+#include <rmf_battery/agv/SimpleDevicePowerSink.hpp>
+#include <rmf_battery/agv/SimpleMotionPowerSink.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <typeinfo>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rmf_task {
+
+namespace {
+
+//==============================================================================
+const char table_magic[8] = {'R', 'M', 'F', 'T', 'R', 'V', 'L', '\0'};
+const char cache_magic[8] = {'R', 'M', 'F', 'T', 'R', 'V', 'C', '\0'};
+const uint32_t table_version = 1;
+const uint32_t byte_order_mark = 0x01020304;
+
+//==============================================================================
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t fingerprint;
+  uint64_t num_waypoints;
+};
+
+static_assert(sizeof(Header) == 32, "Unexpected padding in the table header");
+static_assert(
+  sizeof(TravelTable::Record) == 24, "Unexpected padding in the table records");
+static_assert(
+  sizeof(TravelCacheEntry) == 40, "Unexpected padding in the cache entries");
+
+#ifndef _WIN32
+//==============================================================================
+std::string describe_errno()
+{
+  return std::strerror(errno);
+}
+#endif
+
+//==============================================================================
+Header make_header(const char (&magic)[8], const Parameters& parameters)
+{
+  Header header;
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.version = table_version;
+  header.byte_order = byte_order_mark;
+  header.fingerprint = travel_table_fingerprint(parameters);
+  header.num_waypoints =
+    parameters.planner()->get_configuration().graph().num_waypoints();
+
+  return header;
+}
+
+//==============================================================================
+// Write a file next to the path and then rename it so that readers never see
+// a partially written file
+void write_atomically(
+  const std::string& path,
+  const std::string& what,
+  const std::function<void(std::ostream&)>& write)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    write(file);
+
+    if (!file)
+      throw std::runtime_error("Unable to write " + what + " [" + path + "]");
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    std::error_code ignore;
+    std::filesystem::remove(temporary, ignore);
+    throw std::runtime_error(
+      "Unable to write " + what + " [" + path + "]: " + error.message());
+  }
+  // *INDENT-ON*
+}
+
+} // anonymous namespace
+
+//==============================================================================
+uint64_t travel_table_fingerprint(const Parameters& parameters)
+{
+  using namespace rmf_battery::agv;
+
+  Hasher hash;
+  hash << static_cast<uint64_t>(table_version);
+
+  const auto& battery = parameters.battery_system();
+  hash << battery.nominal_voltage() << battery.capacity()
+       << battery.charging_current();
+
+  if (const auto motion = std::dynamic_pointer_cast<
+      const SimpleMotionPowerSink>(parameters.motion_sink()))
+  {
+    const auto& mechanical = motion->mechanical_system();
+    hash << std::string("SimpleMotionPowerSink")
+         << mechanical.mass() << mechanical.moment_of_inertia()
+         << mechanical.friction_coefficient();
+  }
+  else if (parameters.motion_sink())
+  {
+    hash << std::string(typeid(*parameters.motion_sink()).name());
+  }
+
+  // Only the ambient sink drains the battery while travelling
+  if (const auto device = std::dynamic_pointer_cast<
+      const SimpleDevicePowerSink>(parameters.ambient_sink()))
+  {
+    hash << std::string("SimpleDevicePowerSink")
+         << device->power_system().nominal_power();
+  }
+  else if (parameters.ambient_sink())
+  {
+    hash << std::string(typeid(*parameters.ambient_sink()).name());
+  }
+
+  const auto& configuration = parameters.planner()->get_configuration();
+  const auto& traits = configuration.vehicle_traits();
+  hash << traits.linear().get_nominal_velocity()
+       << traits.linear().get_nominal_acceleration()
+       << traits.rotational().get_nominal_velocity()
+       << traits.rotational().get_nominal_acceleration();
+
+  const auto& graph = configuration.graph();
+  hash << static_cast<uint64_t>(graph.num_waypoints());
+  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+  {
+    const auto& waypoint = graph.get_waypoint(i);
+    const Eigen::Vector2d location = waypoint.get_location();
+    hash << waypoint.get_map_name() << location[0] << location[1];
+  }
+
+  const auto& closures = configuration.lane_closures();
+  hash << static_cast<uint64_t>(graph.num_lanes());
+  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+  {
+    const auto& lane = graph.get_lane(i);
+    hash << static_cast<uint64_t>(lane.entry().waypoint_index())
+         << static_cast<uint64_t>(lane.exit().waypoint_index())
+         << static_cast<uint64_t>(closures.is_closed(i));
+  }
+
+  return hash.value();
+}
+
+//==============================================================================
+bool travel_table_fingerprint_is_complete(const Parameters& parameters)
+{
+  using namespace rmf_battery::agv;
+
+  const bool motion_complete = !parameters.motion_sink()
+    || std::dynamic_pointer_cast<const SimpleMotionPowerSink>(
+    parameters.motion_sink());
+
+  const bool ambient_complete = !parameters.ambient_sink()
+    || std::dynamic_pointer_cast<const SimpleDevicePowerSink>(
+    parameters.ambient_sink());
+
+  return motion_complete && ambient_complete;
+}
+
+//==============================================================================
+std::shared_ptr<const TravelTable> TravelTable::load(
+  const std::string& path,
+  const Parameters& parameters)
+{
+  std::shared_ptr<TravelTable> table(new TravelTable);
+
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+#ifndef _WIN32
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw std::runtime_error(
+      "Unable to open travel table [" + path + "]: " + describe_errno());
+  }
+
+  struct stat status;
+  if (::fstat(fd, &status) != 0)
+  {
+    ::close(fd);
+    throw std::runtime_error(
+      "Unable to read travel table [" + path + "]: " + describe_errno());
+  }
+
+  table->_size = static_cast<std::size_t>(status.st_size);
+  if (table->_size > 0)
+  {
+    void* data = ::mmap(nullptr, table->_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+      throw std::runtime_error(
+        "Unable to map travel table [" + path + "]: " + describe_errno());
+    }
+
+    table->_data = data;
+    table->_mapped = true;
+  }
+  else
+  {
+    ::close(fd);
+  }
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Unable to open travel table [" + path + "]");
+
+  table->_buffer.assign(
+    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  table->_data = table->_buffer.data();
+  table->_size = table->_buffer.size();
+#endif
+
+  if (table->_size < sizeof(Header))
+    throw std::runtime_error("Travel table [" + path + "] is truncated");
+
+  Header header;
+  std::memcpy(&header, table->_data, sizeof(Header));
+  if (std::memcmp(header.magic, table_magic, sizeof(table_magic)) != 0)
+    throw std::runtime_error("[" + path + "] is not a travel table");
+
+  if (header.version != table_version)
+  {
+    throw std::runtime_error(
+      "Travel table [" + path + "] has unsupported version "
+      + std::to_string(header.version));
+  }
+
+  if (header.byte_order != byte_order_mark)
+  {
+    throw std::runtime_error(
+      "Travel table [" + path + "] was built with a different byte order");
+  }
+
+  if (header.fingerprint != travel_table_fingerprint(parameters))
+  {
+    throw std::runtime_error(
+      "Travel table [" + path + "] was built for different parameters");
+  }
+
+  const std::size_t N = header.num_waypoints;
+  if (table->_size != sizeof(Header) + N * N * sizeof(Record))
+    throw std::runtime_error("Travel table [" + path + "] is truncated");
+  // *INDENT-ON*
+
+  table->_num_waypoints = N;
+  table->_records = reinterpret_cast<const Record*>(
+    static_cast<const char*>(table->_data) + sizeof(Header));
+
+  return table;
+}
+
+//==============================================================================
+void TravelTable::write(
+  const std::string& path,
+  const Parameters& parameters,
+  const std::vector<Record>& records)
+{
+  const Header header = make_header(table_magic, parameters);
+
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (records.size() != header.num_waypoints * header.num_waypoints)
+  {
+    throw std::runtime_error(
+      "Travel table needs " + std::to_string(
+        header.num_waypoints * header.num_waypoints) + " records but "
+      + std::to_string(records.size()) + " were given");
+  }
+  // *INDENT-ON*
+
+  write_atomically(path, "travel table", [&](std::ostream& file)
+    {
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(
+        reinterpret_cast<const char*>(records.data()),
+        static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    });
+}
+
+//==============================================================================
+std::size_t TravelTable::num_waypoints() const
+{
+  return _num_waypoints;
+}
+
+//==============================================================================
+auto TravelTable::find(const std::size_t start, const std::size_t goal) const
+-> const Record*
+{
+  if (start >= _num_waypoints || goal >= _num_waypoints)
+    return nullptr;
+
+  return _records + start * _num_waypoints + goal;
+}
+
+//==============================================================================
+TravelTable::~TravelTable()
+{
+#ifndef _WIN32
+  if (_mapped)
+    ::munmap(const_cast<void*>(_data), _size);
+#endif
+}
+
+//==============================================================================
+void write_travel_cache(
+  const std::string& path,
+  const Parameters& parameters,
+  const std::vector<TravelCacheEntry>& entries)
+{
+  const Header header = make_header(cache_magic, parameters);
+  const uint64_t count = entries.size();
+
+  write_atomically(path, "travel cache", [&](std::ostream& file)
+    {
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      file.write(
+        reinterpret_cast<const char*>(entries.data()),
+        static_cast<std::streamsize>(
+          entries.size() * sizeof(TravelCacheEntry)));
+    });
+}
+
+//==============================================================================
+std::vector<TravelCacheEntry> read_travel_cache(
+  const std::string& path,
+  const Parameters& parameters)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return {};
+
+  Header header;
+  uint64_t count = 0;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if (!file)
+    return {};
+
+  const Header expected = make_header(cache_magic, parameters);
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+    || header.version != expected.version
+    || header.byte_order != expected.byte_order
+    || header.fingerprint != expected.fingerprint
+    || header.num_waypoints != expected.num_waypoints
+    || count > header.num_waypoints * header.num_waypoints)
+    return {};
+
+  std::vector<TravelCacheEntry> entries(count);
+  file.read(
+    reinterpret_cast<char*>(entries.data()),
+    static_cast<std::streamsize>(count * sizeof(TravelCacheEntry)));
+  if (!file)
+    return {};
+
+  return entries;
+}
+
+} // namespace rmf_task
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__TRAVELTABLE_HPP
+#define SRC__RMF_TASK__TRAVELTABLE_HPP
+
+#include <rmf_task/Parameters.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rmf_task {
+
+//==============================================================================
+// A precomputed table of the travel estimates between every pair of waypoints
+// of a navigation graph.
+//
+// The file begins with a 32 byte header:
+//   char[8]  magic "RMFTRVL" followed by a null byte
+//   uint32   format version
+//   uint32   byte order mark, 0x01020304 as written by the host
+//   uint64   fingerprint of the parameters the table was built for
+//   uint64   number of waypoints N
+// followed by N*N records in row-major order of (start, goal). All values are
+// stored in the byte order of the host that built the table.
+class TravelTable
+{
+public:
+
+  struct Record
+  {
+    // The travel duration in nanoseconds
+    int64_t duration;
+
+    // The change in battery charge
+    double change_in_charge;
+
+    // 1 if the goal can be reached from the start, otherwise 0
+    uint64_t reachable;
+  };
+
+  // Map a table file into memory. Throws std::runtime_error if the file cannot
+  // be read, is not a valid table, or was built for different parameters.
+  static std::shared_ptr<const TravelTable> load(
+    const std::string& path,
+    const Parameters& parameters);
+
+  // Write a table for the given parameters, whose records are in row-major
+  // order of (start, goal). The file is written next to the path and then
+  // renamed so that readers never see a partially written table. Throws
+  // std::runtime_error if the file cannot be written.
+  static void write(
+    const std::string& path,
+    const Parameters& parameters,
+    const std::vector<Record>& records);
+
+  std::size_t num_waypoints() const;
+
+  // Get the record for a pair of waypoints, or nullptr if either waypoint is
+  // outside of the table
+  const Record* find(std::size_t start, std::size_t goal) const;
+
+  ~TravelTable();
+
+private:
+  TravelTable() = default;
+  TravelTable(const TravelTable&) = delete;
+  TravelTable& operator=(const TravelTable&) = delete;
+
+  const void* _data = nullptr;
+  std::size_t _size = 0;
+  bool _mapped = false;
+  std::vector<char> _buffer;
+  const Record* _records = nullptr;
+  std::size_t _num_waypoints = 0;
+};
+
+//==============================================================================
+// A hash of everything in the parameters that affects a travel estimate: the
+// navigation graph and its lane closures, the vehicle traits, the battery
+// system and the power sinks. Only the simple power sinks of rmf_battery are hashed by value. Any
+// other sink is identified by its type alone.
+uint64_t travel_table_fingerprint(const Parameters& parameters);
+
+//==============================================================================
+// True if every power sink of the parameters is hashed by value, so that two
+// parameters with the same fingerprint are known to give the same estimates
+bool travel_table_fingerprint_is_complete(const Parameters& parameters);
+
+//==============================================================================
+// One memoized estimate of a TravelEstimator
+struct TravelCacheEntry
+{
+  uint64_t start;
+  uint64_t goal;
+  TravelTable::Record record;
+};
+
+//==============================================================================
+// Write a snapshot of memoized estimates. The file has the same header as a
+// TravelTable, with its own magic "RMFTRVC", followed by a uint64 count and
+// that many entries. Throws std::runtime_error if the file cannot be written.
+void write_travel_cache(
+  const std::string& path,
+  const Parameters& parameters,
+  const std::vector<TravelCacheEntry>& entries);
+
+//==============================================================================
+// Read a snapshot that was written by write_travel_cache(). Nothing is returned
+// if the file does not exist, cannot be read, or was written for different
+// parameters, so an outdated snapshot is simply discarded.
+std::vector<TravelCacheEntry> read_travel_cache(
+  const std::string& path,
+  const Parameters& parameters);
+
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__TRAVELTABLE_HPP
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/UpdateCoalescer.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace rmf_task {
+
+namespace {
+
+using SteadyTime = std::chrono::steady_clock::time_point;
+
+//==============================================================================
+// A single background thread that wakes up coalescers when the notifications
+// that they are holding are due
+class Scheduler
+{
+public:
+
+  using Target = std::weak_ptr<UpdateCoalescer::Implementation>;
+
+  static Scheduler& get()
+  {
+    static Scheduler scheduler;
+    return scheduler;
+  }
+
+  void schedule(SteadyTime when, Target target)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _queue.emplace(when, std::move(target));
+    }
+    _wake.notify_one();
+  }
+
+  ~Scheduler()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_one();
+    _thread.join();
+  }
+
+private:
+
+  Scheduler()
+  : _thread([this]() { run(); })
+  {
+    // Do nothing
+  }
+
+  void run();
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::multimap<SteadyTime, Target> _queue;
+  bool _stop = false;
+  std::thread _thread;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+class UpdateCoalescer::Implementation
+  : public std::enable_shared_from_this<Implementation>
+{
+public:
+
+  Implementation(Update update_, rmf_traffic::Duration minimum_period_)
+  : update(std::move(update_)),
+    minimum_period(minimum_period_)
+  {
+    // Do nothing
+  }
+
+  void notify(MakeSnapshot make_snapshot)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closed)
+      return;
+
+    if (held)
+      ++suppressed;
+
+    held = std::move(make_snapshot);
+    const auto now = std::chrono::steady_clock::now();
+    if (!last_delivery.has_value() || *last_delivery + minimum_period <= now)
+      return deliver(lock, now);
+
+    if (!scheduled)
+    {
+      scheduled = true;
+      Scheduler::get().schedule(
+        *last_delivery + minimum_period, weak_from_this());
+    }
+  }
+
+  void flush()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (held)
+      deliver(lock, std::chrono::steady_clock::now());
+  }
+
+  // Called by the scheduler when a held notification may be due
+  void wake()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    scheduled = false;
+    if (!held)
+      return;
+
+    // Something may have been delivered since this wake up was scheduled
+    const auto due = *last_delivery + minimum_period;
+    const auto now = std::chrono::steady_clock::now();
+    if (now < due)
+    {
+      scheduled = true;
+      Scheduler::get().schedule(due, weak_from_this());
+      return;
+    }
+
+    deliver(lock, now);
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    held = nullptr;
+  }
+
+  // The lock must be held on the mutex and there must be a held notification.
+  // The delivery lock is taken before the mutex is released so that every
+  // delivery finishes before the next one begins.
+  void deliver(std::unique_lock<std::mutex>& lock, SteadyTime now)
+  {
+    const auto make_snapshot = std::move(held);
+    held = nullptr;
+    last_delivery = now;
+    ++delivered;
+
+    std::lock_guard<std::mutex> delivering(delivery_mutex);
+    lock.unlock();
+
+    update(make_snapshot());
+  }
+
+  const Update update;
+  const rmf_traffic::Duration minimum_period;
+
+  mutable std::mutex mutex;
+  MakeSnapshot held;
+  std::optional<SteadyTime> last_delivery;
+  bool scheduled = false;
+  bool closed = false;
+  std::size_t suppressed = 0;
+  std::size_t delivered = 0;
+
+  std::mutex delivery_mutex;
+};
+
+namespace {
+
+//==============================================================================
+void Scheduler::run()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_stop)
+  {
+    if (_queue.empty())
+    {
+      _wake.wait(lock);
+      continue;
+    }
+
+    const auto next = _queue.begin()->first;
+    if (std::chrono::steady_clock::now() < next)
+    {
+      _wake.wait_until(lock, next);
+      continue;
+    }
+
+    std::vector<Target> due;
+    const auto now = std::chrono::steady_clock::now();
+    while (!_queue.empty() && _queue.begin()->first <= now)
+    {
+      due.push_back(std::move(_queue.begin()->second));
+      _queue.erase(_queue.begin());
+    }
+
+    lock.unlock();
+    for (const auto& target : due)
+    {
+      if (const auto coalescer = target.lock())
+        coalescer->wake();
+    }
+    lock.lock();
+  }
+}
+
+} // anonymous namespace
+
+//==============================================================================
+UpdateCoalescer::UpdateCoalescer(
+  Update update,
+  const rmf_traffic::Duration minimum_period)
+: _pimpl(std::make_shared<Implementation>(std::move(update), minimum_period))
+{
+  // Do nothing
+}
+
+//==============================================================================
+void UpdateCoalescer::notify(MakeSnapshot make_snapshot)
+{
+  _pimpl->notify(std::move(make_snapshot));
+}
+
+//==============================================================================
+void UpdateCoalescer::notify(Phase::ConstSnapshotPtr snapshot)
+{
+  _pimpl->notify([snapshot = std::move(snapshot)]() { return snapshot; });
+}
+
+//==============================================================================
+void UpdateCoalescer::flush()
+{
+  _pimpl->flush();
+}
+
+//==============================================================================
+rmf_traffic::Duration UpdateCoalescer::minimum_period() const
+{
+  return _pimpl->minimum_period;
+}
+
+//==============================================================================
+std::size_t UpdateCoalescer::suppressed() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->suppressed;
+}
+
+//==============================================================================
+std::size_t UpdateCoalescer::delivered() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->delivered;
+}
+
+//==============================================================================
+UpdateCoalescer::~UpdateCoalescer()
+{
+  _pimpl->close();
+}
+
+} // namespace rmf_task
@@ -17,6 +17,8 @@
 
 #include <rmf_task/VersionedString.hpp>
 
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 
 namespace rmf_task {
@@ -26,20 +28,51 @@ class VersionedString::Implementation
 {
 public:
 
+  // A value together with the number of its version. Each update makes a new
+  // one of these, and it is never modified after it has been published.
+  struct Version
+  {
+    uint64_t number;
+    std::string value;
+  };
+
+  using VersionPtr = std::shared_ptr<const Version>;
+
   Implementation(std::string initial_value)
-  : value(std::make_shared<std::string>(std::move(initial_value)))
+  : current(std::make_shared<Version>(Version{0, std::move(initial_value)}))
   {
     // Do nothing
   }
 
-  using ValuePtr = std::shared_ptr<const std::string>;
-  ValuePtr value;
+  // The mutex only guards swapping and copying the pointer of the current
+  // version, so it is held very briefly.
+  mutable std::mutex mutex;
+  VersionPtr current;
+
+  // A copy of the current version number that can be read without the mutex
+  std::atomic<uint64_t> number = 0;
 
   // The token is used to uniquely identify this VersionedString.
   struct Token {};
   using TokenPtr = std::shared_ptr<const Token>;
   TokenPtr token = std::make_shared<Token>();
 
+  void update(std::string new_value)
+  {
+    auto next = std::make_shared<Version>(Version{0, std::move(new_value)});
+    VersionPtr previous;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      next->number = current->number + 1;
+      previous = std::move(current);
+      current = std::move(next);
+      number.store(current->number, std::memory_order_release);
+    }
+
+    // The previous value is released after the mutex so that nobody waits on
+    // its deallocation
+  }
+
   View make_view() const;
 };
 
@@ -48,15 +81,15 @@ class VersionedString::View::Implementation
 {
 public:
 
-  using ValuePtr = VersionedString::Implementation::ValuePtr;
+  using VersionPtr = VersionedString::Implementation::VersionPtr;
   using TokenPtr = VersionedString::Implementation::TokenPtr;
 
-  static View make(ValuePtr value, TokenPtr token)
+  static View make(VersionPtr version, TokenPtr token)
   {
     View output;
     output._pimpl = rmf_utils::make_impl<Implementation>(
       Implementation{
-        std::move(value),
+        std::move(version),
         std::move(token)
       });
 
@@ -68,7 +101,7 @@ public:
     return *view._pimpl;
   }
 
-  ValuePtr value;
+  VersionPtr version;
   TokenPtr token;
 
 };
@@ -78,17 +111,14 @@ class VersionedString::Reader::Implementation
 {
 public:
 
-  using ValuePtr = VersionedString::Implementation::ValuePtr;
-  using WeakValuePtr = ValuePtr::weak_type;
-
   using Token = VersionedString::Implementation::Token;
   using TokenPtr = VersionedString::Implementation::TokenPtr;
   using WeakTokenPtr = TokenPtr::weak_type;
 
   struct Memory
   {
-    WeakValuePtr last_value;
     WeakTokenPtr token;
+    uint64_t last_version = 0;
 
     Memory()
     {
@@ -98,7 +128,7 @@ public:
 
   std::unordered_map<const Token*, Memory> memories;
 
-  ValuePtr read(const View& view)
+  std::shared_ptr<const std::string> read(const View& view)
   {
     const auto& v = View::Implementation::get(view);
     const auto it = memories.insert({v.token.get(), Memory()}).first;
@@ -106,28 +136,31 @@ public:
     if (memory.token.lock())
     {
       // If we can successfully lock the memory token, then we do remember this
-      // same versioned string.
-      if (const auto last_value = memory.last_value.lock())
-      {
-        if (last_value == v.value)
-        {
-          // If our memory of the last_value is still valid and matches with the
-          // value that we are receiving now, then this value is a duplicate.
-          return nullptr;
-        }
-      }
+      // same versioned string, and the version numbers tell whether this
+      // value is a duplicate.
+      if (memory.last_version == v.version->number)
+        return nullptr;
     }
 
     memory.token = v.token;
-    memory.last_value = v.value;
-    return v.value;
+    memory.last_version = v.version->number;
+
+    // Share ownership with the version instead of allocating another string
+    return std::shared_ptr<const std::string>(v.version, &v.version->value);
   }
 };
 
 //==============================================================================
 auto VersionedString::Implementation::make_view() const -> View
 {
-  return VersionedString::View::Implementation::make(value, token);
+  VersionPtr version;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    version = current;
+  }
+
+  return VersionedString::View::Implementation::make(
+    std::move(version), token);
 }
 
 //==============================================================================
@@ -140,7 +173,7 @@ VersionedString::VersionedString(std::string initial_value)
 //==============================================================================
 void VersionedString::update(std::string new_value)
 {
-  _pimpl->value = std::make_shared<std::string>(std::move(new_value));
+  _pimpl->update(std::move(new_value));
 }
 
 //==============================================================================
@@ -149,6 +182,18 @@ auto VersionedString::view() const -> View
   return _pimpl->make_view();
 }
 
+//==============================================================================
+uint64_t VersionedString::version() const
+{
+  return _pimpl->number.load(std::memory_order_acquire);
+}
+
+//==============================================================================
+uint64_t VersionedString::View::version() const
+{
+  return _pimpl->version->number;
+}
+
 //==============================================================================
 VersionedString::View::View()
 {
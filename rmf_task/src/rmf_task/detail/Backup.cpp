@@ -25,12 +25,22 @@ class Backup::Implementation
 {
 public:
   uint64_t sequence;
-  std::string state;
+  // Never null. Copies of a Backup share this instead of copying the state.
+  SharedState state;
 };
 
 //==============================================================================
 Backup Backup::make(uint64_t seq, std::string state)
 {
+  return make(seq, std::make_shared<const std::string>(std::move(state)));
+}
+
+//==============================================================================
+Backup Backup::make(uint64_t seq, SharedState state)
+{
+  if (!state)
+    state = std::make_shared<const std::string>();
+
   Backup output;
   output._pimpl = rmf_utils::make_impl<Implementation>(
     Implementation{seq, std::move(state)});
@@ -53,6 +63,12 @@ Backup& Backup::sequence(uint64_t seq)
 
 //==============================================================================
 const std::string& Backup::state() const
+{
+  return *_pimpl->state;
+}
+
+//==============================================================================
+auto Backup::shared_state() const -> const SharedState&
 {
   return _pimpl->state;
 }
@@ -60,7 +76,8 @@ const std::string& Backup::state() const
 //==============================================================================
 Backup& Backup::state(std::string new_state)
 {
-  _pimpl->state = std::move(new_state);
+  // Other copies of this Backup keep the buffer that they already share
+  _pimpl->state = std::make_shared<const std::string>(std::move(new_state));
   return *this;
 }
 
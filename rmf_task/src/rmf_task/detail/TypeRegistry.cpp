@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/detail/TypeRegistry.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rmf_task {
+namespace detail {
+
+//==============================================================================
+class TypeRegistry::Implementation
+{
+public:
+
+  std::unordered_map<std::type_index, std::size_t> ids;
+
+  // The type_info that each type was registered with, ordered by ID
+  std::vector<const std::type_info*> types;
+
+  // Sorted by address. This is only filled in once the registry is frozen.
+  std::vector<std::pair<const std::type_info*, std::size_t>> frozen_ids;
+  bool frozen = false;
+};
+
+//==============================================================================
+TypeRegistry::TypeRegistry()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+std::size_t TypeRegistry::insert(const std::type_info& type)
+{
+  if (const auto id = find(type))
+    return *id;
+
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (_pimpl->frozen)
+  {
+    throw std::runtime_error(
+      "[rmf_task::detail::TypeRegistry::insert] Cannot register the new type ["
+      + std::string(type.name()) + "] after the registry has been frozen");
+  }
+  // *INDENT-ON*
+
+  const auto id = _pimpl->types.size();
+  _pimpl->ids.insert({type, id});
+  _pimpl->types.push_back(&type);
+  return id;
+}
+
+//==============================================================================
+std::optional<std::size_t> TypeRegistry::find(const std::type_info& type) const
+{
+  if (_pimpl->frozen)
+  {
+    const auto& frozen_ids = _pimpl->frozen_ids;
+    const auto it = std::lower_bound(
+      frozen_ids.begin(), frozen_ids.end(), &type,
+      [](const auto& entry, const std::type_info* t)
+      {
+        return std::less<const std::type_info*>()(entry.first, t);
+      });
+
+    if (it != frozen_ids.end() && it->first == &type)
+      return it->second;
+  }
+
+  const auto it = _pimpl->ids.find(type);
+  if (it == _pimpl->ids.end())
+    return std::nullopt;
+
+  return it->second;
+}
+
+//==============================================================================
+std::size_t TypeRegistry::size() const
+{
+  return _pimpl->types.size();
+}
+
+//==============================================================================
+void TypeRegistry::freeze()
+{
+  if (_pimpl->frozen)
+    return;
+
+  _pimpl->frozen = true;
+  const auto& types = _pimpl->types;
+  auto& frozen_ids = _pimpl->frozen_ids;
+  frozen_ids.reserve(types.size());
+  for (std::size_t id = 0; id < types.size(); ++id)
+    frozen_ids.push_back({types[id], id});
+
+  std::sort(
+    frozen_ids.begin(), frozen_ids.end(),
+    [](const auto& a, const auto& b)
+    {
+      return std::less<const std::type_info*>()(a.first, b.first);
+    });
+}
+
+//==============================================================================
+bool TypeRegistry::frozen() const
+{
+  return _pimpl->frozen;
+}
+
+} // namespace detail
+} // namespace rmf_task
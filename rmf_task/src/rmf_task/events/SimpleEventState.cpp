@@ -32,6 +32,9 @@ public:
   Log log;
   std::vector<Event::ConstStatePtr> dependencies;
 
+  // Counts the changes to the fields that do not have versions of their own
+  uint64_t changes = 0;
+
 };
 
 //==============================================================================
@@ -66,7 +69,11 @@ uint64_t SimpleEventState::id() const
 //==============================================================================
 SimpleEventState& SimpleEventState::modify_id(uint64_t new_id)
 {
+  if (_pimpl->id == new_id)
+    return *this;
+
   _pimpl->id = new_id;
+  ++_pimpl->changes;
   return *this;
 }
 
@@ -79,7 +86,11 @@ Event::Status SimpleEventState::status() const
 //==============================================================================
 SimpleEventState& SimpleEventState::update_status(Event::Status new_status)
 {
+  if (_pimpl->status == new_status)
+    return *this;
+
   _pimpl->status = new_status;
+  ++_pimpl->changes;
   return *this;
 }
 
@@ -131,7 +142,11 @@ std::vector<Event::ConstStatePtr> SimpleEventState::dependencies() const
 SimpleEventState& SimpleEventState::update_dependencies(
   std::vector<ConstStatePtr> new_dependencies)
 {
-  _pimpl->dependencies = new_dependencies;
+  if (_pimpl->dependencies == new_dependencies)
+    return *this;
+
+  _pimpl->dependencies = std::move(new_dependencies);
+  ++_pimpl->changes;
   return *this;
 }
 
@@ -139,9 +154,18 @@ SimpleEventState& SimpleEventState::update_dependencies(
 SimpleEventState& SimpleEventState::add_dependency(ConstStatePtr new_dependency)
 {
   _pimpl->dependencies.push_back(new_dependency);
+  ++_pimpl->changes;
   return *this;
 }
 
+//==============================================================================
+std::optional<uint64_t> SimpleEventState::version() const
+{
+  // Each of these only grows, so their sum changes whenever any of them does
+  return _pimpl->changes + _pimpl->name.version() + _pimpl->detail.version()
+    + _pimpl->log.version();
+}
+
 //==============================================================================
 SimpleEventState::SimpleEventState()
 {
@@ -16,28 +16,44 @@
 */
 
 #include "internal_task_planning.hpp"
+#include "BinaryPriority.hpp"
+
 #include <rmf_task/requests/ChargeBattery.hpp>
 
 namespace rmf_task {
 
 // ============================================================================
-void Candidates::update_map()
+Candidates::Candidates(FinishTimes finish_times, Entries entries)
+: _finish_times(std::move(finish_times)),
+  _entries(std::move(entries))
 {
-  for (auto it = _value_map.begin(); it != _value_map.end(); ++it)
-  {
-    const auto c = it->second.candidate;
-    if (_candidate_map.size() <= c)
-      _candidate_map.resize(c+1);
+  _update_best();
+}
+
+// ============================================================================
+void Candidates::_update_best()
+{
+  assert(!_finish_times.empty());
+  _best_finish_time = *std::min_element(
+    _finish_times.begin(), _finish_times.end());
 
-    _candidate_map[c] = it;
+  _earliest_best_wait_until = rmf_traffic::Time::max();
+  for (std::size_t i = _next_best(0); i < _finish_times.size();
+    i = _next_best(i + 1))
+  {
+    if (_entries[i] && _entries[i]->wait_until < _earliest_best_wait_until)
+      _earliest_best_wait_until = _entries[i]->wait_until;
   }
 }
 
 // ============================================================================
-Candidates::Candidates(Candidates::Map candidate_values)
-: _value_map(std::move(candidate_values))
+std::size_t Candidates::_next_best(std::size_t index) const
 {
-  update_map();
+  const std::size_t N = _finish_times.size();
+  while (index < N && _finish_times[index] != _best_finish_time)
+    ++index;
+
+  return index;
 }
 
 // ============================================================================
@@ -45,113 +61,384 @@ void Candidates::update_candidate(
   std::size_t candidate,
   State state,
   rmf_traffic::Time wait_until,
-  State previous_state,
+  ConstStatePtr previous_state,
   bool require_charge_battery)
 {
-  const auto it = _candidate_map.at(candidate);
-  _value_map.erase(it);
-  _candidate_map[candidate] = _value_map.insert(
-    {
-      state.time().value(),
-      Entry{candidate, state, wait_until, previous_state, require_charge_battery}
+  assert(_entries.at(candidate));
+  const auto finish_time = state.time().value();
+  _entries[candidate] = std::make_shared<const Entry>(
+    Entry{
+      candidate,
+      std::move(state),
+      wait_until,
+      std::move(previous_state),
+      require_charge_battery
     });
+
+  const auto previous_finish_time = _finish_times[candidate];
+  _finish_times[candidate] = finish_time;
+  if (finish_time < _best_finish_time)
+  {
+    _best_finish_time = finish_time;
+    _earliest_best_wait_until = wait_until;
+  }
+  else if (previous_finish_time == _best_finish_time)
+  {
+    // This candidate was already among the best, so the wait that it had
+    // before may have been the earliest one
+    _update_best();
+  }
+  else if (finish_time == _best_finish_time)
+  {
+    if (wait_until < _earliest_best_wait_until)
+      _earliest_best_wait_until = wait_until;
+  }
+}
+
+// ============================================================================
+bool Candidates::delay(
+  const rmf_traffic::Time release_time,
+  const Constraints& constraints,
+  const Task::Model& task_model,
+  const Task::Model& charging_model,
+  const TravelEstimator& travel_estimator,
+  PlanCounters* counters)
+{
+  const auto count_estimates = [counters](std::size_t n)
+    {
+      if (counters)
+        counters->estimate_finish_calls += n;
+    };
+
+  bool any_candidate = false;
+  for (std::size_t i = 0; i < _entries.size(); ++i)
+  {
+    const auto entry = _entries[i];
+    if (!entry)
+      continue;
+
+    if (release_time <= entry->wait_until)
+    {
+      any_candidate = true;
+      continue;
+    }
+
+    // An agent that needs to charge first still charges right away and only
+    // waits for the release once it is done charging
+    State start = *entry->previous_state;
+    if (entry->require_charge_battery)
+    {
+      auto battery_estimate = FinishEstimator(
+        start, constraints, travel_estimator)(charging_model);
+      count_estimates(1);
+      if (!battery_estimate.has_value())
+      {
+        _entries[i] = nullptr;
+        _finish_times[i] = rmf_traffic::Time::max();
+        continue;
+      }
+
+      start = std::move(battery_estimate->finish_state);
+    }
+
+    if (start.time().value() < release_time)
+      start.time(release_time);
+
+    auto finish = FinishEstimator(
+      start, constraints, travel_estimator)(task_model);
+    count_estimates(1);
+    if (!finish.has_value())
+    {
+      _entries[i] = nullptr;
+      _finish_times[i] = rmf_traffic::Time::max();
+      continue;
+    }
+
+    _finish_times[i] = finish->finish_state.time().value();
+    _entries[i] = std::make_shared<const Entry>(
+      Entry{
+        i,
+        std::move(finish->finish_state),
+        finish->wait_until,
+        entry->previous_state,
+        entry->require_charge_battery
+      });
+    any_candidate = true;
+  }
+
+  _update_best();
+  return any_candidate;
 }
 
 // ============================================================================
 rmf_traffic::Time Candidates::best_finish_time() const
 {
-  assert(!_value_map.empty());
-  return _value_map.begin()->first;
+  return _best_finish_time;
+}
+
+// ============================================================================
+rmf_traffic::Time Candidates::earliest_best_wait_until() const
+{
+  return _earliest_best_wait_until;
+}
+
+// ============================================================================
+double Candidates::regret(const std::size_t k) const
+{
+  if (k < 2)
+    return 0.0;
+
+  if (k > _finish_times.size())
+    return std::numeric_limits<double>::infinity();
+
+  thread_local std::vector<rmf_traffic::Time> best;
+  best.assign(_finish_times.begin(), _finish_times.end());
+  std::partial_sort(best.begin(), best.begin() + k, best.end());
+  if (best[k-1] == rmf_traffic::Time::max())
+    return std::numeric_limits<double>::infinity();
+
+  Ticks total = 0;
+  for (std::size_t i = 1; i < k; ++i)
+    total += to_ticks(best[i] - best[0]);
+
+  return ticks_to_seconds(total);
 }
 
 // ============================================================================
 Candidates::Range Candidates::best_candidates() const
 {
-  assert(!_value_map.empty());
+  return Range{
+    const_iterator(this, _next_best(0)),
+    const_iterator(this, _finish_times.size())
+  };
+}
 
-  Range range;
-  range.begin = _value_map.begin();
-  auto it = range.begin;
-  while (it->first == range.begin->first)
-    ++it;
+// ============================================================================
+auto Candidates::find(std::size_t candidate) const -> const Entry*
+{
+  if (candidate >= _entries.size())
+    return nullptr;
 
-  range.end = it;
-  return range;
+  return _entries[candidate].get();
 }
 
 // ============================================================================
-Candidates& Candidates::operator=(const Candidates& other)
+FinishEstimator::FinishEstimator(
+  const State& initial_state,
+  const Constraints& constraints,
+  const TravelEstimator& travel_estimator)
+: _initial_state(initial_state),
+  _planning_state(PlanningState::from(initial_state)),
+  _constraints(constraints),
+  _travel_estimator(travel_estimator)
 {
-  _value_map = other._value_map;
-  update_map();
-  return *this;
+  // Do nothing
 }
 
 // ============================================================================
-Candidates::Candidates(const Candidates& other)
+std::optional<EstimatedFinish> FinishEstimator::operator()(
+  const Task::Model& model) const
 {
-  _value_map = other._value_map;
-  update_map();
+  if (_planning_state.has_value() && model.uses_planning_state())
+  {
+    const auto estimate = model.estimate_planning_finish(
+      *_planning_state, _constraints, _travel_estimator);
+    if (!estimate.has_value())
+      return std::nullopt;
+
+    return EstimatedFinish{
+      estimate->finish_state.to_state(),
+      estimate->wait_until
+    };
+  }
+
+  const auto estimate = model.estimate_finish(
+    _initial_state, _constraints, _travel_estimator);
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return EstimatedFinish{estimate->finish_state(), estimate->wait_until()};
+}
+
+// ============================================================================
+std::vector<std::optional<EstimatedFinish>> FinishEstimator::batch(
+  const Task::Model& model,
+  const std::vector<State>& initial_states,
+  const Constraints& constraints,
+  const TravelEstimator& travel_estimator)
+{
+  std::vector<std::optional<EstimatedFinish>> finishes;
+  finishes.reserve(initial_states.size());
+  if (model.uses_planning_state())
+  {
+    for (const auto& state : initial_states)
+    {
+      finishes.push_back(
+        FinishEstimator(state, constraints, travel_estimator)(model));
+    }
+
+    return finishes;
+  }
+
+  // Models that do not use planning states may share work between the states
+  // in their batch estimate
+  const auto estimates = model.estimate_finish_batch(
+    initial_states, constraints, travel_estimator);
+  for (const auto& estimate : estimates)
+  {
+    if (estimate.has_value())
+    {
+      finishes.push_back(
+        EstimatedFinish{estimate->finish_state(), estimate->wait_until()});
+    }
+    else
+    {
+      finishes.push_back(std::nullopt);
+    }
+  }
+
+  return finishes;
 }
 
 // ============================================================================
 std::shared_ptr<Candidates> Candidates::make(
-  const rmf_traffic::Time start_time,
   const std::vector<State>& initial_states,
   const Constraints& constraints,
-  const Parameters& parameters,
   const Task::Model& task_model,
+  const Task::Model& charging_model,
+  const TravelEstimator& travel_estimator,
+  std::optional<TaskPlanner::TaskPlannerError>& error,
+  std::pmr::memory_resource* memory,
+  PlanCounters* counters,
+  const std::vector<ConstStatePtr>* shared_initial_states)
+{
+  return _make(
+    nullptr, nullptr, initial_states, constraints, task_model, charging_model,
+    travel_estimator, error, memory, counters, shared_initial_states);
+}
+
+// ============================================================================
+std::shared_ptr<Candidates> Candidates::carry(
+  const Candidates& previous,
+  const std::vector<bool>& changed,
+  const std::vector<State>& initial_states,
+  const Constraints& constraints,
+  const Task::Model& task_model,
+  const Task::Model& charging_model,
   const TravelEstimator& travel_estimator,
-  const std::string& planner_id,
-  TaskPlanner::TaskPlannerError& error)
+  std::optional<TaskPlanner::TaskPlannerError>& error,
+  std::pmr::memory_resource* memory,
+  PlanCounters* counters,
+  const std::vector<ConstStatePtr>* shared_initial_states)
 {
-  Map initial_map;
+  return _make(
+    &previous, &changed, initial_states, constraints, task_model,
+    charging_model, travel_estimator, error, memory, counters,
+    shared_initial_states);
+}
+
+// ============================================================================
+std::shared_ptr<Candidates> Candidates::_make(
+  const Candidates* previous,
+  const std::vector<bool>* changed,
+  const std::vector<State>& initial_states,
+  const Constraints& constraints,
+  const Task::Model& task_model,
+  const Task::Model& charging_model,
+  const TravelEstimator& travel_estimator,
+  std::optional<TaskPlanner::TaskPlannerError>& error,
+  std::pmr::memory_resource* memory,
+  PlanCounters* counters,
+  const std::vector<ConstStatePtr>* shared_initial_states)
+{
+  const auto count_estimates = [counters](std::size_t n)
+    {
+      if (counters)
+        counters->estimate_finish_calls += n;
+    };
+
+  const auto initial_state_ptr = [&](const std::size_t i) -> ConstStatePtr
+    {
+      if (shared_initial_states)
+        return (*shared_initial_states)[i];
+
+      return std::make_shared<const State>(initial_states[i]);
+    };
+
+  FinishTimes finish_times(
+    initial_states.size(), rmf_traffic::Time::max(),
+    FinishTimes::allocator_type(memory));
+  Entries entries(initial_states.size(), Entries::allocator_type(memory));
+  bool any_candidate = false;
+
+  // The agents whose entries need to be estimated
+  std::vector<std::size_t> agents;
+  std::vector<State> states;
   for (std::size_t i = 0; i < initial_states.size(); ++i)
   {
+    if (previous && !(*changed)[i])
+    {
+      finish_times[i] = previous->_finish_times[i];
+      entries[i] = previous->_entries[i];
+      if (entries[i])
+      {
+        any_candidate = true;
+        if (counters)
+          ++counters->carried_candidates;
+      }
+
+      continue;
+    }
+
+    agents.push_back(i);
+    if (previous)
+      states.push_back(initial_states[i]);
+  }
+
+  auto finishes = FinishEstimator::batch(
+    task_model, previous ? states : initial_states, constraints,
+    travel_estimator);
+  count_estimates(agents.size());
+  for (std::size_t k = 0; k < agents.size(); ++k)
+  {
+    const std::size_t i = agents[k];
     const auto& state = initial_states[i];
-    const auto finish = task_model.estimate_finish(
-      state, constraints, travel_estimator);
+    auto& finish = finishes[k];
     if (finish.has_value())
     {
-      initial_map.insert({
-          finish.value().finish_state().time().value(),
-          Entry{
-            i,
-            finish.value().finish_state(),
-            finish.value().wait_until(),
-            state,
-            false}});
+      finish_times[i] = finish->finish_state.time().value();
+      entries[i] = std::make_shared<const Entry>(
+        Entry{
+          i,
+          std::move(finish->finish_state),
+          finish->wait_until,
+          initial_state_ptr(i),
+          false});
+      any_candidate = true;
     }
     else
     {
-      auto charge_battery = requests::ChargeBattery::make(
-        start_time,
-        planner_id,
-        start_time,
-        nullptr,
-        true);
-      const auto battery_model = charge_battery->description()->make_model(
-        start_time,
-        parameters);
-      auto battery_estimate =
-        battery_model->estimate_finish(
-        state, constraints, travel_estimator);
+      const auto battery_estimate = FinishEstimator(
+        state, constraints, travel_estimator)(charging_model);
+      count_estimates(1);
       if (battery_estimate.has_value())
       {
-        auto new_finish = task_model.estimate_finish(
-          battery_estimate.value().finish_state(),
+        auto new_finish = FinishEstimator(
+          battery_estimate->finish_state,
           constraints,
-          travel_estimator);
+          travel_estimator)(task_model);
+        count_estimates(1);
         if (new_finish.has_value())
         {
-          initial_map.insert(
-            {new_finish.value().finish_state().time().value(),
-              Entry{
-                i,
-                new_finish.value().finish_state(),
-                new_finish.value().wait_until(),
-                state,
-                true}});
+          finish_times[i] = new_finish->finish_state.time().value();
+          entries[i] = std::make_shared<const Entry>(
+            Entry{
+              i,
+              std::move(new_finish->finish_state),
+              new_finish->wait_until,
+              initial_state_ptr(i),
+              true});
+          any_candidate = true;
         }
         else
         {
@@ -172,25 +459,169 @@ std::shared_ptr<Candidates> Candidates::make(
     }
   }
 
-  if (initial_map.empty())
+  if (!any_candidate)
   {
     return nullptr;
   }
 
   std::shared_ptr<Candidates> candidates(
-    new Candidates(std::move(initial_map)));
+    new Candidates(std::move(finish_times), std::move(entries)));
   return candidates;
 }
 
+// ============================================================================
+SharedModelCache::SharedModelCache(const std::size_t capacity)
+: _capacity(capacity)
+{
+  // Do nothing
+}
+
+// ============================================================================
+Task::ConstModelPtr SharedModelCache::get(
+  const Task::Description& description,
+  const rmf_traffic::Time earliest_start_time)
+{
+  if (_capacity == 0)
+    return nullptr;
+
+  const auto hash = description.model_hash();
+  if (!hash.has_value())
+    return nullptr;
+
+  Task::ConstModelPtr model;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _models.find({typeid(description), *hash});
+    if (it != _models.end())
+    {
+      _recent.splice(_recent.begin(), _recent, it->second.recent);
+      model = it->second.model;
+    }
+  }
+
+  if (model)
+    model = model->with_earliest_start_time(earliest_start_time);
+
+  if (model)
+    ++_hits;
+  else
+    ++_misses;
+
+  return model;
+}
+
+// ============================================================================
+void SharedModelCache::insert(
+  const Task::Description& description,
+  Task::ConstModelPtr model)
+{
+  if (_capacity == 0)
+    return;
+
+  const auto hash = description.model_hash();
+  if (!hash.has_value())
+    return;
+
+  const Key key{typeid(description), *hash};
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto it = _models.find(key);
+  if (it != _models.end())
+  {
+    it->second.model = std::move(model);
+    _recent.splice(_recent.begin(), _recent, it->second.recent);
+    return;
+  }
+
+  _recent.push_front(key);
+  _models.insert({key, Entry{std::move(model), _recent.begin()}});
+  while (_models.size() > _capacity)
+  {
+    _models.erase(_recent.back());
+    _recent.pop_back();
+  }
+}
+
+// ============================================================================
+std::size_t SharedModelCache::hits() const
+{
+  return _hits;
+}
+
+// ============================================================================
+std::size_t SharedModelCache::misses() const
+{
+  return _misses;
+}
+
+// ============================================================================
+ModelCache::ModelCache(std::shared_ptr<SharedModelCache> shared)
+: _shared(std::move(shared)),
+  _cores(std::numeric_limits<std::size_t>::max())
+{
+  // Do nothing
+}
+
+// ============================================================================
+Task::ConstModelPtr ModelCache::get(
+  const ConstRequestPtr& request,
+  const rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters,
+  const TravelEstimator& travel_estimator)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _models.find(request.get());
+    if (it != _models.end()
+      && it->second.earliest_start_time == earliest_start_time)
+      return it->second.model;
+  }
+
+  // Construct the model without holding the lock, since it may need to plan
+  // routes through the navigation graph
+  const auto& description = *request->description();
+  Task::ConstModelPtr model =
+    _shared ? _shared->get(description, earliest_start_time) : nullptr;
+
+  if (!model)
+    model = _cores.get(description, earliest_start_time);
+
+  if (!model)
+  {
+    model = description.make_model(
+      earliest_start_time, parameters, travel_estimator);
+
+    _cores.insert(description, model);
+    if (_shared)
+      _shared->insert(description, model);
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _models[request.get()] = Entry{request, earliest_start_time, model};
+  return model;
+}
+
 // ============================================================================
 PendingTask::PendingTask(ConstRequestPtr request_,
   Task::ConstModelPtr model_,
   Candidates candidates_)
-: request(std::move(request_)),
-  model(std::move(model_)),
-  candidates(candidates_)
+: candidates(std::move(candidates_)),
+  _source(_make_source(std::move(request_), std::move(model_)))
 {
+  // Do nothing
+}
 
+// ============================================================================
+auto PendingTask::_make_source(
+  ConstRequestPtr request_,
+  Task::ConstModelPtr model_) -> Source
+{
+  Source source{std::move(request_), std::move(model_)};
+  source.priority_level =
+    BinaryPriority::level(source.request->booking()->priority());
+  source.is_charging = dynamic_cast<
+    const rmf_task::requests::ChargeBattery::Description*>(
+    source.request->description().get()) != nullptr;
+  return source;
 }
 
 // ============================================================================
@@ -200,18 +631,30 @@ std::shared_ptr<PendingTask> PendingTask::make(
   const Constraints& constraints,
   const Parameters& parameters,
   const ConstRequestPtr request_,
+  const Task::Model& charging_model,
   const TravelEstimator& travel_estimator,
-  const std::string& planner_id,
-  TaskPlanner::TaskPlannerError& error)
+  std::optional<TaskPlanner::TaskPlannerError>& error,
+  std::pmr::memory_resource* memory,
+  ModelCache* models,
+  PlanCounters* counters,
+  const std::vector<Candidates::ConstStatePtr>* shared_initial_states)
 {
   const auto earliest_start_time = std::max(
     start_time,
     request_->booking()->earliest_start_time());
-  const auto model = request_->description()->make_model(
-    earliest_start_time, parameters);
+  const auto model = models ?
+    models->get(request_, earliest_start_time, parameters, travel_estimator) :
+    request_->description()->make_model(
+    earliest_start_time, parameters, travel_estimator);
+
+  // Models may defer their travel planning until now. This runs on whichever
+  // thread is building this pending task, so the models of many requests are
+  // materialized concurrently.
+  model->materialize(travel_estimator);
 
-  const auto candidates = Candidates::make(start_time, initial_states,
-      constraints, parameters, *model, travel_estimator, planner_id, error);
+  const auto candidates = Candidates::make(initial_states, constraints,
+      *model, charging_model, travel_estimator, error, memory, counters,
+      shared_initial_states);
 
   if (!candidates)
     return nullptr;
@@ -221,4 +664,149 @@ std::shared_ptr<PendingTask> PendingTask::make(
   return pending_task;
 }
 
+// ============================================================================
+std::shared_ptr<PendingTask> PendingTask::share(
+  const PendingTask& other,
+  ConstRequestPtr request_)
+{
+  // The candidates are copied by handle, so the tasks share one table until
+  // one of them gets delayed by its dependencies
+  std::shared_ptr<PendingTask> pending_task(new PendingTask(other));
+  pending_task->_source = _make_source(std::move(request_), other.model());
+  return pending_task;
+}
+
+// ============================================================================
+std::shared_ptr<PendingTask> PendingTask::carry(
+  const PendingTask& previous,
+  const std::vector<bool>& changed,
+  const std::vector<rmf_task::State>& initial_states,
+  const Constraints& constraints,
+  const Task::Model& charging_model,
+  const TravelEstimator& travel_estimator,
+  std::optional<TaskPlanner::TaskPlannerError>& error,
+  std::pmr::memory_resource* memory,
+  PlanCounters* counters,
+  const std::vector<Candidates::ConstStatePtr>* shared_initial_states)
+{
+  const auto candidates = Candidates::carry(*previous.candidates, changed,
+      initial_states, constraints, *previous.model(), charging_model,
+      travel_estimator, error, memory, counters, shared_initial_states);
+
+  if (!candidates)
+    return nullptr;
+
+  std::shared_ptr<PendingTask> pending_task(
+    new PendingTask(previous.request(), previous.model(), *candidates));
+  return pending_task;
+}
+
+// ============================================================================
+void Node::push_assignment(std::size_t agent, AssignmentWrapper assignment)
+{
+  auto& assignments = assigned_tasks[agent].mutate();
+  fingerprint.toggle(agent, assignments.size(), assignment.internal_id);
+  accumulated_cost += assignment.cost;
+
+  const auto finish_time = assignment.assignment.finish_state().time().value();
+  if (latest_finish_time < finish_time)
+    latest_finish_time = finish_time;
+
+  if (agent_priorities.size() < assigned_tasks.size())
+    agent_priorities.resize(assigned_tasks.size());
+
+  auto summary = agent_priorities[agent];
+  _add_priority(summary, assignment);
+  _set_priorities(agent, summary);
+
+  if (!chargers.empty())
+  {
+    const auto charger =
+      assignment.assignment.finish_state().dedicated_charging_waypoint();
+    if (charger.has_value())
+      chargers[agent] = *charger;
+  }
+
+  assignments.push_back(std::move(assignment));
+}
+
+// ============================================================================
+void Node::pop_assignment(std::size_t agent)
+{
+  auto& assignments = assigned_tasks[agent].mutate();
+  fingerprint.toggle(
+    agent, assignments.size() - 1, assignments.back().internal_id);
+  accumulated_cost -= assignments.back().cost;
+  assignments.pop_back();
+
+  // Popping only happens while backtracking, so the summary of this agent is
+  // simply rebuilt from its remaining assignments
+  AgentPriorities summary;
+  for (const auto& a : assignments)
+    _add_priority(summary, a);
+
+  _set_priorities(agent, summary);
+
+  if (!chargers.empty())
+  {
+    chargers[agent] = (*initial_chargers)[agent];
+    if (!assignments.empty())
+    {
+      chargers[agent] = assignments.back().assignment.finish_state()
+        .dedicated_charging_waypoint().value_or(chargers[agent]);
+    }
+  }
+
+  // Likewise the latest finish time is rebuilt from the last assignment of
+  // every agent
+  latest_finish_time = rmf_traffic::Time::min();
+  for (const auto& a : assigned_tasks)
+  {
+    if (a->empty())
+      continue;
+
+    const auto finish_time = a->back().assignment.finish_state().time().value();
+    if (latest_finish_time < finish_time)
+      latest_finish_time = finish_time;
+  }
+}
+
+// ============================================================================
+void Node::_add_priority(
+  AgentPriorities& summary,
+  const AssignmentWrapper& assignment)
+{
+  if (assignment.is_charging)
+    return;
+
+  const auto level = assignment.priority_level;
+  if (level > 0)
+    ++summary.prioritized;
+
+  if (level > summary.lowest_level)
+    summary.inverted = true;
+  else
+    summary.lowest_level = level;
+}
+
+// ============================================================================
+void Node::_set_priorities(std::size_t agent, AgentPriorities summary)
+{
+  auto& current = agent_priorities[agent];
+  const auto update = [](std::size_t& count, bool before, bool after)
+    {
+      if (before && !after)
+        --count;
+      else if (!before && after)
+        ++count;
+    };
+
+  update(agents_with_priority, current.prioritized > 0, summary.prioritized > 0);
+  update(
+    agents_with_multiple_priorities,
+    current.prioritized > 1, summary.prioritized > 1);
+  update(agents_with_inversion, current.inverted, summary.inverted);
+  current = summary;
+}
+
 } // namespace rmf_task
@@ -20,29 +20,464 @@
 
 #include <rmf_task/TaskPlanner.hpp>
 
+#include "InvariantHeuristicQueue.hpp"
+
 #include <map>
+#include <memory>
+#include <optional>
+#include <memory_resource>
 #include <set>
 #include <algorithm>
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <typeindex>
 #include <unordered_map>
+#include <utility>
 #include <limits>
 
 namespace rmf_task {
 
+// ============================================================================
+/// An allocator that draws from a memory resource, such as the arena of a
+/// single plan() call. Unlike std::pmr::polymorphic_allocator, it is
+/// propagated when a container is copied, so the copies that get made while
+/// expanding a node stay inside the same arena as the original.
+template<typename T>
+class PlanAllocator
+{
+public:
+
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PlanAllocator(
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+  : _memory(memory)
+  {
+    // Do nothing
+  }
+
+  template<typename U>
+  PlanAllocator(const PlanAllocator<U>& other)
+  : _memory(other.memory())
+  {
+    // Do nothing
+  }
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(_memory->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    _memory->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  std::pmr::memory_resource* memory() const
+  {
+    return _memory;
+  }
+
+private:
+  std::pmr::memory_resource* _memory;
+};
+
+template<typename T, typename U>
+bool operator==(const PlanAllocator<T>& a, const PlanAllocator<U>& b)
+{
+  return a.memory() == b.memory() || a.memory()->is_equal(*b.memory());
+}
+
+template<typename T, typename U>
+bool operator!=(const PlanAllocator<T>& a, const PlanAllocator<U>& b)
+{
+  return !(a == b);
+}
+
+// ============================================================================
+/// A memory resource that passes every request on to another resource while
+/// adding the number of bytes that get allocated to a total
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+
+  CountingResource(
+    std::pmr::memory_resource* upstream,
+    std::atomic_size_t& total)
+  : _upstream(upstream),
+    _total(total)
+  {
+    // Do nothing
+  }
+
+private:
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) final
+  {
+    _total.fetch_add(bytes, std::memory_order_relaxed);
+    return _upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) final
+  {
+    _upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept
+  final
+  {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* _upstream;
+  std::atomic_size_t& _total;
+};
+
+// ============================================================================
+/// While a scope is alive on a thread, the CopyOnWrite values that the thread
+/// makes count their handles with plain loads and stores instead of atomic
+/// read-modify-write instructions. The planner opens a scope for searches that
+/// run entirely on one thread, where nothing that is made during the search is
+/// ever seen by another thread. Scopes may be nested.
+class SingleThreadedScope
+{
+public:
+
+  SingleThreadedScope()
+  : _previous(_active())
+  {
+    _active() = true;
+  }
+
+  ~SingleThreadedScope()
+  {
+    _active() = _previous;
+  }
+
+  SingleThreadedScope(const SingleThreadedScope&) = delete;
+  SingleThreadedScope& operator=(const SingleThreadedScope&) = delete;
+
+  /// True if a scope is alive on this thread
+  static bool active()
+  {
+    return _active();
+  }
+
+private:
+
+  static bool& _active()
+  {
+    thread_local bool value = false;
+    return value;
+  }
+
+  bool _previous;
+};
+
+// ============================================================================
+/// A handle that lets search nodes share an immutable value until one of them
+/// needs to modify it. Copying the handle is cheap, and the value itself only
+/// gets copied the first time mutate() is called on a handle that is still
+/// shared with another node.
+///
+/// Nodes get copied for every expansion, so the handles are counted with an
+/// intrusive reference count. Values that are made inside a
+/// SingleThreadedScope never need atomic instructions to be shared.
+template<typename T>
+class CopyOnWrite
+{
+public:
+
+  CopyOnWrite()
+  : _block(new Block())
+  {
+    // Do nothing
+  }
+
+  CopyOnWrite(T value)
+  : _block(new Block(std::move(value)))
+  {
+    // Do nothing
+  }
+
+  CopyOnWrite(const CopyOnWrite& other)
+  : _block(other._block)
+  {
+    _block->acquire();
+  }
+
+  CopyOnWrite(CopyOnWrite&& other) noexcept
+  : _block(other._block)
+  {
+    other._block = nullptr;
+  }
+
+  CopyOnWrite& operator=(CopyOnWrite other) noexcept
+  {
+    std::swap(_block, other._block);
+    return *this;
+  }
+
+  ~CopyOnWrite()
+  {
+    if (_block)
+      _block->release();
+  }
+
+  const T& operator*() const
+  {
+    return _block->value;
+  }
+
+  const T* operator->() const
+  {
+    return &_block->value;
+  }
+
+  /// Get a mutable reference to the value, copying it first if it is
+  /// currently shared with any other handle.
+  T& mutate()
+  {
+    if (_block->shared())
+    {
+      Block* copy = new Block(_block->value);
+      _block->release();
+      _block = copy;
+    }
+
+    return _block->value;
+  }
+
+private:
+
+  struct Block
+  {
+    template<typename... Args>
+    explicit Block(Args&&... args)
+    : value(std::forward<Args>(args)...)
+    {
+      // Do nothing
+    }
+
+    void acquire()
+    {
+      if (concurrent)
+        count.fetch_add(1, std::memory_order_relaxed);
+      else
+        count.store(count.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+      if (concurrent)
+      {
+        if (count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          delete this;
+
+        return;
+      }
+
+      const std::size_t remaining = count.load(std::memory_order_relaxed) - 1;
+      if (remaining == 0)
+        delete this;
+      else
+        count.store(remaining, std::memory_order_relaxed);
+    }
+
+    bool shared() const
+    {
+      return count.load(
+        concurrent ? std::memory_order_acquire : std::memory_order_relaxed) > 1;
+    }
+
+    std::atomic_size_t count = 1;
+    const bool concurrent = !SingleThreadedScope::active();
+    T value;
+  };
+
+  Block* _block;
+};
+
+// ============================================================================
+/// A 128-bit Zobrist-style fingerprint of the assignments in a Node. Each
+/// assignment contributes a pseudo-random key that depends on its agent, its
+/// position in that agent's sequence and its internal ID. Keys are combined
+/// with XOR, so the fingerprint is updated in constant time whenever an
+/// assignment is added or removed.
+struct AssignmentFingerprint
+{
+  std::uint64_t high = 0;
+  std::uint64_t low = 0;
+
+  void toggle(
+    std::size_t agent,
+    std::size_t position,
+    std::size_t internal_id)
+  {
+    high ^= key(0x9e3779b97f4a7c15ull, agent, position, internal_id);
+    low ^= key(0xc2b2ae3d27d4eb4full, agent, position, internal_id);
+  }
+
+  bool operator==(const AssignmentFingerprint& other) const
+  {
+    return high == other.high && low == other.low;
+  }
+
+private:
+
+  // The splitmix64 finalizer
+  static std::uint64_t mix(std::uint64_t x)
+  {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+  }
+
+  static std::uint64_t key(
+    std::uint64_t seed,
+    std::size_t agent,
+    std::size_t position,
+    std::size_t internal_id)
+  {
+    return mix(mix(mix(seed ^ agent) ^ position) ^ internal_id);
+  }
+};
+
 // ============================================================================
 struct Invariant
 {
   std::size_t task_id;
-  double earliest_start_time;
-  double earliest_finish_time;
+  Ticks earliest_start_time;
+  Ticks earliest_finish_time;
 };
 
 // ============================================================================
+// Ties are broken by task_id so that every invariant has a unique position in
+// the ordering and can be found by value in logarithmic time.
 struct InvariantLess
 {
   bool operator()(const Invariant& a, const Invariant& b) const
   {
-    return a.earliest_finish_time < b.earliest_finish_time;
+    if (a.earliest_finish_time != b.earliest_finish_time)
+      return a.earliest_finish_time < b.earliest_finish_time;
+
+    return a.task_id < b.task_id;
+  }
+};
+
+// ============================================================================
+/// Counters that every part of a plan() call adds to, possibly from several
+/// threads at once
+struct PlanCounters
+{
+  std::atomic_size_t nodes_expanded = 0;
+  std::atomic_size_t nodes_generated = 0;
+  std::atomic_size_t filter_rejections = 0;
+  std::atomic_size_t peak_open_nodes = 0;
+  std::atomic_size_t segments = 0;
+  std::atomic_size_t deferred_segments = 0;
+  std::atomic_size_t estimate_finish_calls = 0;
+  std::atomic_size_t grouped_requests = 0;
+  std::atomic_size_t carried_candidates = 0;
+  std::atomic<rmf_traffic::Duration::rep> initialization_time = 0;
+  std::atomic<rmf_traffic::Duration::rep> search_time = 0;
+  std::atomic<rmf_traffic::Duration::rep> finishing_time = 0;
+
+  // Bytes allocated for search nodes and for candidate tables, and the most
+  // bytes that any filter or open list held
+  std::atomic_size_t node_bytes = 0;
+  std::atomic_size_t candidate_bytes = 0;
+  std::atomic_size_t peak_filter_bytes = 0;
+  std::atomic_size_t peak_open_list_bytes = 0;
+
+  static void update_peak(std::atomic_size_t& peak, std::size_t value)
+  {
+    std::size_t current = peak;
+    while (current < value && !peak.compare_exchange_weak(current, value))
+    {
+      // Try again
+    }
+  }
+
+  void update_peak_open_nodes(std::size_t size)
+  {
+    update_peak(peak_open_nodes, size);
+  }
+};
+
+// ============================================================================
+/// Adds the time that passes during its lifetime to one of the PlanCounters
+class ScopedTimer
+{
+public:
+
+  ScopedTimer(std::atomic<rmf_traffic::Duration::rep>& total)
+  : _total(total),
+    _start(std::chrono::steady_clock::now())
+  {
+    // Do nothing
+  }
+
+  ~ScopedTimer()
+  {
+    _total += std::chrono::duration_cast<rmf_traffic::Duration>(
+      std::chrono::steady_clock::now() - _start).count();
   }
+
+private:
+  std::atomic<rmf_traffic::Duration::rep>& _total;
+  std::chrono::steady_clock::time_point _start;
+};
+
+// ============================================================================
+/// The finish of a task as estimated by the planner. Unlike an Estimate, its
+/// finish state can be moved out instead of copied.
+struct EstimatedFinish
+{
+  State finish_state;
+  rmf_traffic::Time wait_until;
+};
+
+// ============================================================================
+/// Estimates the finish of task models that start from the same state. The
+/// basic components of the state are copied out once, and every model that
+/// uses planning states is estimated without allocating anything apart from
+/// its finish state.
+class FinishEstimator
+{
+public:
+
+  FinishEstimator(
+    const State& initial_state,
+    const Constraints& constraints,
+    const TravelEstimator& travel_estimator);
+
+  std::optional<EstimatedFinish> operator()(const Task::Model& model) const;
+
+  /// Estimate the finish of a model for each of several initial states
+  static std::vector<std::optional<EstimatedFinish>> batch(
+    const Task::Model& model,
+    const std::vector<State>& initial_states,
+    const Constraints& constraints,
+    const TravelEstimator& travel_estimator);
+
+private:
+  const State& _initial_state;
+  std::optional<PlanningState> _planning_state;
+  const Constraints& _constraints;
+  const TravelEstimator& _travel_estimator;
 };
 
 // ============================================================================
@@ -50,60 +485,280 @@ class Candidates
 {
 public:
 
+  // The state that an agent is in before it begins a task. Every entry that
+  // is updated by the same expansion begins from the same state, so they all
+  // share one copy of it.
+  using ConstStatePtr = std::shared_ptr<const State>;
+
   struct Entry
   {
     std::size_t candidate;
     State state;
     rmf_traffic::Time wait_until;
-    State previous_state;
+    ConstStatePtr previous_state;
     bool require_charge_battery = false;
   };
 
-  // Map finish time to Entry
-  using Map = std::multimap<rmf_traffic::Time, Entry>;
+  // Entries are immutable once they are created, so copies of a Candidates
+  // table share them instead of copying their States.
+  using ConstEntryPtr = std::shared_ptr<const Entry>;
+
+  // Iterates over the candidates that share the best finish time, in the
+  // order of their agent index
+  class const_iterator
+  {
+  public:
+
+    const Entry& operator*() const
+    {
+      return *_table->_entries[_index];
+    }
+
+    const Entry* operator->() const
+    {
+      return _table->_entries[_index].get();
+    }
+
+    const_iterator& operator++()
+    {
+      _index = _table->_next_best(_index + 1);
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      return _index == other._index && _table == other._table;
+    }
+
+    bool operator!=(const const_iterator& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    friend class Candidates;
+
+    const_iterator(const Candidates* table, std::size_t index)
+    : _table(table),
+      _index(index)
+    {
+      // Do nothing
+    }
+
+    const Candidates* _table;
+    std::size_t _index;
+  };
 
   // We may have more than one best candidate so we store their iterators in
   // a Range
   struct Range
   {
-    Map::const_iterator begin;
-    Map::const_iterator end;
+    const_iterator begin;
+    const_iterator end;
   };
 
+  /// Make the table of a task. The entries begin from the shared initial
+  /// states if they are given, which must match the initial states, or from
+  /// copies of the initial states otherwise.
   static std::shared_ptr<Candidates> make(
-    const rmf_traffic::Time start_time,
     const std::vector<State>& initial_states,
     const Constraints& constraints,
-    const Parameters& parameters,
     const Task::Model& task_model,
+    const Task::Model& charging_model,
     const TravelEstimator& travel_estimator,
-    const std::string& planner_id,
-    TaskPlanner::TaskPlannerError& error);
+    std::optional<TaskPlanner::TaskPlannerError>& error,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+    PlanCounters* counters = nullptr,
+    const std::vector<ConstStatePtr>* shared_initial_states = nullptr);
 
-  Candidates(const Candidates& other);
-  Candidates& operator=(const Candidates& other);
-  Candidates(Candidates&&) = default;
-  Candidates& operator=(Candidates&&) = default;
+  /// Make the table of a task for the next planning segment from the table
+  /// that the task had at the end of the previous segment. The entries of the
+  /// agents that were not assigned anything in that segment still begin from
+  /// the same states, so they are kept as they are, and only the agents that
+  /// changed are estimated again from their new initial states.
+  static std::shared_ptr<Candidates> carry(
+    const Candidates& previous,
+    const std::vector<bool>& changed,
+    const std::vector<State>& initial_states,
+    const Constraints& constraints,
+    const Task::Model& task_model,
+    const Task::Model& charging_model,
+    const TravelEstimator& travel_estimator,
+    std::optional<TaskPlanner::TaskPlannerError>& error,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+    PlanCounters* counters = nullptr,
+    const std::vector<ConstStatePtr>* shared_initial_states = nullptr);
 
   Range best_candidates() const;
 
+  /// Find the entry for an agent, or nullptr if that agent is unable to do
+  /// the task
+  const Entry* find(std::size_t candidate) const;
+
   rmf_traffic::Time best_finish_time() const;
 
+  /// The earliest wait_until among the best candidates
+  rmf_traffic::Time earliest_best_wait_until() const;
+
+  /// The total delay, in seconds, of the 2nd through k-th best candidates
+  /// relative to the best one. This is infinite if fewer than k agents are
+  /// able to do the task.
+  double regret(std::size_t k) const;
+
   void update_candidate(
     std::size_t candidate,
     State state,
     rmf_traffic::Time wait_until,
-    State previous_state,
+    ConstStatePtr previous_state,
     bool require_charge_battery);
 
+  /// Estimate again every candidate that would begin the task before the
+  /// release time, this time waiting until the release time before beginning.
+  /// Candidates that become unable to do the task are removed.
+  ///
+  /// \return false if no candidate is able to do the task anymore
+  bool delay(
+    rmf_traffic::Time release_time,
+    const Constraints& constraints,
+    const Task::Model& task_model,
+    const Task::Model& charging_model,
+    const TravelEstimator& travel_estimator,
+    PlanCounters* counters = nullptr);
+
 private:
-  Map _value_map;
-  std::vector<Map::iterator> _candidate_map;
+  using FinishTimes =
+    std::vector<rmf_traffic::Time, PlanAllocator<rmf_traffic::Time>>;
+  using Entries = std::vector<ConstEntryPtr, PlanAllocator<ConstEntryPtr>>;
+
+  // The table is stored as parallel arrays indexed by agent. Agents that are
+  // unable to do the task have a null entry and a finish time of Time::max(),
+  // so the best finish time is a plain scan over a contiguous array, and
+  // copying the table only copies the two arrays.
+  FinishTimes _finish_times;
+  Entries _entries;
+  rmf_traffic::Time _best_finish_time;
+  rmf_traffic::Time _earliest_best_wait_until;
+
+  Candidates(FinishTimes finish_times, Entries entries);
+
+  // Estimate the entries of the agents that are not kept from a previous
+  // table. Every agent is estimated when there is no previous table.
+  static std::shared_ptr<Candidates> _make(
+    const Candidates* previous,
+    const std::vector<bool>* changed,
+    const std::vector<State>& initial_states,
+    const Constraints& constraints,
+    const Task::Model& task_model,
+    const Task::Model& charging_model,
+    const TravelEstimator& travel_estimator,
+    std::optional<TaskPlanner::TaskPlannerError>& error,
+    std::pmr::memory_resource* memory,
+    PlanCounters* counters,
+    const std::vector<ConstStatePtr>* shared_initial_states);
+
+  void _update_best();
+
+  std::size_t _next_best(std::size_t index) const;
+};
+
+// ============================================================================
+/// Keeps the models of descriptions that provide a model_hash() across plan()
+/// calls, so that equivalent requests share one model and the travel behind
+/// its invariants. Models are keyed by the type and hash of their description,
+/// and the least recently used ones are dropped once the cache is over its
+/// capacity. It is safe to use from several threads at once.
+class SharedModelCache
+{
+public:
+
+  SharedModelCache(std::size_t capacity);
+
+  /// Get a model of an equivalent description with the given earliest start
+  /// time, or nullptr if there is none. Counts a hit or a miss for
+  /// descriptions that can be cached.
+  Task::ConstModelPtr get(
+    const Task::Description& description,
+    rmf_traffic::Time earliest_start_time);
+
+  /// Keep the model of a description, if the description can be cached
+  void insert(const Task::Description& description, Task::ConstModelPtr model);
+
+  std::size_t hits() const;
+
+  std::size_t misses() const;
+
+private:
+
+  using Key = std::pair<std::type_index, std::size_t>;
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return key.first.hash_code() ^ (key.second * 0x9e3779b97f4a7c15ull);
+    }
+  };
+
+  struct Entry
+  {
+    Task::ConstModelPtr model;
+    std::list<Key>::iterator recent;
+  };
+
+  std::size_t _capacity;
+  std::atomic_size_t _hits = 0;
+  std::atomic_size_t _misses = 0;
+
+  std::mutex _mutex;
+  std::list<Key> _recent;
+  std::unordered_map<Key, Entry, KeyHash> _models;
+};
+
+// ============================================================================
+/// Keeps the task model of each request for the duration of a plan() call, so
+/// that the segments of a plan do not construct the same models again. It is
+/// safe to use from several threads at once.
+class ModelCache
+{
+public:
+
+  /// Models that are not cached yet are looked up in the shared cache, if
+  /// one is given, and then among the models of equivalent requests of the
+  /// same call before they are constructed
+  ModelCache(std::shared_ptr<SharedModelCache> shared = nullptr);
+
+  /// Get the model of a request, constructing it if it is not cached yet
+  Task::ConstModelPtr get(
+    const ConstRequestPtr& request,
+    rmf_traffic::Time earliest_start_time,
+    const Parameters& parameters,
+    const TravelEstimator& travel_estimator);
+
+private:
+
+  struct Entry
+  {
+    // Holding the request keeps its address from being reused as a key
+    ConstRequestPtr request;
+    rmf_traffic::Time earliest_start_time;
+    Task::ConstModelPtr model;
+  };
 
-  Candidates(Map candidate_values);
+  std::shared_ptr<SharedModelCache> _shared;
 
-  void update_map();
+  // The models of the equivalent requests of this call share one core, even
+  // when the shared cache is disabled
+  SharedModelCache _cores;
 
+  std::mutex _mutex;
+  std::unordered_map<const Request*, Entry> _models;
 };
 
 // ============================================================================
@@ -117,41 +772,412 @@ public:
     const Constraints& constraints,
     const Parameters& parameters,
     const ConstRequestPtr request_,
+    const Task::Model& charging_model,
     const TravelEstimator& travel_estimator,
-    const std::string& planner_id,
-    TaskPlanner::TaskPlannerError& error);
+    std::optional<TaskPlanner::TaskPlannerError>& error,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+    ModelCache* models = nullptr,
+    PlanCounters* counters = nullptr,
+    const std::vector<Candidates::ConstStatePtr>* shared_initial_states =
+    nullptr);
 
-  rmf_task::ConstRequestPtr request;
-  Task::ConstModelPtr model;
-  Candidates candidates;
+  /// Make the pending task of a request that is equivalent to the request of
+  /// another pending task, i.e. its description has the same type and
+  /// model_hash() and it has the same earliest start time. The model and the
+  /// candidates are shared with the other task instead of being estimated
+  /// again. This may only be used while the initial node is being made.
+  static std::shared_ptr<PendingTask> share(
+    const PendingTask& other,
+    ConstRequestPtr request_);
+
+  /// Make the pending task of a request that the previous planning segment
+  /// left unassigned, keeping its model and the candidates of the agents that
+  /// did not change, as described by Candidates::carry(). The dependencies
+  /// and the release time are left for the initial node to link again.
+  static std::shared_ptr<PendingTask> carry(
+    const PendingTask& previous,
+    const std::vector<bool>& changed,
+    const std::vector<rmf_task::State>& initial_states,
+    const Constraints& constraints,
+    const Task::Model& charging_model,
+    const TravelEstimator& travel_estimator,
+    std::optional<TaskPlanner::TaskPlannerError>& error,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+    PlanCounters* counters = nullptr,
+    const std::vector<Candidates::ConstStatePtr>* shared_initial_states =
+    nullptr);
+
+  /// The request of this task
+  const rmf_task::ConstRequestPtr& request() const
+  {
+    return _source->request;
+  }
+
+  /// The model of the request
+  const Task::ConstModelPtr& model() const
+  {
+    return _source->model;
+  }
+
+  /// The internal IDs of the tasks that must finish before this one begins
+  const std::vector<std::size_t>& dependencies() const
+  {
+    return _source->dependencies;
+  }
+
+  /// True if some other task depends on this one
+  bool has_dependents() const
+  {
+    return _source->has_dependents;
+  }
+
+  /// The priority level of the request, as given by BinaryPriority::level()
+  std::size_t priority_level() const
+  {
+    return _source->priority_level;
+  }
+
+  /// True if the request is a ChargeBattery request
+  bool is_charging() const
+  {
+    return _source->is_charging;
+  }
+
+  /// These may only be set while the initial node is being made
+  void dependencies(std::vector<std::size_t> ids)
+  {
+    _source.mutate().dependencies = std::move(ids);
+  }
+
+  void has_dependents(bool value)
+  {
+    _source.mutate().has_dependents = value;
+  }
+
+  CopyOnWrite<Candidates> candidates;
+
+  // The task may not begin before this time because of the tasks that it
+  // depends on
+  rmf_traffic::Time release_time = rmf_traffic::Time::min();
 
 private:
+
+  // The request and the model never change, so they are shared by one handle
+  // instead of copying both of their shared_ptrs into every node
+  struct Source
+  {
+    rmf_task::ConstRequestPtr request;
+    Task::ConstModelPtr model;
+    std::vector<std::size_t> dependencies = {};
+    bool has_dependents = false;
+    std::size_t priority_level = 0;
+    bool is_charging = false;
+  };
+
   PendingTask(
     ConstRequestPtr request_,
     Task::ConstModelPtr model_,
     Candidates candidates_);
+
+  // Make the source of a request, working out everything that is only read
+  // from its booking and description once
+  static Source _make_source(
+    ConstRequestPtr request_,
+    Task::ConstModelPtr model_);
+
+  CopyOnWrite<Source> _source;
+};
+
+// ============================================================================
+/// The pending tasks of a node, indexed by their internal ID. Internal IDs are
+/// handed out sequentially, so the tasks are stored in a dense array of slots
+/// and removing a task just empties its slot. Iteration visits the remaining
+/// tasks in order of their internal ID.
+class PendingTaskTable
+{
+public:
+
+  using value_type = std::pair<const std::size_t, PendingTask>;
+
+  template<typename Value, typename Slots>
+  class Iterator
+  {
+  public:
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PendingTaskTable::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator(Slots* slots = nullptr, std::size_t index = 0)
+    : _slots(slots),
+      _index(index)
+    {
+      _skip_empty();
+    }
+
+    // Allow an iterator to be converted into a const_iterator
+    template<typename V, typename S>
+    Iterator(const Iterator<V, S>& other)
+    : _slots(other._slots),
+      _index(other._index)
+    {
+      // Do nothing
+    }
+
+    reference operator*() const
+    {
+      return *(*_slots)[_index];
+    }
+
+    pointer operator->() const
+    {
+      return &*(*_slots)[_index];
+    }
+
+    Iterator& operator++()
+    {
+      ++_index;
+      _skip_empty();
+      return *this;
+    }
+
+    Iterator operator++(int)
+    {
+      auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return _index == other._index;
+    }
+
+    bool operator!=(const Iterator& other) const
+    {
+      return _index != other._index;
+    }
+
+  private:
+    template<typename, typename> friend class Iterator;
+    friend class PendingTaskTable;
+
+    void _skip_empty()
+    {
+      if (!_slots)
+        return;
+
+      while (_index < _slots->size() && !(*_slots)[_index].has_value())
+        ++_index;
+    }
+
+    Slots* _slots;
+    std::size_t _index;
+  };
+
+  using Slot = std::optional<value_type>;
+  using Slots = std::vector<Slot, PlanAllocator<Slot>>;
+  using iterator = Iterator<value_type, Slots>;
+  using const_iterator = Iterator<const value_type, const Slots>;
+
+  PendingTaskTable(
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+  : _slots(PlanAllocator<Slot>(memory))
+  {
+    // Do nothing
+  }
+
+  iterator begin() { return iterator(&_slots, 0); }
+  iterator end() { return iterator(&_slots, _slots.size()); }
+  const_iterator begin() const { return const_iterator(&_slots, 0); }
+  const_iterator end() const { return const_iterator(&_slots, _slots.size()); }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  /// Insert a task. Returns false if a task with the same ID is already
+  /// present.
+  bool insert(value_type value)
+  {
+    const std::size_t id = value.first;
+    if (_slots.size() <= id)
+      _slots.resize(id + 1);
+
+    auto& slot = _slots[id];
+    if (slot.has_value())
+      return false;
+
+    slot.emplace(std::move(value));
+    ++_size;
+    return true;
+  }
+
+  iterator find(std::size_t id)
+  {
+    if (id >= _slots.size() || !_slots[id].has_value())
+      return end();
+
+    return iterator(&_slots, id);
+  }
+
+  const_iterator find(std::size_t id) const
+  {
+    if (id >= _slots.size() || !_slots[id].has_value())
+      return end();
+
+    return const_iterator(&_slots, id);
+  }
+
+  void erase(const_iterator it)
+  {
+    assert(it._index < _slots.size() && _slots[it._index].has_value());
+    _slots[it._index].reset();
+    --_size;
+  }
+
+  void erase(std::size_t id)
+  {
+    const auto it = find(id);
+    if (it != end())
+      erase(it);
+  }
+
+private:
+  Slots _slots;
+  std::size_t _size = 0;
 };
 
 // ============================================================================
 struct Node
 {
+  Node(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+  : unassigned_tasks(memory)
+  {
+    // Do nothing
+  }
+
   struct AssignmentWrapper
   {
     std::size_t internal_id;
     TaskPlanner::Assignment assignment;
+    // Set for charging assignments, whether the planner created them or they
+    // were requested, so that the search does not need to inspect the request
+    // description
+    bool is_charging = false;
+    // The accumulated cost that this assignment contributes to the node
+    double cost = 0.0;
+    // The priority level of the request, copied from its PendingTask so that
+    // checking the order of priorities only compares integers
+    std::size_t priority_level = 0;
+
+    // True for the charging tasks that the planner added by itself, which
+    // have no pending task to go back to. They all get the internal ID that
+    // get_available_internal_id(true) reserves for them.
+    bool generated() const
+    {
+      return internal_id == 0;
+    }
+  };
+
+  // A summary of the priorities of the tasks assigned to one agent. Charging
+  // tasks are not counted.
+  struct AgentPriorities
+  {
+    // The number of tasks above priority level 0
+    std::size_t prioritized = 0;
+    // The lowest priority level of the tasks so far
+    std::size_t lowest_level = std::numeric_limits<std::size_t>::max();
+    // True if a task comes after a task of a lower priority level
+    bool inverted = false;
   };
 
-  using AssignedTasks = std::vector<std::vector<AssignmentWrapper>>;
-  using UnassignedTasks =
-    std::unordered_map<std::size_t, PendingTask>;
-  using InvariantSet = std::multiset<Invariant, InvariantLess>;
+  // Each agent's assignments and each pending task are held by CopyOnWrite
+  // handles so that a child node only copies the parts that its expansion
+  // actually modifies. Everything else is shared with the parent node.
+  using AgentAssignments = std::vector<AssignmentWrapper>;
+  using AssignedTasks = std::vector<CopyOnWrite<AgentAssignments>>;
+  using UnassignedTasks = PendingTaskTable;
+  using InvariantSet = std::set<Invariant, InvariantLess>;
 
   AssignedTasks assigned_tasks;
   UnassignedTasks unassigned_tasks;
   double cost_estimate;
+  // The portion of cost_estimate that comes from the heuristic
+  double heuristic_cost = 0.0;
   rmf_traffic::Time latest_time;
-  InvariantSet unassigned_invariants;
+  CopyOnWrite<InvariantSet> unassigned_invariants;
   std::size_t next_available_internal_id = 1;
+  AssignmentFingerprint fingerprint;
+
+  // The sum of the costs of every assignment in the node
+  double accumulated_cost = 0.0;
+
+  // The latest finish time of the last assignment of any agent, or Time::min()
+  // if no agent has an assignment yet
+  rmf_traffic::Time latest_finish_time = rmf_traffic::Time::min();
+
+  // The earliest wait_until among the best candidates of every unassigned task
+  // that is not blocked, or Time::max() if there are no such tasks. This must
+  // be refreshed with update_earliest_wait_until() after the candidates of the
+  // unassigned tasks change.
+  rmf_traffic::Time earliest_wait_until = rmf_traffic::Time::max();
+
+  // Per-agent priority summaries along with how many agents fall into each of
+  // the categories that matter for a valid priority ordering
+  std::vector<AgentPriorities> agent_priorities;
+  std::size_t agents_with_priority = 0;
+  std::size_t agents_with_multiple_priorities = 0;
+  std::size_t agents_with_inversion = 0;
+
+  // The charger that each agent holds, which is the dedicated charger of its
+  // latest state. This is only tracked when the planner has a charger pool,
+  // and is empty otherwise. The chargers of the initial states are kept for
+  // when every assignment of an agent gets popped.
+  std::vector<std::size_t> chargers;
+  std::shared_ptr<const std::vector<std::size_t>> initial_chargers;
+
+  /// True if an agent other than this one holds the charger
+  bool charger_held(const std::size_t charger, const std::size_t agent) const
+  {
+    for (std::size_t a = 0; a < chargers.size(); ++a)
+    {
+      if (a != agent && chargers[a] == charger)
+        return true;
+    }
+
+    return false;
+  }
+
+  // Assignments should only be added or removed through these functions so
+  // that the fingerprint, accumulated cost, latest finish time, priority
+  // summaries and chargers stay up to date
+  void push_assignment(std::size_t agent, AssignmentWrapper assignment);
+
+  void pop_assignment(std::size_t agent);
+
+  /// True if no agent has a task after a task of a lower priority level, and
+  /// no agent is left without a prioritized task while another agent has more
+  /// than one
+  bool valid_priority_order() const
+  {
+    if (agents_with_inversion > 0)
+      return false;
+
+    if (agents_with_multiple_priorities > 0
+      && agents_with_priority < assigned_tasks.size())
+      return false;
+
+    return true;
+  }
 
   // ID 0 is reserved for charging tasks
   std::size_t get_available_internal_id(bool charging_task = false)
@@ -159,46 +1185,82 @@ struct Node
     return charging_task ? 0 : next_available_internal_id++;
   }
 
+  static Invariant make_invariant(
+    std::size_t task_id,
+    const PendingTask& pending)
+  {
+    const Ticks earliest_start_time =
+      to_ticks(pending.request()->booking()->earliest_start_time());
+    const Ticks earliest_finish_time = earliest_start_time
+      + to_ticks(pending.model()->invariant_duration());
+
+    return Invariant{
+      task_id,
+      earliest_start_time,
+      earliest_finish_time
+    };
+  }
+
   void sort_invariants()
   {
-    unassigned_invariants.clear();
+    auto& invariants = unassigned_invariants.mutate();
+    invariants.clear();
     for (const auto& u : unassigned_tasks)
-    {
-      double earliest_start_time = rmf_traffic::time::to_seconds(
-        u.second.request->booking()->earliest_start_time().time_since_epoch());
-      const auto invariant_duration =
-        u.second.model->invariant_duration();
-      double earliest_finish_time = earliest_start_time
-        + rmf_traffic::time::to_seconds(invariant_duration);
-
-      unassigned_invariants.insert(
-        Invariant{
-          u.first,
-          earliest_start_time,
-          earliest_finish_time
-        });
-    }
+      invariants.insert(make_invariant(u.first, u.second));
   }
 
   void pop_unassigned(std::size_t task_id)
   {
-    unassigned_tasks.erase(task_id);
+    const auto it = unassigned_tasks.find(task_id);
+    assert(it != unassigned_tasks.end());
+
+    // The invariant of a task is determined entirely by its pending task, so
+    // it can be looked up directly instead of searching the whole set
+    auto& invariants = unassigned_invariants.mutate();
+    const auto invariant_it =
+      invariants.find(make_invariant(task_id, it->second));
+    assert(invariant_it != invariants.end());
+    invariants.erase(invariant_it);
+
+    unassigned_tasks.erase(it);
+  }
 
-    bool popped_invariant = false;
-    InvariantSet::iterator erase_it;
-    for (auto it = unassigned_invariants.begin();
-      it != unassigned_invariants.end(); ++it)
+  /// True if a task that this task depends on has not been assigned yet
+  bool blocked(const PendingTask& task) const
+  {
+    for (const auto id : task.dependencies())
     {
-      if (it->task_id == task_id)
-      {
-        popped_invariant = true;
-        erase_it = it;
-        break;
-      }
+      if (unassigned_tasks.find(id) != unassigned_tasks.end())
+        return true;
     }
-    unassigned_invariants.erase(erase_it);
-    assert(popped_invariant);
+
+    return false;
   }
+
+  void update_earliest_wait_until()
+  {
+    // Each table keeps its own earliest wait, so this is one read per task.
+    // Blocked tasks cannot be assigned yet, so they do not keep the planning
+    // segment open.
+    earliest_wait_until = rmf_traffic::Time::max();
+    for (const auto& u : unassigned_tasks)
+    {
+      if (blocked(u.second))
+        continue;
+
+      const auto wait_until = u.second.candidates->earliest_best_wait_until();
+      if (wait_until < earliest_wait_until)
+        earliest_wait_until = wait_until;
+    }
+  }
+
+private:
+
+  static void _add_priority(
+    AgentPriorities& summary,
+    const AssignmentWrapper& assignment);
+
+  void _set_priorities(std::size_t agent, AgentPriorities summary);
 };
 
 using NodePtr = std::shared_ptr<Node>;
@@ -207,9 +1269,17 @@ using ConstNodePtr = std::shared_ptr<const Node>;
 // ============================================================================
 struct LowestCostEstimate
 {
-  bool operator()(const ConstNodePtr& a, const ConstNodePtr& b)
+  // The heuristic portion of each cost estimate is inflated by this weight
+  double weight = 1.0;
+
+  double key(const Node& n) const
+  {
+    return n.cost_estimate + (weight - 1.0) * n.heuristic_cost;
+  }
+
+  bool operator()(const ConstNodePtr& a, const ConstNodePtr& b) const
   {
-    return b->cost_estimate < a->cost_estimate;
+    return key(*b) < key(*a);
   }
 };
 
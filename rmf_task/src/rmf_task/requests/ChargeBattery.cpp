@@ -16,35 +16,14 @@
 */
 
 #include <string>
-#include <sstream>
-#include <random>
 
 #include <rmf_task/requests/ChargeBattery.hpp>
 
+#include "internal_RequestId.hpp"
+
 namespace rmf_task {
 namespace requests {
 
-//==============================================================================
-namespace {
-std::string generate_uuid(const std::size_t length = 3)
-{
-  std::stringstream ss;
-  for (std::size_t i = 0; i < length; ++i)
-  {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    const auto random_char = dis(gen);
-    std::stringstream hexstream;
-    hexstream << std::hex << random_char;
-    auto hex = hexstream.str();
-    ss << (hex.length() < 2 ? '0' + hex : hex);
-  }
-  return ss.str();
-}
-
-} // anonymous namespace
-
 //==============================================================================
 // Definition for forward declared class
 class ChargeBattery::Model : public Task::Model
@@ -56,8 +35,18 @@ public:
     const Constraints& task_planning_constraints,
     const TravelEstimator& travel_estimator) const final;
 
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
   rmf_traffic::Duration invariant_duration() const final;
 
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
   Model(
     const rmf_traffic::Time earliest_start_time,
     Parameters parameters);
@@ -84,6 +73,30 @@ ChargeBattery::Model::estimate_finish(
   const State& initial_state,
   const Constraints& task_planning_constraints,
   const TravelEstimator& travel_estimator) const
+{
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool ChargeBattery::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto ChargeBattery::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
 {
   // Important to return nullopt if a charging task is not needed. In the task
   // planner, if a charging task is added, the node's latest time may be set to
@@ -92,33 +105,25 @@ ChargeBattery::Model::estimate_finish(
   // infinite loop as a new identical charging task is added in each call to
   // `solve` before returning.
   const auto recharge_soc = task_planning_constraints.recharge_soc();
-  if (initial_state.battery_soc() >= recharge_soc - 1e-3
-    && initial_state.waypoint().value()
-    == initial_state.dedicated_charging_waypoint().value())
+  if (initial_state.battery_soc >= recharge_soc - 1e-3
+    && initial_state.waypoint == initial_state.dedicated_charging_waypoint)
   {
     return std::nullopt;
   }
 
   // Compute time taken to reach charging waypoint from current location
-  rmf_traffic::agv::Plan::Start final_plan_start{
-    initial_state.time().value(),
-    initial_state.dedicated_charging_waypoint().value(),
-    initial_state.orientation().value()};
-
-  auto state = State().load_basic(
-    std::move(final_plan_start),
-    initial_state.dedicated_charging_waypoint().value(),
-    initial_state.battery_soc().value());
+  PlanningState state = initial_state;
+  state.waypoint = initial_state.dedicated_charging_waypoint;
 
-  double battery_soc = initial_state.battery_soc().value();
+  double battery_soc = initial_state.battery_soc;
   rmf_traffic::Duration variant_duration(0);
 
-  if (initial_state.waypoint() != initial_state.dedicated_charging_waypoint())
+  if (initial_state.waypoint != initial_state.dedicated_charging_waypoint)
   {
     const auto travel = travel_estimator.estimate(
-      initial_state.extract_plan_start().value(),
+      initial_state.plan_start(),
       rmf_traffic::agv::Plan::Goal(
-        initial_state.dedicated_charging_waypoint().value()));
+        initial_state.dedicated_charging_waypoint));
 
     if (!travel.has_value())
       return std::nullopt;
@@ -144,14 +149,13 @@ ChargeBattery::Model::estimate_finish(
     (3600 * delta_soc * _parameters.battery_system().capacity()) /
     _parameters.battery_system().charging_current();
 
-  const rmf_traffic::Time wait_until = initial_state.time().value();
-  state.time(
-    wait_until + variant_duration +
-    rmf_traffic::time::from_seconds(time_to_charge));
+  const rmf_traffic::Time wait_until = initial_state.time;
+  state.time = wait_until + variant_duration
+    + rmf_traffic::time::from_seconds(time_to_charge);
 
-  state.battery_soc(recharge_soc);
+  state.battery_soc = recharge_soc;
 
-  return Estimate(state, wait_until);
+  return PlanningEstimate{state, wait_until};
 }
 
 //==============================================================================
@@ -160,6 +164,15 @@ rmf_traffic::Duration ChargeBattery::Model::invariant_duration() const
   return _invariant_duration;
 }
 
+//==============================================================================
+Task::ConstModelPtr ChargeBattery::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  auto model = std::make_shared<ChargeBattery::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
+}
+
 //==============================================================================
 class ChargeBattery::Description::Implementation
 {
@@ -201,6 +214,15 @@ Task::ConstModelPtr ChargeBattery::Description::make_model(
     parameters);
 }
 
+//==============================================================================
+std::optional<std::size_t> ChargeBattery::Description::model_hash() const
+{
+  // The models only depend on the parameters of the robot and on the state
+  // that they start from, so every charging task can share one. Whether the
+  // task is indefinite does not change its estimate.
+  return 0;
+}
+
 //==============================================================================
 auto ChargeBattery::Description::generate_info(
   const State&,
@@ -230,7 +252,7 @@ ConstRequestPtr ChargeBattery::make(
   ConstPriorityPtr priority,
   bool automatic)
 {
-  const std::string id = "Charge" + generate_uuid();
+  const std::string id = generate_request_id("Charge");
   Task::ConstBookingPtr booking =
     std::make_shared<const rmf_task::Task::Booking>(
     std::move(id),
@@ -251,7 +273,7 @@ ConstRequestPtr ChargeBattery::make(
   ConstPriorityPtr priority,
   bool automatic)
 {
-  const std::string id = "Charge" + generate_uuid();
+  const std::string id = generate_request_id("Charge");
   Task::ConstBookingPtr booking =
     std::make_shared<const rmf_task::Task::Booking>(
     std::move(id),
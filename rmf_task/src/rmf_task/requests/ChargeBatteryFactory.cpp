@@ -17,32 +17,12 @@
 
 #include <rmf_task/requests/ChargeBatteryFactory.hpp>
 #include <rmf_task/requests/ChargeBattery.hpp>
-#include <random>
+
+#include "internal_RequestId.hpp"
 
 namespace rmf_task {
 namespace requests {
 
-//==============================================================================
-namespace {
-std::string generate_uuid(const std::size_t length = 3)
-{
-  std::stringstream ss;
-  for (std::size_t i = 0; i < length; ++i)
-  {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    const auto random_char = dis(gen);
-    std::stringstream hexstream;
-    hexstream << std::hex << random_char;
-    auto hex = hexstream.str();
-    ss << (hex.length() < 2 ? '0' + hex : hex);
-  }
-  return ss.str();
-}
-
-} // anonymous namespace
-
 //==============================================================================
 class ChargeBatteryFactory::Implementation
 {
@@ -85,7 +65,7 @@ bool ChargeBatteryFactory::indefinite() const
 //==============================================================================
 ConstRequestPtr ChargeBatteryFactory::make_request(const State& state) const
 {
-  const std::string id = "Charge" + generate_uuid();
+  const std::string id = generate_request_id("Charge");
   Task::ConstBookingPtr booking;
   if (_pimpl->requester.has_value() && _pimpl->time_now_cb)
   {
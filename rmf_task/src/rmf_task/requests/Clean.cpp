@@ -19,6 +19,10 @@
 
 #include <rmf_task/requests/Clean.hpp>
 
+#include "../DrainMemo.hpp"
+#include "../Hasher.hpp"
+#include "internal_Invariant.hpp"
+
 namespace rmf_task {
 namespace requests {
 
@@ -32,12 +36,23 @@ public:
     const Constraints& task_planning_constraints,
     const TravelEstimator& estimate_cache) const final;
 
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
   rmf_traffic::Duration invariant_duration() const final;
 
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
   Model(
     const rmf_traffic::Time earliest_start_time,
     const Parameters& parameters,
     const rmf_traffic::Trajectory& cleaning_path,
+    uint64_t cleaning_shape,
     std::size_t start_waypoint,
     std::size_t end_waypoint);
 
@@ -47,8 +62,8 @@ private:
   std::size_t _start_waypoint;
   std::size_t _end_waypoint;
 
-  rmf_traffic::Duration _invariant_duration;
-  double _invariant_battery_drain;
+  // Shared by every cleaning of the same path
+  std::shared_ptr<Invariant> _invariant;
 };
 
 //==============================================================================
@@ -56,31 +71,45 @@ Clean::Model::Model(
   const rmf_traffic::Time earliest_start_time,
   const Parameters& parameters,
   const rmf_traffic::Trajectory& cleaning_path,
+  const uint64_t cleaning_shape,
   std::size_t start_waypoint,
   std::size_t end_waypoint)
 : _earliest_start_time(earliest_start_time),
   _parameters(parameters),
   _start_waypoint(start_waypoint),
-  _end_waypoint(end_waypoint)
+  _end_waypoint(end_waypoint),
+  _invariant(shared_invariant(_parameters, cleaning_shape))
 {
-  // Calculate duration of invariant component of task
-  const auto& cleaning_start_time = cleaning_path.begin()->time();
-  const auto& cleaning_finish_time = *cleaning_path.finish_time();
-
-  _invariant_duration =
-    cleaning_finish_time - cleaning_start_time;
-
-  // Compute battery drain over invariant path
-  const double dSOC_motion =
-    _parameters.motion_sink()->compute_change_in_charge(cleaning_path);
-  const double dSOC_ambient =
-    _parameters.ambient_sink()->compute_change_in_charge(
-    rmf_traffic::time::to_seconds(_invariant_duration));
-  const double dSOC_cleaning =
-    _parameters.tool_sink()->compute_change_in_charge(
-    rmf_traffic::time::to_seconds(_invariant_duration));
-  _invariant_battery_drain = dSOC_motion + dSOC_ambient +
-    dSOC_cleaning;
+  std::call_once(_invariant->once, [&]()
+    {
+      // Calculate duration of invariant component of task
+      const auto& cleaning_start_time = cleaning_path.begin()->time();
+      const auto& cleaning_finish_time = *cleaning_path.finish_time();
+
+      _invariant->duration =
+        cleaning_finish_time - cleaning_start_time;
+
+      // Compute battery drain over invariant path
+      const double dSOC_motion =
+        DrainMemo::motion(_parameters.motion_sink(), cleaning_path);
+      const double dSOC_ambient =
+        _parameters.ambient_sink()->compute_change_in_charge(
+        rmf_traffic::time::to_seconds(_invariant->duration));
+      const double dSOC_cleaning =
+        _parameters.tool_sink()->compute_change_in_charge(
+        rmf_traffic::time::to_seconds(_invariant->duration));
+      _invariant->battery_drain = dSOC_motion + dSOC_ambient +
+        dSOC_cleaning;
+    });
+}
+
+//==============================================================================
+Task::ConstModelPtr Clean::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  auto model = std::make_shared<Clean::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
 }
 
 //==============================================================================
@@ -89,27 +118,44 @@ std::optional<rmf_task::Estimate> Clean::Model::estimate_finish(
   const Constraints& task_planning_constraints,
   const TravelEstimator& travel_estimator) const
 {
-  rmf_traffic::agv::Plan::Start final_plan_start{
-    initial_state.time().value(),
-    _end_waypoint,
-    initial_state.orientation().value()};
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
 
-  auto state = State().load_basic(
-    std::move(final_plan_start),
-    initial_state.dedicated_charging_waypoint().value(),
-    initial_state.battery_soc().value());
+//==============================================================================
+bool Clean::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto Clean::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  PlanningState state = initial_state;
+  state.waypoint = _end_waypoint;
 
   rmf_traffic::Duration variant_duration(0);
   rmf_traffic::Duration end_duration(0);
 
-  double battery_soc = initial_state.battery_soc().value();
+  double battery_soc = initial_state.battery_soc;
   const bool drain_battery = task_planning_constraints.drain_battery();
   const auto& ambient_sink = *_parameters.ambient_sink();
 
-  if (initial_state.waypoint() != _start_waypoint)
+  if (initial_state.waypoint != _start_waypoint)
   {
     const auto travel = travel_estimator.estimate(
-      initial_state.extract_plan_start().value(),
+      initial_state.plan_start(),
       _start_waypoint);
 
     if (!travel.has_value())
@@ -132,17 +178,14 @@ std::optional<rmf_task::Estimate> Clean::Model::estimate_finish(
 
   const rmf_traffic::Time ideal_start = _earliest_start_time - variant_duration;
   const rmf_traffic::Time wait_until =
-    initial_state.time().value() > ideal_start ?
-    initial_state.time().value() : ideal_start;
+    initial_state.time > ideal_start ? initial_state.time : ideal_start;
 
   // Factor in battery drain while waiting to move to start waypoint. If a robot
   // is initially at a charging waypoint, it is assumed to be continually charging
-  if (drain_battery && wait_until > initial_state.time().value() &&
-    initial_state.waypoint()
-    != initial_state.dedicated_charging_waypoint().value())
+  if (drain_battery && wait_until > initial_state.time &&
+    initial_state.waypoint != initial_state.dedicated_charging_waypoint)
   {
-    rmf_traffic::Duration wait_duration(
-      wait_until - initial_state.time().value());
+    rmf_traffic::Duration wait_duration(wait_until - initial_state.time);
     const double dSOC_ambient = ambient_sink.compute_change_in_charge(
       rmf_traffic::time::to_seconds(wait_duration));
     battery_soc = battery_soc - dSOC_ambient;
@@ -154,21 +197,21 @@ std::optional<rmf_task::Estimate> Clean::Model::estimate_finish(
   }
 
   // Factor in invariants
-  state.time(
-    wait_until + variant_duration + _invariant_duration + end_duration);
+  state.time =
+    wait_until + variant_duration + _invariant->duration + end_duration;
 
   if (drain_battery)
   {
-    battery_soc -= _invariant_battery_drain;
+    battery_soc -= _invariant->battery_drain;
     if (battery_soc <= task_planning_constraints.threshold_soc())
       return std::nullopt;
 
     // Check if the robot has enough charge to head back to nearest charger
-    if (_end_waypoint != state.dedicated_charging_waypoint().value())
+    if (_end_waypoint != state.dedicated_charging_waypoint)
     {
       const auto travel = travel_estimator.estimate(
-        state.extract_plan_start().value(),
-        state.dedicated_charging_waypoint().value());
+        state.plan_start(),
+        state.dedicated_charging_waypoint);
 
       if (!travel.has_value())
         return std::nullopt;
@@ -179,16 +222,16 @@ std::optional<rmf_task::Estimate> Clean::Model::estimate_finish(
         return std::nullopt;
     }
 
-    state.battery_soc(battery_soc);
+    state.battery_soc = battery_soc;
   }
 
-  return Estimate(state, wait_until);
+  return PlanningEstimate{state, wait_until};
 }
 
 //==============================================================================
 rmf_traffic::Duration Clean::Model::invariant_duration() const
 {
-  return _invariant_duration;
+  return _invariant->duration;
 }
 
 //==============================================================================
@@ -238,14 +281,39 @@ Task::ConstModelPtr Clean::Description::make_model(
     // *INDENT-ON*
   }
 
+  Hasher shape;
+  shape << std::string("Clean") << static_cast<uint64_t>(*model_hash());
+
   return std::make_shared<Clean::Model>(
     earliest_start_time,
     parameters,
     _pimpl->cleaning_path,
+    shape.value(),
     _pimpl->start_waypoint,
     _pimpl->end_waypoint);
 }
 
+//==============================================================================
+std::optional<std::size_t> Clean::Description::model_hash() const
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(_pimpl->start_waypoint)
+       << static_cast<uint64_t>(_pimpl->end_waypoint)
+       << static_cast<uint64_t>(_pimpl->cleaning_path.size());
+
+  // Only the timing of the cleaning path relative to its start matters
+  const auto& path = _pimpl->cleaning_path;
+  for (auto it = path.begin(); it != path.end(); ++it)
+  {
+    const Eigen::Vector3d p = it->position();
+    const Eigen::Vector3d v = it->velocity();
+    hash << static_cast<uint64_t>((it->time() - path.begin()->time()).count())
+         << p[0] << p[1] << p[2] << v[0] << v[1] << v[2];
+  }
+
+  return static_cast<std::size_t>(hash.value());
+}
+
 //==============================================================================
 auto Clean::Description::generate_info(
   const State&,
@@ -271,6 +339,12 @@ std::size_t Clean::Description::end_waypoint() const
   return _pimpl->end_waypoint;
 }
 
+//==============================================================================
+const rmf_traffic::Trajectory& Clean::Description::cleaning_path() const
+{
+  return _pimpl->cleaning_path;
+}
+
 //==============================================================================
 ConstRequestPtr Clean::make(
   std::size_t start_waypoint,
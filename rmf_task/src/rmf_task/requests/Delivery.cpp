@@ -16,9 +16,13 @@
 */
 
 #include <map>
+#include <mutex>
 
 #include <rmf_task/requests/Delivery.hpp>
 
+#include "../Hasher.hpp"
+#include "internal_Invariant.hpp"
+
 namespace rmf_task {
 namespace requests {
 
@@ -32,8 +36,20 @@ public:
     const Constraints& task_planning_constraints,
     const TravelEstimator& travel_estimator) const final;
 
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
   rmf_traffic::Duration invariant_duration() const final;
 
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
+  void materialize(const TravelEstimator& travel_estimator) const final;
+
   Model(
     const rmf_traffic::Time earliest_start_time,
     const Parameters& parameters,
@@ -43,13 +59,22 @@ public:
     rmf_traffic::Duration dropoff_wait);
 
 private:
+
+  // Compute the invariant duration and battery drain if that has not been
+  // done yet. If no travel estimator is given, a temporary one is used.
+  void _materialize(const TravelEstimator* travel_estimator) const;
+
   rmf_traffic::Time _earliest_start_time;
   Parameters _parameters;
   std::size_t _pickup_waypoint;
+  rmf_traffic::Duration _pickup_wait;
   std::size_t _dropoff_waypoint;
+  rmf_traffic::Duration _dropoff_wait;
 
-  rmf_traffic::Duration _invariant_duration;
-  double _invariant_battery_drain;
+  // The invariants need a plan from the pickup to the dropoff, so they are
+  // only computed once they are first used
+  // and then shared by every delivery with the same pickup and dropoff
+  std::shared_ptr<Invariant> _invariant;
 };
 
 //==============================================================================
@@ -63,44 +88,69 @@ Delivery::Model::Model(
 : _earliest_start_time(earliest_start_time),
   _parameters(parameters),
   _pickup_waypoint(pickup_waypoint),
-  _dropoff_waypoint(dropoff_waypoint)
+  _pickup_wait(pickup_wait),
+  _dropoff_waypoint(dropoff_waypoint),
+  _dropoff_wait(dropoff_wait)
 {
-  // Calculate duration of invariant component of task
-  _invariant_duration = pickup_wait + dropoff_wait;
-  _invariant_battery_drain =
-    _parameters.ambient_sink()->compute_change_in_charge(
-    rmf_traffic::time::to_seconds(pickup_wait + dropoff_wait));
+  Hasher shape;
+  shape << std::string("Delivery")
+        << static_cast<uint64_t>(_pickup_waypoint)
+        << static_cast<uint64_t>(_pickup_wait.count())
+        << static_cast<uint64_t>(_dropoff_waypoint)
+        << static_cast<uint64_t>(_dropoff_wait.count());
+  _invariant = shared_invariant(_parameters, shape.value());
+}
 
-  if (_pickup_waypoint != _dropoff_waypoint)
-  {
-    rmf_traffic::agv::Planner::Start start{
-      _earliest_start_time,
-      _pickup_waypoint,
-      0.0};
+//==============================================================================
+Task::ConstModelPtr Delivery::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  // The invariants do not depend on the start time, so the copy shares them
+  auto model = std::make_shared<Delivery::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
+}
 
-    rmf_traffic::agv::Planner::Goal goal{_dropoff_waypoint};
-    const auto result_to_dropoff = _parameters.planner()->plan(start, goal);
+//==============================================================================
+void Delivery::Model::materialize(
+  const TravelEstimator& travel_estimator) const
+{
+  _materialize(&travel_estimator);
+}
 
-    auto itinerary_start_time = _earliest_start_time;
-    for (const auto& itinerary : result_to_dropoff->get_itinerary())
+//==============================================================================
+void Delivery::Model::_materialize(
+  const TravelEstimator* travel_estimator) const
+{
+  std::call_once(_invariant->once, [&]()
     {
-      const auto& trajectory = itinerary.trajectory();
-      const auto& finish_time = *trajectory.finish_time();
-      const auto itinerary_duration = finish_time - itinerary_start_time;
-
-      // Compute the invariant battery drain
-      const double dSOC_motion =
-        _parameters.motion_sink()->compute_change_in_charge(trajectory);
-      const double dSOC_device =
+      // Calculate duration of invariant component of task
+      _invariant->duration = _pickup_wait + _dropoff_wait;
+      _invariant->battery_drain =
         _parameters.ambient_sink()->compute_change_in_charge(
-        rmf_traffic::time::to_seconds(itinerary_duration));
-      _invariant_battery_drain += dSOC_motion + dSOC_device;
-
-      _invariant_duration += itinerary_duration;
-      itinerary_start_time = finish_time;
-    }
-  }
-
+        rmf_traffic::time::to_seconds(_pickup_wait + _dropoff_wait));
+
+      if (_pickup_waypoint == _dropoff_waypoint)
+        return;
+
+      rmf_traffic::agv::Planner::Start start{
+        _earliest_start_time,
+        _pickup_waypoint,
+        0.0};
+
+      rmf_traffic::agv::Planner::Goal goal{_dropoff_waypoint};
+
+      // The estimator memoizes this leg, so deliveries that share a pickup
+      // and dropoff only plan it once
+      const auto travel = travel_estimator ?
+      travel_estimator->estimate(start, goal) :
+      TravelEstimator::shared(_parameters)->estimate(start, goal);
+      if (travel.has_value())
+      {
+        _invariant->duration += travel->duration();
+        _invariant->battery_drain += travel->change_in_charge();
+      }
+    });
 }
 
 //==============================================================================
@@ -109,28 +159,47 @@ std::optional<rmf_task::Estimate> Delivery::Model::estimate_finish(
   const Constraints& task_planning_constraints,
   const TravelEstimator& travel_estimator) const
 {
-  rmf_traffic::agv::Plan::Start final_plan_start{
-    initial_state.time().value(),
-    _dropoff_waypoint,
-    initial_state.orientation().value()};
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool Delivery::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto Delivery::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  _materialize(&travel_estimator);
 
-  auto state = State().load_basic(
-    std::move(final_plan_start),
-    initial_state.dedicated_charging_waypoint().value(),
-    initial_state.battery_soc().value());
+  PlanningState state = initial_state;
+  state.waypoint = _dropoff_waypoint;
 
   rmf_traffic::Duration variant_duration(0);
 
-  double battery_soc = initial_state.battery_soc().value();
+  double battery_soc = initial_state.battery_soc;
   const bool drain_battery = task_planning_constraints.drain_battery();
   const auto& ambient_sink = *_parameters.ambient_sink();
   const double battery_threshold = task_planning_constraints.threshold_soc();
 
   // Factor in battery drain while moving to start waypoint of task
-  if (initial_state.waypoint() != _pickup_waypoint)
+  if (initial_state.waypoint != _pickup_waypoint)
   {
     const auto travel = travel_estimator.estimate(
-      initial_state.extract_plan_start().value(),
+      initial_state.plan_start(),
       _pickup_waypoint);
 
     if (!travel)
@@ -146,16 +215,14 @@ std::optional<rmf_task::Estimate> Delivery::Model::estimate_finish(
 
   const rmf_traffic::Time ideal_start = _earliest_start_time - variant_duration;
   const rmf_traffic::Time wait_until =
-    initial_state.time().value() > ideal_start ?
-    initial_state.time().value() : ideal_start;
+    initial_state.time > ideal_start ? initial_state.time : ideal_start;
 
   // Factor in battery drain while waiting to move to start waypoint. If a robot
   // is initially at a charging waypoint, it is assumed to be continually charging
-  if (drain_battery && wait_until > initial_state.time().value() &&
-    initial_state.waypoint() != initial_state.dedicated_charging_waypoint())
+  if (drain_battery && wait_until > initial_state.time &&
+    initial_state.waypoint != initial_state.dedicated_charging_waypoint)
   {
-    const rmf_traffic::Duration wait_duration(
-      wait_until - initial_state.time().value());
+    const rmf_traffic::Duration wait_duration(wait_until - initial_state.time);
 
     const double dSOC_device = ambient_sink.compute_change_in_charge(
       rmf_traffic::time::to_seconds(wait_duration));
@@ -167,22 +234,22 @@ std::optional<rmf_task::Estimate> Delivery::Model::estimate_finish(
   }
 
   // Factor in invariants
-  state.time(wait_until + variant_duration + _invariant_duration);
+  state.time = wait_until + variant_duration + _invariant->duration;
 
   if (drain_battery)
   {
     // Calculate how much battery is drained while waiting for the pickup and
     // waiting for the dropoff
-    battery_soc -= _invariant_battery_drain;
+    battery_soc -= _invariant->battery_drain;
     if (battery_soc <= battery_threshold)
       return std::nullopt;
 
     // Check if the robot has enough charge to head back to nearest charger
-    if (_dropoff_waypoint != state.dedicated_charging_waypoint().value())
+    if (_dropoff_waypoint != state.dedicated_charging_waypoint)
     {
       const auto travel = travel_estimator.estimate(
-        state.extract_plan_start().value(),
-        state.dedicated_charging_waypoint().value());
+        state.plan_start(),
+        state.dedicated_charging_waypoint);
 
       if (!travel.has_value())
         return std::nullopt;
@@ -191,16 +258,17 @@ std::optional<rmf_task::Estimate> Delivery::Model::estimate_finish(
         return std::nullopt;
     }
 
-    state.battery_soc(battery_soc);
+    state.battery_soc = battery_soc;
   }
 
-  return Estimate(state, wait_until);
+  return PlanningEstimate{state, wait_until};
 }
 
 //==============================================================================
 rmf_traffic::Duration Delivery::Model::invariant_duration() const
 {
-  return _invariant_duration;
+  _materialize(nullptr);
+  return _invariant->duration;
 }
 
 //==============================================================================
@@ -262,6 +330,17 @@ Task::ConstModelPtr Delivery::Description::make_model(
     _pimpl->dropoff_wait);
 }
 
+//==============================================================================
+std::optional<std::size_t> Delivery::Description::model_hash() const
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(_pimpl->pickup_waypoint)
+       << static_cast<uint64_t>(_pimpl->pickup_wait.count())
+       << static_cast<uint64_t>(_pimpl->dropoff_waypoint)
+       << static_cast<uint64_t>(_pimpl->dropoff_wait.count());
+  return static_cast<std::size_t>(hash.value());
+}
+
 //==============================================================================
 auto Delivery::Description::generate_info(
   const State&,
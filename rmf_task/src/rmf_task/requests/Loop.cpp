@@ -15,8 +15,13 @@
  *
 */
 
+#include <mutex>
+
 #include <rmf_task/requests/Loop.hpp>
 
+#include "../Hasher.hpp"
+#include "internal_Invariant.hpp"
+
 namespace rmf_task {
 namespace requests {
 
@@ -30,8 +35,20 @@ public:
     const Constraints& task_planning_constraints,
     const TravelEstimator& travel_estimator) const final;
 
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
   rmf_traffic::Duration invariant_duration() const final;
 
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
+  void materialize(const TravelEstimator& travel_estimator) const final;
+
   Model(
     const rmf_traffic::Time earliest_start_time,
     const Parameters& parameters,
@@ -40,13 +57,21 @@ public:
     std::size_t num_loops);
 
 private:
+
+  // Compute the invariant duration and battery drain if that has not been
+  // done yet. If no travel estimator is given, a temporary one is used.
+  void _materialize(const TravelEstimator* travel_estimator) const;
+
   rmf_traffic::Time _earliest_start_time;
   Parameters _parameters;
   std::size_t _start_waypoint;
   std::size_t _finish_waypoint;
+  std::size_t _num_loops;
 
-  rmf_traffic::Duration _invariant_duration;
-  double _invariant_battery_drain;
+  // The invariants need a plan between the loop waypoints, so they are only
+  // computed once they are first used
+  // and then shared by every loop between the same waypoints
+  std::shared_ptr<Invariant> _invariant;
 };
 
 //==============================================================================
@@ -59,47 +84,70 @@ Loop::Model::Model(
 : _earliest_start_time(earliest_start_time),
   _parameters(parameters),
   _start_waypoint(start_waypoint),
-  _finish_waypoint(finish_waypoint)
+  _finish_waypoint(finish_waypoint),
+  _num_loops(num_loops)
 {
-  // Calculate the invariant duration and battery drain for this task
-  _invariant_duration = rmf_traffic::Duration{0};
-  _invariant_battery_drain = 0.0;
-  if (_start_waypoint != _finish_waypoint)
-  {
-    rmf_traffic::agv::Planner::Start loop_start{
-      _earliest_start_time,
-      _start_waypoint,
-      0.0};
-    rmf_traffic::agv::Planner::Goal loop_end_goal{_finish_waypoint};
-
-    const auto forward_loop_plan = _parameters.planner()->plan(
-      loop_start, loop_end_goal);
-
-    auto itinerary_start_time = _earliest_start_time;
-    double forward_battery_drain = 0.0;
-    rmf_traffic::Duration forward_duration(0);
-    for (const auto& itinerary : forward_loop_plan->get_itinerary())
+  Hasher shape;
+  shape << std::string("Loop")
+        << static_cast<uint64_t>(_start_waypoint)
+        << static_cast<uint64_t>(_finish_waypoint)
+        << static_cast<uint64_t>(_num_loops);
+  _invariant = shared_invariant(_parameters, shape.value());
+}
+
+//==============================================================================
+Task::ConstModelPtr Loop::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  // The invariants do not depend on the start time, so the copy shares them
+  auto model = std::make_shared<Loop::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
+}
+
+//==============================================================================
+void Loop::Model::materialize(const TravelEstimator& travel_estimator) const
+{
+  _materialize(&travel_estimator);
+}
+
+//==============================================================================
+void Loop::Model::_materialize(const TravelEstimator* travel_estimator) const
+{
+  std::call_once(_invariant->once, [&]()
     {
-      const auto& trajectory = itinerary.trajectory();
-      const auto& finish_time = *trajectory.finish_time();
-      const auto itinerary_duration = finish_time - itinerary_start_time;
-
-      // Compute the invariant battery drain
-      const double dSOC_motion =
-        _parameters.motion_sink()->compute_change_in_charge(trajectory);
-      const double dSOC_device =
-        _parameters.ambient_sink()->compute_change_in_charge(
-        rmf_traffic::time::to_seconds(itinerary_duration));
-      forward_battery_drain += dSOC_motion + dSOC_device;
-
-      forward_duration += itinerary_duration;
-      itinerary_start_time = finish_time;
-    }
-    _invariant_duration =
-      (2 * num_loops - 1) * forward_duration;
-    _invariant_battery_drain =
-      (2 * num_loops - 1) * forward_battery_drain;
-  }
+      // Calculate the invariant duration and battery drain for this task
+      _invariant->duration = rmf_traffic::Duration{0};
+      _invariant->battery_drain = 0.0;
+      if (_start_waypoint == _finish_waypoint)
+        return;
+
+      rmf_traffic::agv::Planner::Start loop_start{
+        _earliest_start_time,
+        _start_waypoint,
+        0.0};
+      rmf_traffic::agv::Planner::Goal loop_end_goal{_finish_waypoint};
+
+      // The estimator memoizes this leg, so loops between the same waypoints
+      // only plan it once
+      const auto forward_travel = travel_estimator ?
+      travel_estimator->estimate(loop_start, loop_end_goal) :
+      TravelEstimator::shared(_parameters)->estimate(
+        loop_start, loop_end_goal);
+
+      double forward_battery_drain = 0.0;
+      rmf_traffic::Duration forward_duration(0);
+      if (forward_travel.has_value())
+      {
+        forward_battery_drain = forward_travel->change_in_charge();
+        forward_duration = forward_travel->duration();
+      }
+
+      _invariant->duration =
+        (2 * _num_loops - 1) * forward_duration;
+      _invariant->battery_drain =
+        (2 * _num_loops - 1) * forward_battery_drain;
+    });
 }
 
 //==============================================================================
@@ -108,18 +156,44 @@ std::optional<rmf_task::Estimate> Loop::Model::estimate_finish(
   const Constraints& task_planning_constraints,
   const TravelEstimator& travel_estimator) const
 {
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool Loop::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto Loop::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  _materialize(&travel_estimator);
+
   rmf_traffic::Duration variant_duration(0);
 
-  double battery_soc = initial_state.battery_soc().value();
+  double battery_soc = initial_state.battery_soc;
   const bool drain_battery = task_planning_constraints.drain_battery();
   const auto& ambient_sink = *_parameters.ambient_sink();
   const auto battery_threshold = task_planning_constraints.threshold_soc();
 
   // Check if a plan has to be generated from finish location to start_waypoint
-  if (initial_state.waypoint() != _start_waypoint)
+  if (initial_state.waypoint != _start_waypoint)
   {
     const auto travel = travel_estimator.estimate(
-      initial_state.extract_plan_start().value(),
+      initial_state.plan_start(),
       _start_waypoint);
 
     if (!travel.has_value())
@@ -136,17 +210,14 @@ std::optional<rmf_task::Estimate> Loop::Model::estimate_finish(
   // Compute wait_until
   const rmf_traffic::Time ideal_start = _earliest_start_time - variant_duration;
   const rmf_traffic::Time wait_until =
-    initial_state.time().value() > ideal_start ?
-    initial_state.time().value() : ideal_start;
+    initial_state.time > ideal_start ? initial_state.time : ideal_start;
 
   // Factor in battery drain while waiting to move to start waypoint. If a robot
   // is initially at a charging waypoint, it is assumed to be continually charging
-  if (drain_battery && wait_until > initial_state.time().value() &&
-    initial_state.waypoint().value() !=
-    initial_state.dedicated_charging_waypoint().value())
+  if (drain_battery && wait_until > initial_state.time &&
+    initial_state.waypoint != initial_state.dedicated_charging_waypoint)
   {
-    rmf_traffic::Duration wait_duration(
-      wait_until - initial_state.time().value());
+    rmf_traffic::Duration wait_duration(wait_until - initial_state.time);
 
     const auto dSOC_device = ambient_sink.compute_change_in_charge(
       rmf_traffic::time::to_seconds(wait_duration));
@@ -158,35 +229,33 @@ std::optional<rmf_task::Estimate> Loop::Model::estimate_finish(
 
   // Compute finish time
   const rmf_traffic::Time state_finish_time =
-    wait_until + variant_duration + _invariant_duration;
+    wait_until + variant_duration + _invariant->duration;
 
   // Subtract invariant battery drain
   if (drain_battery)
   {
-    battery_soc -= _invariant_battery_drain;
+    battery_soc -= _invariant->battery_drain;
     if (battery_soc <= battery_threshold)
       return std::nullopt;
   }
 
   // Return Estimate
-  rmf_traffic::agv::Planner::Start location{
-    state_finish_time,
+  const PlanningState finish_state{
     _finish_waypoint,
-    initial_state.orientation().value()};
-
-  auto finish_state = State().load_basic(
-    std::move(location),
-    initial_state.dedicated_charging_waypoint().value(),
-    battery_soc);
+    initial_state.orientation,
+    state_finish_time,
+    initial_state.dedicated_charging_waypoint,
+    battery_soc
+  };
 
   // Check if robot can return to its charger
   if (drain_battery)
   {
-    if (_finish_waypoint != initial_state.dedicated_charging_waypoint().value())
+    if (_finish_waypoint != initial_state.dedicated_charging_waypoint)
     {
       const auto travel = travel_estimator.estimate(
-        finish_state.extract_plan_start().value(),
-        finish_state.dedicated_charging_waypoint().value());
+        finish_state.plan_start(),
+        finish_state.dedicated_charging_waypoint);
 
       if (!travel.has_value())
         return std::nullopt;
@@ -197,13 +266,14 @@ std::optional<rmf_task::Estimate> Loop::Model::estimate_finish(
     }
   }
 
-  return Estimate(finish_state, wait_until);
+  return PlanningEstimate{finish_state, wait_until};
 }
 
 //==============================================================================
 rmf_traffic::Duration Loop::Model::invariant_duration() const
 {
-  return _invariant_duration;
+  _materialize(nullptr);
+  return _invariant->duration;
 }
 
 //==============================================================================
@@ -253,6 +323,16 @@ Task::ConstModelPtr Loop::Description::make_model(
     _pimpl->num_loops);
 }
 
+//==============================================================================
+std::optional<std::size_t> Loop::Description::model_hash() const
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(_pimpl->start_waypoint)
+       << static_cast<uint64_t>(_pimpl->finish_waypoint)
+       << static_cast<uint64_t>(_pimpl->num_loops);
+  return static_cast<std::size_t>(hash.value());
+}
+
 //==============================================================================
 auto Loop::Description::generate_info(
   const rmf_task::State&,
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task/requests/MultiStopDelivery.hpp>
+
+#include "../Hasher.hpp"
+#include "internal_Invariant.hpp"
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+class MultiStopDelivery::Model : public Task::Model
+{
+public:
+
+  std::optional<Estimate> estimate_finish(
+    const State& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  rmf_traffic::Duration invariant_duration() const final;
+
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
+  void materialize(const TravelEstimator& travel_estimator) const final;
+
+  Model(
+    const rmf_traffic::Time earliest_start_time,
+    const Parameters& parameters,
+    std::size_t pickup_waypoint,
+    rmf_traffic::Duration pickup_wait,
+    std::shared_ptr<const std::vector<Stop>> dropoffs,
+    uint64_t shape);
+
+private:
+
+  // Compute the invariant duration and battery drain of the whole chain of
+  // legs if that has not been done yet. If no travel estimator is given, a
+  // shared one is used.
+  void _materialize(const TravelEstimator* travel_estimator) const;
+
+  rmf_traffic::Time _earliest_start_time;
+  Parameters _parameters;
+  std::size_t _pickup_waypoint;
+  rmf_traffic::Duration _pickup_wait;
+  std::shared_ptr<const std::vector<Stop>> _dropoffs;
+
+  // The invariants need a plan for every leg from the pickup through each of
+  // the stops, so they are only computed once they are first used and then
+  // shared by every delivery with the same route
+  std::shared_ptr<Invariant> _invariant;
+};
+
+//==============================================================================
+MultiStopDelivery::Model::Model(
+  const rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters,
+  std::size_t pickup_waypoint,
+  rmf_traffic::Duration pickup_wait,
+  std::shared_ptr<const std::vector<Stop>> dropoffs,
+  const uint64_t shape)
+: _earliest_start_time(earliest_start_time),
+  _parameters(parameters),
+  _pickup_waypoint(pickup_waypoint),
+  _pickup_wait(pickup_wait),
+  _dropoffs(std::move(dropoffs)),
+  _invariant(shared_invariant(_parameters, shape))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Task::ConstModelPtr MultiStopDelivery::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  // The invariants do not depend on the start time, so the copy shares them
+  auto model = std::make_shared<MultiStopDelivery::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
+}
+
+//==============================================================================
+void MultiStopDelivery::Model::materialize(
+  const TravelEstimator& travel_estimator) const
+{
+  _materialize(&travel_estimator);
+}
+
+//==============================================================================
+void MultiStopDelivery::Model::_materialize(
+  const TravelEstimator* travel_estimator) const
+{
+  std::call_once(_invariant->once, [&]()
+    {
+      std::shared_ptr<TravelEstimator> shared_estimator;
+      if (!travel_estimator)
+      {
+        shared_estimator = TravelEstimator::shared(_parameters);
+        travel_estimator = shared_estimator.get();
+      }
+
+      rmf_traffic::Duration waiting = _pickup_wait;
+      std::size_t from = _pickup_waypoint;
+      for (const auto& stop : *_dropoffs)
+      {
+        waiting += stop.wait;
+        if (stop.waypoint == from)
+          continue;
+
+        // The estimator memoizes each leg, so deliveries that share part of
+        // a route only plan it once
+        const auto travel = travel_estimator->estimate(
+          rmf_traffic::agv::Plan::Start(_earliest_start_time, from, 0.0),
+          rmf_traffic::agv::Plan::Goal(stop.waypoint));
+
+        if (!travel.has_value())
+        {
+          _invariant->reachable = false;
+          return;
+        }
+
+        _invariant->duration += travel->duration();
+        _invariant->battery_drain += travel->change_in_charge();
+        from = stop.waypoint;
+      }
+
+      _invariant->duration += waiting;
+      _invariant->battery_drain +=
+        _parameters.ambient_sink()->compute_change_in_charge(
+        rmf_traffic::time::to_seconds(waiting));
+    });
+}
+
+//==============================================================================
+std::optional<rmf_task::Estimate> MultiStopDelivery::Model::estimate_finish(
+  const State& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool MultiStopDelivery::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto MultiStopDelivery::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  _materialize(&travel_estimator);
+  if (!_invariant->reachable)
+    return std::nullopt;
+
+  const std::size_t final_waypoint = _dropoffs->back().waypoint;
+  PlanningState state = initial_state;
+  state.waypoint = final_waypoint;
+
+  rmf_traffic::Duration variant_duration(0);
+
+  double battery_soc = initial_state.battery_soc;
+  const bool drain_battery = task_planning_constraints.drain_battery();
+  const auto& ambient_sink = *_parameters.ambient_sink();
+  const double battery_threshold = task_planning_constraints.threshold_soc();
+
+  // Factor in battery drain while moving to start waypoint of task
+  if (initial_state.waypoint != _pickup_waypoint)
+  {
+    const auto travel = travel_estimator.estimate(
+      initial_state.plan_start(),
+      _pickup_waypoint);
+
+    if (!travel)
+      return std::nullopt;
+
+    variant_duration = travel->duration();
+    if (drain_battery)
+      battery_soc = battery_soc - travel->change_in_charge();
+
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+  }
+
+  const rmf_traffic::Time ideal_start = _earliest_start_time - variant_duration;
+  const rmf_traffic::Time wait_until =
+    initial_state.time > ideal_start ? initial_state.time : ideal_start;
+
+  // Factor in battery drain while waiting to move to start waypoint. If a
+  // robot is initially at a charging waypoint, it is assumed to be continually
+  // charging
+  if (drain_battery && wait_until > initial_state.time &&
+    initial_state.waypoint != initial_state.dedicated_charging_waypoint)
+  {
+    const rmf_traffic::Duration wait_duration(wait_until - initial_state.time);
+    battery_soc -= ambient_sink.compute_change_in_charge(
+      rmf_traffic::time::to_seconds(wait_duration));
+
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+  }
+
+  // Factor in the invariants of the whole chain of legs in one step
+  state.time = wait_until + variant_duration + _invariant->duration;
+
+  if (drain_battery)
+  {
+    battery_soc -= _invariant->battery_drain;
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+
+    // Check if the robot has enough charge to head back to nearest charger
+    if (final_waypoint != state.dedicated_charging_waypoint)
+    {
+      const auto travel = travel_estimator.estimate(
+        state.plan_start(),
+        state.dedicated_charging_waypoint);
+
+      if (!travel.has_value())
+        return std::nullopt;
+
+      if (battery_soc - travel->change_in_charge() <= battery_threshold)
+        return std::nullopt;
+    }
+
+    state.battery_soc = battery_soc;
+  }
+
+  return PlanningEstimate{state, wait_until};
+}
+
+//==============================================================================
+rmf_traffic::Duration MultiStopDelivery::Model::invariant_duration() const
+{
+  _materialize(nullptr);
+  return _invariant->duration;
+}
+
+//==============================================================================
+class MultiStopDelivery::Description::Implementation
+{
+public:
+
+  std::size_t pickup_waypoint;
+  rmf_traffic::Duration pickup_wait;
+  // Shared with the models of the request
+  std::shared_ptr<const std::vector<Stop>> dropoffs;
+  std::string pickup_from_dispenser;
+};
+
+//==============================================================================
+auto MultiStopDelivery::Description::make(
+  std::size_t pickup_waypoint,
+  rmf_traffic::Duration pickup_wait,
+  std::vector<Stop> dropoffs,
+  std::string pickup_from_dispenser) -> std::shared_ptr<Description>
+{
+  if (dropoffs.empty())
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "[rmf_task::requests::MultiStopDelivery::Description::make] At least "
+      "one stop is needed");
+    // *INDENT-ON*
+  }
+
+  std::shared_ptr<Description> delivery(new Description());
+  delivery->_pimpl = rmf_utils::make_impl<Implementation>(
+    Implementation{
+      pickup_waypoint,
+      pickup_wait,
+      std::make_shared<const std::vector<Stop>>(std::move(dropoffs)),
+      std::move(pickup_from_dispenser)
+    });
+
+  return delivery;
+}
+
+//==============================================================================
+MultiStopDelivery::Description::Description()
+{
+  // Do nothing
+}
+
+//==============================================================================
+Task::ConstModelPtr MultiStopDelivery::Description::make_model(
+  rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters) const
+{
+  Hasher shape;
+  shape << std::string("MultiStopDelivery")
+        << static_cast<uint64_t>(*model_hash());
+
+  return std::make_shared<MultiStopDelivery::Model>(
+    earliest_start_time,
+    parameters,
+    _pimpl->pickup_waypoint,
+    _pimpl->pickup_wait,
+    _pimpl->dropoffs,
+    shape.value());
+}
+
+//==============================================================================
+std::optional<std::size_t> MultiStopDelivery::Description::model_hash() const
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(_pimpl->pickup_waypoint)
+       << static_cast<uint64_t>(_pimpl->pickup_wait.count())
+       << static_cast<uint64_t>(_pimpl->dropoffs->size());
+  for (const auto& stop : *_pimpl->dropoffs)
+  {
+    hash << static_cast<uint64_t>(stop.waypoint)
+         << static_cast<uint64_t>(stop.wait.count());
+  }
+
+  return static_cast<std::size_t>(hash.value());
+}
+
+//==============================================================================
+auto MultiStopDelivery::Description::generate_info(
+  const State&,
+  const Parameters& parameters) const -> Info
+{
+  const auto& graph = parameters.planner()->get_configuration().graph();
+
+  std::string detail;
+  for (const auto& stop : *_pimpl->dropoffs)
+  {
+    if (!detail.empty())
+      detail += ", ";
+
+    detail += standard_waypoint_name(graph, stop.waypoint);
+  }
+
+  return Info{
+    "Delivery from " + standard_waypoint_name(graph, _pimpl->pickup_waypoint)
+    + " to " + std::to_string(_pimpl->dropoffs->size()) + " stops",
+    detail
+  };
+}
+
+//==============================================================================
+std::size_t MultiStopDelivery::Description::pickup_waypoint() const
+{
+  return _pimpl->pickup_waypoint;
+}
+
+//==============================================================================
+rmf_traffic::Duration MultiStopDelivery::Description::pickup_wait() const
+{
+  return _pimpl->pickup_wait;
+}
+
+//==============================================================================
+const std::string& MultiStopDelivery::Description::pickup_from_dispenser()
+const
+{
+  return _pimpl->pickup_from_dispenser;
+}
+
+//==============================================================================
+auto MultiStopDelivery::Description::dropoffs() const
+-> const std::vector<Stop>&
+{
+  return *_pimpl->dropoffs;
+}
+
+//==============================================================================
+ConstRequestPtr MultiStopDelivery::make(
+  std::size_t pickup_waypoint,
+  rmf_traffic::Duration pickup_wait,
+  std::vector<Stop> dropoffs,
+  const std::string& id,
+  rmf_traffic::Time earliest_start_time,
+  ConstPriorityPtr priority,
+  bool automatic,
+  std::string pickup_from_dispenser)
+{
+  Task::ConstBookingPtr booking =
+    std::make_shared<const rmf_task::Task::Booking>(
+    id,
+    earliest_start_time,
+    std::move(priority),
+    automatic);
+  return std::make_shared<Request>(
+    std::move(booking),
+    Description::make(
+      pickup_waypoint, pickup_wait, std::move(dropoffs),
+      std::move(pickup_from_dispenser)));
+}
+
+//==============================================================================
+ConstRequestPtr MultiStopDelivery::make(
+  std::size_t pickup_waypoint,
+  rmf_traffic::Duration pickup_wait,
+  std::vector<Stop> dropoffs,
+  const std::string& id,
+  rmf_traffic::Time earliest_start_time,
+  const std::string& requester,
+  rmf_traffic::Time request_time,
+  ConstPriorityPtr priority,
+  bool automatic,
+  std::string pickup_from_dispenser)
+{
+  Task::ConstBookingPtr booking =
+    std::make_shared<const rmf_task::Task::Booking>(
+    id,
+    earliest_start_time,
+    std::move(priority),
+    requester,
+    request_time,
+    automatic);
+  return std::make_shared<Request>(
+    std::move(booking),
+    Description::make(
+      pickup_waypoint, pickup_wait, std::move(dropoffs),
+      std::move(pickup_from_dispenser)));
+}
+
+} // namespace requests
+} // namespace rmf_task
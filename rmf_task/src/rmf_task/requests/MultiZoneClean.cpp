@@ -0,0 +1,577 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include <rmf_task/requests/MultiZoneClean.hpp>
+
+#include "../DrainMemo.hpp"
+#include "../Hasher.hpp"
+#include "internal_Invariant.hpp"
+
+namespace rmf_task {
+namespace requests {
+
+namespace {
+//==============================================================================
+// The cost of a leg between two zones when there is no way to travel it. It
+// is large enough that a tour only uses such a leg if it has no alternative.
+const double unreachable_cost = 1e12;
+
+// The most passes of 2-opt moves that are tried on one tour
+const std::size_t max_improvement_passes = 8;
+
+//==============================================================================
+void hash_zone(Hasher& hash, const MultiZoneClean::Zone& zone)
+{
+  hash << static_cast<uint64_t>(zone.start_waypoint)
+       << static_cast<uint64_t>(zone.end_waypoint)
+       << static_cast<uint64_t>(zone.cleaning_path.size());
+
+  // Only the timing of the cleaning path relative to its start matters
+  const auto& path = zone.cleaning_path;
+  for (auto it = path.begin(); it != path.end(); ++it)
+  {
+    const Eigen::Vector3d p = it->position();
+    const Eigen::Vector3d v = it->velocity();
+    hash << static_cast<uint64_t>((it->time() - path.begin()->time()).count())
+         << p[0] << p[1] << p[2] << v[0] << v[1] << v[2];
+  }
+}
+
+//==============================================================================
+// The cost of visiting the zones in this order, where cost[i][j] is the cost
+// of the leg from the end of zone i to the start of zone j
+double tour_cost(
+  const std::vector<std::size_t>& order,
+  const std::vector<std::vector<double>>& cost)
+{
+  double total = 0.0;
+  for (std::size_t k = 1; k < order.size(); ++k)
+    total += cost[order[k-1]][order[k]];
+
+  return total;
+}
+
+//==============================================================================
+// Choose an order to visit the zones in. The robot can begin at any zone, so
+// this is an open tour. A nearest neighbor tour is grown from every zone and
+// the cheapest one is improved by reversing segments of it for as long as
+// that makes it cheaper. Reversing a segment also reverses the direction of
+// its legs, so each move is checked against the whole tour.
+std::vector<std::size_t> choose_order(
+  const std::vector<std::vector<double>>& cost)
+{
+  const std::size_t N = cost.size();
+  std::vector<std::size_t> best;
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (std::size_t first = 0; first < N; ++first)
+  {
+    std::vector<std::size_t> order = {first};
+    std::vector<bool> visited(N, false);
+    visited[first] = true;
+    while (order.size() < N)
+    {
+      const auto from = order.back();
+      std::size_t next = N;
+      for (std::size_t j = 0; j < N; ++j)
+      {
+        if (!visited[j] && (next == N || cost[from][j] < cost[from][next]))
+          next = j;
+      }
+
+      visited[next] = true;
+      order.push_back(next);
+    }
+
+    const double c = tour_cost(order, cost);
+    if (c < best_cost)
+    {
+      best_cost = c;
+      best = std::move(order);
+    }
+  }
+
+  bool improved = true;
+  for (std::size_t pass = 0; improved && pass < max_improvement_passes; ++pass)
+  {
+    improved = false;
+    for (std::size_t i = 0; i + 1 < N; ++i)
+    {
+      for (std::size_t j = i + 1; j < N; ++j)
+      {
+        auto candidate = best;
+        std::reverse(candidate.begin() + i, candidate.begin() + j + 1);
+        const double c = tour_cost(candidate, cost);
+        if (c < best_cost)
+        {
+          best_cost = c;
+          best = std::move(candidate);
+          improved = true;
+        }
+      }
+    }
+  }
+
+  return best;
+}
+} // anonymous namespace
+
+//==============================================================================
+class MultiZoneClean::Model : public Task::Model
+{
+public:
+
+  std::optional<Estimate> estimate_finish(
+    const State& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  bool uses_planning_state() const final;
+
+  std::optional<PlanningEstimate> estimate_planning_finish(
+    const PlanningState& initial_state,
+    const Constraints& task_planning_constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  rmf_traffic::Duration invariant_duration() const final;
+
+  Task::ConstModelPtr with_earliest_start_time(
+    rmf_traffic::Time earliest_start_time) const final;
+
+  void materialize(const TravelEstimator& travel_estimator) const final;
+
+  /// The order that the zones are visited in
+  const std::vector<std::size_t>& order() const;
+
+  Model(
+    const rmf_traffic::Time earliest_start_time,
+    const Parameters& parameters,
+    std::shared_ptr<const std::vector<Zone>> zones,
+    uint64_t shape);
+
+private:
+
+  // Choose the order of the zones and compute the invariant duration and
+  // battery drain if that has not been done yet. If no travel estimator is
+  // given, a shared one is used.
+  void _materialize(const TravelEstimator* travel_estimator) const;
+
+  rmf_traffic::Time _earliest_start_time;
+  Parameters _parameters;
+  std::shared_ptr<const std::vector<Zone>> _zones;
+
+  // The invariants need plans between the zones, so they are only computed
+  // once they are first used and then shared by every request with the same
+  // zones
+  std::shared_ptr<Invariant> _invariant;
+};
+
+//==============================================================================
+MultiZoneClean::Model::Model(
+  const rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters,
+  std::shared_ptr<const std::vector<Zone>> zones,
+  const uint64_t shape)
+: _earliest_start_time(earliest_start_time),
+  _parameters(parameters),
+  _zones(std::move(zones)),
+  _invariant(shared_invariant(_parameters, shape))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Task::ConstModelPtr MultiZoneClean::Model::with_earliest_start_time(
+  const rmf_traffic::Time earliest_start_time) const
+{
+  // The invariants do not depend on the start time, so the copy shares them
+  auto model = std::make_shared<MultiZoneClean::Model>(*this);
+  model->_earliest_start_time = earliest_start_time;
+  return model;
+}
+
+//==============================================================================
+void MultiZoneClean::Model::materialize(
+  const TravelEstimator& travel_estimator) const
+{
+  _materialize(&travel_estimator);
+}
+
+//==============================================================================
+const std::vector<std::size_t>& MultiZoneClean::Model::order() const
+{
+  _materialize(nullptr);
+  return _invariant->order;
+}
+
+//==============================================================================
+void MultiZoneClean::Model::_materialize(
+  const TravelEstimator* travel_estimator) const
+{
+  std::call_once(_invariant->once, [&]()
+    {
+      std::shared_ptr<TravelEstimator> shared_estimator;
+      if (!travel_estimator)
+      {
+        shared_estimator = TravelEstimator::shared(_parameters);
+        travel_estimator = shared_estimator.get();
+      }
+
+      const auto& zones = *_zones;
+      const std::size_t N = zones.size();
+
+      // The estimator plans the legs from the end of each zone to the start
+      // of every other zone concurrently, and memoizes them
+      std::vector<rmf_traffic::agv::Plan::Goal> goals;
+      goals.reserve(N);
+      for (const auto& zone : zones)
+        goals.emplace_back(zone.start_waypoint);
+
+      using Leg = std::optional<TravelEstimator::Result>;
+      std::vector<std::vector<Leg>> legs(N);
+      std::vector<std::vector<double>> cost(N, std::vector<double>(N, 0.0));
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        legs[i] = travel_estimator->estimate(
+          rmf_traffic::agv::Plan::Start(
+            _earliest_start_time, zones[i].end_waypoint, 0.0),
+          goals);
+
+        for (std::size_t j = 0; j < N; ++j)
+        {
+          if (i == j || zones[i].end_waypoint == zones[j].start_waypoint)
+            continue;
+
+          cost[i][j] = legs[i][j].has_value() ?
+            rmf_traffic::time::to_seconds(legs[i][j]->duration()) :
+            unreachable_cost;
+        }
+      }
+
+      _invariant->order = choose_order(cost);
+
+      const auto& order = _invariant->order;
+      for (std::size_t k = 0; k < N; ++k)
+      {
+        const auto& zone = zones[order[k]];
+        if (k > 0)
+        {
+          const auto& previous = zones[order[k-1]];
+          if (previous.end_waypoint != zone.start_waypoint)
+          {
+            const auto& leg = legs[order[k-1]][order[k]];
+            if (!leg.has_value())
+            {
+              _invariant->reachable = false;
+              continue;
+            }
+
+            _invariant->duration += leg->duration();
+            _invariant->battery_drain += leg->change_in_charge();
+          }
+        }
+
+        // Calculate duration and battery drain of cleaning the zone
+        const auto& path = zone.cleaning_path;
+        const auto duration = *path.finish_time() - path.begin()->time();
+        const double duration_s = rmf_traffic::time::to_seconds(duration);
+        _invariant->duration += duration;
+        _invariant->battery_drain +=
+          DrainMemo::motion(_parameters.motion_sink(), path)
+          + _parameters.ambient_sink()->compute_change_in_charge(duration_s)
+          + _parameters.tool_sink()->compute_change_in_charge(duration_s);
+      }
+    });
+}
+
+//==============================================================================
+std::optional<rmf_task::Estimate> MultiZoneClean::Model::estimate_finish(
+  const State& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  const auto estimate = estimate_planning_finish(
+    PlanningState::from(initial_state).value(),
+    task_planning_constraints,
+    travel_estimator);
+
+  if (!estimate.has_value())
+    return std::nullopt;
+
+  return Estimate(estimate->finish_state.to_state(), estimate->wait_until);
+}
+
+//==============================================================================
+bool MultiZoneClean::Model::uses_planning_state() const
+{
+  return true;
+}
+
+//==============================================================================
+auto MultiZoneClean::Model::estimate_planning_finish(
+  const PlanningState& initial_state,
+  const Constraints& task_planning_constraints,
+  const TravelEstimator& travel_estimator) const
+-> std::optional<PlanningEstimate>
+{
+  _materialize(&travel_estimator);
+  if (!_invariant->reachable)
+    return std::nullopt;
+
+  const auto& zones = *_zones;
+  const std::size_t start_waypoint =
+    zones[_invariant->order.front()].start_waypoint;
+  const std::size_t end_waypoint =
+    zones[_invariant->order.back()].end_waypoint;
+
+  PlanningState state = initial_state;
+  state.waypoint = end_waypoint;
+
+  rmf_traffic::Duration variant_duration(0);
+
+  double battery_soc = initial_state.battery_soc;
+  const bool drain_battery = task_planning_constraints.drain_battery();
+  const auto& ambient_sink = *_parameters.ambient_sink();
+  const double battery_threshold = task_planning_constraints.threshold_soc();
+
+  if (initial_state.waypoint != start_waypoint)
+  {
+    const auto travel = travel_estimator.estimate(
+      initial_state.plan_start(),
+      start_waypoint);
+
+    if (!travel.has_value())
+      return std::nullopt;
+
+    variant_duration = travel->duration();
+    if (drain_battery)
+      battery_soc = battery_soc - travel->change_in_charge();
+
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+  }
+
+  const rmf_traffic::Time ideal_start = _earliest_start_time - variant_duration;
+  const rmf_traffic::Time wait_until =
+    initial_state.time > ideal_start ? initial_state.time : ideal_start;
+
+  // Factor in battery drain while waiting to move to the first zone. If a
+  // robot is initially at a charging waypoint, it is assumed to be continually
+  // charging
+  if (drain_battery && wait_until > initial_state.time &&
+    initial_state.waypoint != initial_state.dedicated_charging_waypoint)
+  {
+    const rmf_traffic::Duration wait_duration(wait_until - initial_state.time);
+    const double dSOC_ambient = ambient_sink.compute_change_in_charge(
+      rmf_traffic::time::to_seconds(wait_duration));
+    battery_soc = battery_soc - dSOC_ambient;
+
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+  }
+
+  // Factor in invariants
+  state.time = wait_until + variant_duration + _invariant->duration;
+
+  if (drain_battery)
+  {
+    battery_soc -= _invariant->battery_drain;
+    if (battery_soc <= battery_threshold)
+      return std::nullopt;
+
+    // Check if the robot has enough charge to head back to nearest charger
+    if (end_waypoint != state.dedicated_charging_waypoint)
+    {
+      const auto travel = travel_estimator.estimate(
+        state.plan_start(),
+        state.dedicated_charging_waypoint);
+
+      if (!travel.has_value())
+        return std::nullopt;
+
+      if (battery_soc - travel->change_in_charge() <= battery_threshold)
+        return std::nullopt;
+    }
+
+    state.battery_soc = battery_soc;
+  }
+
+  return PlanningEstimate{state, wait_until};
+}
+
+//==============================================================================
+rmf_traffic::Duration MultiZoneClean::Model::invariant_duration() const
+{
+  _materialize(nullptr);
+  return _invariant->duration;
+}
+
+//==============================================================================
+class MultiZoneClean::Description::Implementation
+{
+public:
+
+  // Shared with the models of the request
+  std::shared_ptr<const std::vector<Zone>> zones;
+};
+
+//==============================================================================
+std::shared_ptr<MultiZoneClean::Description> MultiZoneClean::Description::make(
+  std::vector<Zone> zones)
+{
+  if (zones.empty())
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "[rmf_task::requests::MultiZoneClean::Description::make] At least one "
+      "zone is needed");
+    // *INDENT-ON*
+  }
+
+  std::shared_ptr<Description> clean(new Description());
+  clean->_pimpl->zones =
+    std::make_shared<const std::vector<Zone>>(std::move(zones));
+
+  return clean;
+}
+
+//==============================================================================
+MultiZoneClean::Description::Description()
+: _pimpl(rmf_utils::make_impl<Implementation>(Implementation()))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Task::ConstModelPtr MultiZoneClean::Description::make_model(
+  rmf_traffic::Time earliest_start_time,
+  const Parameters& parameters) const
+{
+  if (parameters.tool_sink() == nullptr)
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "Required parameter tool_sink is undefined in the supplied parameters");
+    // *INDENT-ON*
+  }
+
+  Hasher shape;
+  shape << std::string("MultiZoneClean")
+        << static_cast<uint64_t>(*model_hash());
+
+  return std::make_shared<MultiZoneClean::Model>(
+    earliest_start_time,
+    parameters,
+    _pimpl->zones,
+    shape.value());
+}
+
+//==============================================================================
+std::optional<std::size_t> MultiZoneClean::Description::model_hash() const
+{
+  Hasher hash;
+  hash << static_cast<uint64_t>(_pimpl->zones->size());
+  for (const auto& zone : *_pimpl->zones)
+    hash_zone(hash, zone);
+
+  return static_cast<std::size_t>(hash.value());
+}
+
+//==============================================================================
+auto MultiZoneClean::Description::generate_info(
+  const State&,
+  const Parameters& parameters) const -> Info
+{
+  const auto& graph = parameters.planner()->get_configuration().graph();
+
+  std::string detail;
+  for (const auto& zone : *_pimpl->zones)
+  {
+    if (!detail.empty())
+      detail += ", ";
+
+    detail += standard_waypoint_name(graph, zone.start_waypoint);
+  }
+
+  return Info{
+    "Clean " + std::to_string(_pimpl->zones->size()) + " zones",
+    detail
+  };
+}
+
+//==============================================================================
+auto MultiZoneClean::Description::zones() const -> const std::vector<Zone>&
+{
+  return *_pimpl->zones;
+}
+
+//==============================================================================
+std::vector<std::size_t> MultiZoneClean::Description::visiting_order(
+  const Parameters& parameters) const
+{
+  const auto model = std::static_pointer_cast<const MultiZoneClean::Model>(
+    make_model(rmf_traffic::Time(), parameters));
+
+  return model->order();
+}
+
+//==============================================================================
+ConstRequestPtr MultiZoneClean::make(
+  std::vector<Zone> zones,
+  const std::string& id,
+  rmf_traffic::Time earliest_start_time,
+  ConstPriorityPtr priority,
+  bool automatic)
+{
+  Task::ConstBookingPtr booking =
+    std::make_shared<const rmf_task::Task::Booking>(
+    id,
+    earliest_start_time,
+    std::move(priority),
+    automatic);
+  return std::make_shared<Request>(
+    std::move(booking),
+    MultiZoneClean::Description::make(std::move(zones)));
+}
+
+//==============================================================================
+ConstRequestPtr MultiZoneClean::make(
+  std::vector<Zone> zones,
+  const std::string& id,
+  rmf_traffic::Time earliest_start_time,
+  const std::string& requester,
+  rmf_traffic::Time request_time,
+  ConstPriorityPtr priority,
+  bool automatic)
+{
+  Task::ConstBookingPtr booking =
+    std::make_shared<const rmf_task::Task::Booking>(
+    id,
+    earliest_start_time,
+    std::move(priority),
+    requester,
+    request_time,
+    automatic);
+  return std::make_shared<Request>(
+    std::move(booking),
+    MultiZoneClean::Description::make(std::move(zones)));
+}
+
+} // namespace requests
+} // namespace rmf_task
@@ -18,32 +18,11 @@
 #include <rmf_task/requests/ParkRobotFactory.hpp>
 #include <rmf_task/requests/Loop.hpp>
 
-#include <random>
+#include "internal_RequestId.hpp"
 
 namespace rmf_task {
 namespace requests {
 
-//==============================================================================
-namespace {
-std::string generate_uuid(const std::size_t length = 3)
-{
-  std::stringstream ss;
-  for (std::size_t i = 0; i < length; ++i)
-  {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    const auto random_char = dis(gen);
-    std::stringstream hexstream;
-    hexstream << std::hex << random_char;
-    auto hex = hexstream.str();
-    ss << (hex.length() < 2 ? '0' + hex : hex);
-  }
-  return ss.str();
-}
-
-} // anonymous namespace
-
 //==============================================================================
 class ParkRobotFactory::Implementation
 {
@@ -76,7 +55,7 @@ ParkRobotFactory::ParkRobotFactory(
 //==============================================================================
 ConstRequestPtr ParkRobotFactory::make_request(const State& state) const
 {
-  std::string id = "ParkRobot" + generate_uuid();
+  std::string id = generate_request_id("ParkRobot");
   const auto start_waypoint = state.waypoint().value();
   const auto finish_waypoint = _pimpl->parking_waypoint.has_value() ?
     _pimpl->parking_waypoint.value() :
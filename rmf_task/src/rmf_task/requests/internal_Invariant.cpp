@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_Invariant.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+std::shared_ptr<Invariant> shared_invariant(
+  const Parameters& parameters,
+  const uint64_t shape)
+{
+  struct Key
+  {
+    uint64_t shape;
+    const void* planner;
+    const void* motion_sink;
+    const void* ambient_sink;
+    const void* tool_sink;
+
+    bool operator==(const Key& other) const
+    {
+      return shape == other.shape
+        && planner == other.planner
+        && motion_sink == other.motion_sink
+        && ambient_sink == other.ambient_sink
+        && tool_sink == other.tool_sink;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return std::hash<uint64_t>()(key.shape)
+        ^ std::hash<const void*>()(key.planner)
+        ^ (std::hash<const void*>()(key.motion_sink) << 1)
+        ^ (std::hash<const void*>()(key.ambient_sink) << 2)
+        ^ (std::hash<const void*>()(key.tool_sink) << 3);
+    }
+  };
+
+  // Every model that holds an invariant also holds its parameters, so the
+  // addresses in a key cannot be reused while its entry is alive
+  const Key key{
+    shape,
+    parameters.planner().get(),
+    parameters.motion_sink().get(),
+    parameters.ambient_sink().get(),
+    parameters.tool_sink().get()
+  };
+
+  static std::mutex registry_mutex;
+  static std::unordered_map<Key, std::weak_ptr<Invariant>, KeyHash> registry;
+  static std::size_t prune_size = 64;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto& entry = registry[key];
+  if (auto invariant = entry.lock())
+    return invariant;
+
+  auto invariant = std::make_shared<Invariant>();
+  entry = invariant;
+
+  // Models are made far more often than estimators, so the expired entries
+  // are only swept once the registry has doubled in size
+  if (registry.size() >= prune_size)
+  {
+    for (auto it = registry.begin(); it != registry.end(); )
+    {
+      if (it->second.expired())
+        it = registry.erase(it);
+      else
+        ++it;
+    }
+
+    prune_size = 2 * std::max<std::size_t>(registry.size(), 32);
+  }
+
+  return invariant;
+}
+
+} // namespace requests
+} // namespace rmf_task
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__REQUESTS__INTERNAL_INVARIANT_HPP
+#define SRC__RMF_TASK__REQUESTS__INTERNAL_INVARIANT_HPP
+
+#include <rmf_task/Parameters.hpp>
+
+#include <rmf_traffic/Time.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+/// The part of a request model that does not depend on when the request
+/// starts: how long the task itself takes and how much battery it drains.
+struct Invariant
+{
+  std::once_flag once;
+  rmf_traffic::Duration duration = rmf_traffic::Duration(0);
+  double battery_drain = 0.0;
+
+  /// For requests that choose the order of their parts, the order that the
+  /// parts are visited in
+  std::vector<std::size_t> order;
+
+  /// False if some part of the request cannot be reached from the part that
+  /// comes before it
+  bool reachable = true;
+};
+
+//==============================================================================
+/// Get the invariant that is shared by every model of a request with this
+/// shape under these parameters, so recurring requests that only differ in
+/// their start time compute it once. The shape should fingerprint the kind of
+/// request along with everything that its invariant depends on. Parameters
+/// only match if they use the same planner and power sinks. The invariant is
+/// kept for as long as any model holds on to it.
+std::shared_ptr<Invariant> shared_invariant(
+  const Parameters& parameters,
+  uint64_t shape);
+
+} // namespace requests
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__REQUESTS__INTERNAL_INVARIANT_HPP
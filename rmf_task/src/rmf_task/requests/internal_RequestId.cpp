@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_RequestId.hpp"
+
+#include <random>
+#include <thread>
+
+namespace rmf_task {
+namespace requests {
+
+namespace {
+//==============================================================================
+std::mt19937& thread_generator()
+{
+  // Mixing in the thread keeps generators that were seeded with the same
+  // entropy from producing the same IDs
+  thread_local std::mt19937 generator(
+    static_cast<std::mt19937::result_type>(std::random_device()()
+    ^ std::hash<std::thread::id>()(std::this_thread::get_id())));
+  return generator;
+}
+
+//==============================================================================
+/// The number of random bytes in each ID
+constexpr std::size_t IdBytes = 3;
+
+} // anonymous namespace
+
+//==============================================================================
+std::string generate_request_id(std::string_view prefix)
+{
+  static constexpr char digits[] = "0123456789abcdef";
+
+  const auto value = thread_generator()();
+  std::string id;
+  id.reserve(prefix.size() + 2 * IdBytes);
+  id.append(prefix);
+  for (std::size_t i = 0; i < IdBytes; ++i)
+  {
+    const auto byte = (value >> (8 * i)) & 0xff;
+    id.push_back(digits[byte >> 4]);
+    id.push_back(digits[byte & 0xf]);
+  }
+
+  return id;
+}
+
+} // namespace requests
+} // namespace rmf_task
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK__REQUESTS__INTERNAL_REQUESTID_HPP
+#define SRC__RMF_TASK__REQUESTS__INTERNAL_REQUESTID_HPP
+
+#include <string>
+#include <string_view>
+
+namespace rmf_task {
+namespace requests {
+
+//==============================================================================
+/// Make an ID for a request that is generated automatically, such as charging
+/// or parking. The ID is the prefix followed by six random hexadecimal digits.
+/// Each thread seeds its own random number generator once, so this is cheap
+/// enough to call for every generated request.
+std::string generate_request_id(std::string_view prefix);
+
+} // namespace requests
+} // namespace rmf_task
+
+#endif // SRC__RMF_TASK__REQUESTS__INTERNAL_REQUESTID_HPP
@@ -17,6 +17,10 @@
 
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <rmf_task/BackupFileManager.hpp>
 
 #include "../mock/MockDelivery.hpp"
@@ -214,3 +218,378 @@ SCENARIO("Back up to file")
   CHECK(restored_snapshot->tag()->header().detail()
     == phase_snapshot->tag()->header().detail());
 }
+
+SCENARIO("Asynchronous backups")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  rmf_task::BackupFileManager backup(backup_root_dir);
+  backup.asynchronous_write().clear_on_shutdown(false);
+
+  auto robot_backup = backup.make_group("group")->make_robot("robot");
+  for (uint64_t i = 0; i < 100; ++i)
+    robot_backup->write(Backup::make(i, "state " + std::to_string(i)));
+
+  // Reading waits for the newest backup to be written
+  const auto state = robot_backup->read();
+  REQUIRE(state.has_value());
+  CHECK(*state == "state 99");
+  CHECK_FALSE(std::filesystem::exists(backup_root_dir / "group" / "robot" /
+    ".backup"));
+
+  // Older backups are still ignored
+  robot_backup->write(Backup::make(50, "state 50"));
+  robot_backup->flush();
+  CHECK(robot_backup->read() == std::optional<std::string>("state 99"));
+
+  WHEN("The robot is cleared on shutdown")
+  {
+    rmf_task::BackupFileManager clearing(backup_root_dir);
+    clearing.asynchronous_write();
+
+    auto robot = clearing.make_group("other_group")->make_robot("robot");
+    robot->write(Backup::make(0, "state"));
+    robot.reset();
+
+    CHECK_FALSE(std::filesystem::exists(backup_root_dir / "other_group" /
+      "robot" / "backup"));
+  }
+}
+
+SCENARIO("Durable backups")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  using Durability = rmf_task::BackupFileManager::Durability;
+
+  rmf_task::BackupFileManager backup(backup_root_dir);
+  backup.clear_on_shutdown(false);
+
+  WHEN("Every write is flushed")
+  {
+    backup.durability(Durability::EveryWrite);
+    auto robot_backup = backup.make_group("group")->make_robot("robot");
+    robot_backup->write(Backup::make(0, "flushed state"));
+    CHECK(robot_backup->read() == std::optional<std::string>("flushed state"));
+    CHECK_FALSE(std::filesystem::exists(backup_root_dir / "group" / "robot" /
+      ".backup"));
+  }
+
+  WHEN("Writes are committed together")
+  {
+    using namespace std::chrono_literals;
+    backup.durability(Durability::GroupCommit, 10ms).asynchronous_write();
+    auto group = backup.make_group("group");
+    auto first = group->make_robot("first");
+    auto second = group->make_robot("second");
+    first->write(Backup::make(0, "first state"));
+    second->write(Backup::make(0, "second state"));
+    CHECK(first->read() == std::optional<std::string>("first state"));
+    CHECK(second->read() == std::optional<std::string>("second state"));
+  }
+}
+
+SCENARIO("Journaled backups")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  const auto robot_dir = backup_root_dir / "group" / "robot";
+  const auto state = [](uint64_t phase)
+    {
+      return "{\"phase\": " + std::to_string(phase) + ", \"data\": \""
+        + std::string(100, 'x') + "\"}";
+    };
+
+  rmf_task::BackupFileManager backup(backup_root_dir);
+  backup.clear_on_shutdown(false).journal(true, 4);
+
+  auto robot_backup = backup.make_group("group")->make_robot("robot");
+  robot_backup->write(Backup::make(0, state(0)));
+  CHECK(std::filesystem::exists(robot_dir / "backup"));
+  CHECK(std::filesystem::exists(robot_dir / "journal"));
+  const auto snapshot_size = std::filesystem::file_size(robot_dir / "backup");
+
+  for (uint64_t i = 1; i <= 3; ++i)
+    robot_backup->write(Backup::make(i, state(i)));
+
+  // Only the journal grows while the snapshot stays the same
+  CHECK(robot_backup->read() == std::optional<std::string>(state(3)));
+  CHECK(std::filesystem::file_size(robot_dir / "journal") < snapshot_size);
+
+  WHEN("The journal is full")
+  {
+    for (uint64_t i = 4; i <= 10; ++i)
+      robot_backup->write(Backup::make(i, state(i)));
+
+    THEN("It is compacted into a new snapshot")
+    {
+      CHECK(robot_backup->read() == std::optional<std::string>(state(10)));
+      CHECK(std::filesystem::file_size(robot_dir / "journal") < snapshot_size);
+    }
+  }
+
+  WHEN("The backups are restored by a new manager")
+  {
+    robot_backup.reset();
+    rmf_task::BackupFileManager restarted(backup_root_dir);
+    auto restored = restarted.make_group("group")->make_robot("robot");
+    CHECK(restored->read() == std::optional<std::string>(state(3)));
+  }
+
+  WHEN("The last journal record was cut off")
+  {
+    robot_backup->flush();
+    const auto size = std::filesystem::file_size(robot_dir / "journal");
+    std::filesystem::resize_file(robot_dir / "journal", size - 2);
+    CHECK(robot_backup->read() == std::optional<std::string>(state(2)));
+  }
+
+  WHEN("The journal is left over from an older snapshot")
+  {
+    std::ofstream(robot_dir / "backup", std::ios::binary) << state(7);
+    CHECK(robot_backup->read() == std::optional<std::string>(state(7)));
+  }
+
+  WHEN("The journal is written asynchronously")
+  {
+    rmf_task::BackupFileManager async_backup(backup_root_dir);
+    async_backup.journal(true, 4).asynchronous_write();
+    auto robot = async_backup.make_group("async")->make_robot("robot");
+    for (uint64_t i = 0; i < 20; ++i)
+      robot->write(Backup::make(i, state(i)));
+
+    CHECK(robot->read() == std::optional<std::string>(state(19)));
+  }
+}
+
+SCENARIO("Consolidated backup store")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  const auto group_dir = backup_root_dir / "group";
+
+  rmf_task::BackupFileManager backup(backup_root_dir);
+  backup.clear_on_shutdown(false).consolidated_store(true, 16);
+
+  auto group = backup.make_group("group");
+  std::vector<std::shared_ptr<rmf_task::BackupFileManager::Robot>> robots;
+  for (std::size_t i = 0; i < 50; ++i)
+  {
+    robots.push_back(group->make_robot("robot_" + std::to_string(i)));
+    CHECK_FALSE(robots.back()->read().has_value());
+    robots.back()->write(Backup::make(0, "state " + std::to_string(i)));
+  }
+
+  // The robots do not get directories of their own
+  CHECK(std::filesystem::exists(group_dir / "backups"));
+  CHECK_FALSE(std::filesystem::exists(group_dir / "robot_0"));
+  CHECK(robots[7]->read() == std::optional<std::string>("state 7"));
+
+  // A backup that does not fit in the slots moves the robot to a new record
+  const std::string large(100, 'x');
+  robots[3]->write(Backup::make(1, large));
+  robots[3]->write(Backup::make(2, "small"));
+  CHECK(robots[3]->read() == std::optional<std::string>("small"));
+
+  WHEN("The store is opened again")
+  {
+    robots.clear();
+    group.reset();
+
+    rmf_task::BackupFileManager restarted(backup_root_dir);
+    restarted.consolidated_store();
+    auto restored_group = restarted.make_group("group");
+    CHECK(restored_group->make_robot("robot_49")->read() ==
+      std::optional<std::string>("state 49"));
+    CHECK(restored_group->make_robot("robot_3")->read() ==
+      std::optional<std::string>("small"));
+
+    THEN("Robots that are cleared on shutdown lose their backups")
+    {
+      CHECK_FALSE(restored_group->make_robot("robot_3")->read().has_value());
+    }
+  }
+
+  WHEN("Durable writes are used")
+  {
+    rmf_task::BackupFileManager durable(backup_root_dir);
+    durable.consolidated_store()
+    .durability(rmf_task::BackupFileManager::Durability::EveryWrite);
+    auto robot = durable.make_group("durable")->make_robot("robot");
+    robot->write(Backup::make(0, "durable state"));
+    CHECK(robot->read() == std::optional<std::string>("durable state"));
+  }
+}
+
+SCENARIO("Compressed backups")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  const auto robot_dir = backup_root_dir / "group" / "robot";
+  const std::string large(10000, 'x');
+
+  rmf_task::BackupFileManager backup(backup_root_dir);
+  backup.clear_on_shutdown(false).compression(true, 1000);
+  auto group = backup.make_group("group");
+  auto robot_backup = group->make_robot("robot");
+
+  robot_backup->write(Backup::make(0, "small"));
+  CHECK(std::filesystem::file_size(robot_dir / "backup") == 5);
+  CHECK(robot_backup->read() == std::optional<std::string>("small"));
+
+  robot_backup->write(Backup::make(1, large));
+  CHECK(robot_backup->read() == std::optional<std::string>(large));
+  if (rmf_task::BackupFileManager::compression_available())
+    CHECK(std::filesystem::file_size(robot_dir / "backup") < large.size());
+
+  WHEN("The group raises its threshold")
+  {
+    group->compression_threshold(large.size() + 1);
+    robot_backup->write(Backup::make(2, large));
+    CHECK(std::filesystem::file_size(robot_dir / "backup") == large.size());
+    CHECK(robot_backup->read() == std::optional<std::string>(large));
+  }
+
+  WHEN("An uncompressed backup is read by a manager that compresses")
+  {
+    rmf_task::BackupFileManager plain(backup_root_dir);
+    plain.clear_on_shutdown(false);
+    plain.make_group("plain")->make_robot("robot")
+    ->write(Backup::make(0, large));
+
+    auto restored = backup.make_group("plain")->make_robot("robot");
+    CHECK(restored->read() == std::optional<std::string>(large));
+  }
+}
+
+SCENARIO("Restore a whole group")
+{
+  cleanup();
+
+  using Backup = rmf_task::Task::Active::Backup;
+  using Robot = rmf_task::BackupFileManager::Robot;
+
+  {
+    rmf_task::BackupFileManager backup(backup_root_dir);
+    backup.clear_on_shutdown(false);
+    auto group = backup.make_group("group");
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+      group->make_robot("robot_" + std::to_string(i))
+      ->write(Backup::make(0, "state " + std::to_string(i)));
+    }
+
+    // A robot without a backup is skipped
+    group->make_robot("empty");
+  }
+
+  rmf_task::BackupFileManager restarted(backup_root_dir);
+  auto group = restarted.make_group("group");
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::string> states;
+  std::vector<std::shared_ptr<Robot>> robots;
+  const auto restored = group->restore_all(
+    [&](const std::string& name, const std::shared_ptr<Robot>& robot,
+    std::string state)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      states[name] = std::move(state);
+      robots.push_back(robot);
+    }, 4);
+
+  CHECK(restored.size() == 20);
+  CHECK(states.size() == 20);
+  CHECK(states["robot_13"] == "state 13");
+  CHECK(states.count("empty") == 0);
+
+  WHEN("Restoring a robot fails")
+  {
+    CHECK_THROWS_AS(
+      group->restore_all(
+        [](const std::string&, const std::shared_ptr<Robot>&, std::string)
+        {
+          throw std::runtime_error("restore failed");
+        }),
+      std::runtime_error);
+  }
+}
+
+//==============================================================================
+class CollectingSink : public rmf_task::BackupFileManager::ReplicationSink
+{
+public:
+
+  void send(
+    const std::string& group,
+    const std::vector<Entry>& entries) final
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    groups.push_back(group);
+    batches.push_back(entries);
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> groups;
+  std::vector<std::vector<Entry>> batches;
+};
+
+SCENARIO("Replicate a group to a standby")
+{
+  cleanup();
+
+  using namespace std::chrono_literals;
+  using Backup = rmf_task::Task::Active::Backup;
+  using Robot = rmf_task::BackupFileManager::Robot;
+
+  const auto sink = std::make_shared<CollectingSink>();
+  {
+    rmf_task::BackupFileManager primary(backup_root_dir / "primary");
+    primary.clear_on_shutdown(false);
+    auto group = primary.make_group("group");
+    group->replicate(sink, 1h);
+
+    auto first = group->make_robot("robot_0");
+    auto second = group->make_robot("robot_1");
+    for (std::size_t i = 0; i < 5; ++i)
+      first->write(Backup::make(i, "state " + std::to_string(i)));
+    second->write(Backup::make(0, "other state"));
+
+    // Nothing is sent before the period is over
+    std::lock_guard<std::mutex> lock(sink->mutex);
+    CHECK(sink->batches.empty());
+  }
+
+  // Only the latest backup of each robot is sent, in one batch, once the
+  // group is destroyed
+  REQUIRE(sink->batches.size() == 1);
+  CHECK(sink->groups.front() == "group");
+  const auto& batch = sink->batches.front();
+  REQUIRE(batch.size() == 2);
+  CHECK(batch[0].robot == "robot_0");
+  CHECK(batch[0].sequence == 4);
+  REQUIRE(batch[0].state);
+  CHECK(*batch[0].state == "state 4");
+  CHECK(batch[1].robot == "robot_1");
+
+  rmf_task::BackupFileManager standby(backup_root_dir / "standby");
+  auto group = standby.make_group("group");
+  group->load(batch);
+
+  std::unordered_map<std::string, std::string> states;
+  const auto restored = group->restore_all(
+    [&](const std::string& name, const std::shared_ptr<Robot>&,
+    std::string state)
+    {
+      states[name] = std::move(state);
+    }, 1);
+
+  CHECK(restored.size() == 2);
+  CHECK(states["robot_0"] == "state 4");
+  CHECK(states["robot_1"] == "other state");
+}
@@ -16,17 +16,25 @@
 */
 
 #include <rmf_task/TaskPlanner.hpp>
+#include <rmf_task/CompactAssignments.hpp>
+#include <rmf_task/FleetCoordinator.hpp>
+#include <rmf_task/PlanBatcher.hpp>
+#include <rmf_task/PlannerService.hpp>
 #include <rmf_task/State.hpp>
 #include <rmf_task/Constraints.hpp>
+#include <rmf_task/CostFunction.hpp>
 #include <rmf_task/Parameters.hpp>
 #include <rmf_task/requests/Delivery.hpp>
 #include <rmf_task/requests/ChargeBattery.hpp>
 #include <rmf_task/requests/Loop.hpp>
+#include <rmf_task/requests/MultiStopDelivery.hpp>
+#include <rmf_task/requests/MultiZoneClean.hpp>
 
 #include <rmf_task/requests/ChargeBatteryFactory.hpp>
 #include <rmf_task/requests/ParkRobotFactory.hpp>
 
 #include <rmf_task/BinaryPriorityScheme.hpp>
+#include <rmf_task/IntegerPriorityScheme.hpp>
 
 #include <rmf_traffic/agv/Graph.hpp>
 #include <rmf_traffic/Trajectory.hpp>
@@ -44,7 +52,19 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include "src/rmf_task/PlanCapture.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 using TaskPlanner = rmf_task::TaskPlanner;
 
@@ -133,6 +153,54 @@ inline void display_solution(
   std::cout << " ----------------------" << std::endl;
 }
 
+//==============================================================================
+// The same objective as the BinaryPriorityCostCalculator without priorities:
+// how long after its earliest start time each request finishes
+class DelayCostFunction : public rmf_task::CostFunction
+{
+public:
+
+  double assignment_cost(
+    const Assignment& assignment,
+    const bool is_charging) const final
+  {
+    if (is_charging)
+      return 0.0;
+
+    return rmf_traffic::time::to_seconds(
+      assignment.finish_state().time().value()
+      - assignment.request()->booking()->earliest_start_time());
+  }
+
+  void evaluate_batch(
+    const NodeView* nodes,
+    const std::size_t count,
+    const rmf_traffic::Time,
+    Cost* costs) const final
+  {
+    ++batches;
+    largest_batch = std::max<std::size_t>(largest_batch, count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      // No request can finish before its best finish time
+      const auto& node = nodes[i];
+      double h = 0.0;
+      for (std::size_t u = 0; u < node.num_unassigned; ++u)
+      {
+        const auto earliest_start =
+          node.unassigned_requests[u]->booking()->earliest_start_time();
+        h += std::max(0.0, rmf_traffic::time::to_seconds(
+            node.unassigned_best_finish_times[u] - earliest_start));
+      }
+
+      costs[i] = Cost{node.accumulated_cost + h, h};
+    }
+  }
+
+  mutable std::atomic_size_t batches = 0;
+  mutable std::atomic_size_t largest_batch = 0;
+};
+
 //==============================================================================
 SCENARIO("Grid World")
 {
@@ -1089,6 +1157,61 @@ SCENARIO("Grid World")
     CHECK(index_map["4"] < index_map["3"]);
   }
 
+  WHEN("Planning for 1 robot with three levels of priority")
+  {
+    using rmf_task::IntegerPriorityScheme;
+    CHECK(IntegerPriorityScheme::make_priority(0) == nullptr);
+    CHECK(IntegerPriorityScheme::level(nullptr) == 0);
+    CHECK(IntegerPriorityScheme::level(
+        IntegerPriorityScheme::make_priority(3)) == 3);
+    CHECK(IntegerPriorityScheme::level(
+        rmf_task::BinaryPriorityScheme::make_high_priority()) == 1);
+
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0)
+    };
+
+    // The levels are listed against the order that the travel would prefer
+    const std::vector<std::pair<std::size_t, std::size_t>> routes =
+    {{12, 13}, {13, 14}, {0, 3}};
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t level = 0; level < routes.size(); ++level)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          routes[level].first, delivery_wait, routes[level].second,
+          delivery_wait, {{}}, std::to_string(level), now,
+          IntegerPriorityScheme::make_priority(level)));
+    }
+
+    auto priority_config = task_config;
+    priority_config.cost_calculator(
+      IntegerPriorityScheme::make_cost_calculator());
+    TaskPlanner task_planner(priority_config, default_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+
+    // Every task comes before the tasks of lower levels
+    std::vector<std::string> order;
+    for (const auto& a : assignments->front())
+    {
+      const bool is_charging = std::dynamic_pointer_cast<
+        const rmf_task::requests::ChargeBattery::Description>(
+        a.request()->description()) != nullptr;
+      if (!is_charging)
+        order.push_back(a.request()->booking()->id());
+    }
+    CHECK(order == std::vector<std::string>{"2", "1", "0"});
+  }
+
   WHEN(
     "Planning for 1 robot and 2 tasks per time segment with one priority task per segment")
   {
@@ -1613,6 +1736,117 @@ SCENARIO("Grid World")
 
   }
 
+  WHEN("Comparing the assignments of consecutive plans")
+  {
+    using Kind = TaskPlanner::AssignmentDiff::Kind;
+    const auto now = std::chrono::steady_clock::now();
+    const auto state =
+      rmf_task::State().load_basic({now, 13, 0.0}, 13, 1.0);
+    const auto assign = [&](const std::string& id)
+      {
+        return TaskPlanner::Assignment{
+          rmf_task::requests::Delivery::make(
+            0, delivery_wait, 3, delivery_wait, {{}}, id, now),
+          state, now};
+      };
+    const auto charge = [&]()
+      {
+        return TaskPlanner::Assignment{
+          rmf_task::requests::ChargeBattery::make(now), state, now};
+      };
+
+    const TaskPlanner::Assignments previous = {
+      {assign("1"), charge(), assign("2"), assign("3")},
+      {assign("4"), assign("5")}
+    };
+
+    CHECK(TaskPlanner::diff(previous, previous).empty());
+
+    // The charger is planned again with a new ID, "3" moves to the second
+    // agent, "5" is dropped and "6" is new
+    const TaskPlanner::Assignments next = {
+      {assign("1"), charge(), assign("2"), charge()},
+      {assign("4"), assign("3"), assign("6")}
+    };
+
+    const auto diff = TaskPlanner::diff(previous, next);
+    CHECK_FALSE(diff.empty());
+    REQUIRE(diff.agents.size() == 2);
+
+    const auto& first = diff.agents[0];
+    CHECK(first.unchanged_prefix == 3);
+    REQUIRE(first.changes.size() == 1);
+    CHECK(first.changes[0].kind == Kind::Charger);
+    CHECK(first.changes[0].index == 3);
+    CHECK(first.removed == std::vector<std::size_t>{3});
+
+    const auto& second = diff.agents[1];
+    CHECK(second.unchanged_prefix == 1);
+    REQUIRE(second.changes.size() == 2);
+    CHECK(second.changes[0].kind == Kind::Moved);
+    CHECK(second.changes[0].previous_agent == 0);
+    CHECK(second.changes[0].previous_index == 3);
+    CHECK(second.changes[1].kind == Kind::Added);
+    CHECK(second.removed == std::vector<std::size_t>{1});
+  }
+
+  WHEN("Agents share a pool of chargers")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double initial_soc = 0.3;
+    const double recharge_soc = 0.9;
+    const std::vector<std::size_t> pool = {0, 3, 12, 15};
+    rmf_task::TaskPlanner::Configuration pool_config{
+      parameters,
+      rmf_task::Constraints{0.2, recharge_soc, drain_battery},
+      cost_calculator};
+    pool_config.charger_pool(pool);
+    CHECK(pool_config.charger_pool() == pool);
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic({now, 13, 0.0}, 13, initial_soc),
+      rmf_task::State().load_basic({now, 2, 0.0}, 2, initial_soc)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        9, delivery_wait, 4, delivery_wait, {{}}, "3", now)
+    };
+
+    TaskPlanner task_planner(pool_config, default_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+
+    // Every charge happens at a charger of the pool, which then becomes the
+    // dedicated charger of the agent
+    std::size_t charges = 0;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& assignment : agent)
+      {
+        if (!std::dynamic_pointer_cast<
+            const rmf_task::requests::ChargeBattery::Description>(
+            assignment.request()->description()))
+          continue;
+
+        ++charges;
+        const auto& finish = assignment.finish_state();
+        CHECK(std::find(pool.begin(), pool.end(), finish.waypoint().value())
+          != pool.end());
+        CHECK(finish.dedicated_charging_waypoint() == finish.waypoint());
+      }
+    }
+    CHECK(charges > 0);
+  }
+
   WHEN("start_time for requests are earlier than time_now")
   {
     const auto now = std::chrono::steady_clock::now();
@@ -1864,6 +2098,9 @@ SCENARIO("Grid World")
           last_assignment.request()->description());
         CHECK(is_charge_request);
       }
+
+      // The agents share one model for their finishing requests
+      CHECK(task_planner.last_statistics().model_cache_hits >= 1);
     }
   }
 
@@ -1973,4 +2210,4321 @@ SCENARIO("Grid World")
     }
   }
 
+  WHEN("Planning with arena allocation")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Loop::make(
+        3,
+        4,
+        1,
+        "Loop1",
+        now + rmf_traffic::time::from_seconds(50))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    const double optimal_cost = task_planner.compute_cost(*optimal_assignments);
+
+    auto arena_options = default_options;
+    arena_options.arena_allocation(true);
+    CHECK(arena_options.arena_allocation());
+    CHECK_FALSE(default_options.arena_allocation());
+
+    const auto arena_result = task_planner.plan(
+      now, initial_states, requests, arena_options);
+    const auto arena_assignments = std::get_if<
+      TaskPlanner::Assignments>(&arena_result);
+    REQUIRE(arena_assignments);
+    CHECK_TIMES(*arena_assignments, now);
+    const double arena_cost = task_planner.compute_cost(*arena_assignments);
+    CHECK(arena_cost == Approx(optimal_cost));
+
+    auto greedy_arena_options = greedy_options;
+    greedy_arena_options.arena_allocation(true);
+    const auto greedy_result = task_planner.plan(
+      now, initial_states, requests, greedy_options);
+    const auto greedy_arena_result = task_planner.plan(
+      now, initial_states, requests, greedy_arena_options);
+    const auto greedy_assignments = std::get_if<
+      TaskPlanner::Assignments>(&greedy_result);
+    const auto greedy_arena_assignments = std::get_if<
+      TaskPlanner::Assignments>(&greedy_arena_result);
+    REQUIRE(greedy_assignments);
+    REQUIRE(greedy_arena_assignments);
+    CHECK(task_planner.compute_cost(*greedy_arena_assignments)
+      == Approx(task_planner.compute_cost(*greedy_assignments)));
+
+    // A planner that recycles its threads and arena buffers between plans
+    auto pooled_config = task_config;
+    pooled_config.worker_pool_size(4).arena_pool_capacity(1 << 20);
+    CHECK(pooled_config.worker_pool_size() == 4);
+    CHECK(pooled_config.arena_pool_capacity() == 1 << 20);
+    CHECK(task_config.worker_pool_size() == 0);
+
+    auto pooled_options = arena_options;
+    pooled_options.expansion_threads(2).initialization_threads(2);
+    TaskPlanner pooled_planner(pooled_config, pooled_options);
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      const auto pooled_result = pooled_planner.plan(
+        now, initial_states, requests);
+      const auto pooled_assignments = std::get_if<
+        TaskPlanner::Assignments>(&pooled_result);
+      REQUIRE(pooled_assignments);
+      CHECK_TIMES(*pooled_assignments, now);
+      CHECK(pooled_planner.compute_cost(*pooled_assignments)
+        == Approx(optimal_cost));
+    }
+  }
+
+  WHEN("Planning with parallel node expansion")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Loop::make(
+        3,
+        4,
+        1,
+        "Loop1",
+        now + rmf_traffic::time::from_seconds(50))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto serial_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto serial_assignments = std::get_if<
+      TaskPlanner::Assignments>(&serial_result);
+    REQUIRE(serial_assignments);
+    const double serial_cost = task_planner.compute_cost(*serial_assignments);
+
+    CHECK(default_options.expansion_threads() == 1);
+    for (const std::size_t threads : {2, 4, 0})
+    {
+      auto parallel_options = default_options;
+      parallel_options.expansion_threads(threads);
+      for (const bool arena : {false, true})
+      {
+        parallel_options.arena_allocation(arena);
+        const auto parallel_result = task_planner.plan(
+          now, initial_states, requests, parallel_options);
+        const auto parallel_assignments = std::get_if<
+          TaskPlanner::Assignments>(&parallel_result);
+        REQUIRE(parallel_assignments);
+        CHECK_TIMES(*parallel_assignments, now);
+        CHECK(task_planner.compute_cost(*parallel_assignments)
+          == Approx(serial_cost));
+      }
+    }
+  }
+
+  WHEN("Planning with the greedy and optimal searches as a portfolio")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Loop::make(
+        3,
+        4,
+        1,
+        "Loop1",
+        now + rmf_traffic::time::from_seconds(50))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    const double optimal_cost = task_planner.compute_cost(*optimal_assignments);
+
+    const auto greedy_result = task_planner.plan(
+      now, initial_states, requests, greedy_options);
+    const auto greedy_assignments = std::get_if<
+      TaskPlanner::Assignments>(&greedy_result);
+    REQUIRE(greedy_assignments);
+    const double greedy_cost = task_planner.compute_cost(*greedy_assignments);
+
+    auto portfolio_options = default_options;
+    portfolio_options.portfolio(true);
+    CHECK(portfolio_options.portfolio());
+    CHECK_FALSE(default_options.portfolio());
+
+    THEN("The portfolio finds the optimal solution when given enough time")
+    {
+      const auto result = task_planner.plan(
+        now, initial_states, requests, portfolio_options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+      CHECK(task_planner.compute_cost(*assignments) == Approx(optimal_cost));
+    }
+
+    THEN("The portfolio falls back on the greedy solution when interrupted")
+    {
+      portfolio_options.interrupter([]() { return true; });
+      const auto result = task_planner.plan(
+        now, initial_states, requests, portfolio_options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      std::size_t num_assigned = 0;
+      for (const auto& agent : *assignments)
+        num_assigned += agent.size();
+      CHECK(num_assigned >= requests.size());
+
+      const double cost = task_planner.compute_cost(*assignments);
+      CHECK(cost >= Approx(optimal_cost));
+      CHECK(cost <= Approx(greedy_cost));
+    }
+  }
+
+  WHEN("Planning with an anytime search")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    const double optimal_cost = task_planner.compute_cost(*optimal_assignments);
+    REQUIRE(task_planner.last_suboptimality_bound().has_value());
+    CHECK(*task_planner.last_suboptimality_bound() == Approx(1.0));
+
+    const auto greedy_result = task_planner.plan(
+      now, initial_states, requests, greedy_options);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&greedy_result));
+    CHECK_FALSE(task_planner.last_suboptimality_bound().has_value());
+
+    auto anytime_options = default_options;
+    anytime_options.anytime(true);
+    CHECK(anytime_options.anytime());
+    CHECK_FALSE(default_options.anytime());
+
+    THEN("The anytime search converges on the optimal solution")
+    {
+      const auto result = task_planner.plan(
+        now, initial_states, requests, anytime_options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+      CHECK(task_planner.compute_cost(*assignments) == Approx(optimal_cost));
+      REQUIRE(task_planner.last_suboptimality_bound().has_value());
+      CHECK(*task_planner.last_suboptimality_bound() == Approx(1.0));
+    }
+
+    THEN("The anytime search returns its best solution when interrupted")
+    {
+      std::size_t count = 0;
+      anytime_options.interrupter([&count]() { return ++count > 20; });
+      const auto result = task_planner.plan(
+        now, initial_states, requests, anytime_options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      std::size_t num_assigned = 0;
+      for (const auto& agent : *assignments)
+        num_assigned += agent.size();
+      CHECK(num_assigned >= requests.size());
+
+      const auto bound = task_planner.last_suboptimality_bound();
+      REQUIRE(bound.has_value());
+      CHECK(*bound >= 1.0);
+      CHECK(task_planner.compute_cost(*assignments)
+        <= Approx(*bound * optimal_cost));
+    }
+  }
+
+  WHEN("Replanning after requests are added and cancelled")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto first_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto first_assignments = std::get_if<
+      TaskPlanner::Assignments>(&first_result);
+    REQUIRE(first_assignments);
+
+    const std::vector<rmf_task::ConstRequestPtr> new_requests =
+    {
+      rmf_task::requests::Delivery::make(
+        4,
+        delivery_wait,
+        10,
+        delivery_wait,
+        {{}},
+        "4",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    const std::unordered_set<std::string> cancelled = {"2"};
+
+    // The same set of requests planned from scratch
+    const std::vector<rmf_task::ConstRequestPtr> expected_requests =
+    {
+      requests[0],
+      requests[2],
+      new_requests[0]
+    };
+
+    const auto count_ids = [](const TaskPlanner::Assignments& assignments)
+      {
+        std::unordered_map<std::string, std::size_t> ids;
+        for (const auto& agent : assignments)
+        {
+          for (const auto& a : agent)
+          {
+            if (!a.request()->booking()->automatic())
+              ++ids[a.request()->booking()->id()];
+          }
+        }
+        return ids;
+      };
+
+    THEN("The optimal replan matches an optimal plan from scratch")
+    {
+      const auto scratch_result = task_planner.plan(
+        now, initial_states, expected_requests);
+      const auto scratch_assignments = std::get_if<
+        TaskPlanner::Assignments>(&scratch_result);
+      REQUIRE(scratch_assignments);
+
+      const auto replan_result = task_planner.replan(
+        now, initial_states, *first_assignments, new_requests, cancelled);
+      const auto replan_assignments = std::get_if<
+        TaskPlanner::Assignments>(&replan_result);
+      REQUIRE(replan_assignments);
+      CHECK_TIMES(*replan_assignments, now);
+
+      const auto ids = count_ids(*replan_assignments);
+      CHECK(ids.size() == 3);
+      CHECK(ids.count("1") == 1);
+      CHECK(ids.count("2") == 0);
+      CHECK(ids.count("3") == 1);
+      CHECK(ids.count("4") == 1);
+
+      CHECK(task_planner.compute_cost(*replan_assignments)
+        == Approx(task_planner.compute_cost(*scratch_assignments)));
+    }
+
+    THEN("The greedy replan is no worse than a greedy plan from scratch")
+    {
+      const auto scratch_result = task_planner.plan(
+        now, initial_states, expected_requests, greedy_options);
+      const auto scratch_assignments = std::get_if<
+        TaskPlanner::Assignments>(&scratch_result);
+      REQUIRE(scratch_assignments);
+
+      const auto replan_result = task_planner.replan(
+        now, initial_states, *first_assignments, new_requests, cancelled,
+        greedy_options);
+      const auto replan_assignments = std::get_if<
+        TaskPlanner::Assignments>(&replan_result);
+      REQUIRE(replan_assignments);
+      CHECK_TIMES(*replan_assignments, now);
+      CHECK(count_ids(*replan_assignments).size() == 3);
+
+      CHECK(task_planner.compute_cost(*replan_assignments)
+        <= Approx(task_planner.compute_cost(*scratch_assignments)));
+    }
+
+    THEN("Pinned assignments are kept at the front of the replan")
+    {
+      auto pinned_options = greedy_options;
+      pinned_options.pinned_assignments(1);
+      CHECK(pinned_options.pinned_assignments() == 1);
+
+      const auto replan_result = task_planner.replan(
+        now, initial_states, *first_assignments, new_requests, cancelled,
+        pinned_options);
+      const auto replan_assignments = std::get_if<
+        TaskPlanner::Assignments>(&replan_result);
+      REQUIRE(replan_assignments);
+      REQUIRE(replan_assignments->size() == first_assignments->size());
+      CHECK(count_ids(*replan_assignments).size() == 3);
+
+      for (std::size_t a = 0; a < first_assignments->size(); ++a)
+      {
+        // The cancelled request cannot be pinned
+        const auto& previous = (*first_assignments)[a];
+        if (previous.empty()
+          || previous.front().request()->booking()->id() == "2")
+          continue;
+
+        const auto& agent = (*replan_assignments)[a];
+        REQUIRE(!agent.empty());
+        CHECK(agent.front().request() == previous.front().request());
+        CHECK(agent.front().finish_state().time()
+          == previous.front().finish_state().time());
+        CHECK(agent.front().deployment_time()
+          == previous.front().deployment_time());
+      }
+
+      // A horizon before every deployment pins nothing
+      auto horizon_options = greedy_options;
+      horizon_options.pinned_horizon(now - std::chrono::hours(1));
+      const auto unpinned_result = task_planner.replan(
+        now, initial_states, *first_assignments, new_requests, cancelled,
+        horizon_options);
+      const auto unpinned_assignments = std::get_if<
+        TaskPlanner::Assignments>(&unpinned_result);
+      REQUIRE(unpinned_assignments);
+      CHECK(count_ids(*unpinned_assignments).size() == 3);
+    }
+  }
+
+  WHEN("Planning with a weighted heuristic")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "4",
+        now + rmf_traffic::time::from_seconds(50000)),
+
+      rmf_task::requests::Delivery::make(
+        10,
+        delivery_wait,
+        0,
+        delivery_wait,
+        {{}},
+        "5",
+        now + rmf_traffic::time::from_seconds(50000)),
+
+      rmf_task::requests::Delivery::make(
+        4,
+        delivery_wait,
+        8,
+        delivery_wait,
+        {{}},
+        "6",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        14,
+        delivery_wait,
+        {{}},
+        "7",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        5,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "8",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        9,
+        delivery_wait,
+        0,
+        delivery_wait,
+        {{}},
+        "9",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        1,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "10",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        12,
+        delivery_wait,
+        {{}},
+        "11",
+        now + rmf_traffic::time::from_seconds(60000))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    const double optimal_cost = task_planner.compute_cost(*optimal_assignments);
+
+    auto weighted_options = default_options;
+    CHECK(weighted_options.heuristic_weight() == Approx(1.0));
+    CHECK_THROWS_AS(
+      weighted_options.heuristic_weight(0.5), std::invalid_argument);
+
+    const double weight = 2.0;
+    weighted_options.heuristic_weight(weight);
+    CHECK(weighted_options.heuristic_weight() == Approx(weight));
+
+    const auto weighted_result = task_planner.plan(
+      now, initial_states, requests, weighted_options);
+    const auto weighted_assignments = std::get_if<
+      TaskPlanner::Assignments>(&weighted_result);
+    REQUIRE(weighted_assignments);
+    CHECK_TIMES(*weighted_assignments, now);
+
+    const double weighted_cost =
+      task_planner.compute_cost(*weighted_assignments);
+    CHECK(weighted_cost >= Approx(optimal_cost));
+    CHECK(weighted_cost <= Approx(weight * optimal_cost));
+
+    const auto bound = task_planner.last_suboptimality_bound();
+    REQUIRE(bound.has_value());
+    CHECK(*bound >= 1.0);
+    CHECK(*bound <= Approx(weight));
+  }
+
+  WHEN("Planning with a limited open list")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "4",
+        now + rmf_traffic::time::from_seconds(50000)),
+
+      rmf_task::requests::Delivery::make(
+        10,
+        delivery_wait,
+        0,
+        delivery_wait,
+        {{}},
+        "5",
+        now + rmf_traffic::time::from_seconds(50000)),
+
+      rmf_task::requests::Delivery::make(
+        4,
+        delivery_wait,
+        8,
+        delivery_wait,
+        {{}},
+        "6",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        14,
+        delivery_wait,
+        {{}},
+        "7",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        5,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "8",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        9,
+        delivery_wait,
+        0,
+        delivery_wait,
+        {{}},
+        "9",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        1,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "10",
+        now + rmf_traffic::time::from_seconds(60000)),
+
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        12,
+        delivery_wait,
+        {{}},
+        "11",
+        now + rmf_traffic::time::from_seconds(60000))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    const double optimal_cost = task_planner.compute_cost(*optimal_assignments);
+
+    auto limited_options = default_options;
+    CHECK(limited_options.max_open_nodes() == 0);
+    limited_options.max_open_nodes(4);
+    CHECK(limited_options.max_open_nodes() == 4);
+
+    const auto limited_result = task_planner.plan(
+      now, initial_states, requests, limited_options);
+    const auto limited_assignments = std::get_if<
+      TaskPlanner::Assignments>(&limited_result);
+    REQUIRE(limited_assignments);
+    CHECK_TIMES(*limited_assignments, now);
+
+    std::size_t num_assigned = 0;
+    for (const auto& agent : *limited_assignments)
+    {
+      for (const auto& a : agent)
+      {
+        if (!a.request()->booking()->automatic())
+          ++num_assigned;
+      }
+    }
+    CHECK(num_assigned == requests.size());
+
+    const double limited_cost = task_planner.compute_cost(*limited_assignments);
+    CHECK(limited_cost >= Approx(optimal_cost));
+
+    const auto bound = task_planner.last_suboptimality_bound();
+    if (bound.has_value())
+    {
+      CHECK(*bound >= 1.0);
+      CHECK(limited_cost <= Approx(*bound * optimal_cost));
+    }
+  }
+
+  WHEN("Planning with each type of filter")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "4",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+    CHECK(default_options.filter_type() == TaskPlanner::FilterType::Hash);
+
+    std::vector<double> costs;
+    for (const auto type : {
+        TaskPlanner::FilterType::Passthrough,
+        TaskPlanner::FilterType::Trie,
+        TaskPlanner::FilterType::Hash})
+    {
+      auto options = default_options;
+      options.filter_type(type);
+      CHECK(options.filter_type() == type);
+
+      const auto result = task_planner.plan(
+        now, initial_states, requests, options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+      costs.push_back(task_planner.compute_cost(*assignments));
+    }
+
+    CHECK(costs[1] == Approx(costs[0]));
+    CHECK(costs[2] == Approx(costs[0]));
+  }
+
+  WHEN("Estimating the finish of a task from several initial states")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+    rmf_traffic::agv::Plan::Start third_location{now, 9, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0),
+      rmf_task::State().load_basic(third_location, 9, 0.21)
+    };
+
+    const auto request = rmf_task::requests::Delivery::make(
+      0,
+      delivery_wait,
+      3,
+      delivery_wait,
+      {{}},
+      "1",
+      now);
+
+    const auto model = request->description()->make_model(now, parameters);
+    const rmf_task::TravelEstimator travel_estimator(parameters);
+
+    const auto batch = model->estimate_finish_batch(
+      initial_states, constraints, travel_estimator);
+    REQUIRE(batch.size() == initial_states.size());
+
+    for (std::size_t i = 0; i < initial_states.size(); ++i)
+    {
+      const auto single = model->estimate_finish(
+        initial_states[i], constraints, travel_estimator);
+      REQUIRE(single.has_value() == batch[i].has_value());
+      if (!single.has_value())
+        continue;
+
+      CHECK(single->wait_until() == batch[i]->wait_until());
+      CHECK(single->finish_state().time().value()
+        == batch[i]->finish_state().time().value());
+      CHECK(single->finish_state().battery_soc().value()
+        == Approx(batch[i]->finish_state().battery_soc().value()));
+    }
+  }
+
+  WHEN("Planning with parallel initialization")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        8,
+        delivery_wait,
+        11,
+        delivery_wait,
+        {{}},
+        "4",
+        now + rmf_traffic::time::from_seconds(50000)),
+
+      rmf_task::requests::Delivery::make(
+        10,
+        delivery_wait,
+        0,
+        delivery_wait,
+        {{}},
+        "5",
+        now + rmf_traffic::time::from_seconds(50000))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto serial_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto serial_assignments = std::get_if<
+      TaskPlanner::Assignments>(&serial_result);
+    REQUIRE(serial_assignments);
+
+    auto parallel_options = default_options;
+    CHECK(parallel_options.initialization_threads() == 1);
+    parallel_options.initialization_threads(4);
+    CHECK(parallel_options.initialization_threads() == 4);
+
+    const auto parallel_result = task_planner.plan(
+      now, initial_states, requests, parallel_options);
+    const auto parallel_assignments = std::get_if<
+      TaskPlanner::Assignments>(&parallel_result);
+    REQUIRE(parallel_assignments);
+    CHECK_TIMES(*parallel_assignments, now);
+
+    CHECK(task_planner.compute_cost(*parallel_assignments)
+      == Approx(task_planner.compute_cost(*serial_assignments)));
+
+    REQUIRE(parallel_assignments->size() == serial_assignments->size());
+    for (std::size_t i = 0; i < serial_assignments->size(); ++i)
+    {
+      const auto& serial = (*serial_assignments)[i];
+      const auto& parallel = (*parallel_assignments)[i];
+      REQUIRE(parallel.size() == serial.size());
+      for (std::size_t j = 0; j < serial.size(); ++j)
+      {
+        CHECK(parallel[j].request()->booking()->id()
+          == serial[j].request()->booking()->id());
+      }
+    }
+  }
+
+  WHEN("Planning with decomposition on a connected graph")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    auto decompose_options = default_options;
+    CHECK_FALSE(decompose_options.decompose());
+    decompose_options.decompose(true);
+    CHECK(decompose_options.decompose());
+
+    // Every agent can reach every request, so there is only one cluster and
+    // the plan should be unchanged
+    const auto decomposed_result = task_planner.plan(
+      now, initial_states, requests, decompose_options);
+    const auto decomposed_assignments = std::get_if<
+      TaskPlanner::Assignments>(&decomposed_result);
+    REQUIRE(decomposed_assignments);
+    CHECK_TIMES(*decomposed_assignments, now);
+    CHECK(task_planner.compute_cost(*decomposed_assignments)
+      == Approx(task_planner.compute_cost(*assignments)));
+  }
+
+  WHEN("Collecting statistics about a plan")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(50000))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+    CHECK(task_planner.last_statistics().nodes_expanded == 0);
+
+    const auto result = task_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&result));
+
+    const auto first = task_planner.last_statistics();
+    CHECK(first.segments == 2);
+    CHECK(first.nodes_expanded > 0);
+    CHECK(first.nodes_generated >= first.filter_rejections);
+    CHECK(first.peak_open_nodes > 0);
+    CHECK(first.estimate_finish_calls >= requests.size() * 2);
+    CHECK(first.travel_estimator_misses > 0);
+    CHECK(first.initialization_time > rmf_traffic::Duration(0));
+    CHECK(first.search_time > rmf_traffic::Duration(0));
+    CHECK(first.node_bytes > 0);
+    CHECK(first.candidate_bytes > 0);
+    CHECK(first.filter_bytes > 0);
+    CHECK(first.open_list_bytes > 0);
+    CHECK(first.bytes_per_node > 0.0);
+
+    // The travel estimates are memoized, so planning the same problem again
+    // should not need any new travel plans
+    task_planner.plan(now, initial_states, requests);
+    const auto& second = task_planner.last_statistics();
+    CHECK(second.segments == first.segments);
+    CHECK(second.nodes_expanded == first.nodes_expanded);
+    CHECK(second.travel_estimator_misses == 0);
+    CHECK(second.travel_estimator_hits > 0);
+  }
+
+  WHEN("Planning requests that start beyond the planning horizon")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Loop::make(
+        0, 15, 1, "Loop1", now + std::chrono::hours(2)),
+      rmf_task::requests::Loop::make(
+        3, 4, 1, "Loop2", now + std::chrono::hours(3)),
+      rmf_task::requests::Loop::make(
+        7, 9, 1, "Loop3", now + std::chrono::hours(4))
+    };
+
+    auto options = default_options;
+    options.planning_horizon(std::chrono::hours(1));
+    CHECK(options.planning_horizon() == std::chrono::hours(1));
+
+    TaskPlanner task_planner(task_config, options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+
+    std::size_t assigned = 0;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& a : agent)
+      {
+        if (a.request()->booking()->id().rfind("Loop", 0) == 0)
+          ++assigned;
+      }
+    }
+    CHECK(assigned == requests.size());
+
+    // Placeholder segments carry no guarantee on their solution
+    CHECK(task_planner.last_statistics().deferred_segments > 0);
+    CHECK_FALSE(task_planner.last_suboptimality_bound().has_value());
+
+    // With a horizon that covers every request, nothing gets deferred
+    options.planning_horizon(std::chrono::hours(8));
+    task_planner = TaskPlanner(task_config, options);
+    task_planner.plan(now, initial_states, requests);
+    CHECK(task_planner.last_statistics().deferred_segments == 0);
+    CHECK(task_planner.last_suboptimality_bound().has_value());
+  }
+
+  WHEN("Batching bursts of requests")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const std::vector<std::pair<std::size_t, std::size_t>> routes =
+    {{0, 3}, {15, 2}, {7, 9}, {8, 11}};
+
+    std::mutex mutex;
+    std::vector<rmf_task::PlanBatcher::Batch> batches;
+    const auto window = std::chrono::milliseconds(50);
+    auto batcher = std::make_unique<rmf_task::PlanBatcher>(
+      TaskPlanner(task_config, default_options),
+      [&]() { return initial_states; },
+      [&](rmf_task::PlanBatcher::Batch batch)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        batches.push_back(std::move(batch));
+      },
+      window);
+
+    for (std::size_t i = 0; i < routes.size(); ++i)
+    {
+      batcher->submit(
+        rmf_task::requests::Delivery::make(
+          routes[i].first, delivery_wait, routes[i].second, delivery_wait,
+          {{}}, std::to_string(i), now));
+    }
+
+    // The burst lands in a single batch
+    batcher->wait_until_idle();
+    CHECK(batcher->plans_started() == 1);
+    CHECK(batcher->plans_superseded() == 0);
+    CHECK(batcher->outstanding() == routes.size());
+    CHECK(batcher->pending() == 0);
+    REQUIRE(batches.size() == 1);
+    CHECK(batches[0].new_requests == routes.size());
+    CHECK(batches[0].requests.size() == routes.size());
+    CHECK(batches[0].queueing_latency >= window);
+    CHECK(batches[0].planning_latency > rmf_traffic::Duration(0));
+    const auto assignments =
+      std::get_if<TaskPlanner::Assignments>(&batches[0].result);
+    REQUIRE(assignments);
+    CHECK(assignments->size() == initial_states.size());
+
+    // Retired requests are left out of the next plan
+    CHECK(batcher->retire("0"));
+    CHECK_FALSE(batcher->retire("0"));
+    batcher->flush();
+    batcher->wait_until_idle();
+    REQUIRE(batches.size() == 2);
+    CHECK(batches[1].new_requests == 0);
+    CHECK(batches[1].requests.size() == routes.size() - 1);
+
+    // A size limit closes the batch without waiting for the window
+    batcher = std::make_unique<rmf_task::PlanBatcher>(
+      TaskPlanner(task_config, default_options),
+      [&]() { return initial_states; },
+      [&](rmf_task::PlanBatcher::Batch batch)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        batches.push_back(std::move(batch));
+      },
+      std::chrono::hours(1), 2);
+
+    batcher->submit(
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "a", now));
+    batcher->submit(
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "b", now));
+    batcher->wait_until_idle();
+    CHECK(batcher->plans_started() == 1);
+    REQUIRE(batches.size() == 3);
+    CHECK(batches[2].new_requests == 2);
+    CHECK(batches[2].queueing_latency < std::chrono::hours(1));
+  }
+
+  WHEN("Replaying a captured plan")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 0.8)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0),
+        rmf_task::BinaryPriorityScheme::make_high_priority()),
+
+      rmf_task::requests::Loop::make(
+        15,
+        2,
+        3,
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::ChargeBattery::make(
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    const auto capture_path = (std::filesystem::temp_directory_path()
+      / "rmf_task_test_plan_capture.txt").string();
+
+    auto options = default_options;
+    options.capture_path(capture_path);
+    TaskPlanner task_planner(task_config, options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    std::ifstream file(capture_path);
+    REQUIRE(file);
+    auto capture = rmf_task::read_plan_capture(file);
+    CHECK(capture.warnings.empty());
+    CHECK(capture.time_now == now);
+    CHECK(capture.initial_states.size() == initial_states.size());
+    CHECK(capture.requests.size() == requests.size());
+    CHECK_FALSE(capture.options.greedy());
+    REQUIRE(capture.configuration.has_value());
+
+    TaskPlanner replay_planner(*capture.configuration, capture.options);
+    const auto replay = replay_planner.plan(
+      capture.time_now, capture.initial_states, capture.requests);
+    const auto* replay_assignments =
+      std::get_if<TaskPlanner::Assignments>(&replay);
+    REQUIRE(replay_assignments);
+    REQUIRE(replay_assignments->size() == assignments->size());
+    for (std::size_t a = 0; a < assignments->size(); ++a)
+    {
+      const auto& original = (*assignments)[a];
+      const auto& replayed = (*replay_assignments)[a];
+      REQUIRE(replayed.size() == original.size());
+      for (std::size_t i = 0; i < original.size(); ++i)
+      {
+        CHECK(replayed[i].request()->booking()->id()
+          == original[i].request()->booking()->id());
+        CHECK(replayed[i].finish_state().time()
+          == original[i].finish_state().time());
+      }
+    }
+
+    std::filesystem::remove(capture_path);
+  }
+
+  WHEN("Planning with branch and bound")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Loop::make(
+        4,
+        11,
+        2,
+        "4",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    auto bounded_options = default_options;
+    CHECK_FALSE(bounded_options.branch_and_bound());
+    bounded_options.branch_and_bound(true);
+    CHECK(bounded_options.branch_and_bound());
+
+    const auto bounded_result = task_planner.plan(
+      now, initial_states, requests, bounded_options);
+    const auto bounded_assignments = std::get_if<
+      TaskPlanner::Assignments>(&bounded_result);
+    REQUIRE(bounded_assignments);
+    CHECK_TIMES(*bounded_assignments, now);
+
+    // Pruning against the bound must not give up optimality
+    CHECK(task_planner.compute_cost(*bounded_assignments)
+      == Approx(task_planner.compute_cost(*assignments)));
+    REQUIRE(task_planner.last_suboptimality_bound().has_value());
+    CHECK(*task_planner.last_suboptimality_bound() == Approx(1.0));
+  }
+
+  WHEN("Planning with symmetry breaking for equivalent agents")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start bay_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start other_location{now, 2, default_orientation};
+
+    // The first three agents wait at the same charging bay
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(bay_location, 13, 1.0),
+      rmf_task::State().load_basic(bay_location, 13, 1.0),
+      rmf_task::State().load_basic(bay_location, 13, 1.0),
+      rmf_task::State().load_basic(other_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Loop::make(
+        4,
+        11,
+        2,
+        "4",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    const auto unbroken = task_planner.last_statistics();
+
+    auto symmetry_options = default_options;
+    CHECK_FALSE(symmetry_options.symmetry_breaking());
+    CHECK(symmetry_options.symmetry_tolerance() == Approx(0.0));
+    symmetry_options.symmetry_breaking(true);
+    CHECK(symmetry_options.symmetry_breaking());
+
+    const auto symmetric_result = task_planner.plan(
+      now, initial_states, requests, symmetry_options);
+    const auto symmetric_assignments = std::get_if<
+      TaskPlanner::Assignments>(&symmetric_result);
+    REQUIRE(symmetric_assignments);
+    CHECK_TIMES(*symmetric_assignments, now);
+
+    // Skipping equivalent branches must not change the cost of the plan, but
+    // it should spare the search some work
+    CHECK(task_planner.compute_cost(*symmetric_assignments)
+      == Approx(task_planner.compute_cost(*assignments)));
+    CHECK(task_planner.last_statistics().nodes_generated
+      < unbroken.nodes_generated);
+  }
+
+  WHEN("Planning with a time budget")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(0))
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    auto budget_options = default_options;
+    CHECK_FALSE(budget_options.time_budget().has_value());
+
+    // A generous budget does not change the plan
+    budget_options.time_budget(rmf_traffic::time::from_seconds(60.0));
+    const auto generous_result = task_planner.plan(
+      now, initial_states, requests, budget_options);
+    const auto generous_assignments = std::get_if<
+      TaskPlanner::Assignments>(&generous_result);
+    REQUIRE(generous_assignments);
+    CHECK(task_planner.compute_cost(*generous_assignments)
+      == Approx(task_planner.compute_cost(*assignments)));
+
+    // Without any budget, neither search has time to find a plan
+    budget_options.time_budget(rmf_traffic::Duration(0));
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests, budget_options);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    CHECK(optimal_assignments->empty());
+
+    budget_options.greedy(true);
+    const auto greedy_result = task_planner.plan(
+      now, initial_states, requests, budget_options);
+    const auto greedy_assignments = std::get_if<
+      TaskPlanner::Assignments>(&greedy_result);
+    REQUIRE(greedy_assignments);
+    CHECK(greedy_assignments->empty());
+  }
+
+  WHEN("Planning with regret insertion")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+    rmf_traffic::agv::Plan::Start third_location{now, 9, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0),
+      rmf_task::State().load_basic(third_location, 9, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> deliveries =
+    {
+      {0, 3}, {15, 2}, {7, 9}, {8, 14}, {1, 12}, {6, 11}, {3, 5}, {10, 4}
+    };
+
+    for (std::size_t i = 0; i < deliveries.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          deliveries[i].first,
+          delivery_wait,
+          deliveries[i].second,
+          delivery_wait,
+          {{}},
+          std::to_string(i + 1),
+          now + rmf_traffic::time::from_seconds(0)));
+    }
+
+    auto regret_options = greedy_options;
+    CHECK(regret_options.regret_insertion() < 2);
+    regret_options.regret_insertion(2);
+    CHECK(regret_options.regret_insertion() == 2);
+
+    TaskPlanner task_planner(task_config, regret_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+
+    std::unordered_set<std::string> assigned_ids;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& a : agent)
+        assigned_ids.insert(a.request()->booking()->id());
+    }
+
+    for (const auto& request : requests)
+      CHECK(assigned_ids.count(request->booking()->id()) == 1);
+
+    // No heuristic can beat the optimal plan
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests, default_options);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    CHECK(task_planner.compute_cost(*optimal_assignments)
+      <= Approx(task_planner.compute_cost(*assignments)));
+  }
+
+  WHEN("Planning with approximate candidates")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        7, delivery_wait, 9, delivery_wait, {{}}, "3", now),
+      rmf_task::requests::Delivery::make(
+        8, delivery_wait, 14, delivery_wait, {{}}, "4", now)
+    };
+
+    // Straight lines never take longer than the planned paths
+    const auto straight_line =
+      rmf_task::TravelEstimator::straight_line(parameters);
+    const rmf_task::TravelEstimator exact_estimator(parameters);
+    const rmf_traffic::agv::Plan::Start start(now, 13, 0.0);
+    const rmf_traffic::agv::Plan::Goal goal(3);
+    const auto approximate = straight_line->estimate(start, goal);
+    const auto exact = exact_estimator.estimate(start, goal);
+    REQUIRE(approximate.has_value());
+    REQUIRE(exact.has_value());
+    CHECK(approximate->duration() == straight_line->lower_bound(13, 3));
+    CHECK(approximate->duration() <= exact->duration());
+
+    auto approximate_options = default_options;
+    CHECK(approximate_options.approximate_candidates() == 0);
+    approximate_options.approximate_candidates(3);
+    CHECK(approximate_options.approximate_candidates() == 3);
+
+    TaskPlanner task_planner(task_config, approximate_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+    CHECK_FALSE(task_planner.last_suboptimality_bound().has_value());
+
+    std::unordered_set<std::string> assigned_ids;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& a : agent)
+        assigned_ids.insert(a.request()->booking()->id());
+    }
+
+    for (const auto& request : requests)
+      CHECK(assigned_ids.count(request->booking()->id()) == 1);
+
+    // The candidates are estimated exactly, so the plan is a real one that
+    // cannot beat the optimal plan
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests, default_options);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    CHECK(task_planner.compute_cost(*optimal_assignments)
+      <= Approx(task_planner.compute_cost(*assignments)));
+  }
+
+  WHEN("Planning patrols that are scheduled apart")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> patrols =
+    {
+      {0, 3}, {15, 2}, {7, 9}, {8, 14}, {1, 12}, {6, 11}
+    };
+
+    for (std::size_t i = 0; i < patrols.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Loop::make(
+          patrols[i].first,
+          patrols[i].second,
+          1,
+          std::to_string(i + 1),
+          now + rmf_traffic::time::from_seconds(120.0 * i)));
+    }
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    CHECK_TIMES(*optimal_assignments, now);
+    CHECK(task_planner.last_suboptimality_bound().value_or(0.0) == Approx(1.0));
+    const double optimal_cost =
+      task_planner.compute_cost(*optimal_assignments);
+
+    // The heuristic must stay admissible, so no other plan can be cheaper
+    for (auto options : {greedy_options, default_options})
+    {
+      options.heuristic_weight(1.0).filter_type(
+        TaskPlanner::FilterType::Passthrough);
+      const auto result = task_planner.plan(
+        now, initial_states, requests, options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK(optimal_cost <= Approx(task_planner.compute_cost(*assignments)));
+    }
+  }
+
+  WHEN("Planning requests that depend on each other")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const auto make_request = [&](
+      const std::string& id,
+      std::size_t start,
+      std::size_t finish,
+      std::vector<std::string> dependencies)
+      {
+        auto booking = std::make_shared<rmf_task::Task::Booking>(
+          id, now, nullptr);
+        booking->dependencies(std::move(dependencies));
+        return std::make_shared<rmf_task::Request>(
+          std::move(booking),
+          rmf_task::requests::Loop::Description::make(start, finish, 1));
+      };
+
+    // Replenishing a station must finish before anything is picked from it
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      make_request("pick", 0, 3, {"replenish"}),
+      make_request("replenish", 15, 2, {}),
+      make_request("deliver", 7, 9, {"pick"}),
+      make_request("patrol", 8, 14, {})
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+    for (const auto& options : {default_options, greedy_options})
+    {
+      const auto result = task_planner.plan(
+        now, initial_states, requests, options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      std::unordered_map<std::string, const TaskPlanner::Assignment*> planned;
+      for (const auto& agent : *assignments)
+      {
+        for (const auto& a : agent)
+          planned[a.request()->booking()->id()] = &a;
+      }
+
+      REQUIRE(planned.size() >= requests.size());
+      CHECK(planned.at("replenish")->finish_state().time().value()
+        <= planned.at("pick")->deployment_time());
+      CHECK(planned.at("pick")->finish_state().time().value()
+        <= planned.at("deliver")->deployment_time());
+    }
+
+    // A cycle of dependencies can never be planned
+    requests.push_back(make_request("first", 1, 12, {"second"}));
+    requests.push_back(make_request("second", 6, 11, {"first"}));
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto error = std::get_if<TaskPlanner::TaskPlannerError>(&result);
+    REQUIRE(error);
+    CHECK(*error == TaskPlanner::TaskPlannerError::cyclic_dependencies);
+  }
+
+  WHEN("Breaking ties between nodes in the open list")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Loop::make(0, 3, 1, "1", now),
+      rmf_task::requests::Loop::make(15, 2, 1, "2", now),
+      rmf_task::requests::Loop::make(7, 9, 1, "3", now),
+      rmf_task::requests::Loop::make(8, 14, 1, "4", now),
+      rmf_task::requests::Loop::make(1, 12, 1, "5", now)
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto expected_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto expected = std::get_if<
+      TaskPlanner::Assignments>(&expected_result);
+    REQUIRE(expected);
+    const double expected_cost = task_planner.compute_cost(*expected);
+
+    // The order of equal nodes must never change the cost of the solution
+    for (const auto tie_break :
+      {TaskPlanner::TieBreak::Cost, TaskPlanner::TieBreak::Depth})
+    {
+      auto options = default_options;
+      options.tie_break(tie_break);
+      CHECK(options.tie_break() == tie_break);
+
+      const auto result = task_planner.plan(
+        now, initial_states, requests, options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+      CHECK(task_planner.compute_cost(*assignments) == Approx(expected_cost));
+
+      // A limited open list keeps working with the new order
+      options.max_open_nodes(4);
+      const auto limited_result = task_planner.plan(
+        now, initial_states, requests, options);
+      REQUIRE(std::get_if<TaskPlanner::Assignments>(&limited_result));
+    }
+  }
+
+  WHEN("Expanding nodes partially")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Loop::make(0, 3, 1, "1", now),
+      rmf_task::requests::Loop::make(15, 2, 1, "2", now),
+      rmf_task::requests::Loop::make(7, 9, 1, "3", now),
+      rmf_task::requests::Loop::make(8, 14, 1, "4", now),
+      rmf_task::requests::Loop::make(1, 12, 1, "5", now),
+      rmf_task::requests::Loop::make(6, 11, 1, "6", now)
+    };
+
+    CHECK_THROWS_AS(
+      TaskPlanner::Options(false).partial_expansion(-1.0),
+      std::invalid_argument);
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto full_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto full = std::get_if<TaskPlanner::Assignments>(&full_result);
+    REQUIRE(full);
+    const double full_cost = task_planner.compute_cost(*full);
+    const auto full_peak = task_planner.last_statistics().peak_open_nodes;
+
+    for (const double margin : {0.0, 30.0})
+    {
+      auto options = default_options;
+      options.partial_expansion(margin);
+      REQUIRE(options.partial_expansion().has_value());
+
+      const auto result = task_planner.plan(
+        now, initial_states, requests, options);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      // The search is still optimal, and it keeps fewer nodes open
+      CHECK(task_planner.compute_cost(*assignments) == Approx(full_cost));
+      CHECK(task_planner.last_suboptimality_bound().value_or(0.0)
+        == Approx(1.0));
+      CHECK(task_planner.last_statistics().peak_open_nodes <= full_peak);
+    }
+  }
+
+  WHEN("Planning with a sequential auction")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+    rmf_traffic::agv::Plan::Start third_location{now, 9, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0),
+      rmf_task::State().load_basic(third_location, 9, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> deliveries =
+    {
+      {0, 3}, {15, 2}, {7, 9}, {8, 14}, {1, 12}, {6, 11}, {3, 5}, {10, 4}
+    };
+
+    for (std::size_t i = 0; i < deliveries.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          deliveries[i].first,
+          delivery_wait,
+          deliveries[i].second,
+          delivery_wait,
+          {{}},
+          std::to_string(i + 1),
+          now + rmf_traffic::time::from_seconds(10 * (i % 3))));
+    }
+
+    auto auction_options = default_options;
+    CHECK_FALSE(auction_options.auction());
+    auction_options.auction(true);
+    CHECK(auction_options.auction());
+
+    TaskPlanner task_planner(task_config, auction_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK_TIMES(*assignments, now);
+    CHECK_FALSE(task_planner.last_suboptimality_bound().has_value());
+
+    std::unordered_set<std::string> assigned_ids;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& a : agent)
+        assigned_ids.insert(a.request()->booking()->id());
+    }
+
+    for (const auto& request : requests)
+      CHECK(assigned_ids.count(request->booking()->id()) == 1);
+
+    // Each step only expands the task that is up for auction
+    CHECK(task_planner.last_statistics().nodes_expanded == requests.size());
+
+    const auto optimal_result = task_planner.plan(
+      now, initial_states, requests, default_options);
+    const auto optimal_assignments = std::get_if<
+      TaskPlanner::Assignments>(&optimal_result);
+    REQUIRE(optimal_assignments);
+    CHECK(task_planner.compute_cost(*optimal_assignments)
+      <= Approx(task_planner.compute_cost(*assignments)));
+  }
+
+  WHEN("Refining a greedy plan")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+    rmf_traffic::agv::Plan::Start third_location{now, 9, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0),
+      rmf_task::State().load_basic(third_location, 9, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> deliveries =
+    {
+      {0, 3}, {15, 2}, {7, 9}, {8, 14}, {1, 12}, {6, 11}, {3, 5}, {10, 4}
+    };
+
+    for (std::size_t i = 0; i < deliveries.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          deliveries[i].first,
+          delivery_wait,
+          deliveries[i].second,
+          delivery_wait,
+          {{}},
+          std::to_string(i + 1),
+          now + rmf_traffic::time::from_seconds(0)));
+    }
+
+    TaskPlanner task_planner(task_config, greedy_options);
+    const auto greedy_result = task_planner.plan(
+      now, initial_states, requests);
+    const auto greedy_assignments = std::get_if<
+      TaskPlanner::Assignments>(&greedy_result);
+    REQUIRE(greedy_assignments);
+
+    auto refine_options = greedy_options;
+    CHECK_FALSE(refine_options.refinement_time().has_value());
+    CHECK(refine_options.refinement_threads() == 1);
+    refine_options.refinement_time(rmf_traffic::time::from_seconds(0.5));
+    refine_options.refinement_threads(2);
+
+    const auto refined_result = task_planner.plan(
+      now, initial_states, requests, refine_options);
+    const auto refined_assignments = std::get_if<
+      TaskPlanner::Assignments>(&refined_result);
+    REQUIRE(refined_assignments);
+    CHECK_TIMES(*refined_assignments, now);
+
+    std::unordered_set<std::string> assigned_ids;
+    for (const auto& agent : *refined_assignments)
+    {
+      for (const auto& a : agent)
+        assigned_ids.insert(a.request()->booking()->id());
+    }
+
+    for (const auto& request : requests)
+      CHECK(assigned_ids.count(request->booking()->id()) == 1);
+
+    // Only improvements are kept
+    CHECK(task_planner.compute_cost(*refined_assignments)
+      <= Approx(task_planner.compute_cost(*greedy_assignments)));
+  }
+
+  WHEN("Planning with a custom cost function")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> routes =
+    {{0, 3}, {15, 2}, {7, 9}, {8, 11}, {5, 6}};
+    for (std::size_t i = 0; i < routes.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          routes[i].first, delivery_wait, routes[i].second, delivery_wait,
+          {{}}, std::to_string(i), now));
+    }
+
+    CHECK_THROWS_AS(
+      rmf_task::CostFunction::make_cost_calculator(nullptr),
+      std::invalid_argument);
+
+    const auto function = std::make_shared<DelayCostFunction>();
+    auto custom_config = task_config;
+    custom_config.cost_calculator(
+      rmf_task::CostFunction::make_cost_calculator(function));
+
+    TaskPlanner reference_planner(task_config, default_options);
+    const auto reference = reference_planner.plan(
+      now, initial_states, requests);
+    const auto reference_assignments =
+      std::get_if<TaskPlanner::Assignments>(&reference);
+    REQUIRE(reference_assignments);
+
+    for (const std::size_t threads : {1, 2})
+    {
+      auto options = default_options;
+      options.expansion_threads(threads);
+      TaskPlanner custom_planner(custom_config, options);
+      const auto result = custom_planner.plan(now, initial_states, requests);
+      const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      // The heuristic is admissible, so the plan is just as good
+      CHECK(custom_planner.compute_cost(*assignments)
+        == Approx(reference_planner.compute_cost(*reference_assignments)));
+      CHECK(reference_planner.compute_cost(*assignments)
+        == Approx(custom_planner.compute_cost(*assignments)));
+    }
+
+    // The children of each expanded node were evaluated together
+    CHECK(function->batches > 0);
+    CHECK(function->largest_batch > 1);
+  }
+
+  WHEN("Planning deterministically on several threads")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    // Mirrored deliveries give many plans of equal cost
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> routes =
+    {{0, 3}, {3, 0}, {12, 15}, {15, 12}, {5, 6}, {6, 5}};
+    for (std::size_t i = 0; i < routes.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          routes[i].first, delivery_wait, routes[i].second, delivery_wait,
+          {{}}, std::to_string(i), now));
+    }
+
+    auto options = default_options;
+    CHECK_FALSE(options.deterministic());
+    options.deterministic(true);
+    options.portfolio(true);
+    options.expansion_threads(2);
+    options.initialization_threads(2);
+
+    using Sequence = std::vector<std::pair<std::string, rmf_traffic::Time>>;
+    const auto sequences = [](const TaskPlanner::Assignments& assignments)
+      {
+        std::vector<Sequence> output;
+        for (const auto& agent : assignments)
+        {
+          auto& sequence = output.emplace_back();
+          for (const auto& a : agent)
+          {
+            sequence.push_back(
+              {a.request()->booking()->id(),
+                a.finish_state().time().value()});
+          }
+        }
+
+        return output;
+      };
+
+    std::optional<std::vector<Sequence>> reference;
+    for (std::size_t attempt = 0; attempt < 5; ++attempt)
+    {
+      // A fresh planner each time, so that no plan comes from the cache
+      TaskPlanner task_planner(task_config, options);
+      const auto result = task_planner.plan(now, initial_states, requests);
+      const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      if (!reference.has_value())
+        reference = sequences(*assignments);
+      else
+        CHECK(sequences(*assignments) == *reference);
+    }
+  }
+
+  WHEN("Streaming the assignments of each segment")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0,
+        delivery_wait,
+        3,
+        delivery_wait,
+        {{}},
+        "1",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        15,
+        delivery_wait,
+        2,
+        delivery_wait,
+        {{}},
+        "2",
+        now + rmf_traffic::time::from_seconds(0)),
+
+      rmf_task::requests::Delivery::make(
+        7,
+        delivery_wait,
+        9,
+        delivery_wait,
+        {{}},
+        "3",
+        now + rmf_traffic::time::from_seconds(50000))
+    };
+
+    std::vector<TaskPlanner::Assignments> segments;
+    auto streaming_options = default_options;
+    CHECK_FALSE(streaming_options.segment_callback());
+    streaming_options.segment_callback(
+      [&segments](const TaskPlanner::Assignments& segment)
+      {
+        segments.push_back(segment);
+      });
+
+    TaskPlanner task_planner(task_config, streaming_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<
+      TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    // The late request is planned in its own segment
+    REQUIRE(segments.size() == 2);
+    std::unordered_set<std::string> first_ids;
+    for (const auto& agent : segments.front())
+    {
+      for (const auto& a : agent)
+        first_ids.insert(a.request()->booking()->id());
+    }
+    CHECK(first_ids.count("1") == 1);
+    CHECK(first_ids.count("2") == 1);
+    CHECK(first_ids.count("3") == 0);
+
+    // Together the segments make up the final plan
+    for (std::size_t i = 0; i < assignments->size(); ++i)
+    {
+      std::vector<std::string> streamed;
+      for (const auto& segment : segments)
+      {
+        REQUIRE(segment.size() == assignments->size());
+        for (const auto& a : segment[i])
+          streamed.push_back(a.request()->booking()->id());
+      }
+
+      std::vector<std::string> planned;
+      for (const auto& a : (*assignments)[i])
+        planned.push_back(a.request()->booking()->id());
+
+      CHECK(streamed == planned);
+    }
+  }
+
+  WHEN("Computing the costs of many sets of assignments")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    const std::vector<std::pair<std::size_t, std::size_t>> deliveries =
+    {
+      {0, 3}, {15, 2}, {7, 9}, {8, 14}, {1, 12}
+    };
+
+    // Plan an increasing number of the requests so that every set of
+    // assignments has a different cost
+    TaskPlanner task_planner(task_config, greedy_options);
+    std::vector<TaskPlanner::Assignments> plans;
+    for (std::size_t i = 0; i < deliveries.size(); ++i)
+    {
+      requests.push_back(
+        rmf_task::requests::Delivery::make(
+          deliveries[i].first,
+          delivery_wait,
+          deliveries[i].second,
+          delivery_wait,
+          {{}},
+          std::to_string(i + 1),
+          now + rmf_traffic::time::from_seconds(0)));
+
+      const auto result = task_planner.plan(now, initial_states, requests);
+      const auto assignments = std::get_if<
+        TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      plans.push_back(*assignments);
+    }
+
+    std::vector<const TaskPlanner::Assignments*> batch;
+    for (const auto& plan : plans)
+      batch.push_back(&plan);
+
+    for (const std::size_t num_threads : {1, 2, 8})
+    {
+      const auto costs = task_planner.compute_costs(batch, num_threads);
+      REQUIRE(costs.size() == plans.size());
+      for (std::size_t i = 0; i < plans.size(); ++i)
+        CHECK(costs[i] == Approx(task_planner.compute_cost(plans[i])));
+    }
+
+    CHECK(task_planner.compute_costs({}, 4).empty());
+  }
+
+  WHEN("Planning asynchronously")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        7, delivery_wait, 9, delivery_wait, {{}}, "3", now)
+    };
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto expected_result =
+      task_planner.plan(now, initial_states, requests);
+    const auto expected =
+      std::get_if<TaskPlanner::Assignments>(&expected_result);
+    REQUIRE(expected);
+    const auto expected_statistics = task_planner.last_statistics();
+
+    std::atomic_size_t segments = 0;
+    auto plan = task_planner.plan_async(
+      now, initial_states, requests, std::nullopt,
+      [&](const TaskPlanner::Assignments&) { ++segments; });
+
+    // Several plans can run at the same time
+    auto greedy_plan = task_planner.plan_async(
+      now, initial_states, requests, greedy_options);
+
+    const auto result = plan.result().get();
+    const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+    CHECK(segments > 0);
+    CHECK_FALSE(plan.cancelled());
+    CHECK(task_planner.compute_cost(*assignments)
+      == Approx(task_planner.compute_cost(*expected)));
+
+    const auto greedy_result = greedy_plan.result().get();
+    CHECK(std::get_if<TaskPlanner::Assignments>(&greedy_result));
+
+    // The background plans do not touch the statistics of this planner
+    CHECK(task_planner.last_statistics().nodes_expanded
+      == expected_statistics.nodes_expanded);
+
+    auto cancelled_plan = task_planner.plan_async(
+      now, initial_states, requests);
+    cancelled_plan.cancel();
+    CHECK(cancelled_plan.cancelled());
+    CHECK(cancelled_plan.result().wait_for(std::chrono::seconds(30))
+      == std::future_status::ready);
+  }
+
+  WHEN("Planning on several threads with one planner")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        7, delivery_wait, 9, delivery_wait, {{}}, "3", now)
+    };
+
+    TaskPlanner reference_planner(task_config, default_options);
+    const auto expected_result =
+      reference_planner.plan(now, initial_states, requests);
+    const auto expected =
+      std::get_if<TaskPlanner::Assignments>(&expected_result);
+    REQUIRE(expected);
+    const double expected_cost = reference_planner.compute_cost(*expected);
+
+    TaskPlanner task_planner(task_config, default_options);
+    std::vector<std::optional<double>> costs(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < costs.size(); ++i)
+    {
+      threads.emplace_back(
+        [&, i]()
+        {
+          const auto result = task_planner.plan(now, initial_states, requests);
+          if (const auto* a = std::get_if<TaskPlanner::Assignments>(&result))
+            costs[i] = task_planner.compute_cost(*a);
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    for (const auto& cost : costs)
+    {
+      REQUIRE(cost.has_value());
+      CHECK(*cost == Approx(expected_cost));
+    }
+
+    CHECK(task_planner.last_statistics().nodes_expanded > 0);
+  }
+
+  WHEN("Caching the results of identical plans")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now)
+    };
+
+    auto cached_config = task_config;
+    cached_config.plan_cache_capacity(10);
+    CHECK(cached_config.plan_cache_capacity() == 10);
+    CHECK(task_config.plan_cache_capacity() == 0);
+
+    TaskPlanner task_planner(cached_config, default_options);
+    const auto first_result = task_planner.plan(now, initial_states, requests);
+    const auto first = std::get_if<TaskPlanner::Assignments>(&first_result);
+    REQUIRE(first);
+    CHECK_FALSE(task_planner.last_statistics().plan_cache_hit);
+    CHECK(task_planner.last_statistics().nodes_expanded > 0);
+
+    // The same inputs within the time resolution reuse the result
+    const auto second_result = task_planner.plan(
+      now + std::chrono::milliseconds(1), initial_states, requests);
+    const auto second = std::get_if<TaskPlanner::Assignments>(&second_result);
+    REQUIRE(second);
+    CHECK(task_planner.last_statistics().plan_cache_hit);
+    CHECK(task_planner.last_statistics().nodes_expanded == 0);
+    CHECK(task_planner.compute_cost(*second)
+      == Approx(task_planner.compute_cost(*first)));
+
+    // A hit assigns the requests of its own caller
+    const std::vector<rmf_task::ConstRequestPtr> same_requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now)
+    };
+    const auto third_result =
+      task_planner.plan(now, initial_states, same_requests);
+    const auto third = std::get_if<TaskPlanner::Assignments>(&third_result);
+    REQUIRE(third);
+    CHECK(task_planner.last_statistics().plan_cache_hit);
+    for (const auto& agent : *third)
+    {
+      for (const auto& assignment : agent)
+      {
+        if (assignment.request()->booking()->automatic())
+          continue;
+
+        CHECK(std::find(
+            same_requests.begin(), same_requests.end(), assignment.request())
+          != same_requests.end());
+      }
+    }
+
+    // Different options need a new search
+    task_planner.plan(now, initial_states, requests, greedy_options);
+    CHECK_FALSE(task_planner.last_statistics().plan_cache_hit);
+
+    // So do different states
+    initial_states[0].battery_soc(0.9);
+    task_planner.plan(now, initial_states, requests);
+    CHECK_FALSE(task_planner.last_statistics().plan_cache_hit);
+
+    // Plans with an interrupter are never cached
+    auto interrupted_options = default_options;
+    interrupted_options.interrupter([]() { return false; });
+    task_planner.plan(now, initial_states, requests, interrupted_options);
+    task_planner.plan(now, initial_states, requests, interrupted_options);
+    CHECK_FALSE(task_planner.last_statistics().plan_cache_hit);
+  }
+
+  WHEN("Coordinating the assignments of several fleets")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    const std::vector<rmf_task::FleetCoordinator::Fleet> fleets =
+    {
+      {"fleet_a", task_config,
+        {rmf_task::State().load_basic(first_location, 13, 1.0)}},
+      {"fleet_b", task_config,
+        {rmf_task::State().load_basic(second_location, 2, 1.0)}}
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        7, delivery_wait, 9, delivery_wait, {{}}, "3", now),
+      rmf_task::requests::Delivery::make(
+        8, delivery_wait, 14, delivery_wait, {{}}, "4", now)
+    };
+
+    rmf_task::FleetCoordinator coordinator(fleets, default_options, 2);
+    REQUIRE(coordinator.num_fleets() == 2);
+    CHECK(coordinator.agents(1).size() == 1);
+    CHECK_THROWS_AS(coordinator.planner(2), std::out_of_range);
+
+    const auto result = coordinator.assign(now, requests);
+    REQUIRE(result.assignments.size() == 2);
+    REQUIRE(result.costs.size() == 2);
+    CHECK(result.unassigned.empty());
+
+    // Every request is assigned to exactly one agent of one fleet
+    std::unordered_map<std::string, std::size_t> ids;
+    for (std::size_t f = 0; f < result.assignments.size(); ++f)
+    {
+      CHECK(result.costs[f] == Approx(
+          coordinator.planner(f).compute_cost(result.assignments[f])));
+
+      CHECK_TIMES(result.assignments[f], now);
+      for (const auto& agent : result.assignments[f])
+      {
+        for (const auto& assignment : agent)
+        {
+          if (!assignment.request()->booking()->automatic())
+            ++ids[assignment.request()->booking()->id()];
+        }
+      }
+    }
+
+    REQUIRE(ids.size() == requests.size());
+    for (const auto& [id, count] : ids)
+      CHECK(count == 1);
+
+    // Planning both fleets as one cannot do better than the optimal plan
+    TaskPlanner joint_planner(task_config, default_options);
+    const auto joint_result = joint_planner.plan(
+      now,
+      {fleets[0].agents[0], fleets[1].agents[0]},
+      requests);
+    const auto joint = std::get_if<TaskPlanner::Assignments>(&joint_result);
+    REQUIRE(joint);
+    CHECK(joint_planner.compute_cost(*joint)
+      <= Approx(result.costs[0] + result.costs[1]));
+  }
+
+  WHEN("Evaluating the insertion of a new request into a plan")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now),
+      rmf_task::requests::Delivery::make(
+        7, delivery_wait, 9, delivery_wait, {{}}, "3", now)
+    };
+
+    TaskPlanner task_planner(task_config, greedy_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    const auto new_request = rmf_task::requests::Delivery::make(
+      8, delivery_wait, 14, delivery_wait, {{}}, "4", now);
+
+    const auto insertion = task_planner.evaluate_insertion(
+      now, initial_states, *assignments, new_request);
+    REQUIRE(insertion.has_value());
+
+    std::size_t total = 0;
+    for (const auto& agent : insertion->assignments)
+      total += agent.size();
+    CHECK(total == requests.size() + 1);
+
+    REQUIRE(insertion->agent < insertion->assignments.size());
+    const auto& agent = insertion->assignments[insertion->agent];
+    REQUIRE(insertion->position < agent.size());
+    CHECK(agent[insertion->position].request() == new_request);
+
+    CHECK(insertion->cost
+      == Approx(task_planner.compute_cost(insertion->assignments)));
+    CHECK(insertion->additional_cost
+      == Approx(insertion->cost - task_planner.compute_cost(*assignments)));
+    CHECK(insertion->additional_cost >= 0.0);
+
+    // Inserting into an empty plan gives the request to one of the agents
+    const TaskPlanner::Assignments empty(initial_states.size());
+    const auto first = task_planner.evaluate_insertion(
+      now, initial_states, empty, new_request);
+    REQUIRE(first.has_value());
+    CHECK(first->position == 0);
+    CHECK(first->assignments[first->agent].size() == 1);
+
+    CHECK_THROWS_AS(
+      task_planner.evaluate_insertion(now, initial_states, {}, new_request),
+      std::invalid_argument);
+  }
+
+  WHEN("Sharing a travel estimator between threads")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator travel_estimator(parameters);
+
+    // Every thread estimates the same pairs of waypoints, so each pair should
+    // be calculated once and every other estimate should be served by the
+    // cache, even if it arrives while the calculation is still running
+    const std::size_t num_waypoints = 16;
+    const std::size_t num_threads = 4;
+    std::vector<std::vector<std::optional<rmf_traffic::Duration>>> durations(
+      num_threads);
+
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t)
+    {
+      threads.emplace_back(
+        [&, t]()
+        {
+          for (std::size_t start = 0; start < num_waypoints; ++start)
+          {
+            for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+            {
+              const auto result = travel_estimator.estimate(
+                rmf_traffic::agv::Plan::Start(now, start, 0.0),
+                rmf_traffic::agv::Plan::Goal(goal));
+
+              if (result.has_value())
+                durations[t].push_back(result->duration());
+              else
+                durations[t].push_back(std::nullopt);
+            }
+          }
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    for (std::size_t t = 1; t < num_threads; ++t)
+      CHECK(durations[t] == durations.front());
+
+    const std::size_t num_pairs = num_waypoints * num_waypoints;
+    CHECK(travel_estimator.cache_hits() + travel_estimator.cache_misses()
+      == num_threads * num_pairs);
+    CHECK(travel_estimator.cache_misses() == num_pairs);
+
+    // Once every pair is cached, estimating them again only produces hits
+    const std::size_t misses = travel_estimator.cache_misses();
+    for (std::size_t start = 0; start < num_waypoints; ++start)
+    {
+      travel_estimator.estimate(
+        rmf_traffic::agv::Plan::Start(now, start, 0.0),
+        rmf_traffic::agv::Plan::Goal(num_waypoints - 1 - start));
+    }
+    CHECK(travel_estimator.cache_misses() == misses);
+  }
+
+  WHEN("Loading a precomputed travel table")
+  {
+    const auto table_path = (std::filesystem::temp_directory_path()
+      / "rmf_task_test_travel_table.bin").string();
+
+    rmf_task::TravelEstimator::build_table(parameters, table_path, 2);
+
+    const rmf_task::TravelEstimator lazy_estimator(parameters);
+    const rmf_task::TravelEstimator table_estimator(parameters, table_path);
+
+    const std::size_t num_waypoints = graph.num_waypoints();
+    for (std::size_t start = 0; start < num_waypoints; ++start)
+    {
+      for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+      {
+        const rmf_traffic::agv::Plan::Start from(
+          rmf_traffic::Time(), start, 0.0);
+        const auto expected = lazy_estimator.estimate(
+          from, rmf_traffic::agv::Plan::Goal(goal));
+        const auto loaded = table_estimator.estimate(
+          from, rmf_traffic::agv::Plan::Goal(goal));
+
+        REQUIRE(expected.has_value() == loaded.has_value());
+        if (!expected.has_value())
+          continue;
+
+        CHECK(expected->duration() == loaded->duration());
+        CHECK(expected->change_in_charge()
+          == Approx(loaded->change_in_charge()));
+      }
+    }
+
+    // Every estimate was answered by the table
+    CHECK(table_estimator.cache_hits() == num_waypoints * num_waypoints);
+    CHECK(table_estimator.cache_misses() == 0);
+
+    // A table cannot be used with different parameters
+    const rmf_task::Parameters heavier_parameters{
+      planner,
+      battery_system,
+      std::make_shared<SimpleMotionPowerSink>(
+        battery_system, *MechanicalSystem::make(90.0, 40.0, 0.22)),
+      device_sink};
+    CHECK_THROWS_AS(
+      rmf_task::TravelEstimator(heavier_parameters, table_path),
+      std::runtime_error);
+
+    std::filesystem::remove(table_path);
+    CHECK_THROWS_AS(
+      rmf_task::TravelEstimator(parameters, table_path),
+      std::runtime_error);
+  }
+
+  WHEN("Persisting the travel estimate cache")
+  {
+    const auto cache_path = (std::filesystem::temp_directory_path()
+      / "rmf_task_test_travel_cache.bin").string();
+    std::filesystem::remove(cache_path);
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto estimate_all = [&](const rmf_task::TravelEstimator& estimator)
+      {
+        for (std::size_t start = 0; start < 4; ++start)
+        {
+          for (std::size_t goal = 0; goal < 4; ++goal)
+          {
+            estimator.estimate(
+              rmf_traffic::agv::Plan::Start(now, start, 0.0),
+              rmf_traffic::agv::Plan::Goal(goal));
+          }
+        }
+      };
+
+    {
+      rmf_task::TravelEstimator estimator(parameters);
+      CHECK(estimator.load_cache(cache_path) == 0);
+      estimate_all(estimator);
+      CHECK(estimator.save_cache(cache_path) == 16);
+    }
+
+    {
+      rmf_task::TravelEstimator estimator(parameters);
+      CHECK(estimator.load_cache(cache_path) == 16);
+      estimate_all(estimator);
+      CHECK(estimator.cache_misses() == 0);
+      CHECK(estimator.cache_hits() == 16);
+    }
+
+    // A snapshot for different parameters is discarded
+    const rmf_task::Parameters heavier_parameters{
+      planner,
+      battery_system,
+      std::make_shared<SimpleMotionPowerSink>(
+        battery_system, *MechanicalSystem::make(90.0, 40.0, 0.22)),
+      device_sink};
+    {
+      rmf_task::TravelEstimator estimator(heavier_parameters);
+      CHECK(estimator.load_cache(cache_path) == 0);
+    }
+
+    // A persisted cache is saved when the estimator is destroyed
+    std::filesystem::remove(cache_path);
+    {
+      rmf_task::TravelEstimator estimator(parameters);
+      estimator.persist_cache(cache_path, std::chrono::hours(1));
+      CHECK_THROWS_AS(
+        estimator.persist_cache(cache_path, std::chrono::hours(1)),
+        std::runtime_error);
+      estimate_all(estimator);
+    }
+
+    {
+      rmf_task::TravelEstimator estimator(parameters);
+      estimator.persist_cache(cache_path, std::chrono::hours(1));
+      CHECK(estimator.cache_hits() == 0);
+      estimate_all(estimator);
+      CHECK(estimator.cache_misses() == 0);
+    }
+
+    std::filesystem::remove(cache_path);
+  }
+
+  WHEN("Limiting the capacity of the travel estimate cache")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const auto estimator =
+      std::make_shared<rmf_task::TravelEstimator>(parameters);
+    CHECK_FALSE(estimator->cache_capacity().has_value());
+
+    estimator->cache_capacity(20);
+    REQUIRE(estimator->cache_capacity().has_value());
+    CHECK(*estimator->cache_capacity() == 20);
+
+    std::vector<std::optional<rmf_traffic::Duration>> first;
+    const std::size_t num_waypoints = graph.num_waypoints();
+    for (std::size_t start = 0; start < num_waypoints; ++start)
+    {
+      for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+      {
+        const auto result = estimator->estimate(
+          rmf_traffic::agv::Plan::Start(now, start, 0.0),
+          rmf_traffic::agv::Plan::Goal(goal));
+        first.push_back(
+          result ? std::optional(result->duration()) : std::nullopt);
+        CHECK(estimator->cache_size() <= 20);
+      }
+    }
+
+    CHECK(estimator->cache_evictions() > 0);
+    CHECK(estimator->cache_memory() > 0);
+
+    // Evicted estimates are calculated again with the same results
+    std::size_t i = 0;
+    for (std::size_t start = 0; start < num_waypoints; ++start)
+    {
+      for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+      {
+        const auto result = estimator->estimate(
+          rmf_traffic::agv::Plan::Start(now, start, 0.0),
+          rmf_traffic::agv::Plan::Goal(goal));
+        CHECK(first[i++]
+          == (result ? std::optional(result->duration()) : std::nullopt));
+      }
+    }
+
+    // Lowering the capacity evicts right away
+    estimator->cache_capacity(5);
+    CHECK(estimator->cache_size() <= 5);
+
+    // The planner can use an estimator that has been configured this way
+    auto shared_config = task_config;
+    CHECK_FALSE(shared_config.travel_estimator());
+    shared_config.travel_estimator(estimator);
+    CHECK(shared_config.travel_estimator() == estimator);
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now)
+    };
+
+    const std::size_t misses = estimator->cache_misses();
+    TaskPlanner task_planner(shared_config, greedy_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&result));
+    CHECK(estimator->cache_misses() > misses);
+    CHECK(estimator->cache_size() <= 5);
+  }
+
+  WHEN("Prefetching travel estimates")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator estimator(parameters);
+
+    std::vector<rmf_traffic::agv::Plan::Start> starts;
+    for (const std::size_t wp : {13, 2})
+      starts.push_back(rmf_traffic::agv::Plan::Start(now, wp, 0.0));
+
+    std::vector<rmf_traffic::agv::Plan::Goal> goals;
+    for (const std::size_t wp : {0, 3, 15, 2, 7})
+      goals.push_back(rmf_traffic::agv::Plan::Goal(wp));
+
+    auto done = estimator.prefetch(starts, goals);
+    REQUIRE_NOTHROW(done.get());
+    CHECK(estimator.cache_size() == starts.size() * goals.size());
+    CHECK(estimator.cache_hits() == 0);
+    CHECK(estimator.cache_misses() == 0);
+
+    for (const auto& start : starts)
+    {
+      for (const auto& goal : goals)
+        estimator.estimate(start, goal);
+    }
+
+    CHECK(estimator.cache_hits() == starts.size() * goals.size());
+    CHECK(estimator.cache_misses() == 0);
+
+    // Prefetching pairs that are already memoized finishes right away
+    done = estimator.prefetch(starts, goals);
+    REQUIRE_NOTHROW(done.get());
+    CHECK(estimator.cache_size() == starts.size() * goals.size());
+
+    done = estimator.prefetch({}, goals);
+    CHECK(done.wait_for(std::chrono::seconds(0))
+      == std::future_status::ready);
+  }
+
+  WHEN("Estimating travel by the time of day")
+  {
+    const auto midnight = std::chrono::steady_clock::now();
+    const auto rush_hour = midnight + std::chrono::hours(8);
+    rmf_task::TravelEstimator estimator(parameters);
+
+    const rmf_traffic::agv::Plan::Start rush_start(rush_hour, 13, 0.0);
+    const rmf_traffic::agv::Plan::Start quiet_start(
+      rush_hour + std::chrono::hours(2), 13, 0.0);
+    const rmf_traffic::agv::Plan::Goal goal(3);
+    const auto usual = estimator.estimate(rush_start, goal);
+    REQUIRE(usual.has_value());
+
+    const auto profile =
+      std::make_shared<rmf_task::TravelProfile>(24, midnight);
+    CHECK(profile->bucket_length() == std::chrono::hours(1));
+    CHECK(profile->bucket(rush_hour) == 8);
+    CHECK(profile->bucket(midnight - std::chrono::minutes(30)) == 23);
+    CHECK(profile->bucket(rush_hour + std::chrono::hours(24)) == 8);
+    CHECK_THROWS_AS(
+      profile->set(13, 3, 24, std::chrono::seconds(1), 0.0),
+      std::out_of_range);
+
+    // Two congested trips were observed during the rush hour
+    const auto congested = usual->duration() * 2;
+    profile->record(13, 3, rush_hour, congested - std::chrono::seconds(10),
+      usual->change_in_charge());
+    profile->record(
+      13, 3, rush_hour + std::chrono::minutes(20),
+      congested + std::chrono::seconds(10), usual->change_in_charge());
+    const auto entry = profile->find(13, 3, rush_hour);
+    REQUIRE(entry.has_value());
+    CHECK(entry->samples == 2);
+    CHECK(entry->duration == congested);
+    CHECK(profile->num_pairs() == 1);
+    CHECK(profile->memory() > 0);
+
+    estimator.profile(profile);
+    CHECK(estimator.profile() == profile);
+    const auto hits = estimator.cache_hits();
+    const auto rush = estimator.estimate(rush_start, goal);
+    REQUIRE(rush.has_value());
+    CHECK(rush->duration() == congested);
+    CHECK(estimator.cache_hits() == hits + 1);
+
+    // Buckets without any values are estimated as usual
+    const auto quiet = estimator.estimate(quiet_start, goal);
+    REQUIRE(quiet.has_value());
+    CHECK(quiet->duration() == usual->duration());
+
+    const auto batch = estimator.estimate(
+      rush_start, std::vector<rmf_traffic::agv::Plan::Goal>{goal});
+    REQUIRE(batch.front().has_value());
+    CHECK(batch.front()->duration() == congested);
+
+    estimator.profile(nullptr);
+    CHECK(estimator.estimate(rush_start, goal)->duration()
+      == usual->duration());
+  }
+
+  WHEN("Estimating travel with a hierarchy of the graph")
+  {
+    CHECK_THROWS_AS(
+      rmf_task::TravelEstimator::hierarchical(parameters, 0),
+      std::invalid_argument);
+    CHECK_THROWS_AS(
+      rmf_task::TravelEstimator::hierarchical(parameters, 4, 0.0),
+      std::invalid_argument);
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto hierarchical =
+      rmf_task::TravelEstimator::hierarchical(parameters, 4, 0.5);
+    const rmf_task::TravelEstimator exact(parameters);
+    CHECK(hierarchical->hierarchy_memory() > 0);
+    CHECK(exact.hierarchy_memory() == 0);
+
+    // The hierarchy does not count turning, so its answers are only close to
+    // the planned ones
+    for (const std::size_t start_wp : {0, 5, 13})
+    {
+      const rmf_traffic::agv::Plan::Start start(now, start_wp, 0.0);
+      for (const std::size_t goal_wp : {3, 7, 15})
+      {
+        const rmf_traffic::agv::Plan::Goal goal(goal_wp);
+        const auto expected = exact.estimate(start, goal);
+        const auto result = hierarchical->estimate(start, goal);
+        REQUIRE(result.has_value() == expected.has_value());
+        if (!expected.has_value())
+          continue;
+
+        CHECK(rmf_traffic::time::to_seconds(result->duration())
+          == Approx(rmf_traffic::time::to_seconds(expected->duration()))
+          .epsilon(0.5));
+      }
+    }
+
+    // Only the trips that the hierarchy could not answer were memoized
+    CHECK(hierarchical->cache_size() < 9);
+  }
+
+  WHEN("Evaluating the battery drain of the same leg twice")
+  {
+    class CountingMotionSink : public rmf_battery::MotionPowerSink
+    {
+    public:
+
+      CountingMotionSink(rmf_battery::ConstMotionPowerSinkPtr sink)
+      : _sink(std::move(sink))
+      {
+        // Do nothing
+      }
+
+      double compute_change_in_charge(
+        const rmf_traffic::Trajectory& trajectory) const final
+      {
+        ++count;
+        return _sink->compute_change_in_charge(trajectory);
+      }
+
+      mutable std::atomic_size_t count = 0;
+
+    private:
+      rmf_battery::ConstMotionPowerSinkPtr _sink;
+    };
+
+    const auto counting_sink = std::make_shared<CountingMotionSink>(
+      motion_sink);
+    const rmf_task::Parameters counting_parameters{
+      planner,
+      battery_system,
+      counting_sink,
+      device_sink};
+
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_traffic::agv::Plan::Start start(now, 13, 0.0);
+    const rmf_traffic::agv::Plan::Goal goal(3);
+    const auto first = rmf_task::TravelEstimator(counting_parameters)
+      .estimate(start, goal);
+    REQUIRE(first.has_value());
+    const std::size_t evaluations = counting_sink->count;
+    CHECK(evaluations > 0);
+
+    // A separate estimator plans the leg at another time, but the drain of
+    // its trajectory is already known
+    const rmf_traffic::agv::Plan::Start later(
+      now + std::chrono::hours(1), 13, 0.0);
+    const auto second = rmf_task::TravelEstimator(counting_parameters)
+      .estimate(later, goal);
+    REQUIRE(second.has_value());
+    CHECK(counting_sink->count == evaluations);
+    CHECK(second->change_in_charge() == Approx(first->change_in_charge()));
+  }
+
+  WHEN("Estimating travel from one start to many goals")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator batch_estimator(parameters);
+    const rmf_task::TravelEstimator single_estimator(parameters);
+
+    const rmf_traffic::agv::Plan::Start start(now, 5, 0.0);
+    std::vector<rmf_traffic::agv::Plan::Goal> goals;
+    for (const std::size_t wp : {0, 3, 15, 2, 7, 3, 5})
+      goals.push_back(rmf_traffic::agv::Plan::Goal(wp));
+
+    // Memoize one of the goals up front
+    batch_estimator.estimate(start, goals[1]);
+
+    const auto results = batch_estimator.estimate(start, goals);
+    REQUIRE(results.size() == goals.size());
+    for (std::size_t i = 0; i < goals.size(); ++i)
+    {
+      const auto expected = single_estimator.estimate(start, goals[i]);
+      REQUIRE(results[i].has_value() == expected.has_value());
+      if (!expected.has_value())
+        continue;
+
+      CHECK(results[i]->duration() == expected->duration());
+      CHECK(results[i]->change_in_charge()
+        == Approx(expected->change_in_charge()));
+    }
+
+    // Every distinct pair was only planned once
+    CHECK(batch_estimator.cache_misses() == 6);
+    CHECK(batch_estimator.cache_hits() == 2);
+
+    CHECK(batch_estimator.estimate(
+        start, std::vector<rmf_traffic::agv::Plan::Goal>()).empty());
+  }
+
+  WHEN("Sharing a travel estimator between planners")
+  {
+    const auto now = std::chrono::steady_clock::now();
+
+    const auto estimator = rmf_task::TravelEstimator::shared(parameters);
+    CHECK(rmf_task::TravelEstimator::shared(parameters) == estimator);
+
+    // Equivalent parameters that were built separately share the estimator
+    const rmf_task::Parameters same_parameters{
+      planner,
+      battery_system,
+      std::make_shared<SimpleMotionPowerSink>(
+        battery_system, mechanical_system),
+      std::make_shared<SimpleDevicePowerSink>(
+        battery_system, power_system_processor)};
+    CHECK(rmf_task::TravelEstimator::shared(same_parameters) == estimator);
+
+    const rmf_task::Parameters heavier_parameters{
+      planner,
+      battery_system,
+      std::make_shared<SimpleMotionPowerSink>(
+        battery_system, *MechanicalSystem::make(90.0, 40.0, 0.22)),
+      device_sink};
+    CHECK(rmf_task::TravelEstimator::shared(heavier_parameters) != estimator);
+
+    auto shared_config = task_config;
+    shared_config.travel_estimator(estimator);
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now)
+    };
+
+    TaskPlanner first_planner("first", shared_config, default_options);
+    const auto first_result =
+      first_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&first_result));
+    CHECK(first_planner.last_statistics().travel_estimator_misses > 0);
+
+    // The second planner finds every estimate already memoized
+    TaskPlanner second_planner("second", shared_config, default_options);
+    const auto second_result =
+      second_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&second_result));
+    CHECK(second_planner.last_statistics().travel_estimator_misses == 0);
+    CHECK(second_planner.last_statistics().travel_estimator_hits > 0);
+  }
+
+  WHEN("Bounding travel durations from below")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator estimator(parameters);
+
+    const std::size_t num_waypoints = graph.num_waypoints();
+    for (std::size_t start = 0; start < num_waypoints; ++start)
+    {
+      for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+      {
+        const auto bound = estimator.lower_bound(start, goal);
+        CHECK(bound >= rmf_traffic::Duration(0));
+
+        const auto travel = estimator.estimate(
+          rmf_traffic::agv::Plan::Start(now, start, 0.0),
+          rmf_traffic::agv::Plan::Goal(goal));
+        if (travel.has_value())
+          CHECK(bound <= travel->duration());
+      }
+    }
+
+    // Neighbors on the grid are one edge apart
+    CHECK(rmf_traffic::time::to_seconds(estimator.lower_bound(0, 1))
+      == Approx(edge_length / 1.0));
+    CHECK(estimator.lower_bound(0, 0) == rmf_traffic::Duration(0));
+    CHECK(estimator.lower_bound(0, num_waypoints) == rmf_traffic::Duration(0));
+
+    // Computing bounds does not touch the cache
+    CHECK(estimator.cache_misses() == num_waypoints * num_waypoints);
+  }
+
+  WHEN("Updating the lane closures of a travel estimator")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const std::size_t num_waypoints = graph.num_waypoints();
+
+    // Lane 0 goes from waypoint 0 to waypoint 1
+    rmf_traffic::agv::LaneClosure closures;
+    closures.close(0);
+    rmf_traffic::agv::Planner::Configuration closed_config{graph, traits};
+    closed_config.lane_closures(closures);
+    const auto closed_planner = std::make_shared<rmf_traffic::agv::Planner>(
+      closed_config, default_planner_options);
+
+    auto closed_parameters = parameters;
+    closed_parameters.planner(closed_planner);
+
+    const auto check_all_pairs = [&](
+      const rmf_task::TravelEstimator& estimator,
+      const rmf_task::Parameters& expected_parameters)
+      {
+        const rmf_task::TravelEstimator expected(expected_parameters);
+        for (std::size_t start = 0; start < num_waypoints; ++start)
+        {
+          for (std::size_t goal = 0; goal < num_waypoints; ++goal)
+          {
+            const rmf_traffic::agv::Plan::Start from(now, start, 0.0);
+            const rmf_traffic::agv::Plan::Goal to(goal);
+            const auto travel = estimator.estimate(from, to);
+            const auto fresh = expected.estimate(from, to);
+            REQUIRE(travel.has_value() == fresh.has_value());
+            if (travel.has_value())
+              CHECK(travel->duration() == fresh->duration());
+          }
+        }
+      };
+
+    rmf_task::TravelEstimator estimator(parameters);
+    check_all_pairs(estimator, parameters);
+    const auto num_pairs = num_waypoints * num_waypoints;
+    REQUIRE(estimator.cache_size() == num_pairs);
+
+    const auto before = estimator.estimate(
+      rmf_traffic::agv::Plan::Start(now, 0, 0.0),
+      rmf_traffic::agv::Plan::Goal(1));
+    REQUIRE(before.has_value());
+
+    // Only the routes through the closed lane are dropped
+    const std::size_t closed = estimator.update_planner(closed_planner);
+    CHECK(closed > 0);
+    CHECK(closed < num_pairs / 4);
+    CHECK(estimator.cache_size() == num_pairs - closed);
+
+    const auto after = estimator.estimate(
+      rmf_traffic::agv::Plan::Start(now, 0, 0.0),
+      rmf_traffic::agv::Plan::Goal(1));
+    REQUIRE(after.has_value());
+    CHECK(before->duration() < after->duration());
+    check_all_pairs(estimator, closed_parameters);
+
+    // Reopening the lane drops the estimates it could make faster
+    const std::size_t opened = estimator.update_planner(planner);
+    CHECK(opened > 0);
+    CHECK(opened < num_pairs);
+    check_all_pairs(estimator, parameters);
+
+    // Nothing is dropped when the closures stay the same
+    CHECK(estimator.update_planner(planner) == 0);
+    CHECK(estimator.cache_size() == num_pairs);
+  }
+
+  WHEN("Building models of requests that share a route")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator estimator(parameters);
+
+    const auto first = rmf_task::requests::Delivery::Description::make(
+      3, delivery_wait, 12, delivery_wait, {{}});
+    const auto second = rmf_task::requests::Delivery::Description::make(
+      3, delivery_wait, 12, delivery_wait, {{}});
+    const auto loop = rmf_task::requests::Loop::Description::make(3, 12, 2);
+
+    // Making the models does not plan anything yet
+    const auto first_model = first->make_model(now, parameters, estimator);
+    const auto second_model = second->make_model(now, parameters, estimator);
+    const auto loop_model = loop->make_model(now, parameters, estimator);
+    CHECK(estimator.cache_misses() == 0);
+
+    // The pickup to dropoff leg is only planned once
+    std::vector<std::thread> threads;
+    for (const auto& model : {first_model, second_model, loop_model})
+    {
+      threads.emplace_back([&estimator, model]()
+        {
+          model->materialize(estimator);
+          model->materialize(estimator);
+        });
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    CHECK(estimator.cache_misses() == 1);
+    CHECK(estimator.cache_hits() == 2);
+
+    CHECK(first_model->invariant_duration()
+      == second_model->invariant_duration());
+    CHECK(first_model->invariant_duration()
+      == first->make_model(now, parameters)->invariant_duration());
+    CHECK(loop_model->invariant_duration()
+      == loop->make_model(now, parameters)->invariant_duration());
+  }
+
+  WHEN("Reusing the models of recurring requests")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const double default_orientation = 0.0;
+
+    rmf_traffic::agv::Plan::Start first_location{now, 13, default_orientation};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, default_orientation};
+
+    std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const auto make_requests = [&](rmf_traffic::Time start)
+      {
+        return std::vector<rmf_task::ConstRequestPtr>{
+          rmf_task::requests::Delivery::make(
+            0, delivery_wait, 3, delivery_wait, {{}}, "1", start),
+          rmf_task::requests::Delivery::make(
+            15, delivery_wait, 2, delivery_wait, {{}}, "2", start),
+          rmf_task::requests::Loop::make(5, 10, 2, "3", start)
+        };
+      };
+
+    const auto finish_times = [](const TaskPlanner::Result& result)
+      {
+        std::vector<rmf_traffic::Time> times;
+        const auto* assignments =
+          std::get_if<TaskPlanner::Assignments>(&result);
+        REQUIRE(assignments);
+        for (const auto& agent : *assignments)
+        {
+          for (const auto& assignment : agent)
+            times.push_back(assignment.finish_state().time().value());
+        }
+        return times;
+      };
+
+    TaskPlanner task_planner(task_config, default_options);
+    task_planner.plan(now, initial_states, make_requests(now));
+    const auto first = task_planner.last_statistics();
+    CHECK(first.model_cache_hits == 0);
+    CHECK(first.model_cache_misses == 3);
+
+    // The same requests a day later are new request objects, but their
+    // models are reused with a shifted start time
+    const auto tomorrow = now + std::chrono::hours(24);
+    auto tomorrow_states = initial_states;
+    for (auto& state : tomorrow_states)
+      state.time(tomorrow);
+
+    const auto result = task_planner.plan(
+      tomorrow, tomorrow_states, make_requests(tomorrow));
+    const auto second = task_planner.last_statistics();
+    CHECK(second.model_cache_hits >= 3);
+    CHECK(second.model_cache_misses == 0);
+
+    auto uncached_config = task_config;
+    uncached_config.model_cache_capacity(0);
+    TaskPlanner uncached_planner(uncached_config, default_options);
+    const auto expected = uncached_planner.plan(
+      tomorrow, tomorrow_states, make_requests(tomorrow));
+    CHECK(uncached_planner.last_statistics().model_cache_hits == 0);
+    CHECK(finish_times(result) == finish_times(expected));
+
+    // A small cache only keeps the most recently used models
+    auto small_config = task_config;
+    small_config.model_cache_capacity(1);
+    TaskPlanner small_planner(small_config, default_options);
+    small_planner.plan(now, initial_states, make_requests(now));
+    small_planner.plan(tomorrow, tomorrow_states, make_requests(tomorrow));
+    CHECK(small_planner.last_statistics().model_cache_misses >= 2);
+  }
+
+  WHEN("Building models of recurring requests separately")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const auto make_model = [&](rmf_traffic::Time start)
+      {
+        return rmf_task::requests::Delivery::Description::make(
+          1, delivery_wait, 10, delivery_wait, {{}})->make_model(
+          start, parameters);
+      };
+
+    const auto today = make_model(now);
+    const auto tomorrow = make_model(now + std::chrono::hours(24));
+
+    const rmf_task::TravelEstimator first_estimator(parameters);
+    today->materialize(first_estimator);
+    CHECK(first_estimator.cache_misses() > 0);
+
+    // The second model shares the invariant that the first one computed, so
+    // it does not need to plan the leg from the pickup to the dropoff again
+    const rmf_task::TravelEstimator second_estimator(parameters);
+    tomorrow->materialize(second_estimator);
+    CHECK(second_estimator.cache_misses() == 0);
+    CHECK(tomorrow->invariant_duration() == today->invariant_duration());
+  }
+
+  WHEN("Estimating built-in models from planning states")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::TravelEstimator estimator(parameters);
+    const rmf_task::Constraints charging_constraints{0.2, 0.9, true};
+
+    const auto state = rmf_task::State().load_basic(
+      rmf_traffic::agv::Plan::Start(now, 13, 0.0), 13, 0.5);
+    const auto planning_state = rmf_task::PlanningState::from(state);
+    REQUIRE(planning_state.has_value());
+    CHECK(!rmf_task::PlanningState::from(rmf_task::State()).has_value());
+
+    const std::vector<rmf_task::Task::ConstModelPtr> models = {
+      rmf_task::requests::Delivery::Description::make(
+        3, delivery_wait, 12, delivery_wait, {{}})->make_model(
+        now + std::chrono::minutes(10), parameters),
+      rmf_task::requests::Loop::Description::make(0, 15, 2)->make_model(
+        now, parameters),
+      rmf_task::requests::ChargeBattery::Description::make()->make_model(
+        now, parameters)
+    };
+
+    for (const auto& model : models)
+    {
+      CHECK(model->uses_planning_state());
+      const auto expected = model->estimate_finish(
+        state, charging_constraints, estimator);
+      const auto estimate = model->estimate_planning_finish(
+        *planning_state, charging_constraints, estimator);
+      REQUIRE(expected.has_value());
+      REQUIRE(estimate.has_value());
+
+      const auto finish_state = expected->finish_state();
+      CHECK(estimate->wait_until == expected->wait_until());
+      CHECK(estimate->finish_state.waypoint == finish_state.waypoint());
+      CHECK(estimate->finish_state.time == finish_state.time());
+      CHECK(estimate->finish_state.battery_soc
+        == Approx(finish_state.battery_soc().value()));
+      CHECK(estimate->finish_state.to_state().time() == finish_state.time());
+    }
+  }
+
+  WHEN("Reading the labels and requester of a booking")
+  {
+    const rmf_task::Task::Booking booking(
+      "booking", now, nullptr, "requester", now - std::chrono::seconds(5),
+      false, {"fragile", "urgent"});
+
+    const auto& labels = booking.labels();
+    CHECK(&labels == &booking.labels());
+    REQUIRE(labels.size() == 2);
+    CHECK(booking.has_label("urgent"));
+    CHECK_FALSE(booking.has_label("heavy"));
+
+    REQUIRE(booking.requester().has_value());
+    CHECK(&*booking.requester() == &*booking.requester());
+    CHECK(*booking.requester() == "requester");
+    CHECK(booking.request_time() == now - std::chrono::seconds(5));
+
+    const rmf_task::Task::Booking automatic("auto", now, nullptr, true);
+    CHECK_FALSE(automatic.requester().has_value());
+    CHECK_FALSE(automatic.request_time().has_value());
+    CHECK(automatic.labels().empty());
+  }
+
+  WHEN("Cleaning several zones in one request")
+  {
+    using MultiZoneClean = rmf_task::requests::MultiZoneClean;
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::Parameters clean_parameters{
+      planner,
+      battery_system,
+      motion_sink,
+      device_sink,
+      device_sink};
+
+    const auto zone = [&](std::size_t waypoint)
+      {
+        const auto& location = graph.get_waypoint(waypoint).get_location();
+        const Eigen::Vector3d p(location[0], location[1], 0.0);
+        rmf_traffic::Trajectory path;
+        path.insert(now, p, Eigen::Vector3d::Zero());
+        path.insert(now + std::chrono::seconds(60), p, Eigen::Vector3d::Zero());
+        return MultiZoneClean::Zone{waypoint, waypoint, path};
+      };
+
+    // Visiting the zones in the order that they are given zigzags across the
+    // grid
+    const std::vector<std::size_t> waypoints = {0, 15, 1, 14, 2, 13};
+    std::vector<MultiZoneClean::Zone> zones;
+    for (const auto w : waypoints)
+      zones.push_back(zone(w));
+
+    CHECK_THROWS_AS(
+      MultiZoneClean::Description::make({}), std::invalid_argument);
+
+    const auto request = MultiZoneClean::make(zones, "clean", now);
+    const auto description =
+      std::dynamic_pointer_cast<const MultiZoneClean::Description>(
+      request->description());
+    REQUIRE(description);
+    CHECK(description->zones().size() == zones.size());
+
+    const auto order = description->visiting_order(clean_parameters);
+    REQUIRE(order.size() == zones.size());
+    CHECK(std::is_permutation(
+        order.begin(), order.end(),
+        std::vector<std::size_t>{0, 1, 2, 3, 4, 5}.begin()));
+
+    const rmf_task::TravelEstimator travel_estimator(clean_parameters);
+    const auto travel_time = [&](const std::vector<std::size_t>& visits)
+      {
+        rmf_traffic::Duration total(0);
+        for (std::size_t k = 1; k < visits.size(); ++k)
+        {
+          const auto from = waypoints[visits[k-1]];
+          const auto to = waypoints[visits[k]];
+          const auto travel = travel_estimator.estimate(
+            rmf_traffic::agv::Plan::Start(now, from, 0.0),
+            rmf_traffic::agv::Plan::Goal(to));
+          REQUIRE(travel.has_value());
+          total += travel->duration();
+        }
+        return total;
+      };
+
+    CHECK(travel_time(order) < travel_time({0, 1, 2, 3, 4, 5}));
+
+    const auto model =
+      request->description()->make_model(now, clean_parameters);
+    CHECK(model->invariant_duration()
+      == travel_time(order) + 6 * std::chrono::seconds(60));
+
+    rmf_traffic::agv::Plan::Start start{now, waypoints[order.front()], 0.0};
+    const auto estimate = model->estimate_finish(
+      rmf_task::State().load_basic(start, 13, 1.0),
+      constraints,
+      travel_estimator);
+    REQUIRE(estimate.has_value());
+    CHECK(estimate->finish_state().waypoint().value()
+      == waypoints[order.back()]);
+    CHECK(estimate->finish_state().time().value()
+      == now + model->invariant_duration());
+    CHECK(estimate->finish_state().battery_soc().value() < 1.0);
+  }
+
+  WHEN("Delivering to several stops in one request")
+  {
+    using MultiStopDelivery = rmf_task::requests::MultiStopDelivery;
+    const auto now = std::chrono::steady_clock::now();
+    const rmf_task::Parameters delivery_parameters{
+      planner,
+      battery_system,
+      motion_sink,
+      device_sink,
+      device_sink};
+
+    const auto wait = std::chrono::seconds(30);
+    const rmf_task::Payload payload({});
+    const std::vector<MultiStopDelivery::Stop> stops = {
+      {5, wait, payload},
+      {5, wait, payload},
+      {10, wait, payload},
+      {15, wait, payload}
+    };
+
+    CHECK_THROWS_AS(
+      MultiStopDelivery::Description::make(0, wait, {}),
+      std::invalid_argument);
+
+    const auto request = MultiStopDelivery::make(0, wait, stops, "multi", now);
+    const auto description =
+      std::dynamic_pointer_cast<const MultiStopDelivery::Description>(
+      request->description());
+    REQUIRE(description);
+    CHECK(description->pickup_waypoint() == 0);
+    CHECK(description->dropoffs().size() == stops.size());
+
+    const rmf_task::TravelEstimator travel_estimator(delivery_parameters);
+    rmf_traffic::Duration legs(0);
+    for (const auto& [from, to] :
+      std::vector<std::pair<std::size_t, std::size_t>>{{0, 5}, {5, 10},
+        {10, 15}})
+    {
+      const auto travel = travel_estimator.estimate(
+        rmf_traffic::agv::Plan::Start(now, from, 0.0),
+        rmf_traffic::agv::Plan::Goal(to));
+      REQUIRE(travel.has_value());
+      legs += travel->duration();
+    }
+
+    const auto model =
+      request->description()->make_model(now, delivery_parameters);
+    CHECK(model->invariant_duration() == legs + 5 * wait);
+
+    // Requests with the same route share their invariants
+    const auto other = MultiStopDelivery::make(0, wait, stops, "other", now);
+    CHECK(other->description()->model_hash()
+      == request->description()->model_hash());
+
+    rmf_traffic::agv::Plan::Start start{now, 0, 0.0};
+    const auto estimate = model->estimate_finish(
+      rmf_task::State().load_basic(start, 13, 1.0),
+      constraints,
+      travel_estimator);
+    REQUIRE(estimate.has_value());
+    CHECK(estimate->finish_state().waypoint().value() == 15);
+    CHECK(estimate->finish_state().time().value()
+      == now + model->invariant_duration());
+    CHECK(estimate->finish_state().battery_soc().value() < 1.0);
+  }
+
+  WHEN("Planning a bulk of equivalent requests")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const auto later = now + std::chrono::minutes(30);
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    // The requests only differ by their IDs and start times
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+      const auto start = i < 3 ? now : later;
+      requests.push_back(rmf_task::requests::Delivery::make(
+          0, delivery_wait, 3, delivery_wait, {{}}, std::to_string(i), start));
+    }
+
+    auto greedy_options = default_options;
+    greedy_options.greedy(true);
+    TaskPlanner task_planner(task_config, greedy_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    std::size_t count = 0;
+    for (const auto& agent : *assignments)
+      count += agent.size();
+    CHECK(count == requests.size());
+
+    // Each start time forms one group whose first request gets estimated
+    const auto statistics = task_planner.last_statistics();
+    CHECK(statistics.grouped_requests >= requests.size() - 2);
+
+    // The grouped requests still get their own bookings
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& assignment : agent)
+      {
+        const auto& id = assignment.request()->booking()->id();
+        CHECK(std::count_if(requests.begin(), requests.end(),
+          [&](const auto& r) { return r->booking()->id() == id; }) == 1);
+      }
+    }
+  }
+
+  WHEN("Planning through a planner service")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now,
+        rmf_task::BinaryPriorityScheme::make_high_priority()),
+      rmf_task::requests::Loop::make(6, 9, 2, "2", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "3",
+        now + std::chrono::minutes(10))
+    };
+
+    const auto service_path = (std::filesystem::temp_directory_path()
+      / "rmf_task_test_planner_service").string();
+
+    rmf_task::PlannerService service(service_path, 2);
+    service.add_fleet(
+      "fleet", std::make_shared<TaskPlanner>(task_config, default_options));
+    const rmf_task::PlannerService::Client client(service_path);
+
+    const auto served = client.plan("fleet", now, initial_states, requests);
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&served);
+    REQUIRE(assignments);
+    CHECK(service.served() == 1);
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto direct = task_planner.plan(now, initial_states, requests);
+    const auto* expected = std::get_if<TaskPlanner::Assignments>(&direct);
+    REQUIRE(expected);
+
+    REQUIRE(assignments->size() == expected->size());
+    for (std::size_t a = 0; a < expected->size(); ++a)
+    {
+      REQUIRE(assignments->at(a).size() == expected->at(a).size());
+      for (std::size_t i = 0; i < expected->at(a).size(); ++i)
+      {
+        const auto& served_assignment = assignments->at(a)[i];
+        const auto& expected_assignment = expected->at(a)[i];
+        CHECK(served_assignment.request()->booking()->id()
+          == expected_assignment.request()->booking()->id());
+        CHECK(served_assignment.deployment_time()
+          == expected_assignment.deployment_time());
+        CHECK(served_assignment.finish_state().waypoint()
+          == expected_assignment.finish_state().waypoint());
+        CHECK(served_assignment.finish_state().time()
+          == expected_assignment.finish_state().time());
+      }
+    }
+
+    // The assignments refer to the requests that the client gave
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& assignment : agent)
+      {
+        CHECK(std::find(requests.begin(), requests.end(),
+          assignment.request()) != requests.end());
+      }
+    }
+
+    CHECK_THROWS_AS(
+      client.plan("unknown", now, initial_states, requests),
+      std::runtime_error);
+
+    // Results from the plan cache of the planner still refer to the requests
+    // that the client gave
+    auto cached_config = task_config;
+    cached_config.plan_cache_capacity(10);
+    const auto cached_planner =
+      std::make_shared<TaskPlanner>(cached_config, default_options);
+    const auto cached_path = service_path + "_cached";
+    rmf_task::PlannerService cached_service(cached_path, 1);
+    cached_service.add_fleet("fleet", cached_planner);
+    const rmf_task::PlannerService::Client cached_client(cached_path);
+    for (std::size_t call = 0; call < 2; ++call)
+    {
+      const auto result =
+        cached_client.plan("fleet", now, initial_states, requests);
+      const auto* cached = std::get_if<TaskPlanner::Assignments>(&result);
+      REQUIRE(cached);
+      CHECK(cached_planner->last_statistics().plan_cache_hit == (call == 1));
+      for (const auto& agent : *cached)
+      {
+        for (const auto& assignment : agent)
+        {
+          CHECK(std::find(requests.begin(), requests.end(),
+            assignment.request()) != requests.end());
+        }
+      }
+    }
+  }
+
+  WHEN("Compacting the assignments of a plan")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      requests.push_back(rmf_task::requests::Delivery::make(
+          3 * i, delivery_wait, 3 * i + 2, delivery_wait, {{}},
+          std::to_string(i), now));
+    }
+
+    TaskPlanner task_planner(task_config, default_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    const rmf_task::CompactAssignments compact(*assignments, requests);
+    CHECK(compact.num_agents() == assignments->size());
+
+    const auto check = [&](const rmf_task::CompactAssignments& view)
+      {
+        std::size_t row = 0;
+        for (std::size_t a = 0; a < assignments->size(); ++a)
+        {
+          for (const auto& assignment : assignments->at(a))
+          {
+            REQUIRE(row < view.size());
+            CHECK(view.agents()[row] == a);
+
+            const auto index = view.request_indices()[row];
+            if (index < requests.size())
+            {
+              CHECK(requests[index] == assignment.request());
+            }
+
+            CHECK(view.deployment_time(row) == assignment.deployment_time());
+            const auto state = view.finish_state(row);
+            CHECK(state.time() == assignment.finish_state().time());
+            CHECK(state.waypoint() == assignment.finish_state().waypoint());
+            CHECK(state.battery_soc()
+              == assignment.finish_state().battery_soc());
+            ++row;
+          }
+        }
+
+        CHECK(row == view.size());
+      };
+
+    check(compact);
+
+    // The whole view is one buffer that can be sent with one write
+    std::string bytes(
+      static_cast<const char*>(compact.data()), compact.size_bytes());
+    const auto received =
+      rmf_task::CompactAssignments::from_bytes(bytes.data(), bytes.size());
+    CHECK(received.num_agents() == compact.num_agents());
+    CHECK(received.generated_requests().empty());
+    check(received);
+
+    bytes.pop_back();
+    CHECK_THROWS_AS(
+      rmf_task::CompactAssignments::from_bytes(bytes.data(), bytes.size()),
+      std::invalid_argument);
+  }
+
+  WHEN("Merging nearby planning segments")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    rmf_traffic::agv::Plan::Start location{now, 13, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(location, 13, 1.0),
+      rmf_task::State().load_basic(location, 13, 1.0)
+    };
+
+    // Each request takes one minute at the waypoint where the agents already
+    // are, and the next one begins half a minute after it finishes
+    const auto wait = rmf_traffic::time::from_seconds(30);
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+      requests.push_back(rmf_task::requests::Delivery::make(
+          13, wait, 13, wait, {{}}, std::to_string(i),
+          now + i * rmf_traffic::time::from_seconds(90)));
+    }
+
+    const auto deployments = [](const TaskPlanner::Assignments& assignments)
+      {
+        std::map<std::string, rmf_traffic::Time> times;
+        for (const auto& agent : assignments)
+        {
+          for (const auto& assignment : agent)
+          {
+            times[assignment.request()->booking()->id()] =
+              assignment.deployment_time();
+          }
+        }
+
+        return times;
+      };
+
+    TaskPlanner separate_planner(task_config, default_options);
+    const auto separate =
+      separate_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&separate));
+    const auto separate_statistics = separate_planner.last_statistics();
+    CHECK(separate_statistics.segments == requests.size());
+
+    // Only one agent gets an assignment in each segment, so the candidates
+    // of the other agent are kept for the next segment
+    CHECK(separate_statistics.carried_candidates > 0);
+
+    auto adaptive_options = default_options;
+    adaptive_options.adaptive_segmentation(true);
+    CHECK(adaptive_options.adaptive_segmentation());
+    TaskPlanner merged_planner(task_config, adaptive_options);
+    const auto merged = merged_planner.plan(now, initial_states, requests);
+    REQUIRE(std::get_if<TaskPlanner::Assignments>(&merged));
+    CHECK(merged_planner.last_statistics().segments == 1);
+
+    // Every request still begins as soon as it may
+    const auto separate_times =
+      deployments(std::get<TaskPlanner::Assignments>(separate));
+    const auto merged_times =
+      deployments(std::get<TaskPlanner::Assignments>(merged));
+    CHECK(merged_times == separate_times);
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+      CHECK(merged_times.at(std::to_string(i))
+        == requests[i]->booking()->earliest_start_time());
+    }
+  }
+
+  WHEN("Generating the IDs of automatic requests")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    std::unordered_set<std::string> ids;
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+      const auto id =
+        rmf_task::requests::ChargeBattery::make(now)->booking()->id();
+      CHECK(id.rfind("Charge", 0) == 0);
+      CHECK(id.size() == std::string("Charge").size() + 6);
+      ids.insert(id);
+    }
+
+    // Collisions between six random digits are possible, but not this many
+    CHECK(ids.size() > 90);
+
+    rmf_traffic::agv::Plan::Start location{now, 13, 0.0};
+    const auto state = rmf_task::State().load_basic(location, 13, 1.0);
+    const auto park =
+      rmf_task::requests::ParkRobotFactory().make_request(state);
+    CHECK(park->booking()->id().rfind("ParkRobot", 0) == 0);
+    CHECK(park->booking()->automatic());
+
+    // The charging tasks that the planner adds to a result each get their
+    // own request
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t i = 0; i < 12; ++i)
+    {
+      requests.push_back(rmf_task::requests::Delivery::make(
+          0, delivery_wait, 15, delivery_wait, {{}}, std::to_string(i), now));
+    }
+
+    TaskPlanner task_planner(task_config, greedy_options);
+    const auto result = task_planner.plan(now, initial_states, requests);
+    const auto* assignments = std::get_if<TaskPlanner::Assignments>(&result);
+    REQUIRE(assignments);
+
+    std::unordered_set<const rmf_task::Request*> charging;
+    for (const auto& agent : *assignments)
+    {
+      for (const auto& assignment : agent)
+      {
+        const auto& request = assignment.request();
+        if (!std::dynamic_pointer_cast<
+            const rmf_task::requests::ChargeBattery::Description>(
+            request->description()))
+          continue;
+
+        CHECK(request->booking()->automatic());
+        CHECK(request->booking()->id().size()
+          == std::string("Charge").size() + 6);
+        CHECK(charging.insert(request.get()).second);
+      }
+    }
+  }
+
+  WHEN("Planning a charging request that was submitted")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    rmf_traffic::agv::Plan::Start first_location{now, 13, 0.0};
+    rmf_traffic::agv::Plan::Start second_location{now, 2, 0.0};
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic(first_location, 13, 1.0),
+      rmf_task::State().load_basic(second_location, 2, 1.0)
+    };
+
+    const std::vector<rmf_task::ConstRequestPtr> requests =
+    {
+      rmf_task::requests::Delivery::make(
+        0, delivery_wait, 3, delivery_wait, {{}}, "1", now),
+      rmf_task::requests::ChargeBattery::make(now, "requester", now),
+      rmf_task::requests::Delivery::make(
+        15, delivery_wait, 2, delivery_wait, {{}}, "2", now)
+    };
+
+    for (const auto& options : {default_options, greedy_options})
+    {
+      TaskPlanner task_planner(task_config, options);
+      const auto result = task_planner.plan(now, initial_states, requests);
+      const auto* assignments =
+        std::get_if<TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+
+      // The submitted request is kept in the result as it was given instead
+      // of being replaced like the charging tasks that the planner adds
+      std::size_t found = 0;
+      for (const auto& agent : *assignments)
+      {
+        for (const auto& assignment : agent)
+        {
+          if (assignment.request() == requests[1])
+            ++found;
+        }
+      }
+
+      CHECK(found == 1);
+    }
+  }
+
+  WHEN("Agents must charge before their tasks")
+  {
+    const auto now = std::chrono::steady_clock::now();
+    const std::vector<rmf_task::State> initial_states =
+    {
+      rmf_task::State().load_basic({now, 13, 0.0}, 13, 0.3),
+      rmf_task::State().load_basic({now, 2, 0.0}, 2, 0.3)
+    };
+
+    std::vector<rmf_task::ConstRequestPtr> requests;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      requests.push_back(rmf_task::requests::Delivery::make(
+          0, delivery_wait, 15, delivery_wait, {{}}, std::to_string(i), now));
+    }
+
+    auto refine_options = greedy_options;
+    refine_options.refinement_time(rmf_traffic::time::from_seconds(0.2));
+
+    for (const auto& options :
+      {default_options, greedy_options, refine_options})
+    {
+      TaskPlanner task_planner(task_config, options);
+      const auto result = task_planner.plan(now, initial_states, requests);
+      const auto* assignments =
+        std::get_if<TaskPlanner::Assignments>(&result);
+      REQUIRE(assignments);
+      CHECK_TIMES(*assignments, now);
+
+      // The charges that go ahead of the tasks get requests of their own in
+      // the result instead of the placeholder that the search uses
+      std::size_t charges = 0;
+      std::unordered_map<std::string, std::size_t> assigned_ids;
+      for (const auto& agent : *assignments)
+      {
+        for (const auto& assignment : agent)
+        {
+          const auto& id = assignment.request()->booking()->id();
+          CHECK(id != "Charge");
+          ++assigned_ids[id];
+          if (std::dynamic_pointer_cast<
+              const rmf_task::requests::ChargeBattery::Description>(
+              assignment.request()->description()))
+            ++charges;
+        }
+      }
+
+      CHECK(charges > 0);
+      for (const auto& request : requests)
+        CHECK(assigned_ids[request->booking()->id()] == 1);
+    }
+  }
 }
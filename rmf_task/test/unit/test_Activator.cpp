@@ -19,6 +19,14 @@
 
 #include "../mock/MockDelivery.hpp"
 
+#include <rmf_task/requests/Loop.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 SCENARIO("Activate fresh task")
 {
   rmf_task::Activator activator;
@@ -83,3 +91,102 @@ SCENARIO("Activate fresh task")
   REQUIRE(mock_restored->_restored_state.has_value());
   CHECK(mock_restored->_restored_state == backup->state());
 }
+
+SCENARIO("Activate tasks with a frozen activator")
+{
+  rmf_task::Activator activator;
+  activator.add_activator(test_rmf_task::MockDelivery::make_activator());
+  CHECK_FALSE(activator.frozen());
+
+  activator.freeze();
+  CHECK(activator.frozen());
+
+  using namespace std::chrono_literals;
+  const auto delivery = rmf_task::requests::Delivery::make(
+    0, 1min, 1, 1min, {{}}, "request_0", rmf_traffic::Time());
+  const auto loop = rmf_task::requests::Loop::make(
+    0, 1, 1, "request_1", rmf_traffic::Time());
+
+  const auto activate = [&](const rmf_task::Request& request)
+    {
+      return activator.activate(
+        nullptr, nullptr, request,
+        [](auto) {}, [](auto) {}, [](auto) {}, []() {});
+    };
+
+  CHECK(std::dynamic_pointer_cast<test_rmf_task::MockDelivery::Active>(
+      activate(*delivery)));
+  CHECK_FALSE(activate(*loop));
+
+  WHEN("An activator is added for a new type")
+  {
+    using Loop = rmf_task::requests::Loop::Description;
+    CHECK_THROWS_AS(
+      activator.add_activator<Loop>(
+        [](auto&&...) -> rmf_task::Task::ActivePtr { return nullptr; }),
+      std::runtime_error);
+  }
+
+  WHEN("The activator of a type that is already known gets replaced")
+  {
+    using Delivery = rmf_task::requests::Delivery::Description;
+    std::size_t replaced = 0;
+    activator.add_activator<Delivery>(
+      [&](auto&&...) -> rmf_task::Task::ActivePtr
+      {
+        ++replaced;
+        return nullptr;
+      });
+
+    CHECK_FALSE(activate(*delivery));
+    CHECK(replaced == 1);
+  }
+}
+
+SCENARIO("Activate a task whose callbacks run on an executor")
+{
+  using namespace std::chrono_literals;
+
+  rmf_task::Activator activator;
+  activator.add_activator(test_rmf_task::MockDelivery::make_activator());
+
+  auto request = rmf_task::requests::Delivery::make(
+    0, 1min, 1, 1min, {{}}, "request_0", rmf_traffic::Time());
+
+  std::mutex mutex;
+  std::condition_variable received;
+  std::vector<uint64_t> sequences;
+  std::thread::id caller = std::this_thread::get_id();
+  bool on_caller = false;
+
+  const auto pool = rmf_task::Executor::make_thread_pool(4);
+  auto active = activator.activate(
+    nullptr,
+    nullptr,
+    *request,
+    [](auto) {},
+    [&](auto b)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      on_caller = on_caller || std::this_thread::get_id() == caller;
+      sequences.push_back(b.sequence());
+      received.notify_all();
+    },
+    [](auto) {},
+    []() {},
+    pool);
+
+  auto mock_active =
+    std::dynamic_pointer_cast<test_rmf_task::MockDelivery::Active>(active);
+  REQUIRE(mock_active);
+
+  for (std::size_t i = 0; i < 10; ++i)
+    mock_active->issue_backup();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  REQUIRE(
+    received.wait_for(lock, 5s, [&]() { return sequences.size() == 10; }));
+  CHECK_FALSE(on_caller);
+  for (std::size_t i = 0; i < sequences.size(); ++i)
+    CHECK(sequences[i] == i);
+}
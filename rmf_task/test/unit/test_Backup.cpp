@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/detail/Backup.hpp>
+
+//==============================================================================
+SCENARIO("Copies of a backup share their serialized state")
+{
+  using Backup = rmf_task::detail::Backup;
+
+  const auto original = Backup::make(3, std::string(1024, 'x'));
+  const auto* address = &original.state();
+
+  Backup copy = original;
+  CHECK(&copy.state() == address);
+  CHECK(copy.shared_state() == original.shared_state());
+
+  // Changing the state of one copy leaves the other untouched
+  copy.state("changed");
+  CHECK(copy.state() == "changed");
+  CHECK(original.state() == std::string(1024, 'x'));
+  CHECK(&original.state() == address);
+
+  const auto from_buffer =
+    Backup::make(4, std::make_shared<const std::string>("buffer"));
+  CHECK(from_buffer.state() == "buffer");
+  CHECK(from_buffer.sequence() == 4);
+
+  CHECK(Backup::make(5, Backup::SharedState()).state().empty());
+}
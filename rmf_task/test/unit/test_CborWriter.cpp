@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/CborWriter.hpp>
+#include <rmf_task/events/SimpleEventState.hpp>
+
+#include <algorithm>
+
+namespace {
+//==============================================================================
+std::vector<uint8_t> text_item(const std::string& text)
+{
+  std::vector<uint8_t> output;
+  output.push_back(static_cast<uint8_t>(0x60 + text.size()));
+  output.insert(output.end(), text.begin(), text.end());
+  return output;
+}
+
+//==============================================================================
+bool contains(
+  const std::vector<uint8_t>& buffer,
+  const std::vector<uint8_t>& sequence)
+{
+  return std::search(
+    buffer.begin(), buffer.end(), sequence.begin(), sequence.end())
+    != buffer.end();
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Writing CBOR items")
+{
+  WHEN("Writing integers")
+  {
+    std::vector<uint8_t> buffer;
+    rmf_task::CborWriter writer(buffer);
+    writer.write_unsigned(0).write_unsigned(23).write_unsigned(24)
+    .write_unsigned(500).write_unsigned(1000000)
+    .write_unsigned(1000000000000).write_signed(-1).write_signed(-500);
+
+    const std::vector<uint8_t> expected = {
+      0x00,
+      0x17,
+      0x18, 0x18,
+      0x19, 0x01, 0xf4,
+      0x1a, 0x00, 0x0f, 0x42, 0x40,
+      0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00,
+      0x20,
+      0x39, 0x01, 0xf3
+    };
+    CHECK(buffer == expected);
+  }
+
+  WHEN("Writing other simple items")
+  {
+    std::vector<uint8_t> buffer;
+    rmf_task::CborWriter writer(buffer);
+    writer.write_double(1.5).write_bool(true).write_bool(false).write_null()
+    .write_text("IETF").begin_array(3).begin_map(2);
+
+    const std::vector<uint8_t> expected = {
+      0xfb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0xf5,
+      0xf4,
+      0xf6,
+      0x64, 0x49, 0x45, 0x54, 0x46,
+      0x83,
+      0xa2
+    };
+    CHECK(buffer == expected);
+  }
+
+  WHEN("Writing an event with its log and dependencies")
+  {
+    std::vector<uint8_t> buffer;
+    rmf_task::CborWriter writer(buffer);
+    const auto dependency = rmf_task::events::SimpleEventState::make(
+      2, "dependency", "", rmf_task::Event::Status::Completed);
+
+    const auto event = rmf_task::events::SimpleEventState::make(
+      1, "go", "to the kitchen", rmf_task::Event::Status::Underway,
+      {dependency});
+    event->update_log().warn("blocked by a door");
+
+    writer.write(*rmf_task::Event::Snapshot::make(*event));
+
+    // The event is a map of six pairs that starts with its ID
+    REQUIRE(buffer.size() > 4);
+    CHECK(buffer[0] == 0xa6);
+    CHECK(buffer[1] == 0x62);
+    CHECK(buffer[4] == 0x01);
+
+    CHECK(contains(buffer, text_item("underway")));
+    CHECK(contains(buffer, text_item("to the kitchen")));
+    CHECK(contains(buffer, text_item("warning")));
+    CHECK(contains(buffer, text_item("blocked by a door")));
+    CHECK(contains(buffer, text_item("dependency")));
+    CHECK(contains(buffer, text_item("completed")));
+
+    // The log holds one entry and the dependencies hold one event
+    auto log = text_item("log");
+    log.push_back(0x81);
+    CHECK(contains(buffer, log));
+
+    auto deps = text_item("deps");
+    deps.push_back(0x81);
+    deps.push_back(0xa6);
+    CHECK(contains(buffer, deps));
+  }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/CompositeData.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+RMF_TASK_DEFINE_COMPONENT(int, ComponentA);
+RMF_TASK_DEFINE_COMPONENT(double, ComponentB);
+RMF_TASK_DEFINE_COMPONENT(std::string, ComponentC);
+
+template<std::size_t I>
+struct Extension
+{
+  std::size_t value;
+};
+} // anonymous namespace
+
+SCENARIO("Storing components in CompositeData")
+{
+  rmf_task::CompositeData data;
+  CHECK(data.get<ComponentA>() == nullptr);
+
+  const auto a = data.insert(ComponentA(1));
+  CHECK(a.inserted);
+  REQUIRE(a.value);
+  CHECK(a.value->value == 1);
+
+  const auto repeat = data.insert(ComponentA(2));
+  CHECK(!repeat.inserted);
+  CHECK(repeat.value == a.value);
+  CHECK(data.get<ComponentA>()->value == 1);
+
+  data.with(ComponentA(3)).with(ComponentB(0.5));
+  CHECK(data.get<ComponentA>() == a.value);
+  CHECK(data.get<ComponentA>()->value == 3);
+  CHECK(data.get<ComponentB>()->value == 0.5);
+
+  const auto* c = data.insert(ComponentC("text")).value;
+
+  // More types than fit in the slots, so that some are stored as extensions
+  data.insert(Extension<0>{0});
+  data.insert(Extension<1>{1});
+  data.insert(Extension<2>{2});
+  data.insert(Extension<3>{3});
+  data.insert(Extension<4>{4});
+  const auto* last = data.insert(Extension<5>{5}).value;
+  data.insert(Extension<6>{6});
+  data.insert(Extension<7>{7});
+
+  // Inserting other types does not move the ones that are already stored
+  CHECK(data.get<ComponentA>() == a.value);
+  CHECK(data.get<ComponentC>() == c);
+  CHECK(data.get<Extension<5>>() == last);
+  CHECK(data.get<Extension<7>>()->value == 7);
+
+  auto copy = data;
+  copy.get<Extension<5>>()->value = 50;
+  copy.get<ComponentC>()->value = "changed";
+  CHECK(data.get<Extension<5>>()->value == 5);
+  CHECK(data.get<ComponentC>()->value == "text");
+  CHECK(copy.get<Extension<7>>()->value == 7);
+  CHECK(copy.get<ComponentA>()->value == 3);
+
+  CHECK(data.erase<Extension<5>>());
+  CHECK(!data.erase<Extension<5>>());
+  CHECK(data.get<Extension<5>>() == nullptr);
+  CHECK(data.get<Extension<6>>()->value == 6);
+  CHECK(data.erase<ComponentA>());
+  CHECK(data.get<ComponentA>() == nullptr);
+  CHECK(copy.get<ComponentA>() != nullptr);
+
+  copy.clear();
+  CHECK(copy.get<ComponentB>() == nullptr);
+  CHECK(copy.get<Extension<7>>() == nullptr);
+  CHECK(data.get<Extension<7>>()->value == 7);
+}
+
+SCENARIO("Sharing the components of copied CompositeData")
+{
+  rmf_task::CompositeData data;
+  data.insert(ComponentA(1));
+  data.insert(Extension<9>{9});
+
+  const auto copy = data;
+  const rmf_task::CompositeData& const_data = data;
+  CHECK(copy.get<ComponentA>() == const_data.get<ComponentA>());
+  CHECK(copy.get<Extension<9>>() == const_data.get<Extension<9>>());
+
+  // Modifying the original gives it its own components
+  data.get<ComponentA>()->value = 2;
+  CHECK(copy.get<ComponentA>()->value == 1);
+  CHECK(copy.get<ComponentA>() != const_data.get<ComponentA>());
+
+  auto second = copy;
+  CHECK(second.erase<Extension<9>>());
+  CHECK(copy.get<Extension<9>>()->value == 9);
+
+  auto third = copy;
+  third.clear();
+  CHECK(third.get<ComponentA>() == nullptr);
+  CHECK(copy.get<ComponentA>()->value == 1);
+
+  // Looking up a missing component does not copy anything
+  auto fourth = copy;
+  CHECK(fourth.get<ComponentB>() == nullptr);
+  CHECK(std::as_const(fourth).get<ComponentA>() == copy.get<ComponentA>());
+}
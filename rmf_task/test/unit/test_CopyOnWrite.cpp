@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <rmf_utils/catch.hpp>
+
+#include "src/rmf_task/internal_task_planning.hpp"
+
+#include <thread>
+#include <vector>
+
+//==============================================================================
+SCENARIO("Sharing values between copies of a search node")
+{
+  using Values = rmf_task::CopyOnWrite<std::vector<int>>;
+
+  const auto check_sharing = []()
+    {
+      Values original(std::vector<int>{1, 2, 3});
+      Values copy = original;
+      CHECK(&*copy == &*original);
+
+      // Modifying a shared value leaves the other handle untouched
+      copy.mutate().push_back(4);
+      CHECK(&*copy != &*original);
+      CHECK(original->size() == 3);
+      CHECK(copy->size() == 4);
+
+      // A value that is no longer shared is modified in place
+      const auto* address = &*copy;
+      copy.mutate().push_back(5);
+      CHECK(&*copy == address);
+
+      Values moved = std::move(copy);
+      CHECK(&*moved == address);
+
+      moved = original;
+      CHECK(&*moved == &*original);
+    };
+
+  WHEN("The values are made outside of a single-threaded scope")
+  {
+    CHECK_FALSE(rmf_task::SingleThreadedScope::active());
+    check_sharing();
+  }
+
+  WHEN("The values are made inside of a single-threaded scope")
+  {
+    {
+      rmf_task::SingleThreadedScope scope;
+      CHECK(rmf_task::SingleThreadedScope::active());
+      {
+        rmf_task::SingleThreadedScope nested;
+        CHECK(rmf_task::SingleThreadedScope::active());
+      }
+      CHECK(rmf_task::SingleThreadedScope::active());
+
+      bool active_elsewhere = true;
+      std::thread([&]()
+        {
+          active_elsewhere = rmf_task::SingleThreadedScope::active();
+        }).join();
+      CHECK_FALSE(active_elsewhere);
+
+      check_sharing();
+    }
+
+    CHECK_FALSE(rmf_task::SingleThreadedScope::active());
+  }
+}
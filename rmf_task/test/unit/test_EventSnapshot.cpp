@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/events/SimpleEventState.hpp>
+
+using rmf_task::Event;
+using rmf_task::events::SimpleEventState;
+
+//==============================================================================
+SCENARIO("Reusing unchanged parts of event snapshots")
+{
+  const auto first = SimpleEventState::make(
+    1, "first", "", Event::Status::Completed);
+  const auto second = SimpleEventState::make(
+    2, "second", "", Event::Status::Underway);
+  const auto root = SimpleEventState::make(
+    0, "root", "", Event::Status::Underway, {first, second});
+
+  const auto snapshot = Event::Snapshot::make(*root);
+  REQUIRE(snapshot->version().has_value());
+  REQUIRE(snapshot->dependencies().size() == 2);
+
+  WHEN("Nothing changes")
+  {
+    CHECK(Event::Snapshot::make(*root, snapshot) == snapshot);
+  }
+
+  WHEN("A status is updated to the value that it already has")
+  {
+    const auto version = root->version();
+    root->update_status(Event::Status::Underway);
+    root->update_dependencies({first, second});
+    CHECK(root->version() == version);
+    CHECK(Event::Snapshot::make(*root, snapshot) == snapshot);
+  }
+
+  WHEN("One dependency gets a log entry")
+  {
+    second->update_log().info("moving");
+    const auto next = Event::Snapshot::make(*root, snapshot);
+    CHECK(next != snapshot);
+    REQUIRE(next->dependencies().size() == 2);
+    CHECK(next->dependencies()[0] == snapshot->dependencies()[0]);
+    CHECK(next->dependencies()[1] != snapshot->dependencies()[1]);
+
+    std::size_t count = 0;
+    for (const auto& entry :
+      rmf_task::Log::Reader().read(next->dependencies()[1]->log()))
+    {
+      CHECK(entry.text() == "moving");
+      ++count;
+    }
+    CHECK(count == 1);
+  }
+
+  WHEN("The root changes its status")
+  {
+    root->update_status(Event::Status::Blocked);
+    const auto next = Event::Snapshot::make(*root, snapshot);
+    CHECK(next != snapshot);
+    CHECK(next->status() == Event::Status::Blocked);
+    CHECK(next->dependencies()[0] == snapshot->dependencies()[0]);
+    CHECK(next->dependencies()[1] == snapshot->dependencies()[1]);
+  }
+
+  WHEN("A dependency is renamed")
+  {
+    first->update_name("renamed");
+    const auto next = Event::Snapshot::make(*root, snapshot);
+    CHECK(next != snapshot);
+    CHECK(next->dependencies()[0] != snapshot->dependencies()[0]);
+    CHECK(next->dependencies()[1] == snapshot->dependencies()[1]);
+  }
+
+  WHEN("A dependency is added")
+  {
+    const auto third = SimpleEventState::make(
+      3, "third", "", Event::Status::Standby);
+    root->add_dependency(third);
+    const auto next = Event::Snapshot::make(*root, snapshot);
+    REQUIRE(next->dependencies().size() == 3);
+    CHECK(next->dependencies()[0] == snapshot->dependencies()[0]);
+    CHECK(next->dependencies()[2]->id() == 3);
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/Executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+SCENARIO("Run jobs on a thread pool")
+{
+  std::atomic_size_t count = 0;
+  {
+    const auto pool = rmf_task::Executor::make_thread_pool(4);
+    for (std::size_t i = 0; i < 100; ++i)
+      pool->post([&]() { ++count; });
+  }
+
+  // The pool finishes every posted job before it is destroyed
+  CHECK(count == 100);
+}
+
+//==============================================================================
+SCENARIO("Strands keep their jobs in order")
+{
+  using namespace std::chrono_literals;
+
+  const auto pool = rmf_task::Executor::make_thread_pool(4);
+  const auto strand = rmf_task::Strand::make(pool);
+  CHECK(strand->executor() == pool);
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::vector<std::size_t> order;
+  std::atomic_size_t running = 0;
+  bool overlapped = false;
+
+  const std::size_t N = 200;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    strand->post(
+      [&, i]()
+      {
+        if (running++ > 0)
+          overlapped = true;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(i);
+        --running;
+        finished.notify_all();
+      });
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  REQUIRE(finished.wait_for(lock, 5s, [&]() { return order.size() == N; }));
+  CHECK_FALSE(overlapped);
+  for (std::size_t i = 0; i < N; ++i)
+    CHECK(order[i] == i);
+
+  CHECK_THROWS_AS(rmf_task::Strand::make(nullptr), std::runtime_error);
+}
+
+//==============================================================================
+SCENARIO("A job releases the last owner of its thread pool")
+{
+  using namespace std::chrono_literals;
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+  {
+    auto pool = rmf_task::Executor::make_thread_pool(1);
+    auto strand = rmf_task::Strand::make(std::move(pool));
+    strand->post(
+      [&]()
+      {
+        std::this_thread::sleep_for(10ms);
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        finished.notify_all();
+      });
+
+    // The strand, and with it the pool, is now only owned by the posted job
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  CHECK(finished.wait_for(lock, 5s, [&]() { return done; }));
+}
@@ -247,3 +247,265 @@ SCENARIO("Multi-threaded read/write without syncing")
     ++index;
   }
 }
+
+//==============================================================================
+SCENARIO("Bounded log retention")
+{
+  rmf_task::Log log;
+  log.max_entries(2*rmf_task::Log::ChunkSize);
+
+  rmf_task::Log::Reader fast_reader;
+  rmf_task::Log::Reader slow_reader;
+
+  const std::size_t first_round = rmf_task::Log::ChunkSize;
+  for (std::size_t i = 0; i < first_round; ++i)
+    log.info("Entry " + std::to_string(i));
+
+  std::size_t count = 0;
+  for (const auto& entry : fast_reader.read(log.view()))
+  {
+    CHECK(entry.seq() == count);
+    ++count;
+  }
+  CHECK(count == first_round);
+
+  const auto old_view = log.view();
+
+  const std::size_t total = 10*rmf_task::Log::ChunkSize + 5;
+  for (std::size_t i = first_round; i < total; ++i)
+    log.info("Entry " + std::to_string(i));
+
+  CHECK(log.size() <= 2*rmf_task::Log::ChunkSize);
+  CHECK(log.size() > rmf_task::Log::ChunkSize);
+  CHECK(log.size() + log.evicted() == total);
+
+  WHEN("A reader fell behind the retained entries")
+  {
+    const auto view = log.view();
+    const auto iterable = slow_reader.read(view);
+    CHECK(iterable.truncated() == log.evicted());
+
+    std::size_t expected_seq = log.evicted();
+    count = 0;
+    for (const auto& entry : iterable)
+    {
+      CHECK(entry.seq() == expected_seq);
+      CHECK(entry.text() == "Entry " + std::to_string(expected_seq));
+      ++expected_seq;
+      ++count;
+    }
+    CHECK(count == log.size());
+    CHECK(expected_seq == total);
+
+    const auto again = slow_reader.read(view);
+    CHECK(again.truncated() == 0);
+    CHECK(again.begin() == again.end());
+  }
+
+  WHEN("A view was taken before its entries were evicted")
+  {
+    rmf_task::Log::Reader reader;
+    count = 0;
+    for (const auto& entry : reader.read(old_view))
+    {
+      CHECK(entry.seq() == count);
+      ++count;
+    }
+    CHECK(count == first_round);
+  }
+
+  WHEN("The limit is lowered")
+  {
+    log.max_entries(std::nullopt);
+    log.max_bytes(1);
+    CHECK(log.size() <= rmf_task::Log::ChunkSize);
+    CHECK(log.size() + log.evicted() == total);
+  }
+}
+
+//==============================================================================
+SCENARIO("Multiple producers appending concurrently")
+{
+  auto log = std::make_shared<rmf_task::Log>();
+  log->max_entries(1000);
+
+  const std::size_t num_producers = 4;
+  const std::size_t entries_per_producer = 5000;
+  std::atomic_bool producers_finished = false;
+
+  std::vector<std::thread> producers;
+  for (std::size_t p = 0; p < num_producers; ++p)
+  {
+    producers.emplace_back(
+      [log, p, entries_per_producer]()
+      {
+        for (std::size_t i = 0; i < entries_per_producer; ++i)
+          log->info(std::to_string(p) + ":" + std::to_string(i));
+      });
+  }
+
+  std::vector<std::size_t> next_from_producer(num_producers, 0);
+  std::size_t total = 0;
+  std::size_t truncated = 0;
+  std::optional<uint32_t> last_seq;
+  rmf_task::Log::Reader reader;
+  const auto read = [&]()
+    {
+      const auto iterable = reader.read(log->view());
+      truncated += iterable.truncated();
+      for (const auto& entry : iterable)
+      {
+        if (last_seq.has_value())
+          CHECK(entry.seq() > *last_seq);
+
+        last_seq = entry.seq();
+
+        const auto& text = entry.text();
+        const auto colon = text.find(':');
+        const std::size_t p = std::stoul(text.substr(0, colon));
+        const std::size_t i = std::stoul(text.substr(colon + 1));
+        REQUIRE(p < num_producers);
+
+        // Each producer's entries appear in the order that it added them
+        CHECK(next_from_producer[p] <= i);
+        next_from_producer[p] = i + 1;
+        ++total;
+      }
+    };
+
+  std::thread watcher(
+    [&]()
+    {
+      for (auto& producer : producers)
+        producer.join();
+
+      producers_finished = true;
+    });
+
+  while (!producers_finished)
+    read();
+
+  watcher.join();
+  read();
+
+  CHECK(total + truncated == num_producers * entries_per_producer);
+  CHECK(log->size() + log->evicted() == num_producers * entries_per_producer);
+  CHECK(log->size() <= 1000);
+}
+
+//==============================================================================
+SCENARIO("Reading log entries in bulk")
+{
+  rmf_task::Log log;
+  const std::size_t total = 3*rmf_task::Log::ChunkSize + 7;
+  for (std::size_t i = 0; i < total; ++i)
+    log.info(std::to_string(i));
+
+  const auto view = log.view();
+  CHECK(view.size() == total);
+
+  WHEN("Reading everything")
+  {
+    std::vector<const rmf_task::Log::Entry*> entries;
+    CHECK(view.entries_after(std::nullopt, entries) == total);
+    REQUIRE(entries.size() == total);
+    for (std::size_t i = 0; i < total; ++i)
+    {
+      CHECK(entries[i]->seq() == i);
+      CHECK(entries[i]->text() == std::to_string(i));
+    }
+  }
+
+  WHEN("Reading after a sequence number")
+  {
+    std::vector<const rmf_task::Log::Entry*> entries;
+    const uint32_t seq = rmf_task::Log::ChunkSize + 3;
+    CHECK(view.entries_after(seq, entries) == total - seq - 1);
+    REQUIRE(!entries.empty());
+    CHECK(entries.front()->seq() == seq + 1);
+    CHECK(entries.back()->seq() == total - 1);
+
+    entries.clear();
+    CHECK(view.entries_after(total - 1, entries) == 0);
+    CHECK(entries.empty());
+  }
+
+  WHEN("Reading after an inserted entry")
+  {
+    std::vector<const rmf_task::Log::Entry*> entries;
+    rmf_task::Log other;
+    std::vector<const rmf_task::Log::Entry*> inserted;
+    view.entries_after(std::nullopt, inserted);
+    for (const auto* entry : inserted)
+      other.insert(*entry);
+
+    other.info("new");
+    const auto other_view = other.view();
+    CHECK(other_view.entries_after(total - 1, entries) == 1);
+    REQUIRE(entries.size() == 1);
+    CHECK(entries.front()->text() == "new");
+  }
+
+  WHEN("Using a reader")
+  {
+    std::vector<const rmf_task::Log::Entry*> entries;
+    rmf_task::Log::Reader reader;
+    CHECK(reader.read(view, entries) == total);
+    CHECK(reader.read(view, entries) == 0);
+
+    log.warn("one more");
+    CHECK(reader.read(log.view(), entries) == 1);
+    REQUIRE(entries.size() == total + 1);
+    CHECK(entries.back()->text() == "one more");
+  }
+}
+
+//==============================================================================
+SCENARIO("Deferred log formatting")
+{
+  rmf_task::Log log;
+  const rmf_task::Log::Format arrived("Arrived at waypoint {} with {} charge");
+  const rmf_task::Log::Format same("Arrived at waypoint {} with {} charge");
+  CHECK(&arrived.pattern() == &same.pattern());
+
+  const std::size_t waypoint = 12;
+  log.info(arrived, {waypoint, 0.5});
+  log.warn(arrived, {-3});
+  log.error(arrived, {"A", "B", "extra"});
+  log.info("plain text");
+  log.push(
+    rmf_task::Log::Tier::Info,
+    rmf_task::Log::Format("Waited {}"),
+    {rmf_traffic::time::from_seconds(2.0)});
+
+  std::vector<std::string> texts;
+  std::vector<rmf_task::Log::Tier> tiers;
+  for (const auto& entry : rmf_task::Log::Reader().read(log.view()))
+  {
+    texts.push_back(entry.text());
+    tiers.push_back(entry.tier());
+  }
+
+  REQUIRE(texts.size() == 5);
+  CHECK(texts[0] == "Arrived at waypoint 12 with 0.5 charge");
+  CHECK(texts[1] == "Arrived at waypoint -3 with {} charge");
+  CHECK(texts[2] == "Arrived at waypoint A with B charge extra");
+  CHECK(texts[3] == "plain text");
+  CHECK(texts[4] == "Waited 2s");
+  CHECK(tiers[1] == rmf_task::Log::Tier::Warning);
+  CHECK(tiers[2] == rmf_task::Log::Tier::Error);
+
+  // Copies of formatted entries keep their text
+  rmf_task::Log copy;
+  for (const auto& entry : rmf_task::Log::Reader().read(log.view()))
+    copy.insert(entry);
+
+  std::size_t index = 0;
+  for (const auto& entry : rmf_task::Log::Reader().read(copy.view()))
+  {
+    REQUIRE(index < texts.size());
+    CHECK(entry.text() == texts[index]);
+    ++index;
+  }
+  CHECK(index == texts.size());
+}
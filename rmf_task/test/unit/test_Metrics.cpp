@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/Log.hpp>
+#include <rmf_task/Metrics.hpp>
+
+#include <map>
+#include <string>
+#include <thread>
+
+namespace {
+
+//==============================================================================
+class RecordingSink : public rmf_task::Metrics::Sink
+{
+public:
+
+  void counter(const char* name, uint64_t value) final
+  {
+    counters[name] = value;
+  }
+
+  void histogram(
+    const char* name,
+    const rmf_task::Metrics::Histogram& value) final
+  {
+    histograms[name] = value;
+  }
+
+  std::map<std::string, uint64_t> counters;
+  std::map<std::string, rmf_task::Metrics::Histogram> histograms;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Aggregating metrics across threads")
+{
+  using Metrics = rmf_task::Metrics;
+  using namespace std::chrono_literals;
+
+  // The metrics belong to the whole process, so only their changes are
+  // checked
+  const auto plans = Metrics::total(Metrics::Counter::plans);
+  const auto entries = Metrics::total(Metrics::Counter::log_entries);
+  const auto latencies = Metrics::histogram(Metrics::Latency::plan);
+
+  Metrics::add(Metrics::Counter::plans, 2);
+  std::thread([]()
+    {
+      Metrics::add(Metrics::Counter::plans);
+      Metrics::observe(Metrics::Latency::plan, 3ms);
+    }).join();
+  Metrics::observe(Metrics::Latency::plan, 100s);
+
+  rmf_task::Log log;
+  log.info("hello");
+
+  CHECK(Metrics::total(Metrics::Counter::plans) == plans + 3);
+  CHECK(Metrics::total(Metrics::Counter::log_entries) == entries + 1);
+
+  const auto histogram = Metrics::histogram(Metrics::Latency::plan);
+  CHECK(histogram.count == latencies.count + 2);
+  CHECK(histogram.sum - latencies.sum == Approx(100.003));
+  CHECK(histogram.buckets.back() == latencies.buckets.back() + 1);
+
+  RecordingSink sink;
+  Metrics::scrape(sink);
+  CHECK(sink.counters.size() == Metrics::NumCounters);
+  CHECK(sink.histograms.size() == Metrics::NumLatencies);
+  CHECK(sink.counters.at(Metrics::name(Metrics::Counter::plans))
+    == plans + 3);
+  CHECK(sink.histograms.at("rmf_task_plan_seconds").count == histogram.count);
+}
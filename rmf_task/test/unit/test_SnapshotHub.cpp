@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/SnapshotHub.hpp>
+#include <rmf_task/events/SimpleEventState.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+namespace {
+//==============================================================================
+class TestPhase : public rmf_task::Phase::Active
+{
+public:
+
+  rmf_task::Phase::ConstTagPtr tag() const final
+  {
+    return _tag;
+  }
+
+  rmf_task::Event::ConstStatePtr final_event() const final
+  {
+    return event;
+  }
+
+  rmf_traffic::Duration estimate_remaining_time() const final
+  {
+    return std::chrono::seconds(5);
+  }
+
+  std::shared_ptr<rmf_task::events::SimpleEventState> event =
+    rmf_task::events::SimpleEventState::make(
+    0, "event", "", rmf_task::Event::Status::Underway);
+
+private:
+  rmf_task::Phase::ConstTagPtr _tag =
+    std::make_shared<rmf_task::Phase::Tag>(
+    0, rmf_task::Header("phase", "detail", std::chrono::seconds(10)));
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Publishing snapshots to many subscribers")
+{
+  using Buffer = rmf_task::SnapshotHub::Buffer;
+  using Snapshot = rmf_task::Phase::Snapshot;
+
+  rmf_task::SnapshotHub hub;
+  std::size_t text_encodings = 0;
+  hub.add_format("text",
+    [&text_encodings](const Snapshot& snapshot)
+    {
+      ++text_encodings;
+      const auto& category = snapshot.tag()->header().category();
+      return std::vector<uint8_t>(category.begin(), category.end());
+    });
+
+  std::vector<Buffer> received;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    hub.subscribe("cbor",
+      [&received](const std::string& task, const Buffer& buffer)
+      {
+        CHECK(task == "task");
+        received.push_back(buffer);
+      });
+  }
+
+  CHECK_THROWS_AS(
+    hub.subscribe("yaml", [](const std::string&, const Buffer&) {}),
+    std::invalid_argument);
+
+  TestPhase phase;
+  auto snapshot = Snapshot::make(phase);
+  hub.publish("task", snapshot);
+
+  // Every subscriber shares the one buffer that was encoded
+  REQUIRE(received.size() == 3);
+  CHECK(received[0] == received[1]);
+  CHECK(received[1] == received[2]);
+  CHECK(*received[0] == rmf_task::SnapshotHub::encode_cbor(*snapshot));
+  CHECK(hub.encodings() == 1);
+  CHECK(hub.latest("task") == snapshot);
+
+  // Formats without subscribers are only encoded when they are asked for
+  CHECK(text_encodings == 0);
+  const auto text = hub.encoded("task", "text");
+  REQUIRE(text);
+  CHECK(std::string(text->begin(), text->end()) == "phase");
+  CHECK(hub.encoded("task", "text") == text);
+  CHECK(text_encodings == 1);
+  CHECK(hub.encoded("task", "cbor") == received[0]);
+  CHECK(hub.encodings() == 2);
+
+  CHECK_FALSE(hub.encoded("other", "cbor"));
+  CHECK_THROWS_AS(hub.encoded("task", "yaml"), std::invalid_argument);
+
+  WHEN("The same snapshot is published again")
+  {
+    hub.publish("task", Snapshot::make(phase, snapshot));
+    CHECK(received.size() == 3);
+    CHECK(hub.encodings() == 2);
+  }
+
+  WHEN("A new snapshot is published")
+  {
+    phase.event->update_status(rmf_task::Event::Status::Completed);
+    hub.publish("task", Snapshot::make(phase, snapshot));
+    REQUIRE(received.size() == 6);
+    CHECK(received[3] != received[0]);
+    CHECK(hub.encodings() == 3);
+    CHECK(hub.encoded("task", "text") != text);
+    CHECK(text_encodings == 2);
+  }
+
+  WHEN("The task is erased")
+  {
+    hub.erase("task");
+    CHECK_FALSE(hub.latest("task"));
+    CHECK_FALSE(hub.encoded("task", "cbor"));
+  }
+}
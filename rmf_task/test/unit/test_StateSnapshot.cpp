@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/StateSnapshot.hpp>
+
+//==============================================================================
+SCENARIO("Sharing the state of a robot within a control tick")
+{
+  std::size_t waypoint = 0;
+  rmf_task::StateSnapshot snapshot(
+    [&waypoint]()
+    {
+      return rmf_task::State().waypoint(waypoint);
+    });
+
+  const auto get_state = snapshot.provider();
+  CHECK(snapshot.builds() == 0);
+
+  CHECK(get_state().waypoint() == 0u);
+  waypoint = 1;
+  CHECK(get_state().waypoint() == 0u);
+  CHECK(snapshot.get() == snapshot.get());
+  CHECK(snapshot.builds() == 1);
+
+  WHEN("A copy of the state is modified")
+  {
+    auto state = get_state();
+    state.waypoint(5);
+    CHECK(get_state().waypoint() == 0u);
+  }
+
+  WHEN("The next tick starts")
+  {
+    const auto previous = snapshot.get();
+    snapshot.tick();
+    CHECK(snapshot.builds() == 1);
+    CHECK(get_state().waypoint() == 1u);
+    CHECK(snapshot.builds() == 2);
+    CHECK(previous->waypoint() == 0u);
+    CHECK(snapshot.get() != previous);
+  }
+}
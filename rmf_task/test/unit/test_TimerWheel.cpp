@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/TimerWheel.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+SCENARIO("Timers fire on the tick that they expire")
+{
+  using namespace std::chrono_literals;
+  rmf_task::TimerWheel wheel(10ms);
+  CHECK(wheel.resolution() == 10ms);
+
+  std::vector<int> fired;
+  const auto record = [&](int value)
+    {
+      return [&, value]() { fired.push_back(value); };
+    };
+
+  // These land in every level of the wheel and beyond it
+  const std::vector<std::size_t> ticks = {1, 255, 256, 300, 70000, 20000000};
+  for (std::size_t i = 0; i < ticks.size(); ++i)
+    wheel.arm(ticks[i] * 10ms, record(static_cast<int>(i)));
+
+  const auto canceled = wheel.arm(1s, record(-1));
+  CHECK(wheel.size() == ticks.size() + 1);
+  CHECK(wheel.cancel(canceled));
+  CHECK_FALSE(wheel.cancel(canceled));
+  CHECK(wheel.size() == ticks.size());
+
+  std::size_t elapsed = 0;
+  for (std::size_t i = 0; i < ticks.size(); ++i)
+  {
+    // A timer does not fire one tick early
+    CHECK(wheel.advance(ticks[i] - 1 - elapsed) == 0);
+    CHECK(fired.size() == i);
+
+    CHECK(wheel.advance() == 1);
+    REQUIRE(fired.size() == i + 1);
+    CHECK(fired.back() == static_cast<int>(i));
+    elapsed = ticks[i];
+  }
+
+  CHECK(wheel.size() == 0);
+
+  WHEN("Many timers expire on the same tick")
+  {
+    std::size_t count = 0;
+    std::vector<rmf_task::TimerWheel::Id> ids;
+    for (std::size_t i = 0; i < 1000; ++i)
+      ids.push_back(wheel.arm(95ms, [&]() { ++count; }));
+
+    // Timers round up to the next tick
+    CHECK(wheel.advance(9) == 0);
+
+    for (std::size_t i = 0; i < ids.size(); i += 2)
+      CHECK(wheel.cancel(ids[i]));
+
+    THEN("The rest of them fire together")
+    {
+      CHECK(wheel.advance() == 500);
+      CHECK(count == 500);
+      CHECK_FALSE(wheel.cancel(ids[1]));
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("The shared timer wheel")
+{
+  using namespace std::chrono_literals;
+  auto& wheel = rmf_task::TimerWheel::shared();
+  CHECK(&wheel == &rmf_task::TimerWheel::shared());
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool fired = false;
+  bool canceled_fired = false;
+
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point fired_at;
+  wheel.arm(30ms, [&]()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      fired = true;
+      fired_at = std::chrono::steady_clock::now();
+      cv.notify_all();
+    });
+
+  CHECK(wheel.cancel(wheel.arm(10ms, [&]() { canceled_fired = true; })));
+
+  std::unique_lock<std::mutex> lock(mutex);
+  REQUIRE(cv.wait_for(lock, 5s, [&]() { return fired; }));
+  CHECK(fired_at - start >= 30ms);
+  CHECK_FALSE(canceled_fired);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/Trace.hpp>
+
+#include <thread>
+
+//==============================================================================
+SCENARIO("Recording trace spans")
+{
+  using Trace = rmf_task::Trace;
+
+  Trace::stop();
+  {
+    Trace::Span ignored("ignored");
+  }
+
+  Trace::start();
+  CHECK(Trace::recording());
+  CHECK(Trace::size() == 0);
+
+  {
+    Trace::Span outer("outer", "test");
+    std::thread([]() { Trace::Span inner("inner \"quoted\""); }).join();
+  }
+
+  Trace::stop();
+  CHECK_FALSE(Trace::recording());
+  {
+    Trace::Span late("late");
+  }
+
+  CHECK(Trace::size() == 2);
+  const auto json = Trace::chrome_json();
+  CHECK(json.find("\"traceEvents\"") != std::string::npos);
+  CHECK(json.find("\"name\":\"outer\",\"cat\":\"test\"") != std::string::npos);
+  CHECK(json.find("inner \\\"quoted\\\"") != std::string::npos);
+  CHECK(json.find("ignored") == std::string::npos);
+  CHECK(json.find("late") == std::string::npos);
+
+  WHEN("Recording starts again")
+  {
+    Trace::start();
+    CHECK(Trace::size() == 0);
+    Trace::stop();
+  }
+}
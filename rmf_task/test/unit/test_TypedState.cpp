@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/TypedState.hpp>
+
+namespace {
+RMF_TASK_DEFINE_COMPONENT(int, CustomComponent);
+} // anonymous namespace
+
+SCENARIO("Converting between State and TypedState")
+{
+  const auto now = std::chrono::steady_clock::now();
+  auto state = rmf_task::State().load_basic({now, 3, 0.5}, 7, 0.8);
+  state.with(CustomComponent(5));
+
+  const auto basic = rmf_task::BasicState::from(state);
+  REQUIRE(basic.get<rmf_task::State::CurrentWaypoint>());
+  CHECK(basic.get<rmf_task::State::CurrentWaypoint>()->value == 3);
+  CHECK(basic.get<rmf_task::State::CurrentTime>()->value == now);
+  CHECK(basic.get<rmf_task::State::CurrentBatterySoC>()->value == 0.8);
+  CHECK(!rmf_task::BasicState::has_component<CustomComponent>());
+
+  using CustomState = rmf_task::TypedState<
+    rmf_task::State::CurrentWaypoint, CustomComponent>;
+  auto custom = CustomState::from(state);
+  CHECK(custom.get<CustomComponent>()->value == 5);
+  CHECK(custom.erase<CustomComponent>());
+  CHECK(!custom.erase<CustomComponent>());
+  CHECK(custom.get<CustomComponent>() == nullptr);
+
+  custom.with(rmf_task::State::CurrentWaypoint(4));
+  const auto converted = custom.to_state();
+  CHECK(converted.waypoint() == 4);
+  CHECK(!converted.time().has_value());
+  CHECK(converted.get<CustomComponent>() == nullptr);
+
+  // Storing into an existing State keeps the components outside the schema
+  custom.store_in(state);
+  CHECK(state.waypoint() == 4);
+  CHECK(state.time() == now);
+  CHECK(state.get<CustomComponent>()->value == 5);
+
+  CHECK(rmf_task::BasicState::from(rmf_task::State())
+    .get<rmf_task::State::CurrentWaypoint>() == nullptr);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/UpdateCoalescer.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+SCENARIO("Coalescing phase updates")
+{
+  using namespace std::chrono_literals;
+
+  std::vector<int> updates;
+  std::vector<int> made;
+
+  // Each notification records its number when its snapshot gets made, and the
+  // update callback records the number of the last snapshot that was made
+  const auto notification = [&](int number)
+    {
+      return [&, number]() -> rmf_task::Phase::ConstSnapshotPtr
+        {
+          made.push_back(number);
+          return nullptr;
+        };
+    };
+
+  rmf_task::UpdateCoalescer coalescer(
+    [&](rmf_task::Phase::ConstSnapshotPtr)
+    {
+      updates.push_back(made.back());
+    }, 1h);
+
+  CHECK(coalescer.minimum_period() == 1h);
+
+  WHEN("The first notification arrives")
+  {
+    coalescer.notify(notification(0));
+
+    THEN("It is delivered right away")
+    {
+      CHECK(updates == std::vector<int>{0});
+      CHECK(coalescer.delivered() == 1);
+      CHECK(coalescer.suppressed() == 0);
+    }
+  }
+
+  WHEN("A burst of notifications arrives within the period")
+  {
+    for (int i = 0; i < 10; ++i)
+      coalescer.notify(notification(i));
+
+    THEN("Only the latest one is held and the rest are suppressed")
+    {
+      CHECK(updates == std::vector<int>{0});
+      CHECK(coalescer.suppressed() == 8);
+    }
+
+    coalescer.flush();
+
+    THEN("Flushing makes one snapshot for the latest notification")
+    {
+      CHECK(made == std::vector<int>({0, 9}));
+      CHECK(updates == std::vector<int>({0, 9}));
+      CHECK(coalescer.delivered() == 2);
+    }
+
+    coalescer.flush();
+    CHECK(coalescer.delivered() == 2);
+  }
+}
+
+//==============================================================================
+SCENARIO("Held phase updates are delivered at the end of the period")
+{
+  using namespace std::chrono_literals;
+
+  std::mutex mutex;
+  std::condition_variable delivered;
+  std::size_t update_count = 0;
+
+  const auto snapshot = rmf_task::Phase::ConstSnapshotPtr();
+  std::size_t made = 0;
+
+  rmf_task::UpdateCoalescer coalescer(
+    [&](rmf_task::Phase::ConstSnapshotPtr)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++update_count;
+      delivered.notify_all();
+    }, 50ms);
+
+  const auto make = [&]() { ++made; return snapshot; };
+
+  coalescer.notify(make);
+  coalescer.notify(make);
+  coalescer.notify(make);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    CHECK(update_count == 1);
+    CHECK(delivered.wait_for(lock, 5s, [&]() { return update_count == 2; }));
+  }
+
+  CHECK(made == 2);
+  CHECK(coalescer.suppressed() == 1);
+
+  WHEN("The coalescer is destroyed while it holds a notification")
+  {
+    std::size_t late_updates = 0;
+    {
+      rmf_task::UpdateCoalescer short_lived(
+        [&](rmf_task::Phase::ConstSnapshotPtr) { ++late_updates; }, 10ms);
+
+      short_lived.notify(snapshot);
+      short_lived.notify(snapshot);
+    }
+
+    std::this_thread::sleep_for(50ms);
+
+    THEN("The held notification is dropped")
+    {
+      CHECK(late_updates == 1);
+    }
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task/VersionedString.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+//==============================================================================
+SCENARIO("Reading versioned strings")
+{
+  rmf_task::VersionedString string("first");
+  CHECK(string.version() == 0);
+
+  rmf_task::VersionedString::Reader reader;
+  const auto view = string.view();
+  CHECK(view.version() == 0);
+
+  const auto first = reader.read(view);
+  REQUIRE(first);
+  CHECK(*first == "first");
+  CHECK_FALSE(reader.read(view));
+  CHECK_FALSE(reader.read(string.view()));
+
+  string.update("second");
+  CHECK(string.version() == 1);
+  CHECK(view.version() == 0);
+
+  const auto second = reader.read(string.view());
+  REQUIRE(second);
+  CHECK(*second == "second");
+  CHECK(*first == "first");
+
+  // A different reader sees the current value
+  const auto other = rmf_task::VersionedString::Reader().read(view);
+  REQUIRE(other);
+  CHECK(*other == "first");
+}
+
+//==============================================================================
+SCENARIO("Updating and reading versioned strings on different threads")
+{
+  rmf_task::VersionedString string("0");
+  const uint64_t final_version = 10000;
+
+  std::thread updater(
+    [&string, final_version]()
+    {
+      for (uint64_t i = 1; i <= final_version; ++i)
+        string.update(std::to_string(i));
+    });
+
+  rmf_task::VersionedString::Reader reader;
+  uint64_t last_version = 0;
+  bool consistent = true;
+  bool increasing = true;
+  while (last_version < final_version)
+  {
+    if (string.version() == last_version)
+      continue;
+
+    const auto view = string.view();
+    increasing = increasing && view.version() > last_version;
+    last_version = view.version();
+
+    const auto value = reader.read(view);
+    consistent = consistent && value
+      && *value == std::to_string(view.version());
+  }
+
+  updater.join();
+  CHECK(consistent);
+  CHECK(increasing);
+  CHECK(string.version() == final_version);
+}
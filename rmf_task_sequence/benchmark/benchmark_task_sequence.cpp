@@ -0,0 +1,478 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+// Benchmarks the execution side of composed tasks: activating a
+// Task::Description through an rmf_task::Activator, taking Phase::Snapshots,
+// generating and restoring backups, and making the models that the planner
+// uses.
+//
+// Each benchmark is parametrized by:
+//   0: the number of events in the task
+//   1: the number of events in each phase, which are run as a Bundle sequence
+//
+// The restore benchmark has one more argument:
+//   2: whether the backup skips schema validation because its checksum is
+//      trusted
+//
+// The events finish whenever the benchmark tells them to, so the measurements
+// only include the work of rmf_task_sequence itself.
+
+#include <rmf_task/Activator.hpp>
+#include <rmf_task/events/SimpleEventState.hpp>
+
+#include <rmf_task_sequence/Event.hpp>
+#include <rmf_task_sequence/Task.hpp>
+#include <rmf_task_sequence/events/Bundle.hpp>
+#include <rmf_task_sequence/events/WaitFor.hpp>
+#include <rmf_task_sequence/phases/SimplePhase.hpp>
+
+#include <rmf_battery/agv/BatterySystem.hpp>
+#include <rmf_battery/agv/MechanicalSystem.hpp>
+#include <rmf_battery/agv/PowerSystem.hpp>
+#include <rmf_battery/agv/SimpleDevicePowerSink.hpp>
+#include <rmf_battery/agv/SimpleMotionPowerSink.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+//==============================================================================
+rmf_traffic::Time now()
+{
+  return std::chrono::steady_clock::now();
+}
+
+//==============================================================================
+// An event that waits until the benchmark finishes it
+class BenchmarkEvent
+{
+public:
+
+  class Active;
+
+  class Description : public rmf_task_sequence::Event::Description
+  {
+  public:
+
+    rmf_task_sequence::Activity::ConstModelPtr make_model(
+      rmf_task::State invariant_initial_state,
+      const rmf_task::Parameters& parameters) const final
+    {
+      return rmf_task_sequence::events::WaitFor::Description::make(
+        std::chrono::seconds(10))->make_model(
+        std::move(invariant_initial_state), parameters);
+    }
+
+    rmf_task::Header generate_header(
+      const rmf_task::State&,
+      const rmf_task::Parameters&) const final
+    {
+      return rmf_task::Header(
+        "Benchmark event", "Waiting for the benchmark",
+        std::chrono::seconds(10));
+    }
+  };
+
+  class Active : public rmf_task_sequence::Event::Active
+  {
+  public:
+
+    Active(
+      rmf_task::events::SimpleEventStatePtr state_,
+      std::function<void()> finished_)
+    : state_data(std::move(state_)),
+      finished(std::move(finished_))
+    {
+      state_data->update_status(rmf_task::Event::Status::Underway);
+    }
+
+    rmf_task::Event::ConstStatePtr state() const final
+    {
+      return state_data;
+    }
+
+    rmf_traffic::Duration remaining_time_estimate() const final
+    {
+      return std::chrono::seconds(10);
+    }
+
+    Backup backup() const final
+    {
+      return Backup::make(0, nlohmann::json());
+    }
+
+    Resume interrupt(std::function<void()> task_is_interrupted) final
+    {
+      task_is_interrupted();
+      return Resume::make([]() {});
+    }
+
+    void cancel() final
+    {
+      state_data->update_status(rmf_task::Event::Status::Canceled);
+      finished();
+    }
+
+    void kill() final
+    {
+      state_data->update_status(rmf_task::Event::Status::Killed);
+      finished();
+    }
+
+    void complete()
+    {
+      state_data->update_status(rmf_task::Event::Status::Completed);
+      finished();
+    }
+
+    rmf_task::events::SimpleEventStatePtr state_data;
+    std::function<void()> finished;
+  };
+
+  class Standby : public rmf_task_sequence::Event::Standby
+  {
+  public:
+
+    Standby(rmf_task::events::SimpleEventStatePtr state_)
+    : state_data(std::move(state_))
+    {
+      // Do nothing
+    }
+
+    rmf_task::Event::ConstStatePtr state() const final
+    {
+      return state_data;
+    }
+
+    rmf_traffic::Duration duration_estimate() const final
+    {
+      return std::chrono::seconds(10);
+    }
+
+    rmf_task_sequence::Event::ActivePtr begin(
+      std::function<void()>,
+      std::function<void()> finished) final
+    {
+      return make_active(state_data, std::move(finished));
+    }
+
+    rmf_task::events::SimpleEventStatePtr state_data;
+  };
+
+  static rmf_task::events::SimpleEventStatePtr make_state(
+    const rmf_task::Event::AssignIDPtr& id)
+  {
+    return rmf_task::events::SimpleEventState::make(
+      id->assign(), "Benchmark event", "Waiting for the benchmark",
+      rmf_task::Event::Status::Standby);
+  }
+
+  static std::shared_ptr<Active> make_active(
+    rmf_task::events::SimpleEventStatePtr state,
+    std::function<void()> finished)
+  {
+    auto active =
+      std::make_shared<Active>(std::move(state), std::move(finished));
+    current = active;
+    return active;
+  }
+
+  static void add(const rmf_task_sequence::Event::InitializerPtr& initializer)
+  {
+    initializer->add<Description>(
+      [](
+        const rmf_task::Event::AssignIDPtr& id,
+        const std::function<rmf_task::State()>&,
+        const rmf_task::ConstParametersPtr&,
+        const Description&,
+        std::function<void()>)
+      {
+        return std::make_shared<Standby>(make_state(id));
+      },
+      [](
+        const rmf_task::Event::AssignIDPtr& id,
+        const std::function<rmf_task::State()>&,
+        const rmf_task::ConstParametersPtr&,
+        const Description&,
+        const nlohmann::json&,
+        std::function<void()>,
+        std::function<void()>,
+        std::function<void()> finished)
+      {
+        return make_active(make_state(id), std::move(finished));
+      });
+  }
+
+  // The event that began most recently. The benchmarks run on one thread.
+  static std::shared_ptr<Active> current;
+};
+
+std::shared_ptr<BenchmarkEvent::Active> BenchmarkEvent::current;
+
+//==============================================================================
+rmf_task::ConstParametersPtr make_parameters()
+{
+  const auto battery_system =
+    rmf_battery::agv::BatterySystem::make(24.0, 40.0, 8.8).value();
+  const auto mechanical_system =
+    rmf_battery::agv::MechanicalSystem::make(70.0, 40.0, 0.22).value();
+  const auto power_system = rmf_battery::agv::PowerSystem::make(20.0).value();
+
+  return std::make_shared<rmf_task::Parameters>(
+    nullptr,
+    battery_system,
+    std::make_shared<rmf_battery::agv::SimpleMotionPowerSink>(
+      battery_system, mechanical_system),
+    std::make_shared<rmf_battery::agv::SimpleDevicePowerSink>(
+      battery_system, power_system));
+}
+
+//==============================================================================
+rmf_task::State make_state()
+{
+  return rmf_task::State()
+    .time(now())
+    .waypoint(0)
+    .orientation(0.0)
+    .dedicated_charging_waypoint(0)
+    .battery_soc(1.0);
+}
+
+//==============================================================================
+// A task with the given number of events, split into phases that each run a
+// sequence of events
+rmf_task::Task::ConstDescriptionPtr make_description(
+  const std::size_t num_events,
+  const std::size_t events_per_phase)
+{
+  rmf_task_sequence::Task::Builder builder;
+  for (std::size_t begin = 0; begin < num_events; begin += events_per_phase)
+  {
+    const std::size_t end = std::min(begin + events_per_phase, num_events);
+    std::vector<rmf_task_sequence::Event::ConstDescriptionPtr> events;
+    for (std::size_t i = begin; i < end; ++i)
+      events.push_back(std::make_shared<BenchmarkEvent::Description>());
+
+    builder.add_phase(
+      rmf_task_sequence::phases::SimplePhase::Description::make(
+        std::make_shared<rmf_task_sequence::events::Bundle::Description>(
+          std::move(events),
+          rmf_task_sequence::events::Bundle::Type::Sequence)),
+      {});
+  }
+
+  return builder.build("Benchmark task", "A long composed task");
+}
+
+//==============================================================================
+struct Fixture
+{
+  Fixture(
+    const std::size_t num_events,
+    const std::size_t events_per_phase,
+    const bool trusted_restore = false)
+  : parameters(make_parameters()),
+    request(
+      "benchmark_request", now(), nullptr,
+      make_description(num_events, events_per_phase))
+  {
+    const auto initializer =
+      std::make_shared<rmf_task_sequence::Event::Initializer>();
+    rmf_task_sequence::events::Bundle::add(initializer);
+    BenchmarkEvent::add(initializer);
+
+    const auto phase_activator =
+      std::make_shared<rmf_task_sequence::Phase::Activator>();
+    rmf_task_sequence::phases::SimplePhase::add(*phase_activator, initializer);
+
+    rmf_task_sequence::Task::add(
+      activator, phase_activator, now, std::nullopt,
+      rmf_task_sequence::Task::BackupEncoding::Json, trusted_restore);
+  }
+
+  rmf_task::Task::ActivePtr activate() const
+  {
+    return activator.activate(
+      make_state, parameters, request,
+      [](rmf_task::Phase::ConstSnapshotPtr) {},
+      [](rmf_task::Task::Active::Backup) {},
+      [](rmf_task::Phase::ConstCompletedPtr) {},
+      []() {});
+  }
+
+  rmf_task::Task::ActivePtr restore(std::string backup) const
+  {
+    return activator.restore(
+      make_state, parameters, request, std::move(backup),
+      [](rmf_task::Phase::ConstSnapshotPtr) {},
+      [](rmf_task::Task::Active::Backup) {},
+      [](rmf_task::Phase::ConstCompletedPtr) {},
+      []() {});
+  }
+
+  rmf_task::ConstParametersPtr parameters;
+  rmf_task::Request request;
+  rmf_task::Activator activator;
+};
+
+//==============================================================================
+void BM_Activate(benchmark::State& state)
+{
+  const Fixture fixture(state.range(0), state.range(1));
+  for (auto _ : state)
+  {
+    auto task = fixture.activate();
+    benchmark::DoNotOptimize(task);
+  }
+
+  BenchmarkEvent::current.reset();
+}
+
+//==============================================================================
+// Take a snapshot of the active phase after its current event logs something,
+// sharing the events that have not changed with the previous snapshot
+void BM_Snapshot(benchmark::State& state)
+{
+  const Fixture fixture(state.range(0), state.range(1));
+  const auto task = fixture.activate();
+  const auto phase = task->active_phase();
+  auto snapshot = rmf_task::Phase::Snapshot::make(*phase);
+  for (auto _ : state)
+  {
+    BenchmarkEvent::current->state_data->update_log().info("progress");
+    snapshot = rmf_task::Phase::Snapshot::make(*phase, snapshot);
+    benchmark::DoNotOptimize(snapshot);
+  }
+
+  BenchmarkEvent::current.reset();
+}
+
+//==============================================================================
+void BM_Backup(benchmark::State& state)
+{
+  const Fixture fixture(state.range(0), state.range(1));
+  const auto task = fixture.activate();
+  std::size_t bytes = 0;
+  for (auto _ : state)
+  {
+    const auto backup = task->backup();
+    bytes = backup.state().size();
+    benchmark::DoNotOptimize(backup);
+  }
+
+  state.counters["backup_bytes"] = static_cast<double>(bytes);
+  BenchmarkEvent::current.reset();
+}
+
+//==============================================================================
+// Restore a task from a backup that was taken partway through its first phase
+void BM_Restore(benchmark::State& state)
+{
+  const Fixture fixture(state.range(0), state.range(1), state.range(2) != 0);
+  std::string backup;
+  {
+    const auto task = fixture.activate();
+    BenchmarkEvent::current->complete();
+    backup = task->backup().state();
+  }
+
+  for (auto _ : state)
+  {
+    auto task = fixture.restore(backup);
+    benchmark::DoNotOptimize(task);
+  }
+
+  BenchmarkEvent::current.reset();
+}
+
+//==============================================================================
+void BM_MakeModel(benchmark::State& state)
+{
+  const Fixture fixture(state.range(0), state.range(1));
+  const auto& description = *fixture.request.description();
+  for (auto _ : state)
+  {
+    auto model = description.make_model(now(), *fixture.parameters);
+    benchmark::DoNotOptimize(model);
+  }
+}
+
+//==============================================================================
+void task_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int events : {10, 100, 1000})
+  {
+    for (const int events_per_phase : {1, 10, 100})
+    {
+      if (events_per_phase <= events)
+        b->Args({events, events_per_phase});
+    }
+  }
+}
+
+//==============================================================================
+void restore_arguments(benchmark::internal::Benchmark* b)
+{
+  for (const int events : {10, 100, 1000})
+  {
+    for (const int events_per_phase : {1, 10, 100})
+    {
+      if (events_per_phase > events)
+        continue;
+
+      for (const int trusted : {0, 1})
+        b->Args({events, events_per_phase, trusted});
+    }
+  }
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_Activate)
+->Name("Task/activate")
+->ArgNames({"events", "events_per_phase"})
+->Apply(task_arguments)
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Snapshot)
+->Name("Task/snapshot")
+->ArgNames({"events", "events_per_phase"})
+->Apply(task_arguments)
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Backup)
+->Name("Task/backup")
+->ArgNames({"events", "events_per_phase"})
+->Apply(task_arguments)
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Restore)
+->Name("Task/restore")
+->ArgNames({"events", "events_per_phase", "trusted"})
+->Apply(restore_arguments)
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_MakeModel)
+->Name("Task/make_model")
+->ArgNames({"events", "events_per_phase"})
+->Apply(task_arguments)
+->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -117,6 +117,17 @@ public:
     State invariant_initial_state,
     const Parameters& parameters) const = 0;
 
+  /// Get the invariant finish state that the model of make_model(~) would
+  /// have for this initial state, if it can be known without making the
+  /// model. SequenceModel uses this to make the models of the activities that
+  /// come after this one while this model is being made.
+  ///
+  /// The default implementation returns std::nullopt, which means that the
+  /// model needs to be made to find out its invariant finish state.
+  virtual std::optional<State> predict_invariant_finish_state(
+    const State& invariant_initial_state,
+    const Parameters& parameters) const;
+
   /// Generate human-friendly header information for this Activity.
   ///
   /// \param[in] initial_state
@@ -186,10 +197,29 @@ public:
   /// \param[in] parameters
   ///   The parameters for the robot
   ///
+  /// \param[in] num_threads
+  ///   The number of threads that may make the models of the descriptions at
+  ///   the same time. A model can be made as soon as the invariant finish
+  ///   state of the one before it is known, either from
+  ///   Description::predict_invariant_finish_state(~) or by making that model
+  ///   first. With 1, which is the default, the models are made one at a time
+  ///   by the calling thread. Pass 0 to use one thread per hardware thread.
+  ///
   /// \return A Phase::Model implemented as a SequenceModel.
   static ConstModelPtr make(
     const std::vector<ConstDescriptionPtr>& descriptions,
     State invariant_initial_state,
+    const Parameters& parameters,
+    std::size_t num_threads = 1);
+
+  /// Chain Description::predict_invariant_finish_state(~) through a sequence
+  /// of descriptions.
+  ///
+  /// \return the invariant finish state of the whole sequence, or
+  /// std::nullopt if any of the descriptions cannot predict its own.
+  static std::optional<State> predict_invariant_finish_state(
+    const std::vector<ConstDescriptionPtr>& descriptions,
+    const State& invariant_initial_state,
     const Parameters& parameters);
 
   // Documentation inherited
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK_SEQUENCE__DESCRIPTIONREGISTRY_HPP
+#define RMF_TASK_SEQUENCE__DESCRIPTIONREGISTRY_HPP
+
+#include <rmf_task_sequence/Phase.hpp>
+#include <rmf_task_sequence/Task.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+#include <string>
+
+namespace rmf_task_sequence {
+
+//==============================================================================
+/// Turns the json descriptions of phases into Phase::Description instances.
+/// Each category of phase is registered once with the schema of its json and
+/// a function that builds its description. The validator of each schema is
+/// compiled when the category is added instead of each time that a
+/// description gets parsed.
+///
+/// When a cache capacity is given, the descriptions that were parsed most
+/// recently are remembered by their category and content. Parsing the same
+/// json again gives back the same description without validating it or
+/// calling the deserializer, which helps when many tasks are made from a few
+/// templates. This relies on the deserializers being pure functions of their
+/// json.
+///
+/// A registry can be used by several threads at once as long as no category
+/// is being added at the same time.
+class DescriptionRegistry
+{
+public:
+
+  /// The signature of a function that builds a phase description from json
+  /// that has already been validated against the schema of its category
+  using Deserializer =
+    std::function<Phase::ConstDescriptionPtr(const nlohmann::json&)>;
+
+  /// Constructor
+  ///
+  /// \param[in] cache_capacity
+  ///   The greatest number of parsed descriptions to remember. Use 0 to turn
+  ///   off the cache.
+  DescriptionRegistry(std::size_t cache_capacity = 0);
+
+  /// Add a category of phase to the registry. If the category was already
+  /// added, it is replaced and any cached descriptions of it are forgotten.
+  ///
+  /// \param[in] category
+  ///   The name of the category
+  ///
+  /// \param[in] schema
+  ///   The json schema that descriptions of this category must satisfy
+  ///
+  /// \param[in] deserializer
+  ///   The function that builds the description
+  ///
+  /// \throws std::invalid_argument if the schema cannot be compiled or the
+  ///   deserializer is empty.
+  DescriptionRegistry& add(
+    std::string category,
+    const nlohmann::json& schema,
+    Deserializer deserializer);
+
+  /// Check whether a category has been added
+  bool has(const std::string& category) const;
+
+  /// Parse the description of one phase
+  ///
+  /// \param[in] category
+  ///   The category of the phase
+  ///
+  /// \param[in] description
+  ///   The json description of the phase
+  ///
+  /// \throws std::invalid_argument if the category was never added, the json
+  ///   does not satisfy the schema of the category, or the deserializer does
+  ///   not produce a description.
+  Phase::ConstDescriptionPtr parse(
+    const std::string& category,
+    const nlohmann::json& description) const;
+
+  /// Parse a whole task in a single pass. The json must have this layout:
+  ///
+  /// \code{.json}
+  /// {
+  ///   "category": "...",
+  ///   "detail": "...",
+  ///   "phases": [
+  ///     {
+  ///       "category": "...",
+  ///       "description": { ... },
+  ///       "on_cancel": [ { "category": "...", "description": { ... } } ]
+  ///     }
+  ///   ]
+  /// }
+  /// \endcode
+  ///
+  /// where "detail" and each "on_cancel" may be left out.
+  ///
+  /// \throws std::invalid_argument if the layout is wrong or any of the
+  ///   phases fails to parse.
+  Task::DescriptionPtr parse_task(const nlohmann::json& task) const;
+
+  /// The number of descriptions that are currently cached
+  std::size_t cache_size() const;
+
+  /// Forget all of the cached descriptions
+  void clear_cache();
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_task_sequence
+
+#endif // RMF_TASK_SEQUENCE__DESCRIPTIONREGISTRY_HPP
@@ -208,11 +208,24 @@ public:
     >;
 
   /// Add a callback to convert from a Description to an event in standby mode
+  ///
+  /// \throws std::runtime_error if the Initializer is frozen and it does not
+  /// have callbacks for this Description yet.
   template<typename Desc>
   void add(
     Initialize<Desc> initializer,
     Restore<Desc> restorer);
 
+  /// Freeze the set of Description types that this Initializer supports, so
+  /// that finding the callbacks of a description compares the address of its
+  /// type against a sorted array instead of hashing it. The callbacks of
+  /// types that were already added can still be replaced, but no new types
+  /// can be added.
+  void freeze();
+
+  /// True if freeze() has been called on this Initializer
+  bool frozen() const;
+
   /// Initialize an event
   ///
   /// \param[in] id
@@ -289,7 +302,7 @@ public:
 private:
   /// \private
   void _add(
-    std::type_index type,
+    const std::type_info& type,
     Initialize<Event::Description> initializer,
     Restore<Event::Description> restorer);
 
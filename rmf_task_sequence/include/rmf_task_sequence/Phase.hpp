@@ -112,9 +112,22 @@ public:
   ///
   /// \tparam Description
   ///   A class that implements the sequence::PhaseDescription interface
+  ///
+  /// \throws std::runtime_error if the Activator is frozen and it does not
+  /// have an activator for this Description yet.
   template<typename Description>
   void add_activator(Activate<Description> activator);
 
+  /// Freeze the set of Description types that this Activator supports, so
+  /// that finding the activator of a description compares the address of its
+  /// type against a sorted array instead of hashing it. The activators of
+  /// types that were already added can still be replaced, but no new types
+  /// can be added.
+  void freeze();
+
+  /// True if freeze() has been called on this Activator
+  bool frozen() const;
+
   /// Activate a phase based on a description of the phase.
   ///
   /// \param[in] get_state
@@ -160,7 +173,7 @@ private:
 
   /// \private
   void _add_activator(
-    std::type_index type,
+    const std::type_info& type,
     Activate<Phase::Description> activator);
 
   rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -49,6 +49,18 @@ public:
   using PhaseFinished = std::function<void(Phase::ConstCompletedPtr)>;
   using TaskFinished = std::function<void()>;
 
+  /// How the backups of phase sequence tasks are encoded. Tasks can be
+  /// restored from backups in either encoding, whichever one they use.
+  enum class BackupEncoding : uint8_t
+  {
+    /// JSON text, which is easy to read and edit by hand
+    Json,
+
+    /// CBOR, which is more compact and faster to write and parse than JSON
+    /// text. The backup begins with the CBOR self-described tag.
+    Cbor
+  };
+
   /// Make an activator for a phase sequence task. This activator can be given
   /// to the rmf_task::Activator class to activate phase sequence tasks from
   /// phase sequence descriptions.
@@ -62,9 +74,31 @@ public:
   ///
   /// \param[in] clock
   ///   A callback that gives the current time when called.
+  ///
+  /// \param[in] minimum_update_period
+  ///   If this is set, the phase snapshots of each task will be given to the
+  ///   update callback at most once per period. Changes that arrive faster
+  ///   than that are coalesced so that only a snapshot of the latest state is
+  ///   delivered, and rmf_task::Task::Active::suppressed_updates() counts the
+  ///   snapshots that were skipped. Changes of phase are always delivered
+  ///   right away.
+  ///
+  /// \param[in] backup_encoding
+  ///   How the task backups should be encoded
+  ///
+  /// \param[in] trusted_restore
+  ///   If true, each task backup carries a checksum of its contents, and a
+  ///   backup whose checksum matches is restored without validating it and
+  ///   its phases and events against their schemas. Backups with no checksum
+  ///   or a checksum that does not match are still fully validated. The
+  ///   checksum protects against corruption, not against deliberate changes,
+  ///   so this should only be used for backups that this system wrote itself.
   static rmf_task::Activator::Activate<Description> make_activator(
     Phase::ConstActivatorPtr phase_activator,
-    std::function<rmf_traffic::Time()> clock);
+    std::function<rmf_traffic::Time()> clock,
+    std::optional<rmf_traffic::Duration> minimum_update_period = std::nullopt,
+    BackupEncoding backup_encoding = BackupEncoding::Json,
+    bool trusted_restore = false);
 
   /// Add this task type to an Activator. This is an alternative to using
   /// make_activator(~).
@@ -81,10 +115,24 @@ public:
   ///
   /// \param[in] clock
   ///   A callback that gives the current time when called.
+  ///
+  /// \param[in] minimum_update_period
+  ///   The least amount of time between the updates of each task. See
+  ///   make_activator(~).
+  ///
+  /// \param[in] backup_encoding
+  ///   How the task backups should be encoded
+  ///
+  /// \param[in] trusted_restore
+  ///   Whether backups with a matching checksum skip schema validation. See
+  ///   make_activator(~).
   static void add(
     rmf_task::Activator& activator,
     Phase::ConstActivatorPtr phase_activator,
-    std::function<rmf_traffic::Time()> clock);
+    std::function<rmf_traffic::Time()> clock,
+    std::optional<rmf_traffic::Duration> minimum_update_period = std::nullopt,
+    BackupEncoding backup_encoding = BackupEncoding::Json,
+    bool trusted_restore = false);
 
   /// Give an initializer the ability to build a sequence task for some other
   /// task description.
@@ -105,12 +153,26 @@ public:
   ///
   /// \param[in] clock
   ///   A callback that gives the current time when called
+  ///
+  /// \param[in] minimum_update_period
+  ///   The least amount of time between the updates of each task. See
+  ///   make_activator(~).
+  ///
+  /// \param[in] backup_encoding
+  ///   How the task backups should be encoded
+  ///
+  /// \param[in] trusted_restore
+  ///   Whether backups with a matching checksum skip schema validation. See
+  ///   make_activator(~).
   template<typename OtherDesc>
   static void unfold(
     std::function<Description(const OtherDesc&)> unfold_description,
     rmf_task::Activator& activator,
     Phase::ConstActivatorPtr phase_activator,
-    std::function<rmf_traffic::Time()> clock);
+    std::function<rmf_traffic::Time()> clock,
+    std::optional<rmf_traffic::Duration> minimum_update_period = std::nullopt,
+    BackupEncoding backup_encoding = BackupEncoding::Json,
+    bool trusted_restore = false);
 
 };
 
@@ -178,6 +240,17 @@ public:
   /// Change the details for this task
   Description& detail(std::string new_detail);
 
+  /// Get the number of threads that make_model(~) uses to make the models of
+  /// the phases of this task.
+  std::size_t model_threads() const;
+
+  /// Change the number of threads that make_model(~) uses to make the models
+  /// of the phases of this task. See Activity::SequenceModel::make(~) for how
+  /// the models get split between the threads. The default is 1, which makes
+  /// the models one at a time on the thread that calls make_model(~). Pass 0
+  /// to use one thread per hardware thread.
+  Description& model_threads(std::size_t num_threads);
+
   Header generate_header(
     const State& initial_state,
     const Parameters& parameters) const;
@@ -55,6 +55,11 @@ public:
   /// Get the YAML representation of the backed up state
   const nlohmann::json& state() const;
 
+  /// Move the backed up state out of this Backup, leaving a null state behind.
+  /// This lets a parent phase or event embed the state of a child in its own
+  /// backup without copying it.
+  nlohmann::json release_state();
+
   class Implementation;
 private:
   Backup();
@@ -28,10 +28,14 @@ void Task::unfold(
   std::function<Description(const OtherDesc&)> unfold_description,
   rmf_task::Activator& task_activator,
   Phase::ConstActivatorPtr phase_activator,
-  std::function<rmf_traffic::Time()> clock)
+  std::function<rmf_traffic::Time()> clock,
+  std::optional<rmf_traffic::Duration> minimum_update_period,
+  BackupEncoding backup_encoding,
+  bool trusted_restore)
 {
-  auto sequence_activator =
-    make_activator(std::move(phase_activator), std::move(clock));
+  auto sequence_activator = make_activator(
+    std::move(phase_activator), std::move(clock), minimum_update_period,
+    backup_encoding, trusted_restore);
 
   task_activator.add_activator<OtherDesc>(
     [
@@ -41,13 +41,13 @@ public:
 
     /// The bundle will execute its dependencies in parallel and will finish
     /// when all of its dependencies are finished.
-    // (Not implemented yet)
-//    ParallelAll,
+    ParallelAll,
 
-    /// The bundle will execute its dependencies in parallel and will finished
-    /// when any (one or more) of its dependencies finishes.
-    // (Not implemented yet)
-//    ParallelAny
+    /// The bundle will execute its dependencies in parallel and will finish
+    /// when any (one or more) of its dependencies completes. The dependencies
+    /// that have not finished by then are canceled, and the bundle finishes
+    /// once all of them have wrapped up.
+    ParallelAny
   };
 
   class Description;
@@ -148,13 +148,16 @@ public:
   ///
   /// \warning It is not recommended to use this function directly. You should
   /// consider using add(~) or unfold(~) with an initializer instead.
+  ///
+  /// The backup_state is the structured state that the Bundle gave out in its
+  /// backup, so nested bundles are restored without any text being parsed.
   static Event::ActivePtr restore(
     const Event::Initializer& initializer,
     const Event::AssignIDPtr& id,
     const std::function<rmf_task::State()>& get_state,
     const ConstParametersPtr& parameters,
     const Bundle::Description& description,
-    const std::string& backup,
+    const nlohmann::json& backup_state,
     std::function<void()> update,
     std::function<void()> checkpoint,
     std::function<void()> finished);
@@ -217,6 +220,11 @@ public:
     rmf_task::State invariant_initial_state,
     const Parameters& parameters) const final;
 
+  // Documentation inherited
+  std::optional<rmf_task::State> predict_invariant_finish_state(
+    const rmf_task::State& invariant_initial_state,
+    const Parameters& parameters) const final;
+
   // Documentation inherited
   Header generate_header(
     const rmf_task::State& initial_state,
@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK_SEQUENCE__EVENTS__COROUTINE_HPP
+#define RMF_TASK_SEQUENCE__EVENTS__COROUTINE_HPP
+
+// The coroutine adapter is only available to code that is compiled with C++20
+// coroutine support. The rest of the library does not depend on it.
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define RMF_TASK_SEQUENCE__HAS_COROUTINES
+#endif
+#endif
+
+#ifdef RMF_TASK_SEQUENCE__HAS_COROUTINES
+
+#include <rmf_task/Executor.hpp>
+#include <rmf_task/events/SimpleEventState.hpp>
+
+#include <rmf_task_sequence/Event.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <variant>
+
+namespace rmf_task_sequence {
+namespace events {
+
+//==============================================================================
+/// The Coroutine namespace class lets an event be written as a single C++20
+/// coroutine instead of a hand-written pair of Event::Standby and Event::Active
+/// classes. The coroutine is given a Context, and it co_awaits a Trigger
+/// whenever it needs to wait for something, such as the robot arriving at a
+/// place, an action finishing, or a timeout.
+///
+/// While the coroutine is suspended it does not hold on to any thread. When a
+/// Trigger fires, the coroutine is resumed on the executor of the event, or
+/// on the thread that fired the Trigger if the event has no executor.
+///
+/// \code
+/// Coroutine::Task go(Coroutine::ContextPtr context)
+/// {
+///   auto arrived = context->trigger<bool>();
+///   start_travel([arrived](bool success) mutable { arrived.set(success); });
+///
+///   const auto result = co_await context->with_timeout(arrived, 5min);
+///   if (!result.has_value() || !*result)
+///     context->state().update_status(Event::Status::Error);
+/// }
+/// \endcode
+///
+/// This adapter is header-only so that the library itself does not need to be
+/// built with C++20.
+class Coroutine
+{
+public:
+
+  class Context;
+  using ContextPtr = std::shared_ptr<Context>;
+
+  class Task;
+
+  template<typename T = std::monostate>
+  class Trigger;
+
+  /// The signature of a coroutine that performs an event
+  using Body = std::function<Task(ContextPtr context)>;
+
+  /// Make a standby event that performs a coroutine once it begins.
+  ///
+  /// \param[in] body
+  ///   The coroutine that performs the event. It is not called until the event
+  ///   begins.
+  ///
+  /// \param[in] state
+  ///   The state of the event. The event will be Underway while the coroutine
+  ///   runs. If the coroutine returns while the event is still Underway, the
+  ///   event becomes Completed, Canceled, or Killed depending on what was asked
+  ///   of it. If the coroutine throws, the event becomes Failed.
+  ///
+  /// \param[in] duration_estimate
+  ///   The estimate of how long the event will take, until the coroutine
+  ///   changes it with Context::remaining_time_estimate(~)
+  ///
+  /// \param[in] update
+  ///   The callback that tells the owner of the event that its state changed
+  ///
+  /// \param[in] executor
+  ///   The executor that resumes the coroutine
+  static Event::StandbyPtr standby(
+    Body body,
+    rmf_task::events::SimpleEventStatePtr state,
+    rmf_traffic::Duration duration_estimate,
+    std::function<void()> update,
+    rmf_task::ExecutorPtr executor = nullptr);
+
+  /// Restore an event from a backup and run its coroutine right away. The
+  /// coroutine can find its backed up state in Context::restored_state().
+  ///
+  /// The parameters are the same as standby(~), along with the backup state
+  /// and the callbacks that would be given to Event::Standby::begin(~).
+  static Event::ActivePtr restore(
+    Body body,
+    rmf_task::events::SimpleEventStatePtr state,
+    rmf_traffic::Duration duration_estimate,
+    nlohmann::json backup_state,
+    std::function<void()> update,
+    std::function<void()> checkpoint,
+    std::function<void()> finished,
+    rmf_task::ExecutorPtr executor = nullptr);
+
+  class Standby;
+  class Active;
+};
+
+//==============================================================================
+/// The return type of a coroutine that performs an event. It owns the frame of
+/// the coroutine, which is created in a suspended state.
+class Coroutine::Task
+{
+public:
+
+  class promise_type
+  {
+  public:
+
+    Task get_return_object();
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::exception_ptr exception;
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+  Task(Task&& other) noexcept;
+  Task& operator=(Task&& other) noexcept;
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task();
+
+  /// True if there is no coroutine or it has returned
+  bool done() const;
+
+  /// Resume the coroutine until it suspends again
+  void resume();
+
+  /// The exception that the coroutine threw, if it threw one
+  std::exception_ptr exception() const;
+
+private:
+  explicit Task(Handle handle);
+  Handle _handle;
+};
+
+//==============================================================================
+/// A one-shot event that a coroutine can co_await. Copies of a Trigger all
+/// refer to the same event, so one copy can be given to a callback while the
+/// coroutine awaits another.
+///
+/// Awaiting a Trigger gives back a std::optional<T> which is empty if the
+/// Trigger was aborted, e.g. because it timed out or the event was interrupted,
+/// canceled, or killed while waiting for it. A Trigger that has already fired
+/// does not suspend the coroutine.
+///
+/// Only one coroutine may await a Trigger. The Trigger may be fired from any
+/// thread.
+template<typename T>
+class Coroutine::Trigger
+{
+public:
+
+  /// Fire the trigger with a value.
+  ///
+  /// \return false if the trigger had already fired or been aborted.
+  bool set(T value = T());
+
+  /// Fire the trigger without a value.
+  ///
+  /// \return false if the trigger had already fired or been aborted.
+  bool abort();
+
+  /// True if the trigger has fired or been aborted
+  bool fired() const;
+
+  bool await_ready() const;
+  bool await_suspend(std::coroutine_handle<> handle);
+  std::optional<T> await_resume();
+
+private:
+  friend class Context;
+
+  struct Shared
+  {
+    mutable std::mutex mutex;
+    bool fired = false;
+    std::optional<T> value;
+    std::function<void()> wake;
+  };
+
+  Trigger(std::weak_ptr<Context> context);
+  static bool _fire(Shared& shared, std::optional<T> value);
+
+  std::shared_ptr<Shared> _shared;
+  std::weak_ptr<Context> _context;
+};
+
+//==============================================================================
+/// What a coroutine can use while it performs its event. Everything here may
+/// be used from the coroutine and from the callbacks that it hands out.
+class Coroutine::Context : public std::enable_shared_from_this<Context>
+{
+public:
+
+  /// The state of the event
+  rmf_task::events::SimpleEventState& state();
+
+  /// Tell the owner of the event that its state changed
+  void update() const;
+
+  /// Save a backup of the event and tell the owner of the event to back up
+  /// its task.
+  void checkpoint(nlohmann::json backup_state);
+
+  /// The state that the event was restored from. This is null if the event was
+  /// not restored.
+  const nlohmann::json& restored_state() const;
+
+  /// Change the estimate of how much longer the event will take
+  void remaining_time_estimate(rmf_traffic::Duration remaining);
+
+  /// True while the event is interrupted
+  bool interrupted() const;
+
+  /// True if the event has been canceled
+  bool cancelled() const;
+
+  /// True if the event has been killed
+  bool killed() const;
+
+  /// The executor that resumes the coroutine
+  const rmf_task::ExecutorPtr& executor() const;
+
+  /// Make a trigger that the coroutine can await.
+  ///
+  /// When the event is interrupted, canceled, or killed, the trigger that the
+  /// coroutine is awaiting gets aborted. If the coroutine is not awaiting
+  /// anything at that moment, the next trigger that it awaits is aborted
+  /// instead, so the coroutine always gets a chance to notice.
+  template<typename T = std::monostate>
+  Trigger<T> trigger();
+
+  /// Make a trigger that fires once a delay has passed
+  Trigger<> sleep_for(rmf_traffic::Duration delay);
+
+  /// Abort a trigger if it has not fired before a timeout
+  template<typename T>
+  Trigger<T> with_timeout(Trigger<T> trigger, rmf_traffic::Duration timeout);
+
+  /// Make a trigger that fires once the event is no longer interrupted. It
+  /// fires right away if the event is not interrupted. Awaiting this also lets
+  /// go of the abort that the interruption left for the next trigger.
+  Trigger<> until_resumed();
+
+private:
+  friend class Coroutine;
+  friend class Coroutine::Standby;
+  friend class Coroutine::Active;
+  template<typename> friend class Trigger;
+
+  Context(
+    rmf_task::events::SimpleEventStatePtr state,
+    rmf_traffic::Duration remaining,
+    nlohmann::json restored,
+    std::function<void()> update,
+    rmf_task::ExecutorPtr executor);
+
+  // Remember what to abort if the event gets stopped while the coroutine waits.
+  // Returns false if an abort was already pending, in which case the trigger
+  // should not suspend the coroutine.
+  bool _wait_for(std::function<bool()> abort);
+  void _done_waiting();
+  void _stop();
+  void _resume();
+
+  rmf_task::events::SimpleEventStatePtr _state;
+  nlohmann::json _restored;
+  std::function<void()> _update;
+  std::function<void()> _checkpoint;
+  std::function<void()> _wake;
+  rmf_task::ExecutorPtr _executor;
+
+  mutable std::mutex _mutex;
+  rmf_traffic::Duration _remaining;
+  nlohmann::json _backup_state;
+  uint64_t _backup_seq = 0;
+  bool _interrupted = false;
+  bool _cancelled = false;
+  bool _killed = false;
+  bool _abort_pending = false;
+  std::function<bool()> _abort_waiting;
+  std::optional<Trigger<>> _resumed;
+};
+
+} // namespace events
+} // namespace rmf_task_sequence
+
+#include <rmf_task_sequence/events/detail/impl_Coroutine.hpp>
+
+#endif // RMF_TASK_SEQUENCE__HAS_COROUTINES
+
+#endif // RMF_TASK_SEQUENCE__EVENTS__COROUTINE_HPP
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK_SEQUENCE__EVENTS__EVENTSTATETREE_HPP
+#define RMF_TASK_SEQUENCE__EVENTS__EVENTSTATETREE_HPP
+
+#include <rmf_task/Event.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace rmf_task_sequence {
+namespace events {
+
+//==============================================================================
+/// The states of all the events of a task, kept side by side in a single
+/// block of memory and addressed by their index in the tree. This is an
+/// alternative to making a separate rmf_task::events::SimpleEventState for
+/// each event of a large composed task, where following the dependencies of
+/// one state to the next means chasing pointers across the heap.
+///
+/// Each event of the tree can be given out through the Event::State interface
+/// with state(). Those pointers share ownership of the whole tree, so getting
+/// one does not allocate anything.
+///
+/// Like SimpleEventState, this class is not thread-safe. The events should be
+/// updated from the same thread that takes snapshots of them.
+class EventStateTree : public std::enable_shared_from_this<EventStateTree>
+{
+public:
+
+  using Index = std::size_t;
+  using Status = rmf_task::Event::Status;
+
+  /// Make an empty tree
+  ///
+  /// \param[in] capacity
+  ///   The greatest number of events that the tree can hold. The memory for
+  ///   all of them is allocated right away.
+  ///
+  /// \param[in] clock
+  ///   The clock for the logs of the events
+  static std::shared_ptr<EventStateTree> make(
+    std::size_t capacity,
+    std::function<rmf_traffic::Time()> clock = nullptr);
+
+  /// Add an event to the tree
+  ///
+  /// \param[in] id
+  ///   The ID of the event
+  ///
+  /// \param[in] name
+  ///   The name of the event
+  ///
+  /// \param[in] detail
+  ///   The detail of the event
+  ///
+  /// \param[in] initial_status
+  ///   The status that the event starts with
+  ///
+  /// \param[in] parent
+  ///   The event that this event is a dependency of. It is added after the
+  ///   other dependencies of its parent. Leave this empty for a root event.
+  ///
+  /// \throws std::length_error if the tree is already at its capacity.
+  /// \throws std::out_of_range if the parent is not in the tree.
+  ///
+  /// \return the index of the new event
+  Index add(
+    uint64_t id,
+    std::string name,
+    std::string detail,
+    Status initial_status,
+    std::optional<Index> parent = std::nullopt);
+
+  /// The number of events in the tree
+  std::size_t size() const;
+
+  /// The greatest number of events that the tree can hold
+  std::size_t capacity() const;
+
+  /// Get the Event::State interface of an event. Its dependencies() are the
+  /// states of its children in the tree.
+  ///
+  /// \throws std::out_of_range if the index is not in the tree.
+  rmf_task::Event::ConstStatePtr state(Index index) const;
+
+  /// Get the status of an event
+  Status status(Index index) const;
+
+  /// Update the status of an event. Setting the status that the event already
+  /// has does not change its version().
+  EventStateTree& update_status(Index index, Status new_status);
+
+  /// Update the name of an event
+  EventStateTree& update_name(Index index, std::string new_name);
+
+  /// Update the detail of an event
+  EventStateTree& update_detail(Index index, std::string new_detail);
+
+  /// Update the log of an event. The log is only created the first time that
+  /// this is called for the event.
+  rmf_task::Log& update_log(Index index);
+
+  /// The parent of an event, if it has one
+  std::optional<Index> parent(Index index) const;
+
+  /// The first child of an event, if it has any
+  std::optional<Index> first_child(Index index) const;
+
+  /// The next child after this event within the children of its parent
+  std::optional<Index> next_sibling(Index index) const;
+
+  /// Combine the statuses of the children of an event in order with
+  /// rmf_task::Event::sequence_status(~), starting from Completed. This is the
+  /// status of a sequence whose elements are the children.
+  Status sequence_status(Index index) const;
+
+  class Implementation;
+private:
+  EventStateTree();
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+using EventStateTreePtr = std::shared_ptr<EventStateTree>;
+
+} // namespace events
+} // namespace rmf_task_sequence
+
+#endif // RMF_TASK_SEQUENCE__EVENTS__EVENTSTATETREE_HPP
@@ -95,6 +95,11 @@ public:
     State invariant_initial_state,
     const Parameters& parameters) const final;
 
+  // Documentation inherited
+  std::optional<State> predict_invariant_finish_state(
+    const State& invariant_initial_state,
+    const Parameters& parameters) const final;
+
   // Documentation inherited
   Header generate_header(
     const State& initial_state,
@@ -70,6 +70,11 @@ public:
     rmf_task::State invariant_initial_state,
     const rmf_task::Parameters& parameters) const final;
 
+  // Documentation inherited
+  std::optional<rmf_task::State> predict_invariant_finish_state(
+    const rmf_task::State& invariant_initial_state,
+    const rmf_task::Parameters& parameters) const final;
+
   // Documentation inherited
   rmf_task::Header generate_header(
     const rmf_task::State& initial_state,
@@ -0,0 +1,666 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK_SEQUENCE__EVENTS__DETAIL__IMPL_COROUTINE_HPP
+#define RMF_TASK_SEQUENCE__EVENTS__DETAIL__IMPL_COROUTINE_HPP
+
+#include <rmf_task_sequence/events/Coroutine.hpp>
+
+namespace rmf_task_sequence {
+namespace events {
+
+//==============================================================================
+inline auto Coroutine::Task::promise_type::get_return_object() -> Task
+{
+  return Task(Handle::from_promise(*this));
+}
+
+//==============================================================================
+inline Coroutine::Task::Task(Handle handle)
+: _handle(handle)
+{
+  // Do nothing
+}
+
+//==============================================================================
+inline Coroutine::Task::Task(Task&& other) noexcept
+: _handle(std::exchange(other._handle, nullptr))
+{
+  // Do nothing
+}
+
+//==============================================================================
+inline auto Coroutine::Task::operator=(Task&& other) noexcept -> Task&
+{
+  if (this != &other)
+  {
+    if (_handle)
+      _handle.destroy();
+
+    _handle = std::exchange(other._handle, nullptr);
+  }
+
+  return *this;
+}
+
+//==============================================================================
+inline Coroutine::Task::~Task()
+{
+  if (_handle)
+    _handle.destroy();
+}
+
+//==============================================================================
+inline bool Coroutine::Task::done() const
+{
+  return !_handle || _handle.done();
+}
+
+//==============================================================================
+inline void Coroutine::Task::resume()
+{
+  if (!done())
+    _handle.resume();
+}
+
+//==============================================================================
+inline std::exception_ptr Coroutine::Task::exception() const
+{
+  if (!_handle)
+    return nullptr;
+
+  return _handle.promise().exception;
+}
+
+//==============================================================================
+template<typename T>
+Coroutine::Trigger<T>::Trigger(std::weak_ptr<Context> context)
+: _shared(std::make_shared<Shared>()),
+  _context(std::move(context))
+{
+  // Do nothing
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::set(T value)
+{
+  return _fire(*_shared, std::move(value));
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::abort()
+{
+  return _fire(*_shared, std::nullopt);
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::fired() const
+{
+  std::lock_guard<std::mutex> lock(_shared->mutex);
+  return _shared->fired;
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::await_ready() const
+{
+  return fired();
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::await_suspend(std::coroutine_handle<>)
+{
+  // The coroutine is always resumed through the wake callback of its context,
+  // so the handle itself is not needed here.
+  const auto context = _context.lock();
+  if (!context)
+    return false;
+
+  const std::weak_ptr<Shared> weak = _shared;
+  const bool may_wait = context->_wait_for(
+    [weak]()
+    {
+      const auto shared = weak.lock();
+      if (!shared)
+        return false;
+
+      return _fire(*shared, std::nullopt);
+    });
+
+  std::lock_guard<std::mutex> lock(_shared->mutex);
+  if (!may_wait)
+  {
+    // An abort was left for this trigger before it was awaited
+    _shared->fired = true;
+    _shared->value = std::nullopt;
+    return false;
+  }
+
+  if (_shared->fired)
+    return false;
+
+  _shared->wake = context->_wake;
+  return true;
+}
+
+//==============================================================================
+template<typename T>
+std::optional<T> Coroutine::Trigger<T>::await_resume()
+{
+  if (const auto context = _context.lock())
+    context->_done_waiting();
+
+  std::lock_guard<std::mutex> lock(_shared->mutex);
+  return std::move(_shared->value);
+}
+
+//==============================================================================
+template<typename T>
+bool Coroutine::Trigger<T>::_fire(Shared& shared, std::optional<T> value)
+{
+  std::function<void()> wake;
+  {
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (shared.fired)
+      return false;
+
+    shared.fired = true;
+    shared.value = std::move(value);
+    wake = std::move(shared.wake);
+    shared.wake = nullptr;
+  }
+
+  if (wake)
+    wake();
+
+  return true;
+}
+
+//==============================================================================
+inline Coroutine::Context::Context(
+  rmf_task::events::SimpleEventStatePtr state,
+  const rmf_traffic::Duration remaining,
+  nlohmann::json restored,
+  std::function<void()> update,
+  rmf_task::ExecutorPtr executor)
+: _state(std::move(state)),
+  _restored(std::move(restored)),
+  _update(std::move(update)),
+  _executor(std::move(executor)),
+  _remaining(remaining)
+{
+  // Do nothing
+}
+
+//==============================================================================
+inline rmf_task::events::SimpleEventState& Coroutine::Context::state()
+{
+  return *_state;
+}
+
+//==============================================================================
+inline void Coroutine::Context::update() const
+{
+  if (_update)
+    _update();
+}
+
+//==============================================================================
+inline void Coroutine::Context::checkpoint(nlohmann::json backup_state)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _backup_state = std::move(backup_state);
+    ++_backup_seq;
+  }
+
+  if (_checkpoint)
+    _checkpoint();
+}
+
+//==============================================================================
+inline const nlohmann::json& Coroutine::Context::restored_state() const
+{
+  return _restored;
+}
+
+//==============================================================================
+inline void Coroutine::Context::remaining_time_estimate(
+  const rmf_traffic::Duration remaining)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _remaining = remaining;
+}
+
+//==============================================================================
+inline bool Coroutine::Context::interrupted() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _interrupted;
+}
+
+//==============================================================================
+inline bool Coroutine::Context::cancelled() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _cancelled;
+}
+
+//==============================================================================
+inline bool Coroutine::Context::killed() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _killed;
+}
+
+//==============================================================================
+inline const rmf_task::ExecutorPtr& Coroutine::Context::executor() const
+{
+  return _executor;
+}
+
+//==============================================================================
+template<typename T>
+auto Coroutine::Context::trigger() -> Trigger<T>
+{
+  return Trigger<T>(weak_from_this());
+}
+
+//==============================================================================
+inline auto Coroutine::Context::sleep_for(const rmf_traffic::Duration delay)
+-> Trigger<>
+{
+  auto output = trigger();
+  rmf_task::Executor::post_after(
+    nullptr, delay, [output]() mutable { output.set(); });
+
+  return output;
+}
+
+//==============================================================================
+template<typename T>
+auto Coroutine::Context::with_timeout(
+  Trigger<T> trigger,
+  const rmf_traffic::Duration timeout) -> Trigger<T>
+{
+  rmf_task::Executor::post_after(
+    nullptr, timeout, [trigger]() mutable { trigger.abort(); });
+
+  return trigger;
+}
+
+//==============================================================================
+inline auto Coroutine::Context::until_resumed() -> Trigger<>
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!_interrupted)
+  {
+    auto output = trigger();
+    output.set();
+    return output;
+  }
+
+  // Only a cancel or a kill should abort the wait for the interruption to end
+  if (!_cancelled && !_killed)
+    _abort_pending = false;
+
+  if (!_resumed.has_value())
+    _resumed = trigger();
+
+  return *_resumed;
+}
+
+//==============================================================================
+inline bool Coroutine::Context::_wait_for(std::function<bool()> abort)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_abort_pending)
+  {
+    _abort_pending = false;
+    return false;
+  }
+
+  _abort_waiting = std::move(abort);
+  return true;
+}
+
+//==============================================================================
+inline void Coroutine::Context::_done_waiting()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _abort_waiting = nullptr;
+}
+
+//==============================================================================
+inline void Coroutine::Context::_stop()
+{
+  std::function<bool()> abort;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    abort = std::move(_abort_waiting);
+    _abort_waiting = nullptr;
+    if (!abort)
+    {
+      _abort_pending = true;
+      return;
+    }
+  }
+
+  // If the trigger fired before it could be aborted, leave the abort for the
+  // next trigger instead
+  if (!abort())
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _abort_pending = true;
+  }
+}
+
+//==============================================================================
+inline void Coroutine::Context::_resume()
+{
+  std::optional<Trigger<>> resumed;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _interrupted = false;
+    resumed = std::move(_resumed);
+    _resumed = std::nullopt;
+  }
+
+  if (resumed.has_value())
+    resumed->set();
+}
+
+//==============================================================================
+class Coroutine::Active
+  : public Event::Active,
+  public std::enable_shared_from_this<Coroutine::Active>
+{
+public:
+
+  static std::shared_ptr<Active> make(
+    const Body& body,
+    ContextPtr context,
+    std::function<void()> checkpoint,
+    std::function<void()> finished)
+  {
+    auto active = std::shared_ptr<Active>(new Active);
+    active->_context = std::move(context);
+    active->_finished = std::move(finished);
+
+    auto& ctx = *active->_context;
+    ctx._checkpoint = std::move(checkpoint);
+    ctx._wake = [w = active->weak_from_this()]()
+      {
+        if (const auto self = w.lock())
+          self->_post();
+      };
+
+    ctx.state().update_status(Event::Status::Underway);
+    active->_task = body(active->_context);
+    active->_post();
+    return active;
+  }
+
+  Event::ConstStatePtr state() const final
+  {
+    return _context->_state;
+  }
+
+  rmf_traffic::Duration remaining_time_estimate() const final
+  {
+    std::lock_guard<std::mutex> lock(_context->_mutex);
+    return _context->_remaining;
+  }
+
+  Backup backup() const final
+  {
+    std::lock_guard<std::mutex> lock(_context->_mutex);
+    return Backup::make(_context->_backup_seq, _context->_backup_state);
+  }
+
+  Resume interrupt(std::function<void()> task_is_interrupted) final
+  {
+    {
+      std::lock_guard<std::mutex> lock(_context->_mutex);
+      _context->_interrupted = true;
+    }
+
+    _context->_stop();
+    if (task_is_interrupted)
+      task_is_interrupted();
+
+    return Resume::make(
+      [w = std::weak_ptr<Context>(_context)]()
+      {
+        if (const auto context = w.lock())
+          context->_resume();
+      });
+  }
+
+  void cancel() final
+  {
+    {
+      std::lock_guard<std::mutex> lock(_context->_mutex);
+      if (_context->_killed)
+        return;
+
+      _context->_cancelled = true;
+    }
+
+    _context->_stop();
+  }
+
+  void kill() final
+  {
+    {
+      std::lock_guard<std::mutex> lock(_context->_mutex);
+      _context->_killed = true;
+    }
+
+    _context->_stop();
+  }
+
+private:
+
+  Active() = default;
+
+  void _post()
+  {
+    if (!_context->_executor)
+      return _step();
+
+    _context->_executor->post(
+      [w = weak_from_this()]()
+      {
+        if (const auto self = w.lock())
+          self->_step();
+      });
+  }
+
+  // Resume the coroutine. A wake that arrives while the coroutine is running
+  // on another thread is picked up by that thread once the coroutine suspends,
+  // so the coroutine is never resumed twice at once.
+  void _step()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_running)
+      {
+        _pending = true;
+        return;
+      }
+
+      _running = true;
+    }
+
+    std::function<void()> finished;
+    while (true)
+    {
+      _task.resume();
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_task.done())
+      {
+        finished = std::move(_finished);
+        _finished = nullptr;
+        _running = false;
+        break;
+      }
+
+      if (!_pending)
+      {
+        _running = false;
+        return;
+      }
+
+      _pending = false;
+    }
+
+    if (finished)
+      _finish(finished);
+  }
+
+  void _finish(const std::function<void()>& finished)
+  {
+    auto& state = _context->state();
+    if (const auto exception = _task.exception())
+    {
+      state.update_status(Event::Status::Failed);
+      try
+      {
+        std::rethrow_exception(exception);
+      }
+      catch (const std::exception& e)
+      {
+        state.update_log().error(
+          std::string("Event coroutine threw an exception: ") + e.what());
+      }
+      catch (...)
+      {
+        state.update_log().error("Event coroutine threw an unknown exception");
+      }
+    }
+    else if (state.status() == Event::Status::Underway)
+    {
+      if (_context->killed())
+        state.update_status(Event::Status::Killed);
+      else if (_context->cancelled())
+        state.update_status(Event::Status::Canceled);
+      else
+        state.update_status(Event::Status::Completed);
+    }
+
+    _context->remaining_time_estimate(rmf_traffic::Duration(0));
+    _context->update();
+    finished();
+  }
+
+  ContextPtr _context;
+  Task _task;
+  std::function<void()> _finished;
+
+  std::mutex _mutex;
+  bool _running = false;
+  bool _pending = false;
+};
+
+//==============================================================================
+class Coroutine::Standby : public Event::Standby
+{
+public:
+
+  Standby(Body body, ContextPtr context, rmf_traffic::Duration estimate)
+  : _body(std::move(body)),
+    _context(std::move(context)),
+    _estimate(estimate)
+  {
+    // Do nothing
+  }
+
+  Event::ConstStatePtr state() const final
+  {
+    return _context->_state;
+  }
+
+  rmf_traffic::Duration duration_estimate() const final
+  {
+    return _estimate;
+  }
+
+  Event::ActivePtr begin(
+    std::function<void()> checkpoint,
+    std::function<void()> finished) final
+  {
+    if (!_active)
+    {
+      _active = Coroutine::Active::make(
+        _body, _context, std::move(checkpoint), std::move(finished));
+    }
+
+    return _active;
+  }
+
+private:
+  Body _body;
+  ContextPtr _context;
+  rmf_traffic::Duration _estimate;
+  Event::ActivePtr _active;
+};
+
+//==============================================================================
+inline Event::StandbyPtr Coroutine::standby(
+  Body body,
+  rmf_task::events::SimpleEventStatePtr state,
+  const rmf_traffic::Duration duration_estimate,
+  std::function<void()> update,
+  rmf_task::ExecutorPtr executor)
+{
+  auto context = ContextPtr(new Context(
+      std::move(state), duration_estimate, nullptr, std::move(update),
+      std::move(executor)));
+
+  return std::make_shared<Standby>(
+    std::move(body), std::move(context), duration_estimate);
+}
+
+//==============================================================================
+inline Event::ActivePtr Coroutine::restore(
+  Body body,
+  rmf_task::events::SimpleEventStatePtr state,
+  const rmf_traffic::Duration duration_estimate,
+  nlohmann::json backup_state,
+  std::function<void()> update,
+  std::function<void()> checkpoint,
+  std::function<void()> finished,
+  rmf_task::ExecutorPtr executor)
+{
+  auto context = ContextPtr(new Context(
+      std::move(state), duration_estimate, std::move(backup_state),
+      std::move(update), std::move(executor)));
+
+  return Active::make(
+    body, std::move(context), std::move(checkpoint), std::move(finished));
+}
+
+} // namespace events
+} // namespace rmf_task_sequence
+
+#endif // RMF_TASK_SEQUENCE__EVENTS__DETAIL__IMPL_COROUTINE_HPP
@@ -44,9 +44,24 @@ public:
 
   std::optional<Info> failure;
 
+  /// Validate json against a schema. While a TrustedScope exists on the
+  /// calling thread, the json is not validated and no error is reported.
   static std::optional<Info> has_error(
     const nlohmann::json_schema::json_validator& validator,
-    const nlohmann::json json);
+    const nlohmann::json& json);
+
+  /// Turns off validation on the current thread for as long as it exists.
+  /// This is used while restoring a backup whose integrity has already been
+  /// verified, so that the phases and events inside of it do not need to
+  /// validate their parts of it again.
+  class TrustedScope
+  {
+  public:
+    TrustedScope();
+    TrustedScope(const TrustedScope&) = delete;
+    TrustedScope& operator=(const TrustedScope&) = delete;
+    ~TrustedScope();
+  };
 };
 
 } // namespace schemas
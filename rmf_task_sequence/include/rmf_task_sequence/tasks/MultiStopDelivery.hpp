@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TASK_SEQUENCE__TASKS__MULTISTOPDELIVERY_HPP
+#define RMF_TASK_SEQUENCE__TASKS__MULTISTOPDELIVERY_HPP
+
+#include <rmf_task_sequence/Task.hpp>
+#include <rmf_task_sequence/events/PickUp.hpp>
+#include <rmf_task_sequence/events/DropOff.hpp>
+
+#include <vector>
+
+namespace rmf_task_sequence {
+namespace tasks {
+
+//==============================================================================
+/// A delivery that picks up once and then drops off at several stops, in the
+/// order that the stops are given. Each event gets a SimplePhase of its own,
+/// so the progress of the task can be followed stop by stop and the models of
+/// the phases get estimated in a single pass over the sequence.
+class MultiStopDelivery
+{
+public:
+
+  /// Make the description of a multi-stop delivery task.
+  ///
+  /// \param[in] pickup
+  ///   The pickup that begins the delivery
+  ///
+  /// \param[in] dropoffs
+  ///   The stops of the delivery. There must be at least one.
+  ///
+  /// \param[in] cancellation_sequence
+  ///   This phase sequence will be run if the task is cancelled during any of
+  ///   its phases.
+  ///
+  /// \throws std::invalid_argument if pickup is null, any of the dropoffs is
+  /// null, or there are no dropoffs.
+  static Task::DescriptionPtr make(
+    events::PickUp::DescriptionPtr pickup,
+    std::vector<events::DropOff::DescriptionPtr> dropoffs,
+    std::vector<Phase::ConstDescriptionPtr> cancellation_sequence = {});
+};
+
+} // namespace tasks
+} // namespace rmf_task_sequence
+
+#endif // RMF_TASK_SEQUENCE__TASKS__MULTISTOPDELIVERY_HPP
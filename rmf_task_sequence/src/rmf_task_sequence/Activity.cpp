@@ -17,8 +17,117 @@
 
 #include <rmf_task_sequence/Activity.hpp>
 
+#include "events/internal_FixedStepModel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 namespace rmf_task_sequence {
 
+namespace {
+//==============================================================================
+// Consecutive fixed step models of a sequence, merged into one step
+class MergedStepModel : public events::FixedStepModel
+{
+public:
+
+  MergedStepModel(
+    events::FixedStep step,
+    rmf_task::State invariant_finish_state)
+  : _step(std::move(step)),
+    _invariant_finish_state(std::move(invariant_finish_state))
+  {
+    // Do nothing
+  }
+
+  std::optional<Estimate> estimate_finish(
+    rmf_task::State initial_state,
+    rmf_traffic::Time earliest_arrival_time,
+    const rmf_task::Constraints& constraints,
+    const rmf_task::TravelEstimator&) const final
+  {
+    return _step.apply(
+      std::move(initial_state), earliest_arrival_time, constraints);
+  }
+
+  rmf_traffic::Duration invariant_duration() const final
+  {
+    return _step.duration;
+  }
+
+  rmf_task::State invariant_finish_state() const final
+  {
+    return _invariant_finish_state;
+  }
+
+  const events::FixedStep& fixed_step() const final
+  {
+    return _step;
+  }
+
+private:
+  events::FixedStep _step;
+  rmf_task::State _invariant_finish_state;
+};
+
+//==============================================================================
+const events::FixedStepModel* mergeable(const Activity::ConstModelPtr& model)
+{
+  const auto fixed =
+    dynamic_cast<const events::FixedStepModel*>(model.get());
+
+  // The battery only gets checked against the threshold at the end of a
+  // merged step, which matches checking it after each step as long as none of
+  // the steps charges the battery.
+  if (fixed && fixed->fixed_step().battery_drain >= 0.0)
+    return fixed;
+
+  return nullptr;
+}
+
+//==============================================================================
+// Merge each run of consecutive fixed step models into a single model so that
+// estimating the sequence does not need to visit every one of them.
+std::vector<Activity::ConstModelPtr> merge_fixed_steps(
+  std::vector<Activity::ConstModelPtr> models)
+{
+  std::vector<Activity::ConstModelPtr> output;
+  output.reserve(models.size());
+  std::size_t i = 0;
+  while (i < models.size())
+  {
+    const auto* first = mergeable(models[i]);
+    std::size_t end = i + 1;
+    if (first)
+    {
+      while (end < models.size() && mergeable(models[end]))
+        ++end;
+    }
+
+    if (end - i < 2)
+    {
+      output.emplace_back(std::move(models[i]));
+      i = end;
+      continue;
+    }
+
+    events::FixedStep step = first->fixed_step();
+    for (std::size_t j = i + 1; j < end; ++j)
+      step.then(mergeable(models[j])->fixed_step());
+
+    output.emplace_back(
+      std::make_shared<MergedStepModel>(
+        std::move(step), models[end - 1]->invariant_finish_state()));
+    i = end;
+  }
+
+  return output;
+}
+} // anonymous namespace
+
 //==============================================================================
 class Activity::SequenceModel::Implementation
 {
@@ -28,33 +137,123 @@ public:
   rmf_traffic::Duration invariant_duration;
 };
 
+//==============================================================================
+std::optional<State> Activity::Description::predict_invariant_finish_state(
+  const State&,
+  const Parameters&) const
+{
+  return std::nullopt;
+}
+
 //==============================================================================
 Activity::ConstModelPtr Activity::SequenceModel::make(
   const std::vector<ConstDescriptionPtr>& descriptions,
   rmf_task::State invariant_initial_state,
-  const rmf_task::Parameters& parameters)
+  const rmf_task::Parameters& parameters,
+  std::size_t num_threads)
 {
-  std::vector<Activity::ConstModelPtr> models;
-  rmf_task::State invariant_finish_state = invariant_initial_state;
-  rmf_traffic::Duration invariant_duration = rmf_traffic::Duration(0);
-  for (const auto& desc : descriptions)
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<Activity::ConstModelPtr> models(descriptions.size());
+  std::vector<rmf_task::State> initial_states(descriptions.size());
+
+  // Make the models of descriptions [begin, end) whose initial states are
+  // already known
+  const auto make_models = [&](std::size_t begin, std::size_t end)
+    {
+      const auto make_model = [&](std::size_t i)
+        {
+          models[i] = descriptions[i]->make_model(
+            std::move(initial_states[i]), parameters);
+        };
+
+      const std::size_t num_workers = std::min(num_threads, end - begin);
+      if (num_workers <= 1)
+      {
+        for (std::size_t i = begin; i < end; ++i)
+          make_model(i);
+
+        return;
+      }
+
+      // The first exception stops the workers from taking any more models
+      std::atomic_size_t next = begin;
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      const auto work = [&]()
+        {
+          std::size_t i;
+          while ((i = next++) < end)
+          {
+            try
+            {
+              make_model(i);
+            }
+            catch (...)
+            {
+              std::lock_guard<std::mutex> lock(error_mutex);
+              if (!error)
+                error = std::current_exception();
+              next = end;
+            }
+          }
+        };
+
+      std::vector<std::thread> workers;
+      workers.reserve(num_workers - 1);
+      for (std::size_t w = 1; w < num_workers; ++w)
+        workers.emplace_back(work);
+
+      work();
+      for (auto& worker : workers)
+        worker.join();
+
+      if (error)
+        std::rethrow_exception(error);
+    };
+
+  rmf_task::State invariant_finish_state = std::move(invariant_initial_state);
+  std::size_t begin = 0;
+  while (begin < descriptions.size())
   {
-    auto next_model = desc->make_model(invariant_finish_state, parameters);
-    if (!next_model)
+    // Predict as many initial states ahead as the descriptions allow. The
+    // last description of the batch is the one whose model is needed to know
+    // what comes after it.
+    std::size_t end = begin;
+    initial_states[end] = std::move(invariant_finish_state);
+    while (++end < descriptions.size() && num_threads > 1)
+    {
+      auto predicted = descriptions[end-1]->predict_invariant_finish_state(
+        initial_states[end-1], parameters);
+      if (!predicted.has_value())
+        break;
+
+      initial_states[end] = std::move(*predicted);
+    }
+
+    make_models(begin, end);
+    for (std::size_t i = begin; i < end; ++i)
     {
-      // TODO: Should we throw an error here?
-      return nullptr;
+      if (!models[i])
+      {
+        // TODO: Should we throw an error here?
+        return nullptr;
+      }
     }
-    invariant_finish_state = next_model->invariant_finish_state();
-    invariant_duration += next_model->invariant_duration();
 
-    models.emplace_back(std::move(next_model));
+    invariant_finish_state = models[end-1]->invariant_finish_state();
+    begin = end;
   }
 
+  rmf_traffic::Duration invariant_duration = rmf_traffic::Duration(0);
+  for (const auto& model : models)
+    invariant_duration += model->invariant_duration();
+
   auto output = std::shared_ptr<SequenceModel>(new SequenceModel);
   output->_pimpl = rmf_utils::make_unique_impl<Implementation>(
     Implementation{
-      std::move(models),
+      merge_fixed_steps(std::move(models)),
       std::move(invariant_finish_state),
       invariant_duration
     });
@@ -62,6 +261,26 @@ Activity::ConstModelPtr Activity::SequenceModel::make(
   return output;
 }
 
+//==============================================================================
+std::optional<rmf_task::State>
+Activity::SequenceModel::predict_invariant_finish_state(
+  const std::vector<ConstDescriptionPtr>& descriptions,
+  const rmf_task::State& invariant_initial_state,
+  const rmf_task::Parameters& parameters)
+{
+  rmf_task::State state = invariant_initial_state;
+  for (const auto& desc : descriptions)
+  {
+    auto next = desc->predict_invariant_finish_state(state, parameters);
+    if (!next.has_value())
+      return std::nullopt;
+
+    state = std::move(*next);
+  }
+
+  return state;
+}
+
 //==============================================================================
 std::optional<Estimate> Activity::SequenceModel::estimate_finish(
   rmf_task::State initial_state,
@@ -73,7 +292,7 @@ std::optional<Estimate> Activity::SequenceModel::estimate_finish(
   std::optional<rmf_traffic::Time> wait_until;
   for (const auto& model : _pimpl->models)
   {
-    const auto estimate = model->estimate_finish(
+    auto estimate = model->estimate_finish(
       std::move(finish_state),
       earliest_arrival_time,
       constraints,
@@ -82,9 +301,9 @@ std::optional<Estimate> Activity::SequenceModel::estimate_finish(
     if (!estimate.has_value())
       return std::nullopt;
 
-    finish_state = estimate->finish_state();
     if (!wait_until.has_value())
       wait_until = estimate->wait_until();
+    finish_state = estimate->release_finish_state();
   }
 
   if (!wait_until.has_value())
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task_sequence/DescriptionRegistry.hpp>
+#include <rmf_task_sequence/schemas/ErrorHandler.hpp>
+
+#include <nlohmann/json-schema.hpp>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rmf_task_sequence {
+
+//==============================================================================
+class DescriptionRegistry::Implementation
+{
+public:
+
+  struct Category
+  {
+    std::shared_ptr<const nlohmann::json_schema::json_validator> validator;
+    Deserializer deserializer;
+  };
+
+  using CacheEntry = std::pair<std::string, Phase::ConstDescriptionPtr>;
+  using CacheList = std::list<CacheEntry>;
+
+  Implementation(std::size_t cache_capacity_)
+  : cache_capacity(cache_capacity_)
+  {
+    // Do nothing
+  }
+
+  Phase::ConstDescriptionPtr parse(
+    const std::string& category,
+    const nlohmann::json& description) const
+  {
+    const auto it = categories.find(category);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (it == categories.end())
+    {
+      throw std::invalid_argument(
+        "[DescriptionRegistry::parse] No deserializer was added for the "
+        "category [" + category + "]");
+    }
+    // *INDENT-ON*
+
+    std::string key;
+    if (cache_capacity > 0)
+    {
+      // The category goes in front of the content so that the same json given
+      // to different categories does not share a description
+      key = category + '\n' + description.dump();
+      if (auto cached = lookup(key))
+        return cached;
+    }
+
+    const auto error = schemas::ErrorHandler::has_error(
+      *it->second.validator, description);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (error.has_value())
+    {
+      throw std::invalid_argument(
+        "[DescriptionRegistry::parse] Description of category [" + category
+        + "] failed validation at [" + error->ptr.to_string() + "]: "
+        + error->message);
+    }
+    // *INDENT-ON*
+
+    auto output = it->second.deserializer(description);
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (!output)
+    {
+      throw std::invalid_argument(
+        "[DescriptionRegistry::parse] The deserializer of category ["
+        + category + "] did not produce a description");
+    }
+    // *INDENT-ON*
+
+    if (cache_capacity > 0)
+      remember(std::move(key), output);
+
+    return output;
+  }
+
+  Phase::ConstDescriptionPtr lookup(const std::string& key) const
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    const auto it = cache_index.find(key);
+    if (it == cache_index.end())
+      return nullptr;
+
+    // Move the entry to the front so that it is the last to be evicted
+    cache.splice(cache.begin(), cache, it->second);
+    return it->second->second;
+  }
+
+  void remember(std::string key, Phase::ConstDescriptionPtr description) const
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    // Another thread may have parsed the same description in the meantime
+    if (cache_index.count(key) > 0)
+      return;
+
+    cache.emplace_front(std::move(key), std::move(description));
+    cache_index.insert({cache.front().first, cache.begin()});
+    while (cache.size() > cache_capacity)
+    {
+      cache_index.erase(cache.back().first);
+      cache.pop_back();
+    }
+  }
+
+  void forget(const std::string& category)
+  {
+    const std::string prefix = category + '\n';
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    for (auto it = cache.begin(); it != cache.end(); )
+    {
+      if (it->first.compare(0, prefix.size(), prefix) == 0)
+      {
+        cache_index.erase(it->first);
+        it = cache.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  std::unordered_map<std::string, Category> categories;
+
+  std::size_t cache_capacity;
+  mutable std::mutex cache_mutex;
+  // Ordered from the most recently used to the least recently used
+  mutable CacheList cache;
+  mutable std::unordered_map<std::string, CacheList::iterator> cache_index;
+};
+
+namespace {
+//==============================================================================
+const nlohmann::json& field(
+  const nlohmann::json& json,
+  const char* name,
+  const std::string& location)
+{
+  const auto it = json.find(name);
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (it == json.end())
+  {
+    throw std::invalid_argument(
+      "[DescriptionRegistry::parse_task] Missing [" + std::string(name)
+      + "] field in " + location);
+  }
+  // *INDENT-ON*
+
+  return *it;
+}
+
+//==============================================================================
+std::string string_field(
+  const nlohmann::json& json,
+  const char* name,
+  const std::string& location)
+{
+  const auto& value = field(json, name, location);
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!value.is_string())
+  {
+    throw std::invalid_argument(
+      "[DescriptionRegistry::parse_task] The [" + std::string(name)
+      + "] field in " + location + " must be a string");
+  }
+  // *INDENT-ON*
+
+  return value.get<std::string>();
+}
+
+//==============================================================================
+const nlohmann::json& array_field(
+  const nlohmann::json& json,
+  const char* name,
+  const std::string& location)
+{
+  const auto& value = field(json, name, location);
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!value.is_array())
+  {
+    throw std::invalid_argument(
+      "[DescriptionRegistry::parse_task] The [" + std::string(name)
+      + "] field in " + location + " must be an array");
+  }
+  // *INDENT-ON*
+
+  return value;
+}
+} // anonymous namespace
+
+//==============================================================================
+DescriptionRegistry::DescriptionRegistry(const std::size_t cache_capacity)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>(cache_capacity))
+{
+  // Do nothing
+}
+
+//==============================================================================
+DescriptionRegistry& DescriptionRegistry::add(
+  std::string category,
+  const nlohmann::json& schema,
+  Deserializer deserializer)
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!deserializer)
+  {
+    throw std::invalid_argument(
+      "[DescriptionRegistry::add] The deserializer for category ["
+      + category + "] is empty");
+  }
+  // *INDENT-ON*
+
+  std::shared_ptr<const nlohmann::json_schema::json_validator> validator;
+  try
+  {
+    validator =
+      std::make_shared<nlohmann::json_schema::json_validator>(schema);
+  }
+  catch (const std::exception& e)
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "[DescriptionRegistry::add] The schema for category [" + category
+      + "] could not be compiled: " + e.what());
+    // *INDENT-ON*
+  }
+
+  _pimpl->forget(category);
+  _pimpl->categories[std::move(category)] =
+    Implementation::Category{std::move(validator), std::move(deserializer)};
+
+  return *this;
+}
+
+//==============================================================================
+bool DescriptionRegistry::has(const std::string& category) const
+{
+  return _pimpl->categories.count(category) > 0;
+}
+
+//==============================================================================
+Phase::ConstDescriptionPtr DescriptionRegistry::parse(
+  const std::string& category,
+  const nlohmann::json& description) const
+{
+  return _pimpl->parse(category, description);
+}
+
+//==============================================================================
+Task::DescriptionPtr DescriptionRegistry::parse_task(
+  const nlohmann::json& task) const
+{
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (!task.is_object())
+  {
+    throw std::invalid_argument(
+      "[DescriptionRegistry::parse_task] The task must be a json object");
+  }
+  // *INDENT-ON*
+
+  const auto parse_phase = [&](
+    const nlohmann::json& phase,
+    const std::string& location) -> Phase::ConstDescriptionPtr
+    {
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      if (!phase.is_object())
+      {
+        throw std::invalid_argument(
+          "[DescriptionRegistry::parse_task] " + location
+          + " must be a json object");
+      }
+      // *INDENT-ON*
+
+      return _pimpl->parse(
+        string_field(phase, "category", location),
+        field(phase, "description", location));
+    };
+
+  const auto category = string_field(task, "category", "the task");
+  std::string detail;
+  if (task.contains("detail"))
+    detail = string_field(task, "detail", "the task");
+
+  Task::Builder builder;
+  const auto& phases = array_field(task, "phases", "the task");
+  for (std::size_t i = 0; i < phases.size(); ++i)
+  {
+    const std::string location = "phase [" + std::to_string(i) + "]";
+    const auto& phase = phases[i];
+    auto description = parse_phase(phase, location);
+
+    std::vector<Phase::ConstDescriptionPtr> cancellation_sequence;
+    if (phase.contains("on_cancel"))
+    {
+      const auto& on_cancel = array_field(phase, "on_cancel", location);
+      cancellation_sequence.reserve(on_cancel.size());
+      for (std::size_t j = 0; j < on_cancel.size(); ++j)
+      {
+        cancellation_sequence.push_back(
+          parse_phase(
+            on_cancel[j],
+            "cancellation phase [" + std::to_string(j) + "] of " + location));
+      }
+    }
+
+    builder.add_phase(
+      std::move(description), std::move(cancellation_sequence));
+  }
+
+  return builder.build(category, std::move(detail));
+}
+
+//==============================================================================
+std::size_t DescriptionRegistry::cache_size() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->cache_mutex);
+  return _pimpl->cache.size();
+}
+
+//==============================================================================
+void DescriptionRegistry::clear_cache()
+{
+  std::lock_guard<std::mutex> lock(_pimpl->cache_mutex);
+  _pimpl->cache.clear();
+  _pimpl->cache_index.clear();
+}
+
+} // namespace rmf_task_sequence
@@ -17,6 +17,8 @@
 
 #include <rmf_task_sequence/Event.hpp>
 
+#include <rmf_task/detail/TypeRegistry.hpp>
+
 namespace rmf_task_sequence {
 
 //==============================================================================
@@ -24,8 +26,11 @@ class Event::Initializer::Implementation
 {
 public:
 
-  std::unordered_map<std::type_index, Initialize<Description>> initializers;
-  std::unordered_map<std::type_index, Restore<Description>> restorers;
+  // The callbacks of each type of description are stored at the ID that the
+  // registry gives the type
+  rmf_task::detail::TypeRegistry types;
+  std::vector<Initialize<Description>> initializers;
+  std::vector<Restore<Description>> restorers;
 
 };
 
@@ -44,12 +49,11 @@ Event::StandbyPtr Event::Initializer::initialize(
   const Event::Description& description,
   std::function<void()> update) const
 {
-  const auto& type = typeid(description);
-  const auto it = _pimpl->initializers.find(type);
-  if (it == _pimpl->initializers.end())
+  const auto type = _pimpl->types.find(typeid(description));
+  if (!type.has_value())
     return nullptr;
 
-  return it->second(
+  return _pimpl->initializers[*type](
     id,
     get_state,
     parameters,
@@ -68,12 +72,11 @@ Event::ActivePtr Event::Initializer::restore(
   std::function<void()> checkpoint,
   std::function<void()> finished) const
 {
-  const auto& type = typeid(description);
-  const auto it = _pimpl->restorers.find(type);
-  if (it == _pimpl->restorers.end())
+  const auto type = _pimpl->types.find(typeid(description));
+  if (!type.has_value())
     return nullptr;
 
-  return it->second(
+  return _pimpl->restorers[*type](
     id,
     get_state,
     parameters,
@@ -84,14 +87,34 @@ Event::ActivePtr Event::Initializer::restore(
     std::move(finished));
 }
 
+//==============================================================================
+void Event::Initializer::freeze()
+{
+  _pimpl->types.freeze();
+}
+
+//==============================================================================
+bool Event::Initializer::frozen() const
+{
+  return _pimpl->types.frozen();
+}
+
 //==============================================================================
 void Event::Initializer::_add(
-  std::type_index type,
+  const std::type_info& type,
   Initialize<Event::Description> initializer,
   Restore<Event::Description> restorer)
 {
-  _pimpl->initializers.insert_or_assign(type, std::move(initializer));
-  _pimpl->restorers.insert_or_assign(type, std::move(restorer));
+  const auto id = _pimpl->types.insert(type);
+  if (id < _pimpl->initializers.size())
+  {
+    _pimpl->initializers[id] = std::move(initializer);
+    _pimpl->restorers[id] = std::move(restorer);
+    return;
+  }
+
+  _pimpl->initializers.push_back(std::move(initializer));
+  _pimpl->restorers.push_back(std::move(restorer));
 }
 
 } // namespace rmf_task_sequence
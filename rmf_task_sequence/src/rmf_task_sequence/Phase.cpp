@@ -17,6 +17,8 @@
 
 #include <rmf_task_sequence/Phase.hpp>
 
+#include <rmf_task/detail/TypeRegistry.hpp>
+
 namespace rmf_task_sequence {
 
 //==============================================================================
@@ -24,7 +26,10 @@ class Phase::Activator::Implementation
 {
 public:
 
-  std::unordered_map<std::type_index, Activate<Phase::Description>> activators;
+  // The activator of each type of description is stored at the ID that the
+  // registry gives the type
+  rmf_task::detail::TypeRegistry types;
+  std::vector<Activate<Phase::Description>> activators;
 
 };
 
@@ -46,12 +51,11 @@ Phase::ActivePtr Phase::Activator::activate(
   std::function<void(Active::Backup)> checkpoint,
   std::function<void()> finished) const
 {
-  const auto& type = typeid(description);
-  const auto it = _pimpl->activators.find(type);
-  if (it == _pimpl->activators.end())
+  const auto id = _pimpl->types.find(typeid(description));
+  if (!id.has_value())
     return nullptr;
 
-  return it->second(
+  return _pimpl->activators[*id](
     get_state,
     parameters,
     std::move(tag),
@@ -62,11 +66,27 @@ Phase::ActivePtr Phase::Activator::activate(
     std::move(finished));
 }
 
+//==============================================================================
+void Phase::Activator::freeze()
+{
+  _pimpl->types.freeze();
+}
+
+//==============================================================================
+bool Phase::Activator::frozen() const
+{
+  return _pimpl->types.frozen();
+}
+
 //==============================================================================
 void Phase::Activator::_add_activator(
-  std::type_index type, Activate<Phase::Description> activator)
+  const std::type_info& type, Activate<Phase::Description> activator)
 {
-  _pimpl->activators.insert_or_assign(type, std::move(activator));
+  const auto id = _pimpl->types.insert(type);
+  if (id < _pimpl->activators.size())
+    _pimpl->activators[id] = std::move(activator);
+  else
+    _pimpl->activators.push_back(std::move(activator));
 }
 
 } // namespace rmf_task_sequence
@@ -19,6 +19,9 @@
 
 #include <list>
 
+#include <rmf_task/Metrics.hpp>
+#include <rmf_task/Trace.hpp>
+#include <rmf_task/UpdateCoalescer.hpp>
 #include <rmf_task/phases/RestoreBackup.hpp>
 
 #include <rmf_task_sequence/Task.hpp>
@@ -30,7 +33,9 @@
 #include <rmf_utils/Modular.hpp>
 
 #include <iostream>
+#include <iterator>
 #include <mutex>
+#include <unordered_map>
 
 namespace rmf_task_sequence {
 
@@ -44,6 +49,88 @@ struct Stage
   std::vector<Phase::ConstDescriptionPtr> cancellation_sequence;
 };
 using ConstStagePtr = std::shared_ptr<const Stage>;
+
+//==============================================================================
+// The CBOR self-described tag, which begins every backup that is encoded as
+// CBOR so that it can be told apart from JSON text
+const std::string cbor_backup_prefix = "\xD9\xD9\xF7";
+
+//==============================================================================
+// Begins a backup that carries a checksum of its contents. This is followed by
+// the checksum as 16 hexadecimal digits and a newline.
+const std::string checksum_prefix = "rmf_task_sequence checksum ";
+const std::size_t checksum_header_size = checksum_prefix.size() + 17;
+
+//==============================================================================
+// FNV-1a, written out as 16 hexadecimal digits
+std::string checksum(const char* data, const std::size_t size)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+
+  std::string output(16, '0');
+  for (std::size_t i = 0; i < 16; ++i)
+  {
+    output[15 - i] = "0123456789abcdef"[hash & 0xF];
+    hash >>= 4;
+  }
+
+  return output;
+}
+
+//==============================================================================
+std::string encode_backup(
+  const nlohmann::json& root,
+  const Task::BackupEncoding encoding,
+  const bool with_checksum)
+{
+  std::string output;
+  if (encoding == Task::BackupEncoding::Json)
+  {
+    output = root.dump();
+  }
+  else
+  {
+    output = cbor_backup_prefix;
+    nlohmann::json::to_cbor(root, output);
+  }
+
+  if (!with_checksum)
+    return output;
+
+  return checksum_prefix + checksum(output.data(), output.size()) + "\n"
+    + output;
+}
+
+//==============================================================================
+// The verified flag is set if the backup carries a checksum that matches its
+// contents
+nlohmann::json decode_backup(const std::string& backup, bool& verified)
+{
+  verified = false;
+  std::size_t begin = 0;
+  if (backup.size() >= checksum_header_size
+    && backup.compare(0, checksum_prefix.size(), checksum_prefix) == 0)
+  {
+    begin = checksum_header_size;
+    verified = backup.compare(
+      checksum_prefix.size(), 16,
+      checksum(backup.data() + begin, backup.size() - begin)) == 0;
+  }
+
+  if (backup.compare(begin, cbor_backup_prefix.size(), cbor_backup_prefix)
+    == 0)
+  {
+    return nlohmann::json::from_cbor(
+      backup.begin() + begin + cbor_backup_prefix.size(), backup.end());
+  }
+
+  return nlohmann::json::parse(backup.begin() + begin, backup.end());
+}
 } // anonymous namespace
 
 //==============================================================================
@@ -61,6 +148,7 @@ public:
   std::string category;
   std::string detail;
   std::vector<ConstStagePtr> stages;
+  std::size_t model_threads = 1;
 
   static std::list<ConstStagePtr> get_stages(const Description& desc)
   {
@@ -146,7 +234,10 @@ public:
     std::function<void(Phase::ConstSnapshotPtr)> update,
     std::function<void(Task::Active::Backup)> checkpoint,
     std::function<void(Phase::ConstCompletedPtr)> phase_finished,
-    std::function<void()> task_finished)
+    std::function<void()> task_finished,
+    std::optional<rmf_traffic::Duration> minimum_update_period,
+    BackupEncoding backup_encoding,
+    bool trusted_restore)
   {
     auto task = std::shared_ptr<Active>(
       new Active(
@@ -161,6 +252,12 @@ public:
         std::move(phase_finished),
         std::move(task_finished)));
 
+    if (minimum_update_period.has_value())
+      task->_coalescer.emplace(task->_update, *minimum_update_period);
+
+    task->_backup_encoding = backup_encoding;
+    task->_trusted_restore = trusted_restore;
+
     if (backup_state.has_value())
     {
       task->_load_backup(std::move(*backup_state));
@@ -215,7 +312,11 @@ public:
   // Documentation inherited
   void rewind(uint64_t phase_id) final;
 
-  static const nlohmann::json_schema::json_validator backup_schema_validator;
+  // Documentation inherited
+  std::size_t suppressed_updates() const final;
+
+  static const nlohmann::json_schema::json_validator&
+  backup_schema_validator();
 
 private:
 
@@ -228,21 +329,67 @@ private:
   void _load_backup(std::string backup_state);
   void _generate_pending_phases();
 
+  /// Make the pending phases of a list of stages, beginning from the current
+  /// state of the robot
+  ///
+  /// \param[out] estimate
+  ///   The sum of the duration estimates of the phases
+  std::vector<Phase::Pending> _make_pending_phases(
+    const std::list<ConstStagePtr>& stages,
+    rmf_traffic::Duration& estimate) const;
+
+  /// Get the tag that was generated for a stage, or generate it if the stage
+  /// has never been pending.
+  Phase::ConstTagPtr _tag_of(const Stage& stage);
+
+  /// Change the skip flag of a pending phase in place
+  ///
+  /// \return true if the flag of a pending phase was changed.
+  bool _set_skip(uint64_t phase_id, bool value);
+
+  /// Change the part of the remaining time estimate that comes from the
+  /// pending phases
+  void _add_pending_estimate(rmf_traffic::Duration change);
+
   void _finish_phase(Phase::Tag::Id id);
   void _begin_next_stage(std::optional<nlohmann::json> restore = std::nullopt);
   void _finish_task();
 
-  void _prepare_cancellation_sequence(
-    std::vector<Phase::ConstDescriptionPtr> sequence);
+  /// Pass a phase snapshot to the update callback, or to the coalescer if the
+  /// updates of this task are rate limited. An urgent update is delivered
+  /// right away, along with any update that the coalescer is holding.
+  void _notify_update(
+    std::function<Phase::ConstSnapshotPtr()> make_snapshot,
+    bool urgent = false);
+
+  /// Generate the stages and pending phases of the cancellation sequence of a
+  /// stage so that cancelling the stage does not need to build them. Nothing
+  /// is done if they were already prepared for this stage.
+  void _prepare_cancellation_sequence(const ConstStagePtr& stage);
+
+  /// Replace the pending phases with the cancellation sequence of a stage,
+  /// preparing the sequence first if that has not been done
+  void _begin_cancellation_sequence(const ConstStagePtr& stage);
 
   void _issue_backup(
     Phase::Tag::Id source_phase_id,
     Phase::Active::Backup phase_backup) const;
 
+  /// Issue a backup of the active phase after the pending phases have changed
+  void _backup_pending_change() const;
+
+  /// Give a backup root to the checkpoint callback unless it is the same as
+  /// the last one
+  void _checkpoint_root(nlohmann::json root) const;
+
   Backup _generate_backup(
     Phase::Tag::Id current_phase_id,
     Phase::Active::Backup phase_backup) const;
 
+  nlohmann::json _generate_backup_root(
+    Phase::Tag::Id current_phase_id,
+    Phase::Active::Backup phase_backup) const;
+
   Backup _empty_backup() const;
 
   std::string _task_id() const
@@ -299,6 +446,7 @@ private:
   ConstParametersPtr _parameters;
   ConstTagPtr _tag;
   std::function<void(Phase::ConstSnapshotPtr)> _update;
+  std::optional<rmf_task::UpdateCoalescer> _coalescer;
   std::function<void(Backup)> _checkpoint;
   std::function<void(Phase::ConstCompletedPtr)> _phase_finished;
   std::function<void()> _task_finished;
@@ -309,6 +457,10 @@ private:
   std::list<ConstStagePtr> _pending_stages;
   std::vector<Phase::Pending> _pending_phases;
 
+  // The tags of every stage that has been pending, so that rewinding can put
+  // stages back without generating their headers again
+  std::unordered_map<Phase::Tag::Id, Phase::ConstTagPtr> _phase_tags;
+
   ConstStagePtr _active_stage;
   Phase::ActivePtr _active_phase;
   std::optional<rmf_traffic::Time> _current_phase_start_time;
@@ -324,15 +476,44 @@ private:
 
   mutable std::optional<uint64_t> _last_phase_backup_sequence_number;
   mutable uint64_t _next_task_backup_sequence_number = 0;
+  // The contents of the last backup that was given to the checkpoint callback
+  mutable std::optional<nlohmann::json> _last_checkpoint_root;
+  BackupEncoding _backup_encoding = BackupEncoding::Json;
+  bool _trusted_restore = false;
 
   const uint64_t _cancel_sequence_initial_id;
+
+  // The parts of estimate_remaining_time(). The pending phases contribute the
+  // sum of the duration estimates of their headers, which is kept up to date
+  // as phases become pending or active. The estimate of the active phase is
+  // cached until the phase reports progress or a new phase begins.
+  mutable std::mutex _estimate_mutex;
+  rmf_traffic::Duration _pending_estimate = rmf_traffic::Duration(0);
+  mutable std::optional<rmf_traffic::Duration> _active_estimate;
+
+  // The cancellation sequence of the active stage, generated when the stage
+  // became active so that cancelling many tasks at once is cheap
+  struct PreparedCancellation
+  {
+    ConstStagePtr stage;
+    std::list<ConstStagePtr> stages;
+    std::vector<Phase::Pending> pending_phases;
+    rmf_traffic::Duration estimate = rmf_traffic::Duration(0);
+  };
+  std::optional<PreparedCancellation> _prepared_cancellation;
 };
 
 //==============================================================================
-const nlohmann::json_schema::json_validator
-Task::Active::backup_schema_validator =
-  nlohmann::json_schema::json_validator(
-  schemas::backup_PhaseSequenceTask_v0_1);
+const nlohmann::json_schema::json_validator&
+Task::Active::backup_schema_validator()
+{
+  // This is built on first use so that processes which never restore a
+  // backup do not pay to compile the schema when the library is loaded
+  static const nlohmann::json_schema::json_validator validator(
+    schemas::backup_PhaseSequenceTask_v0_1);
+
+  return validator;
+}
 
 //==============================================================================
 Task::Builder::Builder()
@@ -385,7 +566,8 @@ Task::ConstModelPtr Task::Description::make_model(
     Activity::SequenceModel::make(
       std::move(descriptions),
       State(),
-      parameters),
+      parameters,
+      _pimpl->model_threads),
     earliest_start_time);
 }
 
@@ -426,6 +608,19 @@ Task::Description& Task::Description::detail(std::string new_category)
   return *this;
 }
 
+//==============================================================================
+std::size_t Task::Description::model_threads() const
+{
+  return _pimpl->model_threads;
+}
+
+//==============================================================================
+Task::Description& Task::Description::model_threads(std::size_t num_threads)
+{
+  _pimpl->model_threads = num_threads;
+  return *this;
+}
+
 //==============================================================================
 Header Task::Description::generate_header(
   const State& initial_state,
@@ -517,13 +712,14 @@ rmf_traffic::Duration Task::Active::estimate_remaining_time() const
   if (_finished)
     return rmf_traffic::Duration(0);
 
-  auto remaining_time =
-    _active_phase ? _active_phase->estimate_remaining_time() :
-    rmf_traffic::Duration(0);
-  for (const auto& p : _pending_phases)
-    remaining_time += p.tag()->header().original_duration_estimate();
+  std::lock_guard<std::mutex> lock(_estimate_mutex);
+  if (!_active_estimate.has_value())
+  {
+    _active_estimate = _active_phase ?
+      _active_phase->estimate_remaining_time() : rmf_traffic::Duration(0);
+  }
 
-  return remaining_time;
+  return *_active_estimate + _pending_estimate;
 }
 
 //==============================================================================
@@ -579,7 +775,7 @@ void Task::Active::cancel()
   }
 
   _cancelled_on_phase = _active_phase->tag()->id();
-  _prepare_cancellation_sequence(_active_stage->cancellation_sequence);
+  _begin_cancellation_sequence(_active_stage);
   _active_phase->cancel();
 }
 
@@ -603,14 +799,26 @@ void Task::Active::skip(uint64_t phase_id, bool value)
     return;
   }
 
+  if (_set_skip(phase_id, value))
+    _backup_pending_change();
+}
+
+//==============================================================================
+bool Task::Active::_set_skip(const uint64_t phase_id, const bool value)
+{
   for (auto& p : _pending_phases)
   {
     if (phase_id == p.tag()->id())
     {
+      if (p.will_be_skipped() == value)
+        return false;
+
       p.will_be_skipped(value);
-      return;
+      return true;
     }
   }
+
+  return false;
 }
 
 //==============================================================================
@@ -618,15 +826,9 @@ void Task::Active::rewind(uint64_t phase_id)
 {
   std::lock_guard lock(_next_phase_mutex);
   assert(_completed_phases.size() == _completed_stages.size());
-  std::size_t completed_index = 0;
   auto stage_it = _completed_stages.begin();
-  while (stage_it != _completed_stages.end())
-  {
-    if ((*stage_it)->id == phase_id)
-      break;
-
-    ++completed_index;
-  }
+  while (stage_it != _completed_stages.end() && (*stage_it)->id != phase_id)
+    ++stage_it;
 
   if (stage_it == _completed_stages.end())
   {
@@ -635,18 +837,51 @@ void Task::Active::rewind(uint64_t phase_id)
     return;
   }
 
-  _pending_stages.insert(
-    _pending_stages.begin(),
-    stage_it,
-    _completed_stages.begin());
+  // The stages from the one being rewound to up through the currently active
+  // one are run again before the stages that are still pending, so they are
+  // no longer completed
+  const auto num_kept = static_cast<std::size_t>(
+    std::distance(_completed_stages.begin(), stage_it));
+  std::list<ConstStagePtr> rewound;
+  rewound.splice(
+    rewound.end(), _completed_stages, stage_it, _completed_stages.end());
+  _completed_phases.resize(num_kept);
+  if (_active_stage)
+    rewound.push_back(_active_stage);
+
+  // Only the rewound stages need pending phases made for them. The ones that
+  // are already pending keep theirs, along with their skip flags.
+  std::vector<Phase::Pending> pending;
+  pending.reserve(rewound.size() + _pending_phases.size());
+  rmf_traffic::Duration rewound_estimate(0);
+  for (const auto& s : rewound)
+  {
+    auto tag = _tag_of(*s);
+    rewound_estimate += tag->header().original_duration_estimate();
+    pending.emplace_back(std::move(tag));
+  }
+  _add_pending_estimate(rewound_estimate);
 
-  // The currently active stage should also be put back into pending
-  _pending_stages.push_back(_active_stage);
-  _generate_pending_phases();
+  pending.insert(
+    pending.end(),
+    std::make_move_iterator(_pending_phases.begin()),
+    std::make_move_iterator(_pending_phases.end()));
+  _pending_phases = std::move(pending);
+  _pending_stages.splice(_pending_stages.begin(), rewound);
 
   // If we are supposed to rewind to an earlier stage, then we should cancel
   // the currently active one.
-  _active_phase->cancel();
+  if (_active_phase)
+    _active_phase->cancel();
+}
+
+//==============================================================================
+std::size_t Task::Active::suppressed_updates() const
+{
+  if (_coalescer.has_value())
+    return _coalescer->suppressed();
+
+  return 0;
 }
 
 //==============================================================================
@@ -670,12 +905,20 @@ void Task::Active::_load_backup(std::string backup_state_str)
       _finish_task();
     };
 
-  const auto backup_state = nlohmann::json::parse(backup_state_str);
-  if (const auto result =
-    schemas::ErrorHandler::has_error(backup_schema_validator, backup_state))
+  bool verified = false;
+  const auto backup_state = decode_backup(backup_state_str, verified);
+
+  // A backup whose checksum matches was written by a task like this one, so
+  // neither it nor the phases and events inside of it need to be validated
+  const bool trusted = verified && _trusted_restore;
+  if (!trusted)
   {
-    restore_phase->parsing_failed(result->message);
-    return failed_to_restore();
+    if (const auto result =
+      schemas::ErrorHandler::has_error(backup_schema_validator(), backup_state))
+    {
+      restore_phase->parsing_failed(result->message);
+      return failed_to_restore();
+    }
   }
 
   const auto finished_it = backup_state.find("finished");
@@ -712,7 +955,9 @@ void Task::Active::_load_backup(std::string backup_state_str)
     {
       if (stage->id == cancelled_from)
       {
-        _prepare_cancellation_sequence(stage->cancellation_sequence);
+        // The pending stages get replaced, so hold on to this one
+        const auto cancelled_stage = stage;
+        _begin_cancellation_sequence(cancelled_stage);
         break;
       }
     }
@@ -743,6 +988,10 @@ void Task::Active::_load_backup(std::string backup_state_str)
     return failed_to_restore();
   }
 
+  // The skip flags are applied to the pending phases of the remaining stages,
+  // so those need to be generated first
+  _generate_pending_phases();
+
   const auto& skip_phases_json = backup_state["skip_phases"];
   if (skip_phases_json)
   {
@@ -776,29 +1025,69 @@ void Task::Active::_load_backup(std::string backup_state_str)
     }
   }
 
-  _generate_pending_phases();
+  std::optional<schemas::ErrorHandler::TrustedScope> trusted_scope;
+  if (trusted)
+    trusted_scope.emplace();
+
   _begin_next_stage(std::optional<nlohmann::json>(current_phase_json["state"]));
 }
 
 //==============================================================================
 void Task::Active::_generate_pending_phases()
+{
+  rmf_traffic::Duration pending_estimate(0);
+  _pending_phases = _make_pending_phases(_pending_stages, pending_estimate);
+  for (const auto& p : _pending_phases)
+    _phase_tags[p.tag()->id()] = p.tag();
+
+  std::lock_guard<std::mutex> lock(_estimate_mutex);
+  _pending_estimate = pending_estimate;
+}
+
+//==============================================================================
+std::vector<Phase::Pending> Task::Active::_make_pending_phases(
+  const std::list<ConstStagePtr>& stages,
+  rmf_traffic::Duration& estimate) const
 {
   auto state = _get_state();
-  _pending_phases.clear();
-  _pending_phases.reserve(_pending_stages.size());
-  for (const auto& s : _pending_stages)
+  std::vector<Phase::Pending> pending_phases;
+  pending_phases.reserve(stages.size());
+  estimate = rmf_traffic::Duration(0);
+  for (const auto& s : stages)
   {
-    _pending_phases.emplace_back(
-      std::make_shared<Phase::Tag>(
-        s->id,
-        s->description->generate_header(state, *_parameters)
-      )
-    );
+    auto tag = std::make_shared<Phase::Tag>(
+      s->id,
+      s->description->generate_header(state, *_parameters));
+    estimate += tag->header().original_duration_estimate();
+    pending_phases.emplace_back(std::move(tag));
 
     auto model = s->description->make_model(state, *_parameters);
     if (model)
       state = model->invariant_finish_state();
   }
+
+  return pending_phases;
+}
+
+//==============================================================================
+void Task::Active::_add_pending_estimate(const rmf_traffic::Duration change)
+{
+  std::lock_guard<std::mutex> lock(_estimate_mutex);
+  _pending_estimate += change;
+}
+
+//==============================================================================
+Phase::ConstTagPtr Task::Active::_tag_of(const Stage& stage)
+{
+  const auto it = _phase_tags.find(stage.id);
+  if (it != _phase_tags.end())
+    return it->second;
+
+  auto tag = std::make_shared<Phase::Tag>(
+    stage.id,
+    stage.description->generate_header(_get_state(), *_parameters));
+  _phase_tags[stage.id] = tag;
+  return tag;
 }
 
 //==============================================================================
@@ -817,6 +1106,10 @@ void Task::Active::_finish_phase(Phase::Tag::Id id)
 
   _completed_stages.push_back(_active_stage);
 
+  // Deliver the last update of the phase before announcing that it finished
+  if (_coalescer.has_value())
+    _coalescer->flush();
+
   const auto phase_finish_time = _clock();
   const auto completed_phase = std::make_shared<Phase::Completed>(
     rmf_task::Phase::Snapshot::make(*_active_phase),
@@ -1012,6 +1305,7 @@ void Task::Active::_begin_next_stage(std::optional<nlohmann::json> restore)
     _pending_stages.pop_front();
     auto tag = _pending_phases.front().tag();
     _pending_phases.erase(_pending_phases.begin());
+    _add_pending_estimate(-tag->header().original_duration_estimate());
 
     // Reset our memory of phase backup sequence number
     _last_phase_backup_sequence_number = std::nullopt;
@@ -1040,7 +1334,21 @@ void Task::Active::_begin_next_stage(std::optional<nlohmann::json> restore)
           {
             const auto active_phase = self->_active_phase;
             if (active_phase)
-              self->_update(Phase::Snapshot::make(*active_phase));
+            {
+              // The cancellation phase only refreshes its final event when
+              // the phase that it wraps reports a change
+              if (const auto cancellation =
+                std::dynamic_pointer_cast<phases::CancellationPhase>(
+                  active_phase))
+              {
+                cancellation->update();
+              }
+
+              self->_notify_update([active_phase]()
+                {
+                  return Phase::Snapshot::make(*active_phase);
+                });
+            }
           }
         },
         [me = weak_from_this(), id = phase_id](
@@ -1068,7 +1376,7 @@ void Task::Active::_begin_next_stage(std::optional<nlohmann::json> restore)
         [me = weak_from_this()](Phase::ConstSnapshotPtr snapshot)
         {
           if (const auto self = me.lock())
-            self->_update(snapshot);
+            self->_notify_update([snapshot]() { return snapshot; });
         },
         [me = weak_from_this(), id = phase_id](
           Phase::Active::Backup backup)
@@ -1083,7 +1391,14 @@ void Task::Active::_begin_next_stage(std::optional<nlohmann::json> restore)
         });
     }
 
-    _update(Phase::Snapshot::make(*_active_phase));
+    // Build the cancellation sequence of the new phase now, while nothing is
+    // urgent, so that a cancel only has to switch over to it
+    if (!_cancelled_on_phase.has_value())
+      _prepare_cancellation_sequence(_active_stage);
+
+    _notify_update(
+      [snapshot = Phase::Snapshot::make(*_active_phase)]() { return snapshot; },
+      true);
     _issue_backup(phase_id, _active_phase->backup());
     return;
   }
@@ -1096,6 +1411,29 @@ void Task::Active::_finish_task()
   _task_finished();
 }
 
+//==============================================================================
+void Task::Active::_notify_update(
+  std::function<Phase::ConstSnapshotPtr()> make_snapshot,
+  const bool urgent)
+{
+  {
+    // The active phase has made progress or been replaced, so its estimate
+    // needs to be computed again
+    std::lock_guard<std::mutex> lock(_estimate_mutex);
+    _active_estimate = std::nullopt;
+  }
+
+  if (!_coalescer.has_value())
+  {
+    _update(make_snapshot());
+    return;
+  }
+
+  _coalescer->notify(std::move(make_snapshot));
+  if (urgent)
+    _coalescer->flush();
+}
+
 //==============================================================================
 void Task::Active::_issue_backup(
   Phase::Tag::Id source_phase_id,
@@ -1118,42 +1456,125 @@ void Task::Active::_issue_backup(
   }
 
   _last_phase_backup_sequence_number = phase_backup.sequence();
-  _checkpoint(_generate_backup(source_phase_id, std::move(phase_backup)));
+  _checkpoint_root(
+    _generate_backup_root(source_phase_id, std::move(phase_backup)));
+}
+
+//==============================================================================
+void Task::Active::_backup_pending_change() const
+{
+  if (!_active_phase)
+  {
+    // The skip flags will go into the first backup once a phase is active
+    return;
+  }
+
+  const auto phase_id = _active_phase->tag()->id();
+  if (_last_checkpoint_root.has_value())
+  {
+    // Only the skip flags changed, so the state of the active phase is taken
+    // from the last checkpoint instead of backing up the phase again
+    const nlohmann::json& last_root = *_last_checkpoint_root;
+    const auto last_phase = last_root.find("current_phase");
+    if (last_phase != last_root.end()
+      && last_phase->value("id", nlohmann::json()) == phase_id)
+    {
+      _checkpoint_root(
+        _generate_backup_root(
+          phase_id,
+          Phase::Active::Backup::make(0, last_phase->at("state"))));
+      return;
+    }
+  }
+
+  _checkpoint_root(_generate_backup_root(phase_id, _active_phase->backup()));
+}
+
+//==============================================================================
+void Task::Active::_checkpoint_root(nlohmann::json root) const
+{
+  if (_last_checkpoint_root.has_value() && *_last_checkpoint_root == root)
+  {
+    // Nothing that goes into the backup has changed since the last checkpoint,
+    // so there is no need to serialize it or issue a new sequence number
+    return;
+  }
+
+  _checkpoint(
+    Backup::make(
+      _next_task_backup_sequence_number++,
+      encode_backup(root, _backup_encoding, _trusted_restore)));
+  _last_checkpoint_root = std::move(root);
 }
 
 //==============================================================================
-void Task::Active::_prepare_cancellation_sequence(
-  std::vector<Phase::ConstDescriptionPtr> sequence)
+void Task::Active::_prepare_cancellation_sequence(const ConstStagePtr& stage)
 {
-  _pending_phases.clear();
-  _pending_stages.clear();
+  if (_prepared_cancellation.has_value()
+    && _prepared_cancellation->stage == stage)
+    return;
+
+  PreparedCancellation prepared;
+  prepared.stage = stage;
 
   uint64_t next_stage_id = _cancel_sequence_initial_id;
-  for (auto&& phase : sequence)
+  for (const auto& phase : stage->cancellation_sequence)
   {
-    _pending_stages.emplace_back(
+    prepared.stages.emplace_back(
       std::make_shared<Stage>(
         Stage{
           next_stage_id++,
-          std::move(phase),
+          phase,
           {}
         }));
   }
 
-  _generate_pending_phases();
+  prepared.pending_phases =
+    _make_pending_phases(prepared.stages, prepared.estimate);
+  _prepared_cancellation = std::move(prepared);
+}
+
+//==============================================================================
+void Task::Active::_begin_cancellation_sequence(const ConstStagePtr& stage)
+{
+  _prepare_cancellation_sequence(stage);
+  auto prepared = std::move(*_prepared_cancellation);
+  _prepared_cancellation = std::nullopt;
+
+  _pending_stages = std::move(prepared.stages);
+  _pending_phases = std::move(prepared.pending_phases);
+  for (const auto& p : _pending_phases)
+    _phase_tags[p.tag()->id()] = p.tag();
+
+  std::lock_guard<std::mutex> lock(_estimate_mutex);
+  _pending_estimate = prepared.estimate;
 }
 
 //==============================================================================
 auto Task::Active::_generate_backup(
   Phase::Tag::Id current_phase_id,
   Phase::Active::Backup phase_backup) const -> Backup
+{
+  RMF_TASK_TRACE_SPAN("Task::Active::backup");
+  rmf_task::Metrics::add(rmf_task::Metrics::Counter::task_backups);
+  return Backup::make(
+    _next_task_backup_sequence_number++,
+    encode_backup(
+      _generate_backup_root(current_phase_id, std::move(phase_backup)),
+      _backup_encoding, _trusted_restore));
+}
+
+//==============================================================================
+nlohmann::json Task::Active::_generate_backup_root(
+  Phase::Tag::Id current_phase_id,
+  Phase::Active::Backup phase_backup) const
 {
   nlohmann::json current_phase;
   current_phase["id"] = current_phase_id;
   if (_cancelled_on_phase.has_value())
     current_phase["cancelled_from"] = *_cancelled_on_phase;
 
-  current_phase["state"] = phase_backup.state();
+  current_phase["state"] = phase_backup.release_state();
 
   std::vector<uint64_t> skipping_phases;
   for (const auto& p : _pending_phases)
@@ -1168,7 +1589,7 @@ auto Task::Active::_generate_backup(
   root["skip_phases"] = std::move(skipping_phases);
   // TODO(MXG): Is there anything else we need to consider as part of the state?
 
-  return Backup::make(_next_task_backup_sequence_number++, root.dump());
+  return root;
 }
 
 //==============================================================================
@@ -1182,18 +1603,26 @@ auto Task::Active::_empty_backup() const -> Backup
   root["schema_version"] = 1;
   root["finished"] = _finished;
 
-  return Backup::make(_next_task_backup_sequence_number++, root.dump());
+  return Backup::make(
+    _next_task_backup_sequence_number++,
+    encode_backup(root, _backup_encoding, _trusted_restore));
 }
 
 //==============================================================================
 auto Task::make_activator(
   Phase::ConstActivatorPtr phase_activator,
-  std::function<rmf_traffic::Time()> clock)
+  std::function<rmf_traffic::Time()> clock,
+  std::optional<rmf_traffic::Duration> minimum_update_period,
+  BackupEncoding backup_encoding,
+  bool trusted_restore)
 -> rmf_task::Activator::Activate<Description>
 {
   return [
     phase_activator = std::move(phase_activator),
-    clock = std::move(clock)
+    clock = std::move(clock),
+    minimum_update_period,
+    backup_encoding,
+    trusted_restore
   ](
     const std::function<State()>& get_state,
     const ConstParametersPtr& parameters,
@@ -1216,7 +1645,10 @@ auto Task::make_activator(
         std::move(update),
         std::move(checkpoint),
         std::move(phase_finished),
-        std::move(task_finished));
+        std::move(task_finished),
+        minimum_update_period,
+        backup_encoding,
+        trusted_restore);
     };
 }
 
@@ -1224,10 +1656,15 @@ auto Task::make_activator(
 void Task::add(
   rmf_task::Activator& activator,
   Phase::ConstActivatorPtr phase_activator,
-  std::function<rmf_traffic::Time()> clock)
+  std::function<rmf_traffic::Time()> clock,
+  std::optional<rmf_traffic::Duration> minimum_update_period,
+  BackupEncoding backup_encoding,
+  bool trusted_restore)
 {
   activator.add_activator<Task::Description>(
-    make_activator(std::move(phase_activator), std::move(clock)));
+    make_activator(
+      std::move(phase_activator), std::move(clock), minimum_update_period,
+      backup_encoding, trusted_restore));
 }
 
 } // namespace rmf_task_sequence
@@ -22,10 +22,11 @@
 #include <nlohmann/json-schema.hpp>
 
 #include <rmf_task_sequence/schemas/ErrorHandler.hpp>
-#include <rmf_task_sequence/schemas/backup_EventSequence_v0_1.hpp>
 
+#include "internal_Parallel.hpp"
 #include "internal_Sequence.hpp"
 
+#include <algorithm>
 #include <vector>
 
 namespace rmf_task_sequence {
@@ -35,17 +36,73 @@ namespace {
 //==============================================================================
 nlohmann::json convert_to_json(const std::string& input)
 {
-  nlohmann::json output;
-  try
+  // Most details are plain text, so avoid throwing for each one of them
+  auto output = nlohmann::json::parse(input, nullptr, false);
+  if (output.is_discarded())
+    return input;
+
+  return output;
+}
+
+//==============================================================================
+// Like Bundle::initiate, except that the initializer is owned, so the elements
+// of a long sequence can be initialized lazily
+Event::StandbyPtr initiate_owned(
+  const Event::ConstInitializerPtr& initializer,
+  const Event::AssignIDPtr& id,
+  const std::function<rmf_task::State()>& get_state,
+  const ConstParametersPtr& parameters,
+  const Bundle::Description& description,
+  std::function<void()> parent_update)
+{
+  if (description.type() == Bundle::Type::Sequence)
   {
-    output = nlohmann::json::parse(input);
+    return internal::Sequence::Standby::initiate(
+      *initializer,
+      id,
+      get_state,
+      parameters,
+      description,
+      std::move(parent_update),
+      initializer);
   }
-  catch (const std::exception&)
+
+  return Bundle::initiate(
+    *initializer, id, get_state, parameters, description,
+    std::move(parent_update));
+}
+
+//==============================================================================
+// Like Bundle::restore, except that the initializer is owned
+Event::ActivePtr restore_owned(
+  const Event::ConstInitializerPtr& initializer,
+  const Event::AssignIDPtr& id,
+  const std::function<rmf_task::State()>& get_state,
+  const ConstParametersPtr& parameters,
+  const Bundle::Description& description,
+  const nlohmann::json& backup_state,
+  std::function<void()> parent_update,
+  std::function<void()> checkpoint,
+  std::function<void()> finished)
+{
+  if (description.type() == Bundle::Type::Sequence)
   {
-    output = input;
+    return internal::Sequence::Active::restore(
+      *initializer,
+      id,
+      get_state,
+      parameters,
+      description,
+      backup_state,
+      std::move(parent_update),
+      std::move(checkpoint),
+      std::move(finished),
+      initializer);
   }
 
-  return output;
+  return Bundle::restore(
+    *initializer, id, get_state, parameters, description, backup_state,
+    std::move(parent_update), std::move(checkpoint), std::move(finished));
 }
 } // anonymous namespace
 
@@ -69,6 +126,18 @@ Event::StandbyPtr Bundle::initiate(
       std::move(parent_update));
   }
 
+  if (description.type() == Bundle::Type::ParallelAll
+    || description.type() == Bundle::Type::ParallelAny)
+  {
+    return internal::Parallel::Standby::initiate(
+      initializer,
+      id,
+      get_state,
+      parameters,
+      description,
+      std::move(parent_update));
+  }
+
   // *INDENT-OFF*
   throw std::runtime_error(
     "[rmf_task_sequence::events::Bundle::initiate] "
@@ -84,7 +153,7 @@ Event::ActivePtr Bundle::restore(
   const std::function<rmf_task::State()>& get_state,
   const ConstParametersPtr& parameters,
   const Bundle::Description& description,
-  const std::string& backup,
+  const nlohmann::json& backup_state,
   std::function<void()> parent_update,
   std::function<void()> checkpoint,
   std::function<void()> finished)
@@ -97,12 +166,27 @@ Event::ActivePtr Bundle::restore(
       get_state,
       parameters,
       description,
-      backup,
+      backup_state,
       parent_update,
       checkpoint,
       finished);
   }
 
+  if (description.type() == Bundle::Type::ParallelAll
+    || description.type() == Bundle::Type::ParallelAny)
+  {
+    return internal::Parallel::Active::restore(
+      initializer,
+      id,
+      get_state,
+      parameters,
+      description,
+      backup_state,
+      std::move(parent_update),
+      std::move(checkpoint),
+      std::move(finished));
+  }
+
   // *INDENT-OFF*
   throw std::runtime_error(
     "Bundle type not yet implemented: " + std::to_string(description.type()));
@@ -128,11 +212,10 @@ public:
     {
       case Type::Sequence:
         return "Sequence";
-        // TODO(MXG): Bring back this code when we want to support other types
-//      case Type::ParallelAll:
-//        return "All of";
-//      case Type::ParallelAny:
-//        return "One of";
+      case Type::ParallelAll:
+        return "All of";
+      case Type::ParallelAny:
+        return "One of";
     }
 
     return "<?Undefined Bundle?>";
@@ -142,65 +225,133 @@ public:
     std::optional<rmf_traffic::Duration> current_estimate,
     rmf_traffic::Duration next_dependency_estimate) const
   {
-    // TODO(MXG): Bring back this code when we want to support other types
-//    if (current_estimate.has_value())
-//    {
-//      if (Type::ParallelAll == type)
-//        return std::max(*current_estimate, next_dependency_estimate);
-//      else if (Type::ParallelAny == type)
-//        return std::min(*current_estimate, next_dependency_estimate);
-//    }
-//    else
-//    {
-//      if (Type::ParallelAll == type || Type::ParallelAny == type)
-//        return next_dependency_estimate;
-//    }
+    if (current_estimate.has_value())
+    {
+      if (Type::ParallelAll == type)
+        return std::max(*current_estimate, next_dependency_estimate);
+      else if (Type::ParallelAny == type)
+        return std::min(*current_estimate, next_dependency_estimate);
+    }
 
     return current_estimate.value_or(rmf_traffic::Duration(0))
       + next_dependency_estimate;
   }
 
-  Header generate_header(
+  using MakeJson = std::function<nlohmann::json()>;
+
+  // The header of a bundle whose detail is only composed when it is needed.
+  // Nested bundles hand their detail to their parent as json directly.
+  struct LazyHeader
+  {
+    std::string category;
+    MakeJson detail;
+    rmf_traffic::Duration duration;
+  };
+
+  LazyHeader generate(
     rmf_task::State initial_state,
     const Parameters& parameters) const
   {
-    std::optional<std::vector<nlohmann::json>> detail_json;
-    if (!detail.has_value())
-      detail_json = std::vector<nlohmann::json>();
+    struct Element
+    {
+      std::string category;
+      MakeJson detail;
+    };
 
+    std::vector<Element> elements;
     std::optional<rmf_traffic::Duration> duration_estimate;
 
     for (const auto& element : dependencies)
     {
-      const auto element_header =
-        element->generate_header(initial_state, parameters);
+      const auto* bundle =
+        dynamic_cast<const Bundle::Description*>(element.get());
 
-      duration_estimate = adjust_estimate(
-        duration_estimate, element_header.original_duration_estimate());
+      if (bundle)
+      {
+        auto header = bundle->_pimpl->generate(initial_state, parameters);
+        duration_estimate = adjust_estimate(
+          duration_estimate, header.duration);
+
+        if (!detail.has_value())
+        {
+          elements.push_back(
+            {std::move(header.category), std::move(header.detail)});
+        }
+      }
+      else
+      {
+        auto header = element->generate_header(initial_state, parameters);
+        duration_estimate = adjust_estimate(
+          duration_estimate, header.original_duration_estimate());
+
+        if (!detail.has_value())
+        {
+          std::string element_category = header.category();
+          elements.push_back(
+            {
+              std::move(element_category),
+              [header = std::move(header)]()
+              {
+                return convert_to_json(header.detail());
+              }
+            });
+        }
+      }
+
+      // The dependencies of a parallel bundle all begin from the same state
+      if (type != Type::Sequence)
+        continue;
 
       auto model = element->make_model(initial_state, parameters);
       if (model)
         initial_state = model->invariant_finish_state();
-
-      if (detail_json.has_value())
-      {
-        nlohmann::json element_output;
-        element_output["category"] = element_header.category();
-        element_output["detail"] = convert_to_json(element_header.detail());
-        detail_json->emplace_back(std::move(element_output));
-      }
     }
 
-    std::string output_detail;
+    MakeJson make_detail;
     if (detail.has_value())
-      output_detail = *detail;
+    {
+      make_detail = [detail = *detail]() { return convert_to_json(detail); };
+    }
     else
-      output_detail = nlohmann::json(*detail_json).dump();
+    {
+      make_detail = [elements = std::move(elements)]()
+        {
+          std::vector<nlohmann::json> detail_json;
+          detail_json.reserve(elements.size());
+          for (const auto& element : elements)
+          {
+            nlohmann::json element_output;
+            element_output["category"] = element.category;
+            element_output["detail"] = element.detail();
+            detail_json.emplace_back(std::move(element_output));
+          }
+
+          return nlohmann::json(std::move(detail_json));
+        };
+    }
 
-    return Header(
+    return LazyHeader{
       generate_category(),
-      std::move(output_detail),
-      duration_estimate.value_or(rmf_traffic::Duration(0)));
+      std::move(make_detail),
+      duration_estimate.value_or(rmf_traffic::Duration(0))
+    };
+  }
+
+  Header generate_header(
+    rmf_task::State initial_state,
+    const Parameters& parameters) const
+  {
+    auto header = generate(std::move(initial_state), parameters);
+    if (detail.has_value())
+      return Header(std::move(header.category), *detail, header.duration);
+
+    return Header(
+      std::move(header.category),
+      [make_detail = std::move(header.detail)]()
+      {
+        return make_detail().dump();
+      },
+      header.duration);
   }
 };
 
@@ -281,12 +432,36 @@ Activity::ConstModelPtr Bundle::Description::make_model(
   rmf_task::State invariant_initial_state,
   const Parameters& parameters) const
 {
+  if (_pimpl->type != Type::Sequence)
+  {
+    return internal::Parallel::Model::make(
+      _pimpl->type,
+      _pimpl->dependencies,
+      std::move(invariant_initial_state),
+      parameters);
+  }
+
   return Activity::SequenceModel::make(
     _pimpl->dependencies,
     std::move(invariant_initial_state),
     parameters);
 }
 
+//==============================================================================
+std::optional<rmf_task::State>
+Bundle::Description::predict_invariant_finish_state(
+  const rmf_task::State& invariant_initial_state,
+  const Parameters& parameters) const
+{
+  // Which dependency of a parallel bundle ends up deciding its finish state
+  // depends on their durations, so the models need to be made
+  if (_pimpl->type != Type::Sequence)
+    return std::nullopt;
+
+  return Activity::SequenceModel::predict_invariant_finish_state(
+    _pimpl->dependencies, invariant_initial_state, parameters);
+}
+
 //==============================================================================
 Header Bundle::Description::generate_header(
   const rmf_task::State& initial_state,
@@ -315,8 +490,8 @@ void Bundle::add(const Event::InitializerPtr& initializer)
           "initialize an event.");
       }
 
-      return initiate(
-        *initialize_from,
+      return initiate_owned(
+        initialize_from,
         id,
         get_state,
         parameters,
@@ -342,8 +517,8 @@ void Bundle::add(const Event::InitializerPtr& initializer)
           "initialize an event.");
       }
 
-      return restore(
-        *initialize_from,
+      return restore_owned(
+        initialize_from,
         id,
         get_state,
         parameters,
@@ -368,8 +543,8 @@ void Bundle::add(
       const Bundle::Description& description,
       std::function<void()> update)
     {
-      return initiate(
-        *initialize_from,
+      return initiate_owned(
+        initialize_from,
         id,
         get_state,
         parameters,
@@ -386,8 +561,8 @@ void Bundle::add(
       std::function<void()> checkpoint,
       std::function<void()> finished)
     {
-      return restore(
-        *initialize_from,
+      return restore_owned(
+        initialize_from,
         id,
         get_state,
         parameters,
@@ -416,6 +591,12 @@ Event::StandbyPtr Bundle::standby(
     return sequence;
   }
 
+  if (type == Bundle::Type::ParallelAll || type == Bundle::Type::ParallelAny)
+  {
+    return internal::Parallel::Standby::initiate(
+      type, dependencies, std::move(state), std::move(update));
+  }
+
   // *INDENT-OFF*
   throw std::runtime_error(
     "[rmf_task_sequence::events::Bundle::activate] "
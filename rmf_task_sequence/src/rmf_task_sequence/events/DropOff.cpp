@@ -113,6 +113,15 @@ Activity::ConstModelPtr DropOff::Description::make_model(
     std::move(invariant_initial_state), parameters);
 }
 
+//==============================================================================
+std::optional<State> DropOff::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters& parameters) const
+{
+  return _pimpl->transfer.predict_invariant_finish_state(
+    invariant_initial_state, parameters);
+}
+
 //==============================================================================
 Header DropOff::Description::generate_header(
   const State& initial_state,
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task_sequence/events/EventStateTree.hpp>
+
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace rmf_task_sequence {
+namespace events {
+
+namespace {
+
+//==============================================================================
+constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+//==============================================================================
+std::optional<std::size_t> maybe(std::size_t index)
+{
+  if (index == none)
+    return std::nullopt;
+
+  return index;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class EventStateTree::Implementation
+{
+public:
+
+  // One event of the tree. Its dependencies are linked through the indices of
+  // its first and last child and of its next sibling.
+  class Node : public rmf_task::Event::State
+  {
+  public:
+
+    Node(
+      const Implementation* tree_,
+      uint64_t id_,
+      std::string name_,
+      std::string detail_,
+      Status status_,
+      std::size_t parent_)
+    : tree(tree_),
+      id_value(id_),
+      status_value(status_),
+      name_value(std::move(name_)),
+      detail_value(std::move(detail_)),
+      parent(parent_)
+    {
+      // Do nothing
+    }
+
+    uint64_t id() const final
+    {
+      return id_value;
+    }
+
+    Status status() const final
+    {
+      return status_value;
+    }
+
+    rmf_task::VersionedString::View name() const final
+    {
+      return name_value.view();
+    }
+
+    rmf_task::VersionedString::View detail() const final
+    {
+      return detail_value.view();
+    }
+
+    rmf_task::Log::View log() const final
+    {
+      if (log_value)
+        return log_value->view();
+
+      return tree->empty_log.view();
+    }
+
+    std::vector<rmf_task::Event::ConstStatePtr> dependencies() const final
+    {
+      std::vector<rmf_task::Event::ConstStatePtr> output;
+      output.reserve(num_children);
+      for (auto i = first_child; i != none; i = tree->nodes[i].next_sibling)
+        output.push_back(tree->state(i));
+
+      return output;
+    }
+
+    std::optional<uint64_t> version() const final
+    {
+      // Each of these only grows, so their sum changes whenever any of them
+      // does
+      return changes + name_value.version() + detail_value.version()
+        + (log_value ? log_value->version() : 0);
+    }
+
+    const Implementation* tree;
+    uint64_t id_value;
+    Status status_value;
+    rmf_task::VersionedString name_value;
+    rmf_task::VersionedString detail_value;
+    std::unique_ptr<rmf_task::Log> log_value;
+
+    std::size_t parent;
+    std::size_t first_child = none;
+    std::size_t last_child = none;
+    std::size_t next_sibling = none;
+    std::size_t num_children = 0;
+
+    // Counts the changes to the fields that do not have versions of their own
+    uint64_t changes = 0;
+  };
+
+  Implementation(
+    std::size_t capacity_,
+    std::function<rmf_traffic::Time()> clock_)
+  : capacity(capacity_),
+    clock(std::move(clock_)),
+    empty_log(clock)
+  {
+    // The nodes must never be moved once they are given out, so all of them
+    // are allocated up front
+    nodes.reserve(capacity);
+  }
+
+  const Node& get(const std::size_t index) const
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    if (index >= nodes.size())
+    {
+      throw std::out_of_range(
+        "Index [" + std::to_string(index) + "] is outside of an "
+        "EventStateTree with [" + std::to_string(nodes.size()) + "] events");
+    }
+    // *INDENT-ON*
+
+    return nodes[index];
+  }
+
+  Node& get(const std::size_t index)
+  {
+    const auto& self = *this;
+    return const_cast<Node&>(self.get(index));
+  }
+
+  rmf_task::Event::ConstStatePtr state(const std::size_t index) const
+  {
+    // Alias the ownership of the whole tree
+    return rmf_task::Event::ConstStatePtr(
+      owner->shared_from_this(), &get(index));
+  }
+
+  std::size_t capacity;
+  std::function<rmf_traffic::Time()> clock;
+  std::vector<Node> nodes;
+
+  // Given to events that have not logged anything yet
+  rmf_task::Log empty_log;
+
+  const EventStateTree* owner = nullptr;
+};
+
+//==============================================================================
+std::shared_ptr<EventStateTree> EventStateTree::make(
+  const std::size_t capacity,
+  std::function<rmf_traffic::Time()> clock)
+{
+  EventStateTree tree;
+  tree._pimpl = rmf_utils::make_unique_impl<Implementation>(
+    capacity, std::move(clock));
+
+  auto output = std::make_shared<EventStateTree>(std::move(tree));
+  output->_pimpl->owner = output.get();
+  return output;
+}
+
+//==============================================================================
+auto EventStateTree::add(
+  const uint64_t id,
+  std::string name,
+  std::string detail,
+  const Status initial_status,
+  const std::optional<Index> parent) -> Index
+{
+  auto& nodes = _pimpl->nodes;
+  // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+  if (nodes.size() >= _pimpl->capacity)
+  {
+    throw std::length_error(
+      "EventStateTree is already at its capacity of ["
+      + std::to_string(_pimpl->capacity) + "] events");
+  }
+  // *INDENT-ON*
+
+  if (parent.has_value())
+    _pimpl->get(*parent);
+
+  const auto index = nodes.size();
+  nodes.emplace_back(
+    _pimpl.get(), id, std::move(name), std::move(detail), initial_status,
+    parent.value_or(none));
+
+  if (parent.has_value())
+  {
+    auto& p = nodes[*parent];
+    if (p.last_child == none)
+      p.first_child = index;
+    else
+      nodes[p.last_child].next_sibling = index;
+
+    p.last_child = index;
+    ++p.num_children;
+    ++p.changes;
+  }
+
+  return index;
+}
+
+//==============================================================================
+std::size_t EventStateTree::size() const
+{
+  return _pimpl->nodes.size();
+}
+
+//==============================================================================
+std::size_t EventStateTree::capacity() const
+{
+  return _pimpl->capacity;
+}
+
+//==============================================================================
+rmf_task::Event::ConstStatePtr EventStateTree::state(const Index index) const
+{
+  return _pimpl->state(index);
+}
+
+//==============================================================================
+auto EventStateTree::status(const Index index) const -> Status
+{
+  return _pimpl->get(index).status_value;
+}
+
+//==============================================================================
+EventStateTree& EventStateTree::update_status(
+  const Index index,
+  const Status new_status)
+{
+  auto& node = _pimpl->get(index);
+  if (node.status_value == new_status)
+    return *this;
+
+  node.status_value = new_status;
+  ++node.changes;
+  return *this;
+}
+
+//==============================================================================
+EventStateTree& EventStateTree::update_name(
+  const Index index,
+  std::string new_name)
+{
+  _pimpl->get(index).name_value.update(std::move(new_name));
+  return *this;
+}
+
+//==============================================================================
+EventStateTree& EventStateTree::update_detail(
+  const Index index,
+  std::string new_detail)
+{
+  _pimpl->get(index).detail_value.update(std::move(new_detail));
+  return *this;
+}
+
+//==============================================================================
+rmf_task::Log& EventStateTree::update_log(const Index index)
+{
+  auto& node = _pimpl->get(index);
+  if (!node.log_value)
+    node.log_value = std::make_unique<rmf_task::Log>(_pimpl->clock);
+
+  return *node.log_value;
+}
+
+//==============================================================================
+auto EventStateTree::parent(const Index index) const -> std::optional<Index>
+{
+  return maybe(_pimpl->get(index).parent);
+}
+
+//==============================================================================
+auto EventStateTree::first_child(const Index index) const
+-> std::optional<Index>
+{
+  return maybe(_pimpl->get(index).first_child);
+}
+
+//==============================================================================
+auto EventStateTree::next_sibling(const Index index) const
+-> std::optional<Index>
+{
+  return maybe(_pimpl->get(index).next_sibling);
+}
+
+//==============================================================================
+auto EventStateTree::sequence_status(const Index index) const -> Status
+{
+  const auto& nodes = _pimpl->nodes;
+  Status status = Status::Completed;
+  for (auto i = _pimpl->get(index).first_child; i != none;
+    i = nodes[i].next_sibling)
+  {
+    status = rmf_task::Event::sequence_status(status, nodes[i].status_value);
+  }
+
+  return status;
+}
+
+//==============================================================================
+EventStateTree::EventStateTree()
+{
+  // Do nothing
+}
+
+} // namespace events
+} // namespace rmf_task_sequence
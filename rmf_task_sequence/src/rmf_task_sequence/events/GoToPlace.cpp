@@ -24,22 +24,55 @@ namespace events {
 
 namespace {
 //==============================================================================
-std::optional<rmf_traffic::Duration> estimate_duration(
-  const std::shared_ptr<const rmf_traffic::agv::Planner>& planner,
+struct SelectedGoal
+{
+  std::size_t index;
+  rmf_traffic::Duration duration;
+};
+
+//==============================================================================
+// Choose the goal that takes the least time to reach. Every goal is estimated
+// in one call to the TravelEstimator that is shared by everything planning
+// with these parameters, so the travel between each pair of waypoints is only
+// planned once no matter how many models or headers ask for it.
+std::optional<SelectedGoal> select_goal(
+  const Parameters& parameters,
   const State& initial_state,
-  const GoToPlace::Goal& goal)
+  const std::vector<GoToPlace::Goal>& goals)
 {
-  const auto result =
-    planner->setup(initial_state.project_plan_start().value(), goal);
+  const auto start = initial_state.project_plan_start();
+  if (!start.has_value() || goals.empty())
+    return std::nullopt;
+
+  const auto estimates =
+    TravelEstimator::shared(parameters)->estimate(*start, goals);
 
   // TODO(MXG): Perhaps print errors/warnings about these failure conditions
-  if (result.disconnected())
-    return std::nullopt;
+  std::optional<SelectedGoal> selected;
+  for (std::size_t i = 0; i < estimates.size(); ++i)
+  {
+    const auto& estimate = estimates[i];
+    if (!estimate.has_value())
+      continue;
 
-  if (!result.ideal_cost().has_value())
-    return std::nullopt;
+    if (!selected.has_value() || estimate->duration() < selected->duration)
+      selected = SelectedGoal{i, estimate->duration()};
+  }
+
+  return selected;
+}
+
+//==============================================================================
+State arrive_at(State state, const GoToPlace::Goal& goal)
+{
+  state.waypoint(goal.waypoint());
+
+  if (goal.orientation())
+    state.orientation(*goal.orientation());
+  else
+    state.erase<State::CurrentOrientation>();
 
-  return rmf_traffic::time::from_seconds(*result.ideal_cost());
+  return state;
 }
 } // anonymous namespace
 
@@ -89,45 +122,23 @@ Activity::ConstModelPtr GoToPlace::Model::make(
     return nullptr;
   }
 
-  auto invariant_finish_state = invariant_initial_state;
-
   auto selected_goal = goals[0];
   std::optional<rmf_traffic::Duration> shortest_travel_time = std::nullopt;
   if (invariant_initial_state.waypoint().has_value())
   {
-    for (const auto& goal: goals)
-    {
-      const auto invariant_duration_opt = estimate_duration(
-        parameters.planner(),
-        invariant_initial_state,
-        goal);
-
-      if (!shortest_travel_time.has_value())
-      {
-        shortest_travel_time = invariant_duration_opt;
-        selected_goal = goal;
-      }
-      else if (shortest_travel_time.value() > invariant_duration_opt.value())
-      {
-        shortest_travel_time = invariant_duration_opt;
-        selected_goal = goal;
-      }
-    }
+    const auto selected =
+      select_goal(parameters, invariant_initial_state, goals);
 
-    if (!shortest_travel_time.has_value())
+    if (!selected.has_value())
       return nullptr;
-  }
-
-  invariant_finish_state.waypoint(selected_goal.waypoint());
 
-  if (selected_goal.orientation())
-    invariant_finish_state.orientation(*selected_goal.orientation());
-  else
-    invariant_finish_state.erase<State::CurrentOrientation>();
+    selected_goal = goals[selected->index];
+    shortest_travel_time = selected->duration;
+  }
 
   return std::shared_ptr<Model>(
     new Model(
-      std::move(invariant_finish_state),
+      arrive_at(std::move(invariant_initial_state), selected_goal),
       shortest_travel_time.value_or(rmf_traffic::Duration(0)),
       std::move(selected_goal)));
 }
@@ -259,6 +270,23 @@ Activity::ConstModelPtr GoToPlace::Description::make_model(
     _pimpl->one_of);
 }
 
+//==============================================================================
+std::optional<State> GoToPlace::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters&) const
+{
+  // The goal is only known without planning if there is nothing to choose
+  // between, or if the initial waypoint is unknown so the first goal is used
+  const auto& goals = _pimpl->one_of;
+  if (goals.empty())
+    return std::nullopt;
+
+  if (goals.size() == 1 || !invariant_initial_state.waypoint().has_value())
+    return arrive_at(invariant_initial_state, goals.front());
+
+  return std::nullopt;
+}
+
 //==============================================================================
 Header GoToPlace::Description::generate_header(
   const State& initial_state,
@@ -287,12 +315,8 @@ Header GoToPlace::Description::generate_header(
 
   const auto start_name = rmf_task::standard_waypoint_name(graph, start_wp);
 
-  std::optional<rmf_traffic::Duration> estimate = std::nullopt;
-  std::size_t selected_index = 0;
-  for (std::size_t i = 0; i < _pimpl->one_of.size(); i ++)
+  for (const auto& dest : _pimpl->one_of)
   {
-    auto dest = _pimpl->one_of[i];
-
     if (graph.num_waypoints() <= dest.waypoint())
     {
       utils::fail(fail_header, "Destination waypoint ["
@@ -300,28 +324,12 @@ Header GoToPlace::Description::generate_header(
         + "] is outside the graph [" + std::to_string(graph.num_waypoints())
         + "]");
     }
-
-    if (estimate.has_value())
-    {
-      auto curr_est = estimate_duration(
-        parameters.planner(), initial_state, dest);
-      if (curr_est.has_value() && curr_est.value() < estimate)
-      {
-        estimate = curr_est;
-        selected_index = i;
-      }
-    }
-    else
-    {
-      estimate = estimate_duration(
-        parameters.planner(), initial_state, dest);
-      selected_index = i;
-    }
   }
 
-  if (!estimate.has_value())
+  const auto selected = select_goal(parameters, initial_state, _pimpl->one_of);
+  if (!selected.has_value())
   {
-    Header(
+    return Header(
       "Go to one of [" + destination_name(parameters) + "]",
       "Waiting for path to open up",
       rmf_traffic::Duration(0));
@@ -334,12 +342,12 @@ Header GoToPlace::Description::generate_header(
         goal.waypoint());
     };
 
-  const auto goal_name_ = goal_name(_pimpl->one_of[selected_index]);
+  const auto goal_name_ = goal_name(_pimpl->one_of[selected->index]);
 
   return Header(
     "Go to " + goal_name_,
     "Moving the robot from " + start_name + " to " + goal_name_,
-    *estimate);
+    selected->duration);
 }
 
 //==============================================================================
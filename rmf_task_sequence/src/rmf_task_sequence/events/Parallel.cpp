@@ -0,0 +1,682 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_Parallel.hpp"
+#include "internal_Sequence.hpp"
+
+#include <rmf_task_sequence/schemas/backup_EventParallel_v0_1.hpp>
+
+#include <atomic>
+
+namespace rmf_task_sequence {
+namespace events {
+namespace internal {
+
+namespace {
+//==============================================================================
+rmf_task::events::SimpleEventStatePtr make_state(
+  const Event::AssignIDPtr& id,
+  const Bundle::Description& description)
+{
+  const auto category = description.type() == Bundle::Type::ParallelAll ?
+    "All of" : "One of";
+
+  return rmf_task::events::SimpleEventState::make(
+    id->assign(),
+    description.category().value_or(category),
+    description.detail().value_or(""),
+    rmf_task::Event::Status::Standby);
+}
+
+//==============================================================================
+// Pick the longest of the durations for ParallelAll or the shortest for
+// ParallelAny
+rmf_traffic::Duration combine(
+  Bundle::Type type,
+  std::optional<rmf_traffic::Duration> current,
+  rmf_traffic::Duration next)
+{
+  if (!current.has_value())
+    return next;
+
+  if (type == Bundle::Type::ParallelAll)
+    return std::max(*current, next);
+
+  return std::min(*current, next);
+}
+} // anonymous namespace
+
+//==============================================================================
+void Parallel::update_status(
+  Bundle::Type type,
+  rmf_task::events::SimpleEventState& state)
+{
+  if (state.status() == Event::Status::Canceled
+    || state.status() == Event::Status::Killed
+    || state.status() == Event::Status::Skipped)
+    return;
+
+  const auto dependencies = state.dependencies();
+  if (type == Bundle::Type::ParallelAny)
+  {
+    for (const auto& dep : dependencies)
+    {
+      if (dep->status() == Event::Status::Completed)
+      {
+        state.update_status(Event::Status::Completed);
+        return;
+      }
+    }
+  }
+
+  Event::Status status = Event::Status::Completed;
+  for (const auto& dep : dependencies)
+    status = Event::sequence_status(status, dep->status());
+
+  state.update_status(status);
+}
+
+//==============================================================================
+Event::StandbyPtr Parallel::Standby::initiate(
+  const Event::Initializer& initializer,
+  const Event::AssignIDPtr& id,
+  const std::function<rmf_task::State()>& get_state,
+  const ConstParametersPtr& parameters,
+  const Bundle::Description& description,
+  std::function<void()> parent_update)
+{
+  const auto type = description.type();
+  auto state = make_state(id, description);
+  const auto update = [type, parent_update, state]()
+    {
+      Parallel::update_status(type, *state);
+      parent_update();
+    };
+
+  std::vector<Event::StandbyPtr> dependencies;
+  dependencies.reserve(description.dependencies().size());
+  for (const auto& desc : description.dependencies())
+  {
+    dependencies.push_back(
+      initializer.initialize(id, get_state, parameters, *desc, update));
+  }
+
+  return std::make_shared<Parallel::Standby>(
+    type, std::move(dependencies), std::move(state), std::move(parent_update));
+}
+
+//==============================================================================
+Event::StandbyPtr Parallel::Standby::initiate(
+  Bundle::Type type,
+  const Bundle::DependencySpecifiers& dependencies_fn,
+  rmf_task::events::SimpleEventStatePtr state,
+  std::function<void()> parent_update)
+{
+  const auto update = [type, parent_update, state]()
+    {
+      Parallel::update_status(type, *state);
+      parent_update();
+    };
+
+  std::vector<Event::StandbyPtr> dependencies;
+  dependencies.reserve(dependencies_fn.size());
+  for (const auto& fn : dependencies_fn)
+    dependencies.push_back(fn(update));
+
+  return std::make_shared<Parallel::Standby>(
+    type, std::move(dependencies), std::move(state), std::move(parent_update));
+}
+
+//==============================================================================
+Event::ConstStatePtr Parallel::Standby::state() const
+{
+  return _state;
+}
+
+//==============================================================================
+rmf_traffic::Duration Parallel::Standby::duration_estimate() const
+{
+  std::optional<rmf_traffic::Duration> estimate;
+  for (const auto& dep : _dependencies)
+    estimate = combine(_type, estimate, dep->duration_estimate());
+
+  return estimate.value_or(rmf_traffic::Duration(0));
+}
+
+//==============================================================================
+Event::ActivePtr Parallel::Standby::begin(
+  std::function<void()> checkpoint,
+  std::function<void()> finish)
+{
+  if (_active)
+    return _active;
+
+  _active = std::make_shared<Parallel::Active>(
+    _type, _state, _parent_update, std::move(checkpoint), std::move(finish));
+
+  _active->begin(std::move(_dependencies));
+  return _active;
+}
+
+//==============================================================================
+Parallel::Standby::Standby(
+  Bundle::Type type,
+  std::vector<Event::StandbyPtr> dependencies,
+  rmf_task::events::SimpleEventStatePtr state,
+  std::function<void()> parent_update)
+: _type(type),
+  _dependencies(std::move(dependencies)),
+  _state(std::move(state)),
+  _parent_update(std::move(parent_update))
+{
+  std::vector<Event::ConstStatePtr> state_deps;
+  state_deps.reserve(_dependencies.size());
+  for (const auto& dep : _dependencies)
+    state_deps.push_back(dep->state());
+
+  _state->update_dependencies(std::move(state_deps));
+  Parallel::update_status(_type, *_state);
+}
+
+//==============================================================================
+Event::ActivePtr Parallel::Active::restore(
+  const Event::Initializer& initializer,
+  const Event::AssignIDPtr& id,
+  const std::function<rmf_task::State()>& get_state,
+  const ConstParametersPtr& parameters,
+  const Bundle::Description& description,
+  const nlohmann::json& backup_state,
+  std::function<void()> parent_update,
+  std::function<void()> checkpoint,
+  std::function<void()> finished)
+{
+  const auto type = description.type();
+  auto state = make_state(id, description);
+
+  const auto failed = [&](const std::string& message) -> Event::ActivePtr
+    {
+      state->update_log().error(
+        message + "\nOriginal backup state:\n```" + backup_state.dump()
+        + "\n```");
+      state->update_status(Event::Status::Error);
+      return std::make_shared<Parallel::Active>(
+        type, std::move(state), nullptr, nullptr, nullptr);
+    };
+
+  if (const auto result =
+    schemas::ErrorHandler::has_error(backup_schema_validator(), backup_state))
+  {
+    return failed("Parsing failed while restoring backup: " + result->message);
+  }
+
+  const auto& dependencies_json = backup_state["dependencies"];
+  const auto& descriptions = description.dependencies();
+  if (dependencies_json.size() != descriptions.size())
+  {
+    return failed(
+      "Failed to restore backup. It has ["
+      + std::to_string(dependencies_json.size()) + "] dependencies but the "
+      "bundle has [" + std::to_string(descriptions.size()) + "]");
+  }
+
+  const auto update = [type, parent_update, state]()
+    {
+      Parallel::update_status(type, *state);
+      parent_update();
+    };
+
+  auto active = std::make_shared<Parallel::Active>(
+    type, state, parent_update, checkpoint, std::move(finished));
+  active->_cached_states.resize(descriptions.size());
+
+  for (std::size_t i = 0; i < descriptions.size(); ++i)
+  {
+    const auto& desc = *descriptions[i];
+    const auto& dependency_json = dependencies_json[i];
+    const auto finished_it = dependency_json.find("finished");
+    if (finished_it != dependency_json.end())
+    {
+      // A dependency that already finished only needs a state to report
+      const auto header = desc.generate_header(get_state(), *parameters);
+      active->_states.push_back(
+        rmf_task::events::SimpleEventState::make(
+          id->assign(),
+          header.category(),
+          header.detail(),
+          static_cast<Event::Status>(finished_it->get<uint32_t>())));
+      active->_dependencies.push_back(nullptr);
+      continue;
+    }
+
+    auto dependency = initializer.restore(
+      id, get_state, parameters, desc, dependency_json["state"], update,
+      active->_make_checkpoint_callback(i),
+      active->_make_finished_callback());
+
+    active->_states.push_back(dependency->state());
+    active->_dependencies.push_back(std::move(dependency));
+  }
+
+  state->update_dependencies(active->_states);
+
+  // The bundle does not report that it finished while it is being restored.
+  // Whoever restores it can tell from its state.
+  BoolGuard lock(active->_inside_check);
+  Parallel::update_status(type, *state);
+  if (type == Bundle::Type::ParallelAny
+    && state->status() == Event::Status::Completed)
+  {
+    // The backup was taken while the other dependencies were being canceled
+    active->_losers_canceled = true;
+    for (const auto& dependency : active->_dependencies)
+    {
+      if (dependency && !dependency->state()->finished())
+        dependency->cancel();
+    }
+  }
+
+  return active;
+}
+
+//==============================================================================
+Event::ConstStatePtr Parallel::Active::state() const
+{
+  return _state;
+}
+
+//==============================================================================
+rmf_traffic::Duration Parallel::Active::remaining_time_estimate() const
+{
+  std::optional<rmf_traffic::Duration> estimate;
+  for (const auto& dependency : _dependencies)
+  {
+    if (!dependency || dependency->state()->finished())
+      continue;
+
+    estimate = combine(
+      _type, estimate, dependency->remaining_time_estimate());
+  }
+
+  return estimate.value_or(rmf_traffic::Duration(0));
+}
+
+//==============================================================================
+Event::Active::Backup Parallel::Active::backup() const
+{
+  auto dependencies_json = nlohmann::json::array();
+  for (std::size_t i = 0; i < _dependencies.size(); ++i)
+  {
+    nlohmann::json dependency_json;
+    const auto& dependency_state = _states[i];
+    if (dependency_state->finished() || !_dependencies[i])
+    {
+      dependency_json["finished"] =
+        static_cast<uint32_t>(dependency_state->status());
+    }
+    else
+    {
+      std::lock_guard<std::mutex> lock(_cache_mutex);
+      auto& cached = _cached_states[i];
+      if (!cached.has_value())
+        cached = _dependencies[i]->backup().release_state();
+
+      dependency_json["state"] = *cached;
+    }
+
+    dependencies_json.push_back(std::move(dependency_json));
+  }
+
+  nlohmann::json backup_json;
+  backup_json["schema_version"] = "0.1";
+  backup_json["dependencies"] = std::move(dependencies_json);
+
+  return Backup::make(_next_backup_sequence_number++, backup_json);
+}
+
+//==============================================================================
+Event::Active::Resume Parallel::Active::interrupt(
+  std::function<void()> task_is_interrupted)
+{
+  std::vector<Event::ActivePtr> running;
+  for (const auto& dependency : _dependencies)
+  {
+    if (dependency && !dependency->state()->finished())
+      running.push_back(dependency);
+  }
+
+  if (running.empty())
+  {
+    task_is_interrupted();
+    return Resume::make([]() {});
+  }
+
+  // The task is only interrupted once every dependency that is running says
+  // that it is
+  const auto remaining =
+    std::make_shared<std::atomic_size_t>(running.size());
+  const auto interrupted = [remaining, task_is_interrupted]()
+    {
+      if (--(*remaining) == 0)
+        task_is_interrupted();
+    };
+
+  auto resumes = std::make_shared<std::vector<Resume>>();
+  resumes->reserve(running.size());
+  for (const auto& dependency : running)
+    resumes->push_back(dependency->interrupt(interrupted));
+
+  return Resume::make(
+    [resumes]()
+    {
+      for (const auto& resume : *resumes)
+        resume();
+    });
+}
+
+//==============================================================================
+void Parallel::Active::cancel()
+{
+  _state->update_status(Event::Status::Canceled);
+  {
+    BoolGuard lock(_inside_check);
+    for (const auto& dependency : _dependencies)
+    {
+      if (dependency && !dependency->state()->finished())
+        dependency->cancel();
+    }
+  }
+
+  _check_dependencies();
+}
+
+//==============================================================================
+void Parallel::Active::kill()
+{
+  _state->update_status(Event::Status::Killed);
+  {
+    BoolGuard lock(_inside_check);
+    for (const auto& dependency : _dependencies)
+    {
+      if (dependency && !dependency->state()->finished())
+        dependency->kill();
+    }
+  }
+
+  _check_dependencies();
+}
+
+//==============================================================================
+Parallel::Active::Active(
+  Bundle::Type type,
+  rmf_task::events::SimpleEventStatePtr state,
+  std::function<void()> parent_update,
+  std::function<void()> checkpoint,
+  std::function<void()> finished)
+: _type(type),
+  _state(std::move(state)),
+  _parent_update(std::move(parent_update)),
+  _checkpoint(std::move(checkpoint)),
+  _bundle_finished(std::move(finished))
+{
+  // Do nothing
+}
+
+//==============================================================================
+void Parallel::Active::begin(std::vector<Event::StandbyPtr> dependencies)
+{
+  {
+    BoolGuard lock(_inside_check);
+    _dependencies.reserve(dependencies.size());
+    _states.reserve(dependencies.size());
+    _cached_states.resize(dependencies.size());
+    for (std::size_t i = 0; i < dependencies.size(); ++i)
+    {
+      const auto& dependency = dependencies[i];
+      _states.push_back(dependency->state());
+      _dependencies.push_back(
+        dependency->begin(
+          _make_checkpoint_callback(i), _make_finished_callback()));
+    }
+  }
+
+  _check_dependencies();
+}
+
+//==============================================================================
+std::function<void()> Parallel::Active::_make_finished_callback()
+{
+  return [me = weak_from_this()]()
+    {
+      if (const auto self = me.lock())
+        self->_check_dependencies();
+    };
+}
+
+//==============================================================================
+std::function<void()> Parallel::Active::_make_checkpoint_callback(
+  const std::size_t index)
+{
+  return [me = weak_from_this(), index]()
+    {
+      if (const auto self = me.lock())
+      {
+        {
+          std::lock_guard<std::mutex> lock(self->_cache_mutex);
+          self->_cached_states[index] = std::nullopt;
+        }
+
+        self->_checkpoint();
+      }
+    };
+}
+
+//==============================================================================
+void Parallel::Active::_check_dependencies()
+{
+  if (_finished)
+    return;
+
+  if (_inside_check)
+  {
+    _recheck = true;
+    return;
+  }
+
+  {
+    BoolGuard lock(_inside_check);
+    do
+    {
+      _recheck = false;
+      Parallel::update_status(_type, *_state);
+
+      bool any_completed = false;
+      for (const auto& state : _states)
+        any_completed |= state->status() == Event::Status::Completed;
+
+      if (_type == Bundle::Type::ParallelAny && any_completed
+        && !_losers_canceled)
+      {
+        // Once one dependency has completed, the rest have lost the race
+        _losers_canceled = true;
+        for (const auto& dependency : _dependencies)
+        {
+          if (dependency && !dependency->state()->finished())
+            dependency->cancel();
+        }
+      }
+    } while (_recheck);
+  }
+
+  bool all_finished = true;
+  for (const auto& state : _states)
+    all_finished &= state->finished();
+
+  if (all_finished)
+  {
+    _finished = true;
+    _parent_update();
+    _bundle_finished();
+    return;
+  }
+
+  _parent_update();
+  _checkpoint();
+}
+
+//==============================================================================
+const nlohmann::json_schema::json_validator&
+Parallel::Active::backup_schema_validator()
+{
+  // This is built on first use so that processes which never restore a
+  // backup do not pay to compile the schema when the library is loaded
+  static const nlohmann::json_schema::json_validator validator(
+    schemas::backup_EventParallel_v0_1);
+
+  return validator;
+}
+
+//==============================================================================
+Activity::ConstModelPtr Parallel::Model::make(
+  Bundle::Type type,
+  const std::vector<Event::ConstDescriptionPtr>& descriptions,
+  State invariant_initial_state,
+  const Parameters& parameters)
+{
+  std::vector<Activity::ConstModelPtr> models;
+  models.reserve(descriptions.size());
+  for (const auto& description : descriptions)
+  {
+    if (auto model =
+      description->make_model(invariant_initial_state, parameters))
+    {
+      models.push_back(std::move(model));
+    }
+  }
+
+  return std::make_shared<Parallel::Model>(
+    type, std::move(models), std::move(invariant_initial_state));
+}
+
+//==============================================================================
+std::optional<Estimate> Parallel::Model::estimate_finish(
+  State initial_state,
+  rmf_traffic::Time earliest_arrival_time,
+  const Constraints& constraints,
+  const TravelEstimator& travel_estimator) const
+{
+  if (_models.empty())
+    return Estimate(std::move(initial_state), earliest_arrival_time);
+
+  const auto initial_soc = initial_state.battery_soc();
+  std::optional<Estimate> decisive;
+  double drain = 0.0;
+  for (const auto& model : _models)
+  {
+    auto estimate = model->estimate_finish(
+      initial_state, earliest_arrival_time, constraints, travel_estimator);
+
+    if (!estimate.has_value())
+    {
+      // Every dependency of ParallelAll needs to be able to finish, while
+      // ParallelAny only needs one of them
+      if (_type == Bundle::Type::ParallelAll)
+        return std::nullopt;
+
+      continue;
+    }
+
+    const auto& finish = estimate->finish_state();
+    if (initial_soc.has_value() && finish.battery_soc().has_value())
+      drain += *initial_soc - *finish.battery_soc();
+
+    const auto finish_time = finish.time().value_or(earliest_arrival_time);
+    const bool replace = !decisive.has_value()
+      || (_type == Bundle::Type::ParallelAll ?
+      finish_time > decisive->finish_state().time().value_or(finish_time) :
+      finish_time < decisive->finish_state().time().value_or(finish_time));
+
+    if (replace)
+      decisive = std::move(estimate);
+  }
+
+  if (!decisive.has_value())
+    return std::nullopt;
+
+  if (_type == Bundle::Type::ParallelAll && initial_soc.has_value()
+    && constraints.drain_battery())
+  {
+    // All of the dependencies run to completion, so all of their drains count
+    const double soc = *initial_soc - drain;
+    if (soc <= constraints.threshold_soc())
+      return std::nullopt;
+
+    auto finish = decisive->release_finish_state();
+    finish.battery_soc(soc);
+    decisive->finish_state(std::move(finish));
+  }
+
+  return decisive;
+}
+
+//==============================================================================
+rmf_traffic::Duration Parallel::Model::invariant_duration() const
+{
+  if (!_decisive)
+    return rmf_traffic::Duration(0);
+
+  return _decisive->invariant_duration();
+}
+
+//==============================================================================
+State Parallel::Model::invariant_finish_state() const
+{
+  if (!_decisive)
+    return _invariant_initial_state;
+
+  return _decisive->invariant_finish_state();
+}
+
+//==============================================================================
+Parallel::Model::Model(
+  Bundle::Type type,
+  std::vector<Activity::ConstModelPtr> models,
+  State invariant_initial_state)
+: _type(type),
+  _models(std::move(models)),
+  _invariant_initial_state(std::move(invariant_initial_state))
+{
+  for (const auto& model : _models)
+  {
+    if (!_decisive)
+    {
+      _decisive = model;
+      continue;
+    }
+
+    const auto duration = model->invariant_duration();
+    const auto decisive_duration = _decisive->invariant_duration();
+    if (_type == Bundle::Type::ParallelAll ?
+      duration > decisive_duration : duration < decisive_duration)
+    {
+      _decisive = model;
+    }
+  }
+}
+
+} // namespace internal
+} // namespace events
+} // namespace rmf_task_sequence
@@ -17,9 +17,162 @@
 
 #include "internal_PayloadTransfer.hpp"
 
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
 namespace rmf_task_sequence {
 namespace events {
 
+namespace {
+//==============================================================================
+// Everything that the model of a transfer depends on, apart from the fields of
+// the initial state that the model passes through unchanged
+struct TransferKey
+{
+  // The estimator identifies the parameters, as in TravelEstimator::shared
+  const TravelEstimator* estimator;
+  std::vector<std::pair<std::size_t, std::optional<double>>> goals;
+  bool prefer_same_map;
+  rmf_traffic::Duration loading_duration;
+  std::optional<std::size_t> start_waypoint;
+  std::optional<double> start_orientation;
+
+  bool operator<(const TransferKey& other) const
+  {
+    return std::tie(
+      estimator, goals, prefer_same_map, loading_duration,
+      start_waypoint, start_orientation)
+      < std::tie(
+      other.estimator, other.goals, other.prefer_same_map,
+      other.loading_duration, other.start_waypoint, other.start_orientation);
+  }
+};
+
+//==============================================================================
+// Keeps the models of the most recently used transfers. A transfer that has no
+// model because it cannot reach its place is kept as well.
+class TransferModelCache
+{
+public:
+
+  static constexpr std::size_t Capacity = 1000;
+
+  static TransferModelCache& get()
+  {
+    static TransferModelCache cache;
+    return cache;
+  }
+
+  std::optional<Activity::ConstModelPtr> find(const TransferKey& key)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _models.find(key);
+    if (it == _models.end())
+    {
+      ++misses;
+      return std::nullopt;
+    }
+
+    ++hits;
+    _recent.splice(_recent.begin(), _recent, it->second.recent);
+    return it->second.model;
+  }
+
+  void insert(
+    TransferKey key,
+    std::shared_ptr<const TravelEstimator> estimator,
+    Activity::ConstModelPtr model)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto inserted = _models.insert({std::move(key), Entry()});
+    auto& entry = inserted.first->second;
+    if (inserted.second)
+    {
+      _recent.push_front(inserted.first);
+      entry.recent = _recent.begin();
+    }
+    else
+    {
+      _recent.splice(_recent.begin(), _recent, entry.recent);
+    }
+
+    entry.estimator = std::move(estimator);
+    entry.model = std::move(model);
+
+    while (_models.size() > Capacity)
+    {
+      _models.erase(_recent.back());
+      _recent.pop_back();
+    }
+  }
+
+  std::atomic_size_t hits = 0;
+  std::atomic_size_t misses = 0;
+
+private:
+
+  struct Entry;
+  using Map = std::map<TransferKey, Entry>;
+
+  struct Entry
+  {
+    // Holding the estimator keeps its address from being reused as a key
+    std::shared_ptr<const TravelEstimator> estimator;
+    Activity::ConstModelPtr model;
+    std::list<Map::iterator>::iterator recent;
+  };
+
+  std::mutex _mutex;
+  std::list<Map::iterator> _recent;
+  Map _models;
+};
+
+//==============================================================================
+// A shared transfer model seen from the initial state of one transfer
+class SharedTransferModel : public Activity::Model
+{
+public:
+
+  SharedTransferModel(
+    Activity::ConstModelPtr model,
+    State invariant_finish_state)
+  : _model(std::move(model)),
+    _invariant_finish_state(std::move(invariant_finish_state))
+  {
+    // Do nothing
+  }
+
+  std::optional<Estimate> estimate_finish(
+    State initial_state,
+    rmf_traffic::Time earliest_arrival_time,
+    const Constraints& constraints,
+    const TravelEstimator& travel_estimator) const final
+  {
+    return _model->estimate_finish(
+      std::move(initial_state), earliest_arrival_time, constraints,
+      travel_estimator);
+  }
+
+  rmf_traffic::Duration invariant_duration() const final
+  {
+    return _model->invariant_duration();
+  }
+
+  State invariant_finish_state() const final
+  {
+    return _invariant_finish_state;
+  }
+
+private:
+  Activity::ConstModelPtr _model;
+  State _invariant_finish_state;
+};
+
+} // anonymous namespace
+
 //==============================================================================
 PayloadTransfer::PayloadTransfer(
   Location location_,
@@ -39,10 +192,72 @@ Activity::ConstModelPtr PayloadTransfer::make_model(
   State invariant_initial_state,
   const Parameters& parameters) const
 {
-  return Activity::SequenceModel::make(
-    descriptions,
-    std::move(invariant_initial_state),
-    parameters);
+  auto estimator = TravelEstimator::shared(parameters);
+  TransferKey key{
+    estimator.get(),
+    {},
+    go_to_place->prefer_same_map(),
+    wait_for->duration(),
+    invariant_initial_state.waypoint(),
+    invariant_initial_state.orientation()
+  };
+
+  for (const auto& goal : go_to_place->one_of())
+  {
+    std::optional<double> orientation;
+    if (goal.orientation())
+      orientation = *goal.orientation();
+
+    key.goals.push_back({goal.waypoint(), orientation});
+  }
+
+  auto& cache = TransferModelCache::get();
+  auto model = cache.find(key);
+  if (!model.has_value())
+  {
+    model = Activity::SequenceModel::make(
+      descriptions, invariant_initial_state, parameters);
+    cache.insert(std::move(key), std::move(estimator), *model);
+  }
+
+  if (!*model)
+    return nullptr;
+
+  // The transfer only changes where the robot is, so the rest of the finish
+  // state comes from this initial state
+  const auto shared_finish = (*model)->invariant_finish_state();
+  auto finish = std::move(invariant_initial_state);
+  if (const auto waypoint = shared_finish.waypoint())
+    finish.waypoint(*waypoint);
+
+  if (const auto orientation = shared_finish.orientation())
+    finish.orientation(*orientation);
+  else
+    finish.erase<State::CurrentOrientation>();
+
+  return std::make_shared<SharedTransferModel>(
+    std::move(*model), std::move(finish));
+}
+
+//==============================================================================
+std::size_t PayloadTransfer::model_cache_hits()
+{
+  return TransferModelCache::get().hits;
+}
+
+//==============================================================================
+std::size_t PayloadTransfer::model_cache_misses()
+{
+  return TransferModelCache::get().misses;
+}
+
+//==============================================================================
+std::optional<State> PayloadTransfer::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters& parameters) const
+{
+  return Activity::SequenceModel::predict_invariant_finish_state(
+    descriptions, invariant_initial_state, parameters);
 }
 
 //==============================================================================
@@ -17,13 +17,14 @@
 
 #include <rmf_task_sequence/events/PerformAction.hpp>
 
+#include "internal_FixedStepModel.hpp"
 #include "utils.hpp"
 
 namespace rmf_task_sequence {
 namespace events {
 
 //==============================================================================
-class PerformAction::Model : public Activity::Model
+class PerformAction::Model : public FixedStepModel
 {
 public:
 
@@ -43,11 +44,11 @@ public:
 
   State invariant_finish_state() const final;
 
+  const FixedStep& fixed_step() const final;
+
 private:
   rmf_task::State _invariant_finish_state;
-  double _invariant_battery_drain;
-  rmf_traffic::Duration _invariant_duration;
-  bool _use_tool_sink;
+  FixedStep _step;
 };
 
 //==============================================================================
@@ -56,22 +57,24 @@ PerformAction::Model::Model(
   rmf_traffic::Duration invariant_duration,
   bool use_tool_sink,
   const Parameters& parameters)
-: _invariant_finish_state(invariant_finish_state),
-  _invariant_duration(invariant_duration),
-  _use_tool_sink(use_tool_sink)
+: _invariant_finish_state(std::move(invariant_finish_state))
 {
+  _step.duration = invariant_duration;
+  _step.waypoint = _invariant_finish_state.waypoint();
+  _step.orientation = _invariant_finish_state.orientation();
+
   if (parameters.ambient_sink() != nullptr)
   {
-    _invariant_battery_drain =
+    _step.battery_drain =
       parameters.ambient_sink()->compute_change_in_charge(
-      rmf_traffic::time::to_seconds(_invariant_duration));
+      rmf_traffic::time::to_seconds(invariant_duration));
   }
 
-  if (_use_tool_sink && parameters.tool_sink() != nullptr)
+  if (use_tool_sink && parameters.tool_sink() != nullptr)
   {
-    _invariant_battery_drain +=
+    _step.battery_drain +=
       parameters.tool_sink()->compute_change_in_charge(
-      rmf_traffic::time::to_seconds(_invariant_duration));
+      rmf_traffic::time::to_seconds(invariant_duration));
   }
 }
 
@@ -80,29 +83,18 @@ std::optional<rmf_task::Estimate> PerformAction::Model::estimate_finish(
   rmf_task::State initial_state,
   rmf_traffic::Time earliest_arrival_time,
   const Constraints& constraints,
-  const TravelEstimator& travel_estimator) const
+  const TravelEstimator&) const
 {
-  initial_state.time(initial_state.time().value() + _invariant_duration);
-  if (_invariant_finish_state.waypoint().has_value())
-    initial_state.waypoint(_invariant_finish_state.waypoint().value());
-  if (_invariant_finish_state.orientation().has_value())
-    initial_state.orientation(_invariant_finish_state.orientation().value());
-
-  if (constraints.drain_battery())
-    initial_state.battery_soc(std::max(0.0,
-      initial_state.battery_soc().value() - _invariant_battery_drain));
-
-
-  if (initial_state.battery_soc().value() <= constraints.threshold_soc())
-    return std::nullopt;
-
-  return Estimate(initial_state, earliest_arrival_time);
+  // A drained battery is clamped to zero, which is never above the threshold,
+  // so the step rejects it the same way.
+  return _step.apply(
+    std::move(initial_state), earliest_arrival_time, constraints);
 }
 
 //==============================================================================
 rmf_traffic::Duration PerformAction::Model::invariant_duration() const
 {
-  return _invariant_duration;
+  return _step.duration;
 }
 
 //==============================================================================
@@ -111,6 +103,12 @@ State PerformAction::Model::invariant_finish_state() const
   return _invariant_finish_state;
 }
 
+//==============================================================================
+const FixedStep& PerformAction::Model::fixed_step() const
+{
+  return _step;
+}
+
 //==============================================================================
 class PerformAction::Description::Implementation
 {
@@ -228,6 +226,18 @@ auto PerformAction::Description::expected_finish_location(
 Activity::ConstModelPtr PerformAction::Description::make_model(
   State invariant_initial_state,
   const Parameters& parameters) const
+{
+  return std::make_shared<Model>(
+    *predict_invariant_finish_state(invariant_initial_state, parameters),
+    _pimpl->action_duration_estimate,
+    _pimpl->use_tool_sink,
+    parameters);
+}
+
+//==============================================================================
+std::optional<State> PerformAction::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters&) const
 {
   auto invariant_finish_state = invariant_initial_state;
   if (_pimpl->expected_finish_location.has_value())
@@ -240,11 +250,7 @@ Activity::ConstModelPtr PerformAction::Description::make_model(
     }
   }
 
-  return std::make_shared<Model>(
-    invariant_finish_state,
-    _pimpl->action_duration_estimate,
-    _pimpl->use_tool_sink,
-    parameters);
+  return invariant_finish_state;
 }
 
 //==============================================================================
@@ -112,6 +112,15 @@ Activity::ConstModelPtr PickUp::Description::make_model(
     std::move(invariant_initial_state), parameters);
 }
 
+//==============================================================================
+std::optional<State> PickUp::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters& parameters) const
+{
+  return _pimpl->transfer.predict_invariant_finish_state(
+    invariant_initial_state, parameters);
+}
+
 //==============================================================================
 Header PickUp::Description::generate_header(
   const State& initial_state,
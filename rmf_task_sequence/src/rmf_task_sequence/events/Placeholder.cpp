@@ -84,6 +84,15 @@ Activity::ConstModelPtr Placeholder::Description::make_model(
   return std::make_shared<Model>(std::move(invariant_initial_state));
 }
 
+//==============================================================================
+std::optional<rmf_task::State>
+Placeholder::Description::predict_invariant_finish_state(
+  const rmf_task::State& invariant_initial_state,
+  const rmf_task::Parameters&) const
+{
+  return invariant_initial_state;
+}
+
 //==============================================================================
 Header Placeholder::Description::generate_header(
   const State&, const Parameters&) const
@@ -17,10 +17,228 @@
 
 #include "internal_Sequence.hpp"
 
+#include <rmf_task_sequence/schemas/backup_EventSequence_v0_1.hpp>
+
+#include <algorithm>
+#include <iterator>
+
 namespace rmf_task_sequence {
 namespace events {
 namespace internal {
 
+namespace {
+//==============================================================================
+// Stands in for an element of a sequence that has not been initialized yet
+class Placeholder : public rmf_task::Event::State
+{
+public:
+
+  Placeholder(
+    uint64_t id,
+    const rmf_task::Header& header,
+    std::shared_ptr<const rmf_task::Log> log)
+  : _id(id),
+    _name(header.category()),
+    _detail(header.detail()),
+    _log(std::move(log))
+  {
+    // Do nothing
+  }
+
+  uint64_t id() const final
+  {
+    return _id;
+  }
+
+  Status status() const final
+  {
+    return Status::Standby;
+  }
+
+  rmf_task::VersionedString::View name() const final
+  {
+    return _name.view();
+  }
+
+  rmf_task::VersionedString::View detail() const final
+  {
+    return _detail.view();
+  }
+
+  rmf_task::Log::View log() const final
+  {
+    return _log->view();
+  }
+
+  std::vector<ConstStatePtr> dependencies() const final
+  {
+    return {};
+  }
+
+  std::optional<uint64_t> version() const final
+  {
+    // Nothing about a placeholder ever changes
+    return 0;
+  }
+
+private:
+  uint64_t _id;
+  rmf_task::VersionedString _name;
+  rmf_task::VersionedString _detail;
+  // Shared by all the placeholders of a sequence since they never log anything
+  std::shared_ptr<const rmf_task::Log> _log;
+};
+} // anonymous namespace
+
+//==============================================================================
+Sequence::Remaining::Remaining(std::vector<Event::StandbyPtr> elements)
+: _ready(
+    std::make_move_iterator(elements.begin()),
+    std::make_move_iterator(elements.end()))
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Sequence::Remaining::lazily(
+  Event::ConstInitializerPtr initializer,
+  const Event::AssignIDPtr& id,
+  const std::function<rmf_task::State()>& get_state,
+  const ConstParametersPtr& parameters,
+  std::vector<Event::ConstDescriptionPtr> descriptions,
+  std::function<void()> update) -> Remaining
+{
+  Remaining remaining;
+  const auto num_ready = std::min(lookahead, descriptions.size());
+  for (std::size_t i = 0; i < num_ready; ++i)
+  {
+    remaining._ready.push_back(
+      initializer->initialize(
+        id, get_state, parameters, *descriptions[i], update));
+  }
+
+  if (num_ready == descriptions.size())
+    return remaining;
+
+  // The placeholders are described by the headers that their events would
+  // have, starting from the finish state that the earlier events are expected
+  // to leave behind.
+  auto state = get_state();
+  const auto log = std::make_shared<const rmf_task::Log>();
+  for (std::size_t i = 0; i < descriptions.size(); ++i)
+  {
+    const auto& description = descriptions[i];
+    if (i >= num_ready)
+    {
+      const auto header = description->generate_header(state, *parameters);
+      remaining._deferred.push_back(
+        Deferred{
+          description,
+          std::make_shared<Placeholder>(id->assign(), header, log),
+          header.original_duration_estimate()
+        });
+    }
+
+    if (i + 1 == descriptions.size())
+      break;
+
+    if (auto finish = description->predict_invariant_finish_state(
+        state, *parameters))
+    {
+      state = std::move(*finish);
+    }
+    else if (const auto model = description->make_model(state, *parameters))
+    {
+      state = model->invariant_finish_state();
+    }
+  }
+
+  remaining._initialize = std::make_shared<Initialize>(
+    Initialize{
+      std::move(initializer),
+      id,
+      get_state,
+      parameters,
+      std::move(update)
+    });
+
+  return remaining;
+}
+
+//==============================================================================
+bool Sequence::Remaining::empty() const
+{
+  return _ready.empty() && _deferred.empty();
+}
+
+//==============================================================================
+Event::StandbyPtr Sequence::Remaining::pop(
+  rmf_task::events::SimpleEventState& sequence_state)
+{
+  auto next = std::move(_ready.front());
+  _ready.pop_front();
+
+  if (_ready.size() >= lookahead || _deferred.empty())
+    return next;
+
+  auto deferred = std::move(_deferred.front());
+  _deferred.pop_front();
+
+  const auto& init = *_initialize;
+  auto element = init.initializer->initialize(
+    init.id, init.get_state, init.parameters, *deferred.description,
+    init.update);
+
+  auto dependencies = sequence_state.dependencies();
+  for (auto& dependency : dependencies)
+  {
+    if (dependency == deferred.placeholder)
+    {
+      dependency = element->state();
+      break;
+    }
+  }
+  sequence_state.update_dependencies(std::move(dependencies));
+
+  _ready.push_back(std::move(element));
+  return next;
+}
+
+//==============================================================================
+std::vector<Event::ConstStatePtr> Sequence::Remaining::states() const
+{
+  std::vector<Event::ConstStatePtr> output;
+  output.reserve(_ready.size() + _deferred.size());
+  for (const auto& element : _ready)
+    output.push_back(element->state());
+
+  for (const auto& deferred : _deferred)
+    output.push_back(deferred.placeholder);
+
+  return output;
+}
+
+//==============================================================================
+rmf_traffic::Duration Sequence::Remaining::duration_estimate() const
+{
+  auto estimate = rmf_traffic::Duration(0);
+  for (const auto& element : _ready)
+    estimate += element->duration_estimate();
+
+  for (const auto& deferred : _deferred)
+    estimate += deferred.estimate;
+
+  return estimate;
+}
+
+//==============================================================================
+void Sequence::Remaining::clear()
+{
+  _ready.clear();
+  _deferred.clear();
+  _initialize = nullptr;
+}
+
 //==============================================================================
 Event::StandbyPtr Sequence::Standby::initiate(
   const Event::Initializer& initializer,
@@ -28,7 +246,8 @@ Event::StandbyPtr Sequence::Standby::initiate(
   const std::function<rmf_task::State()>& get_state,
   const ConstParametersPtr& parameters,
   const Bundle::Description& description,
-  std::function<void()> parent_update)
+  std::function<void()> parent_update,
+  Event::ConstInitializerPtr owner)
 {
   auto state = make_state(id, description);
   const auto update = [parent_update, state]()
@@ -37,6 +256,17 @@ Event::StandbyPtr Sequence::Standby::initiate(
       parent_update();
     };
 
+  // The elements can only be initialized later if the initializer is sure to
+  // still exist by then
+  if (owner && description.dependencies().size() > Remaining::lookahead)
+  {
+    return std::make_shared<Sequence::Standby>(
+      Remaining::lazily(
+        std::move(owner), id, get_state, parameters,
+        description.dependencies(), update),
+      std::move(state), std::move(parent_update));
+  }
+
   std::vector<Event::StandbyPtr> dependencies;
   dependencies.reserve(description.dependencies().size());
   for (const auto& desc : description.dependencies())
@@ -47,10 +277,6 @@ Event::StandbyPtr Sequence::Standby::initiate(
     dependencies.emplace_back(std::move(element));
   }
 
-  // We reverse the dependencies so we can always pop them off the back of the
-  // queue.
-  std::reverse(dependencies.begin(), dependencies.end());
-
   return std::make_shared<Sequence::Standby>(
     std::move(dependencies), std::move(state), std::move(parent_update));
 }
@@ -72,10 +298,6 @@ Event::StandbyPtr Sequence::Standby::initiate(
   for (const auto& fn : dependencies_fn)
     dependencies.push_back(fn(update));
 
-  // We reverse the dependencies so we can always pop them off the back of the
-  // queue.
-  std::reverse(dependencies.begin(), dependencies.end());
-
   return std::make_shared<Sequence::Standby>(
     std::move(dependencies), std::move(state), std::move(parent_update));
 }
@@ -89,30 +311,19 @@ Event::ConstStatePtr Sequence::Standby::state() const
 //==============================================================================
 rmf_traffic::Duration Sequence::Standby::duration_estimate() const
 {
-  auto estimate = rmf_traffic::Duration(0);
-  for (const auto& element : _reverse_dependencies)
-    estimate += element->duration_estimate();
-
-  return estimate;
+  return _remaining.duration_estimate();
 }
 
 //==============================================================================
 Sequence::Standby::Standby(
-  std::vector<Event::StandbyPtr> reverse_dependencies,
+  Remaining remaining,
   rmf_task::events::SimpleEventStatePtr state,
   std::function<void()> parent_update)
-: _reverse_dependencies(std::move(reverse_dependencies)),
+: _remaining(std::move(remaining)),
   _state(std::move(state)),
   _parent_update(std::move(parent_update))
 {
-  std::vector<rmf_task::Event::ConstStatePtr> state_deps;
-  state_deps.reserve(_reverse_dependencies.size());
-  const auto rbegin = _reverse_dependencies.rbegin();
-  const auto rend = _reverse_dependencies.rend();
-  for (auto rit = rbegin; rit != rend; ++rit)
-    state_deps.push_back((*rit)->state());
-
-  _state->update_dependencies(std::move(state_deps));
+  _state->update_dependencies(_remaining.states());
   update_status(*_state);
 }
 
@@ -125,7 +336,7 @@ Event::ActivePtr Sequence::Standby::begin(
     return _active;
 
   _active = std::make_shared<Sequence::Active>(
-    std::move(_reverse_dependencies), _state, _parent_update,
+    std::move(_remaining), _state, _parent_update,
     std::move(checkpoint), std::move(finish));
 
   _active->next();
@@ -166,11 +377,28 @@ Event::ActivePtr Sequence::Active::restore(
   const std::function<rmf_task::State()>& get_state,
   const ConstParametersPtr& parameters,
   const Bundle::Description& description,
-  const std::string& backup,
+  const nlohmann::json& backup_state,
   std::function<void()> parent_update,
   std::function<void()> checkpoint,
-  std::function<void()> finished)
+  std::function<void()> finished,
+  Event::ConstInitializerPtr owner)
 {
+  // Older backups carried the state of each nested sequence as text
+  if (backup_state.is_string())
+  {
+    return restore(
+      initializer,
+      id,
+      get_state,
+      parameters,
+      description,
+      nlohmann::json::parse(backup_state.get<std::string>()),
+      std::move(parent_update),
+      std::move(checkpoint),
+      std::move(finished),
+      std::move(owner));
+  }
+
   auto state = Sequence::Standby::make_state(id, description);
   const auto update = [parent_update = std::move(parent_update), state]()
     {
@@ -178,18 +406,15 @@ Event::ActivePtr Sequence::Active::restore(
       parent_update();
     };
 
-  std::vector<Event::StandbyPtr> dependencies;
-
-  const auto backup_state = nlohmann::json::parse(backup);
   if (const auto result =
-    schemas::ErrorHandler::has_error(backup_schema_validator, backup_state))
+    schemas::ErrorHandler::has_error(backup_schema_validator(), backup_state))
   {
     state->update_log().error(
       "Parsing failed while restoring backup: " + result->message
-      + "\nOriginal backup state:\n```" + backup + "\n```");
+      + "\nOriginal backup state:\n```" + backup_state.dump() + "\n```");
     state->update_status(Event::Status::Error);
     return std::make_shared<Sequence::Active>(
-      dependencies, std::move(state), nullptr, nullptr, nullptr);
+      Remaining(), std::move(state), nullptr, nullptr, nullptr);
   }
 
   const auto& current_event_json = backup_state["current_event"];
@@ -203,10 +428,11 @@ Event::ActivePtr Sequence::Active::restore(
       "Failed to restore backup. Index ["
       + std::to_string(current_event_index) + "] is too high for ["
       + std::to_string(description.dependencies().size())
-      + "] event dependencies. Original text:\n```\n" + backup + "\n```");
+      + "] event dependencies. Original text:\n```\n" + backup_state.dump()
+      + "\n```");
     state->update_status(Event::Status::Error);
     return std::make_shared<Sequence::Active>(
-      dependencies, std::move(state), nullptr, nullptr, nullptr);
+      Remaining(), std::move(state), nullptr, nullptr, nullptr);
   }
 
   auto active = std::make_shared<Sequence::Active>(
@@ -234,33 +460,43 @@ Event::ActivePtr Sequence::Active::restore(
     event_finished);
   state->add_dependency(active->state());
 
-  const std::size_t num_elements = element_descriptions.size();
-  for (std::size_t i = current_event_index + 1; i < num_elements; ++i)
-  {
-    const auto& desc = element_descriptions[i];
-    auto element = initializer.initialize(
-      id, get_state, parameters, *desc, update);
+  const std::vector<Event::ConstDescriptionPtr> remaining_descriptions(
+    element_descriptions.begin() + current_event_index + 1,
+    element_descriptions.end());
 
-    active->_state->add_dependency(element->state());
-    dependencies.emplace_back(std::move(element));
+  if (owner && remaining_descriptions.size() > Remaining::lookahead)
+  {
+    active->_remaining = Remaining::lazily(
+      std::move(owner), id, get_state, parameters,
+      remaining_descriptions, update);
   }
+  else
+  {
+    std::vector<Event::StandbyPtr> dependencies;
+    dependencies.reserve(remaining_descriptions.size());
+    for (const auto& desc : remaining_descriptions)
+    {
+      dependencies.push_back(
+        initializer.initialize(id, get_state, parameters, *desc, update));
+    }
 
-  std::reverse(dependencies.begin(), dependencies.end());
+    active->_remaining = Remaining(std::move(dependencies));
+  }
 
-  active->_reverse_remaining = std::move(dependencies);
+  for (const auto& element_state : active->_remaining.states())
+    active->_state->add_dependency(element_state);
 
   BoolGuard lock(active->_inside_next);
   while (active->_current->state()->finished())
   {
-    if (active->_reverse_remaining.empty())
+    if (active->_remaining.empty())
     {
       Sequence::Standby::update_status(*active->_state);
       return active;
     }
 
     ++active->_current_event_index_plus_one;
-    const auto next_event = active->_reverse_remaining.back();
-    active->_reverse_remaining.pop_back();
+    const auto next_event = active->_remaining.pop(*active->_state);
     active->_current = next_event->begin(active->_checkpoint, event_finished);
   }
 
@@ -281,10 +517,7 @@ rmf_traffic::Duration Sequence::Active::remaining_time_estimate() const
   if (_current)
     estimate += _current->remaining_time_estimate();
 
-  for (const auto& element : _reverse_remaining)
-    estimate += element->duration_estimate();
-
-  return estimate;
+  return estimate + _remaining.duration_estimate();
 }
 
 //==============================================================================
@@ -292,7 +525,7 @@ Event::Active::Backup Sequence::Active::backup() const
 {
   nlohmann::json current_event_json;
   current_event_json["index"] = _current_event_index_plus_one - 1;
-  current_event_json["state"] = _current->backup().state();
+  current_event_json["state"] = _current->backup().release_state();
 
   nlohmann::json backup_json;
   backup_json["schema_version"] = "0.1";
@@ -311,7 +544,7 @@ Event::Active::Resume Sequence::Active::interrupt(
 //==============================================================================
 void Sequence::Active::cancel()
 {
-  _reverse_remaining.clear();
+  _remaining.clear();
   _state->update_status(Event::Status::Canceled);
   _current->cancel();
 }
@@ -319,20 +552,20 @@ void Sequence::Active::cancel()
 //==============================================================================
 void Sequence::Active::kill()
 {
-  _reverse_remaining.clear();
+  _remaining.clear();
   _state->update_status(Event::Status::Killed);
   _current->kill();
 }
 
 //==============================================================================
 Sequence::Active::Active(
-  std::vector<Event::StandbyPtr> dependencies,
+  Remaining remaining,
   rmf_task::events::SimpleEventStatePtr state,
   std::function<void()> parent_update,
   std::function<void()> checkpoint,
   std::function<void()> finished)
 : _current(nullptr),
-  _reverse_remaining(dependencies),
+  _remaining(std::move(remaining)),
   _state(std::move(state)),
   _parent_update(std::move(parent_update)),
   _checkpoint(std::move(checkpoint)),
@@ -368,7 +601,7 @@ void Sequence::Active::next()
 
   do
   {
-    if (_reverse_remaining.empty())
+    if (_remaining.empty())
     {
       Sequence::Standby::update_status(*_state);
       _sequence_finished();
@@ -376,8 +609,7 @@ void Sequence::Active::next()
     }
 
     ++_current_event_index_plus_one;
-    const auto next_event = _reverse_remaining.back();
-    _reverse_remaining.pop_back();
+    const auto next_event = _remaining.pop(*_state);
 
     const auto event_finished = [
       me = weak_from_this(),
@@ -400,10 +632,16 @@ void Sequence::Active::next()
 }
 
 //==============================================================================
-const nlohmann::json_schema::json_validator
-Sequence::Active::backup_schema_validator =
-  nlohmann::json_schema::json_validator(
-  schemas::backup_EventSequence_v0_1);
+const nlohmann::json_schema::json_validator&
+Sequence::Active::backup_schema_validator()
+{
+  // This is built on first use so that processes which never restore a
+  // backup do not pay to compile the schema when the library is loaded
+  static const nlohmann::json_schema::json_validator validator(
+    schemas::backup_EventSequence_v0_1);
+
+  return validator;
+}
 
 } // namespace internal
 } // namespace events
@@ -17,11 +17,13 @@
 
 #include <rmf_task_sequence/events/WaitFor.hpp>
 
+#include "internal_FixedStepModel.hpp"
+
 namespace rmf_task_sequence {
 namespace events {
 
 //==============================================================================
-class WaitFor::Model : public Activity::Model
+class WaitFor::Model : public FixedStepModel
 {
 public:
 
@@ -40,10 +42,11 @@ public:
 
   State invariant_finish_state() const final;
 
+  const FixedStep& fixed_step() const final;
+
 private:
   rmf_task::State _invariant_finish_state;
-  double _invariant_battery_drain;
-  rmf_traffic::Duration _duration;
+  FixedStep _step;
 };
 
 //==============================================================================
@@ -92,6 +95,14 @@ Activity::ConstModelPtr WaitFor::Description::make_model(
     invariant_initial_state, _pimpl->duration, parameters);
 }
 
+//==============================================================================
+std::optional<State> WaitFor::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters&) const
+{
+  return invariant_initial_state;
+}
+
 //==============================================================================
 Header WaitFor::Description::generate_header(
   const State&, const Parameters&) const
@@ -110,22 +121,18 @@ WaitFor::Model::Model(
   State invariant_initial_state,
   rmf_traffic::Duration duration,
   const Parameters& parameters)
-: _invariant_finish_state(std::move(invariant_initial_state)),
-  _duration(duration)
+: _invariant_finish_state(std::move(invariant_initial_state))
 {
+  _step.duration = duration;
   if (parameters.ambient_sink())
   {
     // Handle cases where duration is invalid.
-    const auto duration =
-      _duration.count() < 0 ? rmf_traffic::Duration(0) : _duration;
+    const auto drain_duration =
+      duration.count() < 0 ? rmf_traffic::Duration(0) : duration;
 
-    _invariant_battery_drain =
+    _step.battery_drain =
       parameters.ambient_sink()->compute_change_in_charge(
-      rmf_traffic::time::to_seconds(duration));
-  }
-  else
-  {
-    _invariant_battery_drain = 0.0;
+      rmf_traffic::time::to_seconds(drain_duration));
   }
 }
 
@@ -136,29 +143,13 @@ std::optional<Estimate> WaitFor::Model::estimate_finish(
   const Constraints& constraints,
   const TravelEstimator&) const
 {
-  state.time(state.time().value() + _duration);
-
-  if (constraints.drain_battery())
-  {
-    const auto new_battery_soc =
-      state.battery_soc().value() - _invariant_battery_drain;
-    if (new_battery_soc < 0.0)
-    {
-      return std::nullopt;
-    }
-    state.battery_soc(new_battery_soc);
-  }
-
-  if (state.battery_soc().value() <= constraints.threshold_soc())
-    return std::nullopt;
-
-  return Estimate(state, earliest_arrival_time);
+  return _step.apply(std::move(state), earliest_arrival_time, constraints);
 }
 
 //==============================================================================
 rmf_traffic::Duration WaitFor::Model::invariant_duration() const
 {
-  return _duration;
+  return _step.duration;
 }
 
 //==============================================================================
@@ -167,5 +158,11 @@ State WaitFor::Model::invariant_finish_state() const
   return _invariant_finish_state;
 }
 
+//==============================================================================
+const FixedStep& WaitFor::Model::fixed_step() const
+{
+  return _step;
+}
+
 } // namespace phases
 } // namespace rmf_task_sequence
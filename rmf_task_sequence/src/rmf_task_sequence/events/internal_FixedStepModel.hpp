@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_FIXEDSTEPMODEL_HPP
+#define SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_FIXEDSTEPMODEL_HPP
+
+#include <rmf_task_sequence/Activity.hpp>
+
+#include <optional>
+
+namespace rmf_task_sequence {
+namespace events {
+
+//==============================================================================
+/// The change that an activity makes to the state of the robot when that
+/// change does not depend on the state that the activity begins in.
+struct FixedStep
+{
+  /// How far the time of the state moves forward
+  rmf_traffic::Duration duration = rmf_traffic::Duration(0);
+
+  /// How much battery gets drained when the constraints drain the battery
+  double battery_drain = 0.0;
+
+  /// Where the robot ends up, if the step moves it
+  std::optional<std::size_t> waypoint;
+  std::optional<double> orientation;
+
+  /// Add the change of the next step after this one
+  FixedStep& then(const FixedStep& next)
+  {
+    duration += next.duration;
+    battery_drain += next.battery_drain;
+    if (next.waypoint.has_value())
+      waypoint = next.waypoint;
+    if (next.orientation.has_value())
+      orientation = next.orientation;
+
+    return *this;
+  }
+
+  /// Apply the step to a state. The estimate has no value if the battery ends
+  /// up at or below the threshold of the constraints.
+  std::optional<Estimate> apply(
+    State state,
+    rmf_traffic::Time earliest_arrival_time,
+    const Constraints& constraints) const
+  {
+    state.time(state.time().value() + duration);
+    if (waypoint.has_value())
+      state.waypoint(*waypoint);
+    if (orientation.has_value())
+      state.orientation(*orientation);
+
+    if (constraints.drain_battery())
+      state.battery_soc(state.battery_soc().value() - battery_drain);
+
+    // The threshold is never negative, so this also rejects a drained battery
+    if (state.battery_soc().value() <= constraints.threshold_soc())
+      return std::nullopt;
+
+    return Estimate(std::move(state), earliest_arrival_time);
+  }
+};
+
+//==============================================================================
+/// A model whose estimates are always a FixedStep. Activity::SequenceModel
+/// merges consecutive models of this kind into a single step.
+class FixedStepModel : public Activity::Model
+{
+public:
+
+  /// The step that this model applies to every state
+  virtual const FixedStep& fixed_step() const = 0;
+};
+
+} // namespace events
+} // namespace rmf_task_sequence
+
+#endif // SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_FIXEDSTEPMODEL_HPP
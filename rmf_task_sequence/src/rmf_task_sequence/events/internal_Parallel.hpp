@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_PARALLEL_HPP
+#define SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_PARALLEL_HPP
+
+#include <rmf_task_sequence/events/Bundle.hpp>
+#include <rmf_task/events/SimpleEventState.hpp>
+
+#include <rmf_task_sequence/schemas/ErrorHandler.hpp>
+
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace rmf_task_sequence {
+namespace events {
+namespace internal {
+
+//==============================================================================
+/// The ParallelAll and ParallelAny types of Bundle. Every dependency is begun
+/// at the same time, and the bundle follows whichever of them finish first.
+class Parallel
+{
+public:
+
+  class Standby;
+  class Active;
+  class Model;
+
+  /// Combine the statuses of the dependencies into the status of the bundle.
+  /// ParallelAny is Completed as soon as any of its dependencies is.
+  static void update_status(
+    Bundle::Type type,
+    rmf_task::events::SimpleEventState& state);
+};
+
+//==============================================================================
+class Parallel::Standby : public Event::Standby
+{
+public:
+
+  static Event::StandbyPtr initiate(
+    const Event::Initializer& initializer,
+    const Event::AssignIDPtr& id,
+    const std::function<rmf_task::State()>& get_state,
+    const ConstParametersPtr& parameters,
+    const Bundle::Description& description,
+    std::function<void()> parent_update);
+
+  static Event::StandbyPtr initiate(
+    Bundle::Type type,
+    const Bundle::DependencySpecifiers& dependencies,
+    rmf_task::events::SimpleEventStatePtr state,
+    std::function<void()> update);
+
+  Event::ConstStatePtr state() const final;
+
+  /// The longest estimate of the dependencies for ParallelAll, or the
+  /// shortest for ParallelAny
+  rmf_traffic::Duration duration_estimate() const final;
+
+  Event::ActivePtr begin(
+    std::function<void()> checkpoint,
+    std::function<void()> finish) final;
+
+  Standby(
+    Bundle::Type type,
+    std::vector<Event::StandbyPtr> dependencies,
+    rmf_task::events::SimpleEventStatePtr state,
+    std::function<void()> parent_update);
+
+private:
+  Bundle::Type _type;
+  std::vector<Event::StandbyPtr> _dependencies;
+  rmf_task::events::SimpleEventStatePtr _state;
+  std::function<void()> _parent_update;
+  std::shared_ptr<Parallel::Active> _active;
+};
+
+//==============================================================================
+class Parallel::Active
+  : public Event::Active,
+  public std::enable_shared_from_this<Parallel::Active>
+{
+public:
+
+  static Event::ActivePtr restore(
+    const Event::Initializer& initializer,
+    const Event::AssignIDPtr& id,
+    const std::function<rmf_task::State()>& get_state,
+    const ConstParametersPtr& parameters,
+    const Bundle::Description& description,
+    const nlohmann::json& backup_state,
+    std::function<void()> parent_update,
+    std::function<void()> checkpoint,
+    std::function<void()> finished);
+
+  Event::ConstStatePtr state() const final;
+
+  rmf_traffic::Duration remaining_time_estimate() const final;
+
+  Backup backup() const final;
+
+  Resume interrupt(std::function<void()> task_is_interrupted) final;
+
+  void cancel() final;
+
+  void kill() final;
+
+  Active(
+    Bundle::Type type,
+    rmf_task::events::SimpleEventStatePtr state,
+    std::function<void()> parent_update,
+    std::function<void()> checkpoint,
+    std::function<void()> finished);
+
+  /// Begin all of the dependencies at once
+  void begin(std::vector<Event::StandbyPtr> dependencies);
+
+private:
+
+  static const nlohmann::json_schema::json_validator&
+  backup_schema_validator();
+
+  /// The callback that a dependency triggers when it finishes
+  std::function<void()> _make_finished_callback();
+
+  /// The callback that a dependency triggers when it reaches a checkpoint.
+  /// This drops the cached backup state of that dependency before passing on
+  /// the checkpoint.
+  std::function<void()> _make_checkpoint_callback(std::size_t index);
+
+  /// React to a dependency finishing: cancel the rest of a ParallelAny once
+  /// one of its dependencies has completed, and finish the bundle once every
+  /// dependency has finished.
+  void _check_dependencies();
+
+  Bundle::Type _type;
+  // Null for dependencies that had already finished when this was restored
+  std::vector<Event::ActivePtr> _dependencies;
+  // The states of all the dependencies, including the ones that are null
+  std::vector<Event::ConstStatePtr> _states;
+  rmf_task::events::SimpleEventStatePtr _state;
+  std::function<void()> _parent_update;
+  std::function<void()> _checkpoint;
+  std::function<void()> _bundle_finished;
+
+  // Dependencies that finish while they are being begun or canceled are
+  // checked once that is done, instead of recursively
+  bool _inside_check = false;
+  bool _recheck = false;
+  bool _losers_canceled = false;
+  bool _finished = false;
+  mutable uint64_t _next_backup_sequence_number = 0;
+
+  // The backup state of each dependency as of its last checkpoint. A backup
+  // of the bundle only asks the dependencies that reached a checkpoint since
+  // the previous backup for their state, so the cost of a checkpoint does not
+  // grow with the size of the subtrees that have not changed.
+  mutable std::vector<std::optional<nlohmann::json>> _cached_states;
+  mutable std::mutex _cache_mutex;
+};
+
+//==============================================================================
+/// The model of a parallel bundle. Every dependency is estimated from the
+/// same initial state. ParallelAll finishes where its slowest dependency does
+/// and drains the battery by the sum of what each of its dependencies drains.
+/// ParallelAny finishes where its fastest dependency does.
+class Parallel::Model : public Activity::Model
+{
+public:
+
+  static Activity::ConstModelPtr make(
+    Bundle::Type type,
+    const std::vector<Event::ConstDescriptionPtr>& descriptions,
+    State invariant_initial_state,
+    const Parameters& parameters);
+
+  std::optional<Estimate> estimate_finish(
+    State initial_state,
+    rmf_traffic::Time earliest_arrival_time,
+    const Constraints& constraints,
+    const TravelEstimator& travel_estimator) const final;
+
+  rmf_traffic::Duration invariant_duration() const final;
+
+  State invariant_finish_state() const final;
+
+  Model(
+    Bundle::Type type,
+    std::vector<Activity::ConstModelPtr> models,
+    State invariant_initial_state);
+
+private:
+  Bundle::Type _type;
+  std::vector<Activity::ConstModelPtr> _models;
+  // The model whose invariants stand for the whole bundle
+  Activity::ConstModelPtr _decisive;
+  State _invariant_initial_state;
+};
+
+} // namespace internal
+} // namespace events
+} // namespace rmf_task_sequence
+
+#endif // SRC__RMF_TASK_SEQUENCE__EVENTS__INTERNAL_PARALLEL_HPP
@@ -47,10 +47,24 @@ public:
     Payload payload_,
     rmf_traffic::Duration loading_duration_estimate);
 
+  /// Make the model of the transfer. Transfers that go to the same place with
+  /// the same loading duration share one model for each start and set of
+  /// parameters, so this only builds the sequence of sub-models the first
+  /// time that it is needed.
   Activity::ConstModelPtr make_model(
     State invariant_initial_state,
     const Parameters& parameters) const;
 
+  /// The number of models that were shared with an earlier transfer
+  static std::size_t model_cache_hits();
+
+  /// The number of models that had to be built
+  static std::size_t model_cache_misses();
+
+  std::optional<State> predict_invariant_finish_state(
+    const State& invariant_initial_state,
+    const Parameters& parameters) const;
+
   Header generate_header(
     const std::string& type,
     const State& initial_state,
@@ -22,7 +22,8 @@
 #include <rmf_task/events/SimpleEventState.hpp>
 
 #include <rmf_task_sequence/schemas/ErrorHandler.hpp>
-#include <rmf_task_sequence/schemas/backup_EventSequence_v0_1.hpp>
+
+#include <deque>
 
 namespace rmf_task_sequence {
 namespace events {
@@ -54,7 +55,74 @@ public:
 
   class Standby;
   class Active;
+  class Remaining;
+
+};
+
+//==============================================================================
+/// The elements of a sequence that have not begun yet. When the elements are
+/// initialized lazily, only a bounded number of them ahead of the cursor are
+/// Standby events. The rest are represented in the state of the sequence by
+/// lightweight placeholders until they come within range, so a long sequence
+/// does not hold a fully initialized event for each of its steps. The event
+/// that replaces a placeholder gets its own ID when it is initialized.
+class Sequence::Remaining
+{
+public:
+
+  /// How many elements ahead of the cursor are initialized
+  static constexpr std::size_t lookahead = 8;
+
+  /// Use elements that have already been initialized, in order
+  Remaining(std::vector<Event::StandbyPtr> elements = {});
+
+  /// Initialize up to the lookahead right away and the rest of the elements
+  /// once the cursor gets close to them. The descriptions are given in order.
+  static Remaining lazily(
+    Event::ConstInitializerPtr initializer,
+    const Event::AssignIDPtr& id,
+    const std::function<rmf_task::State()>& get_state,
+    const ConstParametersPtr& parameters,
+    std::vector<Event::ConstDescriptionPtr> descriptions,
+    std::function<void()> update);
+
+  bool empty() const;
+
+  /// Take the next element. If a placeholder comes within the lookahead, its
+  /// event is initialized and its state replaces the placeholder among the
+  /// dependencies of the sequence state.
+  Event::StandbyPtr pop(rmf_task::events::SimpleEventState& sequence_state);
+
+  /// The states of the elements in order, including the placeholders
+  std::vector<Event::ConstStatePtr> states() const;
 
+  /// The sum of the duration estimates of the elements. The placeholders use
+  /// the estimates of the headers of their descriptions.
+  rmf_traffic::Duration duration_estimate() const;
+
+  void clear();
+
+private:
+
+  struct Initialize
+  {
+    Event::ConstInitializerPtr initializer;
+    Event::AssignIDPtr id;
+    std::function<rmf_task::State()> get_state;
+    ConstParametersPtr parameters;
+    std::function<void()> update;
+  };
+
+  struct Deferred
+  {
+    Event::ConstDescriptionPtr description;
+    Event::ConstStatePtr placeholder;
+    rmf_traffic::Duration estimate;
+  };
+
+  std::deque<Event::StandbyPtr> _ready;
+  std::deque<Deferred> _deferred;
+  std::shared_ptr<const Initialize> _initialize;
 };
 
 //==============================================================================
@@ -62,13 +130,16 @@ class Sequence::Standby : public Event::Standby
 {
 public:
 
+  /// Initiate a sequence. If an owner of the initializer is given, the
+  /// elements of a long sequence are initialized lazily.
   static Event::StandbyPtr initiate(
     const Event::Initializer& initializer,
     const Event::AssignIDPtr& id,
     const std::function<rmf_task::State()>& get_state,
     const ConstParametersPtr& parameters,
     const Bundle::Description& description,
-    std::function<void()> parent_update);
+    std::function<void()> parent_update,
+    Event::ConstInitializerPtr owner = nullptr);
 
   using MakeStandby = std::function<Event::StandbyPtr(Bundle::UpdateFn)>;
 
@@ -86,7 +157,7 @@ public:
     std::function<void()> finish) final;
 
   Standby(
-    std::vector<Event::StandbyPtr> reverse_dependencies,
+    Remaining remaining,
     rmf_task::events::SimpleEventStatePtr state,
     std::function<void()> parent_update);
 
@@ -98,7 +169,7 @@ public:
 
 private:
 
-  std::vector<Event::StandbyPtr> _reverse_dependencies;
+  Remaining _remaining;
   rmf_task::events::SimpleEventStatePtr _state;
   std::function<void()> _parent_update;
   std::shared_ptr<Sequence::Active> _active;
@@ -117,10 +188,11 @@ public:
     const std::function<rmf_task::State()>& get_state,
     const ConstParametersPtr& parameters,
     const Bundle::Description& description,
-    const std::string& backup,
+    const nlohmann::json& backup_state,
     std::function<void()> parent_update,
     std::function<void()> checkpoint,
-    std::function<void()> finished);
+    std::function<void()> finished,
+    Event::ConstInitializerPtr owner = nullptr);
 
   Event::ConstStatePtr state() const final;
 
@@ -135,7 +207,7 @@ public:
   void kill();
 
   Active(
-    std::vector<Event::StandbyPtr> dependencies,
+    Remaining remaining,
     rmf_task::events::SimpleEventStatePtr state,
     std::function<void()> parent_update,
     std::function<void()> checkpoint,
@@ -152,11 +224,12 @@ public:
 
 private:
 
-  static const nlohmann::json_schema::json_validator backup_schema_validator;
+  static const nlohmann::json_schema::json_validator&
+  backup_schema_validator();
 
   Event::ActivePtr _current;
   uint64_t _current_event_index_plus_one = 0;
-  std::vector<Event::StandbyPtr> _reverse_remaining;
+  Remaining _remaining;
   rmf_task::events::SimpleEventStatePtr _state;
   std::function<void()> _parent_update;
   std::function<void()> _checkpoint;
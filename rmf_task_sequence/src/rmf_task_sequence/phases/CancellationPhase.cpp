@@ -42,6 +42,7 @@ std::shared_ptr<CancellationPhase> CancellationPhase::make(
     nullptr);
 
   result->_phase = std::move(phase);
+  result->update();
   return result;
 }
 
@@ -53,6 +54,12 @@ auto CancellationPhase::tag() const -> ConstTagPtr
 
 //==============================================================================
 Event::ConstStatePtr CancellationPhase::final_event() const
+{
+  return _state;
+}
+
+//==============================================================================
+void CancellationPhase::update()
 {
   const auto child_event = _phase->final_event();
   _state->update_dependencies({child_event});
@@ -104,8 +111,6 @@ Event::ConstStatePtr CancellationPhase::final_event() const
   // active in the tree. That way we can give it a valid event ID that doesn't
   // conflict with any other events in the phase.
   _state->modify_id(highest_index+1);
-
-  return _state;
 }
 
 //==============================================================================
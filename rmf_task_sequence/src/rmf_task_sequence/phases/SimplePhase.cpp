@@ -44,10 +44,15 @@ public:
     auto event_header = final_event->generate_header(initial_state, parameters);
     const std::string& c = category.has_value() ?
       *category : event_header.category();
-    const std::string& d = detail.has_value() ?
-      *detail : event_header.detail();
 
-    return Header(c, d, duration);
+    if (detail.has_value())
+      return Header(c, *detail, duration);
+
+    // Leave the detail of the event to be generated when it is needed
+    return Header(
+      c,
+      [event_header]() { return event_header.detail(); },
+      duration);
   }
 };
 
@@ -95,6 +100,10 @@ public:
 
   ConstTagPtr _tag;
   Event::ActivePtr _final_event;
+
+  // The last snapshot that was published, so that the next one can share the
+  // events that have not changed since then
+  Phase::ConstSnapshotPtr _last_snapshot;
 };
 
 //==============================================================================
@@ -126,7 +135,11 @@ void SimplePhase::add(
         if (const auto phase = weak.lock())
         {
           if (phase->_final_event)
-            phase_update(Phase::Snapshot::make(*phase));
+          {
+            phase->_last_snapshot =
+              Phase::Snapshot::make(*phase, phase->_last_snapshot);
+            phase_update(phase->_last_snapshot);
+          }
         }
       };
 
@@ -243,6 +256,15 @@ Activity::ConstModelPtr SimplePhase::Description::make_model(
     parameters);
 }
 
+//==============================================================================
+std::optional<State> SimplePhase::Description::predict_invariant_finish_state(
+  const State& invariant_initial_state,
+  const Parameters& parameters) const
+{
+  return _pimpl->final_event->predict_invariant_finish_state(
+    invariant_initial_state, parameters);
+}
+
 //==============================================================================
 Header SimplePhase::Description::generate_header(
   const State& initial_state,
@@ -38,6 +38,12 @@ public:
 
   Event::ConstStatePtr final_event() const final;
 
+  /// Recalculate the status and ID of the final event from the event tree of
+  /// the phase that is being cancelled. This walks the whole tree, so it is
+  /// only done when the inner phase reports an update instead of every time
+  /// final_event() is called.
+  void update();
+
   rmf_traffic::Duration estimate_remaining_time() const final;
 
   Backup backup() const final;
@@ -20,6 +20,12 @@
 namespace rmf_task_sequence {
 namespace schemas {
 
+namespace {
+//==============================================================================
+// The number of TrustedScopes that exist on this thread
+thread_local std::size_t trusted_depth = 0;
+} // anonymous namespace
+
 //==============================================================================
 void ErrorHandler::error(
   const nlohmann::json::json_pointer& ptr,
@@ -32,12 +38,27 @@ void ErrorHandler::error(
 //==============================================================================
 auto ErrorHandler::has_error(
   const nlohmann::json_schema::json_validator& validator,
-  const nlohmann::json json) -> std::optional<Info>
+  const nlohmann::json& json) -> std::optional<Info>
 {
+  if (trusted_depth > 0)
+    return std::nullopt;
+
   ErrorHandler handler;
   validator.validate(json, handler);
   return handler.failure;
 }
 
+//==============================================================================
+ErrorHandler::TrustedScope::TrustedScope()
+{
+  ++trusted_depth;
+}
+
+//==============================================================================
+ErrorHandler::TrustedScope::~TrustedScope()
+{
+  --trusted_depth;
+}
+
 } // namespace schemas
 } // namespace rmf_task_sequence
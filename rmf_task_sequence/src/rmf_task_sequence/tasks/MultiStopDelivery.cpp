@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_task_sequence/tasks/MultiStopDelivery.hpp>
+#include <rmf_task_sequence/phases/SimplePhase.hpp>
+
+namespace rmf_task_sequence {
+namespace tasks {
+
+//==============================================================================
+Task::DescriptionPtr MultiStopDelivery::make(
+  events::PickUp::DescriptionPtr pickup,
+  std::vector<events::DropOff::DescriptionPtr> dropoffs,
+  std::vector<Phase::ConstDescriptionPtr> cancellation_sequence)
+{
+  if (!pickup || dropoffs.empty())
+  {
+    // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+    throw std::invalid_argument(
+      "[rmf_task_sequence::tasks::MultiStopDelivery::make] A pickup and at "
+      "least one dropoff are needed");
+    // *INDENT-ON*
+  }
+
+  Task::Builder builder;
+  builder.add_phase(
+    phases::SimplePhase::Description::make(pickup), cancellation_sequence);
+
+  std::string detail;
+  for (std::size_t i = 0; i < dropoffs.size(); ++i)
+  {
+    const auto& dropoff = dropoffs[i];
+    if (!dropoff)
+    {
+      // *INDENT-OFF* (prevent uncrustify from making unnecessary indents here)
+      throw std::invalid_argument(
+        "[rmf_task_sequence::tasks::MultiStopDelivery::make] Dropoff ["
+        + std::to_string(i) + "] is null");
+      // *INDENT-ON*
+    }
+
+    if (!dropoff->into_ingestor().empty())
+    {
+      if (!detail.empty())
+        detail += ", ";
+
+      detail += dropoff->into_ingestor();
+    }
+
+    builder.add_phase(
+      phases::SimplePhase::Description::make(dropoff), cancellation_sequence);
+  }
+
+  return builder.build("Multi-stop Delivery", std::move(detail));
+}
+
+} // namespace tasks
+} // namespace rmf_task_sequence
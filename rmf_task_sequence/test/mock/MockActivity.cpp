@@ -133,6 +133,7 @@ rmf_traffic::Duration MockActivity::Active::remaining_time_estimate() const
 //==============================================================================
 auto MockActivity::Active::backup() const -> Backup
 {
+  ++backups;
   return Backup::make(0, nlohmann::json());
 }
 
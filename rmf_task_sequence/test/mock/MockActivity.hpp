@@ -118,6 +118,9 @@ public:
 
     Signals signals;
     rmf_task::events::SimpleEventStatePtr state_data;
+
+    // The number of times that backup() was called
+    mutable std::size_t backups = 0;
   };
 
   static void add(const rmf_task_sequence::Event::InitializerPtr& initializer);
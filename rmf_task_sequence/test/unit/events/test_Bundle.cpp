@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task_sequence/events/Bundle.hpp>
+#include <rmf_task_sequence/events/WaitFor.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include "../utils.hpp"
+
+SCENARIO("Bundle headers")
+{
+  using Bundle = rmf_task_sequence::events::Bundle;
+  using WaitFor = rmf_task_sequence::events::WaitFor;
+
+  const auto parameters = make_test_parameters();
+  rmf_task::State initial_state;
+  initial_state.waypoint(1)
+  .orientation(0.0)
+  .time(std::chrono::steady_clock::now())
+  .dedicated_charging_waypoint(0)
+  .battery_soc(1.0);
+
+  const auto inner = std::make_shared<Bundle::Description>(
+    Bundle::Description::Dependencies{
+      WaitFor::Description::make(10s),
+      WaitFor::Description::make(20s)
+    }, Bundle::Type::Sequence);
+
+  const auto outer = std::make_shared<Bundle::Description>(
+    Bundle::Description::Dependencies{WaitFor::Description::make(5s), inner},
+    Bundle::Type::Sequence, "Outer");
+
+  const auto header = outer->generate_header(initial_state, *parameters);
+  CHECK(header.category() == "Outer");
+  CHECK(header.original_duration_estimate() == 35s);
+
+  const auto copy = header;
+  const auto detail = nlohmann::json::parse(copy.detail());
+  CHECK(&copy.detail() == &header.detail());
+
+  REQUIRE(detail.is_array());
+  REQUIRE(detail.size() == 2);
+  CHECK(detail[0]["category"] == "Waiting");
+  CHECK(detail[0]["detail"].is_string());
+
+  // The nested bundle gives its detail as json instead of as a string
+  CHECK(detail[1]["category"] == "Sequence");
+  REQUIRE(detail[1]["detail"].is_array());
+  CHECK(detail[1]["detail"].size() == 2);
+
+  WHEN("A bundle has its own detail")
+  {
+    inner->detail("{\"custom\": true}");
+    const auto custom = nlohmann::json::parse(
+      outer->generate_header(initial_state, *parameters).detail());
+
+    CHECK(custom[1]["detail"]["custom"] == true);
+  }
+}
+
+SCENARIO("Lazy header details")
+{
+  std::size_t calls = 0;
+  const rmf_task::Header header(
+    "Lazy",
+    [&calls]()
+    {
+      ++calls;
+      return std::string("generated");
+    }, 1s);
+
+  CHECK(calls == 0);
+  const auto copy = header;
+  CHECK(copy.detail() == "generated");
+  CHECK(header.detail() == "generated");
+  CHECK(calls == 1);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task_sequence/events/Coroutine.hpp>
+
+#ifdef RMF_TASK_SEQUENCE__HAS_COROUTINES
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+using Coroutine = rmf_task_sequence::events::Coroutine;
+using Status = rmf_task::Event::Status;
+
+//==============================================================================
+struct Outcome
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool finished = false;
+  std::optional<bool> arrived;
+  std::size_t checkpoints = 0;
+
+  std::function<void()> on_finished()
+  {
+    return [this]()
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        cv.notify_all();
+      };
+  }
+
+  bool wait()
+  {
+    using namespace std::chrono_literals;
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, 5s, [&]() { return finished; });
+  }
+};
+
+//==============================================================================
+Coroutine::Task travel(
+  Coroutine::ContextPtr context,
+  Coroutine::Trigger<bool> arrival,
+  Outcome& outcome)
+{
+  using namespace std::chrono_literals;
+  if (!co_await context->sleep_for(10ms))
+    co_return;
+
+  context->checkpoint({{"stage", "travel"}});
+
+  const auto result = co_await arrival;
+  std::lock_guard<std::mutex> lock(outcome.mutex);
+  if (result.has_value())
+    outcome.arrived = *result;
+}
+
+//==============================================================================
+Coroutine::Task fail(Coroutine::ContextPtr)
+{
+  co_await std::suspend_never();
+  throw std::runtime_error("no route");
+}
+
+//==============================================================================
+auto make_state()
+{
+  return rmf_task::events::SimpleEventState::make(
+    0, "travel", "", Status::Standby);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Events written as coroutines")
+{
+  using namespace std::chrono_literals;
+  const auto executor = rmf_task::Executor::make_thread_pool(2);
+
+  Outcome outcome;
+  std::optional<Coroutine::Trigger<bool>> arrival;
+  const auto standby = Coroutine::standby(
+    [&](Coroutine::ContextPtr context)
+    {
+      arrival = context->trigger<bool>();
+      return travel(context, *arrival, outcome);
+    }, make_state(), 1min, nullptr, executor);
+
+  CHECK(standby->duration_estimate() == 1min);
+  CHECK(standby->state()->status() == Status::Standby);
+
+  const auto active = standby->begin(
+    [&]()
+    {
+      std::lock_guard<std::mutex> lock(outcome.mutex);
+      ++outcome.checkpoints;
+    }, outcome.on_finished());
+
+  CHECK(standby->begin(nullptr, nullptr) == active);
+  CHECK(active->state() == standby->state());
+
+  WHEN("The robot arrives")
+  {
+    REQUIRE(arrival.has_value());
+    arrival->set(true);
+    REQUIRE(outcome.wait());
+
+    CHECK(outcome.arrived == std::optional<bool>(true));
+    CHECK(outcome.checkpoints == 1);
+    CHECK(active->state()->status() == Status::Completed);
+    CHECK(active->backup().sequence() == 1);
+    CHECK(active->backup().state()["stage"] == "travel");
+    CHECK(active->remaining_time_estimate() == rmf_traffic::Duration(0));
+  }
+
+  WHEN("The event is canceled while it waits")
+  {
+    active->cancel();
+    REQUIRE(outcome.wait());
+
+    CHECK_FALSE(outcome.arrived.has_value());
+    CHECK(active->state()->status() == Status::Canceled);
+  }
+}
+
+//==============================================================================
+SCENARIO("Event coroutines without an executor")
+{
+  Outcome outcome;
+  const auto state = make_state();
+  const auto active = Coroutine::restore(
+    [](Coroutine::ContextPtr context) { return fail(context); },
+    state, std::chrono::seconds(1), {{"stage", "start"}}, nullptr, nullptr,
+    outcome.on_finished());
+
+  // Without an executor the coroutine runs on the thread that begins it
+  CHECK(outcome.finished);
+  CHECK(state->status() == Status::Failed);
+
+  std::size_t errors = 0;
+  for (const auto& entry : rmf_task::Log::Reader().read(state->log()))
+  {
+    if (entry.tier() == rmf_task::Log::Tier::Error)
+      ++errors;
+  }
+  CHECK(errors == 1);
+}
+
+#endif // RMF_TASK_SEQUENCE__HAS_COROUTINES
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task_sequence/events/EventStateTree.hpp>
+
+#include <stdexcept>
+
+SCENARIO("Test EventStateTree")
+{
+  using EventStateTree = rmf_task_sequence::events::EventStateTree;
+  using Status = rmf_task::Event::Status;
+
+  auto tree = EventStateTree::make(4);
+  CHECK(tree->capacity() == 4);
+
+  const auto root = tree->add(0, "root", "everything", Status::Underway);
+  const auto first = tree->add(1, "first", "", Status::Completed, root);
+  const auto second = tree->add(2, "second", "", Status::Underway, root);
+  const auto leaf = tree->add(3, "leaf", "", Status::Standby, second);
+  CHECK(tree->size() == 4);
+
+  CHECK_THROWS_AS(
+    tree->add(4, "extra", "", Status::Standby, root), std::length_error);
+  CHECK_THROWS_AS(tree->state(4), std::out_of_range);
+
+  CHECK_FALSE(tree->parent(root).has_value());
+  CHECK(tree->parent(leaf) == second);
+  CHECK(tree->first_child(root) == first);
+  CHECK(tree->next_sibling(first) == second);
+  CHECK_FALSE(tree->next_sibling(second).has_value());
+  CHECK_FALSE(tree->first_child(leaf).has_value());
+
+  const auto state = tree->state(root);
+  CHECK(state->id() == 0);
+  rmf_task::VersionedString::Reader reader;
+  CHECK(*reader.read(state->name()) == "root");
+  CHECK(*reader.read(state->detail()) == "everything");
+  CHECK(state->status() == Status::Underway);
+
+  const auto dependencies = state->dependencies();
+  REQUIRE(dependencies.size() == 2);
+  CHECK(dependencies[0]->id() == 1);
+  CHECK(dependencies[1]->id() == 2);
+  REQUIRE(dependencies[1]->dependencies().size() == 1);
+  CHECK(dependencies[1]->dependencies()[0]->id() == 3);
+
+  CHECK(tree->sequence_status(root) == Status::Underway);
+  CHECK(tree->sequence_status(leaf) == Status::Completed);
+
+  const auto snapshot = rmf_task::Event::Snapshot::make(*state);
+  CHECK(rmf_task::Event::Snapshot::make(*state, snapshot) == snapshot);
+
+  WHEN("An event changes")
+  {
+    const auto version = tree->state(leaf)->version();
+    tree->update_status(leaf, Status::Standby);
+    CHECK(tree->state(leaf)->version() == version);
+
+    tree->update_status(second, Status::Blocked);
+    CHECK(tree->sequence_status(root) == Status::Blocked);
+
+    tree->update_log(leaf).info("waiting");
+    CHECK(tree->state(leaf)->version() != version);
+
+    std::size_t count = 0;
+    for (const auto& entry :
+      rmf_task::Log::Reader().read(tree->state(leaf)->log()))
+    {
+      CHECK(entry.text() == "waiting");
+      ++count;
+    }
+    CHECK(count == 1);
+  }
+
+}
+
+SCENARIO("EventStateTree states share ownership of the tree")
+{
+  using EventStateTree = rmf_task_sequence::events::EventStateTree;
+  using Status = rmf_task::Event::Status;
+
+  auto tree = EventStateTree::make(2);
+  const auto root = tree->add(0, "root", "", Status::Underway);
+  tree->add(1, "leaf", "", Status::Standby, root);
+
+  const std::weak_ptr<EventStateTree> weak = tree;
+  auto held = tree->state(root)->dependencies().at(0);
+  tree.reset();
+  CHECK_FALSE(weak.expired());
+  CHECK(*rmf_task::VersionedString::Reader().read(held->name()) == "leaf");
+
+  held.reset();
+  CHECK(weak.expired());
+}
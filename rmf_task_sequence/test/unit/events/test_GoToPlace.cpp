@@ -69,4 +69,24 @@ SCENARIO("Test GoToPlace")
     REQUIRE(finish.has_value());
     CHECK(finish->finish_state().waypoint() == 8);
   }
+
+  WHEN("Several models choose between the same goals")
+  {
+    const auto shared = rmf_task::TravelEstimator::shared(*parameters);
+    auto description = GoToPlace::Description::make_for_one_of({0, 8, 12});
+    REQUIRE(description->make_model(initial_state, *parameters));
+
+    const auto misses = shared->cache_misses();
+    const auto hits = shared->cache_hits();
+    const auto again = GoToPlace::Description::make_for_one_of({12, 8, 0});
+    const auto model = again->make_model(initial_state, *parameters);
+    REQUIRE(model);
+
+    THEN("The goals are only planned once")
+    {
+      CHECK(shared->cache_misses() == misses);
+      CHECK(shared->cache_hits() == hits + 3);
+      CHECK(model->invariant_finish_state().waypoint() == 0);
+    }
+  }
 }
@@ -18,6 +18,7 @@
 #include <rmf_utils/catch.hpp>
 
 #include <rmf_task_sequence/events/PerformAction.hpp>
+#include <rmf_task_sequence/events/WaitFor.hpp>
 
 #include "../utils.hpp"
 
@@ -106,3 +107,62 @@ SCENARIO("Test PerformAction")
     CHECK(header.original_duration_estimate() == duration);
   }
 }
+
+SCENARIO("Consecutive fixed duration events in a sequence")
+{
+  using PerformAction = rmf_task_sequence::events::PerformAction;
+  using WaitFor = rmf_task_sequence::events::WaitFor;
+  using SequenceModel = rmf_task_sequence::Activity::SequenceModel;
+
+  const auto parameters = make_test_parameters();
+  const auto constraints = make_test_constraints();
+  const auto travel_estimator = rmf_task::TravelEstimator(*parameters);
+  const auto now = std::chrono::steady_clock::now();
+  rmf_task::State initial_state;
+  initial_state.waypoint(0)
+  .orientation(0.0)
+  .time(now)
+  .dedicated_charging_waypoint(0)
+  .battery_soc(1.0);
+
+  const std::vector<rmf_task_sequence::Activity::ConstDescriptionPtr>
+  descriptions = {
+    PerformAction::Description::make(
+      "first", nlohmann::json(), 10s, true,
+      rmf_traffic::agv::Planner::Goal{1}),
+    WaitFor::Description::make(20s),
+    PerformAction::Description::make(
+      "second", nlohmann::json(), 30s, false, std::nullopt)
+  };
+
+  const auto sequence =
+    SequenceModel::make(descriptions, initial_state, *parameters);
+  REQUIRE(sequence);
+  CHECK(sequence->invariant_duration() == 60s);
+
+  // Estimate each event on its own, one after another
+  rmf_task::State expected = initial_state;
+  rmf_task::State invariant = initial_state;
+  for (const auto& description : descriptions)
+  {
+    const auto model = description->make_model(invariant, *parameters);
+    invariant = model->invariant_finish_state();
+    const auto estimate = model->estimate_finish(
+      expected, now, *constraints, travel_estimator);
+    REQUIRE(estimate.has_value());
+    expected = estimate->finish_state();
+  }
+
+  const auto estimate = sequence->estimate_finish(
+    initial_state, now, *constraints, travel_estimator);
+  REQUIRE(estimate.has_value());
+  const auto& finish = estimate->finish_state();
+  CHECK(finish.time().value() == expected.time().value());
+  CHECK(finish.waypoint().value() == 1);
+  CHECK(finish.waypoint() == expected.waypoint());
+  CHECK(finish.orientation() == expected.orientation());
+  CHECK(finish.battery_soc().value() ==
+    Approx(expected.battery_soc().value()));
+  CHECK(estimate->wait_until() == now);
+  CHECK(sequence->invariant_finish_state().waypoint() == invariant.waypoint());
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task_sequence/events/DropOff.hpp>
+#include <rmf_task_sequence/events/PickUp.hpp>
+
+#include "src/rmf_task_sequence/events/internal_PayloadTransfer.hpp"
+
+#include "../utils.hpp"
+
+SCENARIO("Payload transfers share their models")
+{
+  using PayloadTransfer = rmf_task_sequence::events::PayloadTransfer;
+  using PickUp = rmf_task_sequence::events::PickUp;
+  using DropOff = rmf_task_sequence::events::DropOff;
+
+  const auto parameters = make_test_parameters();
+  const auto constraints = make_test_constraints();
+  const auto now = std::chrono::steady_clock::now();
+  rmf_task::State initial_state;
+  initial_state.waypoint(1)
+  .orientation(0.0)
+  .time(now)
+  .dedicated_charging_waypoint(0)
+  .battery_soc(1.0);
+
+  const auto travel_estimator = rmf_task::TravelEstimator(*parameters);
+  const rmf_task::Payload payload({});
+
+  const auto first = PickUp::Description::make(3, "dispenser", payload, 30s);
+  const auto first_model = first->make_model(initial_state, *parameters);
+  REQUIRE(first_model);
+
+  const auto hits = PayloadTransfer::model_cache_hits();
+  const auto misses = PayloadTransfer::model_cache_misses();
+
+  WHEN("Another transfer goes to the same place")
+  {
+    auto later_state = initial_state;
+    later_state.time(now + 1h);
+
+    const auto second =
+      DropOff::Description::make(3, "ingestor", payload, 30s);
+    const auto second_model = second->make_model(later_state, *parameters);
+    REQUIRE(second_model);
+
+    THEN("The model is shared")
+    {
+      CHECK(PayloadTransfer::model_cache_hits() == hits + 1);
+      CHECK(PayloadTransfer::model_cache_misses() == misses);
+      CHECK(second_model->invariant_duration()
+        == first_model->invariant_duration());
+    }
+
+    THEN("The finish state still follows the initial state")
+    {
+      const auto finish = second_model->invariant_finish_state();
+      CHECK(finish.waypoint() == 3);
+      CHECK(finish.time() == now + 1h);
+
+      const auto estimate = second_model->estimate_finish(
+        later_state, now, *constraints, travel_estimator);
+      REQUIRE(estimate.has_value());
+      CHECK(estimate->finish_state().time().value()
+        > (now + 1h + 30s));
+    }
+  }
+
+  WHEN("A transfer waits for a different duration")
+  {
+    const auto other = PickUp::Description::make(3, "dispenser", payload, 60s);
+    const auto model = other->make_model(initial_state, *parameters);
+    REQUIRE(model);
+
+    CHECK(PayloadTransfer::model_cache_misses() == misses + 1);
+    CHECK(model->invariant_duration()
+      == first_model->invariant_duration() + 30s);
+  }
+
+  WHEN("A transfer moves to a different place")
+  {
+    first->pickup_location(7);
+    REQUIRE(first->make_model(initial_state, *parameters));
+    CHECK(PayloadTransfer::model_cache_misses() == misses + 1);
+  }
+}
@@ -32,6 +32,7 @@
 
 #include <rmf_task_sequence/Task.hpp>
 #include <rmf_task_sequence/phases/SimplePhase.hpp>
+#include <rmf_task_sequence/tasks/MultiStopDelivery.hpp>
 
 #include <rmf_traffic/geometry/Circle.hpp>
 
@@ -209,6 +210,86 @@ SCENARIO("Test GoToPlace and PerformAction Compose task")
       CHECK(optimal_assignments);
     }
   }
+
+  WHEN("The models of the phases are made on several threads")
+  {
+    rmf_task_sequence::Task::Builder long_builder;
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+      long_builder.add_phase(gotoplace_phase, {});
+      long_builder.add_phase(action_phase, {});
+    }
+
+    const auto serial = long_builder.build("mock_category", "mock_tag");
+    const auto parallel = long_builder.build("mock_category", "mock_tag");
+    parallel->model_threads(4);
+    CHECK(serial->model_threads() == 1);
+    CHECK(parallel->model_threads() == 4);
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto serial_model = serial->make_model(now, parameters);
+    const auto parallel_model = parallel->make_model(now, parameters);
+    REQUIRE(serial_model);
+    REQUIRE(parallel_model);
+
+    THEN("The models are the same as when they are made one at a time")
+    {
+      CHECK(parallel_model->invariant_duration()
+        == serial_model->invariant_duration());
+
+      rmf_traffic::agv::Plan::Start start{now, 0, 0.0};
+      const auto initial_state = rmf_task::State().load_basic(start, 0, 1.0);
+      const rmf_task::TravelEstimator estimator(parameters);
+      const rmf_task::Constraints full_battery{0.0, 1.0, false};
+      const auto serial_estimate =
+        serial_model->estimate_finish(initial_state, full_battery, estimator);
+      const auto parallel_estimate =
+        parallel_model->estimate_finish(initial_state, full_battery, estimator);
+      REQUIRE(serial_estimate.has_value());
+      REQUIRE(parallel_estimate.has_value());
+      CHECK(parallel_estimate->finish_state().time()
+        == serial_estimate->finish_state().time());
+      CHECK(parallel_estimate->finish_state().waypoint()
+        == serial_estimate->finish_state().waypoint());
+    }
+  }
+
+  WHEN("A delivery drops off at several stops")
+  {
+    using MultiStopDelivery = rmf_task_sequence::tasks::MultiStopDelivery;
+    using PickUp = rmf_task_sequence::events::PickUp;
+    using DropOff = rmf_task_sequence::events::DropOff;
+
+    const rmf_task::Payload payload({});
+    const auto wait = std::chrono::seconds(10);
+    const auto pickup = PickUp::Description::make(
+      PickUp::Location(0), "dispenser", payload, wait);
+    const std::vector<DropOff::DescriptionPtr> dropoffs = {
+      DropOff::Description::make(DropOff::Location(1), "first", payload, wait),
+      DropOff::Description::make(DropOff::Location(0), "second", payload, wait)
+    };
+
+    CHECK_THROWS_AS(MultiStopDelivery::make(pickup, {}), std::invalid_argument);
+    CHECK_THROWS_AS(
+      MultiStopDelivery::make(pickup, {nullptr}), std::invalid_argument);
+
+    const auto delivery = MultiStopDelivery::make(pickup, dropoffs);
+    CHECK(delivery->category() == "Multi-stop Delivery");
+    CHECK(delivery->detail() == "first, second");
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto model = delivery->make_model(now, parameters);
+    REQUIRE(model);
+
+    rmf_traffic::agv::Plan::Start start{now, 0, 0.0};
+    const auto estimate = model->estimate_finish(
+      rmf_task::State().load_basic(start, 0, 1.0),
+      rmf_task::Constraints{0.0, 1.0, false},
+      rmf_task::TravelEstimator(parameters));
+    REQUIRE(estimate.has_value());
+    CHECK(estimate->finish_state().waypoint() == 0);
+    CHECK(estimate->finish_state().time().value() > now + 3 * wait);
+  }
 }
 
 //==============================================================================
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_utils/catch.hpp>
+
+#include <rmf_task_sequence/DescriptionRegistry.hpp>
+#include <rmf_task_sequence/events/WaitFor.hpp>
+#include <rmf_task_sequence/phases/SimplePhase.hpp>
+
+#include <stdexcept>
+
+SCENARIO("Parse task descriptions with a DescriptionRegistry")
+{
+  using DescriptionRegistry = rmf_task_sequence::DescriptionRegistry;
+  using SimplePhase = rmf_task_sequence::phases::SimplePhase;
+  using WaitFor = rmf_task_sequence::events::WaitFor;
+
+  const nlohmann::json schema = {
+    {"$schema", "https://json-schema.org/draft/2020-12/schema"},
+    {"$id", "https://open-rmf.org/rmf_task_sequence/test_wait/0.1"},
+    {"type", "object"},
+    {"properties", {{"seconds", {{"type", "integer"}}}}},
+    {"required", {"seconds"}}
+  };
+
+  std::size_t calls = 0;
+  const auto deserializer = [&calls](const nlohmann::json& json)
+    {
+      ++calls;
+      return SimplePhase::Description::make(
+        WaitFor::Description::make(
+          std::chrono::seconds(json["seconds"].get<int>())));
+    };
+
+  DescriptionRegistry registry(4);
+  registry.add("wait", schema, deserializer);
+  CHECK(registry.has("wait"));
+  CHECK_FALSE(registry.has("go"));
+
+  CHECK_THROWS_AS(
+    registry.add("empty", schema, nullptr), std::invalid_argument);
+  CHECK_THROWS_AS(
+    registry.parse("go", {{"seconds", 1}}), std::invalid_argument);
+  CHECK_THROWS_AS(
+    registry.parse("wait", {{"seconds", "ten"}}), std::invalid_argument);
+  CHECK(calls == 0);
+
+  const nlohmann::json wait = {{"seconds", 10}};
+  const auto first = registry.parse("wait", wait);
+  REQUIRE(first);
+  CHECK(calls == 1);
+
+  WHEN("The same description is parsed again")
+  {
+    const auto second = registry.parse("wait", wait);
+    CHECK(second == first);
+    CHECK(calls == 1);
+    CHECK(registry.cache_size() == 1);
+
+    registry.clear_cache();
+    CHECK(registry.cache_size() == 0);
+    CHECK(registry.parse("wait", wait) != first);
+    CHECK(calls == 2);
+  }
+
+  WHEN("More descriptions are parsed than the cache can hold")
+  {
+    for (int i = 0; i < 6; ++i)
+      registry.parse("wait", {{"seconds", i}});
+
+    CHECK(registry.cache_size() == 4);
+    CHECK(calls == 7);
+
+    // The first description was evicted
+    CHECK(registry.parse("wait", wait) != first);
+  }
+
+  WHEN("A whole task is parsed")
+  {
+    const nlohmann::json task = {
+      {"category", "patrol"},
+      {"detail", "wait around"},
+      {"phases", {
+        {{"category", "wait"}, {"description", wait}},
+        {
+          {"category", "wait"},
+          {"description", {{"seconds", 20}}},
+          {"on_cancel", {{{"category", "wait"}, {"description", wait}}}}
+        }
+      }}
+    };
+
+    const auto description = registry.parse_task(task);
+    REQUIRE(description);
+    CHECK(description->category() == "patrol");
+    CHECK(description->detail() == "wait around");
+    // The repeated phase came from the cache
+    CHECK(calls == 2);
+
+    CHECK_THROWS_AS(
+      registry.parse_task({{"category", "patrol"}}), std::invalid_argument);
+    CHECK_THROWS_AS(
+      registry.parse_task(
+        {{"category", "patrol"}, {"phases", {{{"category", "go"}}}}}),
+      std::invalid_argument);
+  }
+}
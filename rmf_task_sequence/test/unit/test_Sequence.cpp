@@ -33,6 +33,8 @@
 
 #include "../mock/MockActivity.hpp"
 
+#include <nlohmann/json.hpp>
+
 #include <iostream>
 
 using namespace test_rmf_task_sequence;
@@ -420,4 +422,312 @@ SCENARIO("Test Event Sequences")
     CHECK(task->completed_phases().size() == 3);
     CHECK(task->pending_phases().size() == 0);
   }
+
+  WHEN("An event checkpoints without changing anything")
+  {
+    ctrl_1_0->active->signals.checkpoint();
+    last_backup = std::nullopt;
+
+    ctrl_1_0->active->signals.checkpoint();
+    CHECK_FALSE(last_backup.has_value());
+
+    ctrl_1_0->active->complete();
+    CHECK(last_backup.has_value());
+  }
+
+  WHEN("Pending phases are skipped and rewound")
+  {
+    last_backup = std::nullopt;
+    task->skip(3);
+    REQUIRE(task->pending_phases().size() == 2);
+    CHECK(task->pending_phases()[1].will_be_skipped());
+    CHECK(last_backup.has_value());
+
+    // Setting the same flag again does not change the backup
+    last_backup = std::nullopt;
+    task->skip(3);
+    CHECK_FALSE(last_backup.has_value());
+
+    const auto tag = task->pending_phases()[0].tag();
+    for (const auto& ctrl : {ctrl_1_0, ctrl_1_1, ctrl_1_2, ctrl_1_3})
+      ctrl->active->complete();
+
+    check_active({ctrl_2_0});
+    REQUIRE(task->pending_phases().size() == 1);
+    CHECK(task->pending_phases()[0].will_be_skipped());
+
+    REQUIRE(task->completed_phases().size() == 1);
+    task->rewind(1);
+
+    // The phases that were rewound are no longer completed
+    for (const auto& completed : task->completed_phases())
+      CHECK(completed->snapshot()->tag()->id() != 1);
+
+    const auto& pending = task->pending_phases();
+    REQUIRE(pending.size() >= 2);
+    CHECK(pending[pending.size()-2].tag() == tag);
+    CHECK(pending.back().tag()->id() == 3);
+    // The skip flag of a phase that stayed pending is kept
+    CHECK(pending.back().will_be_skipped());
+  }
+
+  WHEN("Task backups carry a checksum")
+  {
+    rmf_task::Activator trusted_activator;
+    rmf_task_sequence::Task::add(
+      trusted_activator,
+      phase_activator,
+      []() { return std::chrono::steady_clock::now(); },
+      std::nullopt,
+      rmf_task_sequence::Task::BackupEncoding::Json,
+      true);
+
+    auto trusted_task = trusted_activator.activate(
+      []() { return rmf_task::State().time(std::chrono::steady_clock::now()); },
+      params,
+      rmf_task::Request(
+        "mock_request_03",
+        std::chrono::steady_clock::now(),
+        nullptr,
+        builder.build("Mock Task", "Mocking a task")),
+      [](rmf_task::Phase::ConstSnapshotPtr) {},
+      [](rmf_task::Task::Active::Backup) {},
+      [](rmf_task::Phase::ConstCompletedPtr) {},
+      []() {});
+
+    const std::string prefix = "rmf_task_sequence checksum ";
+    const auto state = trusted_task->backup().state();
+    REQUIRE(state.size() > prefix.size() + 17);
+    CHECK(state.substr(0, prefix.size()) == prefix);
+    CHECK(state[prefix.size() + 16] == '\n');
+
+    const auto decoded =
+      nlohmann::json::parse(state.substr(prefix.size() + 17));
+    CHECK(decoded["schema_version"] == 1);
+  }
+
+  WHEN("Task backups are encoded in CBOR")
+  {
+    rmf_task::Activator cbor_activator;
+    rmf_task_sequence::Task::add(
+      cbor_activator,
+      phase_activator,
+      []() { return std::chrono::steady_clock::now(); },
+      std::nullopt,
+      rmf_task_sequence::Task::BackupEncoding::Cbor);
+
+    std::optional<rmf_task::Task::Active::Backup> cbor_backup;
+    auto cbor_task = cbor_activator.activate(
+      []() { return rmf_task::State().time(std::chrono::steady_clock::now()); },
+      params,
+      rmf_task::Request(
+        "mock_request_02",
+        std::chrono::steady_clock::now(),
+        nullptr,
+        builder.build("Mock Task", "Mocking a task")),
+      [](rmf_task::Phase::ConstSnapshotPtr) {},
+      [&cbor_backup](rmf_task::Task::Active::Backup backup)
+      {
+        cbor_backup = std::move(backup);
+      },
+      [](rmf_task::Phase::ConstCompletedPtr) {},
+      []() {});
+
+    ctrl_1_0->active->complete();
+    REQUIRE(cbor_backup.has_value());
+
+    const auto& state = cbor_backup->state();
+    REQUIRE(state.size() > 3);
+    CHECK(state.substr(0, 3) == "\xD9\xD9\xF7");
+
+    const auto decoded = nlohmann::json::from_cbor(state.substr(3));
+    CHECK(decoded["schema_version"] == 1);
+    CHECK(decoded["current_phase"]["id"] == 1);
+
+    // The backups of the nested event sequences are embedded as structured
+    // values rather than as text
+    const auto& phase_state = decoded["current_phase"]["state"];
+    REQUIRE(phase_state.is_object());
+    CHECK(phase_state["current_event"]["index"] == 0);
+  }
+}
+
+SCENARIO("Long sequences initialize their events lazily")
+{
+  using Bundle = rmf_task_sequence::events::Bundle;
+  using SimpleEventState = rmf_task::events::SimpleEventState;
+
+  const auto event_initializer =
+    std::make_shared<rmf_task_sequence::Event::Initializer>();
+  Bundle::add(event_initializer);
+  MockActivity::add(event_initializer);
+
+  const auto battery_system =
+    rmf_battery::agv::BatterySystem::make(24.0, 40.0, 8.8).value();
+  const auto params = std::make_shared<rmf_task::Parameters>(
+    nullptr,
+    battery_system,
+    std::make_shared<rmf_battery::agv::SimpleMotionPowerSink>(
+      battery_system,
+      rmf_battery::agv::MechanicalSystem::make(70.0, 40.0, 0.22).value()),
+    std::make_shared<rmf_battery::agv::SimpleDevicePowerSink>(
+      battery_system, rmf_battery::agv::PowerSystem::make(20.0).value()));
+
+  const std::size_t num_events = 20;
+  std::vector<std::shared_ptr<MockActivity::Controller>> ctrls;
+  Bundle::Description::Dependencies descs;
+  for (std::size_t i = 0; i < num_events; ++i)
+  {
+    ctrls.push_back(std::make_shared<MockActivity::Controller>());
+    descs.push_back(std::make_shared<MockActivity::Description>(ctrls.back()));
+  }
+
+  const auto standby = event_initializer->initialize(
+    rmf_task::Event::AssignID::make(),
+    []() { return rmf_task::State().time(std::chrono::steady_clock::now()); },
+    params,
+    Bundle::Description(descs, Bundle::Type::Sequence),
+    []() {});
+
+  const auto is_initialized = [&standby](std::size_t index)
+    {
+      const auto dependencies = standby->state()->dependencies();
+      REQUIRE(dependencies.size() == num_events);
+      return std::dynamic_pointer_cast<const SimpleEventState>(
+        dependencies[index]) != nullptr;
+    };
+
+  CHECK(is_initialized(0));
+  CHECK(is_initialized(7));
+  CHECK_FALSE(is_initialized(8));
+  CHECK_FALSE(is_initialized(num_events - 1));
+  CHECK(standby->state()->status() == rmf_task::Event::Status::Standby);
+
+  bool finished = false;
+  const auto active = standby->begin(
+    []() {}, [&finished]() { finished = true; });
+  CHECK(is_initialized(8));
+  CHECK_FALSE(is_initialized(9));
+
+  for (const auto& ctrl : ctrls)
+  {
+    REQUIRE(ctrl->active);
+    CHECK_FALSE(finished);
+    ctrl->active->complete();
+  }
+
+  CHECK(finished);
+  CHECK(is_initialized(num_events - 1));
+}
+
+//==============================================================================
+SCENARIO("Parallel bundles run their events at the same time")
+{
+  using Bundle = rmf_task_sequence::events::Bundle;
+  using Status = rmf_task::Event::Status;
+
+  const auto event_initializer =
+    std::make_shared<rmf_task_sequence::Event::Initializer>();
+  Bundle::add(event_initializer);
+  MockActivity::add(event_initializer);
+
+  const auto battery_system =
+    rmf_battery::agv::BatterySystem::make(24.0, 40.0, 8.8).value();
+  const auto params = std::make_shared<rmf_task::Parameters>(
+    nullptr,
+    battery_system,
+    std::make_shared<rmf_battery::agv::SimpleMotionPowerSink>(
+      battery_system,
+      rmf_battery::agv::MechanicalSystem::make(70.0, 40.0, 0.22).value()),
+    std::make_shared<rmf_battery::agv::SimpleDevicePowerSink>(
+      battery_system, rmf_battery::agv::PowerSystem::make(20.0).value()));
+
+  std::vector<std::shared_ptr<MockActivity::Controller>> ctrls;
+  Bundle::Description::Dependencies descs;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    ctrls.push_back(std::make_shared<MockActivity::Controller>());
+    descs.push_back(std::make_shared<MockActivity::Description>(ctrls.back()));
+  }
+
+  const auto begin = [&](Bundle::Type type, bool& finished)
+    {
+      const auto standby = event_initializer->initialize(
+        rmf_task::Event::AssignID::make(),
+        []()
+        {
+          return rmf_task::State().time(std::chrono::steady_clock::now());
+        },
+        params,
+        Bundle::Description(descs, type),
+        []() {});
+
+      CHECK(standby->state()->dependencies().size() == ctrls.size());
+      check_inactive(ctrls);
+      return standby->begin([]() {}, [&finished]() { finished = true; });
+    };
+
+  WHEN("All of the events need to finish")
+  {
+    bool finished = false;
+    const auto active = begin(Bundle::Type::ParallelAll, finished);
+    check_active(ctrls);
+    CHECK(active->state()->status() == Status::Underway);
+
+    ctrls[2]->active->complete();
+    ctrls[0]->active->complete();
+    CHECK_FALSE(finished);
+    CHECK(active->state()->status() == Status::Underway);
+
+    const auto backup = active->backup();
+    const auto& dependencies = backup.state()["dependencies"];
+    REQUIRE(dependencies.size() == ctrls.size());
+    CHECK(dependencies[0].contains("finished"));
+    CHECK(dependencies[1].contains("state"));
+
+    ctrls[1]->active->complete();
+    CHECK(finished);
+    CHECK(active->state()->status() == Status::Completed);
+  }
+
+  WHEN("Any one of the events needs to finish")
+  {
+    bool finished = false;
+    const auto active = begin(Bundle::Type::ParallelAny, finished);
+    check_active(ctrls);
+
+    ctrls[1]->active->complete();
+    CHECK(finished);
+    CHECK(active->state()->status() == Status::Completed);
+    check_statuses(
+      active->state()->dependencies(),
+      {Status::Canceled, Status::Completed, Status::Canceled});
+  }
+
+  WHEN("The bundle is canceled")
+  {
+    bool finished = false;
+    const auto active = begin(Bundle::Type::ParallelAll, finished);
+    active->cancel();
+    CHECK(finished);
+    CHECK(active->state()->status() == Status::Canceled);
+    check_status(ctrls, Status::Canceled);
+  }
+
+  WHEN("Only some of the events reach a checkpoint")
+  {
+    bool finished = false;
+    const auto active = begin(Bundle::Type::ParallelAll, finished);
+    active->backup();
+    for (const auto& ctrl : ctrls)
+      CHECK(ctrl->active->backups == 1);
+
+    // The events that have not reached a checkpoint keep their cached state
+    ctrls[1]->active->signals.checkpoint();
+    const auto backup = active->backup();
+    CHECK(ctrls[0]->active->backups == 1);
+    CHECK(ctrls[1]->active->backups == 2);
+    CHECK(ctrls[2]->active->backups == 1);
+    CHECK(backup.state()["dependencies"].size() == ctrls.size());
+  }
 }